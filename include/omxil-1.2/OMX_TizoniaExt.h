@@ -74,6 +74,12 @@
 #define OMX_TizoniaIndexParamAudioYoutubePlaylist    OMX_IndexVendorStartUnused + 18 /**< reference: OMX_TIZONIA_AUDIO_PARAM_YOUTUBEPLAYLISTTYPE */
 #define OMX_TizoniaIndexParamAudioDeezerSession      OMX_IndexVendorStartUnused + 19 /**< reference: OMX_TIZONIA_AUDIO_PARAM_DEEZERSESSIONTYPE */
 #define OMX_TizoniaIndexParamAudioDeezerPlaylist     OMX_IndexVendorStartUnused + 20 /**< reference: OMX_TIZONIA_AUDIO_PARAM_DEEZERPLAYLISTTYPE */
+#define OMX_TizoniaIndexConfigHttpMountpointStats    OMX_IndexVendorStartUnused + 21 /**< reference: OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE */
+#define OMX_TizoniaIndexConfigFileReaderMode         OMX_IndexVendorStartUnused + 22 /**< reference: OMX_TIZONIA_FILEREADERMODETYPE */
+#define OMX_TizoniaIndexConfigFileWriterMode         OMX_IndexVendorStartUnused + 23 /**< reference: OMX_TIZONIA_FILEWRITERMODETYPE */
+#define OMX_TizoniaIndexConfigFileWriterStats        OMX_IndexVendorStartUnused + 24 /**< reference: OMX_TIZONIA_FILEWRITERSTATSTYPE */
+#define OMX_TizoniaIndexConfigMediaDuration          OMX_IndexVendorStartUnused + 25 /**< reference: OMX_TIZONIA_MEDIADURATIONTYPE */
+#define OMX_TizoniaIndexConfigBufferBatch            OMX_IndexVendorStartUnused + 26 /**< reference: OMX_TIZONIA_BUFFERBATCHTYPE */
 
 /**
  * OMX_AUDIO_CODINGTYPE extensions
@@ -143,6 +149,107 @@ typedef struct OMX_TIZONIA_ICECASTMETADATATYPE {
     OMX_U8 cStreamTitle[1];     /* Max length is OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE */
 } OMX_TIZONIA_ICECASTMETADATATYPE;
 
+/* Read-only; refreshed by the component about once per second */
+typedef struct OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U32 nPortIndex;
+    OMX_U32 nListeners;           /* Listeners currently connected */
+    OMX_U32 nPeakListeners;
+    OMX_U32 nTotalConnections;    /* Listeners accepted so far */
+    OMX_U32 nRejectedConnections; /* Requests refused due to client limits */
+    OMX_U32 nListenerSkips;       /* Times a slow listener skipped audio */
+    OMX_U32 nRingBytes;           /* Encoded bytes queued for this mountpoint */
+    OMX_U64 nBytesSent;           /* Audio bytes sent to all listeners */
+} OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE;
+
+/**
+ * Binary file reader component
+ */
+
+typedef enum OMX_TIZONIA_FILEREADERMODE {
+    OMX_TIZONIA_FileReaderModeSync = 0,  /**< One read per buffer on the component's thread (Default) */
+    OMX_TIZONIA_FileReaderModeReadAhead, /**< A pool of threads keeps a window of the file read in advance */
+    OMX_TIZONIA_FileReaderModeMmap,      /**< Buffers are filled from a memory mapping of the file */
+    OMX_TIZONIA_FileReaderModeKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_TIZONIA_FileReaderModeVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_TIZONIA_FileReaderModeMax = 0x7FFFFFFF
+} OMX_TIZONIA_FILEREADERMODE;
+
+/* Takes effect the next time the component transitions to OMX_StateIdle */
+typedef struct OMX_TIZONIA_FILEREADERMODETYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_TIZONIA_FILEREADERMODE eMode;
+    OMX_U32 nWindowSize;   /**< Bytes read (or paged in) ahead of the consumer */
+    OMX_U32 nReadThreads;  /**< Read-ahead mode only; reads in flight at a time */
+} OMX_TIZONIA_FILEREADERMODETYPE;
+
+/**
+ * Binary file writer component
+ */
+
+typedef enum OMX_TIZONIA_FILEWRITERMODE {
+    OMX_TIZONIA_FileWriterModeSync = 0, /**< One write per buffer on the component's thread (Default) */
+    OMX_TIZONIA_FileWriterModeBatched,  /**< Buffers are coalesced into blocks written by a separate thread */
+    OMX_TIZONIA_FileWriterModeKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_TIZONIA_FileWriterModeVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_TIZONIA_FileWriterModeMax = 0x7FFFFFFF
+} OMX_TIZONIA_FILEWRITERMODE;
+
+typedef enum OMX_TIZONIA_FILEWRITERSYNCPOLICY {
+    OMX_TIZONIA_FileWriterSyncNone = 0, /**< Leave it to the kernel (Default) */
+    OMX_TIZONIA_FileWriterSyncOnEos,    /**< Sync once the EOS buffer has been written */
+    OMX_TIZONIA_FileWriterSyncPeriodic, /**< Sync every nSyncInterval bytes, and on EOS */
+    OMX_TIZONIA_FileWriterSyncKhronosExtensions = 0x6F000000, /**< Reserved region for introducing Khronos Standard Extensions */
+    OMX_TIZONIA_FileWriterSyncVendorStartUnused = 0x7F000000, /**< Reserved region for introducing Vendor Extensions */
+    OMX_TIZONIA_FileWriterSyncMax = 0x7FFFFFFF
+} OMX_TIZONIA_FILEWRITERSYNCPOLICY;
+
+/* Takes effect the next time the component transitions to OMX_StateIdle */
+typedef struct OMX_TIZONIA_FILEWRITERMODETYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_TIZONIA_FILEWRITERMODE eMode;
+    OMX_U32 nBlockSize;        /**< Batched mode only; bytes per write */
+    OMX_BOOL bDirectIO;        /**< Batched mode only; open the file with O_DIRECT */
+    OMX_TIZONIA_FILEWRITERSYNCPOLICY eSyncPolicy;
+    OMX_U32 nSyncInterval;     /**< Bytes between syncs with OMX_TIZONIA_FileWriterSyncPeriodic */
+    OMX_BOOL bDataSyncOnly;    /**< Use fdatasync instead of fsync */
+} OMX_TIZONIA_FILEWRITERMODETYPE;
+
+/* Read-only; refreshed by the component about once per second */
+typedef struct OMX_TIZONIA_FILEWRITERSTATSTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_U64 nBytesWritten;     /* Bytes that reached the file */
+    OMX_U32 nWrites;           /* Write system calls */
+    OMX_U32 nSyncs;            /* fsync/fdatasync calls */
+    OMX_U32 nBytesQueued;      /* Bytes accepted but not written yet */
+    OMX_U32 nMaxWriteTimeUs;   /* Slowest write or sync so far */
+    OMX_U32 nStalls;           /* Times the component waited for a free block */
+} OMX_TIZONIA_FILEWRITERSTATSTYPE;
+
+/* Read-only; exposed by demuxers on their config port */
+typedef struct OMX_TIZONIA_MEDIADURATIONTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_TICKS nDuration;       /* Microseconds; -1 while not known */
+} OMX_TIZONIA_MEDIADURATIONTYPE;
+
+/* Write-only; hands several buffer headers to a Tizonia component in one go,
+ * with the same effect as calling OMX_EmptyThisBuffer (eDir ==
+ * OMX_DirInput) or OMX_FillThisBuffer (eDir == OMX_DirOutput) on each of
+ * them, in order. The array is not referenced after OMX_SetConfig returns.
+ * Components that do not support it return OMX_ErrorUnsupportedIndex. */
+typedef struct OMX_TIZONIA_BUFFERBATCHTYPE {
+    OMX_U32 nSize;
+    OMX_VERSIONTYPE nVersion;
+    OMX_DIRTYPE eDir;
+    OMX_U32 nBufferCount;
+    OMX_BUFFERHEADERTYPE ** ppBuffers;
+} OMX_TIZONIA_BUFFERBATCHTYPE;
+
 /**
  * Opus encoder/decoder components
  * References:
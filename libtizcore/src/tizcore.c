@@ -50,6 +50,8 @@
 #include <tizrmproxy_c.h>
 #include <tizplatform.h>
 
+#include "tizcorecache.h"
+
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.ilcore"
@@ -222,6 +224,7 @@ struct tiz_core_registry_item
   OMX_STRING p_dl_name;
   OMX_STRING p_dl_path;
   OMX_PTR p_entry_point;
+  OMX_STRING p_entry_point_name;
   OMX_PTR p_dl_hdl;
   OMX_HANDLETYPE p_hdl;
   role_list_t p_roles;
@@ -238,6 +241,7 @@ struct tizcore
   OMX_ERRORTYPE error;
   tiz_core_state_t state;
   tiz_core_registry_t p_registry;
+  tiz_core_cache_t * p_cache;
   tiz_rm_t rm;
   tiz_rm_proxy_callbacks_t rmcbacks;
   bool rm_inited;
@@ -434,6 +438,35 @@ get_component_roles (OMX_COMPONENTTYPE * ap_hdl, role_list_t * app_role_list)
   return rc;
 }
 
+static void
+append_to_comp_registry (tiz_core_registry_item_t * ap_reg_item)
+{
+  tiz_core_t * p_core = get_core ();
+  tiz_core_registry_item_t * p_registry_last = NULL;
+
+  assert (p_core);
+  assert (ap_reg_item);
+
+  if (NULL == (p_core->p_registry))
+    {
+      /* First entry in the registry */
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "Component added (first component) [%s]",
+               ap_reg_item->p_comp_name);
+
+      p_core->p_registry = ap_reg_item;
+    }
+  else
+    {
+      /* Find the last entry in the registry */
+      p_registry_last = p_core->p_registry;
+      while (p_registry_last->p_next)
+        {
+          p_registry_last = p_registry_last->p_next;
+        }
+      p_registry_last->p_next = ap_reg_item;
+    }
+}
+
 static OMX_ERRORTYPE
 add_to_comp_registry (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name,
                       OMX_PTR ap_entry_point, OMX_PTR ap_dl_hdl,
@@ -527,34 +560,6 @@ add_to_comp_registry (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name,
 
   if (OMX_ErrorNone == rc)
     {
-
-      /* Add to registry */
-      if (NULL == (p_core->p_registry))
-        {
-          /* First entry in the registry */
-          TIZ_LOG (TIZ_PRIORITY_TRACE, "Component added (first component) [%s]",
-                   comp_name);
-
-          p_core->p_registry = p_registry_new;
-        }
-      else
-        {
-          /* Find the last entry in the registry */
-          p_registry_last = p_core->p_registry;
-          while (true)
-            {
-              if (p_registry_last->p_next)
-                {
-                  p_registry_last = p_registry_last->p_next;
-                }
-              else
-                {
-                  break;
-                }
-            }
-          p_registry_last->p_next = p_registry_new;
-        }
-
       /* Finish filling the registry entry... */
       p_registry_new->p_comp_name
         = strndup (comp_name, OMX_MAX_STRINGNAME_SIZE);
@@ -565,6 +570,9 @@ add_to_comp_registry (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name,
       p_registry_new->p_hdl = ap_hdl;
       p_registry_new->p_roles = p_role_list;
 
+      /* Add to registry */
+      append_to_comp_registry (p_registry_new);
+
       /* TODO: move this to its own function */
       TIZ_LOG (TIZ_PRIORITY_TRACE, "Component [%s] added.",
                p_registry_new->p_comp_name);
@@ -601,6 +609,7 @@ delete_registry (void)
       tiz_mem_free (p_registry_last->p_comp_name);
       tiz_mem_free (p_registry_last->p_dl_name);
       tiz_mem_free (p_registry_last->p_dl_path);
+      tiz_mem_free (p_registry_last->p_entry_point_name);
 
       /* Delete roles */
       p_roles_last = p_registry_last->p_roles;
@@ -659,19 +668,114 @@ instantiate_comp_lib (const OMX_STRING ap_path, const OMX_STRING ap_name,
   if (NULL == (*app_entry_point = dlsym (*app_dl_hdl, ap_entry_point_name)))
     {
       TIZ_LOG (TIZ_PRIORITY_DEBUG,
-               "[OMX_ErrorUndefined] : "
+               "[OMX_ErrorComponentNotFound] : "
                "Default entry point [%s] not found in [%s]",
                ap_entry_point_name, ap_name);
       dlclose (*app_dl_hdl);
       *app_dl_hdl = NULL;
-      return OMX_ErrorUndefined;
+      return OMX_ErrorComponentNotFound;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+add_to_registry_cache (const OMX_STRING ap_dl_path,
+                       const OMX_STRING ap_dl_name, const struct stat * ap_st,
+                       const tiz_core_registry_item_t * ap_reg_item)
+{
+  tiz_core_t * p_core = get_core ();
+  tiz_core_cache_entry_t * p_entry = NULL;
+  role_list_item_t * p_role = NULL;
+
+  assert (p_core);
+
+  tiz_check_omx (tiz_core_cache_add (
+    p_core->p_cache, ap_dl_path, ap_dl_name, ap_st,
+    ap_reg_item ? ap_reg_item->p_comp_name : NULL,
+    ap_reg_item ? ap_reg_item->p_entry_point_name : NULL, &p_entry));
+
+  for (p_role = ap_reg_item ? ap_reg_item->p_roles : NULL; p_role;
+       p_role = p_role->p_next)
+    {
+      tiz_check_omx (tiz_core_cache_add_role (
+        p_core->p_cache, p_entry, (const char *) p_role->role));
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+add_cached_to_comp_registry (const tiz_core_cache_entry_t * ap_entry)
+{
+  tiz_core_registry_item_t * p_reg_item = NULL;
+  role_list_item_t * p_last = NULL;
+  OMX_U32 i = 0;
+
+  assert (ap_entry);
+  assert (ap_entry->p_comp_name);
+
+  if (find_comp_in_registry (ap_entry->p_comp_name))
+    {
+      /* e.g. the folders are being re-scanned */
+      return OMX_ErrorNone;
+    }
+
+  tiz_check_null_ret_oom (
+    (p_reg_item = (tiz_core_registry_item_t *) tiz_mem_calloc (
+       1, sizeof (tiz_core_registry_item_t)))
+    != NULL);
+
+  p_reg_item->p_comp_name
+    = strndup (ap_entry->p_comp_name, OMX_MAX_STRINGNAME_SIZE);
+  p_reg_item->p_dl_name = strndup (ap_entry->p_dl_name, NAME_MAX);
+  p_reg_item->p_dl_path = strndup (ap_entry->p_dl_path, PATH_MAX);
+  p_reg_item->p_entry_point_name = strndup (ap_entry->p_entry_point, NAME_MAX);
+
+  for (i = 0; i < ap_entry->nroles; ++i)
+    {
+      role_list_item_t * p_role
+        = (role_list_item_t *) tiz_mem_calloc (1, sizeof (role_list_item_t));
+      if (!p_role)
+        {
+          break;
+        }
+      strncpy ((char *) p_role->role, ap_entry->pp_roles[i],
+               OMX_MAX_STRINGNAME_SIZE - 1);
+      if (p_last)
+        {
+          p_last->p_next = p_role;
+        }
+      else
+        {
+          p_reg_item->p_roles = p_role;
+        }
+      p_last = p_role;
+    }
+
+  if (!p_reg_item->p_comp_name || !p_reg_item->p_dl_name
+      || !p_reg_item->p_dl_path || !p_reg_item->p_entry_point_name
+      || i < ap_entry->nroles)
+    {
+      free_roles (p_reg_item->p_roles);
+      tiz_mem_free (p_reg_item->p_comp_name);
+      tiz_mem_free (p_reg_item->p_dl_name);
+      tiz_mem_free (p_reg_item->p_dl_path);
+      tiz_mem_free (p_reg_item->p_entry_point_name);
+      tiz_mem_free (p_reg_item);
+      return OMX_ErrorInsufficientResources;
     }
 
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "component [%s] : info found in cache",
+           p_reg_item->p_comp_name);
+  append_to_comp_registry (p_reg_item);
+
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
-cache_comp_info (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name)
+cache_comp_info (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name,
+                 const struct stat * ap_st)
 {
   OMX_PTR p_dl_hdl = NULL;
   OMX_PTR p_entry_point = NULL;
@@ -707,6 +811,18 @@ cache_comp_info (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name)
               TIZ_LOG (TIZ_PRIORITY_TRACE, "component [%s] : info cached",
                        p_reg_item->p_comp_name);
               p_reg_item->p_hdl = NULL;
+              /* The library is about to be unloaded */
+              p_reg_item->p_entry_point = NULL;
+              if (!(p_reg_item->p_entry_point_name = strndup (
+                      TIZ_DEFAULT_COMP_ENTRY_POINT_NAME, NAME_MAX)))
+                {
+                  rc = OMX_ErrorInsufficientResources;
+                }
+              else
+                {
+                  rc = add_to_registry_cache (ap_dl_path, ap_dl_name, ap_st,
+                                              p_reg_item);
+                }
             }
 
           /* delete the comp hadle */
@@ -716,6 +832,13 @@ cache_comp_info (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name)
 
       dlclose (p_dl_hdl);
     }
+  else if (OMX_ErrorComponentNotFound == rc)
+    {
+      /* Not a component plugin; there is no point in loading it again until
+         it changes. Libraries that can not be loaded at all (e.g. because of
+         a missing dependency) are not remembered. */
+      rc = add_to_registry_cache (ap_dl_path, ap_dl_name, ap_st, NULL);
+    }
 
   if (OMX_ErrorNoMore == rc)
     {
@@ -767,14 +890,40 @@ free_paths (char ** pp_paths, unsigned long npaths)
   tiz_mem_free (pp_paths);
 }
 
+static OMX_ERRORTYPE
+register_comp_lib (const OMX_STRING ap_dl_path, const OMX_STRING ap_dl_name,
+                   const struct stat * ap_st)
+{
+  tiz_core_t * p_core = get_core ();
+  const tiz_core_cache_entry_t * p_entry = NULL;
+
+  assert (p_core);
+  assert (p_core->p_cache);
+
+  /* Libraries that have not changed since they were last probed are not
+     loaded */
+  if ((p_entry = tiz_core_cache_find (p_core->p_cache, ap_dl_path, ap_dl_name,
+                                      ap_st)))
+    {
+      return p_entry->p_comp_name ? add_cached_to_comp_registry (p_entry)
+                                  : OMX_ErrorNone;
+    }
+
+  return cache_comp_info (ap_dl_path, ap_dl_name, ap_st);
+}
+
 static OMX_ERRORTYPE
 scan_component_folders (void)
 {
+  tiz_core_t * p_core = get_core ();
   DIR * p_dir;
   int i = 0;
   char ** pp_paths;
   unsigned long npaths = 0;
   struct dirent * p_dir_entry = NULL;
+  struct stat st;
+
+  assert (p_core);
 
   if (NULL == (pp_paths = find_component_paths (&npaths)))
     {
@@ -803,10 +952,13 @@ scan_component_folders (void)
                        != 'a')
                 {
                   TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s]", p_dir_entry->d_name);
-                  if (p_dir_entry->d_type == DT_REG)
+                  if (p_dir_entry->d_type == DT_REG
+                      && 0 == fstatat (dirfd (p_dir), p_dir_entry->d_name,
+                                       &st, 0))
                     {
                       if (OMX_ErrorInsufficientResources
-                          == cache_comp_info (pp_paths[i], p_dir_entry->d_name))
+                          == register_comp_lib (pp_paths[i],
+                                                p_dir_entry->d_name, &st))
                         {
                           (void) closedir (p_dir);
                           free_paths (pp_paths, npaths);
@@ -817,11 +969,17 @@ scan_component_folders (void)
             } /* while */
 
           (void) closedir (p_dir);
+          tiz_core_cache_purge (p_core->p_cache, pp_paths[i]);
         }
     }
 
   free_paths (pp_paths, npaths);
 
+  if (OMX_ErrorNone != tiz_core_cache_save (p_core->p_cache))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Could not save the registry cache");
+    }
+
   return OMX_ErrorNone;
 }
 
@@ -951,8 +1109,7 @@ instantiate_component (tiz_core_msg_gethandle_t * ap_msg)
       if (OMX_ErrorNone
           == (rc = instantiate_comp_lib (
                 p_reg_item->p_dl_path, p_reg_item->p_dl_name,
-                (const OMX_STRING) TIZ_DEFAULT_COMP_ENTRY_POINT_NAME, &p_dl_hdl,
-                &p_entry_point)))
+                p_reg_item->p_entry_point_name, &p_dl_hdl, &p_entry_point)))
         {
           /* TODO: refactor these two blocks into a function. They are also used */
           /* in add_to_comp_registry */
@@ -997,6 +1154,7 @@ instantiate_component (tiz_core_msg_gethandle_t * ap_msg)
           *(ap_msg->pp_hdl) = p_hdl;
           p_reg_item->p_hdl = p_hdl;
           p_reg_item->p_dl_hdl = p_dl_hdl;
+          p_reg_item->p_entry_point = p_entry_point;
         }
     }
   else
@@ -1043,6 +1201,7 @@ remove_comp_instance (tiz_core_msg_freehandle_t * ap_msg)
       p_reg_item->p_hdl = NULL;
       dlclose (p_reg_item->p_dl_hdl);
       p_reg_item->p_dl_hdl = NULL;
+      p_reg_item->p_entry_point = NULL;
     }
   else
     {
@@ -1080,6 +1239,14 @@ do_init (tiz_core_state_t * ap_state, tiz_core_msg_t * ap_msg)
   (void) tiz_thread_setname (&(p_core->thread),
                              (const OMX_STRING) TIZ_IL_CORE_THREAD_NAME);
 
+  if (!p_core->p_cache)
+    {
+      /* The registry cache is only kept on disk if enabled (the default) */
+      const char * p_value = tiz_rcfile_get_value ("ilcore", "registry-cache");
+      tiz_check_omx (tiz_core_cache_init (
+        &(p_core->p_cache), !(p_value && 0 == strncmp (p_value, "false", 5))));
+    }
+
   *ap_state = ETIZCoreStateStarted;
   return scan_component_folders ();
 }
@@ -1105,6 +1272,8 @@ do_deinit (tiz_core_state_t * ap_state, tiz_core_msg_t * ap_msg)
     }
 
   delete_registry ();
+  tiz_core_cache_destroy (p_core->p_cache);
+  p_core->p_cache = NULL;
   return OMX_ErrorNone;
 }
 
@@ -0,0 +1,530 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizcorecache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL Core - Component registry cache
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "tizcorecache.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.ilcore.cache"
+#endif
+
+#ifndef PACKAGE_VERSION
+#define PACKAGE_VERSION ""
+#endif
+
+/* The file is text, one line per library, with tab-separated fields:
+ * path, name, mtime (ns), size, component name (empty if the library is not a
+ * component plugin), entry point and then the component's roles. The first
+ * line identifies the format and the version of Tizonia that wrote it. */
+#define TIZ_CORE_CACHE_FILE "/ilcore.registry"
+#define TIZ_CORE_CACHE_MAGIC "tizonia-ilcore-registry\t1\t" PACKAGE_VERSION
+#define TIZ_CORE_CACHE_MIN_FIELDS 6
+#define TIZ_CORE_CACHE_MAX_ROLES 255
+
+struct tiz_core_cache
+{
+  tiz_core_cache_entry_t * p_entries;
+  char * p_cache_dir;
+  char * p_cache_path;
+  bool dirty;
+};
+
+/* Same location as the player's probe cache. The paths are built on the heap:
+ * the IL Core thread runs with a minimal stack. */
+static char *
+cache_dir (void)
+{
+  const char * p_xdg = getenv ("XDG_CACHE_HOME");
+  const char * p_home = getenv ("HOME");
+  const char * p_base = NULL;
+  const char * p_suffix = NULL;
+  char * p_dir = NULL;
+  size_t len = 0;
+
+  if (p_xdg && *p_xdg)
+    {
+      p_base = p_xdg;
+      p_suffix = "/tizonia";
+    }
+  else if (p_home && *p_home)
+    {
+      p_base = p_home;
+      p_suffix = "/.cache/tizonia";
+    }
+
+  if (p_base)
+    {
+      len = strlen (p_base) + strlen (p_suffix) + 1;
+      if (len <= PATH_MAX && (p_dir = tiz_mem_alloc (len)))
+        {
+          (void) snprintf (p_dir, len, "%s%s", p_base, p_suffix);
+        }
+    }
+  return p_dir;
+}
+
+static inline uint64_t
+mtime_ns_of (const struct stat * ap_st)
+{
+  return (uint64_t) ap_st->st_mtim.tv_sec * 1000000000ULL
+         + ap_st->st_mtim.tv_nsec;
+}
+
+/* Strings with separators can not be stored in the file */
+static inline bool
+is_storable (const char * ap_str)
+{
+  return !ap_str || !strpbrk (ap_str, "\t\n");
+}
+
+static void
+free_entry (tiz_core_cache_entry_t * ap_entry)
+{
+  OMX_U32 i = 0;
+  if (ap_entry)
+    {
+      for (i = 0; i < ap_entry->nroles; ++i)
+        {
+          tiz_mem_free (ap_entry->pp_roles[i]);
+        }
+      tiz_mem_free (ap_entry->pp_roles);
+      tiz_mem_free (ap_entry->p_dl_path);
+      tiz_mem_free (ap_entry->p_dl_name);
+      tiz_mem_free (ap_entry->p_comp_name);
+      tiz_mem_free (ap_entry->p_entry_point);
+      tiz_mem_free (ap_entry);
+    }
+}
+
+static tiz_core_cache_entry_t **
+find_link (tiz_core_cache_t * ap_cache, const char * ap_dl_path,
+           const char * ap_dl_name)
+{
+  tiz_core_cache_entry_t ** pp_link = &(ap_cache->p_entries);
+  while (*pp_link
+         && (0 != strcmp ((*pp_link)->p_dl_name, ap_dl_name)
+             || 0 != strcmp ((*pp_link)->p_dl_path, ap_dl_path)))
+    {
+      pp_link = &((*pp_link)->p_next);
+    }
+  return pp_link;
+}
+
+static tiz_core_cache_entry_t *
+new_entry (const char * ap_dl_path, const char * ap_dl_name,
+           const uint64_t a_mtime_ns, const uint64_t a_size,
+           const char * ap_comp_name, const char * ap_entry_point)
+{
+  tiz_core_cache_entry_t * p_entry = tiz_mem_calloc (1, sizeof (*p_entry));
+  if (p_entry)
+    {
+      p_entry->p_dl_path = strndup (ap_dl_path, PATH_MAX);
+      p_entry->p_dl_name = strndup (ap_dl_name, NAME_MAX);
+      p_entry->p_comp_name
+        = ap_comp_name ? strndup (ap_comp_name, OMX_MAX_STRINGNAME_SIZE) : NULL;
+      p_entry->p_entry_point
+        = strndup (ap_entry_point ? ap_entry_point : "", NAME_MAX);
+      p_entry->mtime_ns = a_mtime_ns;
+      p_entry->size = a_size;
+      if (!p_entry->p_dl_path || !p_entry->p_dl_name
+          || (ap_comp_name && !p_entry->p_comp_name)
+          || !p_entry->p_entry_point)
+        {
+          free_entry (p_entry);
+          p_entry = NULL;
+        }
+    }
+  return p_entry;
+}
+
+static bool
+append_role (tiz_core_cache_entry_t * ap_entry, const char * ap_role)
+{
+  char ** pp_roles = NULL;
+
+  if (ap_entry->nroles >= TIZ_CORE_CACHE_MAX_ROLES
+      || strlen (ap_role) >= OMX_MAX_STRINGNAME_SIZE)
+    {
+      return false;
+    }
+  if (!(pp_roles = tiz_mem_realloc (ap_entry->pp_roles,
+                                    (ap_entry->nroles + 1) * sizeof (char *))))
+    {
+      return false;
+    }
+  ap_entry->pp_roles = pp_roles;
+  if (!(pp_roles[ap_entry->nroles] = strdup (ap_role)))
+    {
+      return false;
+    }
+  ap_entry->nroles++;
+  return true;
+}
+
+/* Parses one line of the file; the line is modified in the process */
+static tiz_core_cache_entry_t *
+parse_entry (char * ap_line)
+{
+  char * p_fields[TIZ_CORE_CACHE_MIN_FIELDS];
+  tiz_core_cache_entry_t * p_entry = NULL;
+  char * p_role = NULL;
+  char * p_end = NULL;
+  unsigned long long mtime_ns = 0;
+  unsigned long long size = 0;
+  int i = 0;
+
+  ap_line[strcspn (ap_line, "\n")] = '\0';
+  for (i = 0; i < TIZ_CORE_CACHE_MIN_FIELDS; ++i)
+    {
+      if (!(p_fields[i] = strsep (&ap_line, "\t")))
+        {
+          return NULL;
+        }
+    }
+
+  errno = 0;
+  mtime_ns = strtoull (p_fields[2], &p_end, 10);
+  if (0 != errno || '\0' != *p_end)
+    {
+      return NULL;
+    }
+  size = strtoull (p_fields[3], &p_end, 10);
+  if (0 != errno || '\0' != *p_end || '\0' == *p_fields[0]
+      || '\0' == *p_fields[1]
+      || strlen (p_fields[4]) >= OMX_MAX_STRINGNAME_SIZE)
+    {
+      return NULL;
+    }
+
+  if (!(p_entry = new_entry (p_fields[0], p_fields[1], mtime_ns, size,
+                             '\0' != *p_fields[4] ? p_fields[4] : NULL,
+                             p_fields[5])))
+    {
+      return NULL;
+    }
+
+  while ((p_role = strsep (&ap_line, "\t")))
+    {
+      if (!p_entry->p_comp_name || !append_role (p_entry, p_role))
+        {
+          free_entry (p_entry);
+          return NULL;
+        }
+    }
+
+  /* A component without roles is not registered */
+  if (p_entry->p_comp_name && 0 == p_entry->nroles)
+    {
+      free_entry (p_entry);
+      return NULL;
+    }
+
+  return p_entry;
+}
+
+static void
+load (tiz_core_cache_t * ap_cache)
+{
+  FILE * p_file = NULL;
+  char * p_line = NULL;
+  size_t line_len = 0;
+  OMX_U32 count = 0;
+
+  assert (ap_cache);
+
+  if (!(p_file = fopen (ap_cache->p_cache_path, "r")))
+    {
+      return;
+    }
+
+  if (getline (&p_line, &line_len, p_file) > 0
+      && 0 == strcmp (p_line, TIZ_CORE_CACHE_MAGIC "\n"))
+    {
+      while (getline (&p_line, &line_len, p_file) > 0)
+        {
+          tiz_core_cache_entry_t * p_entry = parse_entry (p_line);
+          tiz_core_cache_entry_t ** pp_link = NULL;
+          if (!p_entry)
+            {
+              /* Whatever could not be parsed is probed again, and the file
+                 rewritten */
+              ap_cache->dirty = true;
+              continue;
+            }
+          pp_link
+            = find_link (ap_cache, p_entry->p_dl_path, p_entry->p_dl_name);
+          if (*pp_link)
+            {
+              free_entry (p_entry);
+              continue;
+            }
+          *pp_link = p_entry;
+          count++;
+        }
+    }
+
+  free (p_line);
+  (void) fclose (p_file);
+
+  TIZ_LOG (TIZ_PRIORITY_DEBUG, "[%s] : loaded [%u] entries",
+           ap_cache->p_cache_path, count);
+}
+
+OMX_ERRORTYPE
+tiz_core_cache_init (tiz_core_cache_t ** app_cache, const bool a_persistent)
+{
+  tiz_core_cache_t * p_cache = NULL;
+
+  assert (app_cache);
+
+  tiz_check_null_ret_oom ((p_cache = tiz_mem_calloc (1, sizeof (*p_cache)))
+                          != NULL);
+
+  /* Without a cache location, the cache still serves the current process */
+  if (a_persistent && (p_cache->p_cache_dir = cache_dir ())
+      && (p_cache->p_cache_path
+          = tiz_mem_alloc (strlen (p_cache->p_cache_dir)
+                           + sizeof (TIZ_CORE_CACHE_FILE))))
+    {
+      strcpy (p_cache->p_cache_path, p_cache->p_cache_dir);
+      strcat (p_cache->p_cache_path, TIZ_CORE_CACHE_FILE);
+      load (p_cache);
+    }
+
+  *app_cache = p_cache;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_core_cache_destroy (tiz_core_cache_t * ap_cache)
+{
+  if (ap_cache)
+    {
+      while (ap_cache->p_entries)
+        {
+          tiz_core_cache_entry_t * p_next = ap_cache->p_entries->p_next;
+          free_entry (ap_cache->p_entries);
+          ap_cache->p_entries = p_next;
+        }
+      tiz_mem_free (ap_cache->p_cache_dir);
+      tiz_mem_free (ap_cache->p_cache_path);
+      tiz_mem_free (ap_cache);
+    }
+}
+
+const tiz_core_cache_entry_t *
+tiz_core_cache_find (tiz_core_cache_t * ap_cache, const char * ap_dl_path,
+                     const char * ap_dl_name, const struct stat * ap_st)
+{
+  tiz_core_cache_entry_t * p_entry = NULL;
+
+  assert (ap_cache);
+  assert (ap_dl_path);
+  assert (ap_dl_name);
+  assert (ap_st);
+
+  p_entry = *find_link (ap_cache, ap_dl_path, ap_dl_name);
+  if (p_entry && p_entry->mtime_ns == mtime_ns_of (ap_st)
+      && p_entry->size == (uint64_t) ap_st->st_size)
+    {
+      p_entry->seen = true;
+      return p_entry;
+    }
+  return NULL;
+}
+
+OMX_ERRORTYPE
+tiz_core_cache_add (tiz_core_cache_t * ap_cache, const char * ap_dl_path,
+                    const char * ap_dl_name, const struct stat * ap_st,
+                    const char * ap_comp_name, const char * ap_entry_point,
+                    tiz_core_cache_entry_t ** app_entry)
+{
+  tiz_core_cache_entry_t * p_entry = NULL;
+  tiz_core_cache_entry_t ** pp_link = NULL;
+
+  assert (ap_cache);
+  assert (ap_dl_path);
+  assert (ap_dl_name);
+  assert (ap_st);
+
+  tiz_check_null_ret_oom (
+    (p_entry = new_entry (ap_dl_path, ap_dl_name, mtime_ns_of (ap_st),
+                          ap_st->st_size, ap_comp_name, ap_entry_point))
+    != NULL);
+
+  pp_link = find_link (ap_cache, ap_dl_path, ap_dl_name);
+  if (*pp_link)
+    {
+      p_entry->p_next = (*pp_link)->p_next;
+      free_entry (*pp_link);
+    }
+  *pp_link = p_entry;
+  p_entry->seen = true;
+  ap_cache->dirty = true;
+
+  if (app_entry)
+    {
+      *app_entry = p_entry;
+    }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_core_cache_add_role (tiz_core_cache_t * ap_cache,
+                         tiz_core_cache_entry_t * ap_entry,
+                         const char * ap_role)
+{
+  assert (ap_cache);
+  assert (ap_entry);
+  assert (ap_role);
+  ap_cache->dirty = true;
+  return append_role (ap_entry, ap_role) ? OMX_ErrorNone
+                                         : OMX_ErrorInsufficientResources;
+}
+
+void
+tiz_core_cache_purge (tiz_core_cache_t * ap_cache, const char * ap_dl_path)
+{
+  tiz_core_cache_entry_t ** pp_link = NULL;
+
+  assert (ap_cache);
+  assert (ap_dl_path);
+
+  pp_link = &(ap_cache->p_entries);
+  while (*pp_link)
+    {
+      tiz_core_cache_entry_t * p_entry = *pp_link;
+      if (0 == strcmp (p_entry->p_dl_path, ap_dl_path))
+        {
+          if (!p_entry->seen)
+            {
+              TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s/%s] : gone", ap_dl_path,
+                       p_entry->p_dl_name);
+              *pp_link = p_entry->p_next;
+              free_entry (p_entry);
+              ap_cache->dirty = true;
+              continue;
+            }
+          p_entry->seen = false;
+        }
+      pp_link = &(p_entry->p_next);
+    }
+}
+
+OMX_ERRORTYPE
+tiz_core_cache_save (tiz_core_cache_t * ap_cache)
+{
+  const tiz_core_cache_entry_t * p_entry = NULL;
+  char * p_tmp_path = NULL;
+  size_t len = 0;
+  FILE * p_file = NULL;
+  bool written = false;
+
+  assert (ap_cache);
+
+  if (!ap_cache->dirty || !ap_cache->p_cache_path)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (0 != mkdir (ap_cache->p_cache_dir, 0700) && EEXIST != errno)
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* Written aside and renamed, so that other processes never see a partial
+     file */
+  len = strlen (ap_cache->p_cache_path) + 24;
+  tiz_check_null_ret_oom ((p_tmp_path = tiz_mem_alloc (len)) != NULL);
+  (void) snprintf (p_tmp_path, len, "%s.%ld", ap_cache->p_cache_path,
+                   (long) getpid ());
+  if (!(p_file = fopen (p_tmp_path, "w")))
+    {
+      tiz_mem_free (p_tmp_path);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  written = fprintf (p_file, "%s\n", TIZ_CORE_CACHE_MAGIC) > 0;
+  for (p_entry = ap_cache->p_entries; p_entry && written;
+       p_entry = p_entry->p_next)
+    {
+      OMX_U32 i = 0;
+      bool storable = is_storable (p_entry->p_dl_path)
+                      && is_storable (p_entry->p_dl_name)
+                      && is_storable (p_entry->p_comp_name)
+                      && is_storable (p_entry->p_entry_point);
+      for (i = 0; i < p_entry->nroles; ++i)
+        {
+          storable = storable && is_storable (p_entry->pp_roles[i]);
+        }
+      if (!storable)
+        {
+          continue;
+        }
+      written = fprintf (p_file, "%s\t%s\t%llu\t%llu\t%s\t%s",
+                         p_entry->p_dl_path, p_entry->p_dl_name,
+                         (unsigned long long) p_entry->mtime_ns,
+                         (unsigned long long) p_entry->size,
+                         p_entry->p_comp_name ? p_entry->p_comp_name : "",
+                         p_entry->p_entry_point)
+                > 0;
+      for (i = 0; i < p_entry->nroles && written; ++i)
+        {
+          written = fprintf (p_file, "\t%s", p_entry->pp_roles[i]) > 0;
+        }
+      written = written && EOF != fputc ('\n', p_file);
+    }
+  written = (0 == fclose (p_file)) && written;
+
+  if (!written || 0 != rename (p_tmp_path, ap_cache->p_cache_path))
+    {
+      (void) unlink (p_tmp_path);
+      tiz_mem_free (p_tmp_path);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  tiz_mem_free (p_tmp_path);
+
+  TIZ_LOG (TIZ_PRIORITY_DEBUG, "[%s] : saved", ap_cache->p_cache_path);
+  ap_cache->dirty = false;
+  return OMX_ErrorNone;
+}
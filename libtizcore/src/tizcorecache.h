@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizcorecache.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL Core - Component registry cache
+ *
+ * What the IL Core learns about each library found in the component folders
+ * (the name of the component it contains, the component's roles and the
+ * library's entry point, or the fact that it is not a component plugin),
+ * keyed by the library's path, modification time and size. The cache lets
+ * the IL Core fill its registry without loading the libraries; it is kept in
+ * the user's cache directory, so that it survives across processes.
+ */
+
+#ifndef TIZCORECACHE_H
+#define TIZCORECACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct tiz_core_cache tiz_core_cache_t;
+
+typedef struct tiz_core_cache_entry tiz_core_cache_entry_t;
+struct tiz_core_cache_entry
+{
+  char * p_dl_path;
+  char * p_dl_name;
+  uint64_t mtime_ns;
+  uint64_t size;
+  /* NULL if the library is not a component plugin */
+  char * p_comp_name;
+  char * p_entry_point;
+  char ** pp_roles;
+  OMX_U32 nroles;
+  bool seen;
+  tiz_core_cache_entry_t * p_next;
+};
+
+/* Creates the cache. When a_persistent is true, the cache is loaded from, and
+ * saved to, the user's cache directory. */
+OMX_ERRORTYPE
+tiz_core_cache_init (tiz_core_cache_t ** app_cache, const bool a_persistent);
+
+void
+tiz_core_cache_destroy (tiz_core_cache_t * ap_cache);
+
+/* Returns the entry of the library, or NULL if there is none or the library
+ * has changed since the entry was added. */
+const tiz_core_cache_entry_t *
+tiz_core_cache_find (tiz_core_cache_t * ap_cache, const char * ap_dl_path,
+                     const char * ap_dl_name, const struct stat * ap_st);
+
+/* Adds an entry for the library, replacing any previous one. Use a NULL
+ * ap_comp_name for libraries that do not contain a component. */
+OMX_ERRORTYPE
+tiz_core_cache_add (tiz_core_cache_t * ap_cache, const char * ap_dl_path,
+                    const char * ap_dl_name, const struct stat * ap_st,
+                    const char * ap_comp_name, const char * ap_entry_point,
+                    tiz_core_cache_entry_t ** app_entry);
+
+OMX_ERRORTYPE
+tiz_core_cache_add_role (tiz_core_cache_t * ap_cache,
+                         tiz_core_cache_entry_t * ap_entry,
+                         const char * ap_role);
+
+/* Drops the entries of the libraries of folder ap_dl_path that have not been
+ * found or added since the previous purge of the folder. */
+void
+tiz_core_cache_purge (tiz_core_cache_t * ap_cache, const char * ap_dl_path);
+
+/* Writes the cache to the user's cache directory, if it is persistent and it
+ * has changed since it was loaded. */
+OMX_ERRORTYPE
+tiz_core_cache_save (tiz_core_cache_t * ap_cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZCORECACHE_H */
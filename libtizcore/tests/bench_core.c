@@ -0,0 +1,173 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_core.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  IL Core start-up micro-benchmark: component registry cache
+ *
+ * Measures OMX_Init, plus the enumeration of the components found, with the
+ * registry cache disabled (every library in the component folders is loaded
+ * and its component instantiated), with an empty cache, and with the cache
+ * written by the previous run. Each run happens in its own process, with a
+ * private rc file and cache directory.
+ *
+ * Usage: bench_core [component folder] [runs per configuration]
+ */
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <OMX_Core.h>
+
+#include <tizplatform.h>
+
+#include "check_tizcore.h"
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+run (const char * ap_name, const char * ap_comp_path, const char * ap_cache_dir,
+     const bool a_cache)
+{
+  char rc_path[] = "/tmp/bench_core.XXXXXX";
+  char comp_name[OMX_MAX_STRINGNAME_SIZE];
+  struct rusage usage;
+  FILE * p_file = NULL;
+  OMX_U32 ncomps = 0;
+  double start, elapsed;
+  int fd = -1;
+
+  /* A private rc file, so that no resource manager is needed */
+  if ((fd = mkstemp (rc_path)) < 0 || !(p_file = fdopen (fd, "w")))
+    {
+      fprintf (stderr, "could not create the rc file\n");
+      return EXIT_FAILURE;
+    }
+  fprintf (p_file,
+           "[ilcore]\ncomponent-paths = %s\nconfig-reload = false\n"
+           "registry-cache = %s\n\n[resource-management]\nenabled = false\n",
+           ap_comp_path, a_cache ? "true" : "false");
+  fclose (p_file);
+  setenv ("TIZONIA_RC_FILE", rc_path, 1);
+  setenv ("XDG_CACHE_HOME", ap_cache_dir, 1);
+
+  tiz_log_init ();
+
+  start = now_secs ();
+  if (OMX_ErrorNone != OMX_Init ())
+    {
+      fprintf (stderr, "%s: OMX_Init failed\n", ap_name);
+      unlink (rc_path);
+      return EXIT_FAILURE;
+    }
+  /* Index 0 re-scans the folders, as a player does on start-up */
+  while (OMX_ErrorNone
+         == OMX_ComponentNameEnum (comp_name, sizeof (comp_name), ncomps))
+    {
+      ncomps++;
+    }
+  elapsed = now_secs () - start;
+
+  (void) OMX_Deinit ();
+  unlink (rc_path);
+
+  getrusage (RUSAGE_SELF, &usage);
+  printf ("%-24s components=%-3u %10.3f ms   maxrss=%ld KiB\n", ap_name,
+          (unsigned) ncomps, elapsed * 1000, usage.ru_maxrss);
+
+  return EXIT_SUCCESS;
+}
+
+static int
+run_in_child (const char * ap_name, const char * ap_comp_path,
+              const char * ap_cache_dir, const bool a_cache)
+{
+  int status = 0;
+  pid_t pid = 0;
+
+  fflush (stdout);
+  if (0 == (pid = fork ()))
+    {
+      exit (run (ap_name, ap_comp_path, ap_cache_dir, a_cache));
+    }
+  return (pid > 0 && pid == waitpid (pid, &status, 0) && WIFEXITED (status)
+          && EXIT_SUCCESS == WEXITSTATUS (status))
+           ? EXIT_SUCCESS
+           : EXIT_FAILURE;
+}
+
+int
+main (int argc, char ** argv)
+{
+  const char * p_comp_path = argc > 1 ? argv[1] : TIZ_CORE_TEST_COMPONENT_PATH;
+  int nruns = argc > 2 ? atoi (argv[2]) : 3;
+  char cache_dir[] = "/tmp/bench_core_cache.XXXXXX";
+  char cache_file[PATH_MAX];
+  int rc = EXIT_SUCCESS;
+  int i = 0;
+
+  if (nruns < 1 || !mkdtemp (cache_dir))
+    {
+      fprintf (stderr,
+               "usage: %s [component folder] [runs per configuration]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < nruns && EXIT_SUCCESS == rc; ++i)
+    {
+      rc = run_in_child ("no cache", p_comp_path, cache_dir, false);
+    }
+  for (i = 0; i < nruns && EXIT_SUCCESS == rc; ++i)
+    {
+      /* Start from an empty cache each time */
+      snprintf (cache_file, sizeof (cache_file), "%s/tizonia/ilcore.registry",
+                cache_dir);
+      unlink (cache_file);
+      rc = run_in_child ("cold cache", p_comp_path, cache_dir, true);
+    }
+  for (i = 0; i < nruns && EXIT_SUCCESS == rc; ++i)
+    {
+      rc = run_in_child ("warm cache", p_comp_path, cache_dir, true);
+    }
+
+  snprintf (cache_file, sizeof (cache_file), "%s/tizonia/ilcore.registry",
+            cache_dir);
+  unlink (cache_file);
+  snprintf (cache_file, sizeof (cache_file), "%s/tizonia", cache_dir);
+  rmdir (cache_file);
+  rmdir (cache_dir);
+
+  return rc;
+}
@@ -40,6 +40,8 @@
 #include <sys/types.h>
 #include <signal.h>
 #include <limits.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include <tizplatform.h>
 
@@ -284,6 +286,54 @@ START_TEST (test_ilcore_role_of_comp_enum)
   fail_if (error != OMX_ErrorNone);
 }
 
+END_TEST
+START_TEST (test_ilcore_registry_cache)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_U32 appData;
+  OMX_CALLBACKTYPE callBacks;
+  OMX_S8 role[OMX_MAX_STRINGNAME_SIZE];
+  char cache_dir[] = "/tmp/check_tizcore.XXXXXX";
+  char cache_file[PATH_MAX];
+  struct stat st;
+  int i = 0;
+
+  fail_if (NULL == mkdtemp (cache_dir));
+  setenv ("XDG_CACHE_HOME", cache_dir, 1);
+  snprintf (cache_file, sizeof (cache_file), "%s/tizonia/ilcore.registry",
+            cache_dir);
+
+  /* The first run probes the libraries and writes the cache; the second one
+     fills the registry from it */
+  for (i = 0; i < 2; ++i)
+    {
+      error = OMX_Init ();
+      fail_if (error != OMX_ErrorNone);
+      fail_if (0 != stat (cache_file, &st));
+
+      error = OMX_RoleOfComponentEnum ((OMX_STRING) role,
+                                       TIZ_CORE_TEST_COMPONENT_NAME, 0);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (0 != strcmp ((const char *) role, TIZ_CORE_TEST_COMPONENT_ROLE));
+
+      error = OMX_GetHandle (&p_hdl, TIZ_CORE_TEST_COMPONENT_NAME,
+                             (OMX_PTR *) (&appData), &callBacks);
+      fail_if (error != OMX_ErrorNone);
+      error = OMX_FreeHandle (p_hdl);
+      fail_if (error != OMX_ErrorNone);
+
+      error = OMX_Deinit ();
+      fail_if (error != OMX_ErrorNone);
+    }
+
+  unlink (cache_file);
+  snprintf (cache_file, sizeof (cache_file), "%s/tizonia", cache_dir);
+  rmdir (cache_file);
+  rmdir (cache_dir);
+  unsetenv ("XDG_CACHE_HOME");
+}
+
 END_TEST Suite * tizcore_suite (void)
 {
   TCase *tc_ilcore;
@@ -302,6 +352,7 @@ END_TEST Suite * tizcore_suite (void)
   /*   tcase_add_test (tc_ilcore, test_ilcore_setup_tunnel_tear_down_tunnel); */
   tcase_add_test (tc_ilcore, test_ilcore_comp_of_role_enum);
   tcase_add_test (tc_ilcore, test_ilcore_role_of_comp_enum);
+  tcase_add_test (tc_ilcore, test_ilcore_registry_cache);
 
   /* TODO: Negative case for OMX_ErrorPortsNotConnected error */
 
@@ -0,0 +1,339 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizbufpool.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Process-wide pool of buffer memory
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <tizplatform.h>
+
+#include "tizbufpool.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.bufpool"
+#endif
+
+#define BUFPOOL_CACHE_LINE 64
+#define BUFPOOL_HUGEPAGE_SIZE (2 * 1024 * 1024)
+#define BUFPOOL_DEFAULT_CACHE_MB 32
+#define BUFPOOL_HASH_BITS 8
+#define BUFPOOL_HASH_SIZE (1u << BUFPOOL_HASH_BITS)
+
+typedef struct bufpool_rec bufpool_rec_t;
+struct bufpool_rec
+{
+  OMX_U8 * p_buf;
+  size_t size;
+  size_t align;
+  bufpool_rec_t * p_next;
+};
+
+/* The free buffers of a given size and alignment */
+typedef struct bufpool_bucket bufpool_bucket_t;
+struct bufpool_bucket
+{
+  size_t size;
+  size_t align;
+  bufpool_rec_t * p_free;
+  bufpool_bucket_t * p_next;
+};
+
+typedef struct bufpool bufpool_t;
+struct bufpool
+{
+  size_t page_size;
+  size_t max_cached;
+  bool hugepages;
+  bufpool_bucket_t * p_buckets;
+  bufpool_rec_t * p_used[BUFPOOL_HASH_SIZE]; /* buffers in use, by address */
+  tiz_bufpool_info_t info;
+};
+
+static pthread_once_t g_bufpool_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t g_bufpool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bufpool_t g_bufpool;
+
+static void
+init_bufpool (void)
+{
+  const char * p_value = NULL;
+  long cache_mb = BUFPOOL_DEFAULT_CACHE_MB;
+  long page_size = sysconf (_SC_PAGESIZE);
+
+  g_bufpool.page_size = page_size > 0 ? (size_t) page_size : 4096;
+
+  if ((p_value = tiz_rcfile_get_value ("ilcore", "buffer-pool-cache-mb")))
+    {
+      cache_mb = strtol (p_value, NULL, 10);
+    }
+  g_bufpool.max_cached = (size_t) (cache_mb > 0 ? cache_mb : 0) * 1024 * 1024;
+
+  if ((p_value = tiz_rcfile_get_value ("ilcore", "buffer-pool-hugepages")))
+    {
+      g_bufpool.hugepages = (0 == strncmp (p_value, "true", 4));
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "cache [%lu] bytes - hugepages [%s]",
+           (unsigned long) g_bufpool.max_cached,
+           g_bufpool.hugepages ? "YES" : "NO");
+}
+
+/* Buffers are aligned to a cache line, a page or a huge page, so their low
+   address bits carry little information. A multiplicative (Fibonacci) hash
+   takes the bucket from the top bits of the product instead, which depend on
+   all of the address bits. */
+static inline size_t
+used_slot (const void * ap_buf)
+{
+  return (size_t) (((uint64_t) (uintptr_t) ap_buf * 0x9E3779B97F4A7C15ULL)
+                   >> (64 - BUFPOOL_HASH_BITS));
+}
+
+static inline size_t
+round_up (size_t a_size, size_t a_align)
+{
+  return (a_size + a_align - 1) & ~(a_align - 1);
+}
+
+static void
+size_class (size_t a_size, size_t * ap_size, size_t * ap_align)
+{
+  size_t align = BUFPOOL_CACHE_LINE;
+  if (g_bufpool.hugepages && a_size >= BUFPOOL_HUGEPAGE_SIZE)
+    {
+      align = BUFPOOL_HUGEPAGE_SIZE;
+    }
+  else if (a_size >= g_bufpool.page_size)
+    {
+      align = g_bufpool.page_size;
+    }
+  *ap_size = round_up (a_size, align);
+  *ap_align = align;
+}
+
+/* Called with g_bufpool_mutex held */
+static bufpool_bucket_t *
+find_bucket (size_t a_size, size_t a_align, bool a_create)
+{
+  bufpool_bucket_t * p_bucket = g_bufpool.p_buckets;
+  while (p_bucket && (p_bucket->size != a_size || p_bucket->align != a_align))
+    {
+      p_bucket = p_bucket->p_next;
+    }
+  if (!p_bucket && a_create
+      && (p_bucket = tiz_mem_calloc (1, sizeof (bufpool_bucket_t))))
+    {
+      p_bucket->size = a_size;
+      p_bucket->align = a_align;
+      p_bucket->p_next = g_bufpool.p_buckets;
+      g_bufpool.p_buckets = p_bucket;
+    }
+  return p_bucket;
+}
+
+static bufpool_rec_t *
+new_buffer (size_t a_size, size_t a_align)
+{
+  bufpool_rec_t * p_rec = NULL;
+  void * p_buf = NULL;
+
+  if (0 != posix_memalign (&p_buf, a_align, a_size))
+    {
+      return NULL;
+    }
+
+  if (BUFPOOL_HUGEPAGE_SIZE == a_align)
+    {
+#ifdef MADV_HUGEPAGE
+      (void) madvise (p_buf, a_size, MADV_HUGEPAGE);
+#endif
+    }
+
+  if (!(p_rec = tiz_mem_calloc (1, sizeof (bufpool_rec_t))))
+    {
+      free (p_buf);
+      return NULL;
+    }
+
+  p_rec->p_buf = p_buf;
+  p_rec->size = a_size;
+  p_rec->align = a_align;
+  return p_rec;
+}
+
+static void
+delete_buffer (bufpool_rec_t * ap_rec)
+{
+  assert (ap_rec);
+  free (ap_rec->p_buf);
+  tiz_mem_free (ap_rec);
+}
+
+OMX_U8 *
+tiz_bufpool_alloc (OMX_U32 a_size)
+{
+  bufpool_bucket_t * p_bucket = NULL;
+  bufpool_rec_t * p_rec = NULL;
+  size_t size = 0;
+  size_t align = 0;
+
+  assert (a_size > 0);
+
+  (void) pthread_once (&g_bufpool_once, init_bufpool);
+  size_class (a_size, &size, &align);
+
+  (void) pthread_mutex_lock (&g_bufpool_mutex);
+  p_bucket = find_bucket (size, align, false);
+  if (p_bucket && p_bucket->p_free)
+    {
+      p_rec = p_bucket->p_free;
+      p_bucket->p_free = p_rec->p_next;
+      g_bufpool.info.hits++;
+      g_bufpool.info.buffers_cached--;
+      g_bufpool.info.bytes_cached -= size;
+    }
+  else
+    {
+      g_bufpool.info.misses++;
+    }
+  (void) pthread_mutex_unlock (&g_bufpool_mutex);
+
+  if (!p_rec)
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "miss : size [%u] -> [%lu] align [%lu]",
+               a_size, (unsigned long) size, (unsigned long) align);
+      if (!(p_rec = new_buffer (size, align)))
+        {
+          return NULL;
+        }
+    }
+
+  (void) memset (p_rec->p_buf, 0, a_size);
+
+  (void) pthread_mutex_lock (&g_bufpool_mutex);
+  p_rec->p_next = g_bufpool.p_used[used_slot (p_rec->p_buf)];
+  g_bufpool.p_used[used_slot (p_rec->p_buf)] = p_rec;
+  g_bufpool.info.buffers_in_use++;
+  g_bufpool.info.bytes_in_use += size;
+  (void) pthread_mutex_unlock (&g_bufpool_mutex);
+
+  return p_rec->p_buf;
+}
+
+void
+tiz_bufpool_free (OMX_PTR ap_buf)
+{
+  bufpool_rec_t ** pp_rec = NULL;
+  bufpool_rec_t * p_rec = NULL;
+  bool release = true;
+
+  if (!ap_buf)
+    {
+      return;
+    }
+
+  (void) pthread_mutex_lock (&g_bufpool_mutex);
+  for (pp_rec = &(g_bufpool.p_used[used_slot (ap_buf)]);
+       *pp_rec && (*pp_rec)->p_buf != ap_buf; pp_rec = &((*pp_rec)->p_next))
+    ;
+  if ((p_rec = *pp_rec))
+    {
+      *pp_rec = p_rec->p_next;
+      g_bufpool.info.buffers_in_use--;
+      g_bufpool.info.bytes_in_use -= p_rec->size;
+      if (g_bufpool.info.bytes_cached + p_rec->size <= g_bufpool.max_cached)
+        {
+          bufpool_bucket_t * p_bucket
+            = find_bucket (p_rec->size, p_rec->align, true);
+          if (p_bucket)
+            {
+              p_rec->p_next = p_bucket->p_free;
+              p_bucket->p_free = p_rec;
+              g_bufpool.info.buffers_cached++;
+              g_bufpool.info.bytes_cached += p_rec->size;
+              release = false;
+            }
+        }
+    }
+  (void) pthread_mutex_unlock (&g_bufpool_mutex);
+
+  if (!p_rec)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unknown buffer [%p]", ap_buf);
+      assert (0);
+    }
+  else if (release)
+    {
+      delete_buffer (p_rec);
+    }
+}
+
+void
+tiz_bufpool_trim (void)
+{
+  bufpool_bucket_t * p_buckets = NULL;
+
+  (void) pthread_mutex_lock (&g_bufpool_mutex);
+  p_buckets = g_bufpool.p_buckets;
+  g_bufpool.p_buckets = NULL;
+  g_bufpool.info.buffers_cached = 0;
+  g_bufpool.info.bytes_cached = 0;
+  (void) pthread_mutex_unlock (&g_bufpool_mutex);
+
+  while (p_buckets)
+    {
+      bufpool_bucket_t * p_next = p_buckets->p_next;
+      while (p_buckets->p_free)
+        {
+          bufpool_rec_t * p_rec = p_buckets->p_free;
+          p_buckets->p_free = p_rec->p_next;
+          delete_buffer (p_rec);
+        }
+      tiz_mem_free (p_buckets);
+      p_buckets = p_next;
+    }
+}
+
+void
+tiz_bufpool_get_info (tiz_bufpool_info_t * ap_info)
+{
+  assert (ap_info);
+  (void) pthread_mutex_lock (&g_bufpool_mutex);
+  *ap_info = g_bufpool.info;
+  (void) pthread_mutex_unlock (&g_bufpool_mutex);
+}
@@ -0,0 +1,90 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizbufpool.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia OpenMAX IL - Process-wide pool of buffer memory
+ *
+ *
+ */
+
+#ifndef TIZBUFPOOL_H
+#define TIZBUFPOOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <OMX_Types.h>
+#include <OMX_Core.h>
+
+/**
+ * The memory behind the buffers allocated by the ports (through the default
+ * allocation hooks) is recycled across state transitions, port
+ * reconfigurations and components. Buffers are grouped by their rounded size
+ * and alignment: those smaller than a page are cache-line aligned, the rest
+ * are page aligned. When the 'buffer-pool-hugepages' key in the 'ilcore'
+ * section of tizonia.conf is true, buffers of 2 MiB or more are aligned to and
+ * backed by transparent hugepages. Released buffers are kept until the pool
+ * caches 'buffer-pool-cache-mb' megabytes (default: 32).
+ */
+
+typedef struct tiz_bufpool_info tiz_bufpool_info_t;
+struct tiz_bufpool_info
+{
+  /* Allocations served with recycled memory */
+  OMX_U64 hits;
+  /* Allocations that required new memory */
+  OMX_U64 misses;
+  OMX_U32 buffers_in_use;
+  OMX_U64 bytes_in_use;
+  OMX_U32 buffers_cached;
+  OMX_U64 bytes_cached;
+};
+
+/**
+ * Allocate a zero-initialised buffer of at least a_size bytes.
+ *
+ * @return The buffer, or NULL if out of memory.
+ */
+OMX_U8 *
+tiz_bufpool_alloc (OMX_U32 a_size);
+
+/**
+ * Return a buffer obtained with tiz_bufpool_alloc to the pool.
+ */
+void
+tiz_bufpool_free (OMX_PTR ap_buf);
+
+/**
+ * Release all the memory currently cached by the pool.
+ */
+void
+tiz_bufpool_trim (void);
+
+void
+tiz_bufpool_get_info (tiz_bufpool_info_t * ap_info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZBUFPOOL_H */
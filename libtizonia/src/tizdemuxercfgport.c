@@ -33,6 +33,8 @@
 #include <assert.h>
 #include <string.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizplatform.h>
 
 #include "tizdemuxercfgport.h"
@@ -59,6 +61,8 @@ demuxer_cfgport_ctor (void * ap_obj, va_list * app)
     tiz_port_register_index (p_obj, OMX_IndexConfigTimePosition)); /* r/w */
   tiz_check_omx_ret_null (
     tiz_port_register_index (p_obj, OMX_IndexConfigTimeSeekMode)); /* r/w */
+  tiz_check_omx_ret_null (tiz_port_register_index (
+    p_obj, OMX_TizoniaIndexConfigMediaDuration)); /* read-only */
 
   return p_obj;
 }
@@ -73,6 +77,26 @@ demuxer_cfgport_dtor (void * ap_obj)
  * from tiz_api
  */
 
+static OMX_ERRORTYPE
+get_config_from_prc (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
+                     OMX_PTR ap_struct)
+{
+  /* Only the processor knows about current position, seek mode or
+   duration. So lets get the processor to fill this info for us. */
+  void * p_prc = tiz_get_prc (ap_hdl);
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (p_prc);
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetConfig (p_prc, ap_hdl, a_index, ap_struct)))
+    {
+      TIZ_ERROR (ap_hdl,
+                 "[%s] : Error retrieving [%s] "
+                 "from the processor",
+                 tiz_err_to_str (rc), tiz_idx_to_str (a_index));
+    }
+  return rc;
+}
+
 static OMX_ERRORTYPE
 demuxer_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
                            OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
@@ -83,23 +107,17 @@ demuxer_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   TIZ_TRACE (ap_hdl, "GetConfig [%s]...", tiz_idx_to_str (a_index));
   assert (p_obj);
 
+  if (OMX_TizoniaIndexConfigMediaDuration == a_index)
+    {
+      return get_config_from_prc (ap_hdl, a_index, ap_struct);
+    }
+
   switch (a_index)
     {
       case OMX_IndexConfigTimePosition:
       case OMX_IndexConfigTimeSeekMode:
         {
-          /* Only the processor knows about current position or seek mode. So
-           lets get the processor to fill this info for us. */
-          void * p_prc = tiz_get_prc (ap_hdl);
-          assert (p_prc);
-          if (OMX_ErrorNone
-              != (rc = tiz_api_GetConfig (p_prc, ap_hdl, a_index, ap_struct)))
-            {
-              TIZ_ERROR (ap_hdl,
-                         "[%s] : Error retrieving [%s] "
-                         "from the processor",
-                         tiz_err_to_str (rc), tiz_idx_to_str (a_index));
-            }
+          rc = get_config_from_prc (ap_hdl, a_index, ap_struct);
         }
         break;
 
@@ -124,6 +142,12 @@ demuxer_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   TIZ_TRACE (ap_hdl, "SetConfig [%s]...", tiz_idx_to_str (a_index));
   assert (p_obj);
 
+  if (OMX_TizoniaIndexConfigMediaDuration == a_index)
+    {
+      /* The duration is read-only for IL clients */
+      return OMX_ErrorUnsupportedSetting;
+    }
+
   switch (a_index)
     {
       case OMX_IndexConfigTimePosition:
@@ -293,6 +293,11 @@ static OMX_ERRORTYPE dispatch_port_enable (void *ap_obj, OMX_HANDLETYPE p_hdl,
                     }
                   else if (EStateExecuting == now)
                     {
+                      /* The end of a new stream must be reported too */
+                      if (starts_new_stream (p_obj, p_port))
+                        {
+                          p_obj->eos_ = false;
+                        }
                       if (OMX_ErrorNone == (rc = tiz_srv_prepare_to_transfer (
                                                 ap_obj, pid)))
                         {
@@ -1208,6 +1208,37 @@ static bool all_populated (const void *ap_obj)
   return true;
 }
 
+/* Whether enabling this port in Executing starts a new stream: an input port
+   (e.g. a decoder's, when the source is switched to the next track), or the
+   output port of a component that has no input ports (a source). An output
+   port of a filter can be disabled and enabled again mid-stream (e.g. after
+   a port settings change), and that must not re-arm the EOS report. */
+static bool starts_new_stream (const void *ap_obj, OMX_PTR ap_port)
+{
+  const tiz_krn_t *p_obj = ap_obj;
+  OMX_S32 nports = 0;
+  OMX_U32 i = 0;
+
+  assert (ap_obj);
+  assert (ap_port);
+
+  if (OMX_DirInput == tiz_port_dir (ap_port))
+    {
+      return true;
+    }
+
+  nports = tiz_vector_length (p_obj->p_ports_);
+  for (i = 0; i < nports; ++i)
+    {
+      if (OMX_DirInput == tiz_port_dir (get_port (p_obj, i)))
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
 static bool all_depopulated (const void *ap_obj)
 {
   const tiz_krn_t *p_obj = ap_obj;
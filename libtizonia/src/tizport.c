@@ -40,6 +40,7 @@
 #include <tizplatform.h>
 
 #include "tizutils.h"
+#include "tizbufpool.h"
 #include "tizport-macros.h"
 #include "tizport.h"
 #include "tizport_decls.h"
@@ -168,17 +169,15 @@ get_mark_info (const tiz_port_t * ap_obj, OMX_U32 a_mark_idx)
 static OMX_U8 *
 default_alloc_hook (OMX_U32 * ap_size, OMX_PTR * app_port_priv, void * ap_args)
 {
-  OMX_U8 * p = NULL;
   assert (ap_size && *ap_size > 0);
-  p = tiz_mem_calloc ((size_t) *ap_size, sizeof (OMX_U8));
-  return p;
+  return tiz_bufpool_alloc (*ap_size);
 }
 
 static void
 default_free_hook (OMX_PTR ap_buf, OMX_PTR ap_port_priv, void * ap_args)
 {
   assert (ap_buf);
-  tiz_mem_free (ap_buf);
+  tiz_bufpool_free (ap_buf);
 }
 
 static OMX_ERRORTYPE
@@ -164,13 +164,50 @@ init_prc_message (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   return p_msg;
 }
 
+static void
+link_pending_br (tiz_prc_t * ap_prc, tiz_prc_msg_t * ap_msg)
+{
+  assert (ap_prc);
+  assert (ap_msg);
+  ap_msg->br.p_prev_pending = NULL;
+  ap_msg->br.p_next_pending = ap_prc->p_pending_br_;
+  if (ap_prc->p_pending_br_)
+    {
+      ap_prc->p_pending_br_->br.p_prev_pending = ap_msg;
+    }
+  ap_prc->p_pending_br_ = ap_msg;
+}
+
+static void
+unlink_pending_br (tiz_prc_t * ap_prc, tiz_prc_msg_t * ap_msg)
+{
+  assert (ap_prc);
+  assert (ap_msg);
+  if (ap_msg->br.p_prev_pending)
+    {
+      ap_msg->br.p_prev_pending->br.p_next_pending = ap_msg->br.p_next_pending;
+    }
+  else
+    {
+      assert (ap_prc->p_pending_br_ == ap_msg);
+      ap_prc->p_pending_br_ = ap_msg->br.p_next_pending;
+    }
+  if (ap_msg->br.p_next_pending)
+    {
+      ap_msg->br.p_next_pending->br.p_prev_pending = ap_msg->br.p_prev_pending;
+    }
+  ap_msg->br.p_prev_pending = NULL;
+  ap_msg->br.p_next_pending = NULL;
+}
+
 static OMX_ERRORTYPE
 enqueue_buffersready_msg (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
                           OMX_BUFFERHEADERTYPE * ap_hdr, OMX_U32 a_pid)
 {
-  const tiz_prc_t * p_obj = ap_obj;
+  tiz_prc_t * p_obj = (tiz_prc_t *) ap_obj;
   tiz_prc_msg_t * p_msg = NULL;
   tiz_prc_msg_buffersready_t * p_msg_br = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
 
   TIZ_TRACE (ap_hdl, "BuffersReady : HEADER [%p]", ap_hdr);
 
@@ -185,8 +222,14 @@ enqueue_buffersready_msg (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   p_msg_br->p_buffer = ap_hdr;
   p_msg_br->pid = a_pid;
 
-  /* Enqueueing with the lowest priority */
-  return tiz_srv_enqueue (ap_obj, p_msg, 1);
+  /* Enqueueing with the lowest priority; keep the handle so that the message
+     can be cancelled without a search of the queue */
+  rc = tiz_srv_enqueue_with_handle (ap_obj, p_msg, 1, &(p_msg_br->p_handle));
+  if (OMX_ErrorNone == rc)
+    {
+      link_pending_br (p_obj, p_msg);
+    }
+  return rc;
 }
 
 static inline OMX_U32
@@ -275,6 +318,9 @@ dispatch_br (void * ap_obj, OMX_PTR ap_msg)
   assert (p_msg_br);
   assert (p_msg_br->p_buffer);
 
+  /* The message has left the servant queue */
+  unlink_pending_br (p_obj, p_msg);
+
   p_krn = tiz_get_krn (p_msg->p_hdl);
   p_port = tiz_krn_get_port (p_krn, p_msg_br->pid);
   now = tiz_fsm_get_substate (tiz_get_fsm (p_msg->p_hdl));
@@ -495,41 +541,6 @@ dispatch_port_enable (const void * ap_obj, OMX_HANDLETYPE p_hdl,
   return tiz_prc_port_enable (ap_obj, ap_msg_sc->param1);
 }
 
-static OMX_BOOL
-remove_buffer_from_servant_queue (OMX_PTR ap_elem, OMX_S32 a_data1,
-                                  OMX_PTR ap_data2)
-{
-  OMX_BOOL rc = OMX_FALSE;
-  tiz_prc_msg_t * p_msg = ap_elem;
-  const OMX_BUFFERHEADERTYPE * p_hdr = ap_data2;
-
-  assert (p_msg);
-  assert (p_hdr);
-
-  if (p_msg->class == a_data1)
-    {
-      tiz_prc_msg_buffersready_t * p_msg_br = &(p_msg->br);
-      assert (p_msg_br);
-
-      if (p_hdr == p_msg_br->p_buffer)
-        {
-          /* Found, return TRUE so this item will be removed from the servant
-           * queue */
-          TIZ_TRACE (p_msg->p_hdl,
-                     "tiz_prc_msg_buffersready_t : Found HEADER [%p]", p_hdr);
-          rc = OMX_TRUE;
-        }
-    }
-  else
-    {
-      /* Not interested */
-      TIZ_TRACE (p_msg->p_hdl, "Not interested : class  [%s]",
-                 tiz_prc_msg_to_str (p_msg->class));
-    }
-
-  return rc;
-}
-
 /*
  * tiz_prc
  */
@@ -537,7 +548,9 @@ remove_buffer_from_servant_queue (OMX_PTR ap_elem, OMX_S32 a_data1,
 static void *
 prc_ctor (void * ap_obj, va_list * app)
 {
-  return super_ctor (typeOf (ap_obj, "tizprc"), ap_obj, app);
+  tiz_prc_t * p_obj = super_ctor (typeOf (ap_obj, "tizprc"), ap_obj, app);
+  p_obj->p_pending_br_ = NULL;
+  return p_obj;
 }
 
 static void *
@@ -628,12 +641,28 @@ static void
 prc_remove_from_queue (const void * ap_obj, tiz_pq_func_f apf_func,
                        OMX_S32 a_data1, OMX_PTR ap_data2)
 {
-  tiz_srv_t * p_obj = (tiz_srv_t *) ap_obj;
-  /* Actual implementation is in the parent class */
-  /* Replace dummy parameters apf_func and a_data1 */
-  tiz_srv_super_remove_from_queue (typeOf (ap_obj, "tizprc"), p_obj,
-                                   &remove_buffer_from_servant_queue,
-                                   ETIZPrcMsgBuffersReady, ap_data2);
+  tiz_prc_t * p_obj = (tiz_prc_t *) ap_obj;
+  const OMX_BUFFERHEADERTYPE * p_hdr = ap_data2;
+  tiz_prc_msg_t * p_msg = NULL;
+  tiz_prc_msg_t * p_next = NULL;
+
+  assert (p_obj);
+  assert (p_hdr);
+
+  /* The dummy parameters apf_func and a_data1 are ignored. Only the
+     buffers-ready messages still queued are visited, and each one found is
+     cancelled through its queue handle */
+  for (p_msg = p_obj->p_pending_br_; p_msg; p_msg = p_next)
+    {
+      p_next = p_msg->br.p_next_pending;
+      if (p_hdr == p_msg->br.p_buffer)
+        {
+          TIZ_TRACE (p_msg->p_hdl,
+                     "tiz_prc_msg_buffersready_t : Found HEADER [%p]", p_hdr);
+          unlink_pending_br (p_obj, p_msg);
+          tiz_srv_remove_handle (p_obj, p_msg->br.p_handle);
+        }
+    }
 }
 
 static OMX_ERRORTYPE
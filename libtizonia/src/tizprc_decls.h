@@ -43,6 +43,8 @@ struct tiz_prc
 {
   /* Object */
   const tiz_srv_t _;
+  /* Buffers-ready messages still in the servant queue */
+  struct tiz_prc_msg * p_pending_br_;
 };
 
 OMX_ERRORTYPE
@@ -35,6 +35,8 @@ extern "C" {
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 /* Forward declarations */
 static OMX_ERRORTYPE
 dispatch_sc (void * ap_obj, OMX_PTR ap_msg);
@@ -86,6 +88,9 @@ struct tiz_prc_msg_buffersready
 {
   OMX_BUFFERHEADERTYPE * p_buffer;
   OMX_U32 pid;
+  tiz_pqueue_handle_t p_handle;
+  struct tiz_prc_msg * p_prev_pending;
+  struct tiz_prc_msg * p_next_pending;
 };
 
 typedef struct tiz_prc_msg_configchange tiz_prc_msg_configchange_t;
@@ -55,6 +55,9 @@
 
 #define SCHED_OMX_DEFAULT_ROLE "default"
 #define SCHED_QUEUE_MAX_ITEMS 30
+#define SCHED_BATCH_MAX_ENTRIES 32
+#define SCHED_TUNNEL_MAX_PORTS 16
+#define SCHED_TUNNEL_RING_SIZE 64
 
 #ifndef S_SPLINT_S
 #define TIZ_COMP_INIT_MSG(hdl, msg, msgtype)         \
@@ -122,6 +125,20 @@ struct tiz_srv_group
   OMX_COMPONENTTYPE * p_hdl;
 };
 
+/* Direct buffer hand-off from a tunneled peer that lives in the same
+ * process. The peer's scheduler thread is the only producer; this
+ * component's scheduler thread is the only consumer. */
+typedef struct tiz_sched_tunnel tiz_sched_tunnel_t;
+struct tiz_sched_tunnel
+{
+  tiz_queue_t * p_ring; /* Lock-free SPSC */
+  OMX_S32 peer_tid; /* The peer's scheduler thread; 0 while the port is not
+                       tunneled to a co-located Tizonia component */
+  OMX_U32 pid;
+  OMX_DIRTYPE dir;
+  int pending; /* A wake-up message is on its way to the consumer */
+};
+
 typedef struct tiz_scheduler tiz_scheduler_t;
 struct tiz_scheduler
 {
@@ -133,6 +150,17 @@ struct tiz_scheduler
   tiz_mutex_t mutex;
   tiz_sem_t sem;
   tiz_queue_t * p_queue;
+  tiz_mutex_t batch_mutex;
+  struct tiz_sched_msg * p_batch_msg; /* The buffer batch at the tail of the
+                                         queue, that new buffers may be
+                                         appended to; guarded by
+                                         batch_mutex */
+  OMX_U32 batch_seq;
+  OMX_BOOL batching;
+  tiz_sched_tunnel_t * p_tunnels[SCHED_TUNNEL_MAX_PORTS];
+  OMX_BOOL direct_tunnels;
+  tiz_soa_t * p_msg_soa; /* Thread-safe; scheduler messages are allocated by
+                            the clients and freed by the scheduler thread */
   tiz_soa_t * p_soa;
   tiz_os_t * p_objsys;
   OMX_S32 error;
@@ -175,6 +203,8 @@ enum tiz_sched_msg_class
   ETIZSchedMsgEvIo,
   ETIZSchedMsgEvTimer,
   ETIZSchedMsgEvStat,
+  ETIZSchedMsgBufferBatch,
+  ETIZSchedMsgTunnelBuffers,
   ETIZSchedMsgMax,
 };
 
@@ -273,6 +303,30 @@ struct tiz_sched_msg_emptyfillbuffer
   OMX_BUFFERHEADERTYPE * p_hdr;
 };
 
+typedef struct tiz_sched_buf_entry tiz_sched_buf_entry_t;
+struct tiz_sched_buf_entry
+{
+  tiz_sched_msg_class_t class; /* ETIZSchedMsgEmptyThisBuffer or
+                                  ETIZSchedMsgFillThisBuffer */
+  OMX_BUFFERHEADERTYPE * p_hdr;
+};
+
+typedef struct tiz_sched_msg_bufbatch tiz_sched_msg_bufbatch_t;
+struct tiz_sched_msg_bufbatch
+{
+  OMX_U32 seq;
+  OMX_BOOL queued;
+  OMX_U32 nentries;
+  tiz_sched_buf_entry_t * p_entries; /* SCHED_BATCH_MAX_ENTRIES, allocated
+                                        along with the message */
+};
+
+typedef struct tiz_sched_msg_tunnelbufs tiz_sched_msg_tunnelbufs_t;
+struct tiz_sched_msg_tunnelbufs
+{
+  tiz_sched_tunnel_t * p_tunnel;
+};
+
 typedef struct tiz_sched_msg_tunnelrequest tiz_sched_msg_tunnelrequest_t;
 struct tiz_sched_msg_tunnelrequest
 {
@@ -380,6 +434,8 @@ struct tiz_sched_msg
     tiz_sched_msg_ev_io_t eio;
     tiz_sched_msg_ev_timer_t etmr;
     tiz_sched_msg_ev_stat_t estat;
+    tiz_sched_msg_bufbatch_t bb;
+    tiz_sched_msg_tunnelbufs_t tb;
   };
 };
 
@@ -440,6 +496,13 @@ static OMX_ERRORTYPE
 do_etmr (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
 static OMX_ERRORTYPE
 do_estat (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
+static OMX_ERRORTYPE
+do_bb (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
+static OMX_ERRORTYPE
+do_tb (tiz_scheduler_t *, tiz_sched_state_t *, tiz_sched_msg_t *);
+static OMX_ERRORTYPE
+sched_ComponentTunnelRequest (OMX_HANDLETYPE, OMX_U32, OMX_HANDLETYPE, OMX_U32,
+                              OMX_TUNNELSETUPTYPE *);
 
 static OMX_ERRORTYPE
 init_servants (tiz_scheduler_t *, tiz_sched_msg_t *);
@@ -466,6 +529,7 @@ static const tiz_sched_msg_dispatch_f tiz_sched_msg_to_fnt_tbl[] = {
   do_sconfig, do_gei,    do_gs,    do_tr,   do_ub,     do_ab,     do_fb,
   do_etb,     do_ftb,    do_scbs,  do_uei,  do_cre,    do_plgevt, do_rr,
   do_rt,      do_rph,    do_reh,   do_rreh, do_eio,    do_etmr,   do_estat,
+  do_bb,      do_tb,
 };
 
 static OMX_BOOL
@@ -509,6 +573,8 @@ static tiz_sched_msg_str_t tiz_sched_msg_to_str_tbl[] = {
   {ETIZSchedMsgEvIo, "{ETIZSchedMsgEvIo,"},
   {ETIZSchedMsgEvTimer, "ETIZSchedMsgEvTimer"},
   {ETIZSchedMsgEvStat, "ETIZSchedMsgEvStat"},
+  {ETIZSchedMsgBufferBatch, "ETIZSchedMsgBufferBatch"},
+  {ETIZSchedMsgTunnelBuffers, "ETIZSchedMsgTunnelBuffers"},
   {ETIZSchedMsgMax, "ETIZSchedMsgMax"},
 };
 
@@ -569,6 +635,8 @@ static OMX_BOOL tiz_sched_blocking_apis_tbl[] = {
   OMX_FALSE,    /* ETIZSchedMsgEvIo */
   OMX_FALSE,    /* ETIZSchedMsgEvTimer */
   OMX_FALSE,    /* ETIZSchedMsgEvStat */
+  OMX_FALSE,    /* ETIZSchedMsgBufferBatch */
+  OMX_FALSE,    /* ETIZSchedMsgTunnelBuffers */
   OMX_BOOL_MAX, /* ETIZSchedMsgMax */
 };
 
@@ -785,6 +853,19 @@ send_msg_non_blocking (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
   return tiz_queue_send (ap_sched->p_queue, ap_msg);
 }
 
+static inline OMX_ERRORTYPE
+close_batch (tiz_scheduler_t * ap_sched)
+{
+  assert (ap_sched);
+  if (ap_sched->batching)
+    {
+      tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->batch_mutex)));
+      ap_sched->p_batch_msg = NULL;
+      tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->batch_mutex)));
+    }
+  return OMX_ErrorNone;
+}
+
 static inline OMX_ERRORTYPE
 send_msg (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
 {
@@ -808,6 +889,9 @@ send_msg (tiz_scheduler_t * ap_sched, tiz_sched_msg_t * ap_msg)
       if (OMX_FALSE == ap_msg->will_block)
         {
           rc = send_msg_non_blocking (ap_sched, ap_msg);
+          /* Buffers submitted from now on must not overtake this message by
+             being appended to a batch queued ahead of it */
+          tiz_check_omx_ret_oom (close_batch (ap_sched));
         }
       else
         {
@@ -1044,7 +1128,7 @@ do_sconfig (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
      non-blocking */
   if (OMX_FALSE == tiz_sched_blocking_apis_tbl[ETIZSchedMsgSetConfig])
     {
-      tiz_mem_free (p_msg_sconfig->p_struct);
+      tiz_soa_free (ap_sched->p_msg_soa, p_msg_sconfig->p_struct);
       p_msg_sconfig->p_struct = NULL;
     }
 
@@ -1084,11 +1168,71 @@ do_gs (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
                            p_msg_gs->p_state);
 }
 
+static void
+update_tunnel (tiz_scheduler_t * ap_sched, const OMX_U32 a_pid,
+               OMX_HANDLETYPE ap_thdl)
+{
+  tiz_sched_tunnel_t * p_tun = NULL;
+  OMX_PTR p_port = NULL;
+
+  assert (ap_sched);
+
+  if (a_pid >= SCHED_TUNNEL_MAX_PORTS)
+    {
+      return;
+    }
+
+  p_tun = ap_sched->p_tunnels[a_pid];
+
+  if (!ap_sched->direct_tunnels || !ap_thdl
+      || ((OMX_COMPONENTTYPE *) ap_thdl)->ComponentTunnelRequest
+           != sched_ComponentTunnelRequest)
+    {
+      /* Torn down, or the peer is not a Tizonia component in this process */
+      if (p_tun)
+        {
+          __atomic_store_n (&(p_tun->peer_tid), 0, __ATOMIC_RELEASE);
+        }
+      return;
+    }
+
+  if (!p_tun)
+    {
+      /* Rings are kept until the component is destroyed; no buffers flow
+         while a tunnel is being set up or torn down, but a peer may still
+         hold a pointer to the ring */
+      p_port = tiz_krn_get_port (ap_sched->child.p_ker, a_pid);
+      if (!p_port
+          || !(p_tun = tiz_mem_calloc (1, sizeof (tiz_sched_tunnel_t))))
+        {
+          return;
+        }
+      if (OMX_ErrorNone
+          != tiz_queue_init_with_flags (&(p_tun->p_ring),
+                                        SCHED_TUNNEL_RING_SIZE,
+                                        TIZ_QUEUE_FLAG_LOCK_FREE_SPSC))
+        {
+          tiz_mem_free (p_tun);
+          return;
+        }
+      p_tun->pid = a_pid;
+      p_tun->dir = tiz_port_dir (p_port);
+      __atomic_store_n (&(ap_sched->p_tunnels[a_pid]), p_tun,
+                        __ATOMIC_RELEASE);
+    }
+
+  TIZ_DEBUG (ap_sched->child.p_hdl, "pid [%u] direct tunnel to [%s]", a_pid,
+             TIZ_CNAME (ap_thdl));
+  __atomic_store_n (&(p_tun->peer_tid), get_sched (ap_thdl)->thread_id,
+                    __ATOMIC_RELEASE);
+}
+
 static OMX_ERRORTYPE
 do_tr (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
        tiz_sched_msg_t * ap_msg)
 {
   tiz_sched_msg_tunnelrequest_t * p_msg_tr = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
 
   assert (ap_sched);
   assert (ap_msg);
@@ -1096,9 +1240,14 @@ do_tr (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   p_msg_tr = &(ap_msg->tr);
   assert (p_msg_tr);
 
-  return tiz_api_ComponentTunnelRequest (ap_sched->child.p_fsm, ap_msg->p_hdl,
-                                         p_msg_tr->pid, p_msg_tr->p_thdl,
-                                         p_msg_tr->tpid, p_msg_tr->p_tsetup);
+  rc = tiz_api_ComponentTunnelRequest (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                       p_msg_tr->pid, p_msg_tr->p_thdl,
+                                       p_msg_tr->tpid, p_msg_tr->p_tsetup);
+  if (OMX_ErrorNone == rc)
+    {
+      update_tunnel (ap_sched, p_msg_tr->pid, p_msg_tr->p_thdl);
+    }
+  return rc;
 }
 
 static OMX_ERRORTYPE
@@ -1183,6 +1332,84 @@ do_ftb (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
                                  p_msg_efb->p_hdr);
 }
 
+static OMX_ERRORTYPE
+do_bb (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
+       tiz_sched_msg_t * ap_msg)
+{
+  tiz_sched_msg_bufbatch_t * p_msg_bb = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 i = 0;
+
+  assert (ap_sched);
+  assert (ap_msg);
+  assert (ap_state && ETIZSchedStateStarted == *ap_state);
+  p_msg_bb = &(ap_msg->bb);
+  assert (p_msg_bb->p_entries);
+
+  /* From here on, nothing else can be appended to this batch */
+  tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->batch_mutex)));
+  if (ap_sched->p_batch_msg == ap_msg)
+    {
+      ap_sched->p_batch_msg = NULL;
+    }
+  tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->batch_mutex)));
+
+  TIZ_TRACE (ap_sched->child.p_hdl, "batch [%p] entries [%u]", ap_msg,
+             p_msg_bb->nentries);
+
+  for (i = 0; i < p_msg_bb->nentries; ++i)
+    {
+      tiz_sched_buf_entry_t * p_entry = &(p_msg_bb->p_entries[i]);
+      OMX_ERRORTYPE buf_rc
+        = (ETIZSchedMsgEmptyThisBuffer == p_entry->class
+             ? tiz_api_EmptyThisBuffer (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                        p_entry->p_hdr)
+             : tiz_api_FillThisBuffer (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                       p_entry->p_hdr));
+      if (OMX_ErrorNone == rc)
+        {
+          rc = buf_rc;
+        }
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+do_tb (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
+       tiz_sched_msg_t * ap_msg)
+{
+  tiz_sched_tunnel_t * p_tun = NULL;
+  OMX_PTR p_hdr = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (ap_sched);
+  assert (ap_msg);
+  assert (ap_state && ETIZSchedStateStarted == *ap_state);
+  p_tun = ap_msg->tb.p_tunnel;
+  assert (p_tun);
+
+  /* Re-arm before draining; a header published after this point either gets
+     drained below or brings another wake-up message */
+  __atomic_store_n (&(p_tun->pending), 0, __ATOMIC_SEQ_CST);
+
+  while (OMX_ErrorNone == tiz_queue_try_receive (p_tun->p_ring, &p_hdr))
+    {
+      OMX_ERRORTYPE buf_rc
+        = (OMX_DirInput == p_tun->dir
+             ? tiz_api_EmptyThisBuffer (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                        p_hdr)
+             : tiz_api_FillThisBuffer (ap_sched->child.p_fsm, ap_msg->p_hdl,
+                                       p_hdr));
+      if (OMX_ErrorNone == rc)
+        {
+          rc = buf_rc;
+        }
+    }
+
+  return rc;
+}
+
 static OMX_ERRORTYPE
 do_scbs (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
          tiz_sched_msg_t * ap_msg)
@@ -1668,8 +1895,8 @@ init_scheduler_message (OMX_HANDLETYPE ap_hdl,
   assert (ap_hdl);
   assert (a_msg_class < ETIZSchedMsgMax);
 
-  if (!(p_msg
-        = (tiz_sched_msg_t *) tiz_mem_calloc (1, sizeof (tiz_sched_msg_t))))
+  if (!(p_msg = (tiz_sched_msg_t *) tiz_soa_calloc (
+          get_sched (ap_hdl)->p_msg_soa, sizeof (tiz_sched_msg_t))))
     {
       TIZ_ERROR (ap_hdl,
                  "[OMX_ErrorInsufficientResources] : "
@@ -1918,6 +2145,239 @@ sched_GetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
   return send_msg (p_sched, p_msg);
 }
 
+static OMX_ERRORTYPE
+send_buffer (tiz_scheduler_t * ap_sched, OMX_HANDLETYPE ap_hdl,
+             const tiz_sched_msg_class_t a_class,
+             OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  tiz_sched_msg_t * p_msg = NULL;
+  tiz_sched_msg_emptyfillbuffer_t * p_msg_efb = NULL;
+
+  assert (ap_sched);
+  assert (ETIZSchedMsgEmptyThisBuffer == a_class
+          || ETIZSchedMsgFillThisBuffer == a_class);
+
+  TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, a_class);
+
+  assert (p_msg);
+  p_msg_efb = &(p_msg->efb);
+  assert (p_msg_efb);
+  p_msg_efb->p_hdr = ap_hdr;
+
+  return send_msg (ap_sched, p_msg);
+}
+
+/* Headers from a co-located tunneled peer skip the mailbox: they are pushed
+ * onto the port's ring, and a message is only queued to wake the scheduler
+ * when the ring was drained already. Returns OMX_FALSE when the header has
+ * to take the regular path. */
+static OMX_BOOL
+send_buffer_direct (tiz_scheduler_t * ap_sched, const OMX_U32 a_pid,
+                    const OMX_DIRTYPE a_dir, OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  tiz_sched_tunnel_t * p_tun = NULL;
+  tiz_sched_msg_t * p_msg = NULL;
+
+  assert (ap_sched);
+
+  if (a_pid >= SCHED_TUNNEL_MAX_PORTS
+      || !(p_tun = __atomic_load_n (&(ap_sched->p_tunnels[a_pid]),
+                                    __ATOMIC_ACQUIRE))
+      || a_dir != p_tun->dir
+      || tiz_thread_id ()
+           != __atomic_load_n (&(p_tun->peer_tid), __ATOMIC_ACQUIRE))
+    {
+      /* Only the peer's scheduler thread may use the ring */
+      return OMX_FALSE;
+    }
+
+  if (OMX_ErrorNone != tiz_queue_send (p_tun->p_ring, ap_hdr))
+    {
+      return OMX_FALSE;
+    }
+
+  if (0 == __atomic_exchange_n (&(p_tun->pending), 1, __ATOMIC_SEQ_CST))
+    {
+      if (!(p_msg = init_scheduler_message (ap_sched->child.p_hdl,
+                                            ETIZSchedMsgTunnelBuffers)))
+        {
+          /* The next header will try again */
+          __atomic_store_n (&(p_tun->pending), 0, __ATOMIC_SEQ_CST);
+          return OMX_TRUE;
+        }
+      p_msg->tb.p_tunnel = p_tun;
+      if (OMX_ErrorNone != send_msg_non_blocking (ap_sched, p_msg))
+        {
+          tiz_soa_free (ap_sched->p_msg_soa, p_msg);
+          __atomic_store_n (&(p_tun->pending), 0, __ATOMIC_SEQ_CST);
+        }
+    }
+
+  return OMX_TRUE;
+}
+
+static OMX_U32
+add_to_batch (tiz_sched_msg_bufbatch_t * ap_bb,
+              const tiz_sched_msg_class_t a_class,
+              OMX_BUFFERHEADERTYPE ** app_hdrs, const OMX_U32 a_nhdrs)
+{
+  OMX_U32 i = 0;
+  assert (ap_bb);
+  for (i = 0; i < a_nhdrs && ap_bb->nentries < SCHED_BATCH_MAX_ENTRIES; ++i)
+    {
+      ap_bb->p_entries[ap_bb->nentries].class = a_class;
+      ap_bb->p_entries[ap_bb->nentries].p_hdr = app_hdrs[i];
+      ap_bb->nentries++;
+    }
+  return i;
+}
+
+/* Most batches only ever hold one or two headers, so a batch must not cost
+ * more than a plain ETB/FTB message: the entries are allocated in the same
+ * slice as the message itself. */
+static OMX_ERRORTYPE
+init_batch (tiz_scheduler_t * ap_sched, OMX_HANDLETYPE ap_hdl,
+            tiz_sched_msg_t ** app_msg)
+{
+  tiz_sched_msg_t * p_msg = NULL;
+
+  assert (ap_sched);
+  assert (app_msg);
+
+  if (!(p_msg = (tiz_sched_msg_t *) tiz_soa_calloc (
+          ap_sched->p_msg_soa,
+          sizeof (tiz_sched_msg_t)
+            + SCHED_BATCH_MAX_ENTRIES * sizeof (tiz_sched_buf_entry_t))))
+    {
+      TIZ_ERROR (ap_hdl,
+                 "[OMX_ErrorInsufficientResources] : "
+                 "(While allocating a buffer batch)");
+      return OMX_ErrorInsufficientResources;
+    }
+  p_msg->p_hdl = ap_hdl;
+  p_msg->class = ETIZSchedMsgBufferBatch;
+  p_msg->will_block = tiz_sched_blocking_apis_tbl[ETIZSchedMsgBufferBatch];
+  p_msg->bb.p_entries = (tiz_sched_buf_entry_t *) (p_msg + 1);
+  *app_msg = p_msg;
+  return OMX_ErrorNone;
+}
+
+/* Buffers are appended to the batch message that sits at the tail of the
+ * queue, if there is one; otherwise a new batch is queued. A batch stops
+ * accepting buffers once the scheduler thread picks it up, or when any other
+ * message is queued behind it, so that the order in which the API calls were
+ * made is preserved. A new batch is only made available for appending after
+ * it has been queued; the sequence number tells it apart from a newer batch
+ * that may have been allocated at the same address in the meantime. */
+static OMX_ERRORTYPE
+send_buffers (tiz_scheduler_t * ap_sched, OMX_HANDLETYPE ap_hdl,
+              const tiz_sched_msg_class_t a_class,
+              OMX_BUFFERHEADERTYPE ** app_hdrs, const OMX_U32 a_nhdrs)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 i = 0;
+
+  assert (ap_sched);
+  assert (app_hdrs);
+
+  if (!ap_sched->batching || OMX_TRUE == tiz_sched_blocking_apis_tbl[a_class]
+      || tiz_thread_id () == ap_sched->thread_id)
+    {
+      for (i = 0; i < a_nhdrs && OMX_ErrorNone == rc; ++i)
+        {
+          rc = send_buffer (ap_sched, ap_hdl, a_class, app_hdrs[i]);
+        }
+      return rc;
+    }
+
+  while (i < a_nhdrs)
+    {
+      tiz_sched_msg_t * p_msg = NULL;
+      OMX_U32 seq = 0;
+
+      tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->batch_mutex)));
+      p_msg = ap_sched->p_batch_msg;
+      if (p_msg && p_msg->bb.queued)
+        {
+          i += add_to_batch (&(p_msg->bb), a_class, app_hdrs + i, a_nhdrs - i);
+        }
+      tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->batch_mutex)));
+
+      if (i == a_nhdrs)
+        {
+          break;
+        }
+
+      tiz_check_omx (init_batch (ap_sched, ap_hdl, &p_msg));
+      i += add_to_batch (&(p_msg->bb), a_class, app_hdrs + i, a_nhdrs - i);
+
+      tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->batch_mutex)));
+      seq = p_msg->bb.seq = ++(ap_sched->batch_seq);
+      ap_sched->p_batch_msg = p_msg;
+      tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->batch_mutex)));
+
+      rc = send_msg_non_blocking (ap_sched, p_msg);
+
+      tiz_check_omx_ret_oom (tiz_mutex_lock (&(ap_sched->batch_mutex)));
+      if (ap_sched->p_batch_msg == p_msg && p_msg->bb.seq == seq)
+        {
+          if (OMX_ErrorNone == rc)
+            {
+              p_msg->bb.queued = OMX_TRUE;
+            }
+          else
+            {
+              ap_sched->p_batch_msg = NULL;
+            }
+        }
+      tiz_check_omx_ret_oom (tiz_mutex_unlock (&(ap_sched->batch_mutex)));
+
+      if (OMX_ErrorNone != rc)
+        {
+          tiz_soa_free (ap_sched->p_msg_soa, p_msg);
+          return rc;
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+set_buffer_batch (tiz_scheduler_t * ap_sched, OMX_HANDLETYPE ap_hdl,
+                  OMX_TIZONIA_BUFFERBATCHTYPE * ap_batch)
+{
+  OMX_U32 i = 0;
+
+  assert (ap_sched);
+  assert (ap_batch);
+
+  if (ap_batch->nSize < sizeof (OMX_TIZONIA_BUFFERBATCHTYPE)
+      || (OMX_DirInput != ap_batch->eDir && OMX_DirOutput != ap_batch->eDir)
+      || (ap_batch->nBufferCount > 0 && !ap_batch->ppBuffers))
+    {
+      TIZ_ERROR (ap_hdl, "[OMX_ErrorBadParameter] : (Invalid buffer batch)");
+      return OMX_ErrorBadParameter;
+    }
+
+  for (i = 0; i < ap_batch->nBufferCount; ++i)
+    {
+      if (!ap_batch->ppBuffers[i])
+        {
+          TIZ_ERROR (ap_hdl,
+                     "[OMX_ErrorBadParameter] : "
+                     "(Null buffer header at position %u)",
+                     i);
+          return OMX_ErrorBadParameter;
+        }
+    }
+
+  return send_buffers (ap_sched, ap_hdl,
+                       OMX_DirInput == ap_batch->eDir
+                         ? ETIZSchedMsgEmptyThisBuffer
+                         : ETIZSchedMsgFillThisBuffer,
+                       ap_batch->ppBuffers, ap_batch->nBufferCount);
+}
+
 static OMX_ERRORTYPE
 sched_SetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
                  OMX_PTR ap_struct)
@@ -1936,6 +2396,13 @@ sched_SetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
 
   p_sched = get_sched (ap_hdl);
 
+  if (OMX_TizoniaIndexConfigBufferBatch == a_index)
+    {
+      /* Not a config as such; the buffers go straight to the queue */
+      return set_buffer_batch (p_sched, ap_hdl,
+                               (OMX_TIZONIA_BUFFERBATCHTYPE *) ap_struct);
+    }
+
   TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, ETIZSchedMsgSetConfig);
 
   assert (p_msg);
@@ -1946,9 +2413,9 @@ sched_SetConfig (OMX_HANDLETYPE ap_hdl, OMX_INDEXTYPE a_index,
   if (OMX_FALSE == tiz_sched_blocking_apis_tbl[ETIZSchedMsgSetConfig])
     {
       if (!(p_msg_sconf->p_struct
-            = tiz_mem_calloc (1, (*(OMX_U32 *) ap_struct))))
+            = tiz_soa_calloc (p_sched->p_msg_soa, (*(OMX_U32 *) ap_struct))))
         {
-          tiz_mem_free (p_msg);
+          tiz_soa_free (p_sched->p_msg_soa, p_msg);
           TIZ_ERROR (ap_hdl,
                      "[OMX_ErrorInsufficientResources] : "
                      "(While allocating memory for config struct)");
@@ -2158,10 +2625,6 @@ sched_FreeBuffer (OMX_HANDLETYPE ap_hdl, OMX_U32 a_pid,
 static OMX_ERRORTYPE
 sched_EmptyThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
-  tiz_sched_msg_t * p_msg = NULL;
-  tiz_sched_msg_emptyfillbuffer_t * p_msg_efb = NULL;
-  tiz_scheduler_t * p_sched = NULL;
-
   if (!ap_hdl || !ap_hdr)
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR,
@@ -2170,25 +2633,19 @@ sched_EmptyThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
       return OMX_ErrorBadParameter;
     }
 
-  p_sched = get_sched (ap_hdl);
-
-  TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, ETIZSchedMsgEmptyThisBuffer);
-
-  assert (p_msg);
-  p_msg_efb = &(p_msg->efb);
-  assert (p_msg_efb);
-  p_msg_efb->p_hdr = ap_hdr;
+  if (send_buffer_direct (get_sched (ap_hdl), ap_hdr->nInputPortIndex,
+                          OMX_DirInput, ap_hdr))
+    {
+      return OMX_ErrorNone;
+    }
 
-  return send_msg (p_sched, p_msg);
+  return send_buffers (get_sched (ap_hdl), ap_hdl, ETIZSchedMsgEmptyThisBuffer,
+                       &ap_hdr, 1);
 }
 
 static OMX_ERRORTYPE
 sched_FillThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
 {
-  tiz_sched_msg_t * p_msg = NULL;
-  tiz_sched_msg_emptyfillbuffer_t * p_msg_efb = NULL;
-  tiz_scheduler_t * p_sched = NULL;
-
   if (!ap_hdl || !ap_hdr)
     {
       TIZ_LOG (TIZ_PRIORITY_ERROR,
@@ -2197,16 +2654,14 @@ sched_FillThisBuffer (OMX_HANDLETYPE ap_hdl, OMX_BUFFERHEADERTYPE * ap_hdr)
       return OMX_ErrorBadParameter;
     }
 
-  p_sched = get_sched (ap_hdl);
-
-  TIZ_COMP_INIT_MSG_OOM (ap_hdl, p_msg, ETIZSchedMsgFillThisBuffer);
-
-  assert (p_msg);
-  p_msg_efb = &(p_msg->efb);
-  assert (p_msg_efb);
-  p_msg_efb->p_hdr = ap_hdr;
+  if (send_buffer_direct (get_sched (ap_hdl), ap_hdr->nOutputPortIndex,
+                          OMX_DirOutput, ap_hdr))
+    {
+      return OMX_ErrorNone;
+    }
 
-  return send_msg (p_sched, p_msg);
+  return send_buffers (get_sched (ap_hdl), ap_hdl, ETIZSchedMsgFillThisBuffer,
+                       &ap_hdr, 1);
 }
 
 static OMX_ERRORTYPE
@@ -2324,7 +2779,7 @@ dispatch_msg (tiz_scheduler_t * ap_sched, tiz_sched_state_t * ap_state,
   /* Return error to client */
   ap_sched->error = rc;
 
-  tiz_mem_free (ap_msg);
+  tiz_soa_free (ap_sched->p_msg_soa, ap_msg);
 
   return signal_client;
 }
@@ -2445,6 +2900,7 @@ static void
 delete_scheduler (tiz_scheduler_t * ap_sched)
 {
   OMX_PTR p_result = NULL;
+  OMX_U32 i = 0;
   assert (ap_sched);
   (void) tiz_thread_join (&(ap_sched->thread), &p_result);
   delete_roles (ap_sched);
@@ -2453,9 +2909,21 @@ delete_scheduler (tiz_scheduler_t * ap_sched)
   delete_hooks (ap_sched, ap_sched->child.p_eglimage_hooks_map);
   ap_sched->child.p_eglimage_hooks_map = NULL;
   (void) tiz_mutex_destroy (&(ap_sched->mutex));
+  (void) tiz_mutex_destroy (&(ap_sched->batch_mutex));
+  for (i = 0; i < SCHED_TUNNEL_MAX_PORTS; ++i)
+    {
+      if (ap_sched->p_tunnels[i])
+        {
+          tiz_queue_destroy (ap_sched->p_tunnels[i]->p_ring);
+          tiz_mem_free (ap_sched->p_tunnels[i]);
+          ap_sched->p_tunnels[i] = NULL;
+        }
+    }
   (void) tiz_sem_destroy (&(ap_sched->sem));
   tiz_queue_destroy (ap_sched->p_queue);
   ap_sched->p_queue = NULL;
+  tiz_soa_destroy (ap_sched->p_msg_soa);
+  ap_sched->p_msg_soa = NULL;
   tiz_mem_free (ap_sched);
 }
 
@@ -2476,9 +2944,17 @@ instantiate_scheduler (OMX_HANDLETYPE ap_hdl, const char * ap_cname)
     }
 
   tiz_check_omx_ret_null (tiz_mutex_init (&(p_sched->mutex)));
+  tiz_check_omx_ret_null (tiz_mutex_init (&(p_sched->batch_mutex)));
   tiz_check_omx_ret_null (tiz_sem_init (&(p_sched->sem), 0));
+  /* Many producers (IL clients, tunneled peers, the event loop), one consumer
+     (the scheduler thread) */
+  tiz_check_omx_ret_null (tiz_queue_init_with_flags (
+    &(p_sched->p_queue), SCHED_QUEUE_MAX_ITEMS, TIZ_QUEUE_FLAG_LOCK_FREE_MPSC));
+  /* Messages (and the config structs copied by SetConfig) come from a
+     thread-safe small object allocator, so that the steady-state buffer
+     exchange does not hit malloc */
   tiz_check_omx_ret_null (
-    tiz_queue_init (&(p_sched->p_queue), SCHED_QUEUE_MAX_ITEMS));
+    tiz_soa_init_with_flags (&(p_sched->p_msg_soa), TIZ_SOA_FLAG_THREAD_SAFE));
 
   p_sched->child.p_fsm = NULL;
   p_sched->child.p_ker = NULL;
@@ -2492,6 +2968,26 @@ instantiate_scheduler (OMX_HANDLETYPE ap_hdl, const char * ap_cname)
   p_sched->state = ETIZSchedStateStarting;
   p_sched->appdata = NULL;
   p_sched->cbacks = NULL;
+  p_sched->p_batch_msg = NULL;
+  p_sched->batch_seq = 0;
+  p_sched->batching = OMX_TRUE;
+  p_sched->direct_tunnels = OMX_TRUE;
+
+  {
+    /* The buffer exchange optimizations can be disabled, e.g. to compare
+       with the plain one message per buffer path */
+    const char * p_value
+      = tiz_rcfile_get_value ("ilcore", "buffer-batching");
+    if (p_value && 0 == strncmp (p_value, "false", 5))
+      {
+        p_sched->batching = OMX_FALSE;
+      }
+    p_value = tiz_rcfile_get_value ("ilcore", "direct-tunnels");
+    if (p_value && 0 == strncmp (p_value, "false", 5))
+      {
+        p_sched->direct_tunnels = OMX_FALSE;
+      }
+  }
 
   len = strnlen (ap_cname, OMX_MAX_STRINGNAME_SIZE - 1);
   strncpy (p_sched->cname, ap_cname, len);
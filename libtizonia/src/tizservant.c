@@ -311,6 +311,29 @@ tiz_srv_super_enqueue (const void * a_class, const void * ap_obj,
   return superclass->enqueue (ap_obj, ap_data, a_priority);
 }
 
+OMX_ERRORTYPE
+tiz_srv_enqueue_with_handle (const void * ap_obj, OMX_PTR ap_data,
+                             OMX_U32 a_priority,
+                             tiz_pqueue_handle_t * ap_handle)
+{
+  tiz_srv_t * p_srv = (tiz_srv_t *) ap_obj;
+  assert (p_srv);
+  assert (ap_handle);
+  return tiz_pqueue_send_with_handle (p_srv->p_pq_, ap_data, a_priority,
+                                      ap_handle);
+}
+
+void
+tiz_srv_remove_handle (const void * ap_obj, tiz_pqueue_handle_t ap_handle)
+{
+  tiz_srv_t * p_srv = (tiz_srv_t *) ap_obj;
+  OMX_PTR p_msg = NULL;
+  assert (p_srv);
+  assert (ap_handle);
+  (void) tiz_pqueue_remove_handle (p_srv->p_pq_, ap_handle, &p_msg);
+  tiz_soa_free (p_srv->p_soa_, p_msg);
+}
+
 static void
 srv_remove_from_queue (const void * ap_obj, tiz_pq_func_f apf_func,
                        OMX_S32 a_data1, OMX_PTR ap_data2)
@@ -61,6 +61,14 @@ tiz_srv_init_msg (void * ap_obj, size_t msg_sz);
 OMX_ERRORTYPE
 tiz_srv_enqueue (const void * ap_obj, OMX_PTR ap_data, OMX_U32 a_priority);
 
+OMX_ERRORTYPE
+tiz_srv_enqueue_with_handle (const void * ap_obj, OMX_PTR ap_data,
+                             OMX_U32 a_priority,
+                             tiz_pqueue_handle_t * ap_handle);
+
+void
+tiz_srv_remove_handle (const void * ap_obj, tiz_pqueue_handle_t ap_handle);
+
 void
 tiz_srv_remove_from_queue (const void * ap_obj,
                            /*@null@*/ tiz_pq_func_f apf_func, OMX_S32 a_data1,
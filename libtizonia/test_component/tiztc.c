@@ -50,6 +50,7 @@
 
 #define TC_DEFAULT_ROLE1 "tizonia_test_component.role1"
 #define TC_DEFAULT_ROLE2 "tizonia_test_component.role2"
+#define TC_DEFAULT_ROLE3 "tizonia_test_component.source"
 #define TC_COMPONENT_NAME "OMX.Aratelia.tizonia.test_component"
 #define TC_PORT_MIN_BUF_COUNT 1
 #define TC_PORT_MIN_BUF_SIZE 1024
@@ -93,7 +94,7 @@ egl_image_validation_hook (const OMX_HANDLETYPE ap_hdl,
 }
 
 static OMX_PTR
-instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
+instantiate_pcm_port_with_dir (OMX_HANDLETYPE ap_hdl, const OMX_DIRTYPE a_dir)
 {
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode;
   OMX_AUDIO_CONFIG_VOLUMETYPE volume;
@@ -104,7 +105,7 @@ instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
   };
   tiz_port_options_t port_opts = {
     OMX_PortDomainAudio,
-    OMX_DirInput,
+    a_dir,
     TC_PORT_MIN_BUF_COUNT,
     TC_PORT_MIN_BUF_SIZE,
     TC_PORT_NONCONTIGUOUS,
@@ -147,6 +148,18 @@ instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
                       &encodings, &pcmmode, &volume, &mute);
 }
 
+static OMX_PTR
+instantiate_pcm_port (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_pcm_port_with_dir (ap_hdl, OMX_DirInput);
+}
+
+static OMX_PTR
+instantiate_pcm_output_port (OMX_HANDLETYPE ap_hdl)
+{
+  return instantiate_pcm_port_with_dir (ap_hdl, OMX_DirOutput);
+}
+
 static OMX_PTR
 instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
@@ -164,8 +177,9 @@ instantiate_processor (OMX_HANDLETYPE ap_hdl)
 OMX_ERRORTYPE
 OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
 {
-  tiz_role_factory_t role_factory1, role_factory2;
-  const tiz_role_factory_t *rf_list[] = { &role_factory1, &role_factory2 };
+  tiz_role_factory_t role_factory1, role_factory2, role_factory3;
+  const tiz_role_factory_t *rf_list[]
+    = { &role_factory1, &role_factory2, &role_factory3 };
   tiz_type_factory_t type_factory;
   const tiz_type_factory_t *tf_list[] = { &type_factory};
   const tiz_alloc_hooks_t new_hooks =
@@ -186,6 +200,14 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   role_factory2.nports = 1;
   role_factory2.pf_proc = instantiate_processor;
 
+  /* This role produces buffers, e.g. to feed another instance over a
+     tunnel */
+  strcpy ((OMX_STRING) role_factory3.role, TC_DEFAULT_ROLE3);
+  role_factory3.pf_cport = instantiate_config_port;
+  role_factory3.pf_port[0] = instantiate_pcm_output_port;
+  role_factory3.nports = 1;
+  role_factory3.pf_proc = instantiate_processor;
+
   strcpy ((OMX_STRING) type_factory.class_name, "tiztcprc_class");
   type_factory.pf_class_init = tiz_tcprc_class_init;
   strcpy ((OMX_STRING) type_factory.object_name, "tiztcprc");
@@ -202,8 +224,8 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   /* Register the "tiztcprc" class */
   tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
 
-  /* Register two roles */
-  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 2));
+  /* Register three roles */
+  tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 3));
 
   /* Register alloc hooks */
   tiz_check_omx (tiz_comp_register_alloc_hooks
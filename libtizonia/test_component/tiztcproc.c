@@ -33,17 +33,23 @@
 #include "tiztcproc.h"
 #include "tiztcproc_decls.h"
 #include "tizkernel.h"
+#include "tizport.h"
 #include "tizscheduler.h"
 
 #include "tizplatform.h"
 
 #include <assert.h>
+#include <stdint.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.tizonia.test_comp"
 #endif
 
+/* Number of buffers produced by the source role, the last one flagged with
+   EOS */
+#define TC_SOURCE_BUFFER_COUNT 100
+
 /*
  * tiztcprc
  */
@@ -52,6 +58,8 @@ static void *
 tcprc_ctor (void *ap_obj, va_list * app)
 {
   tiz_tcprc_t *p_obj = super_ctor (typeOf (ap_obj, "tiztcprc"), ap_obj, app);
+  p_obj->nbufs_ = 0;
+  p_obj->eos_ = OMX_FALSE;
   return p_obj;
 }
 
@@ -86,6 +94,10 @@ tcprc_deallocate_resources (void *ap_obj)
 static OMX_ERRORTYPE
 tcprc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
 {
+  tiz_tcprc_t *p_obj = ap_obj;
+  assert (p_obj);
+  p_obj->nbufs_ = 0;
+  p_obj->eos_ = OMX_FALSE;
   return OMX_ErrorNone;
 }
 
@@ -105,24 +117,66 @@ tcprc_stop_and_return (void *ap_obj)
  * from tiz_prc class
  */
 
+static OMX_ERRORTYPE
+tcprc_produce_buffers (tiz_tcprc_t * ap_prc)
+{
+  void *p_krn = tiz_get_krn (handleOf (ap_prc));
+  OMX_BUFFERHEADERTYPE *p_hdr = NULL;
+
+  /* Stamp each buffer with its sequence number, so that the consumer can
+     verify that none was lost or reordered */
+  while (!ap_prc->eos_
+         && OMX_ErrorNone == tiz_krn_claim_buffer (p_krn, 0, 0, &p_hdr)
+         && p_hdr)
+    {
+      p_hdr->nOffset = 0;
+      p_hdr->nFilledLen = p_hdr->nAllocLen;
+      p_hdr->nTimeStamp = ap_prc->nbufs_++;
+      if (TC_SOURCE_BUFFER_COUNT == ap_prc->nbufs_)
+        {
+          p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+          ap_prc->eos_ = OMX_TRUE;
+        }
+      tiz_check_omx (tiz_krn_release_buffer (p_krn, 0, p_hdr));
+      p_hdr = NULL;
+    }
+
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 tcprc_buffers_ready (const void *ap_obj)
 {
+  tiz_tcprc_t *p_obj = (tiz_tcprc_t *) ap_obj;
   void *p_krn = tiz_get_krn (handleOf (ap_obj));
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
 
+  if (OMX_DirOutput == tiz_port_dir (tiz_krn_get_port (p_krn, 0)))
+    {
+      return tcprc_produce_buffers (p_obj);
+    }
+
   rc = tiz_krn_claim_buffer (p_krn, 0, 0, &p_hdr);
   if (OMX_ErrorNone == rc && p_hdr)
     {
       OMX_PTR p_eglimage = NULL;
-      tiz_check_omx (tiz_krn_claim_eglimage (p_krn, 0, p_hdr, &p_eglimage));
+      /* Only headers from OMX_UseEGLImage carry an EGL image; the kernel
+         reports an error for any other header */
+      (void) tiz_krn_claim_eglimage (p_krn, 0, p_hdr, &p_eglimage);
       TIZ_PRINTF_DBG_MAG ("eglimage [%p]\n", p_eglimage);
       tiz_check_omx (tiztc_proc_render_buffer (p_hdr));
+      /* Count the buffers received in sequence */
+      if (p_hdr->nTimeStamp == (OMX_TICKS) p_obj->nbufs_)
+        {
+          ++p_obj->nbufs_;
+        }
       if ((p_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
         {
+          /* Report the count along with the EOS */
           tiz_srv_issue_event ((OMX_PTR)ap_obj, OMX_EventBufferFlag, 0,
-                               p_hdr->nFlags, NULL);
+                               p_hdr->nFlags,
+                               (OMX_PTR) (uintptr_t) p_obj->nbufs_);
         }
       (void)tiz_krn_release_buffer (p_krn, 0, p_hdr);
     }
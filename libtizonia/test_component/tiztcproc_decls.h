@@ -42,7 +42,8 @@ extern "C"
   {
     /* Object */
     const tiz_prc_t _;
-
+    OMX_U32 nbufs_;
+    OMX_BOOL eos_;
   };
 
   typedef struct tiz_tcprc_class tiz_tcprc_class_t;
@@ -0,0 +1,313 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_sched.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Scheduler micro-benchmark: buffer exchange with and without
+ * coalescing of the ETB/FTB messages
+ *
+ * Buffers are cycled through the test component's input port, either one
+ * OMX_EmptyThisBuffer call at a time, or all the buffers that are available
+ * in one OMX_TizoniaIndexConfigBufferBatch call. Each run happens in its own
+ * process, with 'buffer-batching' disabled (one scheduler message per buffer)
+ * and then enabled.
+ *
+ * Usage: bench_sched [buffers on the port (1-64)] [buffers exchanged]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <OMX_Core.h>
+#include <OMX_Component.h>
+#include <OMX_TizoniaExt.h>
+
+#include <tizplatform.h>
+
+#include "check_tizonia.h"
+
+#define BENCH_SCHED_COMPONENT "OMX.Aratelia.tizonia.test_component"
+#define BENCH_SCHED_MAX_BUFFERS 64
+#define BENCH_SCHED_FILLED_LEN 256 /* A few ms of low-latency PCM */
+
+typedef struct bench_ctx bench_ctx_t;
+struct bench_ctx
+{
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  OMX_STATETYPE state;
+  OMX_BUFFERHEADERTYPE * p_free[BENCH_SCHED_MAX_BUFFERS];
+  OMX_U32 nfree;
+  long ndone;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static OMX_ERRORTYPE
+bench_EventHandler (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                    OMX_EVENTTYPE eEvent, OMX_U32 nData1, OMX_U32 nData2,
+                    OMX_PTR pEventData)
+{
+  bench_ctx_t * p_ctx = ap_app_data;
+  if (OMX_EventCmdComplete == eEvent && OMX_CommandStateSet == nData1)
+    {
+      (void) tiz_mutex_lock (&(p_ctx->mutex));
+      p_ctx->state = (OMX_STATETYPE) nData2;
+      (void) tiz_cond_broadcast (&(p_ctx->cond));
+      (void) tiz_mutex_unlock (&(p_ctx->mutex));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_EmptyBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                       OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  bench_ctx_t * p_ctx = ap_app_data;
+  (void) tiz_mutex_lock (&(p_ctx->mutex));
+  p_ctx->p_free[p_ctx->nfree++] = ap_hdr;
+  p_ctx->ndone++;
+  (void) tiz_cond_broadcast (&(p_ctx->cond));
+  (void) tiz_mutex_unlock (&(p_ctx->mutex));
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+bench_FillBufferDone (OMX_HANDLETYPE ap_hdl, OMX_PTR ap_app_data,
+                      OMX_BUFFERHEADERTYPE * ap_hdr)
+{
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE bench_cbacks
+  = {bench_EventHandler, bench_EmptyBufferDone, bench_FillBufferDone};
+
+static void
+wait_for_state (bench_ctx_t * ap_ctx, const OMX_STATETYPE a_state)
+{
+  (void) tiz_mutex_lock (&(ap_ctx->mutex));
+  while (ap_ctx->state != a_state)
+    {
+      (void) tiz_cond_wait (&(ap_ctx->cond), &(ap_ctx->mutex));
+    }
+  (void) tiz_mutex_unlock (&(ap_ctx->mutex));
+}
+
+static double
+pump (bench_ctx_t * ap_ctx, OMX_HANDLETYPE ap_hdl, const OMX_BOOL a_batch_api,
+      const long a_nbufs)
+{
+  OMX_BUFFERHEADERTYPE * p_hdrs[BENCH_SCHED_MAX_BUFFERS];
+  OMX_TIZONIA_BUFFERBATCHTYPE batch;
+  long submitted = 0;
+  double start;
+
+  batch.nSize = sizeof (OMX_TIZONIA_BUFFERBATCHTYPE);
+  batch.nVersion.nVersion = OMX_VERSION;
+  batch.eDir = OMX_DirInput;
+  batch.ppBuffers = p_hdrs;
+
+  start = now_secs ();
+
+  (void) tiz_mutex_lock (&(ap_ctx->mutex));
+  ap_ctx->ndone = 0;
+  while (ap_ctx->ndone < a_nbufs)
+    {
+      OMX_U32 n = 0;
+      OMX_U32 i = 0;
+
+      if (0 == ap_ctx->nfree || submitted == a_nbufs)
+        {
+          (void) tiz_cond_wait (&(ap_ctx->cond), &(ap_ctx->mutex));
+          continue;
+        }
+
+      /* Hand over every buffer that has come back so far */
+      while (ap_ctx->nfree > 0 && submitted + (long) n < a_nbufs)
+        {
+          p_hdrs[n++] = ap_ctx->p_free[--ap_ctx->nfree];
+        }
+      (void) tiz_mutex_unlock (&(ap_ctx->mutex));
+
+      if (a_batch_api)
+        {
+          batch.nBufferCount = n;
+          (void) OMX_SetConfig (
+            ap_hdl, (OMX_INDEXTYPE) OMX_TizoniaIndexConfigBufferBatch, &batch);
+        }
+      else
+        {
+          for (i = 0; i < n; ++i)
+            {
+              (void) OMX_EmptyThisBuffer (ap_hdl, p_hdrs[i]);
+            }
+        }
+      submitted += n;
+
+      (void) tiz_mutex_lock (&(ap_ctx->mutex));
+    }
+  (void) tiz_mutex_unlock (&(ap_ctx->mutex));
+
+  return now_secs () - start;
+}
+
+static int
+run (const OMX_BOOL a_batching, const OMX_U32 a_nports_bufs,
+     const long a_nbufs)
+{
+  char rc_path[] = "/tmp/bench_sched.XXXXXX";
+  bench_ctx_t ctx;
+  OMX_HANDLETYPE p_hdl = NULL;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_BUFFERHEADERTYPE * p_hdrs[BENCH_SCHED_MAX_BUFFERS];
+  FILE * p_file = NULL;
+  int fd = -1;
+  OMX_U32 i = 0;
+  int api = 0;
+
+  /* A private rc file, so that the component is found and no resource
+     manager is needed */
+  if ((fd = mkstemp (rc_path)) < 0 || !(p_file = fdopen (fd, "w")))
+    {
+      fprintf (stderr, "could not create the rc file\n");
+      return EXIT_FAILURE;
+    }
+  fprintf (p_file,
+           "[ilcore]\ncomponent-paths = %s\nconfig-reload = false\n"
+           "buffer-batching = %s\n\n[resource-management]\nenabled = false\n",
+           TIZ_TEST_COMPONENT_PATH, a_batching ? "true" : "false");
+  fclose (p_file);
+  setenv ("TIZONIA_RC_FILE", rc_path, 1);
+
+  tiz_log_init ();
+
+  memset (&ctx, 0, sizeof (ctx));
+  (void) tiz_mutex_init (&(ctx.mutex));
+  (void) tiz_cond_init (&(ctx.cond));
+  ctx.state = OMX_StateLoaded;
+
+  if (OMX_ErrorNone != OMX_Init ()
+      || OMX_ErrorNone != OMX_GetHandle (&p_hdl, BENCH_SCHED_COMPONENT, &ctx,
+                                         &bench_cbacks))
+    {
+      fprintf (stderr, "could not instantiate [%s]\n", BENCH_SCHED_COMPONENT);
+      unlink (rc_path);
+      return EXIT_FAILURE;
+    }
+
+  port_def.nSize = sizeof (OMX_PARAM_PORTDEFINITIONTYPE);
+  port_def.nVersion.nVersion = OMX_VERSION;
+  port_def.nPortIndex = 0;
+  (void) OMX_GetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+  port_def.nBufferCountActual = a_nports_bufs;
+  (void) OMX_SetParameter (p_hdl, OMX_IndexParamPortDefinition, &port_def);
+
+  (void) OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  for (i = 0; i < a_nports_bufs; ++i)
+    {
+      (void) OMX_AllocateBuffer (p_hdl, &p_hdrs[i], 0, NULL,
+                                 port_def.nBufferSize);
+      p_hdrs[i]->nFilledLen = BENCH_SCHED_FILLED_LEN < p_hdrs[i]->nAllocLen
+                                ? BENCH_SCHED_FILLED_LEN
+                                : p_hdrs[i]->nAllocLen;
+      ctx.p_free[ctx.nfree++] = p_hdrs[i];
+    }
+  wait_for_state (&ctx, OMX_StateIdle);
+
+  (void) OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateExecuting,
+                          NULL);
+  wait_for_state (&ctx, OMX_StateExecuting);
+
+  for (api = 0; api < 2; ++api)
+    {
+      const double elapsed = pump (&ctx, p_hdl, api, a_nbufs);
+      char name[32];
+      snprintf (name, sizeof (name), "%s %s",
+                a_batching ? "coalesced" : "1 msg/buf", api ? "batch" : "etb");
+      printf ("%-24s buffers=%-2u msgs=%-9ld %8.3f s %12.0f msgs/s\n", name,
+              (unsigned) a_nports_bufs, a_nbufs, elapsed, a_nbufs / elapsed);
+    }
+
+  (void) OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  wait_for_state (&ctx, OMX_StateIdle);
+  (void) OMX_SendCommand (p_hdl, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+  for (i = 0; i < a_nports_bufs; ++i)
+    {
+      (void) OMX_FreeBuffer (p_hdl, 0, p_hdrs[i]);
+    }
+  wait_for_state (&ctx, OMX_StateLoaded);
+
+  (void) OMX_FreeHandle (p_hdl);
+  (void) OMX_Deinit ();
+  (void) tiz_cond_destroy (&(ctx.cond));
+  (void) tiz_mutex_destroy (&(ctx.mutex));
+
+  tiz_log_deinit ();
+  unlink (rc_path);
+
+  return EXIT_SUCCESS;
+}
+
+int
+main (int argc, char ** argv)
+{
+  int nports_bufs = argc > 1 ? atoi (argv[1]) : 16;
+  long nbufs = argc > 2 ? atol (argv[2]) : 1000000;
+  int batching = 0;
+
+  if (nports_bufs < 1 || nports_bufs > BENCH_SCHED_MAX_BUFFERS || nbufs < 1)
+    {
+      fprintf (stderr,
+               "usage: %s [buffers on the port (1-64)] [buffers exchanged]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  /* Each configuration gets a fresh process, with its own rc file */
+  for (batching = 0; batching < 2; ++batching)
+    {
+      int status = 0;
+      pid_t pid = 0;
+
+      fflush (stdout);
+      if (0 == (pid = fork ()))
+        {
+          exit (run (batching, nports_bufs, nbufs));
+        }
+      if (pid < 0 || pid != waitpid (pid, &status, 0) || !WIFEXITED (status)
+          || EXIT_SUCCESS != WEXITSTATUS (status))
+        {
+          return EXIT_FAILURE;
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
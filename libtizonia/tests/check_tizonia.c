@@ -40,6 +40,7 @@
 #include <signal.h>
 #include <assert.h>
 #include <limits.h>
+#include <stdint.h>
 
 #include <OMX_Component.h>
 #include <OMX_TizoniaExt.h>
@@ -49,6 +50,7 @@
 #include "tizscheduler.h"
 #include "tizfsm.h"
 #include "tizkernel.h"
+#include "tizbufpool.h"
 
 #include "check_tizonia.h"
 
@@ -63,6 +65,9 @@ pid_t g_rmd_pid;
 #define COMPONENT_NAME "OMX.Aratelia.tizonia.test_component"
 #define COMPONENT_ROLE1 "tizonia_test_component.role1"
 #define COMPONENT_ROLE2 "tizonia_test_component.role2"
+#define COMPONENT_ROLE_SOURCE "tizonia_test_component.source"
+/* Buffers produced by the source role; must match the test component */
+#define COMPONENT_SOURCE_BUFFER_COUNT 100
 #define COMPONENT_DEFAULT_ROLE "default"
 
 #define INFINITE_WAIT 0xffffffff
@@ -82,6 +87,10 @@ struct check_common_context
   OMX_ERRORTYPE error;
   OMX_U32 port;
   OMX_BUFFERHEADERTYPE *p_hdr;
+  /* Not cleared by _ctx_reset, so that an EOS that arrives before the test
+     starts waiting for it is not lost */
+  OMX_BOOL eos;
+  OMX_PTR p_eos_data;
 };
 
 static bool
@@ -206,6 +215,8 @@ _ctx_init (cc_ctx_t * app_ctx)
   p_ctx->error = OMX_ErrorMax;
   p_ctx->port = OMX_ALL;
   p_ctx->p_hdr = NULL;
+  p_ctx->eos = OMX_FALSE;
+  p_ctx->p_eos_data = NULL;
 
   * app_ctx = p_ctx;
 
@@ -441,6 +452,43 @@ static OMX_CALLBACKTYPE _check_cbacks = {
   check_FillBufferDone
 };
 
+OMX_ERRORTYPE
+check_tunnel_EventHandler (OMX_HANDLETYPE ap_hdl,
+                           OMX_PTR ap_app_data,
+                           OMX_EVENTTYPE eEvent,
+                           OMX_U32 nData1, OMX_U32 nData2, OMX_PTR pEventData)
+{
+  check_common_context_t *p_ctx = NULL;
+  cc_ctx_t *pp_ctx = NULL;
+
+  if (OMX_EventBufferFlag != eEvent)
+    {
+      return check_EventHandler (ap_hdl, ap_app_data, eEvent, nData1, nData2,
+                                 pEventData);
+    }
+
+  assert (ap_app_data);
+  pp_ctx = (cc_ctx_t *) ap_app_data;
+  p_ctx = *pp_ctx;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "EOS on port [%d] - pEventData [%p]", nData1,
+           pEventData);
+
+  fail_if ((nData2 & OMX_BUFFERFLAG_EOS) == 0);
+  p_ctx->port = nData1;
+  p_ctx->p_eos_data = pEventData;
+  p_ctx->eos = OMX_TRUE;
+  _ctx_signal (pp_ctx);
+
+  return OMX_ErrorNone;
+}
+
+static OMX_CALLBACKTYPE _check_tunnel_cbacks = {
+  check_tunnel_EventHandler,
+  check_EmptyBufferDone,
+  check_FillBufferDone
+};
+
 static OMX_ERRORTYPE
 check_tizonia_GetParameter (OMX_HANDLETYPE ap_hdl,
                              OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
@@ -636,8 +684,8 @@ START_TEST (test_tizonia_roles)
 
   fail_if (OMX_ErrorNoMore != error);
 
-  /* Check for 2 roles found (i must be equal 3) */
-  fail_if (i != 3);
+  /* Check for 3 roles found (i must be equal 4) */
+  fail_if (i != 4);
 
   role_type.nSize = sizeof (OMX_PARAM_COMPONENTROLETYPE);
   role_type.nVersion.nVersion = OMX_VERSION;
@@ -2021,6 +2069,196 @@ START_TEST (test_tizonia_command_cancellation_disabled_to_enabled_with_tunneled_
 }
 END_TEST
 
+static void
+_await_transition (cc_ctx_t * ap_ctx, OMX_STATETYPE a_state)
+{
+  check_common_context_t *p_ctx = *ap_ctx;
+  OMX_BOOL timedout = OMX_FALSE;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+
+  error = _ctx_wait (ap_ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_TRUE == timedout);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "p_ctx->state [%s]",
+           tiz_fsm_state_to_str (p_ctx->state));
+  fail_if (a_state != p_ctx->state);
+  fail_if (OMX_ErrorNone != p_ctx->error);
+  error = _ctx_reset (ap_ctx);
+  fail_if (OMX_ErrorNone != error);
+}
+
+static void
+_await_eos (cc_ctx_t * ap_ctx)
+{
+  check_common_context_t *p_ctx = *ap_ctx;
+  OMX_BOOL timedout = OMX_FALSE;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+
+  if (!p_ctx->eos)
+    {
+      error = _ctx_wait (ap_ctx, TIMEOUT_EXPECTING_SUCCESS, &timedout);
+      fail_if (OMX_ErrorNone != error);
+      fail_if (OMX_TRUE == timedout);
+    }
+  fail_if (OMX_TRUE != p_ctx->eos);
+  fail_if (0 != p_ctx->port);
+  error = _ctx_reset (ap_ctx);
+  fail_if (OMX_ErrorNone != error);
+}
+
+/* Two test components in this process, tunneled source -> sink, so that the
+ * buffers travel over the schedulers' direct hand-off rings in both
+ * directions. The sink counts the buffers that arrive in sequence and
+ * reports the count with the EOS. */
+START_TEST (test_tizonia_direct_tunnel_buffer_delivery_and_eos)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  OMX_HANDLETYPE p_src = NULL;
+  OMX_HANDLETYPE p_snk = NULL;
+  cc_ctx_t src_ctx;
+  cc_ctx_t snk_ctx;
+  check_common_context_t *p_snk_ctx = NULL;
+  OMX_PARAM_COMPONENTROLETYPE role_type;
+  OMX_PARAM_PORTDEFINITIONTYPE port_def;
+  OMX_STATETYPE state = OMX_StateMax;
+
+  error = _ctx_init (&src_ctx);
+  fail_if (OMX_ErrorNone != error);
+  error = _ctx_init (&snk_ctx);
+  fail_if (OMX_ErrorNone != error);
+  p_snk_ctx = (check_common_context_t *) (snk_ctx);
+
+  error = OMX_Init ();
+  fail_if (OMX_ErrorNone != error);
+
+  /* Instantiate the two components */
+  error = OMX_GetHandle (&p_src, COMPONENT_NAME, (OMX_PTR *) (&src_ctx),
+                         &_check_tunnel_cbacks);
+  fail_if (OMX_ErrorNone != error);
+  error = OMX_GetHandle (&p_snk, COMPONENT_NAME, (OMX_PTR *) (&snk_ctx),
+                         &_check_tunnel_cbacks);
+  fail_if (OMX_ErrorNone != error);
+
+  /* The first one produces the buffers */
+  role_type.nSize = sizeof (OMX_PARAM_COMPONENTROLETYPE);
+  role_type.nVersion.nVersion = OMX_VERSION;
+  strcpy ((OMX_STRING) role_type.cRole, COMPONENT_ROLE_SOURCE);
+  error = OMX_SetParameter (p_src, OMX_IndexParamStandardComponentRole,
+                            &role_type);
+  fail_if (OMX_ErrorNone != error);
+
+  /* Keep several buffers in flight; the tunnel negotiates the larger count */
+  TIZ_INIT_OMX_PORT_STRUCT (port_def, 0);
+  error = OMX_GetParameter (p_src, OMX_IndexParamPortDefinition, &port_def);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_DirOutput != port_def.eDir);
+  port_def.nBufferCountActual = 4;
+  error = OMX_SetParameter (p_src, OMX_IndexParamPortDefinition, &port_def);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_SetupTunnel (p_src, 0, p_snk, 0);
+  fail_if (OMX_ErrorNone != error);
+
+  /* Loaded -> Idle; the sink supplies the buffers */
+  error = OMX_SendCommand (p_snk, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  error = OMX_SendCommand (p_src, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  _await_transition (&snk_ctx, OMX_StateIdle);
+  _await_transition (&src_ctx, OMX_StateIdle);
+
+  /* Idle -> Executing; the source first, so that it is ready to fill the
+     buffers that the sink sends upstream */
+  error = OMX_SendCommand (p_src, OMX_CommandStateSet, OMX_StateExecuting,
+                           NULL);
+  fail_if (OMX_ErrorNone != error);
+  _await_transition (&src_ctx, OMX_StateExecuting);
+  error = OMX_SendCommand (p_snk, OMX_CommandStateSet, OMX_StateExecuting,
+                           NULL);
+  fail_if (OMX_ErrorNone != error);
+  _await_transition (&snk_ctx, OMX_StateExecuting);
+
+  /* Both ends must see the end of stream, and the sink must have received
+     every buffer, in order */
+  _await_eos (&src_ctx);
+  _await_eos (&snk_ctx);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "buffers received [%u]",
+           (OMX_U32) (uintptr_t) p_snk_ctx->p_eos_data);
+  fail_if (COMPONENT_SOURCE_BUFFER_COUNT
+           != (OMX_U32) (uintptr_t) p_snk_ctx->p_eos_data);
+
+  /* Executing -> Idle */
+  error = OMX_SendCommand (p_src, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  error = OMX_SendCommand (p_snk, OMX_CommandStateSet, OMX_StateIdle, NULL);
+  fail_if (OMX_ErrorNone != error);
+  _await_transition (&src_ctx, OMX_StateIdle);
+  _await_transition (&snk_ctx, OMX_StateIdle);
+
+  /* Idle -> Loaded */
+  error = OMX_SendCommand (p_src, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+  fail_if (OMX_ErrorNone != error);
+  error = OMX_SendCommand (p_snk, OMX_CommandStateSet, OMX_StateLoaded, NULL);
+  fail_if (OMX_ErrorNone != error);
+  _await_transition (&src_ctx, OMX_StateLoaded);
+  _await_transition (&snk_ctx, OMX_StateLoaded);
+
+  error = OMX_GetState (p_snk, &state);
+  fail_if (OMX_ErrorNone != error);
+  fail_if (OMX_StateLoaded != state);
+
+  error = OMX_TeardownTunnel (p_src, 0, p_snk, 0);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_FreeHandle (p_src);
+  fail_if (OMX_ErrorNone != error);
+  error = OMX_FreeHandle (p_snk);
+  fail_if (OMX_ErrorNone != error);
+
+  error = OMX_Deinit ();
+  fail_if (OMX_ErrorNone != error);
+
+  _ctx_destroy (&src_ctx);
+  _ctx_destroy (&snk_ctx);
+}
+END_TEST
+
+START_TEST (test_tizonia_bufpool)
+{
+  tiz_bufpool_info_t before;
+  tiz_bufpool_info_t after;
+  OMX_U8 *p_buf1 = NULL;
+  OMX_U8 *p_buf2 = NULL;
+  long page_size = sysconf (_SC_PAGESIZE);
+  OMX_U32 size = 3 * page_size;
+
+  tiz_bufpool_get_info (&before);
+
+  p_buf1 = tiz_bufpool_alloc (size);
+  fail_if (NULL == p_buf1);
+  fail_if (0 != ((uintptr_t) p_buf1 % page_size));
+  p_buf1[0] = p_buf1[size - 1] = 0xff;
+  tiz_bufpool_free (p_buf1);
+
+  /* Same size class; the memory must be recycled and cleared */
+  p_buf2 = tiz_bufpool_alloc (size - 100);
+  fail_if (p_buf2 != p_buf1);
+  fail_if (0 != p_buf2[0]);
+
+  tiz_bufpool_get_info (&after);
+  fail_if (after.hits != before.hits + 1);
+  fail_if (after.misses != before.misses + 1);
+  fail_if (after.buffers_in_use != before.buffers_in_use + 1);
+
+  tiz_bufpool_free (p_buf2);
+  tiz_bufpool_trim ();
+
+  tiz_bufpool_get_info (&after);
+  fail_if (0 != after.buffers_cached);
+  fail_if (0 != after.bytes_cached);
+}
+END_TEST
+
 Suite *
 tiz_suite (void)
 {
@@ -2052,10 +2290,13 @@ tiz_suite (void)
   tcase_add_test (tc_tizonia, test_tizonia_roles);
   tcase_add_test (tc_tizonia, test_tizonia_preannouncements_extension);
   tcase_add_test (tc_tizonia, test_tizonia_pd_set);
+  tcase_add_test (tc_tizonia, test_tizonia_bufpool);
   tcase_add_test (tc_tizonia,
                   test_tizonia_move_to_exe_and_transfer_with_allocbuffer);
   tcase_add_test (tc_tizonia,
                   test_tizonia_command_cancellation_loaded_to_idle_no_buffers);
+  tcase_add_test (tc_tizonia,
+                  test_tizonia_direct_tunnel_buffer_delivery_and_eos);
   /* TEST DISABLED */
   /*   tcase_add_test (tc_tizonia, */
   /*                   test_tizonia_command_cancellation_loaded_to_idle_with_tunneled_supplied_buffers); */
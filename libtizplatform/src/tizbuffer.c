@@ -31,9 +31,13 @@
 #endif
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 #include "tizmem.h"
 #include "tizlog.h"
@@ -45,6 +49,14 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.platform.buffer"
 #endif
 
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+/* In TIZ_BUFFER_RING mode, 'p_store' is a mapping of 2 * 'alloc_len' bytes
+ * whose two halves are backed by the same pages, and 'offset' is always less
+ * than 'alloc_len'. The data may extend past the end of the first half, into
+ * the second one, but it is always contiguous in memory. */
 struct tiz_buffer
 {
   unsigned char * p_store;
@@ -61,6 +73,194 @@ abs_of (const long v)
   return (v + mask) ^ mask;
 }
 
+static inline bool
+is_ring (const tiz_buffer_t * ap_buf)
+{
+  return TIZ_BUFFER_RING == ap_buf->seek_mode;
+}
+
+static inline bool
+store_is_consistent (const tiz_buffer_t * ap_buf)
+{
+  return is_ring (ap_buf) ? (ap_buf->offset < ap_buf->alloc_len
+                             && ap_buf->filled_len <= ap_buf->alloc_len)
+                          : (ap_buf->alloc_len
+                             >= (ap_buf->offset + ap_buf->filled_len));
+}
+
+static size_t
+ring_len (const size_t a_nbytes)
+{
+  const size_t page_size = sysconf (_SC_PAGESIZE);
+  return ((MAX (a_nbytes, 1) + page_size - 1) / page_size) * page_size;
+}
+
+static unsigned char *
+map_ring (const size_t a_len)
+{
+  unsigned char * p_ring = MAP_FAILED;
+  const int fd = syscall (SYS_memfd_create, "tizbuffer", MFD_CLOEXEC);
+
+  if (fd >= 0 && 0 == ftruncate (fd, (off_t) a_len))
+    {
+      /* Reserve the address space for both halves first, then map the same
+       * file over each of them */
+      p_ring = mmap (NULL, 2 * a_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                     -1, 0);
+      if (MAP_FAILED != p_ring
+          && (MAP_FAILED == mmap (p_ring, a_len, PROT_READ | PROT_WRITE,
+                                  MAP_SHARED | MAP_FIXED, fd, 0)
+              || MAP_FAILED == mmap (p_ring + a_len, a_len,
+                                     PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_FIXED, fd, 0)))
+        {
+          (void) munmap (p_ring, 2 * a_len);
+          p_ring = MAP_FAILED;
+        }
+    }
+
+  if (fd >= 0)
+    {
+      /* The mappings keep the memory alive */
+      (void) close (fd);
+    }
+
+  if (MAP_FAILED == p_ring)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to map a ring of [%zu] bytes",
+               a_len);
+      return NULL;
+    }
+  return p_ring;
+}
+
+static void
+release_store (tiz_buffer_t * ap_buf)
+{
+  assert (ap_buf);
+  if (is_ring (ap_buf))
+    {
+      if (ap_buf->p_store)
+        {
+          (void) munmap (ap_buf->p_store, 2 * (size_t) ap_buf->alloc_len);
+        }
+    }
+  else
+    {
+      tiz_mem_free (ap_buf->p_store);
+    }
+  ap_buf->p_store = NULL;
+}
+
+/* Moves the unread data to the start of a new ring of at least a_min_len
+ * bytes. The buffer is left untouched on failure. */
+static int
+move_to_ring (tiz_buffer_t * ap_buf, const size_t a_min_len)
+{
+  const size_t len = ring_len (MAX ((size_t) ap_buf->alloc_len, a_min_len));
+  unsigned char * p_ring = NULL;
+
+  assert (ap_buf);
+  assert (len <= INT_MAX);
+
+  if (!(p_ring = map_ring (len)))
+    {
+      return -1;
+    }
+
+  memcpy (p_ring, ap_buf->p_store + ap_buf->offset, ap_buf->filled_len);
+  release_store (ap_buf);
+  ap_buf->p_store = p_ring;
+  ap_buf->alloc_len = len;
+  ap_buf->offset = 0;
+  ap_buf->seek_mode = TIZ_BUFFER_RING;
+  return 0;
+}
+
+/* Moves the unread data from the ring to the start of a new heap store */
+static int
+move_to_heap (tiz_buffer_t * ap_buf, const int a_seek_mode)
+{
+  unsigned char * p_heap = NULL;
+
+  assert (ap_buf);
+  assert (is_ring (ap_buf));
+
+  if (!(p_heap = tiz_mem_alloc (ap_buf->alloc_len)))
+    {
+      return -1;
+    }
+
+  memcpy (p_heap, ap_buf->p_store + ap_buf->offset, ap_buf->filled_len);
+  release_store (ap_buf);
+  ap_buf->p_store = p_heap;
+  ap_buf->offset = 0;
+  ap_buf->seek_mode = a_seek_mode;
+  return 0;
+}
+
+/* Makes room at the back of the data, and returns how many of the a_nbytes
+ * requested fit there */
+static size_t
+make_room (tiz_buffer_t * ap_buf, const size_t a_nbytes)
+{
+  size_t avail = 0;
+
+  assert (ap_buf);
+
+  if (ap_buf->seek_mode != TIZ_BUFFER_SEEKABLE && 0 == ap_buf->filled_len)
+    {
+      ap_buf->offset = 0;
+    }
+
+  if (is_ring (ap_buf))
+    {
+      /* Writes never need to wrap around: the free space that follows the
+         data is contiguous in the second half of the mapping */
+      avail = ap_buf->alloc_len - ap_buf->filled_len;
+      if (a_nbytes > avail
+          && 0 == move_to_ring (ap_buf,
+                                MAX (2 * (size_t) ap_buf->alloc_len,
+                                     ap_buf->filled_len + a_nbytes)))
+        {
+          avail = ap_buf->alloc_len - ap_buf->filled_len;
+        }
+    }
+  else
+    {
+      avail = ap_buf->alloc_len - (ap_buf->offset + ap_buf->filled_len);
+
+      /* Unread data is only moved to the front when the space behind it is
+         not enough */
+      if (a_nbytes > avail && ap_buf->seek_mode == TIZ_BUFFER_NON_SEEKABLE
+          && ap_buf->offset > 0)
+        {
+          memmove (ap_buf->p_store, (ap_buf->p_store + ap_buf->offset),
+                   ap_buf->filled_len);
+          ap_buf->offset = 0;
+          avail = ap_buf->alloc_len - ap_buf->filled_len;
+        }
+
+      if (a_nbytes > avail)
+        {
+          /* need to re-alloc */
+          OMX_U8 * p_new_store = NULL;
+          size_t need
+            = MAX (2 * (size_t) ap_buf->alloc_len,
+                   ap_buf->offset + ap_buf->filled_len + a_nbytes);
+          p_new_store = tiz_mem_realloc (ap_buf->p_store, need);
+          if (p_new_store)
+            {
+              ap_buf->p_store = p_new_store;
+              ap_buf->alloc_len = need;
+              avail = ap_buf->alloc_len - (ap_buf->offset + ap_buf->filled_len);
+            }
+        }
+    }
+
+  return MIN (avail, a_nbytes);
+}
+
 static inline void *
 alloc_data_store (tiz_buffer_t * ap_buf, const size_t nbytes)
 {
@@ -89,8 +289,7 @@ dealloc_data_store (
 {
   if (ap_buf)
     {
-      tiz_mem_free (ap_buf->p_store);
-      ap_buf->p_store = NULL;
+      release_store (ap_buf);
       ap_buf->alloc_len = 0;
       ap_buf->filled_len = 0;
       ap_buf->offset = 0;
@@ -150,11 +349,28 @@ tiz_buffer_seek_mode (tiz_buffer_t * ap_buf, const int a_seek_mode)
 {
   int old_val = -1;
   if (a_seek_mode == TIZ_BUFFER_SEEKABLE
-      || a_seek_mode == TIZ_BUFFER_NON_SEEKABLE)
+      || a_seek_mode == TIZ_BUFFER_NON_SEEKABLE
+      || a_seek_mode == TIZ_BUFFER_RING)
     {
+      int rc = 0;
       assert (ap_buf);
       old_val = ap_buf->seek_mode;
-      ap_buf->seek_mode = a_seek_mode;
+      if (a_seek_mode == TIZ_BUFFER_RING && !is_ring (ap_buf))
+        {
+          rc = move_to_ring (ap_buf, ap_buf->alloc_len);
+        }
+      else if (a_seek_mode != TIZ_BUFFER_RING && is_ring (ap_buf))
+        {
+          rc = move_to_heap (ap_buf, a_seek_mode);
+        }
+      else
+        {
+          ap_buf->seek_mode = a_seek_mode;
+        }
+      if (0 != rc)
+        {
+          old_val = -1;
+        }
     }
   return old_val;
 }
@@ -166,47 +382,61 @@ tiz_buffer_push (tiz_buffer_t * ap_buf, const void * ap_data,
   OMX_U32 nbytes_to_copy = 0;
 
   assert (ap_buf);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  assert (store_is_consistent (ap_buf));
 
   if (ap_data && a_nbytes > 0)
     {
-      size_t avail = 0;
+      nbytes_to_copy = make_room (ap_buf, a_nbytes);
+      memcpy (ap_buf->p_store + ap_buf->offset + ap_buf->filled_len, ap_data,
+              nbytes_to_copy);
+      ap_buf->filled_len += nbytes_to_copy;
+    }
+  return nbytes_to_copy;
+}
 
-      if (ap_buf->seek_mode == TIZ_BUFFER_NON_SEEKABLE
-          && ap_buf->offset > 0)
-        {
-          memmove (ap_buf->p_store, (ap_buf->p_store + ap_buf->offset),
-                   ap_buf->filled_len);
-          ap_buf->offset = 0;
-        }
+int
+tiz_buffer_push_iov (tiz_buffer_t * ap_buf, const struct iovec * ap_iov,
+                     const int a_iovcnt)
+{
+  size_t total = 0;
+  size_t room = 0;
+  int i = 0;
 
-      avail = ap_buf->alloc_len - (ap_buf->offset + ap_buf->filled_len);
+  assert (ap_buf);
+  assert (store_is_consistent (ap_buf));
 
-      if (a_nbytes > avail)
+  if (!ap_iov)
+    {
+      return 0;
+    }
+
+  for (i = 0; i < a_iovcnt; ++i)
+    {
+      total += ap_iov[i].iov_len;
+    }
+
+  room = total > 0 ? make_room (ap_buf, total) : 0;
+  total = 0;
+
+  for (i = 0; i < a_iovcnt && total < room; ++i)
+    {
+      const size_t nbytes = MIN (ap_iov[i].iov_len, room - total);
+      if (nbytes > 0)
         {
-          /* need to re-alloc */
-          OMX_U8 * p_new_store = NULL;
-          size_t need = ap_buf->alloc_len * 2;
-          p_new_store = tiz_mem_realloc (ap_buf->p_store, need);
-          if (p_new_store)
-            {
-              ap_buf->p_store = p_new_store;
-              ap_buf->alloc_len = need;
-              avail = ap_buf->alloc_len - (ap_buf->offset + ap_buf->filled_len);
-            }
+          memcpy (ap_buf->p_store + ap_buf->offset + ap_buf->filled_len,
+                  ap_iov[i].iov_base, nbytes);
+          ap_buf->filled_len += nbytes;
+          total += nbytes;
         }
-      nbytes_to_copy = MIN (avail, a_nbytes);
-      memcpy (ap_buf->p_store + ap_buf->offset + ap_buf->filled_len, ap_data, nbytes_to_copy);
-      ap_buf->filled_len += nbytes_to_copy;
     }
-  return nbytes_to_copy;
+  return total;
 }
 
 int
 tiz_buffer_available (const tiz_buffer_t * ap_buf)
 {
   assert (ap_buf);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  assert (store_is_consistent (ap_buf));
   return ap_buf->filled_len;
 }
 
@@ -214,18 +444,37 @@ int
 tiz_buffer_offset (const tiz_buffer_t * ap_buf)
 {
   assert (ap_buf);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
-  return ap_buf->offset;
+  assert (store_is_consistent (ap_buf));
+  /* In ring mode, the buffer always starts at the current position */
+  return is_ring (ap_buf) ? 0 : ap_buf->offset;
 }
 
 void *
 tiz_buffer_get (const tiz_buffer_t * ap_buf)
 {
   assert (ap_buf);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  assert (store_is_consistent (ap_buf));
   return (ap_buf->p_store + ap_buf->offset);
 }
 
+int
+tiz_buffer_get_iov (const tiz_buffer_t * ap_buf, struct iovec * ap_iov,
+                    const int a_iovcnt)
+{
+  assert (ap_buf);
+  assert (store_is_consistent (ap_buf));
+
+  if (!ap_iov || a_iovcnt < 1 || 0 == ap_buf->filled_len)
+    {
+      return 0;
+    }
+
+  /* The unread data is contiguous in every mode */
+  ap_iov[0].iov_base = ap_buf->p_store + ap_buf->offset;
+  ap_iov[0].iov_len = ap_buf->filled_len;
+  return 1;
+}
+
 int
 tiz_buffer_advance (tiz_buffer_t * ap_buf, const int nbytes)
 {
@@ -236,6 +485,10 @@ tiz_buffer_advance (tiz_buffer_t * ap_buf, const int nbytes)
       min_nbytes = MIN (nbytes, tiz_buffer_available (ap_buf));
       ap_buf->offset += min_nbytes;
       ap_buf->filled_len -= min_nbytes;
+      if (is_ring (ap_buf) && ap_buf->offset >= ap_buf->alloc_len)
+        {
+          ap_buf->offset -= ap_buf->alloc_len;
+        }
     }
   return min_nbytes;
 }
@@ -245,7 +498,19 @@ tiz_buffer_seek (tiz_buffer_t * ap_buf, const long offset, const int whence)
 {
   int rc = -1;
   assert (ap_buf);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  assert (store_is_consistent (ap_buf));
+
+  if (is_ring (ap_buf))
+    {
+      /* The data behind the current position is gone; only forward seeks
+         relative to it are possible */
+      if (whence == TIZ_BUFFER_SEEK_CUR && offset >= 0)
+        {
+          (void) tiz_buffer_advance (ap_buf, MIN (offset, INT_MAX));
+          rc = 0;
+        }
+      return rc;
+    }
 
   int total = ap_buf->offset + ap_buf->filled_len;
   if (whence == TIZ_BUFFER_SEEK_SET)
@@ -277,7 +542,7 @@ tiz_buffer_seek (tiz_buffer_t * ap_buf, const long offset, const int whence)
       ap_buf->filled_len = total - ap_buf->offset;
     }
   assert (total == ap_buf->offset + ap_buf->filled_len);
-  assert (ap_buf->alloc_len >= (ap_buf->offset + ap_buf->filled_len));
+  assert (store_is_consistent (ap_buf));
 
   return rc;
 }
@@ -41,6 +41,8 @@ extern "C" {
 * @ingroup libtizplatform
 */
 
+#include <sys/uio.h>
+
 #include <OMX_Core.h>
 #include <OMX_Types.h>
 
@@ -52,6 +54,11 @@ extern "C" {
 #define TIZ_BUFFER_SEEKABLE \
   1 /** Data pushed on to the buffer is only discarded explicitely when
         'tiz_clear_buffer' is used. */
+#define TIZ_BUFFER_RING \
+  2 /** Like TIZ_BUFFER_NON_SEEKABLE, but the data store is a ring that is
+        mapped twice in a row, so that the unread data is always contiguous
+        and is never moved by push operations. Only forward seeks relative to
+        the current position are supported. */
 
 /* The possibilities for the third argument to 'tiz_buffer_seek'.
    These values should not be changed.  */
@@ -91,9 +98,10 @@ tiz_buffer_destroy (tiz_buffer_t * ap_buf);
  *
  * @ingroup tizbuffer
  * @param ap_buf The dynamic buffer handle.
- * @param a_seek_mode TIZ_BUFFER_NON_SEEKABLE (default) or
- * TIZ_BUFFER_SEEKABLE.
- * @return The old seek mode, or -1 on error.
+ * @param a_seek_mode TIZ_BUFFER_NON_SEEKABLE (default), TIZ_BUFFER_SEEKABLE
+ * or TIZ_BUFFER_RING.
+ * @return The old seek mode, or -1 on error (e.g. the ring could not be
+ * mapped, in which case the buffer stays in its current mode).
  */
 int
 tiz_buffer_seek_mode (tiz_buffer_t * ap_buf, const int a_seek_mode);
@@ -111,6 +119,20 @@ int
 tiz_buffer_push (tiz_buffer_t * ap_buf, const void * ap_data,
                  const size_t a_nbytes);
 
+/**
+ * Copy the data described by an array of iovec structures at the back of the
+ * buffer, with a single re-allocation (if any).
+ *
+ * @ingroup tizbuffer
+ * @param ap_buf The dynamic buffer handle.
+ * @param ap_iov The array of data segments to be stored, in order.
+ * @param a_iovcnt The number of elements in ap_iov.
+ * @return The total number of bytes actually stored.
+ */
+int
+tiz_buffer_push_iov (tiz_buffer_t * ap_buf, const struct iovec * ap_iov,
+                     const int a_iovcnt);
+
 /**
  * @brief Reset the position marker.
  *
@@ -156,6 +178,24 @@ tiz_buffer_offset (const tiz_buffer_t * ap_buf);
 void *
 tiz_buffer_get (const tiz_buffer_t * ap_buf);
 
+/**
+ * @brief Describe the data available in the buffer, without copying it.
+ *
+ * The segments remain valid until the next push, seek mode change or
+ * destruction of the buffer. Once the data has been consumed, use
+ * tiz_buffer_advance to release it.
+ *
+ * @ingroup tizbuffer
+ * @param ap_buf The dynamic buffer handle.
+ * @param ap_iov The array of iovec structures to be filled.
+ * @param a_iovcnt The number of elements in ap_iov.
+ * @return The number of elements of ap_iov that were filled (zero if the
+ * buffer is empty).
+ */
+int
+tiz_buffer_get_iov (const tiz_buffer_t * ap_buf, struct iovec * ap_iov,
+                    const int a_iovcnt);
+
 /**
  * @brief Advance the current position in the buffer.
  *
@@ -35,6 +35,7 @@
 #include <string.h>
 #include <assert.h>
 #include <pthread.h>
+#include <unistd.h>
 
 #include "tizplatform.h"
 #include "tizplatform_internal.h"
@@ -63,6 +64,10 @@
 #endif
 
 #define TIZ_EVENT_LOOP_THREAD_NAME "evloop"
+#define TIZ_EVENT_LOOP_MAX_THREADS 64
+
+typedef struct tiz_event_loop tiz_event_loop_t;
+typedef struct tiz_event_loop_msg tiz_event_loop_msg_t;
 
 struct tiz_event_io
 {
@@ -74,6 +79,8 @@ struct tiz_event_io
   uint32_t id;
   int fd;
   bool started;
+  tiz_event_loop_t * p_lp;
+  tiz_event_loop_msg_t * p_pending; /* requests still in the loop's queue */
 };
 
 struct tiz_event_timer
@@ -85,6 +92,8 @@ struct tiz_event_timer
   bool once;
   uint32_t id;
   bool started;
+  tiz_event_loop_t * p_lp;
+  tiz_event_loop_msg_t * p_pending; /* requests still in the loop's queue */
 };
 
 struct tiz_event_stat
@@ -95,6 +104,8 @@ struct tiz_event_stat
   void * p_arg1;
   uint32_t id;
   bool started;
+  tiz_event_loop_t * p_lp;
+  tiz_event_loop_msg_t * p_pending; /* requests still in the loop's queue */
 };
 
 typedef enum tiz_event_loop_state tiz_event_loop_state_t;
@@ -107,7 +118,6 @@ enum tiz_event_loop_state
   ETIZEventLoopStateStopped
 };
 
-typedef struct tiz_event_loop tiz_event_loop_t;
 struct tiz_event_loop
 {
   tiz_thread_t thread;
@@ -118,11 +128,22 @@ struct tiz_event_loop
   ev_async * p_async_watcher;
   struct ev_loop * p_loop;
   tiz_event_loop_state_t state;
+  size_t index;
+};
+
+/* The event loop threads. Each watcher is pinned to one of them, for its
+   whole life, by hashing its first argument (i.e. the component handle). This
+   way, all the events of a component are delivered by the same thread. */
+typedef struct tiz_event_loop_pool tiz_event_loop_pool_t;
+struct tiz_event_loop_pool
+{
+  tiz_event_loop_t * p_loops;
+  size_t nloops;
   tiz_rcfile_t * p_rcfile;
 };
 
 static pthread_once_t g_event_loop_once = PTHREAD_ONCE_INIT;
-static tiz_event_loop_t * gp_event_loop = NULL;
+static tiz_event_loop_pool_t * gp_event_loop_pool = NULL;
 
 typedef enum tiz_event_loop_msg_class tiz_event_loop_msg_class_t;
 enum tiz_event_loop_msg_class
@@ -164,11 +185,16 @@ struct tiz_event_loop_msg_stat
   uint32_t id;
 };
 
-typedef struct tiz_event_loop_msg tiz_event_loop_msg_t;
 struct tiz_event_loop_msg
 {
   tiz_event_loop_msg_class_t class;
   OMX_S32 priority;
+  /* While queued, the message is also linked into its watcher's list of
+     pending requests, so that these can be cancelled without searching the
+     queue */
+  tiz_pqueue_handle_t p_handle;
+  tiz_event_loop_msg_t * p_prev_pending;
+  tiz_event_loop_msg_t * p_next_pending;
   union
   {
     tiz_event_loop_msg_io_t io;
@@ -244,7 +270,7 @@ static tiz_event_loop_msg_str_t tiz_event_loop_msg_to_str_tbl[] = {
   {ETIZEventLoopMsgMax, "ETIZEventLoopMsgMax"},
 };
 
-static const OMX_STRING
+static OMX_STRING
 tiz_event_loop_msg_to_str (const tiz_event_loop_msg_class_t a_msg)
 {
   const OMX_S32 count = sizeof (tiz_event_loop_msg_to_str_tbl)
@@ -324,6 +350,105 @@ init_event_loop_msg (tiz_event_loop_t * ap_event_loop,
 /*@end@*/
 /* NOTE: Stop ignoring splint warnings in this section  */
 
+static tiz_event_loop_msg_t **
+pending_list (tiz_event_loop_msg_t * ap_msg)
+{
+  assert (ap_msg);
+  switch (ap_msg->class)
+    {
+      case ETIZEventLoopMsgIoStart:
+      case ETIZEventLoopMsgIoStop:
+      case ETIZEventLoopMsgIoDestroy:
+        return &(ap_msg->io.p_ev_io->p_pending);
+      case ETIZEventLoopMsgTimerStart:
+      case ETIZEventLoopMsgTimerRestart:
+      case ETIZEventLoopMsgTimerStop:
+      case ETIZEventLoopMsgTimerDestroy:
+        return &(ap_msg->timer.p_ev_timer->p_pending);
+      case ETIZEventLoopMsgStatStart:
+      case ETIZEventLoopMsgStatStop:
+      case ETIZEventLoopMsgStatDestroy:
+        return &(ap_msg->stat.p_ev_stat->p_pending);
+      default:
+        assert (0);
+        break;
+    };
+  return NULL;
+}
+
+static void
+link_pending (tiz_event_loop_msg_t * ap_msg)
+{
+  tiz_event_loop_msg_t ** pp_head = pending_list (ap_msg);
+  ap_msg->p_prev_pending = NULL;
+  ap_msg->p_next_pending = *pp_head;
+  if (*pp_head)
+    {
+      (*pp_head)->p_prev_pending = ap_msg;
+    }
+  *pp_head = ap_msg;
+}
+
+static void
+unlink_pending (tiz_event_loop_msg_t * ap_msg)
+{
+  if (ap_msg->p_prev_pending)
+    {
+      ap_msg->p_prev_pending->p_next_pending = ap_msg->p_next_pending;
+    }
+  else
+    {
+      *(pending_list (ap_msg)) = ap_msg->p_next_pending;
+    }
+  if (ap_msg->p_next_pending)
+    {
+      ap_msg->p_next_pending->p_prev_pending = ap_msg->p_prev_pending;
+    }
+  ap_msg->p_prev_pending = ap_msg->p_next_pending = NULL;
+}
+
+static uint32_t
+msg_id (const tiz_event_loop_msg_t * ap_msg)
+{
+  if (ap_msg->class <= ETIZEventLoopMsgIoAny)
+    {
+      return ap_msg->io.id;
+    }
+  else if (ap_msg->class <= ETIZEventLoopMsgTimerAny)
+    {
+      return ap_msg->timer.id;
+    }
+  return ap_msg->stat.id;
+}
+
+/* Removes from the loop's queue the requests still pending for a watcher.
+   These are only looked for in the watcher's own list, and taken off the
+   queue through their handles, i.e. without searching the queue. With
+   ETIZEventLoopMsgMax as the class, all of them are removed. */
+static void
+cancel_pending (tiz_event_loop_t * ap_lp, tiz_event_loop_msg_t ** app_head,
+                const tiz_event_loop_msg_class_t a_class, const uint32_t a_id)
+{
+  tiz_event_loop_msg_t * p_msg = NULL;
+  tiz_event_loop_msg_t * p_next = NULL;
+
+  assert (ap_lp);
+  assert (app_head);
+
+  for (p_msg = *app_head; p_msg; p_msg = p_next)
+    {
+      p_next = p_msg->p_next_pending;
+      if (ETIZEventLoopMsgMax == a_class
+          || (a_class == p_msg->class && a_id == msg_id (p_msg)))
+        {
+          unlink_pending (p_msg);
+          (void) tiz_pqueue_remove_handle (ap_lp->p_pq, p_msg->p_handle,
+                                           NULL);
+          tiz_soa_free (ap_lp->p_soa, p_msg);
+        }
+    }
+}
+
 static OMX_ERRORTYPE
 enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
                 const tiz_event_loop_msg_class_t a_class)
@@ -331,15 +456,18 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
   OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_io_t * p_msg_io = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (ap_ev_io);
+  p_lp = ap_ev_io->p_lp;
+  assert (p_lp);
   assert (ETIZEventLoopMsgIoStart == a_class
           || ETIZEventLoopMsgIoStop == a_class
           || ETIZEventLoopMsgIoDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
+  tiz_check_omx (tiz_mutex_lock (&(p_lp->mutex)));
   tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
+    (p_msg = init_event_loop_msg (p_lp, (a_class))),
     "Failed to initialise the event loop");
 
   assert (p_msg);
@@ -347,10 +475,12 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
   p_msg_io->p_ev_io = ap_ev_io;
   p_msg_io->id = a_id;
   tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
+    (rc = tiz_pqueue_send_with_handle (p_lp->p_pq, p_msg, p_msg->priority,
+                                       &(p_msg->p_handle))),
     "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
+  link_pending (p_msg);
+  tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
+  ev_async_send (p_lp->p_loop, p_lp->p_async_watcher);
 
   /* All good */
   rc = OMX_ErrorNone;
@@ -359,7 +489,7 @@ enqueue_io_msg (tiz_event_io_t * ap_ev_io, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+      tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
     }
 
   return OMX_ErrorNone;
@@ -372,16 +502,19 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
   OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (ap_ev_timer);
+  p_lp = ap_ev_timer->p_lp;
+  assert (p_lp);
   assert (ETIZEventLoopMsgTimerStart == a_class
           || ETIZEventLoopMsgTimerStop == a_class
           || ETIZEventLoopMsgTimerRestart == a_class
           || ETIZEventLoopMsgTimerDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
+  tiz_check_omx (tiz_mutex_lock (&(p_lp->mutex)));
   tiz_goto_end_on_null (
-    (p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
+    (p_msg = init_event_loop_msg (p_lp, (a_class))),
     "Failed to initialise the event loop");
 
   assert (p_msg);
@@ -389,10 +522,12 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
   p_msg_timer->p_ev_timer = ap_ev_timer;
   p_msg_timer->id = a_id;
   tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
+    (rc = tiz_pqueue_send_with_handle (p_lp->p_pq, p_msg, p_msg->priority,
+                                       &(p_msg->p_handle))),
     "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
+  link_pending (p_msg);
+  tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
+  ev_async_send (p_lp->p_loop, p_lp->p_async_watcher);
 
   /* All good */
   rc = OMX_ErrorNone;
@@ -401,7 +536,7 @@ enqueue_timer_msg (tiz_event_timer_t * ap_ev_timer, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+      tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
     }
 
   return rc;
@@ -414,14 +549,17 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
   OMX_ERRORTYPE rc = OMX_ErrorUndefined;
   tiz_event_loop_msg_t * p_msg = NULL;
   tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (ap_ev_stat);
+  p_lp = ap_ev_stat->p_lp;
+  assert (p_lp);
   assert (ETIZEventLoopMsgStatStart == a_class
           || ETIZEventLoopMsgStatStop == a_class
           || ETIZEventLoopMsgStatDestroy == a_class);
 
-  tiz_check_omx (tiz_mutex_lock (&(gp_event_loop->mutex)));
-  tiz_goto_end_on_null ((p_msg = init_event_loop_msg (gp_event_loop, (a_class))),
+  tiz_check_omx (tiz_mutex_lock (&(p_lp->mutex)));
+  tiz_goto_end_on_null ((p_msg = init_event_loop_msg (p_lp, (a_class))),
                         "Failed to initialise the event loop");
 
   assert (p_msg);
@@ -429,10 +567,12 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
   p_msg_stat->p_ev_stat = ap_ev_stat;
   p_msg_stat->id = a_id;
   tiz_goto_end_on_omx_err (
-    (rc = tiz_pqueue_send (gp_event_loop->p_pq, p_msg, p_msg->priority)),
+    (rc = tiz_pqueue_send_with_handle (p_lp->p_pq, p_msg, p_msg->priority,
+                                       &(p_msg->p_handle))),
     "Failed to insert into the queue");
-  tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
-  ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
+  link_pending (p_msg);
+  tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
+  ev_async_send (p_lp->p_loop, p_lp->p_async_watcher);
 
   /* All good */
   rc = OMX_ErrorNone;
@@ -441,7 +581,7 @@ enqueue_stat_msg (tiz_event_stat_t * ap_ev_stat, const uint32_t a_id,
 
   if (OMX_ErrorNone != rc)
     {
-      tiz_check_omx (tiz_mutex_unlock (&(gp_event_loop->mutex)));
+      tiz_check_omx (tiz_mutex_unlock (&(p_lp->mutex)));
     }
 
   return OMX_ErrorNone;
@@ -467,151 +607,22 @@ pqueue_cmp (OMX_PTR ap_left, OMX_PTR ap_right)
   return 1;
 }
 
-static OMX_BOOL
-ev_io_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
-{
-  OMX_BOOL rc = OMX_FALSE;
-  tiz_event_loop_msg_t * p_msg = ap_elem;
-  const tiz_event_loop_msg_class_t class_to_delete = a_data1;
-  tiz_event_loop_msg_class_t elem_class = ETIZEventLoopMsgMax;
-  bool elem_class_is_io = false;
-
-  assert (p_msg);
-  assert (ETIZEventLoopMsgIoStart == class_to_delete
-          || ETIZEventLoopMsgIoStop == class_to_delete
-          || ETIZEventLoopMsgIoDestroy == class_to_delete
-          || ETIZEventLoopMsgIoAny == class_to_delete);
-
-  elem_class = p_msg->class;
-  elem_class_is_io = (ETIZEventLoopMsgIoStart == elem_class
-                      || ETIZEventLoopMsgIoStop == elem_class
-                      || ETIZEventLoopMsgIoDestroy == elem_class);
-
-  if (class_to_delete == elem_class
-      || (elem_class_is_io && class_to_delete == ETIZEventLoopMsgIoAny))
-    {
-      tiz_event_loop_msg_io_t * p_msg_io = NULL;
-      tiz_event_io_t * p_ev_io = NULL;
-      p_msg_io = &(p_msg->io);
-      assert (p_msg_io);
-      p_ev_io = p_msg_io->p_ev_io;
-      assert (p_ev_io);
-      if (ap_data2 == p_ev_io)
-        {
-          tiz_event_io_t * p_ev_io_needle = ap_data2;
-          if (p_ev_io_needle->id == p_msg_io->id)
-            {
-              /* Found, return TRUE so that the msg will be removed from the
-                 queue */
-              rc = OMX_TRUE;
-            }
-        }
-    }
-  return rc;
-}
-
-static OMX_BOOL
-ev_timer_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
-{
-  OMX_BOOL rc = OMX_FALSE;
-  tiz_event_loop_msg_t * p_msg = ap_elem;
-  const tiz_event_loop_msg_class_t class_to_delete = a_data1;
-  tiz_event_loop_msg_class_t elem_class = ETIZEventLoopMsgMax;
-  bool elem_class_is_timer = false;
-
-  assert (p_msg);
-  assert (ETIZEventLoopMsgTimerStart == class_to_delete
-          || ETIZEventLoopMsgTimerStop == class_to_delete
-          || ETIZEventLoopMsgTimerDestroy == class_to_delete
-          || ETIZEventLoopMsgTimerAny == class_to_delete);
-
-  elem_class = p_msg->class;
-  elem_class_is_timer = (ETIZEventLoopMsgTimerStart == elem_class
-                         || ETIZEventLoopMsgTimerStop == elem_class
-                         || ETIZEventLoopMsgTimerDestroy == elem_class);
-
-  if (class_to_delete == p_msg->class || (elem_class_is_timer
-                                          && class_to_delete
-                                               == ETIZEventLoopMsgTimerAny))
-    {
-      tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
-      tiz_event_timer_t * p_ev_timer = NULL;
-      p_msg_timer = &(p_msg->timer);
-      assert (p_msg_timer);
-      p_ev_timer = p_msg_timer->p_ev_timer;
-      assert (p_ev_timer);
-      if (ap_data2 == p_ev_timer)
-        {
-          tiz_event_timer_t * p_ev_timer_needle = ap_data2;
-          if (p_ev_timer_needle->id == p_msg_timer->id)
-            {
-              /* Found, return TRUE so that the msg will be removed from the
-                 queue */
-              rc = OMX_TRUE;
-            }
-        }
-    }
-  return rc;
-}
-
-static OMX_BOOL
-ev_stat_msg_dequeue (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
-{
-  OMX_BOOL rc = OMX_FALSE;
-  tiz_event_loop_msg_t * p_msg = ap_elem;
-  const tiz_event_loop_msg_class_t class_to_delete = a_data1;
-  tiz_event_loop_msg_class_t elem_class = ETIZEventLoopMsgMax;
-  bool elem_class_is_stat = false;
-
-  assert (p_msg);
-  assert (ETIZEventLoopMsgStatStart == class_to_delete
-          || ETIZEventLoopMsgStatStop == class_to_delete
-          || ETIZEventLoopMsgStatDestroy == class_to_delete
-          || ETIZEventLoopMsgStatAny == class_to_delete);
-
-  elem_class = p_msg->class;
-  elem_class_is_stat = (ETIZEventLoopMsgStatStart == elem_class
-                        || ETIZEventLoopMsgStatStop == elem_class
-                        || ETIZEventLoopMsgStatDestroy == elem_class);
-
-  if (class_to_delete == p_msg->class || (elem_class_is_stat
-                                          && class_to_delete
-                                               == ETIZEventLoopMsgStatAny))
-    {
-      tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
-      tiz_event_stat_t * p_ev_stat = NULL;
-      p_msg_stat = &(p_msg->stat);
-      assert (p_msg_stat);
-      p_ev_stat = p_msg_stat->p_ev_stat;
-      assert (p_ev_stat);
-      if (ap_data2 == p_ev_stat)
-        {
-          tiz_event_stat_t * p_ev_stat_needle = ap_data2;
-          if (p_ev_stat_needle->id == p_msg_stat->id)
-            {
-              /* Found, return TRUE so that the msg will be removed from the
-                 queue */
-              rc = OMX_TRUE;
-            }
-        }
-    }
-  return rc;
-}
-
 static OMX_ERRORTYPE
 do_io_start (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_io_t * p_msg_io = NULL;
   tiz_event_io_t * p_ev_io = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_io = &(ap_msg->io);
   assert (p_msg_io);
   p_ev_io = p_msg_io->p_ev_io;
   assert (p_ev_io);
+  p_lp = p_ev_io->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   /* debug: Verify that ids don't get repeated */
   if (p_ev_io->id != 0 && p_ev_io->id == p_msg_io->id)
     {
@@ -624,7 +635,7 @@ do_io_start (tiz_event_loop_msg_t * ap_msg)
       assert (!p_ev_io->started);
     }
   p_ev_io->started = true;
-  ev_io_start (gp_event_loop->p_loop, (ev_io *) (p_ev_io));
+  ev_io_start (p_lp->p_loop, (ev_io *) (p_ev_io));
 
   return OMX_ErrorNone;
 }
@@ -634,29 +645,29 @@ do_io_stop (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_io_t * p_msg_io = NULL;
   tiz_event_io_t * p_ev_io = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_io = &(ap_msg->io);
   assert (p_msg_io);
   p_ev_io = p_msg_io->p_ev_io;
   assert (p_ev_io);
+  p_lp = p_ev_io->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_io->started)
     {
       /* The io watcher has been started, let's stop it */
-      ev_io_stop (gp_event_loop->p_loop, (ev_io *) (p_ev_io));
+      ev_io_stop (p_lp->p_loop, (ev_io *) (p_ev_io));
       p_ev_io->started = false;
     }
   else
     {
       /* This io watcher hasn't been started, let's make sure there are no
          start requests left behind in the queue */
-      const tiz_event_loop_msg_class_t class_to_be_deleted
-        = ETIZEventLoopMsgIoStart;
-      tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_io_msg_dequeue,
-                              (OMX_S32) class_to_be_deleted, p_ev_io);
+      cancel_pending (p_lp, &(p_ev_io->p_pending), ETIZEventLoopMsgIoStart,
+                      p_ev_io->id);
     }
   return OMX_ErrorNone;
 }
@@ -666,28 +677,26 @@ do_io_destroy (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_io_t * p_msg_io = NULL;
   tiz_event_io_t * p_ev_io = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_io = &(ap_msg->io);
   assert (p_msg_io);
   p_ev_io = p_msg_io->p_ev_io;
   assert (p_ev_io);
+  p_lp = p_ev_io->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_io->started)
     {
       /* The io watcher has been started, let's stop it */
-      ev_io_stop (gp_event_loop->p_loop, (ev_io *) (p_ev_io));
+      ev_io_stop (p_lp->p_loop, (ev_io *) (p_ev_io));
     }
 
-  {
-    /* Now remove any references to this watcher that might be present in the
-       queue */
-    tiz_event_loop_msg_class_t class_to_be_deleted = ETIZEventLoopMsgIoAny;
-    tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_io_msg_dequeue,
-                            (OMX_S32) class_to_be_deleted, p_ev_io);
-  }
+  /* Now remove any references to this watcher that might be present in the
+     queue */
+  cancel_pending (p_lp, &(p_ev_io->p_pending), ETIZEventLoopMsgMax, 0);
 
   /* And now it should be safe to delete the io event */
   tiz_mem_free (p_ev_io);
@@ -701,15 +710,17 @@ do_timer_start (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
   tiz_event_timer_t * p_ev_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_timer = &(ap_msg->timer);
   assert (p_msg_timer);
   p_ev_timer = p_msg_timer->p_ev_timer;
   assert (p_ev_timer);
+  p_lp = p_ev_timer->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   /* debug: Verify that ids don't get repeated */
   if (p_ev_timer->id != 0 && p_ev_timer->id == p_msg_timer->id)
     {
@@ -717,7 +728,7 @@ do_timer_start (tiz_event_loop_msg_t * ap_msg)
     }
   p_ev_timer->id = p_msg_timer->id;
   p_ev_timer->started = true;
-  ev_timer_start (gp_event_loop->p_loop, (ev_timer *) (p_ev_timer));
+  ev_timer_start (p_lp->p_loop, (ev_timer *) (p_ev_timer));
 
   return OMX_ErrorNone;
 }
@@ -727,15 +738,17 @@ do_timer_restart (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
   tiz_event_timer_t * p_ev_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_timer = &(ap_msg->timer);
   assert (p_msg_timer);
   p_ev_timer = p_msg_timer->p_ev_timer;
   assert (p_ev_timer);
+  p_lp = p_ev_timer->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   /* debug: Verify that ids don't get repeated */
   if (p_ev_timer->id != 0 && p_ev_timer->id == p_msg_timer->id)
     {
@@ -743,7 +756,7 @@ do_timer_restart (tiz_event_loop_msg_t * ap_msg)
     }
   p_ev_timer->id = p_msg_timer->id;
   p_ev_timer->started = true;
-  ev_timer_again (gp_event_loop->p_loop, (ev_timer *) (p_ev_timer));
+  ev_timer_again (p_lp->p_loop, (ev_timer *) (p_ev_timer));
 
   return OMX_ErrorNone;
 }
@@ -753,19 +766,21 @@ do_timer_stop (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
   tiz_event_timer_t * p_ev_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_timer = &(ap_msg->timer);
   assert (p_msg_timer);
   p_ev_timer = p_msg_timer->p_ev_timer;
   assert (p_ev_timer);
+  p_lp = p_ev_timer->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_timer->started)
     {
       /* The timer watcher has been started, let's stop it */
-      ev_timer_stop (gp_event_loop->p_loop, (ev_timer *) (p_ev_timer));
+      ev_timer_stop (p_lp->p_loop, (ev_timer *) (p_ev_timer));
       p_ev_timer->started = false;
     }
   else
@@ -773,10 +788,8 @@ do_timer_stop (tiz_event_loop_msg_t * ap_msg)
       /* The timer watcher hasn't been started, let's make sure there are no
          start
          requests in the queue */
-      const tiz_event_loop_msg_class_t class_to_be_deleted
-        = ETIZEventLoopMsgTimerStart;
-      tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_timer_msg_dequeue,
-                              (OMX_S32) class_to_be_deleted, p_ev_timer);
+      cancel_pending (p_lp, &(p_ev_timer->p_pending),
+                      ETIZEventLoopMsgTimerStart, p_ev_timer->id);
     }
 
   return OMX_ErrorNone;
@@ -787,27 +800,25 @@ do_timer_destroy (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_timer_t * p_msg_timer = NULL;
   tiz_event_timer_t * p_ev_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_timer = &(ap_msg->timer);
   assert (p_msg_timer);
   p_ev_timer = p_msg_timer->p_ev_timer;
   assert (p_ev_timer);
+  p_lp = p_ev_timer->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_timer->started)
     {
       /* The timer watcher has been started, let's stop it */
-      ev_timer_stop (gp_event_loop->p_loop, (ev_timer *) (p_ev_timer));
+      ev_timer_stop (p_lp->p_loop, (ev_timer *) (p_ev_timer));
     }
-  {
-    /* Now remove any references to this watcher that might be present in the
-       queue */
-    tiz_event_loop_msg_class_t class_to_be_deleted = ETIZEventLoopMsgTimerAny;
-    tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_timer_msg_dequeue,
-                            (OMX_S32) class_to_be_deleted, p_ev_timer);
-  }
+  /* Now remove any references to this watcher that might be present in the
+     queue */
+  cancel_pending (p_lp, &(p_ev_timer->p_pending), ETIZEventLoopMsgMax, 0);
 
   /* And now it should be safe to delete the timer event */
   tiz_mem_free (p_ev_timer);
@@ -821,15 +832,17 @@ do_stat_start (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
   tiz_event_stat_t * p_ev_stat = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_stat = &(ap_msg->stat);
   assert (p_msg_stat);
   p_ev_stat = p_msg_stat->p_ev_stat;
   assert (p_ev_stat);
+  p_lp = p_ev_stat->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   /* debug: Verify that ids don't get repeated */
   if (p_ev_stat->id != 0 && p_ev_stat->id == p_msg_stat->id)
     {
@@ -842,7 +855,7 @@ do_stat_start (tiz_event_loop_msg_t * ap_msg)
       assert (!p_ev_stat->started);
     }
   p_ev_stat->started = true;
-  ev_stat_start (gp_event_loop->p_loop, (ev_stat *) (p_ev_stat));
+  ev_stat_start (p_lp->p_loop, (ev_stat *) (p_ev_stat));
 
   return OMX_ErrorNone;
 }
@@ -852,19 +865,21 @@ do_stat_stop (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
   tiz_event_stat_t * p_ev_stat = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_stat = &(ap_msg->stat);
   assert (p_msg_stat);
   p_ev_stat = p_msg_stat->p_ev_stat;
   assert (p_ev_stat);
+  p_lp = p_ev_stat->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_stat->started)
     {
       /* The stat watcher has been started, let's stop it */
-      ev_stat_stop (gp_event_loop->p_loop, (ev_stat *) (p_ev_stat));
+      ev_stat_stop (p_lp->p_loop, (ev_stat *) (p_ev_stat));
       p_ev_stat->started = false;
     }
   else
@@ -872,10 +887,8 @@ do_stat_stop (tiz_event_loop_msg_t * ap_msg)
       /* The stat watcher hasn't been started, let's make sure there are no
          start
          requests in the queue */
-      const tiz_event_loop_msg_class_t class_to_be_deleted
-        = ETIZEventLoopMsgStatStart;
-      tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_stat_msg_dequeue,
-                              (OMX_S32) class_to_be_deleted, p_ev_stat);
+      cancel_pending (p_lp, &(p_ev_stat->p_pending),
+                      ETIZEventLoopMsgStatStart, p_ev_stat->id);
     }
   return OMX_ErrorNone;
 }
@@ -885,28 +898,26 @@ do_stat_destroy (tiz_event_loop_msg_t * ap_msg)
 {
   tiz_event_loop_msg_stat_t * p_msg_stat = NULL;
   tiz_event_stat_t * p_ev_stat = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
-  assert (gp_event_loop);
   assert (ap_msg);
-  assert (ETIZEventLoopStateStarted == gp_event_loop->state);
 
   p_msg_stat = &(ap_msg->stat);
   assert (p_msg_stat);
   p_ev_stat = p_msg_stat->p_ev_stat;
   assert (p_ev_stat);
+  p_lp = p_ev_stat->p_lp;
+  assert (p_lp);
+  assert (ETIZEventLoopStateStarted == p_lp->state);
   if (p_ev_stat->started)
     {
       /* The stat watcher has been started, let's stop it */
-      ev_stat_stop (gp_event_loop->p_loop, (ev_stat *) (p_ev_stat));
+      ev_stat_stop (p_lp->p_loop, (ev_stat *) (p_ev_stat));
     }
 
-  {
-    /* Now remove any references to this watcher that might be present in the
-       queue */
-    tiz_event_loop_msg_class_t class_to_be_deleted = ETIZEventLoopMsgStatAny;
-    tiz_pqueue_remove_func (gp_event_loop->p_pq, ev_stat_msg_dequeue,
-                            (OMX_S32) class_to_be_deleted, p_ev_stat);
-  }
+  /* Now remove any references to this watcher that might be present in the
+     queue */
+  cancel_pending (p_lp, &(p_ev_stat->p_pending), ETIZEventLoopMsgMax, 0);
 
   /* And now it should be safe to delete the stat event */
   tiz_mem_free (p_msg_stat->p_ev_stat);
@@ -918,35 +929,39 @@ static void
 async_watcher_cback (struct ev_loop * ap_loop, ev_async * ap_watcher,
                      int a_revents)
 {
+  tiz_event_loop_t * p_lp = NULL;
   (void) ap_loop;
-  (void) ap_watcher;
   (void) a_revents;
 
-  if (gp_event_loop)
+  assert (ap_watcher);
+  p_lp = ap_watcher->data;
+
+  if (p_lp)
     {
-      if (ETIZEventLoopStateStopping == gp_event_loop->state)
+      if (ETIZEventLoopStateStopping == p_lp->state)
         {
-          ev_break (gp_event_loop->p_loop, EVBREAK_ONE);
+          ev_break (p_lp->p_loop, EVBREAK_ONE);
         }
-      else if (ETIZEventLoopStateStarted == gp_event_loop->state)
+      else if (ETIZEventLoopStateStarted == p_lp->state)
         {
           void * p_msg = NULL;
 
           /* Process all items from the queue */
-          (void) tiz_mutex_lock (&(gp_event_loop->mutex));
-          while (0 < tiz_pqueue_length (gp_event_loop->p_pq))
+          (void) tiz_mutex_lock (&(p_lp->mutex));
+          while (0 < tiz_pqueue_length (p_lp->p_pq))
             {
-              if (OMX_ErrorNone
-                  != tiz_pqueue_receive (gp_event_loop->p_pq, &p_msg))
+              if (OMX_ErrorNone != tiz_pqueue_receive (p_lp->p_pq, &p_msg))
                 {
                   break;
                 }
+              /* Its handle is no longer valid */
+              unlink_pending (p_msg);
               /* Process the message */
               dispatch_msg (p_msg);
               /* Delete the message */
-              tiz_soa_free (gp_event_loop->p_soa, p_msg);
+              tiz_soa_free (p_lp->p_soa, p_msg);
             }
-          (void) tiz_mutex_unlock (&(gp_event_loop->mutex));
+          (void) tiz_mutex_unlock (&(p_lp->mutex));
         }
     }
 }
@@ -955,9 +970,8 @@ static void
 io_watcher_cback (struct ev_loop * ap_loop, ev_io * ap_watcher, int a_revents)
 {
   tiz_event_io_t * p_io_event = (tiz_event_io_t *) ap_watcher;
-  (void) ap_loop;
 
-  if (gp_event_loop)
+  if (gp_event_loop_pool)
     {
       assert (p_io_event);
       assert (p_io_event->pf_cback);
@@ -965,7 +979,7 @@ io_watcher_cback (struct ev_loop * ap_loop, ev_io * ap_watcher, int a_revents)
       if (p_io_event->once)
         {
           p_io_event->started = false;
-          ev_io_stop (gp_event_loop->p_loop, (ev_io *) p_io_event);
+          ev_io_stop (ap_loop, (ev_io *) p_io_event);
         }
       p_io_event->pf_cback (p_io_event->p_arg0, p_io_event, p_io_event->p_arg1,
                             p_io_event->id, ((ev_io *) p_io_event)->fd,
@@ -980,7 +994,7 @@ timer_watcher_cback (struct ev_loop * ap_loop, ev_timer * ap_watcher,
   (void) ap_loop;
   (void) a_revents;
 
-  if (gp_event_loop)
+  if (gp_event_loop_pool)
     {
       tiz_event_timer_t * p_timer_event = (tiz_event_timer_t *) ap_watcher;
       assert (p_timer_event);
@@ -996,7 +1010,7 @@ stat_watcher_cback (struct ev_loop * ap_loop, ev_stat * ap_watcher,
 {
   (void) ap_loop;
 
-  if (gp_event_loop)
+  if (gp_event_loop_pool)
     {
       tiz_event_stat_t * p_stat_event = (tiz_event_stat_t *) ap_watcher;
       assert (p_stat_event);
@@ -1012,14 +1026,27 @@ event_loop_thread_func (void * p_arg)
 {
   tiz_event_loop_t * p_event_loop = p_arg;
   struct ev_loop * p_loop = NULL;
+  char thread_name[16]; /* 16 is the max number of characters that
+                           tiz_thread_setname will use */
 
   assert (p_event_loop);
 
   p_loop = p_event_loop->p_loop;
   assert (p_loop);
 
+  /* The first loop keeps the traditional name */
+  if (0 == p_event_loop->index)
+    {
+      snprintf (thread_name, sizeof (thread_name), "%s",
+                TIZ_EVENT_LOOP_THREAD_NAME);
+    }
+  else
+    {
+      snprintf (thread_name, sizeof (thread_name), "%s%u",
+                TIZ_EVENT_LOOP_THREAD_NAME, (unsigned) p_event_loop->index);
+    }
   (void) tiz_thread_setname (&(p_event_loop->thread),
-                             (const OMX_STRING) TIZ_EVENT_LOOP_THREAD_NAME);
+                             (const OMX_STRING) thread_name);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "Entering the dispatcher...");
   tiz_sem_post (&(p_event_loop->sem));
@@ -1062,6 +1089,13 @@ clean_up_thread_data (tiz_event_loop_t * ap_lp)
 
       if (ap_lp->p_pq)
         {
+          /* The loop may have been stopped with requests still queued, e.g.
+             watchers destroyed right before tiz_event_loop_destroy */
+          void * p_msg = NULL;
+          while (OMX_ErrorNone == tiz_pqueue_receive (ap_lp->p_pq, &p_msg))
+            {
+              tiz_soa_free (ap_lp->p_soa, p_msg);
+            }
           tiz_pqueue_destroy (ap_lp->p_pq);
           ap_lp->p_pq = NULL;
         }
@@ -1071,9 +1105,24 @@ clean_up_thread_data (tiz_event_loop_t * ap_lp)
           tiz_soa_destroy (ap_lp->p_soa);
           ap_lp->p_soa = NULL;
         }
+    }
+}
 
-      tiz_mem_free (gp_event_loop);
-      gp_event_loop = NULL;
+static void
+clean_up_pool_data (tiz_event_loop_pool_t * ap_pool)
+{
+  if (ap_pool)
+    {
+      size_t i = 0;
+      for (i = 0; ap_pool->p_loops && i < ap_pool->nloops; ++i)
+        {
+          clean_up_thread_data (&(ap_pool->p_loops[i]));
+        }
+      tiz_mem_free (ap_pool->p_loops);
+      ap_pool->p_loops = NULL;
+      /* NOTE: The rc file is not destroyed, as the config file handle is
+         handed out by tiz_rcfile_get_handle */
+      tiz_mem_free (ap_pool);
     }
 }
 
@@ -1083,7 +1132,81 @@ child_event_loop_reset (void)
   /* Reset the once control */
   pthread_once_t once = PTHREAD_ONCE_INIT;
   memcpy (&g_event_loop_once, &once, sizeof (g_event_loop_once));
-  gp_event_loop = NULL;
+  gp_event_loop_pool = NULL;
+}
+
+static size_t
+configured_loop_count (tiz_rcfile_t * ap_rcfile)
+{
+  long nloops = 1;
+  const char * p_value = NULL;
+
+  /* NOTE: tiz_rcfile_get_value can't be used here, as that would re-enter
+     get_event_loop */
+  if (ap_rcfile && (p_value = tiz_rcfile_get_value_internal (
+                      ap_rcfile, "ilcore", "event-loop-threads")))
+    {
+      nloops = strtol (p_value, NULL, 10);
+      if (nloops <= 0)
+        {
+          /* 0 means one loop per online cpu */
+          nloops = sysconf (_SC_NPROCESSORS_ONLN);
+        }
+    }
+
+  return (size_t) MIN (MAX (nloops, 1), TIZ_EVENT_LOOP_MAX_THREADS);
+}
+
+static OMX_ERRORTYPE
+init_loop_data (tiz_event_loop_t * ap_lp, const size_t a_index)
+{
+  assert (ap_lp);
+
+  ap_lp->index = a_index;
+  ap_lp->state = ETIZEventLoopStateStarting;
+
+  tiz_check_null_ret_oom ((ap_lp->p_loop = ev_loop_new (EVFLAG_AUTO))
+                          != NULL);
+
+  tiz_check_null_ret_oom (
+    (ap_lp->p_async_watcher
+     = (ev_async *) tiz_mem_calloc (1, sizeof (ev_async)))
+    != NULL);
+
+  tiz_check_omx (tiz_mutex_init (&(ap_lp->mutex)));
+
+  tiz_check_omx (tiz_sem_init (&(ap_lp->sem), 0));
+
+  /* Init the small object allocator */
+  tiz_check_omx (tiz_soa_init (&(ap_lp->p_soa)));
+
+  /* Init the priority queue */
+  tiz_check_omx (tiz_pqueue_init (&ap_lp->p_pq, 2, &pqueue_cmp, ap_lp->p_soa,
+                                  TIZ_EVENT_LOOP_THREAD_NAME));
+
+  ev_async_init (ap_lp->p_async_watcher, async_watcher_cback);
+  ap_lp->p_async_watcher->data = ap_lp;
+  ev_async_start (ap_lp->p_loop, ap_lp->p_async_watcher);
+
+  return OMX_ErrorNone;
+}
+
+static void
+start_loop_thread (tiz_event_loop_t * ap_lp)
+{
+  assert (ap_lp);
+  ap_lp->state = ETIZEventLoopStateStarted;
+  /* Create event loop thread */
+  tiz_thread_create (&(ap_lp->thread), 0, 0, event_loop_thread_func, ap_lp);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Loop [%u] now in ETIZEventLoopStateStarted...",
+           (unsigned) ap_lp->index);
+
+  (void) tiz_mutex_lock (&(ap_lp->mutex));
+  /* This is to prevent the event loop from exiting when there are no
+   * more active events */
+  ev_ref (ap_lp->p_loop);
+  (void) tiz_mutex_unlock (&(ap_lp->mutex));
+  tiz_sem_wait (&(ap_lp->sem));
 }
 
 static void
@@ -1091,8 +1214,11 @@ init_event_loop_thread (void)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
 
-  if (!gp_event_loop)
+  if (!gp_event_loop_pool)
     {
+      tiz_event_loop_pool_t * p_pool = NULL;
+      size_t i = 0;
+
       /* Let's return OOM error if something goes wrong */
       rc = OMX_ErrorInsufficientResources;
 
@@ -1103,77 +1229,74 @@ init_event_loop_thread (void)
       pthread_atfork (NULL, NULL, child_event_loop_reset);
 
       tiz_goto_end_on_null (
-        (gp_event_loop
-         = (tiz_event_loop_t *) tiz_mem_calloc (1, sizeof (tiz_event_loop_t))),
+        (p_pool = (tiz_event_loop_pool_t *) tiz_mem_calloc (
+           1, sizeof (tiz_event_loop_pool_t))),
         "Error allocating thread data struct.");
 
-      gp_event_loop->state = ETIZEventLoopStateStarting;
-
-      tiz_goto_end_on_omx_err (tiz_rcfile_init (&(gp_event_loop->p_rcfile)),
-                           "Error opening configuration file.");
-
-      tiz_goto_end_on_null ((gp_event_loop->p_loop = ev_loop_new (EVFLAG_AUTO)),
-                            "Error instantiating ev_loop.");
+      tiz_goto_end_on_omx_err (tiz_rcfile_init (&(p_pool->p_rcfile)),
+                               "Error opening configuration file.");
 
-      tiz_goto_end_on_null ((gp_event_loop->p_async_watcher
-                            = (ev_async *) tiz_mem_calloc (1, sizeof (ev_async))),
-                           "Error initializing async watcher.");
+      p_pool->nloops = configured_loop_count (p_pool->p_rcfile);
 
-      tiz_goto_end_on_omx_err (tiz_mutex_init (&(gp_event_loop->mutex)),
-                           "Error initializing mutex.");
-
-      tiz_goto_end_on_omx_err (tiz_sem_init (&(gp_event_loop->sem), 0),
-                           "Error initializing sem.");
-
-      /* Init the small object allocator */
-      tiz_goto_end_on_omx_err (tiz_soa_init (&(gp_event_loop->p_soa)),
-                           "Error initializing the small object allocator.");
+      tiz_goto_end_on_null (
+        (p_pool->p_loops = (tiz_event_loop_t *) tiz_mem_calloc (
+           p_pool->nloops, sizeof (tiz_event_loop_t))),
+        "Error allocating thread data structs.");
 
-      /* Init the priority queue */
-      tiz_goto_end_on_omx_err (
-        tiz_pqueue_init (&gp_event_loop->p_pq, 2, &pqueue_cmp,
-                         gp_event_loop->p_soa, TIZ_EVENT_LOOP_THREAD_NAME),
-        "Error initializing pqueue.");
+      for (i = 0; i < p_pool->nloops; ++i)
+        {
+          tiz_goto_end_on_omx_err (init_loop_data (&(p_pool->p_loops[i]), i),
+                                   "Error initializing event loop.");
+        }
 
       /* All good */
       rc = OMX_ErrorNone;
 
-      ev_async_init (gp_event_loop->p_async_watcher, async_watcher_cback);
-      ev_async_start (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
+    end:
 
-      assert (gp_event_loop);
+      if (OMX_ErrorNone == rc)
+        {
+          TIZ_LOG (TIZ_PRIORITY_DEBUG, "Starting [%u] event loop threads",
+                   (unsigned) p_pool->nloops);
+          for (i = 0; i < p_pool->nloops; ++i)
+            {
+              start_loop_thread (&(p_pool->p_loops[i]));
+            }
+          gp_event_loop_pool = p_pool;
+        }
+      else
+        {
+          clean_up_pool_data (p_pool);
+        }
     }
+}
+
+static inline tiz_event_loop_pool_t *
+get_event_loop (void)
+{
+  (void) pthread_once (&g_event_loop_once, init_event_loop_thread);
+  return gp_event_loop_pool;
+}
 
-end:
+static inline tiz_event_loop_t *
+get_affine_event_loop (const void * ap_affinity_key)
+{
+  tiz_event_loop_pool_t * p_pool = get_event_loop ();
+  size_t index = 0;
 
-  if (OMX_ErrorNone == rc)
+  if (!p_pool)
     {
-      tiz_event_loop_t * p_lp = gp_event_loop;
-      p_lp->state = ETIZEventLoopStateStarted;
-      /* Create event loop thread */
-      tiz_thread_create (&(p_lp->thread), 0, 0, event_loop_thread_func, p_lp);
-      TIZ_LOG (TIZ_PRIORITY_TRACE, "Now in ETIZEventLoopStateStarted state...");
-
-      (void) tiz_mutex_lock (&(p_lp->mutex));
-      /* This is to prevent the event loop from exiting when there are no
-       * more active events */
-      ev_ref (p_lp->p_loop);
-      (void) tiz_mutex_unlock (&(p_lp->mutex));
-      tiz_sem_wait (&(p_lp->sem));
+      return NULL;
     }
-  else
+
+  if (p_pool->nloops > 1)
     {
-      clean_up_thread_data (gp_event_loop);
-      tiz_mem_free (gp_event_loop);
-      gp_event_loop = NULL;
+      /* Fibonacci hashing of the key's address */
+      const uint64_t key = (uint64_t) (uintptr_t) ap_affinity_key;
+      index = (size_t) ((key * 11400714819323198485ull) >> 32) % p_pool->nloops;
     }
-}
 
-static inline tiz_event_loop_t *
-get_event_loop (void)
-{
-  (void) pthread_once (&g_event_loop_once, init_event_loop_thread);
-  return gp_event_loop;
+  return &(p_pool->p_loops[index]);
 }
 
 OMX_ERRORTYPE
@@ -1188,23 +1311,31 @@ tiz_event_loop_destroy (void)
   /* NOTE: If the thread is destroyed, it can't be recreated in the same
      process as it's been instantiated with pthread_once. */
 
-  if (gp_event_loop)
+  if (gp_event_loop_pool)
     {
-      (void) tiz_mutex_lock (&(gp_event_loop->mutex));
-      TIZ_LOG (TIZ_PRIORITY_TRACE, "destroying event loop thread [%p].",
-               gp_event_loop);
-      gp_event_loop->state = ETIZEventLoopStateStopping;
-      ev_unref (gp_event_loop->p_loop);
-      ev_async_send (gp_event_loop->p_loop, gp_event_loop->p_async_watcher);
-      (void) tiz_mutex_unlock (&(gp_event_loop->mutex));
-
-      {
-        OMX_PTR p_result = NULL;
-        tiz_thread_join (&(gp_event_loop->thread), &p_result);
-        clean_up_thread_data (gp_event_loop);
-        tiz_mem_free (gp_event_loop);
-        gp_event_loop = NULL;
-      }
+      tiz_event_loop_pool_t * p_pool = gp_event_loop_pool;
+      size_t i = 0;
+
+      for (i = 0; i < p_pool->nloops; ++i)
+        {
+          tiz_event_loop_t * p_lp = &(p_pool->p_loops[i]);
+          (void) tiz_mutex_lock (&(p_lp->mutex));
+          TIZ_LOG (TIZ_PRIORITY_TRACE, "destroying event loop thread [%u].",
+                   (unsigned) i);
+          p_lp->state = ETIZEventLoopStateStopping;
+          ev_unref (p_lp->p_loop);
+          ev_async_send (p_lp->p_loop, p_lp->p_async_watcher);
+          (void) tiz_mutex_unlock (&(p_lp->mutex));
+        }
+
+      for (i = 0; i < p_pool->nloops; ++i)
+        {
+          OMX_PTR p_result = NULL;
+          tiz_thread_join (&(p_pool->p_loops[i].thread), &p_result);
+        }
+
+      gp_event_loop_pool = NULL;
+      clean_up_pool_data (p_pool);
     }
 }
 
@@ -1218,10 +1349,11 @@ tiz_event_io_init (tiz_event_io_t ** app_ev_io, void * ap_arg0,
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   tiz_event_io_t * p_ev_io = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (app_ev_io);
   assert (ap_cback);
-  (void) get_event_loop ();
+  tiz_check_null_ret_oom ((p_lp = get_affine_event_loop (ap_arg0)) != NULL);
 
   if ((p_ev_io
        = (tiz_event_io_t *) tiz_mem_calloc (1, sizeof (tiz_event_io_t))))
@@ -1233,6 +1365,7 @@ tiz_event_io_init (tiz_event_io_t ** app_ev_io, void * ap_arg0,
       p_ev_io->id = 0;
       p_ev_io->fd = -1;
       p_ev_io->started = false;
+      p_ev_io->p_lp = p_lp;
       ev_init ((ev_io *) p_ev_io, io_watcher_cback);
       rc = OMX_ErrorNone;
     }
@@ -1298,10 +1431,11 @@ tiz_event_timer_init (tiz_event_timer_t ** app_ev_timer, void * ap_arg0,
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   tiz_event_timer_t * p_ev_timer = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (app_ev_timer);
   assert (ap_cback);
-  (void) get_event_loop ();
+  tiz_check_null_ret_oom ((p_lp = get_affine_event_loop (ap_arg0)) != NULL);
 
   if ((p_ev_timer
        = (tiz_event_timer_t *) tiz_mem_calloc (1, sizeof (tiz_event_timer_t))))
@@ -1312,6 +1446,7 @@ tiz_event_timer_init (tiz_event_timer_t ** app_ev_timer, void * ap_arg0,
       p_ev_timer->once = false;
       p_ev_timer->id = 0;
       p_ev_timer->started = false;
+      p_ev_timer->p_lp = p_lp;
       ev_init ((ev_timer *) p_ev_timer, timer_watcher_cback);
       rc = OMX_ErrorNone;
     }
@@ -1384,10 +1519,11 @@ tiz_event_stat_init (tiz_event_stat_t ** app_ev_stat, void * ap_arg0,
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   tiz_event_stat_t * p_ev_stat = NULL;
+  tiz_event_loop_t * p_lp = NULL;
 
   assert (app_ev_stat);
   assert (ap_cback);
-  (void) get_event_loop ();
+  tiz_check_null_ret_oom ((p_lp = get_affine_event_loop (ap_arg0)) != NULL);
 
   if ((p_ev_stat
        = (tiz_event_stat_t *) tiz_mem_calloc (1, sizeof (tiz_event_stat_t))))
@@ -1397,6 +1533,7 @@ tiz_event_stat_init (tiz_event_stat_t ** app_ev_stat, void * ap_arg0,
       p_ev_stat->p_arg1 = ap_arg1;
       p_ev_stat->id = 0;
       p_ev_stat->started = false;
+      p_ev_stat->p_lp = p_lp;
       ev_init ((ev_stat *) p_ev_stat, stat_watcher_cback);
       rc = OMX_ErrorNone;
     }
@@ -1445,7 +1582,6 @@ tiz_event_stat_destroy (tiz_event_stat_t * ap_ev_stat)
 tiz_rcfile_t *
 tiz_rcfile_get_handle (void)
 {
-  tiz_event_loop_t * p_event_loop = get_event_loop ();
-  return (p_event_loop && p_event_loop->p_rcfile) ? p_event_loop->p_rcfile
-                                                  : NULL;
+  tiz_event_loop_pool_t * p_pool = get_event_loop ();
+  return (p_pool && p_pool->p_rcfile) ? p_pool->p_rcfile : NULL;
 }
@@ -99,7 +99,10 @@ typedef enum tiz_event_io_event {
 /**
  * Explicit initialisation of the global event loop. The loop is hosted in
  * its own thread which is spawned the first time this function or any other
- * function in this module are called. Therefore it is not mandatory to call
+ * function in this module are called. The number of loop threads is read from
+ * the 'event-loop-threads' key in the 'ilcore' section of tizonia.conf (one
+ * by default); watchers are assigned to a loop thread according to their
+ * 'ap_arg0' argument (typically the component handle). Therefore it is not mandatory to call
  * this function in order to instantiate the global event loop. This is only
  * useful if for some reason the initialization cannot be done at the same
  * time as the first use.
@@ -31,10 +31,17 @@
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
 #include <unistd.h>
 #include <sys/syscall.h>
 #include <time.h>
@@ -45,8 +52,21 @@
 #include <log4c/appender_type_rollingfile.h>
 #include <log4c/rollingpolicy.h>
 
+#include "tizmacros.h"
 #include "tizlog.h"
 
+/* Longest message (after formatting) handed to log4c */
+#define LOG_MAX_MSG_LEN 4096
+/* Longest component name kept in an async record */
+#define LOG_MAX_CNAME_LEN 128
+/* Per-thread ring size when TIZONIA_LOG_ASYNC does not give one */
+#define LOG_DEFAULT_RING_SIZE (256 * 1024)
+#define LOG_MIN_RING_SIZE (16 * 1024)
+/* How long the writer thread lets records pile up between two passes */
+#define LOG_WRITER_NAP_NS (10 * 1000 * 1000)
+#define LOG_CAT_CACHE_SLOTS 8
+#define LOG_RECORD_ALIGN(len) (((len) + 7) & ~((size_t) 7))
+
 typedef struct user_locinfo user_locinfo_t;
 struct user_locinfo
 {
@@ -54,8 +74,81 @@ struct user_locinfo
   int tid;
   const char * cname;
   char * cbuf;
+  /* When the event was produced, if not when it reaches log4c */
+  const struct timeval * p_tv;
 };
 
+/* An async record: the message is formatted by the thread that logs it (its
+   arguments may not outlive the call), everything else is left to the writer
+   thread */
+typedef struct log_record log_record_t;
+struct log_record
+{
+  uint32_t size; /* Of the whole record; 0 means the rest of the ring is
+                    unused and the next record is at the start */
+  int priority;
+  int line;
+  int tid;
+  struct timeval tv;
+  const char * p_file;
+  const char * p_func;
+  const char * p_cat_name;
+  uint32_t cname_len; /* 0 when there is no component name */
+  uint32_t msg_len;
+  char data[]; /* cname\0msg\0 */
+};
+
+/* Single-producer, single-consumer byte ring, one per logging thread. head is
+   only written by the owner thread, tail by whoever holds g_rings_mutex */
+typedef struct log_ring log_ring_t;
+struct log_ring
+{
+  log_ring_t * p_next;
+  char * p_data;
+  size_t size;
+  size_t head;
+  size_t tail;
+  unsigned long dropped;
+  unsigned long dropped_reported;
+  int tid;
+};
+
+typedef struct log_cat_cache log_cat_cache_t;
+struct log_cat_cache
+{
+  const char * p_name;
+  const log4c_category_t * p_cat;
+  int priority;
+  unsigned int gen;
+};
+
+/* Kept on the heap: static TLS is carved out of the threads' stacks, and some
+   threads run with PTHREAD_STACK_MIN */
+typedef struct log_thread log_thread_t;
+struct log_thread
+{
+  int tid;
+  log_ring_t * p_ring;
+  log_cat_cache_t cat_cache[LOG_CAT_CACHE_SLOTS];
+};
+
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_thread_key;
+static pthread_mutex_t g_rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static log_ring_t * gp_rings = NULL;     /* Protected by g_rings_mutex */
+static unsigned long g_retired_dropped = 0; /* Protected by g_rings_mutex */
+static char g_async_cbuf[LOG_MAX_MSG_LEN];  /* Protected by g_rings_mutex */
+static bool g_async = false;
+static size_t g_ring_size = LOG_DEFAULT_RING_SIZE;
+static int g_evfd = -1;
+static int g_writer_sleeping = 0;
+static int g_writer_stop = 0;
+static pthread_t g_writer;
+static unsigned int g_gen = 1;
+static int g_pid = 0;
+
+static __thread log_thread_t * tp_thread = NULL;
+
 static const char *
 log_layout_format (const log4c_layout_t * a_layout,
                    const log4c_logging_event_t * a_event)
@@ -70,8 +163,10 @@ log_layout_format (const log4c_layout_t * a_layout,
   if (a_event->evt_loc->loc_data)
     {
       struct tm tm;
-      gmtime_r (&a_event->evt_timestamp.tv_sec, &tm);
+      const struct timeval * p_tv = NULL;
       uloc = (user_locinfo_t *) a_event->evt_loc->loc_data;
+      p_tv = uloc->p_tv ? uloc->p_tv : &a_event->evt_timestamp;
+      gmtime_r (&p_tv->tv_sec, &tm);
 
       if (NULL == uloc->cname)
         {
@@ -79,7 +174,7 @@ log_layout_format (const log4c_layout_t * a_layout,
                     "%02d-%02d-%04d %02d:%02d:%02d.%03ld - "
                     "[PID:%i][TID:%i] [%s] [%s] [%s:%s:%i] --- %s\n",
                     tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour,
-                    tm.tm_min, tm.tm_sec, a_event->evt_timestamp.tv_usec / 1000,
+                    tm.tm_min, tm.tm_sec, (long) p_tv->tv_usec / 1000,
                     uloc->pid, uloc->tid,
                     log4c_priority_to_string (a_event->evt_priority),
                     a_event->evt_category, a_event->evt_loc->loc_file,
@@ -94,7 +189,7 @@ log_layout_format (const log4c_layout_t * a_layout,
                     "%02d-%02d-%04d %02d:%02d:%02d.%03ld - "
                     "[PID:%i][TID:%i] [%s] [%s] [%s:%s:%i] --- %s\n",
                     tm.tm_mday, tm.tm_mon + 1, tm.tm_year + 1900, tm.tm_hour,
-                    tm.tm_min, tm.tm_sec, a_event->evt_timestamp.tv_usec / 1000,
+                    tm.tm_min, tm.tm_sec, (long) p_tv->tv_usec / 1000,
                     uloc->pid, uloc->tid,
                     log4c_priority_to_string (a_event->evt_priority),
                     uloc->cname, a_event->evt_loc->loc_file,
@@ -139,12 +234,444 @@ log_formatters_init (void)
   return rc;
 }
 
+#ifndef WITHOUT_LOG4C
+
+static void
+emit_record (const log_ring_t * ap_ring, const log_record_t * ap_rec)
+{
+  log4c_location_info_t locinfo;
+  user_locinfo_t user_locinfo;
+  const log4c_category_t * p_category = log4c_category_get (ap_rec->p_cat_name);
+
+  user_locinfo.pid = g_pid;
+  user_locinfo.tid = ap_rec->tid;
+  user_locinfo.cname = ap_rec->cname_len > 0 ? ap_rec->data : NULL;
+  user_locinfo.cbuf = g_async_cbuf;
+  user_locinfo.p_tv = &(ap_rec->tv);
+  locinfo.loc_file = ap_rec->p_file;
+  locinfo.loc_line = ap_rec->line;
+  locinfo.loc_function = ap_rec->p_func;
+  locinfo.loc_data = &user_locinfo;
+
+  log4c_category_log_locinfo (
+    p_category, &locinfo, ap_rec->priority, "%s",
+    ap_rec->data + (ap_rec->cname_len > 0 ? ap_rec->cname_len + 1 : 0));
+}
+
+static void
+report_dropped (log_ring_t * ap_ring)
+{
+  const unsigned long dropped
+    = __atomic_load_n (&(ap_ring->dropped), __ATOMIC_RELAXED);
+  if (dropped != ap_ring->dropped_reported)
+    {
+      log4c_location_info_t locinfo;
+      user_locinfo_t user_locinfo;
+      user_locinfo.pid = g_pid;
+      user_locinfo.tid = ap_ring->tid;
+      user_locinfo.cname = NULL;
+      user_locinfo.cbuf = NULL;
+      user_locinfo.p_tv = NULL;
+      locinfo.loc_file = __FILE__;
+      locinfo.loc_line = __LINE__;
+      locinfo.loc_function = __FUNCTION__;
+      locinfo.loc_data = &user_locinfo;
+      log4c_category_log_locinfo (
+        log4c_category_get (TIZ_LOG_CATEGORY_NAME), &locinfo,
+        LOG4C_PRIORITY_WARN, "%lu log records dropped (log ring full)",
+        dropped - ap_ring->dropped_reported);
+      ap_ring->dropped_reported = dropped;
+    }
+}
+
+/* Must be called with g_rings_mutex held */
+static size_t
+drain_ring (log_ring_t * ap_ring)
+{
+  const size_t head = __atomic_load_n (&(ap_ring->head), __ATOMIC_SEQ_CST);
+  size_t tail = ap_ring->tail;
+  size_t count = 0;
+
+  report_dropped (ap_ring);
+
+  while (tail != head)
+    {
+      const size_t pos = tail & (ap_ring->size - 1);
+      const log_record_t * p_rec
+        = (const log_record_t *) (ap_ring->p_data + pos);
+      if (0 == p_rec->size)
+        {
+          tail += ap_ring->size - pos;
+          continue;
+        }
+      emit_record (ap_ring, p_rec);
+      tail += p_rec->size;
+      ++count;
+    }
+
+  __atomic_store_n (&(ap_ring->tail), tail, __ATOMIC_RELEASE);
+  return count;
+}
+
+/* Must be called with g_rings_mutex held */
+static size_t
+drain_all_rings (void)
+{
+  log_ring_t * p_ring = gp_rings;
+  size_t count = 0;
+  for (; p_ring; p_ring = p_ring->p_next)
+    {
+      count += drain_ring (p_ring);
+    }
+  return count;
+}
+
+static void
+retire_ring (void * ap_ring)
+{
+  log_ring_t * p_ring = ap_ring;
+  log_ring_t ** pp_ring = NULL;
+
+  (void) pthread_mutex_lock (&g_rings_mutex);
+  if (__atomic_load_n (&g_async, __ATOMIC_ACQUIRE))
+    {
+      (void) drain_ring (p_ring);
+    }
+  g_retired_dropped += p_ring->dropped;
+  for (pp_ring = &gp_rings; *pp_ring; pp_ring = &((*pp_ring)->p_next))
+    {
+      if (*pp_ring == p_ring)
+        {
+          *pp_ring = p_ring->p_next;
+          break;
+        }
+    }
+  (void) pthread_mutex_unlock (&g_rings_mutex);
+
+  free (p_ring->p_data);
+  free (p_ring);
+}
+
+static void
+retire_thread (void * ap_thread)
+{
+  log_thread_t * p_thread = ap_thread;
+  if (p_thread->p_ring)
+    {
+      retire_ring (p_thread->p_ring);
+    }
+  /* This runs on the exiting thread; other key destructors may still log */
+  tp_thread = NULL;
+  free (p_thread);
+}
+
+static void
+reset_after_fork (void)
+{
+  /* The writer thread does not exist in the child */
+  g_async = false;
+  g_pid = getpid ();
+  if (tp_thread)
+    {
+      tp_thread->tid = syscall (SYS_gettid);
+    }
+}
+
+static void
+create_thread_key (void)
+{
+  (void) pthread_key_create (&g_thread_key, retire_thread);
+  (void) pthread_atfork (NULL, NULL, reset_after_fork);
+}
+
+static log_thread_t *
+this_thread (void)
+{
+  if (!tp_thread)
+    {
+      log_thread_t * p_thread = calloc (1, sizeof (log_thread_t));
+      if (p_thread)
+        {
+          p_thread->tid = syscall (SYS_gettid);
+          (void) pthread_once (&g_once, create_thread_key);
+          (void) pthread_setspecific (g_thread_key, p_thread);
+          tp_thread = p_thread;
+        }
+    }
+  return tp_thread;
+}
+
+/* log4c_category_get is a name lookup; the category and its chained priority
+   are cached per thread, keyed by the address of the name, until the next
+   tiz_log_init/tiz_log_deinit */
+static log_cat_cache_t *
+lookup_category (log_thread_t * ap_thread, const char * ap_cat_name)
+{
+  log_cat_cache_t * p_slot
+    = &(ap_thread->cat_cache[((uintptr_t) ap_cat_name >> 3)
+                             % LOG_CAT_CACHE_SLOTS]);
+  const unsigned int gen = __atomic_load_n (&g_gen, __ATOMIC_RELAXED);
+  if (p_slot->p_name != ap_cat_name || p_slot->gen != gen)
+    {
+      p_slot->p_cat = log4c_category_get (ap_cat_name);
+      p_slot->priority = log4c_category_get_chainedpriority (p_slot->p_cat);
+      p_slot->p_name = ap_cat_name;
+      p_slot->gen = gen;
+    }
+  return p_slot;
+}
+
+static log_ring_t *
+thread_ring (log_thread_t * ap_thread)
+{
+  if (!ap_thread->p_ring)
+    {
+      log_ring_t * p_ring = calloc (1, sizeof (log_ring_t));
+      if (!p_ring)
+        {
+          return NULL;
+        }
+      p_ring->size = g_ring_size;
+      p_ring->tid = ap_thread->tid;
+      if (!(p_ring->p_data = malloc (p_ring->size)))
+        {
+          free (p_ring);
+          return NULL;
+        }
+      (void) pthread_mutex_lock (&g_rings_mutex);
+      p_ring->p_next = gp_rings;
+      gp_rings = p_ring;
+      (void) pthread_mutex_unlock (&g_rings_mutex);
+      ap_thread->p_ring = p_ring;
+    }
+  return ap_thread->p_ring;
+}
+
+static void
+wake_writer (void)
+{
+  /* Only the first record after the writer went to sleep costs a syscall */
+  if (__atomic_load_n (&g_writer_sleeping, __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n (&g_writer_sleeping, 0, __ATOMIC_SEQ_CST))
+    {
+      const uint64_t one = 1;
+      (void) !write (g_evfd, &one, sizeof (one));
+    }
+}
+
+/* Not inlined, so that the stack of tiz_log stays small when the priority is
+   disabled; some threads run with PTHREAD_STACK_MIN */
+static void __attribute__ ((noinline))
+enqueue_record (log_thread_t * ap_thread, const char * ap_file, int a_line, const char * ap_func,
+                const char * ap_cat_name, int a_priority,
+                const char * ap_cname, const char * ap_format, va_list a_va)
+{
+  char msg[LOG_MAX_MSG_LEN];
+  log_ring_t * p_ring = thread_ring (ap_thread);
+  log_record_t * p_rec = NULL;
+  size_t cname_len = 0;
+  size_t msg_len = 0;
+  size_t need = 0;
+  size_t pos = 0;
+  size_t head = 0;
+  size_t free_space = 0;
+  int len = 0;
+
+  if (!p_ring)
+    {
+      return;
+    }
+
+  len = vsnprintf (msg, sizeof (msg), ap_format, a_va);
+  msg_len = len < 0 ? 0 : MIN ((size_t) len, sizeof (msg) - 1);
+  cname_len = ap_cname ? strnlen (ap_cname, LOG_MAX_CNAME_LEN - 1) : 0;
+  need = LOG_RECORD_ALIGN (sizeof (log_record_t)
+                           + (cname_len > 0 ? cname_len + 1 : 0) + msg_len
+                           + 1);
+
+  head = p_ring->head;
+  pos = head & (p_ring->size - 1);
+  free_space = p_ring->size
+               - (head - __atomic_load_n (&(p_ring->tail), __ATOMIC_ACQUIRE));
+  /* Records never wrap around; skip what is left at the end of the ring */
+  if (p_ring->size - pos < need
+      && free_space >= (p_ring->size - pos) + need)
+    {
+      ((log_record_t *) (p_ring->p_data + pos))->size = 0;
+      free_space -= p_ring->size - pos;
+      head += p_ring->size - pos;
+      pos = 0;
+    }
+
+  if (p_ring->size - pos < need || free_space < need)
+    {
+      (void) __atomic_add_fetch (&(p_ring->dropped), 1, __ATOMIC_RELAXED);
+      wake_writer ();
+      return;
+    }
+
+  p_rec = (log_record_t *) (p_ring->p_data + pos);
+  p_rec->size = need;
+  p_rec->priority = a_priority;
+  p_rec->line = a_line;
+  p_rec->tid = p_ring->tid;
+  (void) gettimeofday (&(p_rec->tv), NULL);
+  p_rec->p_file = ap_file;
+  p_rec->p_func = ap_func;
+  p_rec->p_cat_name = ap_cat_name;
+  p_rec->cname_len = cname_len;
+  p_rec->msg_len = msg_len;
+  if (cname_len > 0)
+    {
+      memcpy (p_rec->data, ap_cname, cname_len);
+      p_rec->data[cname_len] = '\0';
+      memcpy (p_rec->data + cname_len + 1, msg, msg_len);
+      p_rec->data[cname_len + 1 + msg_len] = '\0';
+    }
+  else
+    {
+      memcpy (p_rec->data, msg, msg_len);
+      p_rec->data[msg_len] = '\0';
+    }
+
+  __atomic_store_n (&(p_ring->head), head + need, __ATOMIC_SEQ_CST);
+  wake_writer ();
+}
+
+static void *
+log_writer_thread_func (void * ap_arg)
+{
+  const struct timespec nap = {0, LOG_WRITER_NAP_NS};
+  struct pollfd pfd;
+  (void) ap_arg;
+
+  pfd.fd = g_evfd;
+  pfd.events = POLLIN;
+
+  while (!__atomic_load_n (&g_writer_stop, __ATOMIC_ACQUIRE))
+    {
+      size_t count = 0;
+      uint64_t val = 0;
+
+      (void) pthread_mutex_lock (&g_rings_mutex);
+      count = drain_all_rings ();
+      (void) pthread_mutex_unlock (&g_rings_mutex);
+
+      if (count > 0)
+        {
+          /* Let the next records accumulate instead of waking up for each */
+          (void) nanosleep (&nap, NULL);
+          continue;
+        }
+
+      __atomic_store_n (&g_writer_sleeping, 1, __ATOMIC_SEQ_CST);
+      (void) pthread_mutex_lock (&g_rings_mutex);
+      count = drain_all_rings ();
+      (void) pthread_mutex_unlock (&g_rings_mutex);
+      if (0 == count)
+        {
+          while (poll (&pfd, 1, -1) < 0 && EINTR == errno)
+            {
+            }
+          (void) !read (g_evfd, &val, sizeof (val));
+        }
+      __atomic_store_n (&g_writer_sleeping, 0, __ATOMIC_SEQ_CST);
+    }
+
+  (void) pthread_mutex_lock (&g_rings_mutex);
+  (void) drain_all_rings ();
+  (void) pthread_mutex_unlock (&g_rings_mutex);
+
+  return NULL;
+}
+
+static size_t
+async_ring_size (void)
+{
+  const char * p_env = getenv ("TIZONIA_LOG_ASYNC");
+  size_t size = LOG_DEFAULT_RING_SIZE;
+  size_t pow2 = LOG_MIN_RING_SIZE;
+  char * p_end = NULL;
+  unsigned long kb = 0;
+
+  if (!p_env || 0 == strcmp (p_env, "0") || 0 == strcmp (p_env, "false"))
+    {
+      return 0;
+    }
+
+  kb = strtoul (p_env, &p_end, 10);
+  if (p_end != p_env && '\0' == *p_end && kb > 1)
+    {
+      size = kb * 1024;
+    }
+  while (pow2 < size)
+    {
+      pow2 <<= 1;
+    }
+  return pow2;
+}
+
+static void
+start_async (void)
+{
+  size_t ring_size = 0;
+
+  (void) pthread_once (&g_once, create_thread_key);
+  g_pid = getpid ();
+
+  if (0 == (ring_size = async_ring_size ()))
+    {
+      return;
+    }
+
+  g_ring_size = ring_size;
+  g_writer_stop = 0;
+  g_writer_sleeping = 0;
+  if ((g_evfd = eventfd (0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+    {
+      return;
+    }
+
+  if (0 != pthread_create (&g_writer, NULL, log_writer_thread_func, NULL))
+    {
+      close (g_evfd);
+      g_evfd = -1;
+      return;
+    }
+  (void) pthread_setname_np (g_writer, "tizlog");
+  __atomic_store_n (&g_async, true, __ATOMIC_RELEASE);
+}
+
+static void
+stop_async (void)
+{
+  const uint64_t one = 1;
+
+  if (!__atomic_load_n (&g_async, __ATOMIC_ACQUIRE))
+    {
+      return;
+    }
+
+  __atomic_store_n (&g_async, false, __ATOMIC_RELEASE);
+  __atomic_store_n (&g_writer_stop, 1, __ATOMIC_RELEASE);
+  (void) !write (g_evfd, &one, sizeof (one));
+  (void) pthread_join (g_writer, NULL);
+  close (g_evfd);
+  g_evfd = -1;
+}
+
+#endif
+
 int
 tiz_log_init (void)
 {
 #ifndef WITHOUT_LOG4C
+  int rc = 0;
   log_formatters_init ();
-  return log4c_init ();
+  rc = log4c_init ();
+  (void) __atomic_add_fetch (&g_gen, 1, __ATOMIC_RELAXED);
+  start_async ();
+  return rc;
 #else
   return 0;
 #endif
@@ -197,41 +724,91 @@ int
 tiz_log_deinit (void)
 {
 #ifndef WITHOUT_LOG4C
+  stop_async ();
+  (void) __atomic_add_fetch (&g_gen, 1, __ATOMIC_RELAXED);
   return log4c_fini ();
 #else
   return 0;
 #endif
 }
 
+void
+tiz_log_flush (void)
+{
+#ifndef WITHOUT_LOG4C
+  if (__atomic_load_n (&g_async, __ATOMIC_ACQUIRE))
+    {
+      (void) pthread_mutex_lock (&g_rings_mutex);
+      (void) drain_all_rings ();
+      (void) pthread_mutex_unlock (&g_rings_mutex);
+    }
+#endif
+}
+
+unsigned long
+tiz_log_dropped (void)
+{
+  unsigned long dropped = 0;
+#ifndef WITHOUT_LOG4C
+  log_ring_t * p_ring = NULL;
+  (void) pthread_mutex_lock (&g_rings_mutex);
+  dropped = g_retired_dropped;
+  for (p_ring = gp_rings; p_ring; p_ring = p_ring->p_next)
+    {
+      dropped += __atomic_load_n (&(p_ring->dropped), __ATOMIC_RELAXED);
+    }
+  (void) pthread_mutex_unlock (&g_rings_mutex);
+#endif
+  return dropped;
+}
+
 void
 tiz_log (const char * ap_file, int a_line, const char * ap_func,
          const char * ap_cat_name, int a_priority, const char * ap_cname,
          char * ap_cbuf, const char * ap_format, ...)
 {
 #ifndef WITHOUT_LOG4C
-  log4c_location_info_t locinfo;
-  user_locinfo_t user_locinfo;
+  log_thread_t * p_thread = this_thread ();
+  const log_cat_cache_t * p_cat = NULL;
+  if (!p_thread)
+    {
+      return;
+    }
+
+  p_cat = lookup_category (p_thread, ap_cat_name);
+  if (a_priority > p_cat->priority)
+    {
+      return;
+    }
 
-  const log4c_category_t * p_category = log4c_category_get (ap_cat_name);
-  if (log4c_category_is_priority_enabled (p_category, a_priority))
+  if (__atomic_load_n (&g_async, __ATOMIC_ACQUIRE))
+    {
+      va_list va;
+      va_start (va, ap_format);
+      enqueue_record (p_thread, ap_file, a_line, ap_func, ap_cat_name,
+                      a_priority, ap_cname, ap_format, va);
+      va_end (va);
+    }
+  else
     {
-      /* TODO: 4096 - this value should be obtained at config time */
-      char * buffer = alloca (4096);
+      log4c_location_info_t locinfo;
+      user_locinfo_t user_locinfo;
+      char * buffer = alloca (LOG_MAX_MSG_LEN);
       user_locinfo.pid = getpid ();
-      user_locinfo.tid = syscall (SYS_gettid);
+      user_locinfo.tid = p_thread->tid;
       user_locinfo.cname = ap_cname;
       user_locinfo.cbuf = ap_cbuf;
+      user_locinfo.p_tv = NULL;
       locinfo.loc_file = ap_file;
       locinfo.loc_line = a_line;
       locinfo.loc_function = ap_func;
-      /*          locinfo.loc_data = NULL; */
       locinfo.loc_data = &user_locinfo;
 
       va_list va;
       va_start (va, ap_format);
-      vsprintf (buffer, ap_format, va);
+      vsnprintf (buffer, LOG_MAX_MSG_LEN, ap_format, va);
       va_end (va);
-      log4c_category_log_locinfo (p_category, &locinfo, a_priority, "%s",
+      log4c_category_log_locinfo (p_cat->p_cat, &locinfo, a_priority, "%s",
                                   buffer);
     }
 #else
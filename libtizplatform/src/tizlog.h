@@ -66,6 +66,15 @@ tiz_log_set_unique_rolling_file (const char * ap_logdir,
                                  const char * ap_file_prefix);
 int
 tiz_log_deinit (void);
+/* With TIZONIA_LOG_ASYNC set in the environment (to "1", or to the size in
+   KiB of the per-thread rings) when tiz_log_init is called, tiz_log only
+   formats the message into a ring owned by the calling thread, and a
+   background thread hands the records to log4c. Records that do not fit in a
+   full ring are dropped and counted. */
+void
+tiz_log_flush (void);
+unsigned long
+tiz_log_dropped (void);
 void
 tiz_log (const char * __p_file, int __line, const char * __p_func,
          const char * __p_cat_name, int __priority,
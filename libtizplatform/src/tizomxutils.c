@@ -653,6 +653,18 @@ static const tiz_idx_str_t tiz_idx_to_str_tbl[] = {
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioDeezerSession"},
   {OMX_TizoniaIndexParamAudioDeezerPlaylist,
    (const OMX_STRING) "OMX_TizoniaIndexParamAudioDeezerPlaylist"},
+  {OMX_TizoniaIndexConfigHttpMountpointStats,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigHttpMountpointStats"},
+  {OMX_TizoniaIndexConfigFileReaderMode,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigFileReaderMode"},
+  {OMX_TizoniaIndexConfigFileWriterMode,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigFileWriterMode"},
+  {OMX_TizoniaIndexConfigFileWriterStats,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigFileWriterStats"},
+  {OMX_TizoniaIndexConfigMediaDuration,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigMediaDuration"},
+  {OMX_TizoniaIndexConfigBufferBatch,
+   (const OMX_STRING) "OMX_TizoniaIndexConfigBufferBatch"},
   {OMX_IndexKhronosExtensions, (const OMX_STRING) "OMX_IndexKhronosExtensions"},
   {OMX_IndexVendorStartUnused, (const OMX_STRING) "OMX_IndexVendorStartUnused"},
   {OMX_IndexMax, (const OMX_STRING) "OMX_IndexMax"}};
@@ -0,0 +1,1171 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcm.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - PCM sample format conversion
+ *
+ * The samples are converted in chunks that fit in L1. Planar input is first
+ * interleaved into a scratch area kept in the converter (the component
+ * threads run on small stacks), and the interleaved chunk is then requantized
+ * straight into the destination.
+ *
+ * The 16-bit output paths (round to nearest and TPDF dither), the stereo
+ * interleaving and the in-place gain have SIMD kernels; everything else,
+ * including noise shaping (which is sequential by nature), goes through the
+ * generic C path.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+#include "tizmem.h"
+#include "tizlog.h"
+#include "tizmacros.h"
+#include "tizpcm.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.pcm"
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIZ_PCM_X86 1
+#include <immintrin.h>
+#define TIZ_PCM_SSE2 __attribute__ ((target ("sse2")))
+#define TIZ_PCM_AVX2 __attribute__ ((target ("avx2")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TIZ_PCM_NEON 1
+#include <arm_neon.h>
+#endif
+
+/* Samples converted per pass */
+#define TIZ_PCM_CHUNK 512
+#define TIZ_PCM_SHAPER_TAPS 5
+#define TIZ_PCM_RNG_LANES 8
+
+/* Error feedback coefficients of Lipshitz's 5-tap E-weighted noise shaping
+   filter */
+static const double shaper_coefs[TIZ_PCM_SHAPER_TAPS]
+  = {2.033, -2.165, 1.959, -1.590, 0.6149};
+
+typedef struct pcm_kernels pcm_kernels_t;
+struct pcm_kernels
+{
+  const char * p_name;
+  void (*pf_interleave2) (const uint32_t * ap_l, const uint32_t * ap_r,
+                          uint32_t * ap_dst, size_t a_nframes);
+  void (*pf_fixed_to_s16) (const int32_t * ap_src, int16_t * ap_dst,
+                           size_t a_count, int a_shift);
+  void (*pf_float_to_s16) (const float * ap_src, int16_t * ap_dst,
+                           size_t a_count);
+  void (*pf_tpdf_to_s16) (const void * ap_src, bool a_fixed, float a_scale,
+                          int16_t * ap_dst, size_t a_count, uint32_t * ap_rng);
+  void (*pf_bswap16) (int16_t * ap_data, size_t a_count);
+  void (*pf_gain_s16) (int16_t * ap_data, size_t a_count, float a_gain);
+  void (*pf_gain_float) (float * ap_data, size_t a_count, float a_gain);
+};
+
+struct tiz_pcm_conv
+{
+  tiz_pcm_in_fmt_t in_fmt;
+  tiz_pcm_out_fmt_t out_fmt;
+  tiz_pcm_dither_t dither;
+  OMX_U32 fracbits;
+  OMX_U32 nchannels;
+  size_t sample_size;
+  size_t chunk_frames;
+  bool swap;     /* output byte order differs from the host's */
+  bool s16_simd; /* the 16-bit kernels can be used */
+  double scale;  /* input to output LSB units */
+  double min;
+  double max;
+  uint32_t rng[TIZ_PCM_RNG_LANES];
+  double * p_err; /* noise shaper history, TIZ_PCM_SHAPER_TAPS per channel */
+  uint32_t scratch[TIZ_PCM_CHUNK];
+};
+
+static pcm_kernels_t g_kernels;
+static pthread_once_t g_kernels_once = PTHREAD_ONCE_INIT;
+
+/*
+ * Plain C kernels
+ */
+
+static inline int16_t
+clip_s16 (const int32_t a_val)
+{
+  return a_val > INT16_MAX ? INT16_MAX
+                           : (a_val < INT16_MIN ? INT16_MIN : (int16_t) a_val);
+}
+
+static inline int32_t
+round_float (const float a_val)
+{
+  return (int32_t) (a_val >= 0.f ? a_val + 0.5f : a_val - 0.5f);
+}
+
+static inline uint32_t
+xorshift32 (uint32_t * ap_state)
+{
+  uint32_t x = *ap_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *ap_state = x;
+  return x;
+}
+
+/* Triangular PDF noise in (-1, 1), as the difference of two 16-bit uniform
+   random numbers */
+static inline float
+tpdf_noise (uint32_t * ap_state)
+{
+  const uint32_t r = xorshift32 (ap_state);
+  return (float) ((int32_t) (r >> 16) - (int32_t) (r & 0xffff))
+         * (1.f / 65536.f);
+}
+
+static void
+c_interleave2 (const uint32_t * ap_l, const uint32_t * ap_r, uint32_t * ap_dst,
+               size_t a_nframes)
+{
+  size_t i = 0;
+  for (i = 0; i < a_nframes; ++i)
+    {
+      ap_dst[2 * i] = ap_l[i];
+      ap_dst[2 * i + 1] = ap_r[i];
+    }
+}
+
+static void
+c_fixed_to_s16 (const int32_t * ap_src, int16_t * ap_dst, size_t a_count,
+                int a_shift)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      ap_dst[i] = clip_s16 (((ap_src[i] >> a_shift) + 1) >> 1);
+    }
+}
+
+static void
+c_float_to_s16 (const float * ap_src, int16_t * ap_dst, size_t a_count)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      float v = ap_src[i] * 32768.f;
+      v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+      ap_dst[i] = (int16_t) round_float (v);
+    }
+}
+
+static void
+c_tpdf_to_s16 (const void * ap_src, bool a_fixed, float a_scale,
+               int16_t * ap_dst, size_t a_count, uint32_t * ap_rng)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      float v = (a_fixed ? (float) ((const int32_t *) ap_src)[i]
+                         : ((const float *) ap_src)[i])
+                  * a_scale
+                + tpdf_noise (ap_rng);
+      v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+      ap_dst[i] = (int16_t) round_float (v);
+    }
+}
+
+static void
+c_bswap16 (int16_t * ap_data, size_t a_count)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      const uint16_t v = (uint16_t) ap_data[i];
+      ap_data[i] = (int16_t) ((v << 8) | (v >> 8));
+    }
+}
+
+static void
+c_gain_s16 (int16_t * ap_data, size_t a_count, float a_gain)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      float v = ap_data[i] * a_gain;
+      v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+      ap_data[i] = (int16_t) round_float (v);
+    }
+}
+
+static void
+c_gain_float (float * ap_data, size_t a_count, float a_gain)
+{
+  size_t i = 0;
+  for (i = 0; i < a_count; ++i)
+    {
+      ap_data[i] *= a_gain;
+    }
+}
+
+#ifdef TIZ_PCM_X86
+
+/*
+ * SSE2 kernels
+ */
+
+TIZ_PCM_SSE2 static void
+sse2_interleave2 (const uint32_t * ap_l, const uint32_t * ap_r,
+                  uint32_t * ap_dst, size_t a_nframes)
+{
+  size_t i = 0;
+  for (; i + 4 <= a_nframes; i += 4)
+    {
+      const __m128i l = _mm_loadu_si128 ((const __m128i *) (ap_l + i));
+      const __m128i r = _mm_loadu_si128 ((const __m128i *) (ap_r + i));
+      _mm_storeu_si128 ((__m128i *) (ap_dst + 2 * i),
+                        _mm_unpacklo_epi32 (l, r));
+      _mm_storeu_si128 ((__m128i *) (ap_dst + 2 * i + 4),
+                        _mm_unpackhi_epi32 (l, r));
+    }
+  c_interleave2 (ap_l + i, ap_r + i, ap_dst + 2 * i, a_nframes - i);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_fixed_to_s16 (const int32_t * ap_src, int16_t * ap_dst, size_t a_count,
+                   int a_shift)
+{
+  const __m128i shift = _mm_cvtsi32_si128 (a_shift);
+  const __m128i one = _mm_set1_epi32 (1);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *) (ap_src + i));
+      __m128i b = _mm_loadu_si128 ((const __m128i *) (ap_src + i + 4));
+      a = _mm_srai_epi32 (_mm_add_epi32 (_mm_sra_epi32 (a, shift), one), 1);
+      b = _mm_srai_epi32 (_mm_add_epi32 (_mm_sra_epi32 (b, shift), one), 1);
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i), _mm_packs_epi32 (a, b));
+    }
+  c_fixed_to_s16 (ap_src + i, ap_dst + i, a_count - i, a_shift);
+}
+
+TIZ_PCM_SSE2 static inline __m128i
+sse2_quantize (__m128 a_val)
+{
+  a_val = _mm_min_ps (a_val, _mm_set1_ps (32767.f));
+  a_val = _mm_max_ps (a_val, _mm_set1_ps (-32768.f));
+  return _mm_cvtps_epi32 (a_val);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_float_to_s16 (const float * ap_src, int16_t * ap_dst, size_t a_count)
+{
+  const __m128 scale = _mm_set1_ps (32768.f);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const __m128i a
+        = sse2_quantize (_mm_mul_ps (_mm_loadu_ps (ap_src + i), scale));
+      const __m128i b
+        = sse2_quantize (_mm_mul_ps (_mm_loadu_ps (ap_src + i + 4), scale));
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i), _mm_packs_epi32 (a, b));
+    }
+  c_float_to_s16 (ap_src + i, ap_dst + i, a_count - i);
+}
+
+TIZ_PCM_SSE2 static inline __m128
+sse2_tpdf_noise (__m128i * ap_state)
+{
+  __m128i x = *ap_state;
+  x = _mm_xor_si128 (x, _mm_slli_epi32 (x, 13));
+  x = _mm_xor_si128 (x, _mm_srli_epi32 (x, 17));
+  x = _mm_xor_si128 (x, _mm_slli_epi32 (x, 5));
+  *ap_state = x;
+  return _mm_mul_ps (
+    _mm_cvtepi32_ps (_mm_sub_epi32 (
+      _mm_srli_epi32 (x, 16), _mm_and_si128 (x, _mm_set1_epi32 (0xffff)))),
+    _mm_set1_ps (1.f / 65536.f));
+}
+
+TIZ_PCM_SSE2 static inline __m128
+sse2_load (const void * ap_src, bool a_fixed, size_t a_idx)
+{
+  return a_fixed ? _mm_cvtepi32_ps (_mm_loadu_si128 (
+                     (const __m128i *) ((const int32_t *) ap_src + a_idx)))
+                 : _mm_loadu_ps ((const float *) ap_src + a_idx);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_tpdf_to_s16 (const void * ap_src, bool a_fixed, float a_scale,
+                  int16_t * ap_dst, size_t a_count, uint32_t * ap_rng)
+{
+  const __m128 scale = _mm_set1_ps (a_scale);
+  __m128i state = _mm_loadu_si128 ((const __m128i *) ap_rng);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const __m128i a = sse2_quantize (_mm_add_ps (
+        _mm_mul_ps (sse2_load (ap_src, a_fixed, i), scale),
+        sse2_tpdf_noise (&state)));
+      const __m128i b = sse2_quantize (_mm_add_ps (
+        _mm_mul_ps (sse2_load (ap_src, a_fixed, i + 4), scale),
+        sse2_tpdf_noise (&state)));
+      _mm_storeu_si128 ((__m128i *) (ap_dst + i), _mm_packs_epi32 (a, b));
+    }
+  _mm_storeu_si128 ((__m128i *) ap_rng, state);
+  c_tpdf_to_s16 (a_fixed ? (const void *) ((const int32_t *) ap_src + i)
+                         : (const void *) ((const float *) ap_src + i),
+                 a_fixed, a_scale, ap_dst + i, a_count - i, ap_rng);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_bswap16 (int16_t * ap_data, size_t a_count)
+{
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const __m128i v = _mm_loadu_si128 ((const __m128i *) (ap_data + i));
+      _mm_storeu_si128 (
+        (__m128i *) (ap_data + i),
+        _mm_or_si128 (_mm_slli_epi16 (v, 8), _mm_srli_epi16 (v, 8)));
+    }
+  c_bswap16 (ap_data + i, a_count - i);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_gain_s16 (int16_t * ap_data, size_t a_count, float a_gain)
+{
+  const __m128 gain = _mm_set1_ps (a_gain);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const __m128i v = _mm_loadu_si128 ((const __m128i *) (ap_data + i));
+      const __m128i lo = _mm_srai_epi32 (_mm_unpacklo_epi16 (v, v), 16);
+      const __m128i hi = _mm_srai_epi32 (_mm_unpackhi_epi16 (v, v), 16);
+      const __m128i a = sse2_quantize (_mm_mul_ps (_mm_cvtepi32_ps (lo), gain));
+      const __m128i b = sse2_quantize (_mm_mul_ps (_mm_cvtepi32_ps (hi), gain));
+      _mm_storeu_si128 ((__m128i *) (ap_data + i), _mm_packs_epi32 (a, b));
+    }
+  c_gain_s16 (ap_data + i, a_count - i, a_gain);
+}
+
+TIZ_PCM_SSE2 static void
+sse2_gain_float (float * ap_data, size_t a_count, float a_gain)
+{
+  const __m128 gain = _mm_set1_ps (a_gain);
+  size_t i = 0;
+  for (; i + 4 <= a_count; i += 4)
+    {
+      _mm_storeu_ps (ap_data + i,
+                     _mm_mul_ps (_mm_loadu_ps (ap_data + i), gain));
+    }
+  c_gain_float (ap_data + i, a_count - i, a_gain);
+}
+
+/*
+ * AVX2 kernels
+ */
+
+TIZ_PCM_AVX2 static void
+avx2_interleave2 (const uint32_t * ap_l, const uint32_t * ap_r,
+                  uint32_t * ap_dst, size_t a_nframes)
+{
+  size_t i = 0;
+  for (; i + 8 <= a_nframes; i += 8)
+    {
+      const __m256i l = _mm256_loadu_si256 ((const __m256i *) (ap_l + i));
+      const __m256i r = _mm256_loadu_si256 ((const __m256i *) (ap_r + i));
+      const __m256i lo = _mm256_unpacklo_epi32 (l, r);
+      const __m256i hi = _mm256_unpackhi_epi32 (l, r);
+      _mm256_storeu_si256 ((__m256i *) (ap_dst + 2 * i),
+                           _mm256_permute2x128_si256 (lo, hi, 0x20));
+      _mm256_storeu_si256 ((__m256i *) (ap_dst + 2 * i + 8),
+                           _mm256_permute2x128_si256 (lo, hi, 0x31));
+    }
+  c_interleave2 (ap_l + i, ap_r + i, ap_dst + 2 * i, a_nframes - i);
+}
+
+/* _mm256_packs_epi32 works within 128-bit lanes; this puts the result back
+   in order */
+TIZ_PCM_AVX2 static inline __m256i
+avx2_packs (const __m256i a, const __m256i b)
+{
+  return _mm256_permute4x64_epi64 (_mm256_packs_epi32 (a, b), 0xd8);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_fixed_to_s16 (const int32_t * ap_src, int16_t * ap_dst, size_t a_count,
+                   int a_shift)
+{
+  const __m128i shift = _mm_cvtsi32_si128 (a_shift);
+  const __m256i one = _mm256_set1_epi32 (1);
+  size_t i = 0;
+  for (; i + 16 <= a_count; i += 16)
+    {
+      __m256i a = _mm256_loadu_si256 ((const __m256i *) (ap_src + i));
+      __m256i b = _mm256_loadu_si256 ((const __m256i *) (ap_src + i + 8));
+      a = _mm256_srai_epi32 (
+        _mm256_add_epi32 (_mm256_sra_epi32 (a, shift), one), 1);
+      b = _mm256_srai_epi32 (
+        _mm256_add_epi32 (_mm256_sra_epi32 (b, shift), one), 1);
+      _mm256_storeu_si256 ((__m256i *) (ap_dst + i), avx2_packs (a, b));
+    }
+  c_fixed_to_s16 (ap_src + i, ap_dst + i, a_count - i, a_shift);
+}
+
+TIZ_PCM_AVX2 static inline __m256i
+avx2_quantize (__m256 a_val)
+{
+  a_val = _mm256_min_ps (a_val, _mm256_set1_ps (32767.f));
+  a_val = _mm256_max_ps (a_val, _mm256_set1_ps (-32768.f));
+  return _mm256_cvtps_epi32 (a_val);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_float_to_s16 (const float * ap_src, int16_t * ap_dst, size_t a_count)
+{
+  const __m256 scale = _mm256_set1_ps (32768.f);
+  size_t i = 0;
+  for (; i + 16 <= a_count; i += 16)
+    {
+      const __m256i a
+        = avx2_quantize (_mm256_mul_ps (_mm256_loadu_ps (ap_src + i), scale));
+      const __m256i b = avx2_quantize (
+        _mm256_mul_ps (_mm256_loadu_ps (ap_src + i + 8), scale));
+      _mm256_storeu_si256 ((__m256i *) (ap_dst + i), avx2_packs (a, b));
+    }
+  c_float_to_s16 (ap_src + i, ap_dst + i, a_count - i);
+}
+
+TIZ_PCM_AVX2 static inline __m256
+avx2_tpdf_noise (__m256i * ap_state)
+{
+  __m256i x = *ap_state;
+  x = _mm256_xor_si256 (x, _mm256_slli_epi32 (x, 13));
+  x = _mm256_xor_si256 (x, _mm256_srli_epi32 (x, 17));
+  x = _mm256_xor_si256 (x, _mm256_slli_epi32 (x, 5));
+  *ap_state = x;
+  return _mm256_mul_ps (
+    _mm256_cvtepi32_ps (
+      _mm256_sub_epi32 (_mm256_srli_epi32 (x, 16),
+                        _mm256_and_si256 (x, _mm256_set1_epi32 (0xffff)))),
+    _mm256_set1_ps (1.f / 65536.f));
+}
+
+TIZ_PCM_AVX2 static inline __m256
+avx2_load (const void * ap_src, bool a_fixed, size_t a_idx)
+{
+  return a_fixed ? _mm256_cvtepi32_ps (_mm256_loadu_si256 (
+                     (const __m256i *) ((const int32_t *) ap_src + a_idx)))
+                 : _mm256_loadu_ps ((const float *) ap_src + a_idx);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_tpdf_to_s16 (const void * ap_src, bool a_fixed, float a_scale,
+                  int16_t * ap_dst, size_t a_count, uint32_t * ap_rng)
+{
+  const __m256 scale = _mm256_set1_ps (a_scale);
+  __m256i state = _mm256_loadu_si256 ((const __m256i *) ap_rng);
+  size_t i = 0;
+  for (; i + 16 <= a_count; i += 16)
+    {
+      const __m256i a = avx2_quantize (_mm256_add_ps (
+        _mm256_mul_ps (avx2_load (ap_src, a_fixed, i), scale),
+        avx2_tpdf_noise (&state)));
+      const __m256i b = avx2_quantize (_mm256_add_ps (
+        _mm256_mul_ps (avx2_load (ap_src, a_fixed, i + 8), scale),
+        avx2_tpdf_noise (&state)));
+      _mm256_storeu_si256 ((__m256i *) (ap_dst + i), avx2_packs (a, b));
+    }
+  _mm256_storeu_si256 ((__m256i *) ap_rng, state);
+  c_tpdf_to_s16 (a_fixed ? (const void *) ((const int32_t *) ap_src + i)
+                         : (const void *) ((const float *) ap_src + i),
+                 a_fixed, a_scale, ap_dst + i, a_count - i, ap_rng);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_bswap16 (int16_t * ap_data, size_t a_count)
+{
+  size_t i = 0;
+  for (; i + 16 <= a_count; i += 16)
+    {
+      const __m256i v = _mm256_loadu_si256 ((const __m256i *) (ap_data + i));
+      _mm256_storeu_si256 (
+        (__m256i *) (ap_data + i),
+        _mm256_or_si256 (_mm256_slli_epi16 (v, 8), _mm256_srli_epi16 (v, 8)));
+    }
+  c_bswap16 (ap_data + i, a_count - i);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_gain_s16 (int16_t * ap_data, size_t a_count, float a_gain)
+{
+  const __m256 gain = _mm256_set1_ps (a_gain);
+  size_t i = 0;
+  for (; i + 16 <= a_count; i += 16)
+    {
+      const __m256i lo = _mm256_cvtepi16_epi32 (
+        _mm_loadu_si128 ((const __m128i *) (ap_data + i)));
+      const __m256i hi = _mm256_cvtepi16_epi32 (
+        _mm_loadu_si128 ((const __m128i *) (ap_data + i + 8)));
+      _mm256_storeu_si256 (
+        (__m256i *) (ap_data + i),
+        avx2_packs (
+          avx2_quantize (_mm256_mul_ps (_mm256_cvtepi32_ps (lo), gain)),
+          avx2_quantize (_mm256_mul_ps (_mm256_cvtepi32_ps (hi), gain))));
+    }
+  c_gain_s16 (ap_data + i, a_count - i, a_gain);
+}
+
+TIZ_PCM_AVX2 static void
+avx2_gain_float (float * ap_data, size_t a_count, float a_gain)
+{
+  const __m256 gain = _mm256_set1_ps (a_gain);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      _mm256_storeu_ps (ap_data + i,
+                        _mm256_mul_ps (_mm256_loadu_ps (ap_data + i), gain));
+    }
+  c_gain_float (ap_data + i, a_count - i, a_gain);
+}
+
+#endif /* TIZ_PCM_X86 */
+
+#ifdef TIZ_PCM_NEON
+
+/*
+ * NEON kernels
+ */
+
+static void
+neon_interleave2 (const uint32_t * ap_l, const uint32_t * ap_r,
+                  uint32_t * ap_dst, size_t a_nframes)
+{
+  size_t i = 0;
+  for (; i + 4 <= a_nframes; i += 4)
+    {
+      uint32x4x2_t v;
+      v.val[0] = vld1q_u32 (ap_l + i);
+      v.val[1] = vld1q_u32 (ap_r + i);
+      vst2q_u32 (ap_dst + 2 * i, v);
+    }
+  c_interleave2 (ap_l + i, ap_r + i, ap_dst + 2 * i, a_nframes - i);
+}
+
+static void
+neon_fixed_to_s16 (const int32_t * ap_src, int16_t * ap_dst, size_t a_count,
+                   int a_shift)
+{
+  const int32x4_t shift = vdupq_n_s32 (-a_shift);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      /* vrshrq_n_s32 (x, 1) is (x + 1) >> 1 */
+      const int32x4_t a
+        = vrshrq_n_s32 (vshlq_s32 (vld1q_s32 (ap_src + i), shift), 1);
+      const int32x4_t b
+        = vrshrq_n_s32 (vshlq_s32 (vld1q_s32 (ap_src + i + 4), shift), 1);
+      vst1q_s16 (ap_dst + i, vcombine_s16 (vqmovn_s32 (a), vqmovn_s32 (b)));
+    }
+  c_fixed_to_s16 (ap_src + i, ap_dst + i, a_count - i, a_shift);
+}
+
+static inline int16x4_t
+neon_quantize (float32x4_t a_val)
+{
+  /* vcvtq_s32_f32 truncates; add 0.5 with the sign of the value first */
+  const uint32x4_t sign = vandq_u32 (vreinterpretq_u32_f32 (a_val),
+                                     vdupq_n_u32 (0x80000000));
+  const float32x4_t half = vreinterpretq_f32_u32 (
+    vorrq_u32 (sign, vreinterpretq_u32_f32 (vdupq_n_f32 (0.5f))));
+  a_val = vminq_f32 (a_val, vdupq_n_f32 (32767.f));
+  a_val = vmaxq_f32 (a_val, vdupq_n_f32 (-32768.f));
+  return vqmovn_s32 (vcvtq_s32_f32 (vaddq_f32 (a_val, half)));
+}
+
+static void
+neon_float_to_s16 (const float * ap_src, int16_t * ap_dst, size_t a_count)
+{
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const int16x4_t a
+        = neon_quantize (vmulq_n_f32 (vld1q_f32 (ap_src + i), 32768.f));
+      const int16x4_t b
+        = neon_quantize (vmulq_n_f32 (vld1q_f32 (ap_src + i + 4), 32768.f));
+      vst1q_s16 (ap_dst + i, vcombine_s16 (a, b));
+    }
+  c_float_to_s16 (ap_src + i, ap_dst + i, a_count - i);
+}
+
+static inline float32x4_t
+neon_tpdf_noise (uint32x4_t * ap_state)
+{
+  uint32x4_t x = *ap_state;
+  x = veorq_u32 (x, vshlq_n_u32 (x, 13));
+  x = veorq_u32 (x, vshrq_n_u32 (x, 17));
+  x = veorq_u32 (x, vshlq_n_u32 (x, 5));
+  *ap_state = x;
+  return vmulq_n_f32 (
+    vcvtq_f32_s32 (vsubq_s32 (
+      vreinterpretq_s32_u32 (vshrq_n_u32 (x, 16)),
+      vreinterpretq_s32_u32 (vandq_u32 (x, vdupq_n_u32 (0xffff))))),
+    1.f / 65536.f);
+}
+
+static inline float32x4_t
+neon_load (const void * ap_src, bool a_fixed, size_t a_idx)
+{
+  return a_fixed ? vcvtq_f32_s32 (vld1q_s32 ((const int32_t *) ap_src + a_idx))
+                 : vld1q_f32 ((const float *) ap_src + a_idx);
+}
+
+static void
+neon_tpdf_to_s16 (const void * ap_src, bool a_fixed, float a_scale,
+                  int16_t * ap_dst, size_t a_count, uint32_t * ap_rng)
+{
+  uint32x4_t state = vld1q_u32 (ap_rng);
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const int16x4_t a = neon_quantize (vmlaq_n_f32 (
+        neon_tpdf_noise (&state), neon_load (ap_src, a_fixed, i), a_scale));
+      const int16x4_t b = neon_quantize (vmlaq_n_f32 (
+        neon_tpdf_noise (&state), neon_load (ap_src, a_fixed, i + 4), a_scale));
+      vst1q_s16 (ap_dst + i, vcombine_s16 (a, b));
+    }
+  vst1q_u32 (ap_rng, state);
+  c_tpdf_to_s16 (a_fixed ? (const void *) ((const int32_t *) ap_src + i)
+                         : (const void *) ((const float *) ap_src + i),
+                 a_fixed, a_scale, ap_dst + i, a_count - i, ap_rng);
+}
+
+static void
+neon_bswap16 (int16_t * ap_data, size_t a_count)
+{
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const uint8x16_t v = vld1q_u8 ((const uint8_t *) (ap_data + i));
+      vst1q_u8 ((uint8_t *) (ap_data + i), vrev16q_u8 (v));
+    }
+  c_bswap16 (ap_data + i, a_count - i);
+}
+
+static void
+neon_gain_s16 (int16_t * ap_data, size_t a_count, float a_gain)
+{
+  size_t i = 0;
+  for (; i + 8 <= a_count; i += 8)
+    {
+      const int16x8_t v = vld1q_s16 (ap_data + i);
+      const float32x4_t lo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (v)));
+      const float32x4_t hi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (v)));
+      vst1q_s16 (ap_data + i,
+                 vcombine_s16 (neon_quantize (vmulq_n_f32 (lo, a_gain)),
+                               neon_quantize (vmulq_n_f32 (hi, a_gain))));
+    }
+  c_gain_s16 (ap_data + i, a_count - i, a_gain);
+}
+
+static void
+neon_gain_float (float * ap_data, size_t a_count, float a_gain)
+{
+  size_t i = 0;
+  for (; i + 4 <= a_count; i += 4)
+    {
+      vst1q_f32 (ap_data + i, vmulq_n_f32 (vld1q_f32 (ap_data + i), a_gain));
+    }
+  c_gain_float (ap_data + i, a_count - i, a_gain);
+}
+
+#endif /* TIZ_PCM_NEON */
+
+static void
+select_kernels (void)
+{
+  const char * p_env = getenv ("TIZONIA_PCM_SIMD");
+  const bool force_c = (p_env && 0 == strcmp (p_env, "c"));
+
+  g_kernels.p_name = "c";
+  g_kernels.pf_interleave2 = c_interleave2;
+  g_kernels.pf_fixed_to_s16 = c_fixed_to_s16;
+  g_kernels.pf_float_to_s16 = c_float_to_s16;
+  g_kernels.pf_tpdf_to_s16 = c_tpdf_to_s16;
+  g_kernels.pf_bswap16 = c_bswap16;
+  g_kernels.pf_gain_s16 = c_gain_s16;
+  g_kernels.pf_gain_float = c_gain_float;
+
+  if (force_c)
+    {
+      return;
+    }
+
+#if defined(TIZ_PCM_X86)
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2")
+      && !(p_env && 0 == strcmp (p_env, "sse2")))
+    {
+      g_kernels.p_name = "avx2";
+      g_kernels.pf_interleave2 = avx2_interleave2;
+      g_kernels.pf_fixed_to_s16 = avx2_fixed_to_s16;
+      g_kernels.pf_float_to_s16 = avx2_float_to_s16;
+      g_kernels.pf_tpdf_to_s16 = avx2_tpdf_to_s16;
+      g_kernels.pf_bswap16 = avx2_bswap16;
+  g_kernels.pf_gain_s16 = avx2_gain_s16;
+  g_kernels.pf_gain_float = avx2_gain_float;
+    }
+  else if (__builtin_cpu_supports ("sse2"))
+    {
+      g_kernels.p_name = "sse2";
+      g_kernels.pf_interleave2 = sse2_interleave2;
+      g_kernels.pf_fixed_to_s16 = sse2_fixed_to_s16;
+      g_kernels.pf_float_to_s16 = sse2_float_to_s16;
+      g_kernels.pf_tpdf_to_s16 = sse2_tpdf_to_s16;
+      g_kernels.pf_bswap16 = sse2_bswap16;
+  g_kernels.pf_gain_s16 = sse2_gain_s16;
+  g_kernels.pf_gain_float = sse2_gain_float;
+    }
+#elif defined(TIZ_PCM_NEON)
+  g_kernels.p_name = "neon";
+  g_kernels.pf_interleave2 = neon_interleave2;
+  g_kernels.pf_fixed_to_s16 = neon_fixed_to_s16;
+  g_kernels.pf_float_to_s16 = neon_float_to_s16;
+  g_kernels.pf_tpdf_to_s16 = neon_tpdf_to_s16;
+  g_kernels.pf_bswap16 = neon_bswap16;
+  g_kernels.pf_gain_s16 = neon_gain_s16;
+  g_kernels.pf_gain_float = neon_gain_float;
+#endif
+}
+
+static inline const pcm_kernels_t *
+kernels (void)
+{
+  (void) pthread_once (&g_kernels_once, select_kernels);
+  return &g_kernels;
+}
+
+/*
+ * Generic path
+ */
+
+static inline int32_t
+quantize (const tiz_pcm_conv_t * ap_conv, double a_val)
+{
+  a_val = a_val > ap_conv->max ? ap_conv->max
+                               : (a_val < ap_conv->min ? ap_conv->min : a_val);
+  return (int32_t) (a_val >= 0. ? a_val + 0.5 : a_val - 0.5);
+}
+
+static inline void
+store_int (const tiz_pcm_conv_t * ap_conv, uint8_t * ap_dst,
+           const int32_t a_val)
+{
+  const uint32_t v = (uint32_t) a_val;
+  switch (ap_conv->out_fmt)
+    {
+      case ETIZPcmOutS16:
+        {
+          const uint16_t s = (uint16_t) v;
+          memcpy (ap_dst, &s, 2);
+          if (ap_conv->swap)
+            {
+              c_bswap16 ((int16_t *) (void *) ap_dst, 1);
+            }
+        }
+        break;
+      case ETIZPcmOutS24:
+        {
+          const bool big = (TIZ_PCM_NATIVE_ENDIAN == OMX_EndianBig)
+                           != ap_conv->swap;
+          ap_dst[big ? 0 : 2] = (uint8_t) (v >> 16);
+          ap_dst[1] = (uint8_t) (v >> 8);
+          ap_dst[big ? 2 : 0] = (uint8_t) v;
+        }
+        break;
+      case ETIZPcmOutS32:
+        {
+          const uint32_t s
+            = ap_conv->swap ? ((v << 24) | ((v & 0xff00) << 8)
+                               | ((v >> 8) & 0xff00) | (v >> 24))
+                            : v;
+          memcpy (ap_dst, &s, 4);
+        }
+        break;
+      default:
+        assert (0);
+        break;
+    };
+}
+
+/* Converts a_count interleaved samples, starting at the first channel of a
+   frame */
+static void
+convert_generic (tiz_pcm_conv_t * ap_conv, const void * ap_src,
+                 const size_t a_count, uint8_t * ap_dst)
+{
+  const bool fixed = (ETIZPcmInFixed32 == ap_conv->in_fmt);
+  const int32_t * p_fixed = ap_src;
+  const float * p_float = ap_src;
+  size_t ch = 0;
+  size_t i = 0;
+
+  if (ETIZPcmOutFloat32 == ap_conv->out_fmt)
+    {
+      float * p_dst = (float *) (void *) ap_dst;
+      for (i = 0; i < a_count; ++i)
+        {
+          p_dst[i]
+            = fixed ? (float) (p_fixed[i] * ap_conv->scale) : p_float[i];
+        }
+      return;
+    }
+
+  for (i = 0; i < a_count; ++i)
+    {
+      double v = (fixed ? p_fixed[i] : p_float[i]) * ap_conv->scale;
+      int32_t q = 0;
+
+      if (ETIZPcmDitherShaped == ap_conv->dither)
+        {
+          double * p_err = ap_conv->p_err + ch * TIZ_PCM_SHAPER_TAPS;
+          double err = 0.;
+          v -= shaper_coefs[0] * p_err[0] + shaper_coefs[1] * p_err[1]
+               + shaper_coefs[2] * p_err[2] + shaper_coefs[3] * p_err[3]
+               + shaper_coefs[4] * p_err[4];
+          q = quantize (ap_conv, v + tpdf_noise (ap_conv->rng));
+          /* Bounded, so that clipping cannot make the filter unstable */
+          err = v - q;
+          p_err[4] = p_err[3];
+          p_err[3] = p_err[2];
+          p_err[2] = p_err[1];
+          p_err[1] = p_err[0];
+          p_err[0] = err > 1.5 ? 1.5 : (err < -1.5 ? -1.5 : err);
+          ch = (ch + 1 == ap_conv->nchannels) ? 0 : ch + 1;
+        }
+      else
+        {
+          if (ETIZPcmDitherTpdf == ap_conv->dither)
+            {
+              v += tpdf_noise (ap_conv->rng);
+            }
+          q = quantize (ap_conv, v);
+        }
+      store_int (ap_conv, ap_dst + i * ap_conv->sample_size, q);
+    }
+}
+
+static void
+convert_chunk (tiz_pcm_conv_t * ap_conv, const void * ap_src,
+               const size_t a_count, uint8_t * ap_dst)
+{
+  if (ap_conv->s16_simd)
+    {
+      const pcm_kernels_t * p_k = kernels ();
+      int16_t * p_dst = (int16_t *) (void *) ap_dst;
+      if (ETIZPcmDitherTpdf == ap_conv->dither)
+        {
+          p_k->pf_tpdf_to_s16 (ap_src, ETIZPcmInFixed32 == ap_conv->in_fmt,
+                               (float) ap_conv->scale, p_dst, a_count,
+                               ap_conv->rng);
+        }
+      else if (ETIZPcmInFixed32 == ap_conv->in_fmt)
+        {
+          p_k->pf_fixed_to_s16 (ap_src, p_dst, a_count,
+                                (int) ap_conv->fracbits - 16);
+        }
+      else
+        {
+          p_k->pf_float_to_s16 (ap_src, p_dst, a_count);
+        }
+      if (ap_conv->swap)
+        {
+          p_k->pf_bswap16 (p_dst, a_count);
+        }
+    }
+  else if (ETIZPcmInFloat32 == ap_conv->in_fmt
+           && ETIZPcmOutFloat32 == ap_conv->out_fmt)
+    {
+      if (ap_dst != ap_src)
+        {
+          memcpy (ap_dst, ap_src, a_count * sizeof (float));
+        }
+    }
+  else
+    {
+      convert_generic (ap_conv, ap_src, a_count, ap_dst);
+    }
+}
+
+/*
+ * Public API
+ */
+
+OMX_ERRORTYPE
+tiz_pcm_conv_init (tiz_pcm_conv_ptr_t * app_conv,
+                   const tiz_pcm_in_fmt_t a_in_fmt,
+                   const OMX_U32 a_in_fracbits,
+                   const tiz_pcm_out_fmt_t a_out_fmt,
+                   const OMX_ENDIANTYPE a_out_endian,
+                   const OMX_U32 a_nchannels, const tiz_pcm_dither_t a_dither)
+{
+  tiz_pcm_conv_t * p_conv = NULL;
+  static const size_t sample_sizes[] = {2, 3, 4, 4};
+  static const int out_bits[] = {16, 24, 32, 0};
+  int i = 0;
+
+  assert (app_conv);
+  tiz_check_true_ret_val (a_in_fmt < ETIZPcmInMax, OMX_ErrorBadParameter);
+  tiz_check_true_ret_val (a_out_fmt < ETIZPcmOutMax, OMX_ErrorBadParameter);
+  tiz_check_true_ret_val (a_dither < ETIZPcmDitherMax, OMX_ErrorBadParameter);
+  tiz_check_true_ret_val (a_nchannels > 0 && a_nchannels < 256,
+                          OMX_ErrorBadParameter);
+  tiz_check_true_ret_val (ETIZPcmInFixed32 != a_in_fmt
+                            || (a_in_fracbits > 0 && a_in_fracbits <= 30),
+                          OMX_ErrorBadParameter);
+
+  p_conv = tiz_mem_calloc (1, sizeof (tiz_pcm_conv_t));
+  tiz_check_null_ret_oom (p_conv != NULL);
+
+  p_conv->in_fmt = a_in_fmt;
+  p_conv->out_fmt = a_out_fmt;
+  p_conv->fracbits = a_in_fracbits;
+  p_conv->nchannels = a_nchannels;
+  p_conv->sample_size = sample_sizes[a_out_fmt];
+  p_conv->chunk_frames = TIZ_PCM_CHUNK / a_nchannels;
+  p_conv->swap = (ETIZPcmOutFloat32 != a_out_fmt
+                  && a_out_endian != TIZ_PCM_NATIVE_ENDIAN);
+  /* There is nothing to gain from dithering a 32-bit output */
+  p_conv->dither
+    = (ETIZPcmOutS16 == a_out_fmt || ETIZPcmOutS24 == a_out_fmt)
+        ? a_dither
+        : ETIZPcmDitherNone;
+
+  if (ETIZPcmOutFloat32 == a_out_fmt)
+    {
+      p_conv->scale = 1.;
+      if (ETIZPcmInFixed32 == a_in_fmt)
+        {
+          p_conv->scale = 1. / (double) (1UL << a_in_fracbits);
+        }
+    }
+  else
+    {
+      const int bits = out_bits[a_out_fmt];
+      p_conv->max = (double) ((1LL << (bits - 1)) - 1);
+      p_conv->min = -(double) (1LL << (bits - 1));
+      p_conv->scale = (double) (1LL << (bits - 1));
+      if (ETIZPcmInFixed32 == a_in_fmt)
+        {
+          p_conv->scale /= (double) (1UL << a_in_fracbits);
+        }
+    }
+
+  p_conv->s16_simd
+    = (ETIZPcmOutS16 == a_out_fmt && ETIZPcmDitherShaped != p_conv->dither
+       && (ETIZPcmInFloat32 == a_in_fmt || ETIZPcmDitherTpdf == p_conv->dither
+           || a_in_fracbits >= 16));
+
+  if (ETIZPcmDitherShaped == p_conv->dither)
+    {
+      p_conv->p_err = tiz_mem_calloc (a_nchannels * TIZ_PCM_SHAPER_TAPS,
+                                      sizeof (double));
+      if (!p_conv->p_err)
+        {
+          tiz_mem_free (p_conv);
+          return OMX_ErrorInsufficientResources;
+        }
+    }
+
+  tiz_pcm_conv_reset (p_conv);
+  (void) kernels ();
+
+  for (i = 0; i < TIZ_PCM_RNG_LANES; ++i)
+    {
+      /* Any non-zero seeds will do */
+      p_conv->rng[i] = 0x9e3779b9U * (uint32_t) (i + 1);
+    }
+
+  *app_conv = p_conv;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_pcm_conv_destroy (tiz_pcm_conv_t * ap_conv)
+{
+  if (ap_conv)
+    {
+      tiz_mem_free (ap_conv->p_err);
+      tiz_mem_free (ap_conv);
+    }
+}
+
+void
+tiz_pcm_conv_reset (tiz_pcm_conv_t * ap_conv)
+{
+  assert (ap_conv);
+  if (ap_conv->p_err)
+    {
+      memset (ap_conv->p_err, 0, ap_conv->nchannels * TIZ_PCM_SHAPER_TAPS
+                                   * sizeof (double));
+    }
+}
+
+size_t
+tiz_pcm_conv_frame_size (const tiz_pcm_conv_t * ap_conv)
+{
+  assert (ap_conv);
+  return ap_conv->sample_size * ap_conv->nchannels;
+}
+
+void
+tiz_pcm_conv_planar (tiz_pcm_conv_t * ap_conv, const void * const * app_src,
+                     const size_t a_nframes, void * ap_dst)
+{
+  const size_t nch = ap_conv ? ap_conv->nchannels : 0;
+  const size_t frame_size = ap_conv ? tiz_pcm_conv_frame_size (ap_conv) : 0;
+  uint8_t * p_dst = ap_dst;
+  size_t done = 0;
+
+  assert (ap_conv);
+  assert (app_src);
+  assert (ap_dst || 0 == a_nframes);
+
+  if (1 == nch)
+    {
+      tiz_pcm_conv_interleaved (ap_conv, app_src[0], a_nframes, ap_dst);
+      return;
+    }
+
+  while (done < a_nframes)
+    {
+      const size_t n = MIN (ap_conv->chunk_frames, a_nframes - done);
+      const bool direct = (ETIZPcmInFloat32 == ap_conv->in_fmt
+                           && ETIZPcmOutFloat32 == ap_conv->out_fmt);
+      /* float to float only needs interleaving */
+      uint32_t * p_ilv
+        = direct ? (uint32_t *) (void *) p_dst : ap_conv->scratch;
+      size_t c = 0;
+
+      if (2 == nch)
+        {
+          kernels ()->pf_interleave2 ((const uint32_t *) app_src[0] + done,
+                                      (const uint32_t *) app_src[1] + done,
+                                      p_ilv, n);
+        }
+      else
+        {
+          for (c = 0; c < nch; ++c)
+            {
+              const uint32_t * p_plane = (const uint32_t *) app_src[c] + done;
+              size_t i = 0;
+              for (i = 0; i < n; ++i)
+                {
+                  p_ilv[i * nch + c] = p_plane[i];
+                }
+            }
+        }
+
+      if (!direct)
+        {
+          convert_chunk (ap_conv, p_ilv, n * nch, p_dst);
+        }
+      p_dst += n * frame_size;
+      done += n;
+    }
+}
+
+void
+tiz_pcm_conv_interleaved (tiz_pcm_conv_t * ap_conv, const void * ap_src,
+                          const size_t a_nframes, void * ap_dst)
+{
+  const uint32_t * p_src = ap_src;
+  uint8_t * p_dst = ap_dst;
+  size_t done = 0;
+
+  assert (ap_conv);
+  assert (ap_src || 0 == a_nframes);
+  assert (ap_dst || 0 == a_nframes);
+
+  while (done < a_nframes)
+    {
+      const size_t n = MIN (ap_conv->chunk_frames, a_nframes - done);
+      const size_t count = n * ap_conv->nchannels;
+      convert_chunk (ap_conv, p_src, count, p_dst);
+      p_src += count;
+      p_dst += count * ap_conv->sample_size;
+      done += n;
+    }
+}
+
+tiz_pcm_dither_t
+tiz_pcm_dither_from_str (const char * ap_str, const tiz_pcm_dither_t a_default)
+{
+  if (ap_str)
+    {
+      if (0 == strcasecmp (ap_str, "none"))
+        {
+          return ETIZPcmDitherNone;
+        }
+      if (0 == strcasecmp (ap_str, "tpdf"))
+        {
+          return ETIZPcmDitherTpdf;
+        }
+      if (0 == strcasecmp (ap_str, "shaped"))
+        {
+          return ETIZPcmDitherShaped;
+        }
+    }
+  return a_default;
+}
+
+void
+tiz_pcm_gain_s16 (int16_t * ap_data, const size_t a_count, const float a_gain)
+{
+  assert (ap_data || 0 == a_count);
+  kernels ()->pf_gain_s16 (ap_data, a_count, a_gain);
+}
+
+void
+tiz_pcm_gain_float (float * ap_data, const size_t a_count, const float a_gain)
+{
+  assert (ap_data || 0 == a_count);
+  kernels ()->pf_gain_float (ap_data, a_count, a_gain);
+}
+
+const char *
+tiz_pcm_simd_name (void)
+{
+  return kernels ()->p_name;
+}
@@ -0,0 +1,236 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizpcm.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - PCM sample format conversion
+ *
+ *
+ */
+
+#ifndef TIZPCM_H
+#define TIZPCM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @defgroup tizpcm PCM sample format conversion
+*
+* Block conversion of the planar or interleaved fixed-point and floating point
+* samples produced by the audio decoders into interleaved integer or floating
+* point PCM, with optional dithering. The conversion kernels are selected at
+* run time (AVX2, SSE2, NEON or plain C).
+*
+* @ingroup libtizplatform
+*/
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * The host's byte order, for integer outputs in native endianness.
+ * @ingroup tizpcm
+ */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define TIZ_PCM_NATIVE_ENDIAN OMX_EndianBig
+#else
+#define TIZ_PCM_NATIVE_ENDIAN OMX_EndianLittle
+#endif
+
+/**
+ * Input sample formats.
+ * @ingroup tizpcm
+ */
+typedef enum tiz_pcm_in_fmt {
+  ETIZPcmInFixed32, /**< 32-bit fixed point (e.g. libmad's mad_fixed_t), with
+                       the number of fractional bits given at init time. */
+  ETIZPcmInFloat32, /**< Native float, full scale is [-1.0, 1.0). */
+  ETIZPcmInMax,
+} tiz_pcm_in_fmt_t;
+
+/**
+ * Output sample formats. The output is always interleaved.
+ * @ingroup tizpcm
+ */
+typedef enum tiz_pcm_out_fmt {
+  ETIZPcmOutS16,     /**< Signed 16-bit. */
+  ETIZPcmOutS24,     /**< Signed 24-bit, packed in 3 bytes. */
+  ETIZPcmOutS32,     /**< Signed 32-bit. */
+  ETIZPcmOutFloat32, /**< Native float, always native endianness. */
+  ETIZPcmOutMax,
+} tiz_pcm_out_fmt_t;
+
+/**
+ * Requantization strategies, used when the output has less resolution than
+ * the input (i.e. S16 and S24 outputs).
+ * @ingroup tizpcm
+ */
+typedef enum tiz_pcm_dither {
+  ETIZPcmDitherNone,   /**< Round to nearest. */
+  ETIZPcmDitherTpdf,   /**< Triangular PDF dither of +-1 LSB. */
+  ETIZPcmDitherShaped, /**< TPDF dither plus a noise shaping filter that moves
+                          the requantization noise to the less audible high
+                          frequencies. */
+  ETIZPcmDitherMax,
+} tiz_pcm_dither_t;
+
+/**
+ * PCM converter opaque handle.
+ * @ingroup tizpcm
+ */
+typedef struct tiz_pcm_conv tiz_pcm_conv_t;
+typedef /*@null@ */ tiz_pcm_conv_t * tiz_pcm_conv_ptr_t;
+
+/**
+ * Create a new PCM converter.
+ *
+ * @ingroup tizpcm
+ * @param app_conv A converter handle to be initialised.
+ * @param a_in_fmt The input sample format.
+ * @param a_in_fracbits Fractional bits of ETIZPcmInFixed32 samples (1-30);
+ * ignored for other input formats.
+ * @param a_out_fmt The output sample format.
+ * @param a_out_endian The byte order of integer output samples.
+ * @param a_nchannels The number of channels (1-255).
+ * @param a_dither The requantization strategy.
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter if any of the
+ * parameters is not supported, OMX_ErrorInsufficientResources on OOM.
+ */
+OMX_ERRORTYPE
+tiz_pcm_conv_init (tiz_pcm_conv_ptr_t * app_conv,
+                   const tiz_pcm_in_fmt_t a_in_fmt,
+                   const OMX_U32 a_in_fracbits,
+                   const tiz_pcm_out_fmt_t a_out_fmt,
+                   const OMX_ENDIANTYPE a_out_endian,
+                   const OMX_U32 a_nchannels, const tiz_pcm_dither_t a_dither);
+
+/**
+ * Destroy a PCM converter.
+ *
+ * @ingroup tizpcm
+ * @param ap_conv The converter handle.
+ */
+void
+tiz_pcm_conv_destroy (tiz_pcm_conv_t * ap_conv);
+
+/**
+ * Clear the dither and noise shaping state (e.g. after a seek or a flush).
+ *
+ * @ingroup tizpcm
+ * @param ap_conv The converter handle.
+ */
+void
+tiz_pcm_conv_reset (tiz_pcm_conv_t * ap_conv);
+
+/**
+ * Retrieve the size in bytes of one output frame (one sample of each
+ * channel).
+ *
+ * @ingroup tizpcm
+ * @param ap_conv The converter handle.
+ * @return The output frame size.
+ */
+size_t
+tiz_pcm_conv_frame_size (const tiz_pcm_conv_t * ap_conv);
+
+/**
+ * Convert a block of planar samples.
+ *
+ * @ingroup tizpcm
+ * @param ap_conv The converter handle.
+ * @param app_src One pointer per channel to the first sample to be
+ * converted. The same plane may be given more than once (e.g. to output a
+ * mono stream as stereo).
+ * @param a_nframes The number of samples to convert from each plane.
+ * @param ap_dst Where the a_nframes interleaved output frames are written to.
+ */
+void
+tiz_pcm_conv_planar (tiz_pcm_conv_t * ap_conv, const void * const * app_src,
+                     const size_t a_nframes, void * ap_dst);
+
+/**
+ * Convert a block of interleaved samples.
+ *
+ * @ingroup tizpcm
+ * @param ap_conv The converter handle.
+ * @param ap_src The first sample of the first frame to be converted.
+ * @param a_nframes The number of frames to convert.
+ * @param ap_dst Where the a_nframes output frames are written to. It must not
+ * overlap with ap_src, unless both are the same.
+ */
+void
+tiz_pcm_conv_interleaved (tiz_pcm_conv_t * ap_conv, const void * ap_src,
+                          const size_t a_nframes, void * ap_dst);
+
+/**
+ * Parse a requantization strategy from a configuration value.
+ *
+ * @ingroup tizpcm
+ * @param ap_str "none", "tpdf" or "shaped", or NULL.
+ * @param a_default The value returned when ap_str is NULL or not recognised.
+ * @return The requantization strategy.
+ */
+tiz_pcm_dither_t
+tiz_pcm_dither_from_str (const char * ap_str, const tiz_pcm_dither_t a_default);
+
+/**
+ * Scale a block of 16-bit samples in place, rounding to nearest and
+ * saturating.
+ *
+ * @ingroup tizpcm
+ * @param ap_data The first sample, in the host's byte order.
+ * @param a_count The number of samples.
+ * @param a_gain The linear gain.
+ */
+void
+tiz_pcm_gain_s16 (int16_t * ap_data, const size_t a_count, const float a_gain);
+
+/**
+ * Scale a block of floating point samples in place.
+ *
+ * @ingroup tizpcm
+ * @param ap_data The first sample.
+ * @param a_count The number of samples.
+ * @param a_gain The linear gain.
+ */
+void
+tiz_pcm_gain_float (float * ap_data, const size_t a_count, const float a_gain);
+
+/**
+ * Retrieve the name of the instruction set used by the conversion kernels
+ * ("avx2", "sse2", "neon" or "c").
+ *
+ * @ingroup tizpcm
+ * @return The name of the kernel set.
+ */
+const char *
+tiz_pcm_simd_name (void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZPCM_H */
@@ -30,6 +30,9 @@
 #ifndef TIZINT_H
 #define TIZINT_H
 
+#include <stdbool.h>
+#include <time.h>
+
 /**
  * Value struct used in the Tizonia Platform config file data structure
  *
@@ -51,6 +54,7 @@ struct value
 typedef struct keyval keyval_t;
 struct keyval
 {
+  char * p_section;
   char * p_key;
   value_t * p_value_list;
   value_t * p_value_iter;
@@ -58,6 +62,26 @@ struct keyval
   keyval_t * p_next;
 };
 
+/**
+ * The contents of a config file, indexed by section and key. A snapshot is
+ * never modified once it has been published.
+ *
+ * @private
+ */
+typedef struct tiz_rcsnapshot tiz_rcsnapshot_t;
+struct tiz_rcsnapshot
+{
+  keyval_t * p_keyvals;
+  int count;
+  keyval_t ** pp_index;     /* Open addressing, by section and key */
+  keyval_t ** pp_key_index; /* Open addressing, by key alone */
+  size_t index_size;        /* Power of two */
+  tiz_rcsnapshot_t * p_retired_next;
+  time_t retired_at; /* Monotonic seconds */
+};
+
+#define TIZ_RCFILE_NUM_FILES 3
+
 /**
  * Handle to the Tizonia Platform config file data structure
  *
@@ -66,8 +90,17 @@ struct keyval
 typedef struct tiz_rcfile tiz_rcfile_t;
 struct tiz_rcfile
 {
-  keyval_t * p_keyvals;
-  int count;
+  /* Readers load this without locking; it is swapped when the file changes */
+  tiz_rcsnapshot_t * p_snapshot;
+  /* The snapshots replaced by a reload, newest first. The strings handed
+     out point into them, so they are kept for a grace period. */
+  tiz_rcsnapshot_t * p_retired;
+  time_t retired_grace; /* Seconds */
+  char * p_paths[TIZ_RCFILE_NUM_FILES];
+  int inotify_fd;
+  int stop_fd;
+  tiz_thread_t watcher;
+  bool watching;
 };
 
 /**
@@ -83,6 +116,19 @@ struct tiz_rcfile
 OMX_ERRORTYPE
 tiz_rcfile_init (tiz_rcfile_t ** rcfile);
 
+/**
+ * Start reloading the config file data structure whenever one of the config
+ * files is written, created or removed
+ *
+ * @private
+ *
+ * @param rcfile The handle to the Tizonia config file data structure
+ *
+ * @return OMX_ErrorNone on success. OMX_ErrorInsuficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_rcfile_watch (tiz_rcfile_t * rcfile);
+
 /**
  * Deinitialise the resources allocated for the Tizonia config file data
  * structure
@@ -94,6 +140,18 @@ tiz_rcfile_init (tiz_rcfile_t ** rcfile);
 void
 tiz_rcfile_destroy (tiz_rcfile_t * rcfile);
 
+/**
+ * Retrieve a value from the Tizonia config file data structure. Unlike
+ * tiz_rcfile_get_value, this does not need the event loop to be initialised.
+ *
+ * @private
+ *
+ * @param rcfile The handle to the Tizonia config file data structure
+ */
+const char *
+tiz_rcfile_get_value_internal (tiz_rcfile_t * rcfile, const char * section,
+                               const char * key);
+
 /**
  * Retrieve the config file handle from the event loop thread
  *
@@ -33,6 +33,7 @@
 #include "tizplatform.h"
 
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -52,6 +53,12 @@ _pq_dump_item (const char *ap_name, void    *ap_data,
 }
 #endif
 
+/* Each priority group is a doubly-linked list of its own, and a bitmap
+   records which groups are non-empty. Sending and receiving are O(1), and so
+   is removing an item through the handle returned at send time. */
+
+#define PQUEUE_BITS_PER_WORD 64
+
 typedef struct tiz_pqueue_item tiz_pqueue_item_t;
 struct tiz_pqueue_item
 {
@@ -61,11 +68,18 @@ struct tiz_pqueue_item
   tiz_pqueue_item_t * p_next;
 };
 
+typedef struct tiz_pqueue_group tiz_pqueue_group_t;
+struct tiz_pqueue_group
+{
+  /*@null@ */ tiz_pqueue_item_t * p_first;
+  /*@null@ */ tiz_pqueue_item_t * p_last;
+};
+
 struct tiz_pqueue
 {
-  /*@dependent@ */ tiz_pqueue_item_t ** pp_store;
-  /*@dependent@ */ /*@null@ */ tiz_pqueue_item_t * p_first;
-  /*@dependent@ */ /*@null@ */ tiz_pqueue_item_t * p_last;
+  /*@dependent@ */ tiz_pqueue_group_t * p_groups;
+  /*@dependent@ */ uint64_t * p_bitmap;
+  OMX_S32 nwords;
   OMX_S32 length;
   OMX_S32 max_prio;
   tiz_pq_cmp_f pf_cmp;
@@ -86,42 +100,114 @@ pqueue_free (tiz_soa_t * p_soa, void * ap_addr)
 }
 
 static inline void
-hook_before (tiz_pqueue_t * p_q, tiz_pqueue_item_t * p_cur,
-             tiz_pqueue_item_t * p_new)
+mark_group (tiz_pqueue_t * p_q, const OMX_S32 a_prio)
+{
+  p_q->p_bitmap[a_prio / PQUEUE_BITS_PER_WORD]
+    |= ((uint64_t) 1) << (a_prio % PQUEUE_BITS_PER_WORD);
+}
+
+static inline void
+unmark_group (tiz_pqueue_t * p_q, const OMX_S32 a_prio)
+{
+  p_q->p_bitmap[a_prio / PQUEUE_BITS_PER_WORD]
+    &= ~(((uint64_t) 1) << (a_prio % PQUEUE_BITS_PER_WORD));
+}
+
+/* Returns the highest priority (i.e. lowest number) non-empty group at or
+   below a_from, or -1 if there is none */
+static inline OMX_S32
+first_group (const tiz_pqueue_t * p_q, const OMX_S32 a_from)
 {
-  tiz_pqueue_item_t * p_tmp = p_cur->p_prev;
-  p_cur->p_prev = p_new;
-  p_new->p_next = p_cur;
-  if (p_tmp)
+  OMX_S32 w = a_from / PQUEUE_BITS_PER_WORD;
+  uint64_t word = 0;
+
+  if (a_from > p_q->max_prio)
     {
-      p_new->p_prev = p_tmp;
-      p_tmp->p_next = p_new;
+      return -1;
     }
-  else
+
+  word = p_q->p_bitmap[w]
+         & (~((uint64_t) 0) << (a_from % PQUEUE_BITS_PER_WORD));
+  while (0 == word)
     {
-      p_q->p_first = p_new;
+      if (++w >= p_q->nwords)
+        {
+          return -1;
+        }
+      word = p_q->p_bitmap[w];
     }
+
+  return w * PQUEUE_BITS_PER_WORD + __builtin_ctzll (word);
 }
 
 static inline void
 hook_last (tiz_pqueue_t * p_q, tiz_pqueue_item_t * p_new)
 {
-  tiz_pqueue_item_t * p_tmp = NULL;
+  tiz_pqueue_group_t * p_grp = NULL;
+
+  assert (p_q);
+  assert (p_new);
+
+  p_grp = &(p_q->p_groups[p_new->priority]);
+  p_new->p_next = NULL;
+  p_new->p_prev = p_grp->p_last;
+  if (p_grp->p_last)
+    {
+      p_grp->p_last->p_next = p_new;
+    }
+  else
+    {
+      p_grp->p_first = p_new;
+      mark_group (p_q, p_new->priority);
+    }
+  p_grp->p_last = p_new;
+  p_q->length++;
+}
+
+static inline void
+unhook (tiz_pqueue_t * p_q, tiz_pqueue_item_t * p_cur)
+{
+  tiz_pqueue_group_t * p_grp = NULL;
 
   assert (p_q);
+  assert (p_cur);
 
-  if (p_q->p_last)
+  p_grp = &(p_q->p_groups[p_cur->priority]);
+
+  if (p_cur->p_prev)
+    {
+      p_cur->p_prev->p_next = p_cur->p_next;
+    }
+  else
+    {
+      assert (p_grp->p_first == p_cur);
+      p_grp->p_first = p_cur->p_next;
+    }
+
+  if (p_cur->p_next)
+    {
+      p_cur->p_next->p_prev = p_cur->p_prev;
+    }
+  else
     {
-      p_tmp = p_q->p_last;
-      p_tmp->p_next = p_new;
-      p_new->p_prev = p_tmp;
+      assert (p_grp->p_last == p_cur);
+      p_grp->p_last = p_cur->p_prev;
     }
 
-  p_q->p_last = p_new;
-  if (NULL == p_q->p_first)
+  if (NULL == p_grp->p_first)
     {
-      p_q->p_first = p_new;
+      unmark_group (p_q, p_cur->priority);
     }
+
+  p_q->length--;
+  assert (p_q->length >= 0);
+}
+
+static inline void
+remove_item (tiz_pqueue_t * p_q, tiz_pqueue_item_t * p_cur)
+{
+  unhook (p_q, p_cur);
+  pqueue_free (p_q->p_soa, p_cur);
 }
 
 OMX_ERRORTYPE
@@ -130,6 +216,7 @@ tiz_pqueue_init (tiz_pqueue_t ** pp_q, OMX_S32 a_max_prio,
                  const char * ap_name)
 {
   tiz_pqueue_t * p_q = NULL;
+  OMX_S32 nwords = 0;
 
   assert (pp_q != NULL);
   assert (a_max_prio >= 0);
@@ -141,18 +228,28 @@ tiz_pqueue_init (tiz_pqueue_t ** pp_q, OMX_S32 a_max_prio,
       return OMX_ErrorInsufficientResources;
     }
 
-  /* There is one pointer per priority category */
-  if (NULL
-      == (p_q->pp_store = (tiz_pqueue_item_t **) pqueue_calloc (
-            ap_soa, (size_t) (a_max_prio + 1) * sizeof (tiz_pqueue_item_t *))))
+  /* There is one list per priority category, and one bit in the bitmap. These
+     are allocated once, from the heap, as they may not fit in a small object
+     allocator slice */
+  nwords = a_max_prio / PQUEUE_BITS_PER_WORD + 1;
+  if (NULL == (p_q->p_groups = (tiz_pqueue_group_t *) tiz_mem_calloc (
+                 (size_t) (a_max_prio + 1), sizeof (tiz_pqueue_group_t))))
+    {
+      pqueue_free (ap_soa, p_q);
+      p_q = NULL;
+      return OMX_ErrorInsufficientResources;
+    }
+
+  if (NULL == (p_q->p_bitmap = (uint64_t *) tiz_mem_calloc (
+                 (size_t) nwords, sizeof (uint64_t))))
     {
+      tiz_mem_free (p_q->p_groups);
       pqueue_free (ap_soa, p_q);
       p_q = NULL;
       return OMX_ErrorInsufficientResources;
     }
 
-  p_q->p_first = NULL;
-  p_q->p_last = NULL;
+  p_q->nwords = nwords;
   p_q->length = 0;
   p_q->max_prio = a_max_prio;
   p_q->pf_cmp = a_pf_cmp;
@@ -174,17 +271,25 @@ tiz_pqueue_destroy (tiz_pqueue_t * p_q)
 {
   if (p_q)
     {
-      assert (p_q->p_first == p_q->p_last);
-      assert (p_q->p_first == NULL);
       assert (p_q->length == 0);
+      assert (first_group (p_q, 0) == -1);
 
-      pqueue_free (p_q->p_soa, p_q->pp_store);
+      tiz_mem_free (p_q->p_bitmap);
+      tiz_mem_free (p_q->p_groups);
       pqueue_free (p_q->p_soa, p_q);
     }
 }
 
 OMX_ERRORTYPE
 tiz_pqueue_send (tiz_pqueue_t * p_q, void * ap_data, OMX_S32 a_priority)
+{
+  return tiz_pqueue_send_with_handle (p_q, ap_data, a_priority, NULL);
+}
+
+OMX_ERRORTYPE
+tiz_pqueue_send_with_handle (tiz_pqueue_t * p_q, void * ap_data,
+                             OMX_S32 a_priority,
+                             tiz_pqueue_handle_t * ap_handle)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   tiz_pqueue_item_t * p_new = NULL;
@@ -200,34 +305,13 @@ tiz_pqueue_send (tiz_pqueue_t * p_q, void * ap_data, OMX_S32 a_priority)
     }
   else
     {
-      OMX_S32 next_prio = a_priority + 1;
-      /* Find the next priority upwards. This will make next_prio equal to next
-       * prio up or max+1 if none */
-      while ((next_prio <= p_q->max_prio) && (NULL == p_q->pp_store[next_prio]))
-        {
-          next_prio++;
-        }
-
-      if (NULL == p_q->pp_store[a_priority])
-        {
-          p_q->pp_store[a_priority] = p_new;
-        }
-
-      if ((next_prio <= p_q->max_prio) && (p_q->pp_store[next_prio]))
-        {
-          hook_before (p_q, p_q->pp_store[next_prio], p_new);
-        }
-      else
-        {
-          hook_last (p_q, p_new);
-        }
-
       p_new->p_data = ap_data;
       p_new->priority = a_priority;
-      p_q->length++;
-
-      assert (p_q->p_first);
-      assert (p_q->p_last);
+      hook_last (p_q, p_new);
+      if (ap_handle)
+        {
+          *ap_handle = p_new;
+        }
     }
 
   return rc;
@@ -237,61 +321,33 @@ OMX_ERRORTYPE
 tiz_pqueue_receive (tiz_pqueue_t * p_q, void ** app_data)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_S32 prio = -1;
 
   assert (p_q);
   assert (app_data);
 
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s], pq[%p] len[%d] fst [%p] lst [%p]",
-           p_q->name, p_q, p_q->length, p_q->p_first, p_q->p_last);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s], pq[%p] len[%d]", p_q->name, p_q,
+           p_q->length);
 
   if (0 >= p_q->length)
     {
-      assert (p_q->p_first == p_q->p_last);
       assert (0 == p_q->length);
       rc = OMX_ErrorNoMore;
     }
   else
     {
       tiz_pqueue_item_t * p_cur = NULL;
-      tiz_pqueue_item_t * p_next = NULL;
 
-      p_cur = p_q->p_first;
+      prio = first_group (p_q, 0);
+      assert (prio >= 0);
+      p_cur = p_q->p_groups[prio].p_first;
       assert (p_cur);
-      p_next = p_cur->p_next;
-      p_q->p_first = p_next;
-
-      if (p_next)
-        {
-          p_next->p_prev = NULL;
-        }
-      else
-        {
-          p_q->p_last = NULL;
-          assert (p_q->length == 1);
-        }
-
-      if (p_q->pp_store[p_cur->priority] == p_cur)
-        {
-          if ((p_next) && (p_next->priority == p_cur->priority))
-            {
-              p_q->pp_store[p_cur->priority] = p_next;
-            }
-          else
-            {
-              p_q->pp_store[p_cur->priority] = NULL;
-            }
-        }
-
-      p_q->length--;
       *app_data = p_cur->p_data;
-      pqueue_free (p_q->p_soa, p_cur);
-
-      assert (p_q->length >= 0);
-      assert (p_q->length > 0 ? (p_q->p_first && p_q->p_last) : 1);
+      remove_item (p_q, p_cur);
     }
 
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s], pq[%p] len[%d] fst [%p] lst [%p]",
-           p_q->name, p_q, p_q->length, p_q->p_first, p_q->p_last);
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s], pq[%p] len[%d] prio [%d]", p_q->name,
+           p_q, p_q->length, prio);
 
   return rc;
 }
@@ -299,129 +355,86 @@ tiz_pqueue_receive (tiz_pqueue_t * p_q, void ** app_data)
 OMX_ERRORTYPE
 tiz_pqueue_remove (tiz_pqueue_t * p_q, void * ap_data)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNoMore;
-  tiz_pqueue_item_t * p_cur = NULL;
-  tiz_pqueue_item_t * p_next = NULL;
-  tiz_pqueue_item_t * p_prev = NULL;
+  OMX_S32 prio = 0;
 
   assert (p_q);
   assert (ap_data);
 
-  p_cur = p_q->p_first;
-  while (p_cur)
+  for (prio = first_group (p_q, 0); prio >= 0;
+       prio = first_group (p_q, prio + 1))
     {
-      if (p_q->pf_cmp (p_cur->p_data, ap_data) == 0)
+      if (OMX_ErrorNone == tiz_pqueue_removep (p_q, ap_data, prio))
         {
-          p_next = p_cur->p_next;
-          p_prev = p_cur->p_prev;
-
-          if (p_next)
-            {
-              p_next->p_prev = p_prev;
-            }
-
-          if (p_prev)
-            {
-              p_prev->p_next = p_next;
-            }
-
-          if (p_q->p_first == p_cur)
-            {
-              p_q->p_first = p_next;
-            }
-
-          if (p_q->p_last == p_cur)
-            {
-              p_q->p_last = p_prev;
-            }
-
-          if (p_q->pp_store[p_cur->priority] == p_cur)
-            {
-              if ((p_next) && (p_next->priority == p_cur->priority))
-                {
-                  p_q->pp_store[p_cur->priority] = p_next;
-                }
-              else
-                {
-                  p_q->pp_store[p_cur->priority] = NULL;
-                }
-            }
-
-          pqueue_free (p_q->p_soa, p_cur);
-          p_q->length--;
-          rc = OMX_ErrorNone;
-          /* DONE */
-          break;
+          return OMX_ErrorNone;
         }
-      p_cur = p_cur->p_next;
     }
 
-  return rc;
+  return OMX_ErrorNoMore;
 }
 
 OMX_ERRORTYPE
 tiz_pqueue_removep (tiz_pqueue_t * p_q, void * ap_data, OMX_S32 a_priority)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNoMore;
   tiz_pqueue_item_t * p_cur = NULL;
-  tiz_pqueue_item_t * p_next = NULL;
-  tiz_pqueue_item_t * p_prev = NULL;
 
   assert (p_q);
   assert (ap_data != NULL);
   assert (a_priority >= 0);
   assert (a_priority <= p_q->max_prio);
 
-  p_cur = p_q->pp_store[a_priority];
-  while (p_cur && p_cur->priority == a_priority)
+  for (p_cur = p_q->p_groups[a_priority].p_first; p_cur; p_cur = p_cur->p_next)
     {
       if (p_q->pf_cmp (p_cur->p_data, ap_data) == 0)
         {
-          p_next = p_cur->p_next;
-          p_prev = p_cur->p_prev;
-
-          if (p_next)
-            {
-              p_next->p_prev = p_prev;
-            }
-
-          if (p_prev)
-            {
-              p_prev->p_next = p_next;
-            }
-
-          if (p_q->p_first == p_cur)
-            {
-              p_q->p_first = p_next;
-            }
+          remove_item (p_q, p_cur);
+          return OMX_ErrorNone;
+        }
+    }
 
-          if (p_q->p_last == p_cur)
-            {
-              p_q->p_last = p_prev;
-            }
+  return OMX_ErrorNoMore;
+}
 
-          if (p_q->pp_store[p_cur->priority] == p_cur)
+#ifndef NDEBUG
+/* Only compares addresses, as a stale handle points to freed memory */
+static bool
+is_queued (const tiz_pqueue_t * p_q, const tiz_pqueue_item_t * ap_item)
+{
+  const tiz_pqueue_item_t * p_cur = NULL;
+  OMX_S32 prio = 0;
+  for (prio = first_group (p_q, 0); prio >= 0;
+       prio = first_group (p_q, prio + 1))
+    {
+      for (p_cur = p_q->p_groups[prio].p_first; p_cur; p_cur = p_cur->p_next)
+        {
+          if (p_cur == ap_item)
             {
-              if ((p_next) && (p_next->priority == p_cur->priority))
-                {
-                  p_q->pp_store[p_cur->priority] = p_next;
-                }
-              else
-                {
-                  p_q->pp_store[p_cur->priority] = NULL;
-                }
+              return true;
             }
-
-          pqueue_free (p_q->p_soa, p_cur);
-          p_q->length--;
-          rc = OMX_ErrorNone;
-          /* DONE */
-          break;
         }
-      p_cur = p_cur->p_next;
     }
+  return false;
+}
+#endif
 
-  return rc;
+OMX_ERRORTYPE
+tiz_pqueue_remove_handle (tiz_pqueue_t * p_q, tiz_pqueue_handle_t ap_handle,
+                          void ** app_data)
+{
+  assert (p_q);
+  assert (ap_handle);
+  /* The item must not have been received or removed already; its memory has
+     been released, and removing it again would free it twice */
+  assert (is_queued (p_q, ap_handle));
+  assert (ap_handle->priority >= 0);
+  assert (ap_handle->priority <= p_q->max_prio);
+
+  if (app_data)
+    {
+      *app_data = ap_handle->p_data;
+    }
+  remove_item (p_q, ap_handle);
+
+  return OMX_ErrorNone;
 }
 
 OMX_S32
@@ -430,8 +443,8 @@ tiz_pqueue_remove_func (tiz_pqueue_t * p_q, tiz_pq_func_f a_pf_func,
 {
   tiz_pqueue_item_t * p_cur = NULL;
   tiz_pqueue_item_t * p_next = NULL;
-  tiz_pqueue_item_t * p_prev = NULL;
   OMX_S32 initial_item_count = 0;
+  OMX_S32 prio = 0;
 
   assert (p_q);
   assert (a_pf_func);
@@ -439,58 +452,18 @@ tiz_pqueue_remove_func (tiz_pqueue_t * p_q, tiz_pq_func_f a_pf_func,
 
   initial_item_count = p_q->length;
 
-  p_cur = p_q->p_first;
-  while (p_cur)
+  for (prio = first_group (p_q, 0); prio >= 0;
+       prio = first_group (p_q, prio + 1))
     {
-      if (OMX_TRUE == a_pf_func (p_cur->p_data, a_data1, ap_data2))
+      for (p_cur = p_q->p_groups[prio].p_first; p_cur; p_cur = p_next)
         {
           p_next = p_cur->p_next;
-          p_prev = p_cur->p_prev;
-
-          if (p_next)
-            {
-              p_next->p_prev = p_prev;
-            }
-
-          if (p_prev)
-            {
-              p_prev->p_next = p_next;
-            }
-
-          if (p_q->p_first == p_cur)
-            {
-              p_q->p_first = p_next;
-            }
-
-          if (p_q->p_last == p_cur)
-            {
-              p_q->p_last = p_prev;
-            }
-
-          if (p_q->pp_store[p_cur->priority] == p_cur)
+          if (OMX_TRUE == a_pf_func (p_cur->p_data, a_data1, ap_data2))
             {
-              if ((p_next) && (p_next->priority == p_cur->priority))
-                {
-                  p_q->pp_store[p_cur->priority] = p_next;
-                }
-              else
-                {
-                  p_q->pp_store[p_cur->priority] = NULL;
-                }
+              /* NOTE: We continue here to remove as many matching items as
+               * possible */
+              remove_item (p_q, p_cur);
             }
-
-          {
-            tiz_pqueue_item_t * p_to_delete = p_cur;
-            p_cur = p_cur->p_next;
-            pqueue_free (p_q->p_soa, p_to_delete);
-            p_q->length--;
-            /* NOTE: We continue here to remove as many matching items as
-             * possible */
-          }
-        }
-      else
-        {
-          p_cur = p_cur->p_next;
         }
     }
 
@@ -507,13 +480,14 @@ tiz_pqueue_first (tiz_pqueue_t * p_q, void ** app_data)
 
   if (0 >= p_q->length)
     {
-      assert (p_q->p_first == p_q->p_last);
       rc = OMX_ErrorNoMore;
     }
   else
     {
-      assert (p_q->p_first);
-      *app_data = p_q->p_first->p_data;
+      const OMX_S32 prio = first_group (p_q, 0);
+      assert (prio >= 0);
+      assert (p_q->p_groups[prio].p_first);
+      *app_data = p_q->p_groups[prio].p_first->p_data;
     }
 
   return rc;
@@ -530,18 +504,34 @@ OMX_S32
 tiz_pqueue_dump (tiz_pqueue_t * p_q, tiz_pq_dump_item_f a_pf_dump)
 {
   tiz_pqueue_item_t * p_current = NULL;
+  tiz_pqueue_item_t * p_prev = NULL;
+  tiz_pqueue_item_t * p_next = NULL;
   OMX_S32 count = 0;
+  OMX_S32 prio = 0;
 
   assert (p_q);
   assert (a_pf_dump);
 
-  p_current = p_q->p_first;
-  while (p_current)
+  /* The neighbours reported are those in the queue's overall order, i.e.
+     across priority groups */
+  for (prio = first_group (p_q, 0); prio >= 0;
+       prio = first_group (p_q, prio + 1))
     {
-      a_pf_dump (p_q->name, p_current->p_data, p_current->priority, p_current,
-                 p_current->p_prev, p_current->p_next);
-      p_current = p_current->p_next;
-      count++;
+      for (p_current = p_q->p_groups[prio].p_first; p_current;
+           p_current = p_current->p_next)
+        {
+          p_next = p_current->p_next;
+          if (!p_next)
+            {
+              const OMX_S32 next_prio = first_group (p_q, prio + 1);
+              p_next
+                = next_prio >= 0 ? p_q->p_groups[next_prio].p_first : NULL;
+            }
+          a_pf_dump (p_q->name, p_current->p_data, p_current->priority,
+                     p_current, p_prev, p_next);
+          p_prev = p_current;
+          count++;
+        }
     }
 
   return count;
@@ -53,6 +53,14 @@ extern "C" {
  */
 typedef struct tiz_pqueue tiz_pqueue_t;
 
+/**
+ * Handle to an item in a priority queue (see tiz_pqueue_send_with_handle).
+ * A handle remains valid until its item leaves the queue, i.e. until it is
+ * received or removed by any of the removal functions.
+ * @ingroup tizpqueue
+ */
+typedef struct tiz_pqueue_item * tiz_pqueue_handle_t;
+
 /**
  * \typedef The comparison function to be used by the removal functions
  * tiz_pqueue_remove and tiz_pqueue_removep.
@@ -157,6 +165,22 @@ tiz_pqueue_destroy (/*@null@ */ tiz_pqueue_t * ap_pq);
 OMX_ERRORTYPE
 tiz_pqueue_send (tiz_pqueue_t * ap_pq, void * ap_data, OMX_S32 a_prio);
 
+/**
+ * Add an item to the end of the priority group a_prio, and return a handle
+ * that can be used to remove it from the queue in constant time (see
+ * tiz_pqueue_remove_handle).
+ *
+ * @ingroup tizpqueue
+ *
+ * @param ap_handle If not NULL, receives the handle of the new item
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise
+ *
+ */
+OMX_ERRORTYPE
+tiz_pqueue_send_with_handle (tiz_pqueue_t * ap_pq, void * ap_data,
+                             OMX_S32 a_prio, tiz_pqueue_handle_t * ap_handle);
+
 /**
  * Receive the first item from the queue. The item received is no longer in
  * the queue.
@@ -194,6 +218,26 @@ tiz_pqueue_remove (tiz_pqueue_t * ap_pq, void * ap_data);
 OMX_ERRORTYPE
 tiz_pqueue_removep (tiz_pqueue_t * ap_pq, void * ap_data, OMX_S32 a_priority);
 
+/**
+ * Remove an item from the queue, in constant time, using the handle obtained
+ * when it was sent.
+ *
+ * @pre The item must still be in the queue. Once an item has been received,
+ * or removed by any means, its handle refers to released memory: the caller
+ * must stop using it at that point (debug builds assert this, at linear
+ * cost). Removing an item twice would release its memory twice.
+ *
+ * @param app_data If not NULL, receives the data of the item removed.
+ *
+ * @return OMX_ErrorNone
+ *
+ * @ingroup tizpqueue
+ *
+ */
+OMX_ERRORTYPE
+tiz_pqueue_remove_handle (tiz_pqueue_t * ap_pq, tiz_pqueue_handle_t ap_handle,
+                          void ** app_data);
+
 /**
  * Remove from the queue all the items found using the comparison function
  * apf_func.
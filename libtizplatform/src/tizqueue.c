@@ -34,6 +34,11 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -63,6 +68,12 @@
     }                                                                       \
   while (0)
 
+#define TIZ_Q_CACHE_LINE_SIZE 64
+
+#define TIZ_Q_IS_LOCK_FREE(q)                                                  \
+  (((q)->flags & (TIZ_QUEUE_FLAG_LOCK_FREE_SPSC | TIZ_QUEUE_FLAG_LOCK_FREE_MPSC)) \
+   != 0)
+
 typedef struct tiz_queue_item tiz_queue_item_t;
 struct tiz_queue_item
 {
@@ -70,43 +81,93 @@ struct tiz_queue_item
   tiz_queue_item_t * p_next;
 };
 
+/* A slot in the lock-free ring. 'seq' tells producers and consumer whose turn
+   it is to use the slot (D. Vyukov's bounded queue algorithm) */
+typedef struct tiz_queue_cell tiz_queue_cell_t;
+struct tiz_queue_cell
+{
+  size_t seq;
+  OMX_PTR p_data;
+};
+
 struct tiz_queue
 {
+  OMX_U32 flags;
+  OMX_S32 capacity;
+  /* Locked implementation */
   /*@null@ */ tiz_queue_item_t * p_first;
   /*@null@ */ tiz_queue_item_t * p_last;
-  OMX_S32 capacity;
   OMX_S32 length;
   tiz_mutex_t mutex;
   tiz_cond_t cond_full;
   tiz_cond_t cond_empty;
+  /* Lock-free implementation */
+  /*@null@ */ tiz_queue_cell_t * p_cells;
+  size_t mask;
+  char pad0[TIZ_Q_CACHE_LINE_SIZE];
+  size_t head; /* next position to be claimed by a producer */
+  int not_full_ftx;
+  int producers_waiting;
+  char pad1[TIZ_Q_CACHE_LINE_SIZE];
+  size_t tail; /* next position to be read by the consumer */
+  int not_empty_ftx;
+  int consumer_waiting;
+  char pad2[TIZ_Q_CACHE_LINE_SIZE];
 };
 
+static inline void
+futex_wait (int * ap_addr, const int a_val)
+{
+  /* EAGAIN (the value has already changed) and EINTR are both fine here: the
+     callers always re-check the ring after returning */
+  (void) syscall (SYS_futex, ap_addr, FUTEX_WAIT_PRIVATE, a_val, NULL, NULL,
+                  0);
+}
+
+static inline void
+futex_wake (int * ap_addr, const int a_count)
+{
+  (void) syscall (SYS_futex, ap_addr, FUTEX_WAKE_PRIVATE, a_count, NULL, NULL,
+                  0);
+}
+
 static inline void
 deinit_queue_struct (/*@null@ */ tiz_queue_t * ap_q)
 {
   /* Clean-up */
   if (ap_q)
     {
-      (void) tiz_cond_destroy (&(ap_q->cond_empty));
-      (void) tiz_cond_destroy (&(ap_q->cond_full));
-      (void) tiz_mutex_destroy (&(ap_q->mutex));
+      if (TIZ_Q_IS_LOCK_FREE (ap_q))
+        {
+          tiz_mem_free (ap_q->p_cells);
+        }
+      else
+        {
+          (void) tiz_cond_destroy (&(ap_q->cond_empty));
+          (void) tiz_cond_destroy (&(ap_q->cond_full));
+          (void) tiz_mutex_destroy (&(ap_q->mutex));
+        }
       tiz_mem_free (ap_q);
     }
 }
 
 /*@null@*/ static tiz_queue_t *
-init_queue_struct (void)
+init_queue_struct (const OMX_U32 a_flags)
 {
   bool init_ok = false;
   tiz_queue_t * p_q = (tiz_queue_t *) tiz_mem_calloc (1, sizeof (tiz_queue_t));
 
   TIZ_Q_GOTO_END_ON_NULL (p_q);
-  TIZ_Q_GOTO_END_ON_ERROR (tiz_mutex_init (&(p_q->mutex)));
-  TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_full)));
-  TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_empty)));
-  p_q->p_first
-    = (tiz_queue_item_t *) tiz_mem_calloc (1, sizeof (tiz_queue_item_t));
-  TIZ_Q_GOTO_END_ON_NULL (p_q->p_first);
+  p_q->flags = a_flags;
+  if (!TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      TIZ_Q_GOTO_END_ON_ERROR (tiz_mutex_init (&(p_q->mutex)));
+      TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_full)));
+      TIZ_Q_GOTO_END_ON_ERROR (tiz_cond_init (&(p_q->cond_empty)));
+      p_q->p_first
+        = (tiz_queue_item_t *) tiz_mem_calloc (1, sizeof (tiz_queue_item_t));
+      TIZ_Q_GOTO_END_ON_NULL (p_q->p_first);
+    }
 
   /* All OK */
   init_ok = true;
@@ -122,59 +183,121 @@ end:
   return p_q;
 }
 
-OMX_ERRORTYPE
-tiz_queue_init (tiz_queue_ptr_t * app_q, OMX_S32 a_capacity)
+static OMX_ERRORTYPE
+init_locked_items (tiz_queue_t * ap_q, const OMX_S32 a_capacity)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   tiz_queue_item_t * p_new_item = NULL;
   tiz_queue_item_t * p_cur_item = NULL;
-  tiz_queue_t * p_q = NULL;
+  int i = 0;
 
-  assert (app_q);
+  assert (ap_q);
 
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "queue capacity [%d]", a_capacity);
+  ap_q->capacity = a_capacity;
+  ap_q->length = 0;
 
-  assert (a_capacity > 0);
+  p_cur_item = ap_q->p_last = ap_q->p_first;
+  assert (p_cur_item);
 
-  if ((p_q = init_queue_struct ()))
+  for (i = 0; i < (a_capacity - 1); ++i)
     {
-      int i = 0;
-      p_q->capacity = a_capacity;
-      p_q->length = 0;
-
-      p_cur_item = p_q->p_last = p_q->p_first;
-      assert (p_cur_item);
-
-      for (i = 0; i < (a_capacity - 1); ++i)
+      if ((p_new_item
+           = (tiz_queue_item_t *) tiz_mem_calloc (1, sizeof (tiz_queue_item_t))))
         {
-          if ((p_new_item = (tiz_queue_item_t *) tiz_mem_calloc (
-                 1, sizeof (tiz_queue_item_t))))
-            {
-              p_cur_item->p_next = p_new_item;
-              p_cur_item = p_new_item;
-            }
-          else
+          p_cur_item->p_next = p_new_item;
+          p_cur_item = p_new_item;
+        }
+      else
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR,
+                   "[OMX_ErrorInsufficientResources]: "
+                   "Could not instantiate queue items.");
+          rc = OMX_ErrorInsufficientResources;
+
+          /* Clean-up */
+          while (ap_q->p_first)
             {
-              TIZ_LOG (TIZ_PRIORITY_ERROR,
-                       "[OMX_ErrorInsufficientResources]: "
-                       "Could not instantiate queue items.");
-              rc = OMX_ErrorInsufficientResources;
-
-              /* Clean-up */
-              while (p_q->p_first)
-                {
-                  p_cur_item = p_q->p_first->p_next;
-                  tiz_mem_free ((OMX_PTR) p_q->p_first);
-                  p_q->p_first = p_cur_item;
-                }
-              /* end loop  */
-              break;
+              p_cur_item = ap_q->p_first->p_next;
+              tiz_mem_free ((OMX_PTR) ap_q->p_first);
+              ap_q->p_first = p_cur_item;
             }
-        } /* for */
+          /* end loop  */
+          break;
+        }
+    } /* for */
+
+  if (OMX_ErrorNone == rc)
+    {
+      p_cur_item->p_next = ap_q->p_first;
+    }
+
+  return rc;
+}
 
+static OMX_ERRORTYPE
+init_lock_free_cells (tiz_queue_t * ap_q, const OMX_S32 a_capacity)
+{
+  size_t ncells = 1;
+  size_t i = 0;
+
+  assert (ap_q);
+
+  while (ncells < (size_t) a_capacity)
+    {
+      ncells <<= 1;
+    }
+
+  if (!(ap_q->p_cells = (tiz_queue_cell_t *) tiz_mem_calloc (
+          ncells, sizeof (tiz_queue_cell_t))))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR,
+               "[OMX_ErrorInsufficientResources]: "
+               "Could not instantiate queue cells.");
+      return OMX_ErrorInsufficientResources;
+    }
+
+  for (i = 0; i < ncells; ++i)
+    {
+      ap_q->p_cells[i].seq = i;
+    }
+
+  ap_q->capacity = (OMX_S32) ncells;
+  ap_q->mask = ncells - 1;
+  ap_q->head = 0;
+  ap_q->tail = 0;
+
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_queue_init (tiz_queue_ptr_t * app_q, OMX_S32 a_capacity)
+{
+  return tiz_queue_init_with_flags (app_q, a_capacity, TIZ_QUEUE_FLAG_LOCKED);
+}
+
+OMX_ERRORTYPE
+tiz_queue_init_with_flags (tiz_queue_ptr_t * app_q, OMX_S32 a_capacity,
+                           OMX_U32 a_flags)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  tiz_queue_t * p_q = NULL;
+
+  assert (app_q);
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "queue capacity [%d] flags [0x%x]", a_capacity,
+           a_flags);
+
+  assert (a_capacity > 0);
+  assert (a_flags == TIZ_QUEUE_FLAG_LOCKED
+          || a_flags == TIZ_QUEUE_FLAG_LOCK_FREE_SPSC
+          || a_flags == TIZ_QUEUE_FLAG_LOCK_FREE_MPSC);
+
+  if ((p_q = init_queue_struct (a_flags)))
+    {
+      rc = TIZ_Q_IS_LOCK_FREE (p_q) ? init_lock_free_cells (p_q, a_capacity)
+                                    : init_locked_items (p_q, a_capacity);
       if (OMX_ErrorNone == rc)
         {
-          p_cur_item->p_next = p_q->p_first;
           TIZ_LOG (TIZ_PRIORITY_TRACE, "queue created [%p]", p_q);
         }
     }
@@ -219,6 +342,152 @@ tiz_queue_destroy (/*@null@ */ tiz_queue_t * p_q)
     }
 }
 
+static inline OMX_S32
+lf_length (tiz_queue_t * ap_q)
+{
+  /* A snapshot; may include items that are still being published */
+  const size_t tail = __atomic_load_n (&(ap_q->tail), __ATOMIC_ACQUIRE);
+  const size_t head = __atomic_load_n (&(ap_q->head), __ATOMIC_ACQUIRE);
+  const OMX_S32 length = (OMX_S32) (head - tail);
+  return MIN (MAX (length, 0), ap_q->capacity);
+}
+
+static inline bool
+lf_try_send (tiz_queue_t * ap_q, OMX_PTR ap_data)
+{
+  const bool single_producer
+    = (ap_q->flags & TIZ_QUEUE_FLAG_LOCK_FREE_SPSC) != 0;
+  tiz_queue_cell_t * p_cell = NULL;
+  size_t pos = __atomic_load_n (&(ap_q->head), __ATOMIC_RELAXED);
+
+  for (;;)
+    {
+      size_t seq = 0;
+      intptr_t diff = 0;
+      p_cell = &(ap_q->p_cells[pos & ap_q->mask]);
+      seq = __atomic_load_n (&(p_cell->seq), __ATOMIC_ACQUIRE);
+      diff = (intptr_t) seq - (intptr_t) pos;
+      if (0 == diff)
+        {
+          if (single_producer)
+            {
+              __atomic_store_n (&(ap_q->head), pos + 1, __ATOMIC_RELAXED);
+              break;
+            }
+          /* On failure, 'pos' is refreshed with the current head */
+          if (__atomic_compare_exchange_n (&(ap_q->head), &pos, pos + 1, true,
+                                           __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+              break;
+            }
+        }
+      else if (diff < 0)
+        {
+          /* The ring is full */
+          return false;
+        }
+      else
+        {
+          pos = __atomic_load_n (&(ap_q->head), __ATOMIC_RELAXED);
+        }
+    }
+
+  p_cell->p_data = ap_data;
+  __atomic_store_n (&(p_cell->seq), pos + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static inline bool
+lf_try_receive (tiz_queue_t * ap_q, OMX_PTR * app_data)
+{
+  /* There is only one consumer, so 'tail' is never contended */
+  const size_t pos = __atomic_load_n (&(ap_q->tail), __ATOMIC_RELAXED);
+  tiz_queue_cell_t * p_cell = &(ap_q->p_cells[pos & ap_q->mask]);
+  const size_t seq = __atomic_load_n (&(p_cell->seq), __ATOMIC_ACQUIRE);
+
+  if ((intptr_t) seq - (intptr_t) (pos + 1) < 0)
+    {
+      /* Empty, or the next producer in line has not published yet */
+      return false;
+    }
+
+  *app_data = p_cell->p_data;
+  p_cell->p_data = NULL;
+  __atomic_store_n (&(ap_q->tail), pos + 1, __ATOMIC_RELAXED);
+  __atomic_store_n (&(p_cell->seq), pos + ap_q->mask + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static OMX_ERRORTYPE
+lf_send (tiz_queue_t * ap_q, OMX_PTR ap_data)
+{
+  while (!lf_try_send (ap_q, ap_data))
+    {
+      /* Full; park until the consumer frees a slot */
+      const int epoch
+        = __atomic_load_n (&(ap_q->not_full_ftx), __ATOMIC_ACQUIRE);
+      (void) __atomic_add_fetch (&(ap_q->producers_waiting), 1,
+                                 __ATOMIC_SEQ_CST);
+      if (lf_try_send (ap_q, ap_data))
+        {
+          (void) __atomic_sub_fetch (&(ap_q->producers_waiting), 1,
+                                     __ATOMIC_SEQ_CST);
+          break;
+        }
+      futex_wait (&(ap_q->not_full_ftx), epoch);
+      (void) __atomic_sub_fetch (&(ap_q->producers_waiting), 1,
+                                 __ATOMIC_SEQ_CST);
+    }
+
+  /* Only pay for a syscall if the consumer is actually asleep */
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&(ap_q->consumer_waiting), __ATOMIC_RELAXED)
+      && __atomic_exchange_n (&(ap_q->consumer_waiting), 0, __ATOMIC_ACQ_REL))
+    {
+      (void) __atomic_add_fetch (&(ap_q->not_empty_ftx), 1, __ATOMIC_RELEASE);
+      futex_wake (&(ap_q->not_empty_ftx), 1);
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void
+lf_wake_producers (tiz_queue_t * ap_q)
+{
+  /* Let parked producers sleep until half the ring is free, to avoid waking
+     them up (and having them park again) once per received item */
+  __atomic_thread_fence (__ATOMIC_SEQ_CST);
+  if (__atomic_load_n (&(ap_q->producers_waiting), __ATOMIC_RELAXED) > 0
+      && lf_length (ap_q) <= (ap_q->capacity / 2))
+    {
+      (void) __atomic_add_fetch (&(ap_q->not_full_ftx), 1, __ATOMIC_RELEASE);
+      futex_wake (&(ap_q->not_full_ftx), INT_MAX);
+    }
+}
+
+static OMX_ERRORTYPE
+lf_receive (tiz_queue_t * ap_q, OMX_PTR * app_data)
+{
+  while (!lf_try_receive (ap_q, app_data))
+    {
+      /* Empty; park until a producer publishes an item */
+      const int epoch
+        = __atomic_load_n (&(ap_q->not_empty_ftx), __ATOMIC_ACQUIRE);
+      __atomic_store_n (&(ap_q->consumer_waiting), 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence (__ATOMIC_SEQ_CST);
+      if (lf_try_receive (ap_q, app_data))
+        {
+          __atomic_store_n (&(ap_q->consumer_waiting), 0, __ATOMIC_RELAXED);
+          break;
+        }
+      futex_wait (&(ap_q->not_empty_ftx), epoch);
+    }
+
+  lf_wake_producers (ap_q);
+
+  return OMX_ErrorNone;
+}
+
 OMX_ERRORTYPE
 tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
 {
@@ -226,10 +495,15 @@ tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
 
   assert (p_q);
 
+  if (TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      assert (ap_data);
+      return lf_send (p_q, ap_data);
+    }
+
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
 
   assert (p_q->p_last);
-  assert (NULL == (p_q->p_last->p_data));
   assert (p_q->length <= p_q->capacity);
 
   while (p_q->length == p_q->capacity)
@@ -239,6 +513,8 @@ tiz_queue_send (tiz_queue_t * p_q, OMX_PTR ap_data)
 
   if (OMX_ErrorNone == rc)
     {
+      /* Only true once there is room in the queue */
+      assert (NULL == (p_q->p_last->p_data));
       p_q->p_last->p_data = ap_data;
       p_q->p_last = p_q->p_last->p_next;
       p_q->length++;
@@ -258,6 +534,11 @@ tiz_queue_receive (tiz_queue_t * p_q, OMX_PTR * app_data)
   assert (p_q);
   assert (app_data);
 
+  if (TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      return lf_receive (p_q, app_data);
+    }
+
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
 
   assert (!(p_q->length < 0));
@@ -283,6 +564,49 @@ tiz_queue_receive (tiz_queue_t * p_q, OMX_PTR * app_data)
   return rc;
 }
 
+OMX_ERRORTYPE
+tiz_queue_try_receive (tiz_queue_t * p_q, OMX_PTR * app_data)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_q);
+  assert (app_data);
+
+  if (TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      if (!lf_try_receive (p_q, app_data))
+        {
+          return OMX_ErrorNoMore;
+        }
+      lf_wake_producers (p_q);
+      return OMX_ErrorNone;
+    }
+
+  tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
+
+  if (0 == p_q->length)
+    {
+      rc = OMX_ErrorNoMore;
+    }
+  else
+    {
+      assert (p_q->p_first);
+      assert (p_q->p_first->p_data);
+      *app_data = p_q->p_first->p_data;
+      p_q->p_first->p_data = 0;
+      p_q->p_first = p_q->p_first->p_next;
+      p_q->length--;
+    }
+
+  tiz_check_omx_ret_oom (tiz_mutex_unlock (&(p_q->mutex)));
+  if (OMX_ErrorNone == rc)
+    {
+      tiz_check_omx_ret_oom (tiz_cond_broadcast (&(p_q->cond_full)));
+    }
+
+  return rc;
+}
+
 OMX_S32
 tiz_queue_capacity (tiz_queue_t * p_q)
 {
@@ -290,6 +614,12 @@ tiz_queue_capacity (tiz_queue_t * p_q)
 
   assert (p_q);
 
+  if (TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      /* Immutable after init */
+      return p_q->capacity;
+    }
+
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
 
   capacity = p_q->capacity;
@@ -306,6 +636,11 @@ tiz_queue_length (tiz_queue_t * p_q)
 
   assert (p_q);
 
+  if (TIZ_Q_IS_LOCK_FREE (p_q))
+    {
+      return lf_length (p_q);
+    }
+
   tiz_check_omx_ret_oom (tiz_mutex_lock (&(p_q->mutex)));
 
   length = p_q->length;
@@ -53,6 +53,21 @@ extern "C" {
 typedef struct tiz_queue tiz_queue_t;
 typedef /*@null@ */ tiz_queue_t * tiz_queue_ptr_t;
 
+/**
+ * Queue implementation flags.
+ * @ingroup tizqueue
+ */
+typedef enum tiz_queue_flags
+{
+  /** Mutex and condition variable-based queue (the default). */
+  TIZ_QUEUE_FLAG_LOCKED = 0x00,
+  /** Lock-free bounded ring, one producer thread and one consumer thread. */
+  TIZ_QUEUE_FLAG_LOCK_FREE_SPSC = 0x01,
+  /** Lock-free bounded ring, any number of producer threads and one consumer
+      thread (e.g. a scheduler mailbox). */
+  TIZ_QUEUE_FLAG_LOCK_FREE_MPSC = 0x02
+} tiz_queue_flags_t;
+
 /**
  * Initialize a new empty queue.
  *
@@ -65,6 +80,25 @@ typedef /*@null@ */ tiz_queue_t * tiz_queue_ptr_t;
 OMX_ERRORTYPE
 tiz_queue_init (/*@out@*/ tiz_queue_ptr_t * app_q, OMX_S32 a_capacity);
 
+/**
+ * Initialize a new empty queue using the implementation selected by a_flags.
+ *
+ * The lock-free variants are bounded rings; the capacity is rounded up to the
+ * next power of two. Threads only sleep (on a futex) when the queue is empty
+ * (consumer) or full (producers).
+ *
+ * @ingroup tizqueue
+ *
+ * @param a_capacity Maximum number of items that can be send into the queue.
+ *
+ * @param a_flags One of the tiz_queue_flags_t values.
+ *
+ * @return OMX_ErrorNone if success, OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_queue_init_with_flags (/*@out@*/ tiz_queue_ptr_t * app_q,
+                           OMX_S32 a_capacity, OMX_U32 a_flags);
+
 /**
  * Destroy a queue. If ap_q is NULL, or the queue has already been detroyed
  * before, no operation is performed.
@@ -95,6 +129,17 @@ tiz_queue_send (tiz_queue_t * ap_q, OMX_PTR ap_data);
 OMX_ERRORTYPE
 tiz_queue_receive (tiz_queue_t * ap_q, OMX_PTR * app_data);
 
+/**
+ * Retrieve an item from the head of the queue, without blocking.
+ *
+ * @ingroup tizqueue
+ *
+ * @return OMX_ErrorNone if an item was retrieved, OMX_ErrorNoMore if the
+ * queue is empty.
+ */
+OMX_ERRORTYPE
+tiz_queue_try_receive (tiz_queue_t * ap_q, OMX_PTR * app_data);
+
 /**
  * Retrieve the maximum number of items that can be stored in the queue.
  *
@@ -33,11 +33,17 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
 #include <limits.h>
+#include <poll.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdbool.h>
 #include <ctype.h>
@@ -56,9 +62,15 @@
 #endif
 
 #define PAT_SIZE PATH_MAX
+#define RC_INDEX_INITIAL_SIZE 64
+#define RC_WATCHER_THREAD_NAME "tizrcwatch"
+#define RC_WATCHER_STACK_SIZE (128 * 1024)
+/* Time given to an editor to finish a sequence of writes and renames */
+#define RC_RELOAD_SETTLE_NS (100 * 1000 * 1000)
+/* Time a replaced snapshot is kept, for the strings handed out from it */
+#define RC_RETIRED_GRACE_SEC 30
 
 static char delim[2] = {';', '\000'};
-static char pat[PAT_SIZE];
 
 typedef struct file_info file_info_t;
 struct file_info
@@ -68,6 +80,16 @@ struct file_info
   int exists;
 };
 
+/* The state of a parse. Lines are read into a per-parse buffer, so that a
+   reload may run while another thread parses the file */
+typedef struct rc_parser rc_parser_t;
+struct rc_parser
+{
+  tiz_rcsnapshot_t * p_snap;
+  char * p_section;
+  char pat[PAT_SIZE];
+};
+
 static char * g_list_value_keys[] = {
   "component-paths",
 };
@@ -152,27 +174,168 @@ trimcommenting (char * str)
   return str;
 }
 
+/* FNV-1a */
+static inline uint32_t
+hash_str (uint32_t a_hash, const char * ap_str)
+{
+  while (*ap_str)
+    {
+      a_hash ^= (unsigned char) *ap_str++;
+      a_hash *= 16777619u;
+    }
+  return a_hash;
+}
+
+static inline uint32_t
+hash_key (const char * ap_key)
+{
+  return hash_str (2166136261u, ap_key);
+}
+
+static inline uint32_t
+hash_section_key (const char * ap_section, const char * ap_key)
+{
+  /* The separator keeps "a" + "bc" and "ab" + "c" apart */
+  return hash_str ((hash_str (2166136261u, ap_section) ^ '\n') * 16777619u,
+                   ap_key);
+}
+
 static keyval_t *
-find_node (const tiz_rcfile_t * ap_rc, const char * key)
+index_find (keyval_t * const * app_index, const size_t a_size,
+            const uint32_t a_hash, const char * ap_section,
+            const char * ap_key)
 {
-  keyval_t * p_kvs = NULL;
+  const size_t mask = a_size - 1;
+  size_t i = a_hash & mask;
 
-  assert (ap_rc);
-  assert (key);
+  for (; app_index[i]; i = (i + 1) & mask)
+    {
+      if (0 == strcmp (app_index[i]->p_key, ap_key)
+          && (!ap_section || 0 == strcmp (app_index[i]->p_section, ap_section)))
+        {
+          return app_index[i];
+        }
+    }
+  return NULL;
+}
 
-  p_kvs = ap_rc->p_keyvals;
+/* Later definitions of a key replace the earlier ones in the key index, the
+   way they did when sections were ignored */
+static void
+index_insert (keyval_t ** app_index, const size_t a_size,
+              const uint32_t a_hash, keyval_t * ap_kv, const bool a_by_section)
+{
+  const size_t mask = a_size - 1;
+  size_t i = a_hash & mask;
 
-  while (p_kvs && p_kvs->p_key)
+  for (; app_index[i]; i = (i + 1) & mask)
     {
-      if (0 == strncmp (p_kvs->p_key, key, PATH_MAX))
+      if (0 == strcmp (app_index[i]->p_key, ap_kv->p_key)
+          && (!a_by_section
+              || 0 == strcmp (app_index[i]->p_section, ap_kv->p_section)))
         {
-          return p_kvs;
+          break;
         }
-      p_kvs = p_kvs->p_next;
     }
+  app_index[i] = ap_kv;
+}
 
-  TIZ_LOG (TIZ_PRIORITY_TRACE, "Key not found [%s] [%p]", key, p_kvs);
-  return NULL;
+static int
+index_grow (tiz_rcsnapshot_t * ap_snap)
+{
+  const size_t old_size = ap_snap->index_size;
+  const size_t new_size = old_size ? old_size * 2 : RC_INDEX_INITIAL_SIZE;
+  keyval_t ** pp_index = tiz_mem_calloc (new_size, sizeof (keyval_t *));
+  keyval_t ** pp_key_index = tiz_mem_calloc (new_size, sizeof (keyval_t *));
+  size_t i = 0;
+
+  if (!pp_index || !pp_key_index)
+    {
+      tiz_mem_free (pp_index);
+      tiz_mem_free (pp_key_index);
+      return -1;
+    }
+
+  for (i = 0; i < old_size; ++i)
+    {
+      keyval_t * p_kv = ap_snap->pp_index[i];
+      if (p_kv)
+        {
+          index_insert (pp_index, new_size,
+                        hash_section_key (p_kv->p_section, p_kv->p_key), p_kv,
+                        true);
+        }
+      p_kv = ap_snap->pp_key_index[i];
+      if (p_kv)
+        {
+          index_insert (pp_key_index, new_size, hash_key (p_kv->p_key), p_kv,
+                        false);
+        }
+    }
+
+  tiz_mem_free (ap_snap->pp_index);
+  tiz_mem_free (ap_snap->pp_key_index);
+  ap_snap->pp_index = pp_index;
+  ap_snap->pp_key_index = pp_key_index;
+  ap_snap->index_size = new_size;
+  return 0;
+}
+
+static int
+index_add (tiz_rcsnapshot_t * ap_snap, keyval_t * ap_kv, const size_t a_nkeys)
+{
+  /* Keep the load factor under 3/4 */
+  if ((a_nkeys + 1) * 4 > ap_snap->index_size * 3
+      && 0 != index_grow (ap_snap))
+    {
+      return -1;
+    }
+  index_insert (ap_snap->pp_index, ap_snap->index_size,
+                hash_section_key (ap_kv->p_section, ap_kv->p_key), ap_kv,
+                true);
+  index_insert (ap_snap->pp_key_index, ap_snap->index_size,
+                hash_key (ap_kv->p_key), ap_kv, false);
+  return 0;
+}
+
+/* A NULL section finds the last definition of the key in any section */
+static keyval_t *
+find_node (const tiz_rcsnapshot_t * ap_snap, const char * section,
+           const char * key)
+{
+  keyval_t * p_kv = NULL;
+
+  assert (ap_snap);
+  assert (key);
+
+  if (ap_snap->index_size > 0)
+    {
+      p_kv = section ? index_find (ap_snap->pp_index, ap_snap->index_size,
+                                   hash_section_key (section, key), section,
+                                   key)
+                     : index_find (ap_snap->pp_key_index, ap_snap->index_size,
+                                   hash_key (key), NULL, key);
+    }
+
+  if (!p_kv)
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "Key not found [%s] [%p]", key, p_kv);
+    }
+  return p_kv;
+}
+
+/* Sections were historically ignored, and some callers still use names that
+   are not in the file (e.g. "il-core"); fall back to the key alone */
+static keyval_t *
+lookup_node (const tiz_rcsnapshot_t * ap_snap, const char * section,
+             const char * key)
+{
+  keyval_t * p_kv = NULL;
+  if (!section || !(p_kv = find_node (ap_snap, section, key)))
+    {
+      p_kv = find_node (ap_snap, NULL, key);
+    }
+  return p_kv;
 }
 
 static bool
@@ -191,7 +354,7 @@ is_list (const char * key)
 }
 
 static int
-get_node (const tiz_rcfile_t * ap_rc, char * str, keyval_t ** app_kv)
+get_node (rc_parser_t * ap_parser, char * str, keyval_t ** app_kv)
 {
   int ret = 0;
   char * needle = strstr (str, "=");
@@ -199,11 +362,12 @@ get_node (const tiz_rcfile_t * ap_rc, char * str, keyval_t ** app_kv)
   char * value_start = str + (needle - str) + 1;
   char * value = strndup (trimlistseparator (trimwhitespace (value_start)),
                           strlen (str) - (needle - str));
+  tiz_rcsnapshot_t * p_snap = ap_parser->p_snap;
   keyval_t * p_kv = NULL;
   value_t * p_v = NULL;
   value_t * p_next_v = NULL;
 
-  assert (ap_rc);
+  assert (p_snap);
   assert (str);
   assert (app_kv);
 
@@ -211,15 +375,20 @@ get_node (const tiz_rcfile_t * ap_rc, char * str, keyval_t ** app_kv)
   TIZ_LOG (TIZ_PRIORITY_TRACE, "val : [%s]",
            trimlistseparator (trimwhitespace (value)));
 
-  /* Find if the key exists already */
-  p_kv = find_node (ap_rc, key);
+  /* Find if the key exists already in this section */
+  p_kv = find_node (p_snap, ap_parser->p_section, key);
   if (!p_kv)
     {
       p_kv = (keyval_t *) tiz_mem_calloc (1, sizeof (keyval_t));
       p_v = (value_t *) tiz_mem_calloc (1, sizeof (value_t));
 
-      if (!p_kv || !p_v)
+      if (!p_kv || !p_v
+          || !(p_kv->p_section = strndup (ap_parser->p_section, PATH_MAX)))
         {
+          if (p_kv)
+            {
+              tiz_mem_free (p_kv->p_section);
+            }
           tiz_mem_free (p_kv);
           p_kv = NULL;
           tiz_mem_free (p_v);
@@ -260,6 +429,10 @@ get_node (const tiz_rcfile_t * ap_rc, char * str, keyval_t ** app_kv)
               p_v->p_value = value;
             }
           ret = 1;
+          /* The node is linked into the list by the caller, and counted
+             there; it goes into the index now, so that repeated keys are
+             found while parsing */
+          (void) index_add (p_snap, p_kv, p_snap->count);
         }
     }
   else
@@ -309,15 +482,16 @@ get_node (const tiz_rcfile_t * ap_rc, char * str, keyval_t ** app_kv)
 
 static int
 extractkeyval (FILE * ap_file, char * ap_str, keyval_t ** app_last_kv,
-               tiz_rcfile_t * ap_tiz_rcfile)
+               rc_parser_t * ap_parser)
 {
   int len;
   int ret = 0;
   int is_new = 0;
   keyval_t * p_kv = NULL;
   value_t *p_v = NULL, *p_next_v = NULL;
+  char * pat = ap_parser->pat;
 
-  is_new = get_node (ap_tiz_rcfile, ap_str, &p_kv);
+  is_new = get_node (ap_parser, ap_str, &p_kv);
 
   if (!p_kv)
     {
@@ -381,7 +555,7 @@ extractkeyval (FILE * ap_file, char * ap_str, keyval_t ** app_last_kv,
 
 static int
 analyze_pattern (FILE * ap_file, char * ap_str, keyval_t ** app_last_kv,
-                 tiz_rcfile_t * ap_tiz_rcfile)
+                 rc_parser_t * ap_parser)
 {
   if (strstr (ap_str, "#"))
     {
@@ -393,40 +567,52 @@ analyze_pattern (FILE * ap_file, char * ap_str, keyval_t ** app_last_kv,
     {
       char * str = trimsectioning (ap_str);
       TIZ_LOG (TIZ_PRIORITY_TRACE, "Section : [%s]", str);
-      (void) str;
+      tiz_mem_free (ap_parser->p_section);
+      ap_parser->p_section = strndup (trimwhitespace (str), PATH_MAX);
     }
   else if (strstr (ap_str, "="))
     {
       TIZ_LOG (TIZ_PRIORITY_TRACE, "key-value pair : [%s]", ap_str);
-      return extractkeyval (ap_file, ap_str, app_last_kv, ap_tiz_rcfile);
+      return extractkeyval (ap_file, ap_str, app_last_kv, ap_parser);
     }
 
   return 0;
 }
 
 static int
-load_rc_file (const file_info_t * ap_finfo, tiz_rcfile_t * ap_tiz_rcfile)
+load_rc_file (const char * ap_path, tiz_rcsnapshot_t * ap_snap)
 {
   FILE * p_file = 0;
   int len;
   keyval_t **pp_last_kv = NULL, *p_kv = NULL;
+  rc_parser_t * p_parser = NULL;
+  char * pat = NULL;
+
+  assert (ap_path);
+  assert (ap_snap);
 
-  assert (ap_finfo);
-  assert (ap_finfo->name);
-  assert (ap_tiz_rcfile);
+  if ((p_file = fopen (ap_path, "r")) == 0)
+    {
+      return -1;
+    }
 
-  if ((p_file = fopen (ap_finfo->name, "r")) == 0)
+  if (!(p_parser = tiz_mem_calloc (1, sizeof (rc_parser_t)))
+      || !(p_parser->p_section = strndup ("", PATH_MAX)))
     {
+      tiz_mem_free (p_parser);
+      fclose (p_file);
       return -1;
     }
+  p_parser->p_snap = ap_snap;
+  pat = p_parser->pat;
 
-  if (!ap_tiz_rcfile->p_keyvals)
+  if (!ap_snap->p_keyvals)
     {
-      pp_last_kv = &ap_tiz_rcfile->p_keyvals;
+      pp_last_kv = &ap_snap->p_keyvals;
     }
   else
     {
-      p_kv = ap_tiz_rcfile->p_keyvals;
+      p_kv = ap_snap->p_keyvals;
       for (;;)
         {
           if (!p_kv || !p_kv->p_next)
@@ -456,23 +642,25 @@ load_rc_file (const file_info_t * ap_finfo, tiz_rcfile_t * ap_tiz_rcfile)
           pat[len - 1] = '\0';
         }
 
-      while (analyze_pattern (p_file, pat, pp_last_kv, ap_tiz_rcfile))
+      while (analyze_pattern (p_file, pat, pp_last_kv, p_parser))
         {
           if (pp_last_kv && *pp_last_kv)
             {
               pp_last_kv = &(*pp_last_kv)->p_next;
-              ap_tiz_rcfile->count++;
+              ap_snap->count++;
             }
         };
 
       if (pp_last_kv && *pp_last_kv)
         {
           pp_last_kv = &(*pp_last_kv)->p_next;
-          ap_tiz_rcfile->count++;
+          ap_snap->count++;
         }
     }
 
   fclose (p_file);
+  tiz_mem_free (p_parser->p_section);
+  tiz_mem_free (p_parser);
 
   return 0;
 }
@@ -490,6 +678,257 @@ stat_ctime (const char * path, time_t * time)
   return statret;
 }
 
+static void
+destroy_snapshot (tiz_rcsnapshot_t * ap_snap)
+{
+  keyval_t * p_kv_lst = NULL;
+  keyval_t * p_kvt = NULL;
+  value_t * p_val_lst = NULL;
+
+  if (!ap_snap)
+    {
+      return;
+    }
+
+  p_kv_lst = ap_snap->p_keyvals;
+  while (p_kv_lst)
+    {
+      value_t * p_vt = NULL;
+      tiz_mem_free (p_kv_lst->p_section);
+      tiz_mem_free (p_kv_lst->p_key);
+      p_val_lst = p_kv_lst->p_value_list;
+      while (p_val_lst)
+        {
+          p_vt = p_val_lst;
+          p_val_lst = p_val_lst->p_next;
+          tiz_mem_free (p_vt->p_value);
+          tiz_mem_free (p_vt);
+        }
+      p_kvt = p_kv_lst;
+      p_kv_lst = p_kv_lst->p_next;
+      tiz_mem_free (p_kvt);
+    }
+
+  tiz_mem_free (ap_snap->pp_index);
+  tiz_mem_free (ap_snap->pp_key_index);
+  tiz_mem_free (ap_snap);
+}
+
+/* Loads the first readable file, in order of precedence */
+static tiz_rcsnapshot_t *
+load_snapshot (char * const * app_paths)
+{
+  tiz_rcsnapshot_t * p_snap = NULL;
+  int i;
+
+  for (i = (g_num_rcfiles - 1); i >= 0; --i)
+    {
+      if (!app_paths[i])
+        {
+          continue;
+        }
+
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "Checking for rc file [%d] at [%s]", i,
+               app_paths[i]);
+      /* Check file existence and user's read access */
+      if (0 != access (app_paths[i], R_OK))
+        {
+          TIZ_LOG (TIZ_PRIORITY_TRACE,
+                   "rc file [%s] does not exist or "
+                   "user has no read access permission",
+                   app_paths[i]);
+          continue;
+        }
+
+      if (!(p_snap = tiz_mem_calloc (1, sizeof (tiz_rcsnapshot_t))))
+        {
+          TIZ_LOG (TIZ_PRIORITY_TRACE,
+                   "Could not allocate memory "
+                   "for tiz_rcsnapshot_t...");
+          return NULL;
+        }
+
+      if (0 != load_rc_file (app_paths[i], p_snap))
+        {
+          TIZ_LOG (TIZ_PRIORITY_TRACE, "Loading [%s] rc file failed",
+                   app_paths[i]);
+          destroy_snapshot (p_snap);
+          p_snap = NULL;
+          continue;
+        }
+
+      TIZ_LOG (TIZ_PRIORITY_DEBUG, "Loading [%s] rc file succeeded",
+               app_paths[i]);
+
+      /* We only need to load one file */
+      break;
+    }
+
+  if (p_snap && 0 == p_snap->count)
+    {
+      destroy_snapshot (p_snap);
+      p_snap = NULL;
+    }
+
+  return p_snap;
+}
+
+static inline tiz_rcsnapshot_t *
+current_snapshot (const tiz_rcfile_t * ap_rc)
+{
+  return __atomic_load_n (&(ap_rc->p_snapshot), __ATOMIC_ACQUIRE);
+}
+
+static time_t
+monotonic_seconds (void)
+{
+  struct timespec now;
+  (void) clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec;
+}
+
+/* Frees the snapshots that were replaced more than the grace period ago */
+static void
+reclaim_retired (tiz_rcfile_t * ap_rc)
+{
+  const time_t now = monotonic_seconds ();
+  tiz_rcsnapshot_t ** pp_snap = &(ap_rc->p_retired);
+
+  /* The list is ordered newest first; everything past the first expired
+     snapshot has expired too */
+  while (*pp_snap && now - (*pp_snap)->retired_at < ap_rc->retired_grace)
+    {
+      pp_snap = &((*pp_snap)->p_retired_next);
+    }
+
+  while (*pp_snap)
+    {
+      tiz_rcsnapshot_t * p_snap = *pp_snap;
+      *pp_snap = p_snap->p_retired_next;
+      destroy_snapshot (p_snap);
+    }
+}
+
+static void
+reload (tiz_rcfile_t * ap_rc)
+{
+  tiz_rcsnapshot_t * p_snap = load_snapshot (ap_rc->p_paths);
+  tiz_rcsnapshot_t * p_old = NULL;
+
+  if (!p_snap)
+    {
+      /* Most likely, a file is being rewritten; keep what we have */
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "No usable rc file; keeping the old one");
+      return;
+    }
+
+  /* Only this thread replaces snapshots; readers see either one */
+  p_old = current_snapshot (ap_rc);
+  __atomic_store_n (&(ap_rc->p_snapshot), p_snap, __ATOMIC_RELEASE);
+  p_old->retired_at = monotonic_seconds ();
+  p_old->p_retired_next = ap_rc->p_retired;
+  ap_rc->p_retired = p_old;
+
+  TIZ_LOG (TIZ_PRIORITY_NOTICE, "rc file reloaded [%d keys]", p_snap->count);
+}
+
+static bool
+is_watched_name (const tiz_rcfile_t * ap_rc, const char * ap_name)
+{
+  int i;
+  for (i = 0; i < g_num_rcfiles; ++i)
+    {
+      const char * p_base = NULL;
+      if (ap_rc->p_paths[i])
+        {
+          p_base = strrchr (ap_rc->p_paths[i], '/');
+          p_base = p_base ? p_base + 1 : ap_rc->p_paths[i];
+          if (0 == strcmp (p_base, ap_name))
+            {
+              return true;
+            }
+        }
+    }
+  return false;
+}
+
+/* Returns whether any of the pending events is about one of the rc files */
+static bool
+read_inotify_events (const tiz_rcfile_t * ap_rc)
+{
+  char buf[4096]
+    __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+  bool relevant = false;
+  ssize_t len = 0;
+
+  while ((len = read (ap_rc->inotify_fd, buf, sizeof (buf))) > 0)
+    {
+      const char * p = buf;
+      while (p < buf + len)
+        {
+          const struct inotify_event * p_ev
+            = (const struct inotify_event *) p;
+          if (p_ev->len > 0 && is_watched_name (ap_rc, p_ev->name))
+            {
+              relevant = true;
+            }
+          p += sizeof (struct inotify_event) + p_ev->len;
+        }
+    }
+  return relevant;
+}
+
+static void *
+rc_watcher_thread_func (void * ap_arg)
+{
+  tiz_rcfile_t * p_rc = ap_arg;
+  const struct timespec settle = {0, RC_RELOAD_SETTLE_NS};
+  struct pollfd pfds[2];
+
+  assert (p_rc);
+
+  (void) tiz_thread_setname (&(p_rc->watcher),
+                             (const OMX_STRING) RC_WATCHER_THREAD_NAME);
+
+  pfds[0].fd = p_rc->inotify_fd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = p_rc->stop_fd;
+  pfds[1].events = POLLIN;
+
+  for (;;)
+    {
+      /* Wake up to free the replaced snapshots once their time is up */
+      const int timeout_ms
+        = p_rc->p_retired ? (int) p_rc->retired_grace * 1000 : -1;
+
+      if (poll (pfds, 2, timeout_ms) < 0)
+        {
+          if (EINTR == errno)
+            {
+              continue;
+            }
+          break;
+        }
+
+      if (pfds[1].revents)
+        {
+          break;
+        }
+
+      if ((pfds[0].revents & POLLIN) && read_inotify_events (p_rc))
+        {
+          /* Editors often write, rename and touch in quick succession */
+          (void) nanosleep (&settle, NULL);
+          (void) read_inotify_events (p_rc);
+          reload (p_rc);
+        }
+
+      reclaim_retired (p_rc);
+    }
+
+  return NULL;
+}
+
 OMX_ERRORTYPE
 tiz_rcfile_init (tiz_rcfile_t ** pp_rc)
 {
@@ -502,7 +941,7 @@ tiz_rcfile_init (tiz_rcfile_t ** pp_rc)
 
   /* Load rc files */
   TIZ_LOG (TIZ_PRIORITY_TRACE, "Looking for [%d] rc files...", g_num_rcfiles);
-  assert (3 == g_num_rcfiles);
+  assert (TIZ_RCFILE_NUM_FILES == g_num_rcfiles);
 
   snprintf (g_rcfiles[0].name, sizeof (g_rcfiles[0].name) - 1,
             "%s/tizonia/tizonia.conf", SYSCONFDIR);
@@ -527,65 +966,142 @@ tiz_rcfile_init (tiz_rcfile_t ** pp_rc)
                "for tiz_rcfile_t...");
       return OMX_ErrorInsufficientResources;
     }
+  p_rc->inotify_fd = -1;
+  p_rc->stop_fd = -1;
+  p_rc->retired_grace = RC_RETIRED_GRACE_SEC;
 
-  for (i = (g_num_rcfiles - 1); i >= 0; --i)
+  /* The unexpanded templates are not paths */
+  for (i = 0; i < g_num_rcfiles; ++i)
     {
-      TIZ_LOG (TIZ_PRIORITY_TRACE, "Checking for rc file [%d] at [%s]", i,
-               g_rcfiles[i].name);
-      /* Check file existence and user's read access */
-      if (0 != access (g_rcfiles[i].name, R_OK))
+      if ('$' != g_rcfiles[i].name[0])
         {
-          TIZ_LOG (TIZ_PRIORITY_TRACE,
-                   "rc file [%s] does not exist or "
-                   "user has no read access permission",
-                   g_rcfiles[i].name);
-          continue;
+          p_rc->p_paths[i] = strndup (g_rcfiles[i].name, PATH_MAX);
         }
+    }
 
-      /* Store stat's ctime */
-      if (stat_ctime (g_rcfiles[i].name, &g_rcfiles[i].ctime) != 0)
+  if ((p_rc->p_snapshot = load_snapshot (p_rc->p_paths)))
+    {
+      for (i = 0; i < g_num_rcfiles; ++i)
         {
-          TIZ_LOG (TIZ_PRIORITY_TRACE, "stat_ctime for [%s] failed",
-                   g_rcfiles[i].name);
-          continue;
+          g_rcfiles[i].exists
+            = (p_rc->p_paths[i]
+               && 0 == stat_ctime (p_rc->p_paths[i], &g_rcfiles[i].ctime));
         }
+      *pp_rc = p_rc;
+    }
+  else
+    {
+      *pp_rc = NULL;
+      tiz_rcfile_destroy (p_rc);
+      rc = OMX_ErrorInsufficientResources;
+    }
+
+  return rc;
+}
+
+OMX_ERRORTYPE
+tiz_rcfile_watch (tiz_rcfile_t * p_rc)
+{
+  int i;
+  int nwatches = 0;
+
+  assert (p_rc);
+
+  if (p_rc->watching)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if ((p_rc->inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC)) < 0
+      || (p_rc->stop_fd = eventfd (0, EFD_CLOEXEC)) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to watch the rc files (%s)",
+               strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
 
-      if (0 != load_rc_file (&g_rcfiles[i], p_rc))
+  /* Directories are watched, so that files replaced by a rename (the way
+     most editors save them) are noticed too */
+  for (i = 0; i < g_num_rcfiles; ++i)
+    {
+      char dir[PATH_MAX];
+      char * p_slash = NULL;
+      if (!p_rc->p_paths[i])
         {
-          TIZ_LOG (TIZ_PRIORITY_TRACE, "Loading [%s] rc file failed",
-                   g_rcfiles[i].name);
           continue;
         }
+      snprintf (dir, sizeof (dir), "%s", p_rc->p_paths[i]);
+      if (!(p_slash = strrchr (dir, '/')))
+        {
+          snprintf (dir, sizeof (dir), ".");
+        }
+      else if (p_slash == dir)
+        {
+          p_slash[1] = '\0';
+        }
+      else
+        {
+          *p_slash = '\0';
+        }
+      if (inotify_add_watch (p_rc->inotify_fd, dir,
+                             IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM
+                               | IN_CREATE | IN_DELETE)
+          >= 0)
+        {
+          ++nwatches;
+        }
+    }
 
-      TIZ_LOG (TIZ_PRIORITY_DEBUG, "Loading [%s] rc file succeeded",
-               g_rcfiles[i].name);
-      g_rcfiles[i].exists = 1;
-
-      /* We only need to load one file */
-      break;
+  if (0 == nwatches)
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "None of the rc file directories exist");
+      return OMX_ErrorNone;
     }
 
-  if (p_rc->count)
+  tiz_check_omx_ret_val (tiz_thread_create (&(p_rc->watcher),
+                                            RC_WATCHER_STACK_SIZE, 0,
+                                            rc_watcher_thread_func, p_rc),
+                         OMX_ErrorInsufficientResources);
+  p_rc->watching = true;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_rcfile_enable_reload (void)
+{
+  tiz_rcfile_t * p_rc = tiz_rcfile_get_handle ();
+  const char * p_value = NULL;
+
+  if (NULL == p_rc)
     {
-      *pp_rc = p_rc;
+      return OMX_ErrorInsufficientResources;
     }
-  else
+
+  /* The config file may still turn this off */
+  p_value = tiz_rcfile_get_value_internal (p_rc, "ilcore", "config-reload");
+  if (p_value && 0 == strcmp (p_value, "false"))
     {
-      *pp_rc = NULL;
-      tiz_mem_free (p_rc);
-      rc = OMX_ErrorInsufficientResources;
+      return OMX_ErrorNone;
     }
 
-  return rc;
+  return tiz_rcfile_watch (p_rc);
 }
 
 const char *
 tiz_rcfile_get_value (const char * ap_section, const char * ap_key)
 {
+  return tiz_rcfile_get_value_internal (tiz_rcfile_get_handle (), ap_section,
+                                        ap_key);
+}
+
+const char *
+tiz_rcfile_get_value_internal (tiz_rcfile_t * p_rc, const char * ap_section,
+                               const char * ap_key)
+{
+  tiz_rcsnapshot_t * p_snap = NULL;
   keyval_t * p_kv = NULL;
-  tiz_rcfile_t * p_rc = tiz_rcfile_get_handle ();
 
-  if (NULL == p_rc)
+  if (NULL == p_rc || NULL == (p_snap = current_snapshot (p_rc)))
     {
       return NULL;
     }
@@ -597,7 +1113,7 @@ tiz_rcfile_get_value (const char * ap_section, const char * ap_key)
   TIZ_LOG (TIZ_PRIORITY_TRACE, "Retrieving value for Key [%s] in section [%s]",
            ap_key, ap_section);
 
-  p_kv = find_node (p_rc, ap_key);
+  p_kv = lookup_node (p_snap, ap_section, ap_key);
   if (p_kv && p_kv->p_value_list)
     {
       return p_kv->p_value_list->p_value;
@@ -614,8 +1130,9 @@ tiz_rcfile_get_value_list (const char * ap_section, const char * ap_key,
   char ** pp_ret = NULL;
   value_t * p_next_value = NULL;
   tiz_rcfile_t * p_rc = tiz_rcfile_get_handle ();
+  tiz_rcsnapshot_t * p_snap = NULL;
 
-  if (NULL == p_rc)
+  if (NULL == p_rc || NULL == (p_snap = current_snapshot (p_rc)))
     {
       return NULL;
     }
@@ -630,7 +1147,7 @@ tiz_rcfile_get_value_list (const char * ap_section, const char * ap_key,
            "for Key [%s] in section [%s]",
            ap_key, ap_section);
 
-  p_kv = find_node (p_rc, ap_key);
+  p_kv = lookup_node (p_snap, ap_section, ap_key);
   if (p_kv)
     {
       int i = 0;
@@ -654,31 +1171,43 @@ tiz_rcfile_get_value_list (const char * ap_section, const char * ap_key,
 void
 tiz_rcfile_destroy (tiz_rcfile_t * p_rc)
 {
-  keyval_t * p_kv_lst = NULL;
-  keyval_t * p_kvt = NULL;
-  value_t * p_val_lst = NULL;
+  int i;
 
   if (!p_rc)
     {
       return;
     }
 
-  p_kv_lst = p_rc->p_keyvals;
-  while (p_kv_lst)
+  if (p_rc->watching)
     {
-      value_t * p_vt = NULL;
-      tiz_mem_free (p_kv_lst->p_key);
-      p_val_lst = p_kv_lst->p_value_list;
-      while (p_val_lst)
-        {
-          p_vt = p_val_lst;
-          p_val_lst = p_val_lst->p_next;
-          tiz_mem_free (p_vt->p_value);
-          tiz_mem_free (p_vt);
-        }
-      p_kvt = p_kv_lst;
-      p_kv_lst = p_kv_lst->p_next;
-      tiz_mem_free (p_kvt);
+      OMX_PTR p_result = NULL;
+      const uint64_t one = 1;
+      (void) !write (p_rc->stop_fd, &one, sizeof (one));
+      (void) tiz_thread_join (&(p_rc->watcher), &p_result);
+    }
+
+  if (p_rc->inotify_fd >= 0)
+    {
+      close (p_rc->inotify_fd);
+    }
+
+  if (p_rc->stop_fd >= 0)
+    {
+      close (p_rc->stop_fd);
+    }
+
+  while (p_rc->p_retired)
+    {
+      tiz_rcsnapshot_t * p_snap = p_rc->p_retired;
+      p_rc->p_retired = p_snap->p_retired_next;
+      destroy_snapshot (p_snap);
+    }
+
+  destroy_snapshot (p_rc->p_snapshot);
+
+  for (i = 0; i < g_num_rcfiles; ++i)
+    {
+      tiz_mem_free (p_rc->p_paths[i]);
     }
 
   tiz_mem_free (p_rc);
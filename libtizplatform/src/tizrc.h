@@ -100,6 +100,22 @@ int
 tiz_rcfile_compare_value (const char * section, const char * key,
                           const char * value);
 
+/**
+ * Start picking up changes to the configuration files while the process
+ * runs. Values looked up after a change are the new ones. Strings returned
+ * by tiz_rcfile_get_value before a change remain valid for a grace period
+ * (30 seconds); callers that keep them longer should copy them. Reloading is
+ * off until this is called, and the 'config-reload' key in the 'ilcore'
+ * section can keep it off.
+ *
+ * @ingroup tizrcfile
+ *
+ * @return OMX_ErrorNone on success, or if reloading has been disabled in the
+ * configuration file. OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_rcfile_enable_reload (void);
+
 /**
  * Returns 0 if the status of the configuration file is such that a tizonia
  * configuration file has been found at one of the expected locations and the
@@ -0,0 +1,770 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared memory broadcast ring
+ *
+ * The segment starts with a header, followed by the slots. Each consumer owns
+ * a bit in the 'subscribed' mask. When a slot is published, the producer
+ * records the consumers it is published to in 'readers' and 'pending';
+ * consumers clear their bit in 'pending' when they release it, and the slot
+ * is free again once no subscribed consumer has its bit set there. Using a
+ * mask rather than a count means that an unsubscribed (or vanished) consumer
+ * never holds a slot.
+ *
+ * Wakeups are only sent to a side that has announced that it is waiting (the
+ * 'waiting' mask for consumers, 'producer_waiting' for the producer).
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "tizmem.h"
+#include "tizlog.h"
+#include "tizmacros.h"
+#include "tizshmring.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.shmring"
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+
+#define SHM_RING_MAGIC 0x545a5352 /* "TZSR" */
+#define SHM_RING_CACHELINE 64
+#define SHM_RING_MAX_SLOTS 4096
+#define SHM_RING_MAX_SLOT_SIZE (64 * 1024 * 1024)
+#define SHM_RING_MAX_NAME 64
+/* One eventfd per consumer, plus the producer's */
+#define SHM_RING_NFDS (TIZ_SHM_RING_MAX_CONSUMERS + 1)
+#define SHM_RING_PRODUCER_FD TIZ_SHM_RING_MAX_CONSUMERS
+
+#define shm_ring_align(x) \
+  (((x) + SHM_RING_CACHELINE - 1) & ~((size_t) SHM_RING_CACHELINE - 1))
+
+typedef struct shm_ring_hdr shm_ring_hdr_t;
+struct shm_ring_hdr
+{
+  uint32_t magic;
+  uint32_t nslots;
+  uint32_t slot_size;
+  uint32_t stride;
+  uint32_t claimed;    /* consumer bits in use, incl. those subscribing */
+  uint32_t subscribed; /* consumer bits new slots are published to */
+  uint32_t waiting;    /* consumers waiting for a slot to be published */
+  uint32_t producer_waiting;
+  /* Written by the producer only, on its own cache line */
+  uint64_t head __attribute__ ((aligned (SHM_RING_CACHELINE)));
+} __attribute__ ((aligned (SHM_RING_CACHELINE)));
+
+typedef struct shm_ring_slot shm_ring_slot_t;
+struct shm_ring_slot
+{
+  uint64_t seq;
+  uint64_t len;
+  int64_t timestamp;
+  uint32_t flags;
+  uint32_t readers;
+  uint32_t pending;
+} __attribute__ ((aligned (SHM_RING_CACHELINE)));
+
+/* The per-process side of a ring */
+typedef struct shm_ring_seg shm_ring_seg_t;
+struct shm_ring_seg
+{
+  char name[SHM_RING_MAX_NAME]; /* empty for imported rings */
+  int mem_fd;
+  int ev_fds[SHM_RING_NFDS];
+  shm_ring_hdr_t * p_hdr;
+  size_t map_len;
+  unsigned nrefs;
+  shm_ring_seg_t * p_next;
+};
+
+struct tiz_shm_ring
+{
+  shm_ring_seg_t * p_seg;
+  int consumer; /* -1 when not subscribed */
+  uint64_t tail;
+  bool claimed;
+};
+
+static pthread_mutex_t g_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static shm_ring_seg_t * gp_registry = NULL;
+
+static inline shm_ring_slot_t *
+slot_at (const shm_ring_hdr_t * ap_hdr, const uint64_t a_seq)
+{
+  return (shm_ring_slot_t *) ((char *) ap_hdr + shm_ring_align (sizeof (
+                                                  shm_ring_hdr_t))
+                              + (size_t) (a_seq % ap_hdr->nslots)
+                                  * ap_hdr->stride);
+}
+
+static inline void *
+slot_data (shm_ring_slot_t * ap_slot)
+{
+  return (char *) ap_slot + shm_ring_align (sizeof (shm_ring_slot_t));
+}
+
+static void
+notify (const int a_fd)
+{
+  const uint64_t one = 1;
+  /* EAGAIN means the counter is already non-zero, which is just as good */
+  (void) !write (a_fd, &one, sizeof (one));
+}
+
+static void
+wake_producer (const shm_ring_seg_t * ap_seg)
+{
+  if (__atomic_load_n (&(ap_seg->p_hdr->producer_waiting), __ATOMIC_SEQ_CST)
+      && __atomic_exchange_n (&(ap_seg->p_hdr->producer_waiting), 0,
+                              __ATOMIC_SEQ_CST))
+    {
+      notify (ap_seg->ev_fds[SHM_RING_PRODUCER_FD]);
+    }
+}
+
+static void
+clear_pending (shm_ring_hdr_t * ap_hdr, const uint32_t a_bit)
+{
+  uint32_t i = 0;
+  for (i = 0; i < ap_hdr->nslots; ++i)
+    {
+      (void) __atomic_fetch_and (&(slot_at (ap_hdr, i)->pending), ~a_bit,
+                                 __ATOMIC_SEQ_CST);
+    }
+}
+
+static void
+seg_destroy (shm_ring_seg_t * ap_seg)
+{
+  int i = 0;
+  if (ap_seg)
+    {
+      if (ap_seg->p_hdr)
+        {
+          (void) munmap (ap_seg->p_hdr, ap_seg->map_len);
+        }
+      for (i = 0; i < SHM_RING_NFDS; ++i)
+        {
+          if (ap_seg->ev_fds[i] >= 0)
+            {
+              (void) close (ap_seg->ev_fds[i]);
+            }
+        }
+      if (ap_seg->mem_fd >= 0)
+        {
+          (void) close (ap_seg->mem_fd);
+        }
+      tiz_mem_free (ap_seg);
+    }
+}
+
+static shm_ring_seg_t *
+seg_alloc (void)
+{
+  shm_ring_seg_t * p_seg = tiz_mem_calloc (1, sizeof (shm_ring_seg_t));
+  if (p_seg)
+    {
+      int i = 0;
+      p_seg->mem_fd = -1;
+      for (i = 0; i < SHM_RING_NFDS; ++i)
+        {
+          p_seg->ev_fds[i] = -1;
+        }
+    }
+  return p_seg;
+}
+
+static OMX_ERRORTYPE
+seg_map (shm_ring_seg_t * ap_seg, const size_t a_len)
+{
+  void * p_map
+    = mmap (NULL, a_len, PROT_READ | PROT_WRITE, MAP_SHARED, ap_seg->mem_fd, 0);
+  if (MAP_FAILED == p_map)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "mmap failed [%s]", strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+  ap_seg->p_hdr = p_map;
+  ap_seg->map_len = a_len;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+seg_create (shm_ring_seg_t ** app_seg, const char * ap_name,
+            const OMX_U32 a_nslots, const OMX_U32 a_slot_size)
+{
+  shm_ring_seg_t * p_seg = NULL;
+  const size_t stride
+    = shm_ring_align (sizeof (shm_ring_slot_t)) + shm_ring_align (a_slot_size);
+  const size_t len
+    = shm_ring_align (sizeof (shm_ring_hdr_t)) + (size_t) a_nslots * stride;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  int i = 0;
+
+  assert (app_seg);
+
+  p_seg = seg_alloc ();
+  tiz_check_null_ret_oom (p_seg != NULL);
+  snprintf (p_seg->name, sizeof (p_seg->name), "%s", ap_name);
+
+  p_seg->mem_fd = syscall (SYS_memfd_create, "tizshmring", MFD_CLOEXEC);
+  if (p_seg->mem_fd < 0 || ftruncate (p_seg->mem_fd, (off_t) len) < 0)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : could not create the segment [%s]",
+               ap_name, strerror (errno));
+      goto end;
+    }
+
+  for (i = 0; i < SHM_RING_NFDS; ++i)
+    {
+      p_seg->ev_fds[i] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if (p_seg->ev_fds[i] < 0)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : eventfd failed [%s]", ap_name,
+                   strerror (errno));
+          goto end;
+        }
+    }
+
+  if (OMX_ErrorNone == seg_map (p_seg, len))
+    {
+      /* A fresh memfd is zero-filled, so all slots are free */
+      p_seg->p_hdr->nslots = a_nslots;
+      p_seg->p_hdr->slot_size = a_slot_size;
+      p_seg->p_hdr->stride = (uint32_t) stride;
+      __atomic_store_n (&(p_seg->p_hdr->magic), SHM_RING_MAGIC,
+                        __ATOMIC_RELEASE);
+      *app_seg = p_seg;
+      p_seg = NULL;
+      rc = OMX_ErrorNone;
+    }
+
+end:
+  seg_destroy (p_seg);
+  return rc;
+}
+
+static void
+seg_unref (shm_ring_seg_t * ap_seg)
+{
+  shm_ring_seg_t ** pp_cur = NULL;
+
+  (void) pthread_mutex_lock (&g_registry_mutex);
+  if (0 == --ap_seg->nrefs)
+    {
+      for (pp_cur = &gp_registry; *pp_cur; pp_cur = &((*pp_cur)->p_next))
+        {
+          if (*pp_cur == ap_seg)
+            {
+              *pp_cur = ap_seg->p_next;
+              break;
+            }
+        }
+    }
+  else
+    {
+      ap_seg = NULL;
+    }
+  (void) pthread_mutex_unlock (&g_registry_mutex);
+
+  seg_destroy (ap_seg);
+}
+
+static OMX_ERRORTYPE
+ring_alloc (tiz_shm_ring_ptr_t * app_ring, shm_ring_seg_t * ap_seg)
+{
+  tiz_shm_ring_t * p_ring = tiz_mem_calloc (1, sizeof (tiz_shm_ring_t));
+  tiz_check_null_ret_oom (p_ring != NULL);
+  p_ring->p_seg = ap_seg;
+  p_ring->consumer = -1;
+  *app_ring = p_ring;
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_open (tiz_shm_ring_ptr_t * app_ring, const char * ap_name,
+                   const OMX_U32 a_nslots, const OMX_U32 a_slot_size)
+{
+  shm_ring_seg_t * p_seg = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (app_ring);
+  assert (ap_name);
+
+  if (a_nslots < 2 || a_nslots > SHM_RING_MAX_SLOTS || 0 == a_slot_size
+      || a_slot_size > SHM_RING_MAX_SLOT_SIZE
+      || strlen (ap_name) >= SHM_RING_MAX_NAME || '\0' == ap_name[0])
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  (void) pthread_mutex_lock (&g_registry_mutex);
+  for (p_seg = gp_registry; p_seg; p_seg = p_seg->p_next)
+    {
+      if (0 == strcmp (p_seg->name, ap_name))
+        {
+          break;
+        }
+    }
+  if (!p_seg)
+    {
+      rc = seg_create (&p_seg, ap_name, a_nslots, a_slot_size);
+      if (OMX_ErrorNone == rc)
+        {
+          p_seg->p_next = gp_registry;
+          gp_registry = p_seg;
+        }
+    }
+  if (p_seg)
+    {
+      ++p_seg->nrefs;
+    }
+  (void) pthread_mutex_unlock (&g_registry_mutex);
+
+  tiz_check_omx (rc);
+
+  rc = ring_alloc (app_ring, p_seg);
+  if (OMX_ErrorNone != rc)
+    {
+      seg_unref (p_seg);
+    }
+  return rc;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_export (const tiz_shm_ring_t * ap_ring, const int a_sock)
+{
+  const shm_ring_seg_t * p_seg = NULL;
+  const uint32_t magic = SHM_RING_MAGIC;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * (SHM_RING_NFDS + 1))];
+    struct cmsghdr align;
+  } ctrl;
+  struct iovec iov = {(void *) &magic, sizeof (magic)};
+  struct msghdr msg;
+  struct cmsghdr * p_cmsg = NULL;
+  int * p_fds = NULL;
+
+  assert (ap_ring);
+  p_seg = ap_ring->p_seg;
+
+  memset (&msg, 0, sizeof (msg));
+  memset (&ctrl, 0, sizeof (ctrl));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  p_cmsg->cmsg_level = SOL_SOCKET;
+  p_cmsg->cmsg_type = SCM_RIGHTS;
+  p_cmsg->cmsg_len = CMSG_LEN (sizeof (int) * (SHM_RING_NFDS + 1));
+  p_fds = (int *) CMSG_DATA (p_cmsg);
+  p_fds[0] = p_seg->mem_fd;
+  memcpy (p_fds + 1, p_seg->ev_fds, sizeof (p_seg->ev_fds));
+
+  if (sendmsg (a_sock, &msg, MSG_NOSIGNAL) != (ssize_t) sizeof (magic))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : sendmsg failed [%s]", p_seg->name,
+               strerror (errno));
+      return OMX_ErrorUndefined;
+    }
+  return OMX_ErrorNone;
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_import (tiz_shm_ring_ptr_t * app_ring, const int a_sock)
+{
+  shm_ring_seg_t * p_seg = NULL;
+  uint32_t magic = 0;
+  union
+  {
+    char buf[CMSG_SPACE (sizeof (int) * (SHM_RING_NFDS + 1))];
+    struct cmsghdr align;
+  } ctrl;
+  struct iovec iov = {&magic, sizeof (magic)};
+  struct msghdr msg;
+  struct cmsghdr * p_cmsg = NULL;
+  struct stat st;
+  OMX_ERRORTYPE rc = OMX_ErrorUndefined;
+
+  assert (app_ring);
+
+  p_seg = seg_alloc ();
+  tiz_check_null_ret_oom (p_seg != NULL);
+
+  memset (&msg, 0, sizeof (msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = ctrl.buf;
+  msg.msg_controllen = sizeof (ctrl.buf);
+
+  if (recvmsg (a_sock, &msg, MSG_CMSG_CLOEXEC) != (ssize_t) sizeof (magic))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "recvmsg failed [%s]", strerror (errno));
+      goto end;
+    }
+
+  p_cmsg = CMSG_FIRSTHDR (&msg);
+  if (!p_cmsg || SOL_SOCKET != p_cmsg->cmsg_level
+      || SCM_RIGHTS != p_cmsg->cmsg_type
+      || CMSG_LEN (sizeof (int) * (SHM_RING_NFDS + 1)) != p_cmsg->cmsg_len)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "no ring descriptors received");
+      goto end;
+    }
+  {
+    const int * p_fds = (const int *) CMSG_DATA (p_cmsg);
+    p_seg->mem_fd = p_fds[0];
+    memcpy (p_seg->ev_fds, p_fds + 1, sizeof (p_seg->ev_fds));
+  }
+
+  if (SHM_RING_MAGIC != magic || fstat (p_seg->mem_fd, &st) < 0
+      || (size_t) st.st_size < shm_ring_align (sizeof (shm_ring_hdr_t)))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "not a ring segment");
+      goto end;
+    }
+
+  rc = seg_map (p_seg, (size_t) st.st_size);
+  if (OMX_ErrorNone == rc
+      && (SHM_RING_MAGIC
+            != __atomic_load_n (&(p_seg->p_hdr->magic), __ATOMIC_ACQUIRE)
+          || shm_ring_align (sizeof (shm_ring_hdr_t))
+                 + (size_t) p_seg->p_hdr->nslots * p_seg->p_hdr->stride
+               > p_seg->map_len))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "corrupt ring segment");
+      rc = OMX_ErrorUndefined;
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      p_seg->nrefs = 1;
+      rc = ring_alloc (app_ring, p_seg);
+      if (OMX_ErrorNone == rc)
+        {
+          p_seg = NULL;
+        }
+    }
+
+end:
+  seg_destroy (p_seg);
+  return rc;
+}
+
+void
+tiz_shm_ring_close (tiz_shm_ring_t * ap_ring)
+{
+  if (ap_ring)
+    {
+      tiz_shm_ring_unsubscribe (ap_ring);
+      seg_unref (ap_ring->p_seg);
+      tiz_mem_free (ap_ring);
+    }
+}
+
+size_t
+tiz_shm_ring_slot_size (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->p_seg->p_hdr->slot_size;
+}
+
+int
+tiz_shm_ring_fd (const tiz_shm_ring_t * ap_ring)
+{
+  assert (ap_ring);
+  return ap_ring->p_seg->ev_fds[ap_ring->consumer >= 0
+                                  ? ap_ring->consumer
+                                  : SHM_RING_PRODUCER_FD];
+}
+
+void
+tiz_shm_ring_clear_fd (tiz_shm_ring_t * ap_ring)
+{
+  uint64_t val = 0;
+  (void) !read (tiz_shm_ring_fd (ap_ring), &val, sizeof (val));
+}
+
+static bool
+slot_busy (const shm_ring_hdr_t * ap_hdr, shm_ring_slot_t * ap_slot)
+{
+  return 0 != (__atomic_load_n (&(ap_slot->pending), __ATOMIC_SEQ_CST)
+               & __atomic_load_n (&(ap_hdr->subscribed), __ATOMIC_SEQ_CST));
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_claim (tiz_shm_ring_t * ap_ring, void ** app_data)
+{
+  shm_ring_hdr_t * p_hdr = NULL;
+  shm_ring_slot_t * p_slot = NULL;
+
+  assert (ap_ring);
+  assert (app_data);
+  assert (ap_ring->consumer < 0);
+
+  p_hdr = ap_ring->p_seg->p_hdr;
+  p_slot
+    = slot_at (p_hdr, __atomic_load_n (&(p_hdr->head), __ATOMIC_RELAXED));
+
+  if (!ap_ring->claimed && slot_busy (p_hdr, p_slot))
+    {
+      /* Announce the wait, then look again in case the last reader has
+         released the slot in between */
+      __atomic_store_n (&(p_hdr->producer_waiting), 1, __ATOMIC_SEQ_CST);
+      if (slot_busy (p_hdr, p_slot))
+        {
+          return OMX_ErrorNoMore;
+        }
+      __atomic_store_n (&(p_hdr->producer_waiting), 0, __ATOMIC_RELAXED);
+    }
+
+  if (!ap_ring->claimed)
+    {
+      /* Mark it as being rewritten, for consumers that may still be looking
+         at the previous publication (see tiz_shm_ring_peek) */
+      __atomic_store_n (&(p_slot->seq), UINT64_MAX, __ATOMIC_RELAXED);
+      __atomic_thread_fence (__ATOMIC_RELEASE);
+      ap_ring->claimed = true;
+    }
+
+  *app_data = slot_data (p_slot);
+  return OMX_ErrorNone;
+}
+
+void
+tiz_shm_ring_publish (tiz_shm_ring_t * ap_ring, const size_t a_len,
+                      const OMX_U32 a_flags, const OMX_TICKS a_timestamp)
+{
+  shm_ring_hdr_t * p_hdr = NULL;
+  shm_ring_slot_t * p_slot = NULL;
+  uint64_t head = 0;
+  uint32_t readers = 0;
+  uint32_t waiting = 0;
+  int i = 0;
+
+  assert (ap_ring);
+  assert (ap_ring->claimed);
+
+  p_hdr = ap_ring->p_seg->p_hdr;
+  head = __atomic_load_n (&(p_hdr->head), __ATOMIC_RELAXED);
+  p_slot = slot_at (p_hdr, head);
+  assert (a_len <= p_hdr->slot_size);
+
+  readers = __atomic_load_n (&(p_hdr->subscribed), __ATOMIC_SEQ_CST);
+  p_slot->len = MIN (a_len, p_hdr->slot_size);
+  p_slot->flags = a_flags;
+  p_slot->timestamp = a_timestamp;
+  __atomic_store_n (&(p_slot->readers), readers, __ATOMIC_RELAXED);
+  __atomic_store_n (&(p_slot->pending), readers, __ATOMIC_RELAXED);
+  __atomic_store_n (&(p_slot->seq), head, __ATOMIC_RELEASE);
+  __atomic_store_n (&(p_hdr->head), head + 1, __ATOMIC_SEQ_CST);
+  ap_ring->claimed = false;
+
+  waiting = __atomic_fetch_and (&(p_hdr->waiting), ~readers, __ATOMIC_SEQ_CST)
+            & readers;
+  for (i = 0; waiting && i < TIZ_SHM_RING_MAX_CONSUMERS; ++i)
+    {
+      if (waiting & (1u << i))
+        {
+          notify (ap_ring->p_seg->ev_fds[i]);
+          waiting &= ~(1u << i);
+        }
+    }
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_subscribe (tiz_shm_ring_t * ap_ring)
+{
+  shm_ring_hdr_t * p_hdr = NULL;
+  uint32_t claimed = 0;
+  int i = 0;
+
+  assert (ap_ring);
+  assert (!ap_ring->claimed);
+
+  if (ap_ring->consumer >= 0)
+    {
+      return OMX_ErrorNone;
+    }
+
+  p_hdr = ap_ring->p_seg->p_hdr;
+  claimed = __atomic_load_n (&(p_hdr->claimed), __ATOMIC_SEQ_CST);
+  do
+    {
+      for (i = 0; i < TIZ_SHM_RING_MAX_CONSUMERS && (claimed & (1u << i)); ++i)
+        {
+        }
+      if (TIZ_SHM_RING_MAX_CONSUMERS == i)
+        {
+          return OMX_ErrorNoMore;
+        }
+    }
+  while (!__atomic_compare_exchange_n (&(p_hdr->claimed), &claimed,
+                                       claimed | (1u << i), false,
+                                       __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+  /* Drop any references left behind by a previous owner of this bit before
+     slots start being published to it */
+  clear_pending (p_hdr, 1u << i);
+  /* The tail must be read before the bit is visible to the producer. Any
+     slot published in between is skipped by tiz_shm_ring_peek, as it does
+     not carry the bit; reading the tail afterwards could instead step over
+     a slot that does, and that slot would never be released. */
+  ap_ring->tail = __atomic_load_n (&(p_hdr->head), __ATOMIC_SEQ_CST);
+  (void) __atomic_fetch_or (&(p_hdr->subscribed), 1u << i, __ATOMIC_SEQ_CST);
+  ap_ring->consumer = i;
+  return OMX_ErrorNone;
+}
+
+void
+tiz_shm_ring_unsubscribe (tiz_shm_ring_t * ap_ring)
+{
+  shm_ring_seg_t * p_seg = NULL;
+  uint32_t bit = 0;
+
+  assert (ap_ring);
+
+  if (ap_ring->consumer < 0)
+    {
+      return;
+    }
+
+  p_seg = ap_ring->p_seg;
+  bit = 1u << ap_ring->consumer;
+  (void) __atomic_fetch_and (&(p_seg->p_hdr->subscribed), ~bit,
+                             __ATOMIC_SEQ_CST);
+  (void) __atomic_fetch_and (&(p_seg->p_hdr->waiting), ~bit,
+                             __ATOMIC_SEQ_CST);
+  clear_pending (p_seg->p_hdr, bit);
+  (void) __atomic_fetch_and (&(p_seg->p_hdr->claimed), ~bit,
+                             __ATOMIC_SEQ_CST);
+  tiz_shm_ring_clear_fd (ap_ring);
+  ap_ring->consumer = -1;
+  wake_producer (p_seg);
+}
+
+OMX_ERRORTYPE
+tiz_shm_ring_peek (tiz_shm_ring_t * ap_ring, const void ** app_data,
+                   size_t * ap_len, OMX_U32 * ap_flags,
+                   OMX_TICKS * ap_timestamp)
+{
+  shm_ring_hdr_t * p_hdr = NULL;
+  uint32_t bit = 0;
+
+  assert (ap_ring);
+  assert (ap_ring->consumer >= 0);
+  assert (app_data);
+  assert (ap_len);
+
+  p_hdr = ap_ring->p_seg->p_hdr;
+  bit = 1u << ap_ring->consumer;
+
+  for (;;)
+    {
+      shm_ring_slot_t * p_slot = NULL;
+      uint64_t seq = 0;
+      uint32_t readers = 0;
+
+      if (ap_ring->tail == __atomic_load_n (&(p_hdr->head), __ATOMIC_ACQUIRE))
+        {
+          /* Announce the wait, then look again in case the producer has
+             published in between */
+          (void) __atomic_fetch_or (&(p_hdr->waiting), bit, __ATOMIC_SEQ_CST);
+          if (ap_ring->tail
+              == __atomic_load_n (&(p_hdr->head), __ATOMIC_SEQ_CST))
+            {
+              return OMX_ErrorNoMore;
+            }
+          (void) __atomic_fetch_and (&(p_hdr->waiting), ~bit,
+                                     __ATOMIC_RELAXED);
+        }
+
+      /* Only the slot published while this handle was subscribing may not
+         be ours. The producer is free to reuse it meanwhile, so the sequence
+         number is checked on both sides of the 'readers' read. */
+      p_slot = slot_at (p_hdr, ap_ring->tail);
+      seq = __atomic_load_n (&(p_slot->seq), __ATOMIC_ACQUIRE);
+      readers = __atomic_load_n (&(p_slot->readers), __ATOMIC_RELAXED);
+      __atomic_thread_fence (__ATOMIC_ACQUIRE);
+      if (seq == ap_ring->tail
+          && seq == __atomic_load_n (&(p_slot->seq), __ATOMIC_RELAXED)
+          && (readers & bit))
+        {
+          *app_data = slot_data (p_slot);
+          *ap_len = p_slot->len;
+          if (ap_flags)
+            {
+              *ap_flags = p_slot->flags;
+            }
+          if (ap_timestamp)
+            {
+              *ap_timestamp = p_slot->timestamp;
+            }
+          return OMX_ErrorNone;
+        }
+      ++ap_ring->tail;
+    }
+}
+
+void
+tiz_shm_ring_release (tiz_shm_ring_t * ap_ring)
+{
+  shm_ring_seg_t * p_seg = NULL;
+
+  assert (ap_ring);
+  assert (ap_ring->consumer >= 0);
+
+  p_seg = ap_ring->p_seg;
+  assert (ap_ring->tail
+          < __atomic_load_n (&(p_seg->p_hdr->head), __ATOMIC_ACQUIRE));
+
+  (void) __atomic_fetch_and (&(slot_at (p_seg->p_hdr, ap_ring->tail)->pending),
+                             ~(1u << ap_ring->consumer), __ATOMIC_SEQ_CST);
+  ++ap_ring->tail;
+  wake_producer (p_seg);
+}
@@ -0,0 +1,233 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizshmring.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Shared memory broadcast ring
+ *
+ *
+ */
+
+#ifndef TIZSHMRING_H
+#define TIZSHMRING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @defgroup tizshmring Shared memory broadcast ring
+*
+* A ring of fixed-size slots in an anonymous shared memory segment (memfd),
+* written by a single producer and read in place by up to
+* TIZ_SHM_RING_MAX_CONSUMERS consumers. A slot is recycled once every
+* consumer that was subscribed when it was published has released it, so the
+* slowest consumer throttles the producer. Readiness is signalled through one
+* eventfd per consumer and one for the producer, which can be watched from an
+* event loop.
+*
+* Rings are looked up by name within a process. The segment and its eventfds
+* can also be handed to another process over a unix domain socket.
+*
+* @ingroup libtizplatform
+*/
+
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Maximum number of consumers subscribed to a ring at the same time.
+ * @ingroup tizshmring
+ */
+#define TIZ_SHM_RING_MAX_CONSUMERS 8
+
+/**
+ * Shared memory ring opaque handle.
+ * @ingroup tizshmring
+ */
+typedef struct tiz_shm_ring tiz_shm_ring_t;
+typedef /*@null@ */ tiz_shm_ring_t * tiz_shm_ring_ptr_t;
+
+/**
+ * Open a handle to the ring with the given name, creating the ring if this is
+ * the first handle to it in this process.
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param ap_name The ring's name.
+ * @param a_nslots The number of slots (2-4096). Only used when the ring is
+ * created.
+ * @param a_slot_size The payload capacity of each slot, in bytes. Only used
+ * when the ring is created.
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter on invalid
+ * parameters, OMX_ErrorInsufficientResources if the segment or the eventfds
+ * could not be created.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_open (tiz_shm_ring_ptr_t * app_ring, const char * ap_name,
+                   const OMX_U32 a_nslots, const OMX_U32 a_slot_size);
+
+/**
+ * Send the ring's segment and eventfds to another process.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_sock A connected unix domain socket.
+ * @return OMX_ErrorNone on success, OMX_ErrorUndefined otherwise.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_export (const tiz_shm_ring_t * ap_ring, const int a_sock);
+
+/**
+ * Open a handle to a ring exported by another process with
+ * tiz_shm_ring_export.
+ *
+ * @ingroup tizshmring
+ * @param app_ring A ring handle to be initialised.
+ * @param a_sock A connected unix domain socket.
+ * @return OMX_ErrorNone on success, OMX_ErrorUndefined if the ring could not
+ * be received, OMX_ErrorInsufficientResources on OOM.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_import (tiz_shm_ring_ptr_t * app_ring, const int a_sock);
+
+/**
+ * Close a ring handle. A subscribed handle is unsubscribed first. The ring is
+ * destroyed when its last handle in the process is closed.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_close (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Retrieve the payload capacity of the ring's slots.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return The slot size, in bytes.
+ */
+size_t
+tiz_shm_ring_slot_size (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * Retrieve the file descriptor that becomes readable when the handle may
+ * make progress: a slot has been freed (producer handles) or published
+ * (subscribed handles).
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return An eventfd.
+ */
+int
+tiz_shm_ring_fd (const tiz_shm_ring_t * ap_ring);
+
+/**
+ * Clear the notification pending in the handle's file descriptor.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_clear_fd (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Obtain the next free slot. Only one handle may act as the producer.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param app_data Where the slot's payload area is returned.
+ * @return OMX_ErrorNone on success, OMX_ErrorNoMore if all slots are still
+ * being read; the handle's file descriptor is signalled when one is freed.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_claim (tiz_shm_ring_t * ap_ring, void ** app_data);
+
+/**
+ * Make the slot obtained with tiz_shm_ring_claim available to the consumers
+ * that are subscribed at this point. With no consumers, the data is dropped.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @param a_len The number of bytes written to the slot.
+ * @param a_flags OMX buffer flags.
+ * @param a_timestamp OMX buffer timestamp.
+ */
+void
+tiz_shm_ring_publish (tiz_shm_ring_t * ap_ring, const size_t a_len,
+                      const OMX_U32 a_flags, const OMX_TICKS a_timestamp);
+
+/**
+ * Subscribe the handle to the ring. Only the slots published from now on are
+ * seen.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ * @return OMX_ErrorNone on success, OMX_ErrorNoMore if the ring already has
+ * TIZ_SHM_RING_MAX_CONSUMERS consumers.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_subscribe (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Unsubscribe the handle, releasing all the slots not yet read.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring The ring handle.
+ */
+void
+tiz_shm_ring_unsubscribe (tiz_shm_ring_t * ap_ring);
+
+/**
+ * Obtain the oldest published slot not yet released by this handle. The
+ * payload stays valid, and is not copied, until tiz_shm_ring_release.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring A subscribed ring handle.
+ * @param app_data Where the slot's payload is returned.
+ * @param ap_len Where the payload length is returned.
+ * @param ap_flags Where the OMX buffer flags are returned.
+ * @param ap_timestamp Where the OMX buffer timestamp is returned.
+ * @return OMX_ErrorNone on success, OMX_ErrorNoMore if there is nothing to
+ * read; the handle's file descriptor is signalled when there is.
+ */
+OMX_ERRORTYPE
+tiz_shm_ring_peek (tiz_shm_ring_t * ap_ring, const void ** app_data,
+                   size_t * ap_len, OMX_U32 * ap_flags,
+                   OMX_TICKS * ap_timestamp);
+
+/**
+ * Release the slot obtained with tiz_shm_ring_peek.
+ *
+ * @ingroup tizshmring
+ * @param ap_ring A subscribed ring handle.
+ */
+void
+tiz_shm_ring_release (tiz_shm_ring_t * ap_ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZSHMRING_H */
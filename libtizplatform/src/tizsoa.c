@@ -33,6 +33,8 @@
 #include "tizplatform.h"
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -41,10 +43,21 @@
 #define TIZ_LOG_CATEGORY_NAME "tiz.platform.soa"
 #endif
 
-#define SOA_MAX_SLICE_SIZE 256
+#define SOA_MAX_SLICE_SIZE 1024
 #define SOA_SLICE_ALIGN 8
 #define SOA_CHUNK_SZ 4096
 
+/* Number of free slices per class that a thread keeps before handing them
+   back to the other threads (thread-safe allocators only) */
+#define SOA_MAGAZINE_SIZE 32
+/* Size of a thread's table of magazines, indexed by allocator id. Ids are
+   handed out sequentially, so a thread can serve this many allocators created
+   around the same time without any two of them sharing a slot. */
+#define SOA_MAGAZINE_SLOTS 64
+/* Number of slots looked at, from the allocator's own, before one is
+   reclaimed */
+#define SOA_MAGAZINE_PROBES 4
+
 static const int32_t chunk_class_tbl[] = {
   0, 0, 0, 0, 0,                                 /* 32 bytes */
   1, 1, 1, 1,                                    /* 64 bytes */
@@ -54,27 +67,91 @@ static const int32_t chunk_class_tbl[] = {
 };
 
 static const size_t slice_sz_tbl[TIZ_SOA_NUM_CHUNK_CLASSES]
-  = {32, 64, 96, 128, 256};
+  = {32, 64, 96, 128, 256, 512, 1024};
 
 typedef struct chunk chunk_t;
 struct chunk
 {
   chunk_t * p_next;
   tiz_soa_t * p_soa;
-  int32_t n_allocated_slices;
   int32_t class;
-  uint8_t data[SOA_CHUNK_SZ];
+  uint8_t data[SOA_CHUNK_SZ] __attribute__ ((aligned (SOA_SLICE_ALIGN)));
 };
 
 typedef struct slice slice_t;
 struct slice
 {
   size_t size;
-  chunk_t * p_chunk;
+  chunk_t * p_chunk; /* NULL for objects too large for any chunk class */
   slice_t * p_next_free;
 };
 #define SLICE_PREAMBLE_SZ (sizeof (size_t) + sizeof (chunk_t *))
 
+typedef struct soa_magazine soa_magazine_t;
+struct soa_magazine
+{
+  uint64_t soa_id; /* 0 when the slot is unused */
+  slice_t * p_head[TIZ_SOA_NUM_CHUNK_CLASSES];
+  slice_t * p_tail[TIZ_SOA_NUM_CHUNK_CLASSES];
+  int32_t count[TIZ_SOA_NUM_CHUNK_CLASSES];
+  /* Statistics not yet published to the allocator */
+  int32_t class_delta[TIZ_SOA_NUM_CHUNK_CLASSES];
+  int64_t allocs;
+  int64_t frees;
+  int64_t hits;
+  int32_t ops;
+};
+
+struct tiz_soa
+{
+  slice_t * p_slice_store[TIZ_SOA_NUM_CHUNK_CLASSES];
+  slice_t * p_pending_chain;
+  chunk_t * p_chunk_lst;
+  int32_t n_chunks;
+  int32_t n_class_objects[TIZ_SOA_NUM_CHUNK_CLASSES];
+  int32_t n_large_objects;
+  int64_t n_allocs;
+  int64_t n_frees;
+  int64_t n_magazine_hits;
+  int64_t n_remote_refills;
+  /* Thread-safe variant only */
+  OMX_U32 flags;
+  uint64_t id;
+  tiz_soa_t * p_next_live;
+  tiz_mutex_t mutex; /* protects p_slice_store and the chunk list */
+  slice_t * p_remote_free[TIZ_SOA_NUM_CHUNK_CLASSES];
+};
+
+/* Registry of the thread-safe allocators that are alive. A thread only hands
+   back the contents of a magazine it is retiring when its allocator is still
+   in this list. */
+static pthread_mutex_t g_live_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tiz_soa_t * gp_live_lst = NULL;
+static uint64_t g_next_soa_id = 1;
+
+static pthread_once_t g_exit_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_exit_key;
+
+/* Allocated on first use, to keep it out of the static TLS block */
+static __thread soa_magazine_t * tp_magazines = NULL;
+
+static inline bool
+is_thread_safe (const tiz_soa_t * p_soa)
+{
+  return (p_soa->flags & TIZ_SOA_FLAG_THREAD_SAFE) != 0;
+}
+
+static inline int32_t
+get_chunk_class (size_t alloc_sz)
+{
+  assert (alloc_sz <= SOA_MAX_SLICE_SIZE);
+  if (alloc_sz <= 256)
+    {
+      return chunk_class_tbl[alloc_sz / SOA_SLICE_ALIGN];
+    }
+  return alloc_sz <= 512 ? 5 : 6;
+}
+
 static inline uint8_t *
 get_usr_ptr (slice_t * p_slice)
 {
@@ -87,63 +164,390 @@ get_slice_ptr (void * p_usr)
   return ((slice_t *) ((uint8_t *) p_usr - SLICE_PREAMBLE_SZ));
 }
 
-struct tiz_soa
+static inline void
+add_counter32 (const tiz_soa_t * p_soa, int32_t * p_counter, int32_t a_val)
 {
-  slice_t * p_slice_store[TIZ_SOA_NUM_CHUNK_CLASSES];
-  slice_t * p_pending_chain;
-  chunk_t * p_chunk_lst;
-  int32_t n_chunks;
-  int32_t n_allocated_objects;
-};
+  if (is_thread_safe (p_soa))
+    {
+      (void) __atomic_add_fetch (p_counter, a_val, __ATOMIC_RELAXED);
+    }
+  else
+    {
+      *p_counter += a_val;
+    }
+}
 
-/*@null@*/ static slice_t *
+static inline void
+add_counter64 (const tiz_soa_t * p_soa, int64_t * p_counter, int64_t a_val)
+{
+  if (is_thread_safe (p_soa))
+    {
+      (void) __atomic_add_fetch (p_counter, a_val, __ATOMIC_RELAXED);
+    }
+  else
+    {
+      *p_counter += a_val;
+    }
+}
+
+/* Carves a new chunk into slices and prepends them to the class's store. The
+   caller holds the allocator's mutex in the thread-safe variant. */
+static OMX_ERRORTYPE
 alloc_chunk (tiz_soa_t * p_soa, int32_t chunk_class)
 {
+  chunk_t * p_new_chunk = NULL;
   slice_t * p_slice = NULL;
-  int32_t num_slices = 0;
   size_t slice_sz = 0;
-  chunk_t * p_new_chunk = NULL;
+  int32_t num_slices = 0;
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "chunk_class [%d] ", chunk_class);
 
   assert (p_soa != NULL);
-  assert (chunk_class < TIZ_SOA_NUM_CHUNK_CLASSES);
+  assert (chunk_class >= 0 && chunk_class < TIZ_SOA_NUM_CHUNK_CLASSES);
+
+  if (NULL == (p_new_chunk = tiz_mem_calloc (1, sizeof (chunk_t))))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_new_chunk->p_soa = p_soa;
+  p_new_chunk->p_next = p_soa->p_chunk_lst;
+  p_new_chunk->class = chunk_class;
+  p_soa->p_chunk_lst = p_new_chunk;
+  p_soa->n_chunks += 1;
 
   slice_sz = slice_sz_tbl[chunk_class];
+  num_slices = SOA_CHUNK_SZ / slice_sz - 1;
+  p_slice = (slice_t *) p_new_chunk->data;
+  while (num_slices-- > 0)
+    {
+      slice_t * p_next = (slice_t *) ((uint8_t *) p_slice + slice_sz);
+      p_slice->p_chunk = p_new_chunk;
+      p_slice->size = 0;
+      p_slice->p_next_free = p_next;
+      p_slice = p_next;
+    }
+
+  p_slice->p_chunk = p_new_chunk;
+  p_slice->size = 0;
+  p_slice->p_next_free = p_soa->p_slice_store[chunk_class];
+  p_soa->p_slice_store[chunk_class] = (slice_t *) p_new_chunk->data;
 
-  if ((p_new_chunk = tiz_mem_calloc (1, sizeof (chunk_t))))
-    {
-      p_new_chunk->p_soa = p_soa;
-      p_new_chunk->p_next = p_soa->p_chunk_lst;
-      p_new_chunk->n_allocated_slices = 0;
-      p_new_chunk->class = chunk_class;
-      p_soa->p_chunk_lst = p_new_chunk;
-      p_soa->n_chunks += 1;
-      num_slices = SOA_CHUNK_SZ / slice_sz - 2;
-      p_soa->p_slice_store[chunk_class] = p_slice
-        = (slice_t *) (p_new_chunk->data + slice_sz);
-      do
+  return OMX_ErrorNone;
+}
+
+/*@null@*/ static slice_t *
+get_slice (tiz_soa_t * p_soa, int32_t chunk_class)
+{
+  slice_t * p_slice = p_soa->p_slice_store[chunk_class];
+
+  if (NULL == p_slice && OMX_ErrorNone == alloc_chunk (p_soa, chunk_class))
+    {
+      p_slice = p_soa->p_slice_store[chunk_class];
+    }
+
+  if (p_slice)
+    {
+      p_soa->p_slice_store[chunk_class] = p_slice->p_next_free;
+    }
+
+  return p_slice;
+}
+
+/*
+ * Thread-safe variant
+ */
+
+static void
+push_remote_chain (tiz_soa_t * p_soa, int32_t chunk_class, slice_t * p_head,
+                   slice_t * p_tail)
+{
+  slice_t * p_top
+    = __atomic_load_n (&(p_soa->p_remote_free[chunk_class]), __ATOMIC_RELAXED);
+  do
+    {
+      p_tail->p_next_free = p_top;
+    }
+  while (!__atomic_compare_exchange_n (&(p_soa->p_remote_free[chunk_class]),
+                                       &p_top, p_head, true, __ATOMIC_RELEASE,
+                                       __ATOMIC_RELAXED));
+}
+
+static void
+publish_stats (tiz_soa_t * p_soa, soa_magazine_t * p_mag)
+{
+  int32_t i = 0;
+  for (i = 0; i < TIZ_SOA_NUM_CHUNK_CLASSES; ++i)
+    {
+      if (p_mag->class_delta[i] != 0)
         {
-          slice_t * p_next = (slice_t *) ((uint8_t *) p_slice + slice_sz);
-          p_slice->p_chunk = p_new_chunk;
-          p_slice->size = 0;
-          p_slice->p_next_free = p_next;
-          p_slice = p_next;
+          (void) __atomic_add_fetch (&(p_soa->n_class_objects[i]),
+                                     p_mag->class_delta[i], __ATOMIC_RELAXED);
+          p_mag->class_delta[i] = 0;
         }
-      while (--num_slices != 0);
+    }
+  (void) __atomic_add_fetch (&(p_soa->n_allocs), p_mag->allocs,
+                             __ATOMIC_RELAXED);
+  (void) __atomic_add_fetch (&(p_soa->n_frees), p_mag->frees,
+                             __ATOMIC_RELAXED);
+  (void) __atomic_add_fetch (&(p_soa->n_magazine_hits), p_mag->hits,
+                             __ATOMIC_RELAXED);
+  p_mag->allocs = p_mag->frees = p_mag->hits = 0;
+  p_mag->ops = 0;
+}
 
-      p_slice->p_chunk = p_new_chunk;
-      p_slice->size = 0;
-      p_slice->p_next_free = NULL;
-      p_slice = (slice_t *) p_new_chunk->data;
-      p_slice->p_chunk = p_new_chunk;
+static void
+flush_magazine (tiz_soa_t * p_soa, soa_magazine_t * p_mag,
+                int32_t chunk_class)
+{
+  if (p_mag->p_head[chunk_class])
+    {
+      push_remote_chain (p_soa, chunk_class, p_mag->p_head[chunk_class],
+                         p_mag->p_tail[chunk_class]);
+      p_mag->p_head[chunk_class] = NULL;
+      p_mag->p_tail[chunk_class] = NULL;
+      p_mag->count[chunk_class] = 0;
+    }
+}
+
+/* Hands back the contents of a magazine to its allocator, if that is still
+   alive, and frees the slot */
+static void
+retire_magazine (soa_magazine_t * p_mag)
+{
+  if (p_mag->soa_id != 0)
+    {
+      tiz_soa_t * p_soa = NULL;
+      int32_t i = 0;
+
+      (void) pthread_mutex_lock (&g_live_mutex);
+      for (p_soa = gp_live_lst; p_soa && p_soa->id != p_mag->soa_id;
+           p_soa = p_soa->p_next_live)
+        ;
+      if (p_soa)
+        {
+          for (i = 0; i < TIZ_SOA_NUM_CHUNK_CLASSES; ++i)
+            {
+              flush_magazine (p_soa, p_mag, i);
+            }
+          publish_stats (p_soa, p_mag);
+        }
+      (void) pthread_mutex_unlock (&g_live_mutex);
+    }
+  (void) tiz_mem_set (p_mag, 0, sizeof (soa_magazine_t));
+}
+
+static void
+retire_thread_magazines (void * ap_arg)
+{
+  soa_magazine_t * p_mags = ap_arg;
+  int32_t i = 0;
+  for (i = 0; i < SOA_MAGAZINE_SLOTS; ++i)
+    {
+      retire_magazine (&(p_mags[i]));
+    }
+  tp_magazines = NULL;
+  tiz_mem_free (p_mags);
+}
+
+static void
+create_exit_key (void)
+{
+  (void) pthread_key_create (&g_exit_key, retire_thread_magazines);
+}
+
+static inline uint32_t
+magazine_slot (const uint64_t a_soa_id, const uint32_t a_probe)
+{
+  return (uint32_t) (a_soa_id + a_probe) & (SOA_MAGAZINE_SLOTS - 1);
+}
+
+/* Returns the calling thread's magazine for this allocator, if it has one */
+static soa_magazine_t *
+find_magazine (const tiz_soa_t * p_soa)
+{
+  uint32_t i = 0;
+  if (tp_magazines)
+    {
+      for (i = 0; i < SOA_MAGAZINE_PROBES; ++i)
+        {
+          soa_magazine_t * p_mag
+            = &(tp_magazines[magazine_slot (p_soa->id, i)]);
+          if (p_mag->soa_id == p_soa->id)
+            {
+              return p_mag;
+            }
+        }
+    }
+  return NULL;
+}
+
+static soa_magazine_t *
+get_magazine (tiz_soa_t * p_soa)
+{
+  soa_magazine_t * p_mag = NULL;
+  uint32_t i = 0;
+
+  if (NULL == tp_magazines)
+    {
+      if (NULL == (tp_magazines = tiz_mem_calloc (SOA_MAGAZINE_SLOTS,
+                                                  sizeof (soa_magazine_t))))
+        {
+          return NULL;
+        }
+      /* Make sure the magazines are handed back when the thread exits */
+      (void) pthread_once (&g_exit_key_once, create_exit_key);
+      (void) pthread_setspecific (g_exit_key, tp_magazines);
+    }
+
+  for (i = 0; i < SOA_MAGAZINE_PROBES; ++i)
+    {
+      soa_magazine_t * p_slot = &(tp_magazines[magazine_slot (p_soa->id, i)]);
+      if (p_slot->soa_id == p_soa->id)
+        {
+          return p_slot;
+        }
+      if (0 == p_slot->soa_id && NULL == p_mag)
+        {
+          p_mag = p_slot;
+        }
+    }
+
+  if (NULL == p_mag)
+    {
+      /* Only here does the thread need the registry of live allocators */
+      p_mag = &(tp_magazines[magazine_slot (p_soa->id, 0)]);
+      retire_magazine (p_mag);
+    }
+
+  p_mag->soa_id = p_soa->id;
+  return p_mag;
+}
+
+static inline void
+count_op (tiz_soa_t * p_soa, soa_magazine_t * p_mag)
+{
+  if (++p_mag->ops >= SOA_MAGAZINE_SIZE)
+    {
+      publish_stats (p_soa, p_mag);
+    }
+}
+
+/*@null@*/ static slice_t *
+ts_get_slice (tiz_soa_t * p_soa, int32_t chunk_class)
+{
+  soa_magazine_t * p_mag = get_magazine (p_soa);
+  slice_t * p_slice = NULL;
+
+  if (NULL == p_mag)
+    {
+      return NULL;
+    }
+
+  if (NULL != (p_slice = p_mag->p_head[chunk_class]))
+    {
+      p_mag->hits += 1;
+    }
+  else if (NULL != (p_slice = __atomic_exchange_n (
+                      &(p_soa->p_remote_free[chunk_class]), NULL,
+                      __ATOMIC_ACQUIRE)))
+    {
+      /* Take everything other threads have handed back for this class */
+      int32_t count = 0;
+      slice_t * p_tail = p_slice;
+      while (p_tail->p_next_free)
+        {
+          p_tail = p_tail->p_next_free;
+          ++count;
+        }
+      p_mag->p_tail[chunk_class] = p_tail;
+      p_mag->count[chunk_class] = count + 1;
+      (void) __atomic_add_fetch (&(p_soa->n_remote_refills), 1,
+                                 __ATOMIC_RELAXED);
+    }
+  else
+    {
+      /* Take a batch of slices from the shared store */
+      int32_t count = 1;
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      if (NULL != (p_slice = p_soa->p_slice_store[chunk_class])
+          || (OMX_ErrorNone == alloc_chunk (p_soa, chunk_class)
+              && NULL != (p_slice = p_soa->p_slice_store[chunk_class])))
+        {
+          slice_t * p_tail = p_slice;
+          while (p_tail->p_next_free && count < SOA_MAGAZINE_SIZE)
+            {
+              p_tail = p_tail->p_next_free;
+              ++count;
+            }
+          p_soa->p_slice_store[chunk_class] = p_tail->p_next_free;
+          p_tail->p_next_free = NULL;
+          p_mag->p_tail[chunk_class] = p_tail;
+          p_mag->count[chunk_class] = count;
+        }
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+
+  if (p_slice)
+    {
+      p_mag->p_head[chunk_class] = p_slice->p_next_free;
+      if (NULL == p_mag->p_head[chunk_class])
+        {
+          p_mag->p_tail[chunk_class] = NULL;
+        }
+      p_mag->count[chunk_class] -= 1;
+      p_mag->class_delta[chunk_class] += 1;
+      p_mag->allocs += 1;
+      count_op (p_soa, p_mag);
     }
 
   return p_slice;
 }
 
+static void
+ts_put_slice (tiz_soa_t * p_soa, int32_t chunk_class, slice_t * p_slice)
+{
+  soa_magazine_t * p_mag = get_magazine (p_soa);
+
+  if (NULL == p_mag)
+    {
+      /* No magazines for this thread; hand the slice straight back */
+      push_remote_chain (p_soa, chunk_class, p_slice, p_slice);
+      add_counter32 (p_soa, &(p_soa->n_class_objects[chunk_class]), -1);
+      add_counter64 (p_soa, &(p_soa->n_frees), 1);
+      return;
+    }
+
+  p_slice->p_next_free = p_mag->p_head[chunk_class];
+  p_mag->p_head[chunk_class] = p_slice;
+  if (NULL == p_mag->p_tail[chunk_class])
+    {
+      p_mag->p_tail[chunk_class] = p_slice;
+    }
+  p_mag->class_delta[chunk_class] -= 1;
+  p_mag->frees += 1;
+
+  if (++p_mag->count[chunk_class] > SOA_MAGAZINE_SIZE)
+    {
+      /* Let other threads, e.g. the one that allocates the objects this
+         thread is freeing, reuse the slices */
+      flush_magazine (p_soa, p_mag, chunk_class);
+    }
+  count_op (p_soa, p_mag);
+}
+
+/*
+ * Public API
+ */
+
 OMX_ERRORTYPE
 tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa)
+{
+  return tiz_soa_init_with_flags (app_soa, TIZ_SOA_FLAG_DEFAULT);
+}
+
+OMX_ERRORTYPE
+tiz_soa_init_with_flags (/*@null@ */ tiz_soa_ptr_t * app_soa, OMX_U32 a_flags)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   tiz_soa_t * p_soa = NULL;
@@ -154,6 +558,23 @@ tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa)
     {
       rc = OMX_ErrorInsufficientResources;
     }
+  else if (a_flags & TIZ_SOA_FLAG_THREAD_SAFE)
+    {
+      if (OMX_ErrorNone != (rc = tiz_mutex_init (&(p_soa->mutex))))
+        {
+          tiz_mem_free (p_soa);
+          p_soa = NULL;
+        }
+      else
+        {
+          p_soa->flags = a_flags;
+          (void) pthread_mutex_lock (&g_live_mutex);
+          p_soa->id = g_next_soa_id++;
+          p_soa->p_next_live = gp_live_lst;
+          gp_live_lst = p_soa;
+          (void) pthread_mutex_unlock (&g_live_mutex);
+        }
+    }
 
   *app_soa = p_soa;
 
@@ -163,12 +584,23 @@ tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa)
 OMX_ERRORTYPE
 tiz_soa_reserve_chunk (tiz_soa_t * p_soa, int32_t chunk_class)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
   assert (p_soa != NULL);
   assert (chunk_class < TIZ_SOA_NUM_CHUNK_CLASSES);
 
-  return alloc_chunk (p_soa, chunk_class) == NULL
-           ? OMX_ErrorInsufficientResources
-           : OMX_ErrorNone;
+  if (is_thread_safe (p_soa))
+    {
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      rc = alloc_chunk (p_soa, chunk_class);
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+  else
+    {
+      rc = alloc_chunk (p_soa, chunk_class);
+    }
+
+  return rc;
 }
 
 void
@@ -179,6 +611,26 @@ tiz_soa_destroy (tiz_soa_t * p_soa)
       chunk_t * p_chunk = NULL;
       chunk_t * p_next = NULL;
 
+      if (is_thread_safe (p_soa))
+        {
+          tiz_soa_t ** pp_soa = NULL;
+          soa_magazine_t * p_mag = NULL;
+
+          (void) pthread_mutex_lock (&g_live_mutex);
+          for (pp_soa = &gp_live_lst; *pp_soa != p_soa;
+               pp_soa = &((*pp_soa)->p_next_live))
+            ;
+          *pp_soa = p_soa->p_next_live;
+          (void) pthread_mutex_unlock (&g_live_mutex);
+
+          if (NULL != (p_mag = find_magazine (p_soa)))
+            {
+              (void) tiz_mem_set (p_mag, 0, sizeof (soa_magazine_t));
+            }
+
+          tiz_mutex_destroy (&(p_soa->mutex));
+        }
+
       p_chunk = p_soa->p_chunk_lst;
 
       while (p_chunk != NULL)
@@ -197,36 +649,42 @@ tiz_soa_calloc (tiz_soa_t * p_soa, size_t size)
 {
   size_t alloc_sz = ((size + SOA_SLICE_ALIGN - 1) & ~(SOA_SLICE_ALIGN - 1))
                     + SLICE_PREAMBLE_SZ;
+  slice_t * p_slice = NULL;
   uint8_t * p_usr = NULL;
 
   assert (p_soa);
   assert (alloc_sz > 0);
-  assert (alloc_sz <= SOA_MAX_SLICE_SIZE);
 
-  {
-    int32_t chunk_class = chunk_class_tbl[alloc_sz / SOA_SLICE_ALIGN];
-    slice_t * p_slice = NULL;
-
-    p_slice = p_soa->p_slice_store[chunk_class];
-
-    if (NULL == p_slice)
-      {
-        p_slice = alloc_chunk (p_soa, chunk_class);
-      }
-    else
-      {
-        p_soa->p_slice_store[chunk_class] = p_slice->p_next_free;
-      }
-
-    if (p_slice)
-      {
-        p_slice->p_chunk->n_allocated_slices += 1;
-        p_soa->n_allocated_objects += 1;
-        p_slice->size = alloc_sz;
-        p_usr = get_usr_ptr (p_slice);
-        (void) tiz_mem_set (p_usr, 0, size);
-      }
-  }
+  if (alloc_sz > SOA_MAX_SLICE_SIZE)
+    {
+      /* Too large for any of the chunk classes */
+      if ((p_slice = tiz_mem_alloc (alloc_sz)))
+        {
+          p_slice->p_chunk = NULL;
+          add_counter32 (p_soa, &(p_soa->n_large_objects), 1);
+          add_counter64 (p_soa, &(p_soa->n_allocs), 1);
+        }
+    }
+  else
+    {
+      int32_t chunk_class = get_chunk_class (alloc_sz);
+      if (is_thread_safe (p_soa))
+        {
+          p_slice = ts_get_slice (p_soa, chunk_class);
+        }
+      else if ((p_slice = get_slice (p_soa, chunk_class)))
+        {
+          p_soa->n_class_objects[chunk_class] += 1;
+          p_soa->n_allocs += 1;
+        }
+    }
+
+  if (p_slice)
+    {
+      p_slice->size = alloc_sz;
+      p_usr = get_usr_ptr (p_slice);
+      (void) tiz_mem_set (p_usr, 0, size);
+    }
 
   return p_usr;
 }
@@ -239,20 +697,34 @@ tiz_soa_free (tiz_soa_t * p_soa, void * p_addr)
   if (p_addr)
     {
       slice_t * p_slice = get_slice_ptr (p_addr);
+      chunk_t * p_chunk = p_slice->p_chunk;
 
-      assert (p_slice != NULL);
-      assert (p_slice->size <= SOA_MAX_SLICE_SIZE);
-      {
-        chunk_t * p_chunk = p_slice->p_chunk;
-        int32_t chunk_class = chunk_class_tbl[p_slice->size / SOA_SLICE_ALIGN];
-
-        assert (p_chunk != NULL);
-
-        p_slice->p_chunk->n_allocated_slices -= 1;
-        p_soa->n_allocated_objects -= 1;
-        p_slice->p_next_free = p_soa->p_slice_store[chunk_class];
-        p_soa->p_slice_store[chunk_class] = p_slice;
-      }
+      if (NULL == p_chunk)
+        {
+          assert (p_slice->size > SOA_MAX_SLICE_SIZE);
+          add_counter32 (p_soa, &(p_soa->n_large_objects), -1);
+          add_counter64 (p_soa, &(p_soa->n_frees), 1);
+          tiz_mem_free (p_slice);
+        }
+      else
+        {
+          int32_t chunk_class = p_chunk->class;
+
+          assert (p_chunk->p_soa == p_soa);
+          assert (p_slice->size <= slice_sz_tbl[chunk_class]);
+
+          if (is_thread_safe (p_soa))
+            {
+              ts_put_slice (p_soa, chunk_class, p_slice);
+            }
+          else
+            {
+              p_soa->n_class_objects[chunk_class] -= 1;
+              p_soa->n_frees += 1;
+              p_slice->p_next_free = p_soa->p_slice_store[chunk_class];
+              p_soa->p_slice_store[chunk_class] = p_slice;
+            }
+        }
     }
 }
 
@@ -260,26 +732,45 @@ void
 tiz_soa_info (tiz_soa_t * p_soa, tiz_soa_info_t * p_info)
 {
   int32_t i = 0;
-  chunk_t * p_chunk = NULL;
 
   assert (p_soa != NULL);
   assert (p_info != NULL);
 
   (void) tiz_mem_set (p_info, 0, sizeof (tiz_soa_info_t));
 
-  p_info->chunks = p_soa->n_chunks;
-  p_chunk = p_soa->p_chunk_lst;
-
-  for (i = p_soa->n_chunks; i > 0; --i)
+  if (is_thread_safe (p_soa))
     {
-      p_info->slices[p_chunk->class] = p_chunk->n_allocated_slices;
-      p_chunk = p_chunk->p_next;
+      /* Other threads publish their statistics in batches; make sure at least
+         the caller's are up to date */
+      soa_magazine_t * p_mag = find_magazine (p_soa);
+      if (p_mag)
+        {
+          publish_stats (p_soa, p_mag);
+        }
+      (void) tiz_mutex_lock (&(p_soa->mutex));
+      p_info->chunks = p_soa->n_chunks;
+      (void) tiz_mutex_unlock (&(p_soa->mutex));
+    }
+  else
+    {
+      p_info->chunks = p_soa->n_chunks;
     }
 
-  assert (p_chunk == NULL);
-
-  p_info->chunks = p_soa->n_chunks;
-  p_info->objects = p_soa->n_allocated_objects;
+  for (i = 0; i < TIZ_SOA_NUM_CHUNK_CLASSES; ++i)
+    {
+      p_info->slices[i]
+        = __atomic_load_n (&(p_soa->n_class_objects[i]), __ATOMIC_RELAXED);
+      p_info->objects += p_info->slices[i];
+    }
+  p_info->large_objects
+    = __atomic_load_n (&(p_soa->n_large_objects), __ATOMIC_RELAXED);
+  p_info->objects += p_info->large_objects;
+  p_info->allocations = __atomic_load_n (&(p_soa->n_allocs), __ATOMIC_RELAXED);
+  p_info->frees = __atomic_load_n (&(p_soa->n_frees), __ATOMIC_RELAXED);
+  p_info->magazine_hits
+    = __atomic_load_n (&(p_soa->n_magazine_hits), __ATOMIC_RELAXED);
+  p_info->remote_refills
+    = __atomic_load_n (&(p_soa->n_remote_refills), __ATOMIC_RELAXED);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "objects [%d] chunks [%d]", p_info->objects,
            p_info->chunks);
@@ -39,14 +39,30 @@ extern "C" {
 #include <OMX_Types.h>
 #include <OMX_Core.h>
 
-#define TIZ_SOA_NUM_CHUNK_CLASSES 5
+#define TIZ_SOA_NUM_CHUNK_CLASSES 7
 
 typedef struct tiz_soa tiz_soa_t;
 typedef /*@null@ */ tiz_soa_t * tiz_soa_ptr_t;
 
+typedef enum tiz_soa_flags
+{
+  /* Unsynchronised allocator; all calls must be made from the same thread
+     (the default). */
+  TIZ_SOA_FLAG_DEFAULT = 0x00,
+  /* Allocations and frees may be made from any thread. Each thread keeps a
+     small magazine of free slices per size class, and slices freed by a
+     thread whose magazine is full are handed back to the other threads
+     through a lock-free list. */
+  TIZ_SOA_FLAG_THREAD_SAFE = 0x01
+} tiz_soa_flags_t;
+
 OMX_ERRORTYPE
 tiz_soa_init (/*@null@ */ tiz_soa_ptr_t * app_soa);
 
+OMX_ERRORTYPE
+tiz_soa_init_with_flags (/*@null@ */ tiz_soa_ptr_t * app_soa,
+                         OMX_U32 a_flags);
+
 void
 tiz_soa_destroy (tiz_soa_t * p_soa);
 
@@ -68,6 +84,17 @@ struct tiz_soa_info
   int32_t objects;
   /* Number of slices currently in use in each chunk class */
   int32_t slices[TIZ_SOA_NUM_CHUNK_CLASSES];
+  /* Number of objects currently in use that were too large for any chunk
+     class and were obtained from the heap */
+  int32_t large_objects;
+  /* Total number of allocations and frees served so far */
+  int64_t allocations;
+  int64_t frees;
+  /* Thread-safe allocators only: allocations served from the calling
+     thread's magazine, and magazine refills from the slices freed by other
+     threads */
+  int64_t magazine_hits;
+  int64_t remote_refills;
 };
 
 void
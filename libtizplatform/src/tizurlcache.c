@@ -0,0 +1,1082 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Disk-backed cache of a seekable URL
+ *
+ * The state of each chunk (missing, in flight or done) is shared by the
+ * reader and the fetcher thread, under the cache's mutex. The curl handles
+ * are only ever used by the fetcher thread. The reader wakes the fetcher up,
+ * through a second eventfd that curl_multi_wait watches, when the read
+ * position moves to another chunk, so that the download window follows it.
+ *
+ * On disk, an entry is a pair of files named after a hash of the url:
+ * 'HASH.data', the sparse file with the resource's bytes, and 'HASH.idx', a
+ * text file with the url, the validator, the length and one character per
+ * chunk ('1' for the chunks downloaded). The data file is locked while in
+ * use, so that a second cache of the same url (in this process or another)
+ * works on a private file instead.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include <curl/curl.h>
+
+#include "tizmem.h"
+#include "tizlog.h"
+#include "tizmacros.h"
+#include "tizthread.h"
+#include "tizurlcache.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.platform.urlcache"
+#endif
+
+#define URL_CACHE_IDX_MAGIC "tizonia-urlcache\t1"
+#define URL_CACHE_RETRY_SECS 1
+#define URL_CACHE_WAIT_MS 1000
+
+typedef enum url_cache_chunk_state url_cache_chunk_state_t;
+enum url_cache_chunk_state
+{
+  EUrlCacheChunkMissing = 0,
+  EUrlCacheChunkInFlight,
+  EUrlCacheChunkDone
+};
+
+typedef struct url_cache_req url_cache_req_t;
+struct url_cache_req
+{
+  tiz_urlcache_t * p_cache;
+  CURL * p_curl;
+  OMX_S64 chunk; /* -1 when idle */
+  OMX_S64 offset;
+  OMX_S64 end;
+  OMX_ERRORTYPE fatal;
+};
+
+struct tiz_urlcache
+{
+  char * p_url;
+  char * p_validator;
+  OMX_S64 length;
+  OMX_S64 nchunks;
+  OMX_S64 window_chunks;
+  int nreqs;
+  int data_fd;
+  char * p_idx_path; /* NULL if the cache is not kept on disk */
+  int ev_fd;         /* reader notifications */
+  int ctl_fd;        /* fetcher wakeups */
+  pthread_mutex_t mutex;
+  /* Protected by mutex */
+  unsigned char * p_state;
+  OMX_S64 ndone;
+  OMX_S64 read_pos;
+  OMX_ERRORTYPE error;
+  time_t not_before;
+  bool stop;
+  /* Fetcher thread only */
+  CURLM * p_multi;
+  url_cache_req_t reqs[TIZ_URL_CACHE_MAX_CONNECTIONS];
+  tiz_thread_t thread;
+  bool thread_started;
+};
+
+static inline void
+signal_fd (const int a_fd)
+{
+  const uint64_t one = 1;
+  if (sizeof (one) != write (a_fd, &one, sizeof (one)))
+    {
+      /* The counter is only saturated if nobody reads it; that is fine */
+    }
+}
+
+static inline void
+drain_fd (const int a_fd)
+{
+  uint64_t count = 0;
+  if (sizeof (count) != read (a_fd, &count, sizeof (count)))
+    {
+      /* EAGAIN: nothing pending */
+    }
+}
+
+static inline OMX_S64
+chunk_end (const tiz_urlcache_t * ap_cache, const OMX_S64 a_chunk)
+{
+  return MIN (ap_cache->length, (a_chunk + 1) * TIZ_URL_CACHE_CHUNK_SIZE);
+}
+
+static inline OMX_S64
+chunk_bytes (const tiz_urlcache_t * ap_cache, const OMX_S64 a_chunk)
+{
+  return chunk_end (ap_cache, a_chunk) - a_chunk * TIZ_URL_CACHE_CHUNK_SIZE;
+}
+
+/* FNV-1a */
+static uint64_t
+hash_of (const char * ap_str)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  while (*ap_str)
+    {
+      hash ^= (unsigned char) *ap_str++;
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+static char *
+cache_dir (void)
+{
+  const char * p_xdg = getenv ("XDG_CACHE_HOME");
+  const char * p_home = getenv ("HOME");
+  const char * p_base = NULL;
+  const char * p_suffix = NULL;
+  char * p_dir = NULL;
+  size_t len = 0;
+
+  if (p_xdg && *p_xdg)
+    {
+      p_base = p_xdg;
+      p_suffix = "/tizonia/urlcache";
+    }
+  else if (p_home && *p_home)
+    {
+      p_base = p_home;
+      p_suffix = "/.cache/tizonia/urlcache";
+    }
+
+  if (p_base)
+    {
+      len = strlen (p_base) + strlen (p_suffix) + 1;
+      if (len <= PATH_MAX && (p_dir = tiz_mem_alloc (len)))
+        {
+          (void) snprintf (p_dir, len, "%s%s", p_base, p_suffix);
+        }
+    }
+  return p_dir;
+}
+
+/* Creates the directory and its parents */
+static bool
+make_dir (char * ap_dir)
+{
+  char * p_slash = ap_dir;
+  while ((p_slash = strchr (p_slash + 1, '/')))
+    {
+      *p_slash = '\0';
+      (void) mkdir (ap_dir, 0700);
+      *p_slash = '/';
+    }
+  return 0 == mkdir (ap_dir, 0700) || EEXIST == errno;
+}
+
+static char *
+entry_path (const char * ap_dir, const uint64_t a_key, const char * ap_ext)
+{
+  const size_t len = strlen (ap_dir) + 1 + 16 + strlen (ap_ext) + 1;
+  char * p_path = tiz_mem_alloc (len);
+  if (p_path)
+    {
+      (void) snprintf (p_path, len, "%s/%016llx%s", ap_dir,
+                       (unsigned long long) a_key, ap_ext);
+    }
+  return p_path;
+}
+
+static bool
+read_line (FILE * ap_file, char ** app_line, size_t * ap_cap)
+{
+  ssize_t len = getline (app_line, ap_cap, ap_file);
+  if (len <= 0 || '\n' != (*app_line)[len - 1])
+    {
+      return false;
+    }
+  (*app_line)[len - 1] = '\0';
+  return true;
+}
+
+/* Reloads the list of chunks downloaded, if the index describes the same
+   resource */
+static bool
+load_idx (tiz_urlcache_t * ap_cache)
+{
+  FILE * p_file = NULL;
+  char * p_line = NULL;
+  size_t cap = 0;
+  bool loaded = false;
+
+  assert (ap_cache);
+  assert (ap_cache->p_idx_path);
+
+  if (!(p_file = fopen (ap_cache->p_idx_path, "r")))
+    {
+      return false;
+    }
+
+  if (read_line (p_file, &p_line, &cap)
+      && 0 == strcmp (p_line, URL_CACHE_IDX_MAGIC)
+      && read_line (p_file, &p_line, &cap)
+      && 0 == strcmp (p_line, ap_cache->p_url)
+      && read_line (p_file, &p_line, &cap)
+      && 0 == strcmp (p_line, ap_cache->p_validator)
+      && read_line (p_file, &p_line, &cap))
+    {
+      long long length = 0;
+      long chunk_size = 0;
+      if (2 == sscanf (p_line, "%lld\t%ld", &length, &chunk_size)
+          && length == ap_cache->length
+          && TIZ_URL_CACHE_CHUNK_SIZE == chunk_size
+          && read_line (p_file, &p_line, &cap)
+          && (OMX_S64) strlen (p_line) == ap_cache->nchunks)
+        {
+          OMX_S64 i = 0;
+          for (i = 0; i < ap_cache->nchunks; ++i)
+            {
+              if ('1' == p_line[i])
+                {
+                  ap_cache->p_state[i] = EUrlCacheChunkDone;
+                  ++ap_cache->ndone;
+                }
+            }
+          loaded = true;
+        }
+    }
+
+  free (p_line);
+  (void) fclose (p_file);
+  return loaded;
+}
+
+static void
+save_idx (tiz_urlcache_t * ap_cache)
+{
+  char * p_tmp_path = NULL;
+  FILE * p_file = NULL;
+  bool written = false;
+  size_t len = 0;
+  OMX_S64 i = 0;
+
+  assert (ap_cache);
+  assert (ap_cache->p_idx_path);
+
+  /* Written aside and renamed, so that other processes never see a partial
+     index */
+  len = strlen (ap_cache->p_idx_path) + 24;
+  if (!(p_tmp_path = tiz_mem_alloc (len)))
+    {
+      return;
+    }
+  (void) snprintf (p_tmp_path, len, "%s.%ld", ap_cache->p_idx_path,
+                   (long) getpid ());
+
+  if ((p_file = fopen (p_tmp_path, "w")))
+    {
+      written
+        = fprintf (p_file, "%s\n%s\n%s\n%lld\t%ld\n", URL_CACHE_IDX_MAGIC,
+                   ap_cache->p_url, ap_cache->p_validator,
+                   (long long) ap_cache->length,
+                   (long) TIZ_URL_CACHE_CHUNK_SIZE)
+          > 0;
+      for (i = 0; written && i < ap_cache->nchunks; ++i)
+        {
+          written = EOF
+                    != fputc (EUrlCacheChunkDone == ap_cache->p_state[i] ? '1'
+                                                                         : '0',
+                              p_file);
+        }
+      written = written && EOF != fputc ('\n', p_file);
+      written = (0 == fclose (p_file)) && written;
+    }
+
+  if (!written || 0 != rename (p_tmp_path, ap_cache->p_idx_path))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "Unable to save [%s] : %s",
+               ap_cache->p_idx_path, strerror (errno));
+      (void) unlink (p_tmp_path);
+    }
+  tiz_mem_free (p_tmp_path);
+}
+
+typedef struct url_cache_entry url_cache_entry_t;
+struct url_cache_entry
+{
+  char name[32];
+  time_t mtime;
+  off_t bytes;
+};
+
+static int
+compare_entries (const void * ap_a, const void * ap_b)
+{
+  const url_cache_entry_t * p_a = ap_a;
+  const url_cache_entry_t * p_b = ap_b;
+  return (p_a->mtime > p_b->mtime) - (p_a->mtime < p_b->mtime);
+}
+
+/* Removes the least recently used entries (the index is rewritten each time
+   an entry is used), until the directory holds at most a_budget bytes. The
+   entries in use are skipped. */
+static void
+evict_entries (const char * ap_dir, const uint64_t a_key,
+               const off_t a_budget)
+{
+  DIR * p_dir = NULL;
+  struct dirent * p_ent = NULL;
+  url_cache_entry_t * p_entries = NULL;
+  size_t count = 0;
+  size_t cap = 0;
+  off_t total = 0;
+  size_t i = 0;
+  char own[32];
+
+  if (!(p_dir = opendir (ap_dir)))
+    {
+      return;
+    }
+
+  (void) snprintf (own, sizeof (own), "%016llx", (unsigned long long) a_key);
+  while ((p_ent = readdir (p_dir)))
+    {
+      struct stat st;
+      const char * p_ext = strstr (p_ent->d_name, ".data");
+      if (!p_ext || 0 != strcmp (p_ext, ".data")
+          || (size_t) (p_ext - p_ent->d_name) >= sizeof (own)
+          || 0 != fstatat (dirfd (p_dir), p_ent->d_name, &st, 0))
+        {
+          continue;
+        }
+      /* Sparse files only take up the space of the chunks downloaded */
+      total += (off_t) st.st_blocks * 512;
+      if (0 == strncmp (p_ent->d_name, own, p_ext - p_ent->d_name))
+        {
+          continue;
+        }
+      if (count == cap)
+        {
+          url_cache_entry_t * p_new = tiz_mem_realloc (
+            p_entries, (cap ? cap * 2 : 16) * sizeof (url_cache_entry_t));
+          if (!p_new)
+            {
+              break;
+            }
+          p_entries = p_new;
+          cap = cap ? cap * 2 : 16;
+        }
+      (void) snprintf (p_entries[count].name, sizeof (p_entries[count].name),
+                       "%.*s", (int) (p_ext - p_ent->d_name), p_ent->d_name);
+      p_entries[count].mtime = st.st_mtime;
+      p_entries[count].bytes = (off_t) st.st_blocks * 512;
+      ++count;
+    }
+
+  if (0 == count)
+    {
+      /* Nothing else to evict; p_entries was never allocated */
+      (void) closedir (p_dir);
+      return;
+    }
+
+  qsort (p_entries, count, sizeof (url_cache_entry_t), compare_entries);
+
+  for (i = 0; i < count && total > a_budget; ++i)
+    {
+      char path[64];
+      int fd = -1;
+      (void) snprintf (path, sizeof (path), "%s.data", p_entries[i].name);
+      fd = openat (dirfd (p_dir), path, O_RDWR | O_CLOEXEC);
+      if (fd >= 0 && 0 == flock (fd, LOCK_EX | LOCK_NB))
+        {
+          (void) unlinkat (dirfd (p_dir), path, 0);
+          (void) snprintf (path, sizeof (path), "%s.idx", p_entries[i].name);
+          (void) unlinkat (dirfd (p_dir), path, 0);
+          total -= p_entries[i].bytes;
+        }
+      if (fd >= 0)
+        {
+          (void) close (fd);
+        }
+    }
+
+  tiz_mem_free (p_entries);
+  (void) closedir (p_dir);
+}
+
+/* Opens the entry for this url in the cache directory, if the cache is to be
+   kept on disk and the entry is not in use */
+static bool
+open_disk_store (tiz_urlcache_t * ap_cache, const size_t a_disk_bytes)
+{
+  const uint64_t key = hash_of (ap_cache->p_url);
+  char * p_dir = NULL;
+  char * p_data_path = NULL;
+  bool opened = false;
+  struct stat st;
+
+  if (!ap_cache->p_validator || 0 == a_disk_bytes
+      || (OMX_S64) a_disk_bytes < ap_cache->length || !(p_dir = cache_dir ())
+      || !make_dir (p_dir) || !(p_data_path = entry_path (p_dir, key, ".data"))
+      || !(ap_cache->p_idx_path = entry_path (p_dir, key, ".idx")))
+    {
+      goto end;
+    }
+
+  if ((ap_cache->data_fd
+       = open (p_data_path, O_RDWR | O_CREAT | O_CLOEXEC, 0600))
+      < 0)
+    {
+      goto end;
+    }
+
+  if (0 != flock (ap_cache->data_fd, LOCK_EX | LOCK_NB))
+    {
+      TIZ_LOG (TIZ_PRIORITY_NOTICE, "[%s] is in use", p_data_path);
+      goto end;
+    }
+
+  /* The data file may have been removed and created again since the index
+     was written */
+  if (0 != fstat (ap_cache->data_fd, &st) || st.st_size != ap_cache->length
+      || !load_idx (ap_cache))
+    {
+      if (0 != ftruncate (ap_cache->data_fd, 0))
+        {
+          goto end;
+        }
+    }
+
+  if (0 == ftruncate (ap_cache->data_fd, ap_cache->length))
+    {
+      evict_entries (p_dir, key, (off_t) (a_disk_bytes - ap_cache->length));
+      opened = true;
+    }
+
+end:
+
+  if (!opened)
+    {
+      if (ap_cache->data_fd >= 0)
+        {
+          (void) close (ap_cache->data_fd);
+          ap_cache->data_fd = -1;
+        }
+      tiz_mem_free (ap_cache->p_idx_path);
+      ap_cache->p_idx_path = NULL;
+      memset (ap_cache->p_state, EUrlCacheChunkMissing, ap_cache->nchunks);
+      ap_cache->ndone = 0;
+    }
+  tiz_mem_free (p_data_path);
+  tiz_mem_free (p_dir);
+  return opened;
+}
+
+/* A file that goes away with the cache */
+static bool
+open_private_store (tiz_urlcache_t * ap_cache)
+{
+  char path[] = "/tmp/tizurlcache.XXXXXX";
+  const char * p_tmpdir = getenv ("TMPDIR");
+  char * p_path = path;
+  bool opened = false;
+
+  if (p_tmpdir && *p_tmpdir
+      && (p_path = tiz_mem_alloc (strlen (p_tmpdir) + sizeof (path))))
+    {
+      (void) sprintf (p_path, "%s/tizurlcache.XXXXXX", p_tmpdir);
+    }
+  else
+    {
+      p_path = path;
+    }
+
+  if ((ap_cache->data_fd = mkostemp (p_path, O_CLOEXEC)) >= 0)
+    {
+      (void) unlink (p_path);
+      opened = (0 == ftruncate (ap_cache->data_fd, ap_cache->length));
+    }
+
+  if (p_path != path)
+    {
+      tiz_mem_free (p_path);
+    }
+  return opened;
+}
+
+static size_t
+fetcher_write_cback (void * ap_ptr, size_t a_size, size_t a_nmemb,
+                     void * ap_userdata)
+{
+  url_cache_req_t * p_req = ap_userdata;
+  const size_t nbytes = a_size * a_nmemb;
+  long code = 0;
+
+  assert (p_req);
+
+  if (p_req->offset == p_req->chunk * TIZ_URL_CACHE_CHUNK_SIZE
+      && CURLE_OK
+           == curl_easy_getinfo (p_req->p_curl, CURLINFO_RESPONSE_CODE, &code)
+      && 206 != code
+      && !(200 == code && 0 == p_req->chunk
+           && p_req->end == p_req->p_cache->length))
+    {
+      /* The server is sending something else than the range asked for */
+      p_req->fatal = OMX_ErrorNotImplemented;
+      return 0;
+    }
+
+  if (p_req->offset + (OMX_S64) nbytes > p_req->end)
+    {
+      p_req->fatal = OMX_ErrorStreamCorrupt;
+      return 0;
+    }
+
+  if ((ssize_t) nbytes
+      != pwrite (p_req->p_cache->data_fd, ap_ptr, nbytes, p_req->offset))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "pwrite failed : %s", strerror (errno));
+      p_req->fatal = OMX_ErrorInsufficientResources;
+      return 0;
+    }
+
+  p_req->offset += nbytes;
+  return nbytes;
+}
+
+static bool
+start_request (tiz_urlcache_t * ap_cache, url_cache_req_t * ap_req,
+               const OMX_S64 a_chunk)
+{
+  char range[64];
+  CURL * p_curl = ap_req->p_curl;
+
+  ap_req->chunk = a_chunk;
+  ap_req->offset = a_chunk * TIZ_URL_CACHE_CHUNK_SIZE;
+  ap_req->end = chunk_end (ap_cache, a_chunk);
+  ap_req->fatal = OMX_ErrorNone;
+
+  (void) snprintf (range, sizeof (range), "%lld-%lld",
+                   (long long) ap_req->offset, (long long) ap_req->end - 1);
+
+  curl_easy_reset (p_curl);
+  if (CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_URL, ap_cache->p_url)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_RANGE, range)
+      || CURLE_OK
+           != curl_easy_setopt (p_curl, CURLOPT_WRITEFUNCTION,
+                                fetcher_write_cback)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_WRITEDATA, ap_req)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_PRIVATE, ap_req)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_USERAGENT, "tizonia")
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_FOLLOWLOCATION, 1L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_MAXREDIRS, 5L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_FAILONERROR, 1L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_NOSIGNAL, 1L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_CONNECTTIMEOUT, 20L)
+      /* A stalled request is given up on, and retried */
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_LOW_SPEED_LIMIT, 1L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_LOW_SPEED_TIME, 30L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_SSL_VERIFYHOST, 0L)
+      || CURLE_OK != curl_easy_setopt (p_curl, CURLOPT_SSL_VERIFYPEER, 0L)
+      || CURLM_OK != curl_multi_add_handle (ap_cache->p_multi, p_curl))
+    {
+      ap_req->chunk = -1;
+      return false;
+    }
+
+  ap_cache->p_state[a_chunk] = EUrlCacheChunkInFlight;
+  return true;
+}
+
+static void
+abandon_request (tiz_urlcache_t * ap_cache, url_cache_req_t * ap_req)
+{
+  (void) curl_multi_remove_handle (ap_cache->p_multi, ap_req->p_curl);
+  ap_cache->p_state[ap_req->chunk] = EUrlCacheChunkMissing;
+  ap_req->chunk = -1;
+}
+
+/* Keeps the connections busy with the missing chunks of the window that
+   starts at the read position, nearest first */
+static void
+schedule_requests (tiz_urlcache_t * ap_cache)
+{
+  OMX_S64 first = 0;
+  OMX_S64 last = 0;
+  OMX_S64 next = 0;
+  int i = 0;
+
+  (void) pthread_mutex_lock (&(ap_cache->mutex));
+
+  first = MIN (ap_cache->read_pos / TIZ_URL_CACHE_CHUNK_SIZE,
+               ap_cache->nchunks - 1);
+  last = MIN (first + ap_cache->window_chunks, ap_cache->nchunks);
+
+  for (i = 0; i < ap_cache->nreqs; ++i)
+    {
+      url_cache_req_t * p_req = &(ap_cache->reqs[i]);
+      if (p_req->chunk >= 0 && (p_req->chunk < first || p_req->chunk >= last))
+        {
+          abandon_request (ap_cache, p_req);
+        }
+    }
+
+  next = first;
+  for (i = 0; i < ap_cache->nreqs && OMX_ErrorNone == ap_cache->error
+              && !ap_cache->stop && time (NULL) >= ap_cache->not_before;
+       ++i)
+    {
+      url_cache_req_t * p_req = &(ap_cache->reqs[i]);
+      if (p_req->chunk >= 0)
+        {
+          continue;
+        }
+      while (next < last
+             && EUrlCacheChunkMissing != ap_cache->p_state[next])
+        {
+          ++next;
+        }
+      if (next == last || !start_request (ap_cache, p_req, next))
+        {
+          break;
+        }
+    }
+
+  (void) pthread_mutex_unlock (&(ap_cache->mutex));
+}
+
+static void
+collect_requests (tiz_urlcache_t * ap_cache)
+{
+  CURLMsg * p_msg = NULL;
+  int left = 0;
+
+  while ((p_msg = curl_multi_info_read (ap_cache->p_multi, &left)))
+    {
+      url_cache_req_t * p_req = NULL;
+      long code = 0;
+
+      if (CURLMSG_DONE != p_msg->msg
+          || CURLE_OK != curl_easy_getinfo (p_msg->easy_handle,
+                                            CURLINFO_PRIVATE, &p_req)
+          || !p_req || p_req->chunk < 0)
+        {
+          continue;
+        }
+
+      (void) curl_easy_getinfo (p_req->p_curl, CURLINFO_RESPONSE_CODE, &code);
+      (void) curl_multi_remove_handle (ap_cache->p_multi, p_req->p_curl);
+
+      (void) pthread_mutex_lock (&(ap_cache->mutex));
+      if (CURLE_OK == p_msg->data.result && p_req->offset == p_req->end)
+        {
+          ap_cache->p_state[p_req->chunk] = EUrlCacheChunkDone;
+          ++ap_cache->ndone;
+          signal_fd (ap_cache->ev_fd);
+        }
+      else
+        {
+          ap_cache->p_state[p_req->chunk] = EUrlCacheChunkMissing;
+          if (OMX_ErrorNone != p_req->fatal
+              || (code >= 400 && code < 500 && 408 != code && 429 != code))
+            {
+              TIZ_LOG (TIZ_PRIORITY_ERROR,
+                       "[%s] : range request failed (code %ld) : %s",
+                       ap_cache->p_url, code,
+                       curl_easy_strerror (p_msg->data.result));
+              ap_cache->error = (OMX_ErrorNone != p_req->fatal
+                                   ? p_req->fatal
+                                   : OMX_ErrorContentURIError);
+              signal_fd (ap_cache->ev_fd);
+            }
+          else
+            {
+              TIZ_LOG (TIZ_PRIORITY_NOTICE,
+                       "[%s] : range request failed (code %ld) : %s - "
+                       "retrying",
+                       ap_cache->p_url, code,
+                       curl_easy_strerror (p_msg->data.result));
+              ap_cache->not_before = time (NULL) + URL_CACHE_RETRY_SECS;
+            }
+        }
+      p_req->chunk = -1;
+      (void) pthread_mutex_unlock (&(ap_cache->mutex));
+    }
+}
+
+static void *
+fetcher_thread_func (void * ap_arg)
+{
+  tiz_urlcache_t * p_cache = ap_arg;
+  bool stop = false;
+
+  assert (p_cache);
+
+  (void) tiz_thread_setname (&(p_cache->thread),
+                             (const OMX_STRING) "tizurlcache");
+
+  while (!stop)
+    {
+      struct curl_waitfd ctl = {p_cache->ctl_fd, CURL_WAIT_POLLIN, 0};
+      int running = 0;
+
+      schedule_requests (p_cache);
+      (void) curl_multi_perform (p_cache->p_multi, &running);
+      collect_requests (p_cache);
+      if (running > 0)
+        {
+          /* Some of the requests may have finished during the perform call;
+             start the next ones before waiting */
+          schedule_requests (p_cache);
+        }
+      (void) curl_multi_wait (p_cache->p_multi, &ctl, 1, URL_CACHE_WAIT_MS,
+                              NULL);
+      if (ctl.revents)
+        {
+          drain_fd (p_cache->ctl_fd);
+        }
+
+      (void) pthread_mutex_lock (&(p_cache->mutex));
+      stop = p_cache->stop;
+      (void) pthread_mutex_unlock (&(p_cache->mutex));
+    }
+
+  return NULL;
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_init (tiz_urlcache_ptr_t * app_cache, const char * ap_url,
+                   const char * ap_validator, const OMX_S64 a_length,
+                   const int a_connections, const size_t a_window_bytes,
+                   const size_t a_disk_bytes)
+{
+  tiz_urlcache_t * p_cache = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  int i = 0;
+
+  assert (app_cache);
+  assert (ap_url);
+
+  if (!app_cache || !ap_url || a_length <= 0 || a_connections <= 0
+      || a_connections > TIZ_URL_CACHE_MAX_CONNECTIONS)
+    {
+      return OMX_ErrorBadParameter;
+    }
+
+  p_cache = (tiz_urlcache_t *) tiz_mem_calloc (1, sizeof (tiz_urlcache_t));
+  tiz_check_null_ret_oom (p_cache != NULL);
+
+  p_cache->data_fd = -1;
+  p_cache->ev_fd = -1;
+  p_cache->ctl_fd = -1;
+  p_cache->length = a_length;
+  p_cache->nchunks
+    = (a_length + TIZ_URL_CACHE_CHUNK_SIZE - 1) / TIZ_URL_CACHE_CHUNK_SIZE;
+  p_cache->window_chunks
+    = MAX (1, (OMX_S64) a_window_bytes / TIZ_URL_CACHE_CHUNK_SIZE);
+  p_cache->nreqs = a_connections;
+  p_cache->error = OMX_ErrorNone;
+  (void) pthread_mutex_init (&(p_cache->mutex), NULL);
+  for (i = 0; i < TIZ_URL_CACHE_MAX_CONNECTIONS; ++i)
+    {
+      p_cache->reqs[i].p_cache = p_cache;
+      p_cache->reqs[i].chunk = -1;
+    }
+
+  if (!(p_cache->p_url = strdup (ap_url))
+      || (ap_validator && *ap_validator
+          && !(p_cache->p_validator = strdup (ap_validator)))
+      || !(p_cache->p_state = tiz_mem_calloc (1, p_cache->nchunks)))
+    {
+      goto end;
+    }
+
+  /* The validator is stored as a line of text */
+  if (p_cache->p_validator && strpbrk (p_cache->p_validator, "\r\n"))
+    {
+      free (p_cache->p_validator);
+      p_cache->p_validator = NULL;
+    }
+
+  if (!open_disk_store (p_cache, a_disk_bytes)
+      && !open_private_store (p_cache))
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to create the cache file : %s",
+               strerror (errno));
+      goto end;
+    }
+
+  if ((p_cache->ev_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0
+      || (p_cache->ctl_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0
+      || CURLE_OK != curl_global_init (CURL_GLOBAL_ALL))
+    {
+      goto end;
+    }
+
+  if (!(p_cache->p_multi = curl_multi_init ()))
+    {
+      curl_global_cleanup ();
+      goto end;
+    }
+
+  for (i = 0; i < p_cache->nreqs; ++i)
+    {
+      if (!(p_cache->reqs[i].p_curl = curl_easy_init ()))
+        {
+          goto end;
+        }
+    }
+
+  if (OMX_ErrorNone
+      != tiz_thread_create (&(p_cache->thread), 0, 0, fetcher_thread_func,
+                            p_cache))
+    {
+      goto end;
+    }
+  p_cache->thread_started = true;
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "[%s] : %lld bytes, %lld cached", ap_url,
+           (long long) a_length, (long long) tiz_urlcache_cached (p_cache));
+
+  rc = OMX_ErrorNone;
+
+end:
+
+  if (OMX_ErrorNone != rc)
+    {
+      tiz_urlcache_destroy (p_cache);
+      p_cache = NULL;
+    }
+
+  *app_cache = p_cache;
+  return rc;
+}
+
+void
+tiz_urlcache_destroy (tiz_urlcache_t * ap_cache)
+{
+  int i = 0;
+
+  if (!ap_cache)
+    {
+      return;
+    }
+
+  if (ap_cache->thread_started)
+    {
+      void * p_result = NULL;
+      (void) pthread_mutex_lock (&(ap_cache->mutex));
+      ap_cache->stop = true;
+      (void) pthread_mutex_unlock (&(ap_cache->mutex));
+      signal_fd (ap_cache->ctl_fd);
+      (void) tiz_thread_join (&(ap_cache->thread), &p_result);
+    }
+
+  for (i = 0; i < TIZ_URL_CACHE_MAX_CONNECTIONS; ++i)
+    {
+      url_cache_req_t * p_req = &(ap_cache->reqs[i]);
+      if (p_req->p_curl)
+        {
+          if (p_req->chunk >= 0)
+            {
+              abandon_request (ap_cache, p_req);
+            }
+          curl_easy_cleanup (p_req->p_curl);
+        }
+    }
+
+  if (ap_cache->p_multi)
+    {
+      curl_multi_cleanup (ap_cache->p_multi);
+      curl_global_cleanup ();
+    }
+
+  if (ap_cache->p_idx_path)
+    {
+      save_idx (ap_cache);
+      tiz_mem_free (ap_cache->p_idx_path);
+    }
+
+  if (ap_cache->data_fd >= 0)
+    {
+      (void) close (ap_cache->data_fd);
+    }
+  if (ap_cache->ev_fd >= 0)
+    {
+      (void) close (ap_cache->ev_fd);
+    }
+  if (ap_cache->ctl_fd >= 0)
+    {
+      (void) close (ap_cache->ctl_fd);
+    }
+
+  (void) pthread_mutex_destroy (&(ap_cache->mutex));
+  tiz_mem_free (ap_cache->p_state);
+  free (ap_cache->p_validator);
+  free (ap_cache->p_url);
+  tiz_mem_free (ap_cache);
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_read (tiz_urlcache_t * ap_cache, void * ap_buf,
+                   const size_t a_nbytes, size_t * ap_nread)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_S64 pos = 0;
+  OMX_S64 avail = 0;
+  ssize_t nread = 0;
+
+  assert (ap_cache);
+  assert (ap_buf);
+  assert (ap_nread);
+
+  *ap_nread = 0;
+
+  (void) pthread_mutex_lock (&(ap_cache->mutex));
+  pos = ap_cache->read_pos;
+  if (OMX_ErrorNone != ap_cache->error)
+    {
+      rc = ap_cache->error;
+    }
+  else if (pos < ap_cache->length)
+    {
+      OMX_S64 chunk = pos / TIZ_URL_CACHE_CHUNK_SIZE;
+      while (chunk < ap_cache->nchunks && avail < (OMX_S64) a_nbytes
+             && EUrlCacheChunkDone == ap_cache->p_state[chunk])
+        {
+          avail = chunk_end (ap_cache, chunk++) - pos;
+        }
+      rc = (avail > 0 ? OMX_ErrorNone : OMX_ErrorNoMore);
+    }
+  (void) pthread_mutex_unlock (&(ap_cache->mutex));
+
+  if (avail > 0)
+    {
+      if ((nread = pread (ap_cache->data_fd, ap_buf,
+                          MIN (avail, (OMX_S64) a_nbytes), pos))
+          <= 0)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "pread failed : %s", strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+
+      (void) pthread_mutex_lock (&(ap_cache->mutex));
+      ap_cache->read_pos = pos + nread;
+      (void) pthread_mutex_unlock (&(ap_cache->mutex));
+      *ap_nread = nread;
+
+      /* The window has moved */
+      if (pos / TIZ_URL_CACHE_CHUNK_SIZE
+          != (pos + nread) / TIZ_URL_CACHE_CHUNK_SIZE)
+        {
+          signal_fd (ap_cache->ctl_fd);
+        }
+    }
+
+  return rc;
+}
+
+OMX_ERRORTYPE
+tiz_urlcache_seek (tiz_urlcache_t * ap_cache, const OMX_S64 a_offset)
+{
+  assert (ap_cache);
+  if (a_offset < 0 || a_offset > ap_cache->length)
+    {
+      return OMX_ErrorBadParameter;
+    }
+  (void) pthread_mutex_lock (&(ap_cache->mutex));
+  ap_cache->read_pos = a_offset;
+  (void) pthread_mutex_unlock (&(ap_cache->mutex));
+  signal_fd (ap_cache->ctl_fd);
+  return OMX_ErrorNone;
+}
+
+OMX_S64
+tiz_urlcache_tell (const tiz_urlcache_t * ap_cache)
+{
+  OMX_S64 pos = 0;
+  assert (ap_cache);
+  (void) pthread_mutex_lock ((pthread_mutex_t *) &(ap_cache->mutex));
+  pos = ap_cache->read_pos;
+  (void) pthread_mutex_unlock ((pthread_mutex_t *) &(ap_cache->mutex));
+  return pos;
+}
+
+OMX_S64
+tiz_urlcache_length (const tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  return ap_cache->length;
+}
+
+OMX_S64
+tiz_urlcache_cached (const tiz_urlcache_t * ap_cache)
+{
+  OMX_S64 bytes = 0;
+  assert (ap_cache);
+  (void) pthread_mutex_lock ((pthread_mutex_t *) &(ap_cache->mutex));
+  bytes = ap_cache->ndone * TIZ_URL_CACHE_CHUNK_SIZE;
+  if (ap_cache->nchunks > 0
+      && EUrlCacheChunkDone == ap_cache->p_state[ap_cache->nchunks - 1])
+    {
+      /* The last chunk may be a short one */
+      bytes -= TIZ_URL_CACHE_CHUNK_SIZE
+               - chunk_bytes (ap_cache, ap_cache->nchunks - 1);
+    }
+  (void) pthread_mutex_unlock ((pthread_mutex_t *) &(ap_cache->mutex));
+  return bytes;
+}
+
+int
+tiz_urlcache_fd (const tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  return ap_cache->ev_fd;
+}
+
+void
+tiz_urlcache_clear_fd (tiz_urlcache_t * ap_cache)
+{
+  assert (ap_cache);
+  drain_fd (ap_cache->ev_fd);
+}
@@ -0,0 +1,192 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizurlcache.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia Platform - Disk-backed cache of a seekable URL
+ *
+ *
+ */
+
+#ifndef TIZURLCACHE_H
+#define TIZURLCACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* @defgroup tizurlcache Disk-backed cache of a seekable URL
+*
+* A sparse file that holds a remote resource of known length, in fixed-size
+* chunks. A fetcher thread downloads the chunks that are missing ahead of the
+* read position, with several HTTP range requests in parallel, and the reader
+* takes the data from the file as soon as it is there. Moving the read
+* position re-targets the fetcher, so seeks and replays are served from the
+* chunks already downloaded.
+*
+* When the resource has a validator (an ETag or a Last-Modified date), the
+* file and the list of chunks downloaded are kept in the user's cache
+* directory, keyed by the url, and reused by later caches of the same url and
+* validator. The least recently used files are removed to keep the directory
+* within its size limit.
+*
+* Readiness is signalled through an eventfd, which can be watched from an
+* event loop.
+*
+* @ingroup libtizplatform
+*/
+
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+/**
+ * Size of the chunks that make up the cache, in bytes. Each range request
+ * downloads one chunk.
+ * @ingroup tizurlcache
+ */
+#define TIZ_URL_CACHE_CHUNK_SIZE (256 * 1024)
+
+/**
+ * Maximum number of range requests in flight.
+ * @ingroup tizurlcache
+ */
+#define TIZ_URL_CACHE_MAX_CONNECTIONS 8
+
+/**
+ * Url cache opaque handle.
+ * @ingroup tizurlcache
+ */
+typedef struct tiz_urlcache tiz_urlcache_t;
+typedef /*@null@ */ tiz_urlcache_t * tiz_urlcache_ptr_t;
+
+/**
+ * Create a cache of a url, and start downloading it from offset 0.
+ *
+ * @ingroup tizurlcache
+ * @param app_cache A cache handle to be initialised.
+ * @param ap_url The url of the resource. The server must honour range
+ * requests.
+ * @param ap_validator The resource's ETag or Last-Modified value, or NULL.
+ * The cache is not kept on disk without one.
+ * @param a_length The length of the resource, in bytes.
+ * @param a_connections The number of range requests in flight (1 -
+ * TIZ_URL_CACHE_MAX_CONNECTIONS).
+ * @param a_window_bytes How far ahead of the read position to download.
+ * @param a_disk_bytes Size limit of the cache directory. Use 0 to keep
+ * nothing on disk.
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter or
+ * OMX_ErrorInsufficientResources otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_init (tiz_urlcache_ptr_t * app_cache, const char * ap_url,
+                   const char * ap_validator, const OMX_S64 a_length,
+                   const int a_connections, const size_t a_window_bytes,
+                   const size_t a_disk_bytes);
+
+/**
+ * Stop the downloads, and save the list of chunks downloaded, if the cache
+ * is kept on disk.
+ *
+ * @ingroup tizurlcache
+ * @param ap_cache The cache handle.
+ */
+void
+tiz_urlcache_destroy (tiz_urlcache_t * ap_cache);
+
+/**
+ * Read from the read position, and advance it.
+ *
+ * @ingroup tizurlcache
+ * @param ap_cache The cache handle.
+ * @param ap_buf The destination buffer.
+ * @param a_nbytes The size of the destination buffer.
+ * @param ap_nread The number of bytes read. 0 at the end of the resource.
+ * @return OMX_ErrorNone on success, OMX_ErrorNoMore if the data at the read
+ * position is not there yet (wait for the fd to become readable), or the
+ * error that stopped the downloads (e.g. the server not honouring range
+ * requests).
+ */
+OMX_ERRORTYPE
+tiz_urlcache_read (tiz_urlcache_t * ap_cache, void * ap_buf,
+                   const size_t a_nbytes, size_t * ap_nread);
+
+/**
+ * Move the read position. The downloads in flight that fall out of the new
+ * window are abandoned.
+ *
+ * @ingroup tizurlcache
+ * @param ap_cache The cache handle.
+ * @param a_offset The new read position (0 - length).
+ * @return OMX_ErrorNone on success, OMX_ErrorBadParameter otherwise.
+ */
+OMX_ERRORTYPE
+tiz_urlcache_seek (tiz_urlcache_t * ap_cache, const OMX_S64 a_offset);
+
+/**
+ * @ingroup tizurlcache
+ * @return The read position.
+ */
+OMX_S64
+tiz_urlcache_tell (const tiz_urlcache_t * ap_cache);
+
+/**
+ * @ingroup tizurlcache
+ * @return The length of the resource.
+ */
+OMX_S64
+tiz_urlcache_length (const tiz_urlcache_t * ap_cache);
+
+/**
+ * @ingroup tizurlcache
+ * @return The number of bytes downloaded so far, including the ones found
+ * on disk.
+ */
+OMX_S64
+tiz_urlcache_cached (const tiz_urlcache_t * ap_cache);
+
+/**
+ * Returns the eventfd that becomes readable when a chunk has been downloaded
+ * or the downloads have stopped with an error.
+ *
+ * @ingroup tizurlcache
+ * @param ap_cache The cache handle.
+ * @return An eventfd.
+ */
+int
+tiz_urlcache_fd (const tiz_urlcache_t * ap_cache);
+
+/**
+ * Consume the notifications pending on the cache's eventfd.
+ *
+ * @ingroup tizurlcache
+ * @param ap_cache The cache handle.
+ */
+void
+tiz_urlcache_clear_fd (tiz_urlcache_t * ap_cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIZURLCACHE_H */
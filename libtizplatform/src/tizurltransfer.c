@@ -32,8 +32,10 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <curl/curl.h>
 
@@ -197,6 +199,7 @@ struct tiz_urltrans
   int internal_buffer_size_initial_;
   CURL * p_curl_;        /* curl easy */
   CURLM * p_curl_multi_; /* curl multi */
+  bool mgr_ref_;
   struct curl_slist * p_http_ok_aliases_;
   struct curl_slist * p_http_headers_;
   httpsrc_curl_state_id_t curl_state_;
@@ -536,6 +539,18 @@ stop_reconnect_timer_watcher (tiz_urltrans_t * ap_trans)
   return rc;
 }
 
+/* Whether curl needs to be called again straight away. The timer callback only
+   reports changes, so the last timeout reported may be a stale zero, e.g. when
+   a request goes out on a connection that is already open. */
+static inline bool
+is_curl_timeout_expired (tiz_urltrans_t * ap_trans)
+{
+  long timeout_ms = -1;
+  assert (ap_trans);
+  return (CURLM_OK == curl_multi_timeout (ap_trans->p_curl_multi_, &timeout_ms)
+          && 0 == timeout_ms);
+}
+
 static OMX_ERRORTYPE
 kickstart_curl_socket (tiz_urltrans_t * ap_trans, int * ap_running_handles)
 {
@@ -546,7 +561,7 @@ kickstart_curl_socket (tiz_urltrans_t * ap_trans, int * ap_running_handles)
       on_curl_multi_error_ret_omx_oom (curl_multi_socket_action (
         ap_trans->p_curl_multi_, CURL_SOCKET_TIMEOUT, 0, ap_running_handles));
     }
-  while (0 == ap_trans->curl_timeout_);
+  while (is_curl_timeout_expired (ap_trans));
 
   return OMX_ErrorNone;
 }
@@ -899,17 +914,272 @@ curl_timer_cback (CURLM * multi, long timeout_ms, void * userp)
   return 0;
 }
 
+/* Process-wide transfer manager. All the transfers in the process share a
+   DNS and TLS session cache, through a curl share handle. When a transfer is
+   destroyed, its easy and multi handles are parked for a while, with the
+   connections in the multi's connection cache still open, so that the next
+   transfer to the same origin (e.g. the next track of a playlist) starts
+   without a new TCP connect and TLS handshake. The connection cache itself is
+   not put in the share handle, as libcurl does not support sharing
+   connections between threads. */
+
+#define URLTRANS_IDLE_MAX 4
+#define URLTRANS_IDLE_MAX_SECS 60
+
+typedef struct urltrans_idle urltrans_idle_t;
+struct urltrans_idle
+{
+  CURL * p_curl;
+  CURLM * p_curl_multi;
+  char * p_origin;
+  time_t since;
+};
+
+typedef struct urltrans_mgr urltrans_mgr_t;
+struct urltrans_mgr
+{
+  int nrefs;
+  CURLSH * p_share;
+  pthread_mutex_t locks[CURL_LOCK_DATA_LAST];
+  urltrans_idle_t idle[URLTRANS_IDLE_MAX]; /* oldest first */
+  int nidle;
+  bool reuse_enabled;
+  bool http2_enabled;
+};
+
+static pthread_mutex_t g_mgr_mutex = PTHREAD_MUTEX_INITIALIZER;
+static urltrans_mgr_t g_mgr; /* Protected by g_mgr_mutex */
+
+static void
+mgr_lock_cback (CURL * p_curl, curl_lock_data data, curl_lock_access access,
+                void * userp)
+{
+  (void) p_curl;
+  (void) access;
+  (void) userp;
+  assert (data < CURL_LOCK_DATA_LAST);
+  (void) pthread_mutex_lock (&(g_mgr.locks[data]));
+}
+
+static void
+mgr_unlock_cback (CURL * p_curl, curl_lock_data data, void * userp)
+{
+  (void) p_curl;
+  (void) userp;
+  assert (data < CURL_LOCK_DATA_LAST);
+  (void) pthread_mutex_unlock (&(g_mgr.locks[data]));
+}
+
+static bool
+mgr_rc_flag (const char * ap_key, const bool a_default)
+{
+  const char * p_value = tiz_rcfile_get_value ("ilcore", ap_key);
+  if (p_value)
+    {
+      return a_default ? 0 != strncmp (p_value, "false", 5)
+                       : 0 == strncmp (p_value, "true", 4);
+    }
+  return a_default;
+}
+
+/* Returns the "scheme://authority" part of a url, or NULL. */
+static char *
+url_origin (const char * ap_url)
+{
+  const char * p_authority = ap_url ? strstr (ap_url, "://") : NULL;
+  if (!p_authority)
+    {
+      return NULL;
+    }
+  p_authority += 3;
+  return strndup (ap_url,
+                  (p_authority - ap_url) + strcspn (p_authority, "/?#"));
+}
+
+static void
+mgr_expire_idle (const time_t a_now, const int a_keep)
+{
+  int nexpired = 0;
+  while (nexpired < g_mgr.nidle
+         && (g_mgr.nidle - nexpired > a_keep
+             || a_now - g_mgr.idle[nexpired].since > URLTRANS_IDLE_MAX_SECS))
+    {
+      urltrans_idle_t * p_idle = &(g_mgr.idle[nexpired++]);
+      curl_multi_cleanup (p_idle->p_curl_multi);
+      curl_easy_cleanup (p_idle->p_curl);
+      free (p_idle->p_origin);
+    }
+  if (nexpired > 0)
+    {
+      g_mgr.nidle -= nexpired;
+      memmove (g_mgr.idle, g_mgr.idle + nexpired,
+               g_mgr.nidle * sizeof (urltrans_idle_t));
+    }
+}
+
 static OMX_ERRORTYPE
-allocate_curl_global_resources (tiz_urltrans_t * ap_trans)
+urltrans_mgr_ref (void)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  bail_on_curl_error (curl_global_init (CURL_GLOBAL_ALL));
-  /* All well */
-  rc = OMX_ErrorNone;
-end:
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  (void) pthread_mutex_lock (&g_mgr_mutex);
+  if (0 == g_mgr.nrefs && !g_mgr.p_share)
+    {
+      int i = 0;
+      if (CURLE_OK != curl_global_init (CURL_GLOBAL_ALL)
+          || !(g_mgr.p_share = curl_share_init ()))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "[OMX_ErrorInsufficientResources] : "
+                                       "unable to init curl");
+          rc = OMX_ErrorInsufficientResources;
+        }
+      else
+        {
+          for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+            {
+              (void) pthread_mutex_init (&(g_mgr.locks[i]), NULL);
+            }
+          (void) curl_share_setopt (g_mgr.p_share, CURLSHOPT_LOCKFUNC,
+                                    mgr_lock_cback);
+          (void) curl_share_setopt (g_mgr.p_share, CURLSHOPT_UNLOCKFUNC,
+                                    mgr_unlock_cback);
+          (void) curl_share_setopt (g_mgr.p_share, CURLSHOPT_SHARE,
+                                    CURL_LOCK_DATA_DNS);
+          (void) curl_share_setopt (g_mgr.p_share, CURLSHOPT_SHARE,
+                                    CURL_LOCK_DATA_SSL_SESSION);
+          g_mgr.nidle = 0;
+          g_mgr.reuse_enabled = mgr_rc_flag ("http-connection-reuse", true);
+          g_mgr.http2_enabled = mgr_rc_flag ("http2-multiplexing", false);
+        }
+    }
+  if (OMX_ErrorNone == rc)
+    {
+      ++g_mgr.nrefs;
+    }
+  (void) pthread_mutex_unlock (&g_mgr_mutex);
   return rc;
 }
 
+static void
+urltrans_mgr_unref (void)
+{
+  (void) pthread_mutex_lock (&g_mgr_mutex);
+  assert (g_mgr.nrefs > 0);
+  --g_mgr.nrefs;
+  mgr_expire_idle (time (NULL), URLTRANS_IDLE_MAX);
+  /* The parked handles keep the manager alive */
+  if (0 == g_mgr.nrefs && 0 == g_mgr.nidle)
+    {
+      int i = 0;
+      (void) curl_share_cleanup (g_mgr.p_share);
+      g_mgr.p_share = NULL;
+      for (i = 0; i < CURL_LOCK_DATA_LAST; ++i)
+        {
+          (void) pthread_mutex_destroy (&(g_mgr.locks[i]));
+        }
+      curl_global_cleanup ();
+    }
+  (void) pthread_mutex_unlock (&g_mgr_mutex);
+}
+
+/* Hands over the handles of the most recent transfer to the origin of
+   ap_url, if there are any parked. */
+static bool
+urltrans_mgr_acquire (const char * ap_url, CURL ** app_curl,
+                      CURLM ** app_curl_multi)
+{
+  char * p_origin = url_origin (ap_url);
+  bool found = false;
+  int i = 0;
+
+  assert (app_curl);
+  assert (app_curl_multi);
+
+  (void) pthread_mutex_lock (&g_mgr_mutex);
+  mgr_expire_idle (time (NULL), URLTRANS_IDLE_MAX);
+  for (i = g_mgr.nidle - 1; p_origin && i >= 0; --i)
+    {
+      if (0 == strcmp (g_mgr.idle[i].p_origin, p_origin))
+        {
+          *app_curl = g_mgr.idle[i].p_curl;
+          *app_curl_multi = g_mgr.idle[i].p_curl_multi;
+          free (g_mgr.idle[i].p_origin);
+          --g_mgr.nidle;
+          memmove (g_mgr.idle + i, g_mgr.idle + i + 1,
+                   (g_mgr.nidle - i) * sizeof (urltrans_idle_t));
+          found = true;
+          break;
+        }
+    }
+  (void) pthread_mutex_unlock (&g_mgr_mutex);
+
+  free (p_origin);
+  return found;
+}
+
+/* Parks the handles of a finished transfer, or destroys them. The easy handle
+   must have been removed from the multi handle already. */
+static void
+urltrans_mgr_release (CURL * ap_curl, CURLM * ap_curl_multi)
+{
+  char * p_url = NULL;
+  char * p_origin = NULL;
+
+  if (ap_curl && ap_curl_multi && g_mgr.reuse_enabled
+      && CURLE_OK == curl_easy_getinfo (ap_curl, CURLINFO_EFFECTIVE_URL, &p_url)
+      && (p_origin = url_origin (p_url)))
+    {
+      /* Forget everything about the transfer, except its connections */
+      curl_easy_reset (ap_curl);
+      (void) pthread_mutex_lock (&g_mgr_mutex);
+      mgr_expire_idle (time (NULL), URLTRANS_IDLE_MAX - 1);
+      g_mgr.idle[g_mgr.nidle].p_curl = ap_curl;
+      g_mgr.idle[g_mgr.nidle].p_curl_multi = ap_curl_multi;
+      g_mgr.idle[g_mgr.nidle].p_origin = p_origin;
+      g_mgr.idle[g_mgr.nidle].since = time (NULL);
+      ++g_mgr.nidle;
+      (void) pthread_mutex_unlock (&g_mgr_mutex);
+    }
+  else
+    {
+      curl_multi_cleanup (ap_curl_multi);
+      curl_easy_cleanup (ap_curl);
+    }
+}
+
+/* Options that stay the same for the lifetime of the handles */
+static OMX_ERRORTYPE
+setup_curl_handles (tiz_urltrans_t * ap_trans)
+{
+  assert (ap_trans);
+  assert (g_mgr.p_share);
+
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_SHARE, g_mgr.p_share));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_DNS_CACHE_TIMEOUT, 300L));
+#if LIBCURL_VERSION_NUM >= 0x071900
+  /* Keep the idle connections alive, and notice when the peer is gone */
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_TCP_KEEPALIVE, 1L));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_TCP_KEEPIDLE, 30L));
+  on_curl_error_ret_omx_oom (
+    curl_easy_setopt (ap_trans->p_curl_, CURLOPT_TCP_KEEPINTVL, 15L));
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072f00
+  if (g_mgr.http2_enabled)
+    {
+      /* Not fatal; libcurl may have been built without HTTP/2 support */
+      (void) curl_easy_setopt (ap_trans->p_curl_, CURLOPT_HTTP_VERSION,
+                               CURL_HTTP_VERSION_2TLS);
+      (void) curl_easy_setopt (ap_trans->p_curl_, CURLOPT_PIPEWAIT, 1L);
+      (void) curl_multi_setopt (ap_trans->p_curl_multi_, CURLMOPT_PIPELINING,
+                                CURLPIPE_MULTIPLEX);
+    }
+#endif
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 allocate_temp_data_store (tiz_urltrans_t * ap_trans)
 {
@@ -917,6 +1187,9 @@ allocate_temp_data_store (tiz_urltrans_t * ap_trans)
   assert (ap_trans->p_store_ == NULL);
   tiz_check_omx (
     tiz_buffer_init (&(ap_trans->p_store_), ap_trans->store_bytes_));
+  /* A ring avoids moving the cached data on every push; the default mode is
+     fine too, if the ring can not be mapped */
+  (void) tiz_buffer_seek_mode (ap_trans->p_store_, TIZ_BUFFER_RING);
   return OMX_ErrorNone;
 }
 
@@ -978,7 +1251,8 @@ allocate_curl_resources (tiz_urltrans_t * ap_trans)
   assert (!ap_trans->p_curl_);
   assert (!ap_trans->p_curl_multi_);
 
-  tiz_check_omx (allocate_curl_global_resources (ap_trans));
+  tiz_check_omx (urltrans_mgr_ref ());
+  ap_trans->mgr_ref_ = true;
 
   TIZ_LOG (TIZ_PRIORITY_DEBUG, "%s", curl_version ());
 
@@ -988,10 +1262,16 @@ allocate_curl_resources (tiz_urltrans_t * ap_trans)
       ap_trans->curl_version_ = p_version_info->version_num;
     }
 
-  /* Init the curl easy handle */
-  tiz_check_null_ret_oom ((ap_trans->p_curl_ = curl_easy_init ()) != NULL);
-  /* Now init the curl multi handle */
-  bail_on_oom ((ap_trans->p_curl_multi_ = curl_multi_init ()));
+  if (!urltrans_mgr_acquire ((const char *) ap_trans->p_uri_param_->contentURI,
+                             &(ap_trans->p_curl_), &(ap_trans->p_curl_multi_)))
+    {
+      /* Init the curl easy handle */
+      bail_on_oom ((ap_trans->p_curl_ = curl_easy_init ()));
+      /* Now init the curl multi handle */
+      bail_on_oom ((ap_trans->p_curl_multi_ = curl_multi_init ()));
+    }
+  goto_end_on_omx_error (setup_curl_handles (ap_trans),
+                         "Unable to set up the curl handles");
   /* this is to ask libcurl to accept ICY OK headers*/
   bail_on_oom ((ap_trans->p_http_ok_aliases_ = curl_slist_append (
                   ap_trans->p_http_ok_aliases_, "ICY 200 OK")));
@@ -1021,10 +1301,27 @@ destroy_curl_resources (tiz_urltrans_t * ap_trans)
   ap_trans->p_http_ok_aliases_ = NULL;
   curl_slist_free_all (ap_trans->p_http_headers_);
   ap_trans->p_http_headers_ = NULL;
-  curl_multi_cleanup (ap_trans->p_curl_multi_);
+  if (ap_trans->p_curl_multi_)
+    {
+      /* The multi's callbacks must not reach this transfer any more */
+      (void) curl_multi_setopt (ap_trans->p_curl_multi_,
+                                CURLMOPT_SOCKETFUNCTION, NULL);
+      (void) curl_multi_setopt (ap_trans->p_curl_multi_, CURLMOPT_TIMERFUNCTION,
+                                NULL);
+      if (ap_trans->p_curl_)
+        {
+          (void) curl_multi_remove_handle (ap_trans->p_curl_multi_,
+                                           ap_trans->p_curl_);
+        }
+    }
+  urltrans_mgr_release (ap_trans->p_curl_, ap_trans->p_curl_multi_);
   ap_trans->p_curl_multi_ = NULL;
-  curl_easy_cleanup (ap_trans->p_curl_);
   ap_trans->p_curl_ = NULL;
+  if (ap_trans->mgr_ref_)
+    {
+      urltrans_mgr_unref ();
+      ap_trans->mgr_ref_ = false;
+    }
 }
 
 OMX_ERRORTYPE
@@ -1080,6 +1377,7 @@ tiz_urltrans_init (tiz_urltrans_ptr_t * app_trans, void * ap_parent,
           p_trans->internal_buffer_size_initial_ = 0;
           p_trans->p_curl_ = NULL;
           p_trans->p_curl_multi_ = NULL;
+          p_trans->mgr_ref_ = false;
           p_trans->p_http_ok_aliases_ = NULL;
           p_trans->p_http_headers_ = NULL;
           p_trans->curl_state_ = ECurlStateStopped;
@@ -1115,7 +1413,6 @@ tiz_urltrans_destroy (tiz_urltrans_t * ap_trans)
       destroy_temp_data_store (ap_trans);
       destroy_events (ap_trans);
       destroy_curl_resources (ap_trans);
-      curl_global_cleanup ();
     }
 }
 
@@ -1162,6 +1459,12 @@ tiz_urltrans_start (tiz_urltrans_t * ap_trans)
       assert (ap_trans->p_curl_multi_);
       /* Kickstart curl to get one or more callbacks called. */
       tiz_check_omx (kickstart_curl_socket (ap_trans, &running_handles));
+      if (!running_handles)
+        {
+          /* Over a connection that is already open, a short transfer may be
+             over by now */
+          report_connection_lost_event (ap_trans);
+        }
     }
   URLTRANS_LOG_API_END (ap_trans);
   ASSERT_ASYNC_EVENTS (ap_trans);
@@ -1271,7 +1574,7 @@ tiz_urltrans_on_io_ready (tiz_urltrans_t * ap_trans, tiz_event_io_t * ap_ev_io,
             ap_trans->p_curl_multi_, ap_trans->sockfd_, curl_ev_bitmask,
             &running_handles));
         }
-      while (0 == ap_trans->curl_timeout_);
+      while (is_curl_timeout_expired (ap_trans));
 
       if (!running_handles)
         {
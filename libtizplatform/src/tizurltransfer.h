@@ -40,6 +40,10 @@ extern "C" {
  * A URL file transfer API (based on libcurl) to be used in Tizonia processor
  * objects that need to access files over HTTP or FILE protocols.
  *
+ * All the transfers in a process share a DNS and TLS session cache. The
+ * connections of a destroyed transfer are kept open for a while, and handed
+ * over to the next transfer to the same origin.
+ *
  * @ingroup libtizplatform
  */
 
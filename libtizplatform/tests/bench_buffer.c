@@ -0,0 +1,117 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_buffer.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Dynamic buffer micro-benchmark: default vs ring mode
+ *
+ * Mimics the http source's use of the buffer: the network pushes chunks of
+ * data, and whenever the backlog is above a threshold, the component copies
+ * it out in OpenMAX IL buffer sized pieces.
+ *
+ * Usage: bench_buffer [backlog in KiB] [MiB to transfer]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/tizplatform.h"
+
+#define BENCH_BUFFER_CHUNK_SIZE 16384    /* Same as curl's write callback */
+#define BENCH_BUFFER_OMX_BUFFER_SIZE 8192 /* Typical http source buffer */
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double
+run (const char * ap_name, int a_mode, long a_backlog, long a_total)
+{
+  tiz_buffer_t * p_buf = NULL;
+  static unsigned char chunk[BENCH_BUFFER_CHUNK_SIZE];
+  static unsigned char omx_buffer[BENCH_BUFFER_OMX_BUFFER_SIZE];
+  double start, elapsed;
+  long pushed = 0;
+
+  if (OMX_ErrorNone != tiz_buffer_init (&p_buf, BENCH_BUFFER_OMX_BUFFER_SIZE)
+      || -1 == tiz_buffer_seek_mode (p_buf, a_mode))
+    {
+      fprintf (stderr, "%s: could not create the buffer\n", ap_name);
+      exit (EXIT_FAILURE);
+    }
+
+  memset (chunk, 0xa5, sizeof (chunk));
+  start = now_secs ();
+
+  while (pushed < a_total)
+    {
+      pushed += tiz_buffer_push (p_buf, chunk, sizeof (chunk));
+      while (tiz_buffer_available (p_buf) > a_backlog)
+        {
+          const int nbytes = tiz_buffer_available (p_buf)
+                             < BENCH_BUFFER_OMX_BUFFER_SIZE
+                               ? tiz_buffer_available (p_buf)
+                               : BENCH_BUFFER_OMX_BUFFER_SIZE;
+          memcpy (omx_buffer, tiz_buffer_get (p_buf), nbytes);
+          (void) tiz_buffer_advance (p_buf, nbytes);
+        }
+    }
+
+  elapsed = now_secs () - start;
+
+  tiz_buffer_destroy (p_buf);
+
+  printf ("%-24s backlog=%-8ld bytes=%-11ld %8.3f s %10.1f MiB/s\n", ap_name,
+          a_backlog, pushed, elapsed, pushed / elapsed / (1024 * 1024));
+
+  return elapsed;
+}
+
+int
+main (int argc, char ** argv)
+{
+  long backlog_kib = argc > 1 ? atol (argv[1]) : 256;
+  long total_mib = argc > 2 ? atol (argv[2]) : 4096;
+
+  if (backlog_kib < 0 || total_mib < 1)
+    {
+      fprintf (stderr, "usage: %s [backlog in KiB] [MiB to transfer]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  tiz_log_init ();
+
+  (void) run ("non-seekable", TIZ_BUFFER_NON_SEEKABLE, backlog_kib * 1024,
+              total_mib * 1024 * 1024);
+  (void) run ("ring", TIZ_BUFFER_RING, backlog_kib * 1024,
+              total_mib * 1024 * 1024);
+
+  tiz_log_deinit ();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,204 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_pcm.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  PCM conversion micro-benchmark: per-sample vs block conversion
+ *
+ * Converts stereo frames the way the mp3 decoder (planar libmad fixed point to
+ * big-endian S16, one sample at a time) and the opus decoder (interleaved
+ * float to S16, one sample at a time) used to, and with the tizpcm block
+ * converter, with and without dithering. Set TIZONIA_PCM_SIMD=c (or sse2) to
+ * compare against the plain C (or SSE2) kernels.
+ *
+ * Usage: bench_pcm [frames per run]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <time.h>
+
+#include "../src/tizplatform.h"
+
+/* libmad's synthesis output: 1152 frames per mpeg-1 layer III frame */
+#define BENCH_PCM_BLOCK 1152
+#define BENCH_PCM_FRACBITS 28
+#define BENCH_PCM_ONE (1L << BENCH_PCM_FRACBITS)
+
+static int32_t g_fixed[2][BENCH_PCM_BLOCK];
+static float g_float[2 * BENCH_PCM_BLOCK];
+static uint8_t g_out[4 * BENCH_PCM_BLOCK];
+static volatile unsigned g_sink;
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* The conversion the mp3 decoder used to do */
+static signed short
+mad_fixed_to_sshort (int32_t fixed)
+{
+  if (fixed >= BENCH_PCM_ONE)
+    {
+      return (SHRT_MAX);
+    }
+  if (fixed <= -BENCH_PCM_ONE)
+    {
+      return (-SHRT_MAX);
+    }
+  fixed = fixed >> (BENCH_PCM_FRACBITS - 15);
+  return (signed short) fixed;
+}
+
+static void
+per_sample_fixed (void)
+{
+  unsigned char * p_output = g_out;
+  int i;
+  for (i = 0; i < BENCH_PCM_BLOCK; i++)
+    {
+      signed short sample = mad_fixed_to_sshort (g_fixed[0][i]);
+      *(p_output++) = sample >> 8;
+      *(p_output++) = sample & 0xff;
+      sample = mad_fixed_to_sshort (g_fixed[1][i]);
+      *(p_output++) = sample >> 8;
+      *(p_output++) = sample & 0xff;
+    }
+}
+
+/* The conversion the opus decoder used to do */
+static void
+per_sample_float (void)
+{
+  short * out = (short *) g_out;
+  int i;
+  for (i = 0; i < 2 * BENCH_PCM_BLOCK; ++i)
+    {
+      out[i] = (short) lrintf (
+        fmaxf (-32768, fminf (g_float[i] * 32768.f, 32767)));
+    }
+}
+
+static tiz_pcm_conv_t * gp_conv;
+
+static void
+block_fixed (void)
+{
+  const void * planes[2] = {g_fixed[0], g_fixed[1]};
+  tiz_pcm_conv_planar (gp_conv, planes, BENCH_PCM_BLOCK, g_out);
+}
+
+static void
+block_float (void)
+{
+  tiz_pcm_conv_interleaved (gp_conv, g_float, BENCH_PCM_BLOCK, g_out);
+}
+
+static void
+run (const char * ap_name, void (*apf_conv) (void), long a_frames)
+{
+  const long blocks = a_frames / BENCH_PCM_BLOCK + 1;
+  double start, elapsed;
+  long i;
+
+  apf_conv (); /* warm up */
+  start = now_secs ();
+  for (i = 0; i < blocks; ++i)
+    {
+      apf_conv ();
+      g_sink += g_out[i % sizeof (g_out)];
+    }
+  elapsed = now_secs () - start;
+
+  printf ("%-34s %7.2f ns/frame  %8.1f Mframes/s\n", ap_name,
+          elapsed * 1e9 / (blocks * BENCH_PCM_BLOCK),
+          blocks * BENCH_PCM_BLOCK / elapsed / 1e6);
+}
+
+static void
+run_block (const char * ap_name, const tiz_pcm_in_fmt_t a_in_fmt,
+           const OMX_ENDIANTYPE a_endian, const tiz_pcm_dither_t a_dither,
+           long a_frames)
+{
+  if (OMX_ErrorNone
+      != tiz_pcm_conv_init (&gp_conv, a_in_fmt, BENCH_PCM_FRACBITS,
+                            ETIZPcmOutS16, a_endian, 2, a_dither))
+    {
+      fprintf (stderr, "could not create the converter\n");
+      exit (EXIT_FAILURE);
+    }
+  run (ap_name, ETIZPcmInFixed32 == a_in_fmt ? block_fixed : block_float,
+       a_frames);
+  tiz_pcm_conv_destroy (gp_conv);
+  gp_conv = NULL;
+}
+
+int
+main (int argc, char ** argv)
+{
+  long nframes = argc > 1 ? atol (argv[1]) : 20000000;
+  int i;
+
+  if (nframes < 1)
+    {
+      fprintf (stderr, "usage: %s [frames per run]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < BENCH_PCM_BLOCK; ++i)
+    {
+      const double phase = 2. * M_PI * 441. * i / 44100.;
+      g_fixed[0][i] = (int32_t) (0.9 * sin (phase) * BENCH_PCM_ONE);
+      g_fixed[1][i] = (int32_t) (1.1 * cos (phase) * BENCH_PCM_ONE);
+      g_float[2 * i] = (float) (0.9 * sin (phase));
+      g_float[2 * i + 1] = (float) (1.1 * cos (phase));
+    }
+
+  tiz_log_init ();
+
+  printf ("pcm kernels: %s\n", tiz_pcm_simd_name ());
+
+  run ("mp3: per-sample fixed -> s16be", per_sample_fixed, nframes);
+  run_block ("mp3: block fixed -> s16be", ETIZPcmInFixed32, OMX_EndianBig,
+             ETIZPcmDitherNone, nframes);
+  run_block ("mp3: block fixed -> s16be tpdf", ETIZPcmInFixed32,
+             OMX_EndianBig, ETIZPcmDitherTpdf, nframes);
+  run_block ("mp3: block fixed -> s16be shaped", ETIZPcmInFixed32,
+             OMX_EndianBig, ETIZPcmDitherShaped, nframes);
+
+  run ("opus: per-sample float -> s16", per_sample_float, nframes);
+  run_block ("opus: block float -> s16", ETIZPcmInFloat32, OMX_EndianLittle,
+             ETIZPcmDitherNone, nframes);
+  run_block ("opus: block float -> s16 tpdf", ETIZPcmInFloat32,
+             OMX_EndianLittle, ETIZPcmDitherTpdf, nframes);
+
+  tiz_log_deinit ();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_pqueue.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Priority queue micro-benchmark
+ *
+ * Usage: bench_pqueue [pending items] [rounds]
+ *
+ * Simulates the event loop's message churn: a number of items is kept
+ * pending in the queue, spread over the priority groups, while items are
+ * sent, received and cancelled (by handle, or by a search like the one the
+ * event loop does when a watcher is stopped).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/tizplatform.h"
+
+#define BENCH_PQUEUE_MAX_PRIO 5 /* Same as the servants' queue */
+
+typedef struct bench_item bench_item_t;
+struct bench_item
+{
+  int id;
+  tiz_pqueue_handle_t hdl;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static OMX_S32
+bench_cmp (void * ap_left, void * ap_right)
+{
+  return ap_left == ap_right ? 0 : 1;
+}
+
+static OMX_BOOL
+bench_match (void * ap_elem, OMX_S32 a_data1, void * ap_data2)
+{
+  return (ap_elem == ap_data2) ? OMX_TRUE : OMX_FALSE;
+}
+
+static void
+report (const char * ap_name, long a_ops, double a_elapsed)
+{
+  printf ("%-24s ops=%-9ld %8.3f s %12.0f ops/s\n", ap_name, a_ops,
+          a_elapsed, a_ops / a_elapsed);
+}
+
+static tiz_pqueue_t *
+fill (tiz_soa_t * ap_soa, bench_item_t * ap_items, int a_npending)
+{
+  tiz_pqueue_t * p_pq = NULL;
+  int i;
+
+  if (OMX_ErrorNone != tiz_pqueue_init (&p_pq, BENCH_PQUEUE_MAX_PRIO,
+                                        bench_cmp, ap_soa, "bench"))
+    {
+      fprintf (stderr, "could not create the queue\n");
+      exit (EXIT_FAILURE);
+    }
+
+  for (i = 0; i < a_npending; i++)
+    {
+      ap_items[i].id = i;
+      (void) tiz_pqueue_send_with_handle (p_pq, &ap_items[i],
+                                          i % (BENCH_PQUEUE_MAX_PRIO + 1),
+                                          &ap_items[i].hdl);
+    }
+  return p_pq;
+}
+
+static void
+drain (tiz_pqueue_t * ap_pq)
+{
+  OMX_PTR p_data = NULL;
+  while (OMX_ErrorNone == tiz_pqueue_receive (ap_pq, &p_data))
+    {
+    }
+  tiz_pqueue_destroy (ap_pq);
+}
+
+/* Receive one, send one */
+static void
+bench_send_receive (tiz_soa_t * ap_soa, bench_item_t * ap_items,
+                    int a_npending, long a_rounds)
+{
+  tiz_pqueue_t * p_pq = fill (ap_soa, ap_items, a_npending);
+  OMX_PTR p_data = NULL;
+  double start;
+  long i;
+
+  start = now_secs ();
+  for (i = 0; i < a_rounds; i++)
+    {
+      (void) tiz_pqueue_receive (p_pq, &p_data);
+      (void) tiz_pqueue_send (p_pq, p_data,
+                              (int) (i % (BENCH_PQUEUE_MAX_PRIO + 1)));
+    }
+  report ("send+receive", a_rounds, now_secs () - start);
+  drain (p_pq);
+}
+
+/* Cancel a pending item and send it again, using its handle */
+static void
+bench_remove_handle (tiz_soa_t * ap_soa, bench_item_t * ap_items,
+                     int a_npending, long a_rounds)
+{
+  tiz_pqueue_t * p_pq = fill (ap_soa, ap_items, a_npending);
+  double start;
+  long i;
+
+  start = now_secs ();
+  for (i = 0; i < a_rounds; i++)
+    {
+      bench_item_t * p_item = &ap_items[rand () % a_npending];
+      (void) tiz_pqueue_remove_handle (p_pq, p_item->hdl, NULL);
+      (void) tiz_pqueue_send_with_handle (
+        p_pq, p_item, p_item->id % (BENCH_PQUEUE_MAX_PRIO + 1), &p_item->hdl);
+    }
+  report ("remove_handle+send", a_rounds, now_secs () - start);
+  drain (p_pq);
+}
+
+/* Same, but finding the item by searching the queue */
+static void
+bench_remove_func (tiz_soa_t * ap_soa, bench_item_t * ap_items,
+                   int a_npending, long a_rounds)
+{
+  tiz_pqueue_t * p_pq = fill (ap_soa, ap_items, a_npending);
+  double start;
+  long i;
+
+  start = now_secs ();
+  for (i = 0; i < a_rounds; i++)
+    {
+      bench_item_t * p_item = &ap_items[rand () % a_npending];
+      (void) tiz_pqueue_remove_func (p_pq, bench_match, 0, p_item);
+      (void) tiz_pqueue_send_with_handle (
+        p_pq, p_item, p_item->id % (BENCH_PQUEUE_MAX_PRIO + 1), &p_item->hdl);
+    }
+  report ("remove_func+send", a_rounds, now_secs () - start);
+  drain (p_pq);
+}
+
+int
+main (int argc, char ** argv)
+{
+  int npending = argc > 1 ? atoi (argv[1]) : 1000;
+  long nrounds = argc > 2 ? atol (argv[2]) : 1000000;
+  bench_item_t * p_items = NULL;
+  tiz_soa_t * p_soa = NULL;
+
+  if (npending < 1 || nrounds < 1)
+    {
+      fprintf (stderr, "usage: %s [pending items] [rounds]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  tiz_log_init ();
+
+  if (NULL == (p_items = calloc (npending, sizeof (bench_item_t)))
+      || OMX_ErrorNone != tiz_soa_init (&p_soa))
+    {
+      fprintf (stderr, "out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+  printf ("pending items=%d\n", npending);
+  bench_send_receive (p_soa, p_items, npending, nrounds);
+  bench_remove_handle (p_soa, p_items, npending, nrounds);
+  /* The search is O(n), so do fewer rounds of it */
+  bench_remove_func (p_soa, p_items, npending, nrounds / 100 + 1);
+
+  tiz_soa_destroy (p_soa);
+  free (p_items);
+  tiz_log_deinit ();
+
+  return EXIT_SUCCESS;
+}
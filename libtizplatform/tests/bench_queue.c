@@ -0,0 +1,142 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_queue.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Message queue micro-benchmark: locked vs lock-free implementations
+ *
+ * Usage: bench_queue [producers] [messages per producer]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "../src/tizplatform.h"
+
+#define BENCH_QUEUE_CAPACITY 30 /* Same as the scheduler's mailbox */
+
+typedef struct bench_producer bench_producer_t;
+struct bench_producer
+{
+  tiz_queue_t * p_queue;
+  long nmsgs;
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *
+producer_func (void * ap_arg)
+{
+  bench_producer_t * p_prod = ap_arg;
+  /* Any non-NULL pointer will do */
+  OMX_PTR p_msg = p_prod;
+  long i;
+
+  for (i = 0; i < p_prod->nmsgs; i++)
+    {
+      (void) tiz_queue_send (p_prod->p_queue, p_msg);
+    }
+
+  return NULL;
+}
+
+static double
+run (const char * ap_name, OMX_U32 a_flags, int a_nproducers, long a_nmsgs)
+{
+  tiz_queue_t * p_queue = NULL;
+  tiz_thread_t threads[64];
+  bench_producer_t prods[64];
+  OMX_PTR p_data = NULL;
+  double start, elapsed;
+  long total = a_nmsgs * a_nproducers;
+  long i;
+  int p;
+
+  if (OMX_ErrorNone
+      != tiz_queue_init_with_flags (&p_queue, BENCH_QUEUE_CAPACITY, a_flags))
+    {
+      fprintf (stderr, "%s: could not create the queue\n", ap_name);
+      exit (EXIT_FAILURE);
+    }
+
+  start = now_secs ();
+
+  for (p = 0; p < a_nproducers; p++)
+    {
+      prods[p].p_queue = p_queue;
+      prods[p].nmsgs = a_nmsgs;
+      (void) tiz_thread_create (&threads[p], 0, 0, producer_func, &prods[p]);
+    }
+
+  for (i = 0; i < total; i++)
+    {
+      (void) tiz_queue_receive (p_queue, &p_data);
+    }
+
+  elapsed = now_secs () - start;
+
+  for (p = 0; p < a_nproducers; p++)
+    {
+      OMX_PTR p_result = NULL;
+      (void) tiz_thread_join (&threads[p], &p_result);
+    }
+
+  tiz_queue_destroy (p_queue);
+
+  printf ("%-24s producers=%-2d msgs=%-9ld %8.3f s %12.0f msgs/s\n", ap_name,
+          a_nproducers, total, elapsed, total / elapsed);
+
+  return elapsed;
+}
+
+int
+main (int argc, char ** argv)
+{
+  int nproducers = argc > 1 ? atoi (argv[1]) : 4;
+  long nmsgs = argc > 2 ? atol (argv[2]) : 1000000;
+
+  if (nproducers < 1 || nproducers > 64 || nmsgs < 1)
+    {
+      fprintf (stderr, "usage: %s [producers (1-64)] [messages per producer]\n",
+               argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  tiz_log_init ();
+
+  (void) run ("locked", TIZ_QUEUE_FLAG_LOCKED, 1, nmsgs);
+  (void) run ("lock-free spsc", TIZ_QUEUE_FLAG_LOCK_FREE_SPSC, 1, nmsgs);
+  (void) run ("lock-free mpsc", TIZ_QUEUE_FLAG_LOCK_FREE_MPSC, 1, nmsgs);
+  (void) run ("locked", TIZ_QUEUE_FLAG_LOCKED, nproducers, nmsgs);
+  (void) run ("lock-free mpsc", TIZ_QUEUE_FLAG_LOCK_FREE_MPSC, nproducers,
+              nmsgs);
+
+  tiz_log_deinit ();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   bench_rc.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Config file micro-benchmark: indexed lookups vs a list walk
+ *
+ * Generates config files of increasing size (keys spread over a few sections,
+ * like the [plugins] section grows with the number of components), and
+ * measures the cost of loading them and of looking up existing and missing
+ * keys. The list walk is the lookup the config store used to do.
+ *
+ * Usage: bench_rc [lookups per size]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <limits.h>
+
+#include "../src/tizplatform.h"
+#include "../src/tizplatform_internal.h"
+
+#define BENCH_RC_SECTIONS 4
+#define BENCH_RC_SAMPLES 1024
+
+typedef struct bench_key bench_key_t;
+struct bench_key
+{
+  char section[32];
+  char key[128];
+};
+
+static double
+now_secs (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+key_name (char * ap_buf, size_t a_len, long a_idx)
+{
+  snprintf (ap_buf, a_len, "OMX.Aratelia.bench_component.%ld.some_setting",
+            a_idx);
+}
+
+static void
+write_conf (const char * ap_path, long a_nkeys)
+{
+  FILE * p_file = fopen (ap_path, "w");
+  char key[128];
+  long i;
+  int s;
+
+  if (!p_file)
+    {
+      perror ("fopen");
+      exit (EXIT_FAILURE);
+    }
+
+  for (s = 0; s < BENCH_RC_SECTIONS; ++s)
+    {
+      fprintf (p_file, "[section%d]\n# Some comment\n", s);
+      for (i = s; i < a_nkeys; i += BENCH_RC_SECTIONS)
+        {
+          key_name (key, sizeof (key), i);
+          fprintf (p_file, "%s = value%ld\n", key, i);
+        }
+    }
+  fclose (p_file);
+}
+
+/* What the config store did before it was indexed */
+static const char *
+list_walk (const tiz_rcfile_t * ap_rc, const char * ap_key)
+{
+  const keyval_t * p_kv = ap_rc->p_snapshot->p_keyvals;
+  for (; p_kv && p_kv->p_key; p_kv = p_kv->p_next)
+    {
+      if (0 == strncmp (p_kv->p_key, ap_key, PATH_MAX))
+        {
+          return p_kv->p_value_list->p_value;
+        }
+    }
+  return NULL;
+}
+
+static void
+run (const char * ap_path, long a_nkeys, long a_nlookups)
+{
+  static bench_key_t samples[BENCH_RC_SAMPLES];
+  tiz_rcfile_t * p_rc = NULL;
+  char missing[128];
+  double start, load, indexed, indexed_miss, walk;
+  long found = 0;
+  long i;
+
+  write_conf (ap_path, a_nkeys);
+
+  /* The names are formatted beforehand, so that only the lookups are timed */
+  for (i = 0; i < BENCH_RC_SAMPLES; ++i)
+    {
+      const long idx = (i * 7919) % a_nkeys;
+      snprintf (samples[i].section, sizeof (samples[i].section), "section%ld",
+                idx % BENCH_RC_SECTIONS);
+      key_name (samples[i].key, sizeof (samples[i].key), idx);
+    }
+  key_name (missing, sizeof (missing), -1);
+
+  start = now_secs ();
+  if (OMX_ErrorNone != tiz_rcfile_init (&p_rc))
+    {
+      fprintf (stderr, "could not load %s\n", ap_path);
+      exit (EXIT_FAILURE);
+    }
+  load = now_secs () - start;
+
+  start = now_secs ();
+  for (i = 0; i < a_nlookups; ++i)
+    {
+      const bench_key_t * p_sample = &samples[i % BENCH_RC_SAMPLES];
+      found += (NULL
+                != tiz_rcfile_get_value_internal (p_rc, p_sample->section,
+                                                  p_sample->key));
+    }
+  indexed = now_secs () - start;
+
+  start = now_secs ();
+  for (i = 0; i < a_nlookups; ++i)
+    {
+      found += (NULL
+                != tiz_rcfile_get_value_internal (p_rc, "section0", missing));
+    }
+  indexed_miss = now_secs () - start;
+
+  start = now_secs ();
+  for (i = 0; i < a_nlookups; ++i)
+    {
+      found += (NULL != list_walk (p_rc, samples[i % BENCH_RC_SAMPLES].key));
+    }
+  walk = now_secs () - start;
+
+  tiz_rcfile_destroy (p_rc);
+
+  printf ("keys=%-7ld load %8.3f ms  hit %7.1f ns  miss %7.1f ns  "
+          "list walk %10.1f ns  (found %ld)\n",
+          a_nkeys, load * 1e3, indexed * 1e9 / a_nlookups,
+          indexed_miss * 1e9 / a_nlookups, walk * 1e9 / a_nlookups, found);
+}
+
+int
+main (int argc, char ** argv)
+{
+  static const long sizes[] = {16, 128, 1024, 8192, 65536};
+  long nlookups = argc > 1 ? atol (argv[1]) : 100000;
+  char dir[] = "/tmp/bench_rc_XXXXXX";
+  char path[PATH_MAX];
+  size_t i;
+
+  if (nlookups < 1 || !mkdtemp (dir))
+    {
+      fprintf (stderr, "usage: %s [lookups per size]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  snprintf (path, sizeof (path), "%s/tizonia.conf", dir);
+  setenv ("TIZONIA_RC_FILE", path, 1);
+
+  tiz_log_init ();
+
+  for (i = 0; i < sizeof (sizes) / sizeof (sizes[0]); ++i)
+    {
+      /* The list walk is linear in the number of keys; keep its runs short */
+      run (path, sizes[i], sizes[i] > 8192 ? nlookups / 10 : nlookups);
+    }
+
+  tiz_log_deinit ();
+
+  unlink (path);
+  rmdir (dir);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_buffer.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Dynamic buffer API unit tests
+ *
+ *
+ */
+
+#include <sys/uio.h>
+
+#define BUFFER_TEST_INITIAL_SIZE 100
+#define BUFFER_TEST_CHUNK_SIZE 777
+#define BUFFER_TEST_ITERATIONS 1000
+
+/* Pushes and consumes a stream of bytes (i mod 251), with a backlog that
+   makes the data wrap around the store many times */
+static void
+buffer_test_stream (tiz_buffer_t * ap_buf)
+{
+  unsigned char chunk[BUFFER_TEST_CHUNK_SIZE];
+  unsigned long pushed = 0;
+  unsigned long consumed = 0;
+  int i = 0;
+  int j = 0;
+
+  for (i = 0; i < BUFFER_TEST_ITERATIONS; ++i)
+    {
+      for (j = 0; j < BUFFER_TEST_CHUNK_SIZE; ++j)
+        {
+          chunk[j] = (pushed + j) % 251;
+        }
+      fail_if (BUFFER_TEST_CHUNK_SIZE
+               != tiz_buffer_push (ap_buf, chunk, BUFFER_TEST_CHUNK_SIZE));
+      pushed += BUFFER_TEST_CHUNK_SIZE;
+
+      while (tiz_buffer_available (ap_buf) > 3 * BUFFER_TEST_CHUNK_SIZE)
+        {
+          const unsigned char * p_data = tiz_buffer_get (ap_buf);
+          const int nbytes = BUFFER_TEST_CHUNK_SIZE / 2 + i % 100;
+          for (j = 0; j < nbytes; ++j)
+            {
+              fail_if (p_data[j] != (consumed + j) % 251);
+            }
+          fail_if (nbytes != tiz_buffer_advance (ap_buf, nbytes));
+          consumed += nbytes;
+        }
+    }
+  fail_if ((long) (pushed - consumed) != tiz_buffer_available (ap_buf));
+}
+
+START_TEST (test_buffer_non_seekable)
+{
+  tiz_buffer_t * p_buf = NULL;
+
+  fail_if (OMX_ErrorNone
+           != tiz_buffer_init (&p_buf, BUFFER_TEST_INITIAL_SIZE));
+  buffer_test_stream (p_buf);
+  tiz_buffer_clear (p_buf);
+  fail_if (0 != tiz_buffer_available (p_buf));
+  tiz_buffer_destroy (p_buf);
+}
+END_TEST
+
+START_TEST (test_buffer_ring)
+{
+  tiz_buffer_t * p_buf = NULL;
+  char data[] = "0123456789";
+  struct iovec iov[2];
+  int old_mode = 0;
+
+  fail_if (OMX_ErrorNone
+           != tiz_buffer_init (&p_buf, BUFFER_TEST_INITIAL_SIZE));
+  fail_if (10 != tiz_buffer_push (p_buf, data, 10));
+  fail_if (3 != tiz_buffer_advance (p_buf, 3));
+
+  /* The unread data survives the change of mode */
+  old_mode = tiz_buffer_seek_mode (p_buf, TIZ_BUFFER_RING);
+  fail_if (TIZ_BUFFER_NON_SEEKABLE != old_mode);
+  fail_if (7 != tiz_buffer_available (p_buf));
+  fail_if (0 != tiz_buffer_offset (p_buf));
+  fail_if (0 != memcmp (tiz_buffer_get (p_buf), "3456789", 7));
+
+  /* Only forward relative seeks are supported */
+  fail_if (-1 != tiz_buffer_seek (p_buf, 0, TIZ_BUFFER_SEEK_SET));
+  fail_if (-1 != tiz_buffer_seek (p_buf, -1, TIZ_BUFFER_SEEK_CUR));
+  fail_if (0 != tiz_buffer_seek (p_buf, 2, TIZ_BUFFER_SEEK_CUR));
+  fail_if (5 != tiz_buffer_available (p_buf));
+  tiz_buffer_clear (p_buf);
+
+  buffer_test_stream (p_buf);
+
+  /* The data is contiguous, even when it wraps around the ring */
+  fail_if (1 != tiz_buffer_get_iov (p_buf, iov, 2));
+  fail_if (iov[0].iov_base != tiz_buffer_get (p_buf));
+  fail_if ((int) iov[0].iov_len != tiz_buffer_available (p_buf));
+
+  /* Back to the default mode, with the unread data at the front */
+  {
+    const int avail = tiz_buffer_available (p_buf);
+    const unsigned char first = *(unsigned char *) tiz_buffer_get (p_buf);
+    fail_if (TIZ_BUFFER_RING
+             != tiz_buffer_seek_mode (p_buf, TIZ_BUFFER_NON_SEEKABLE));
+    fail_if (avail != tiz_buffer_available (p_buf));
+    fail_if (0 != tiz_buffer_offset (p_buf));
+    fail_if (first != *(unsigned char *) tiz_buffer_get (p_buf));
+  }
+
+  tiz_buffer_destroy (p_buf);
+}
+END_TEST
+
+START_TEST (test_buffer_iov)
+{
+  tiz_buffer_t * p_buf = NULL;
+  char a[] = "abc";
+  char b[] = "defgh";
+  struct iovec in[3];
+  struct iovec out[1];
+  int mode = 0;
+
+  in[0].iov_base = a;
+  in[0].iov_len = 3;
+  in[1].iov_base = NULL;
+  in[1].iov_len = 0;
+  in[2].iov_base = b;
+  in[2].iov_len = 5;
+
+  for (mode = TIZ_BUFFER_NON_SEEKABLE; mode <= TIZ_BUFFER_RING; ++mode)
+    {
+      fail_if (OMX_ErrorNone != tiz_buffer_init (&p_buf, 4));
+      fail_if (-1 == tiz_buffer_seek_mode (p_buf, mode));
+      fail_if (0 != tiz_buffer_get_iov (p_buf, out, 1));
+      fail_if (8 != tiz_buffer_push_iov (p_buf, in, 3));
+      fail_if (8 != tiz_buffer_push_iov (p_buf, in, 3));
+      fail_if (16 != tiz_buffer_available (p_buf));
+      fail_if (1 != tiz_buffer_get_iov (p_buf, out, 1));
+      fail_if (16 != out[0].iov_len);
+      fail_if (0 != memcmp (out[0].iov_base, "abcdefghabcdefgh", 16));
+      fail_if (5 != tiz_buffer_advance (p_buf, 5));
+      fail_if (1 != tiz_buffer_get_iov (p_buf, out, 1));
+      fail_if (11 != out[0].iov_len);
+      fail_if (0 != memcmp (out[0].iov_base, "fghabcdefgh", 11));
+      tiz_buffer_destroy (p_buf);
+      p_buf = NULL;
+    }
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
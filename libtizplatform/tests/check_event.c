@@ -341,6 +341,79 @@ START_TEST (test_event_stat)
 }
 END_TEST
 
+#define CHECK_SHARDED_TIMERS 16
+
+static int g_sharded_timer_fired = 0;
+static OMX_S32 g_sharded_timer_tids[CHECK_SHARDED_TIMERS];
+
+static void
+check_event_sharded_timer_cback (OMX_HANDLETYPE p_hdl,
+                                 tiz_event_timer_t * ap_ev_timer,
+                                 void *ap_arg, const uint32_t a_id)
+{
+  int *p_index = ap_arg;
+  fail_if (NULL == ap_ev_timer);
+  fail_if (NULL == p_index);
+  g_sharded_timer_tids[*p_index] = tiz_thread_id ();
+  (void) __sync_add_and_fetch (&g_sharded_timer_fired, 1);
+}
+
+START_TEST (test_event_timer_sharded_loops)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_event_timer_t * p_ev_timers[CHECK_SHARDED_TIMERS];
+  /* Each timer gets its own "component handle", so that they are spread over
+     the event loop threads configured in the test rc file */
+  int hdls[CHECK_SHARDED_TIMERS];
+  int sleep_count = 5;
+  int i, j;
+  bool many_threads = false;
+
+  error = tiz_event_loop_init ();
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < CHECK_SHARDED_TIMERS; i++)
+    {
+      hdls[i] = i;
+      error = tiz_event_timer_init (&p_ev_timers[i], &hdls[i],
+                                    check_event_sharded_timer_cback, &hdls[i]);
+      fail_if (error != OMX_ErrorNone);
+      tiz_event_timer_set (p_ev_timers[i], 0.1, 0.);
+      error = tiz_event_timer_start (p_ev_timers[i], i + 1);
+      fail_if (error != OMX_ErrorNone);
+    }
+
+  while (--sleep_count > 0
+         && __sync_add_and_fetch (&g_sharded_timer_fired, 0)
+              < CHECK_SHARDED_TIMERS)
+    {
+      sleep (1);
+    }
+
+  fail_if (CHECK_SHARDED_TIMERS != g_sharded_timer_fired);
+
+  for (i = 0; i < CHECK_SHARDED_TIMERS && !many_threads; i++)
+    {
+      for (j = i + 1; j < CHECK_SHARDED_TIMERS; j++)
+        {
+          if (g_sharded_timer_tids[i] != g_sharded_timer_tids[j])
+            {
+              many_threads = true;
+              break;
+            }
+        }
+    }
+  fail_if (!many_threads);
+
+  for (i = 0; i < CHECK_SHARDED_TIMERS; i++)
+    {
+      tiz_event_timer_destroy (p_ev_timers[i]);
+    }
+
+  tiz_event_loop_destroy ();
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
@@ -0,0 +1,89 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_log.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Logging API unit tests
+ *
+ *
+ */
+
+#define LOG_TEST_THREADS 4
+#define LOG_TEST_RECORDS 20000
+
+static void *
+log_test_thread_func (void *ap_arg)
+{
+  int i = 0;
+  for (i = 0; i < LOG_TEST_RECORDS; i++)
+    {
+      TIZ_LOG (TIZ_PRIORITY_TRACE, "thread [%ld] record [%d] - %s",
+               (long) ap_arg, i, "some payload to fill the ring");
+    }
+  return NULL;
+}
+
+START_TEST (test_log_async_multiple_threads)
+{
+  tiz_thread_t threads[LOG_TEST_THREADS];
+  OMX_PTR p_result = NULL;
+  unsigned long dropped = 0;
+  long i = 0;
+
+  /* Restart the logging subsystem with small rings, so that some records are
+     likely to be dropped */
+  tiz_log_deinit ();
+  fail_if (0 != setenv ("TIZONIA_LOG_ASYNC", "16", 1));
+  tiz_log_init ();
+
+  for (i = 0; i < LOG_TEST_THREADS; i++)
+    {
+      fail_if (OMX_ErrorNone
+               != tiz_thread_create (&threads[i], 0, 0, log_test_thread_func,
+                                     (void *) i));
+    }
+  for (i = 0; i < LOG_TEST_THREADS; i++)
+    {
+      tiz_thread_join (&threads[i], &p_result);
+    }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_log_async_multiple_threads - flush");
+  tiz_log_flush ();
+
+  /* The rings of the threads that exited are gone, but not their drops */
+  dropped = tiz_log_dropped ();
+  fail_if (dropped > LOG_TEST_THREADS * LOG_TEST_RECORDS);
+  fail_if (tiz_log_dropped () < dropped);
+
+  tiz_log_deinit ();
+  fail_if (0 != unsetenv ("TIZONIA_LOG_ASYNC"));
+  tiz_log_init ();
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_log_async_multiple_threads - end");
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
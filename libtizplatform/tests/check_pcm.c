@@ -0,0 +1,296 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_pcm.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  PCM conversion API unit tests
+ *
+ *
+ */
+
+#include <endian.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* Not a multiple of any vector width nor of the conversion chunk */
+#define PCM_TEST_FRAMES 1203
+#define PCM_TEST_FRACBITS 28
+
+static int32_t
+pcm_test_ref_fixed_to_s16 (int32_t a_fixed)
+{
+  const int32_t v = ((a_fixed >> (PCM_TEST_FRACBITS - 16)) + 1) >> 1;
+  return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+static int32_t
+pcm_test_ref_float_to_s16 (float a_val)
+{
+  float v = a_val * 32768.f;
+  v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+  return (int32_t) (v >= 0.f ? v + 0.5f : v - 0.5f);
+}
+
+static int32_t
+pcm_test_fixed_sample (int a_idx)
+{
+  /* Spans a little more than [-2.0, 2.0), to exercise the clipping */
+  return (int32_t) ((((a_idx * 7919) % 4093) - 2046) * (1 << 18)) + a_idx;
+}
+
+START_TEST (test_pcm_fixed_to_s16)
+{
+  static int32_t left[PCM_TEST_FRAMES];
+  static int32_t right[PCM_TEST_FRAMES];
+  static uint8_t out[PCM_TEST_FRAMES * 4];
+  const void * planes[2] = {left, right};
+  tiz_pcm_conv_t * p_conv = NULL;
+  int i = 0;
+
+  for (i = 0; i < PCM_TEST_FRAMES; i++)
+    {
+      left[i] = pcm_test_fixed_sample (i);
+      right[i] = -pcm_test_fixed_sample (i + 1);
+    }
+  left[0] = 1 << PCM_TEST_FRACBITS;
+  right[0] = -(1 << PCM_TEST_FRACBITS);
+  left[1] = 1 << (PCM_TEST_FRACBITS - 1);
+
+  fail_if (OMX_ErrorNone
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFixed32, PCM_TEST_FRACBITS,
+                                 ETIZPcmOutS16, OMX_EndianBig, 2,
+                                 ETIZPcmDitherNone));
+  fail_if (4 != tiz_pcm_conv_frame_size (p_conv));
+
+  tiz_pcm_conv_planar (p_conv, planes, PCM_TEST_FRAMES, out);
+
+  fail_if (0x7f != out[0] || 0xff != out[1]);
+  fail_if (0x80 != out[2] || 0x00 != out[3]);
+  fail_if (0x40 != out[4] || 0x00 != out[5]);
+
+  for (i = 0; i < PCM_TEST_FRAMES; i++)
+    {
+      const int16_t l = (int16_t) ((out[4 * i] << 8) | out[4 * i + 1]);
+      const int16_t r = (int16_t) ((out[4 * i + 2] << 8) | out[4 * i + 3]);
+      fail_if (l != pcm_test_ref_fixed_to_s16 (left[i]));
+      fail_if (r != pcm_test_ref_fixed_to_s16 (right[i]));
+    }
+
+  tiz_pcm_conv_destroy (p_conv);
+}
+END_TEST
+
+START_TEST (test_pcm_float_to_s16)
+{
+  static float in[PCM_TEST_FRAMES * 2];
+  static float left[PCM_TEST_FRAMES];
+  static float right[PCM_TEST_FRAMES];
+  static int16_t out[PCM_TEST_FRAMES * 2];
+  static int16_t out_planar[PCM_TEST_FRAMES * 2];
+  const void * planes[2] = {left, right};
+  tiz_pcm_conv_t * p_conv = NULL;
+  int i = 0;
+
+  for (i = 0; i < PCM_TEST_FRAMES * 2; i++)
+    {
+      /* Keep clear of the rounding ties, where the kernels may differ */
+      in[i] = ((((i * 7919) % 4093) - 2046) + 0.3f) / 1536.f;
+    }
+  in[0] = 1.f;
+  in[1] = -1.f;
+  for (i = 0; i < PCM_TEST_FRAMES; i++)
+    {
+      left[i] = in[2 * i];
+      right[i] = in[2 * i + 1];
+    }
+
+  fail_if (OMX_ErrorNone
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFloat32, 0, ETIZPcmOutS16,
+                                 OMX_EndianLittle, 2, ETIZPcmDitherNone));
+
+  tiz_pcm_conv_interleaved (p_conv, in, PCM_TEST_FRAMES, out);
+  tiz_pcm_conv_planar (p_conv, planes, PCM_TEST_FRAMES, out_planar);
+
+  fail_if (32767 != le16toh (out[0]));
+  fail_if (-32768 != (int16_t) le16toh (out[1]));
+  for (i = 0; i < PCM_TEST_FRAMES * 2; i++)
+    {
+      fail_if ((int16_t) le16toh (out[i]) != pcm_test_ref_float_to_s16 (in[i]));
+    }
+  fail_if (0 != memcmp (out, out_planar, sizeof (out)));
+
+  tiz_pcm_conv_destroy (p_conv);
+}
+END_TEST
+
+START_TEST (test_pcm_gain)
+{
+  static int16_t s16[PCM_TEST_FRAMES];
+  static int16_t s16_ref[PCM_TEST_FRAMES];
+  static float flt[PCM_TEST_FRAMES];
+  static float flt_ref[PCM_TEST_FRAMES];
+  const float gains[] = {0.f, 0.3333f, 1.f, 1.7511f};
+  size_t g = 0;
+  int i = 0;
+
+  for (g = 0; g < sizeof (gains) / sizeof (gains[0]); g++)
+    {
+      for (i = 0; i < PCM_TEST_FRAMES; i++)
+        {
+          float v = 0.f;
+          s16[i] = (int16_t) ((((i * 7919) % 4093) - 2046) * 16 + i % 16);
+          flt[i] = s16[i] / 32768.f;
+          v = s16[i] * gains[g];
+          v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+          /* Keep clear of the rounding ties, where the kernels may differ */
+          if (v - (int32_t) v == 0.5f || v - (int32_t) v == -0.5f)
+            {
+              s16[i] = 0;
+              v = 0.f;
+            }
+          s16_ref[i] = (int16_t) (v >= 0.f ? v + 0.5f : v - 0.5f);
+          flt_ref[i] = flt[i] * gains[g];
+        }
+
+      tiz_pcm_gain_s16 (s16, PCM_TEST_FRAMES, gains[g]);
+      tiz_pcm_gain_float (flt, PCM_TEST_FRAMES, gains[g]);
+
+      fail_if (0 != memcmp (s16, s16_ref, sizeof (s16)));
+      fail_if (0 != memcmp (flt, flt_ref, sizeof (flt)));
+    }
+}
+END_TEST
+
+START_TEST (test_pcm_dither)
+{
+  static float in[PCM_TEST_FRAMES * 2];
+  static int16_t out[PCM_TEST_FRAMES * 2];
+  tiz_pcm_dither_t dither = ETIZPcmDitherTpdf;
+
+  for (; dither <= ETIZPcmDitherShaped; ++dither)
+    {
+      tiz_pcm_conv_t * p_conv = NULL;
+      long sum = 0;
+      int nonzero = 0;
+      int i = 0;
+
+      fail_if (OMX_ErrorNone
+               != tiz_pcm_conv_init (&p_conv, ETIZPcmInFloat32, 0,
+                                     ETIZPcmOutS16, OMX_EndianLittle, 2,
+                                     dither));
+
+      /* Digital silence gets a little noise, centred on zero */
+      memset (in, 0, sizeof (in));
+      tiz_pcm_conv_interleaved (p_conv, in, PCM_TEST_FRAMES, out);
+      for (i = 0; i < PCM_TEST_FRAMES * 2; i++)
+        {
+          const int16_t v = (int16_t) le16toh (out[i]);
+          fail_if (v < -16 || v > 16);
+          nonzero += (0 != v);
+          sum += v;
+        }
+      fail_if (nonzero < PCM_TEST_FRAMES / 4);
+      fail_if (labs (sum) > PCM_TEST_FRAMES / 4);
+
+      /* Without noise shaping, the error is within one LSB */
+      for (i = 0; i < PCM_TEST_FRAMES * 2; i++)
+        {
+          in[i] = ((((i * 7919) % 4093) - 2046) + 0.3f) / 2048.f;
+        }
+      tiz_pcm_conv_interleaved (p_conv, in, PCM_TEST_FRAMES, out);
+      for (i = 0; ETIZPcmDitherTpdf == dither && i < PCM_TEST_FRAMES * 2; i++)
+        {
+          const float err = (int16_t) le16toh (out[i]) - in[i] * 32768.f;
+          fail_if (err < -1.5f || err > 1.5f);
+        }
+
+      tiz_pcm_conv_destroy (p_conv);
+    }
+}
+END_TEST
+
+START_TEST (test_pcm_formats)
+{
+  static const int32_t in[3] = {1 << (PCM_TEST_FRACBITS - 1), -1, 0x7fffffff};
+  uint8_t out[3 * 4];
+  float out_float[3];
+  tiz_pcm_conv_t * p_conv = NULL;
+
+  /* Three channels go through the generic interleaving */
+  fail_if (OMX_ErrorNone
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFixed32, PCM_TEST_FRACBITS,
+                                 ETIZPcmOutS24, OMX_EndianLittle, 3,
+                                 ETIZPcmDitherNone));
+  fail_if (9 != tiz_pcm_conv_frame_size (p_conv));
+  {
+    const void * planes[3] = {&in[0], &in[1], &in[2]};
+    tiz_pcm_conv_planar (p_conv, planes, 1, out);
+  }
+  fail_if (0x00 != out[0] || 0x00 != out[1] || 0x40 != out[2]);
+  fail_if (0x00 != out[3] || 0x00 != out[4] || 0x00 != out[5]);
+  fail_if (0xff != out[6] || 0xff != out[7] || 0x7f != out[8]);
+  tiz_pcm_conv_destroy (p_conv);
+
+  fail_if (OMX_ErrorNone
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFixed32, PCM_TEST_FRACBITS,
+                                 ETIZPcmOutS32, OMX_EndianBig, 3,
+                                 ETIZPcmDitherTpdf));
+  tiz_pcm_conv_interleaved (p_conv, in, 1, out);
+  fail_if (0x40 != out[0] || 0x00 != out[1] || 0x00 != out[3]);
+  fail_if (0xff != out[4] || 0xff != out[5] || 0xff != out[6]
+           || 0xf8 != out[7]);
+  fail_if (0x7f != out[8] || 0xff != out[9] || 0xff != out[11]);
+  tiz_pcm_conv_destroy (p_conv);
+
+  fail_if (OMX_ErrorNone
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFixed32, PCM_TEST_FRACBITS,
+                                 ETIZPcmOutFloat32, OMX_EndianLittle, 1,
+                                 ETIZPcmDitherShaped));
+  tiz_pcm_conv_interleaved (p_conv, in, 3, out_float);
+  fail_if (0.5f != out_float[0]);
+  fail_if (out_float[1] >= 0.f || out_float[1] < -1e-8f);
+  fail_if (out_float[2] < 7.99f || out_float[2] > 8.f);
+  tiz_pcm_conv_destroy (p_conv);
+
+  fail_if (OMX_ErrorBadParameter
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFixed32, 0, ETIZPcmOutS16,
+                                 OMX_EndianLittle, 2, ETIZPcmDitherNone));
+  fail_if (OMX_ErrorBadParameter
+           != tiz_pcm_conv_init (&p_conv, ETIZPcmInFloat32, 0, ETIZPcmOutS16,
+                                 OMX_EndianLittle, 0, ETIZPcmDitherNone));
+
+  fail_if (ETIZPcmDitherShaped
+           != tiz_pcm_dither_from_str ("shaped", ETIZPcmDitherNone));
+  fail_if (ETIZPcmDitherTpdf
+           != tiz_pcm_dither_from_str ("bogus", ETIZPcmDitherTpdf));
+  fail_if (ETIZPcmDitherNone
+           != tiz_pcm_dither_from_str (NULL, ETIZPcmDitherNone));
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "pcm kernels [%s]", tiz_pcm_simd_name ());
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
@@ -452,6 +452,121 @@ START_TEST (test_pqueue_removep)
 }
 END_TEST
 
+START_TEST (test_pqueue_remove_handle)
+{
+
+  OMX_S32 i;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_pqueue_t *p_queue = NULL;
+  tiz_pqueue_handle_t handles[9];
+  OMX_PTR p_received = NULL;
+  int items[9];
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_pqueue_remove_handle");
+
+  error = tiz_pqueue_init (&p_queue, 2, &pqueue_cmp, NULL, "tizkrn");
+
+  fail_if (error != OMX_ErrorNone);
+
+  /* Three items per priority group; item i goes to group i / 3 */
+  for (i = 8; i >= 0; i--)
+    {
+      items[i] = i;
+      error = tiz_pqueue_send_with_handle (p_queue, &items[i], i / 3,
+                                           &handles[i]);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (handles[i] == NULL);
+    }
+
+  /* Remove the first, middle and last items of different groups, and the
+     whole of group 1 */
+  error = tiz_pqueue_remove_handle (p_queue, handles[0], &p_received);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (p_received != &items[0]);
+  fail_if (OMX_ErrorNone
+           != tiz_pqueue_remove_handle (p_queue, handles[3], NULL));
+  fail_if (OMX_ErrorNone
+           != tiz_pqueue_remove_handle (p_queue, handles[4], NULL));
+  fail_if (OMX_ErrorNone
+           != tiz_pqueue_remove_handle (p_queue, handles[5], NULL));
+  fail_if (OMX_ErrorNone
+           != tiz_pqueue_remove_handle (p_queue, handles[8], NULL));
+  fail_if (tiz_pqueue_length (p_queue) != 4);
+
+  tiz_pqueue_dump (p_queue, &pqueue_dump_item);
+
+  error = tiz_pqueue_first (p_queue, &p_received);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (*(int *) p_received != 2);
+
+  {
+    const int expected[] = {2, 1, 7, 6};
+    for (i = 0; i < 4; i++)
+      {
+        error = tiz_pqueue_receive (p_queue, &p_received);
+        fail_if (error != OMX_ErrorNone);
+        TIZ_LOG (TIZ_PRIORITY_TRACE, "*p_received [%d]", *(int *) p_received);
+        fail_if (*(int *) p_received != expected[i]);
+      }
+  }
+
+  error = tiz_pqueue_receive (p_queue, &p_received);
+  fail_if (error != OMX_ErrorNoMore);
+
+  tiz_pqueue_destroy (p_queue);
+
+}
+END_TEST
+
+static OMX_BOOL
+pqueue_is_odd (void *ap_elem, OMX_S32 a_data1, void *ap_data2)
+{
+  return (*(int *) ap_elem % 2) == a_data1 ? OMX_TRUE : OMX_FALSE;
+}
+
+START_TEST (test_pqueue_many_groups)
+{
+
+  OMX_S32 i;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_pqueue_t *p_queue = NULL;
+  OMX_PTR p_received = NULL;
+  int items[200];
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "test_pqueue_many_groups");
+
+  /* More groups than bits in a bitmap word */
+  error = tiz_pqueue_init (&p_queue, 199, &pqueue_cmp, NULL, "tizkrn");
+
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 199; i >= 0; i--)
+    {
+      items[i] = i;
+      error = tiz_pqueue_send (p_queue, &items[i], i);
+      fail_if (error != OMX_ErrorNone);
+    }
+
+  fail_if (tiz_pqueue_dump (p_queue, &pqueue_dump_item) != 200);
+
+  /* Remove the odd ones */
+  fail_if (tiz_pqueue_remove_func (p_queue, pqueue_is_odd, 1, items) != 100);
+  fail_if (tiz_pqueue_length (p_queue) != 100);
+
+  for (i = 0; i < 100; i++)
+    {
+      error = tiz_pqueue_receive (p_queue, &p_received);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (*(int *) p_received != 2 * i);
+    }
+
+  fail_if (tiz_pqueue_length (p_queue) != 0);
+
+  tiz_pqueue_destroy (p_queue);
+
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
@@ -85,6 +85,155 @@ START_TEST (test_queue_send_and_receive)
 }
 END_TEST
 
+START_TEST (test_queue_lock_free_spsc_send_and_receive)
+{
+  OMX_U32 i;
+  OMX_PTR p_received = NULL;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  int items[10];
+  tiz_queue_t *p_queue = NULL;
+
+  /* The lock-free ring rounds the capacity up to a power of two */
+  error = tiz_queue_init_with_flags (&p_queue, 10,
+                                     TIZ_QUEUE_FLAG_LOCK_FREE_SPSC);
+  fail_if (error != OMX_ErrorNone);
+  fail_if (16 != tiz_queue_capacity (p_queue));
+
+  /* Go round the ring a few times */
+  for (i = 0; i < 100; i++)
+    {
+      items[i % 10] = i;
+      error = tiz_queue_send (p_queue, &items[i % 10]);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (1 != tiz_queue_length (p_queue));
+      error = tiz_queue_receive (p_queue, &p_received);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (*(int *) p_received != i);
+      fail_if (0 != tiz_queue_length (p_queue));
+    }
+
+  tiz_queue_destroy (p_queue);
+}
+END_TEST
+
+START_TEST (test_queue_try_receive)
+{
+  const OMX_U32 flags[] = {TIZ_QUEUE_FLAG_LOCKED, TIZ_QUEUE_FLAG_LOCK_FREE_SPSC};
+  OMX_PTR p_received = NULL;
+  int items[3] = {0, 1, 2};
+  tiz_queue_t *p_queue = NULL;
+  OMX_U32 f;
+  int i;
+
+  for (f = 0; f < sizeof (flags) / sizeof (flags[0]); f++)
+    {
+      fail_if (OMX_ErrorNone
+               != tiz_queue_init_with_flags (&p_queue, 4, flags[f]));
+      fail_if (OMX_ErrorNoMore != tiz_queue_try_receive (p_queue, &p_received));
+
+      for (i = 0; i < 3; i++)
+        {
+          fail_if (OMX_ErrorNone != tiz_queue_send (p_queue, &items[i]));
+        }
+      for (i = 0; i < 3; i++)
+        {
+          fail_if (OMX_ErrorNone
+                   != tiz_queue_try_receive (p_queue, &p_received));
+          fail_if (*(int *) p_received != i);
+        }
+      fail_if (OMX_ErrorNoMore != tiz_queue_try_receive (p_queue, &p_received));
+      fail_if (0 != tiz_queue_length (p_queue));
+
+      tiz_queue_destroy (p_queue);
+      p_queue = NULL;
+    }
+}
+END_TEST
+
+#define QUEUE_TEST_PRODUCERS 4
+#define QUEUE_TEST_ITEMS_PER_PRODUCER 10000
+
+typedef struct queue_test_producer queue_test_producer_t;
+struct queue_test_producer
+{
+  tiz_queue_t *p_queue;
+  int id;
+  int items[QUEUE_TEST_ITEMS_PER_PRODUCER];
+};
+
+static void *
+queue_test_producer_func (void *ap_arg)
+{
+  queue_test_producer_t *p_prod = ap_arg;
+  int i;
+
+  for (i = 0; i < QUEUE_TEST_ITEMS_PER_PRODUCER; i++)
+    {
+      p_prod->items[i] = p_prod->id * QUEUE_TEST_ITEMS_PER_PRODUCER + i;
+      fail_if (OMX_ErrorNone
+               != tiz_queue_send (p_prod->p_queue, &p_prod->items[i]));
+    }
+
+  return NULL;
+}
+
+START_TEST (test_queue_lock_free_mpsc_send_and_receive)
+{
+  OMX_PTR p_received = NULL;
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_queue_t *p_queue = NULL;
+  tiz_thread_t threads[QUEUE_TEST_PRODUCERS];
+  queue_test_producer_t *p_prods = NULL;
+  int last[QUEUE_TEST_PRODUCERS];
+  int i;
+
+  /* A small ring, so that producers get to park on a full queue */
+  error = tiz_queue_init_with_flags (&p_queue, 8,
+                                     TIZ_QUEUE_FLAG_LOCK_FREE_MPSC);
+  fail_if (error != OMX_ErrorNone);
+
+  p_prods = tiz_mem_calloc (QUEUE_TEST_PRODUCERS,
+                            sizeof (queue_test_producer_t));
+  fail_if (p_prods == NULL);
+
+  for (i = 0; i < QUEUE_TEST_PRODUCERS; i++)
+    {
+      last[i] = -1;
+      p_prods[i].p_queue = p_queue;
+      p_prods[i].id = i;
+      fail_if (OMX_ErrorNone
+               != tiz_thread_create (&threads[i], 0, 0,
+                                     queue_test_producer_func,
+                                     &p_prods[i]));
+    }
+
+  /* Items from any given producer must be received in order */
+  for (i = 0; i < QUEUE_TEST_PRODUCERS * QUEUE_TEST_ITEMS_PER_PRODUCER; i++)
+    {
+      int value, producer;
+      error = tiz_queue_receive (p_queue, &p_received);
+      fail_if (error != OMX_ErrorNone);
+      fail_if (p_received == NULL);
+      value = *(int *) p_received;
+      producer = value / QUEUE_TEST_ITEMS_PER_PRODUCER;
+      fail_if (producer < 0 || producer >= QUEUE_TEST_PRODUCERS);
+      fail_if (value % QUEUE_TEST_ITEMS_PER_PRODUCER != last[producer] + 1);
+      last[producer] = value % QUEUE_TEST_ITEMS_PER_PRODUCER;
+    }
+
+  for (i = 0; i < QUEUE_TEST_PRODUCERS; i++)
+    {
+      OMX_PTR p_result = NULL;
+      tiz_thread_join (&threads[i], &p_result);
+    }
+
+  fail_if (0 != tiz_queue_length (p_queue));
+
+  tiz_queue_destroy (p_queue);
+  tiz_mem_free (p_prods);
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
@@ -69,6 +69,159 @@ START_TEST (test_rcfile_get_value_list)
 }
 END_TEST
 
+static void
+write_rc_file (const char * ap_path, const char * ap_contents)
+{
+  char tmp_path[PATH_MAX];
+  FILE * p_file = NULL;
+
+  /* Replace the file the way editors do, with a rename */
+  snprintf (tmp_path, sizeof (tmp_path), "%s.tmp", ap_path);
+  fail_if (NULL == (p_file = fopen (tmp_path, "w")));
+  fail_if (EOF == fputs (ap_contents, p_file));
+  fail_if (0 != fclose (p_file));
+  fail_if (0 != rename (tmp_path, ap_path));
+}
+
+START_TEST (test_rcfile_sections)
+{
+  char dir[] = "/tmp/check_rc_XXXXXX";
+  char path[PATH_MAX];
+  tiz_rcfile_t * p_rc = NULL;
+  const char * val = NULL;
+
+  fail_if (NULL == mkdtemp (dir));
+  snprintf (path, sizeof (path), "%s/tizonia.conf", dir);
+  write_rc_file (path,
+                 "[first]\n"
+                 "key = one\n"
+                 "[second]\n"
+                 "key = two\n"
+                 "other = three\n");
+  fail_if (0 != setenv ("TIZONIA_RC_FILE", path, 1));
+
+  fail_if (OMX_ErrorNone != tiz_rcfile_init (&p_rc));
+
+  val = tiz_rcfile_get_value_internal (p_rc, "first", "key");
+  fail_if (NULL == val || 0 != strcmp (val, "one"));
+  val = tiz_rcfile_get_value_internal (p_rc, "second", "key");
+  fail_if (NULL == val || 0 != strcmp (val, "two"));
+
+  /* Unknown sections fall back to the last definition of the key */
+  val = tiz_rcfile_get_value_internal (p_rc, "unknown", "key");
+  fail_if (NULL == val || 0 != strcmp (val, "two"));
+  val = tiz_rcfile_get_value_internal (p_rc, "first", "other");
+  fail_if (NULL == val || 0 != strcmp (val, "three"));
+
+  val = tiz_rcfile_get_value_internal (p_rc, "first", "missing");
+  fail_if (NULL != val);
+
+  tiz_rcfile_destroy (p_rc);
+  unlink (path);
+  rmdir (dir);
+}
+END_TEST
+
+START_TEST (test_rcfile_reload)
+{
+  char dir[] = "/tmp/check_rc_XXXXXX";
+  char path[PATH_MAX];
+  tiz_rcfile_t * p_rc = NULL;
+  const char * val = NULL;
+  const char * old_val = NULL;
+  int i = 0;
+
+  fail_if (NULL == mkdtemp (dir));
+  snprintf (path, sizeof (path), "%s/tizonia.conf", dir);
+  write_rc_file (path, "[plugins]\nkey = before\n");
+  fail_if (0 != setenv ("TIZONIA_RC_FILE", path, 1));
+
+  fail_if (OMX_ErrorNone != tiz_rcfile_init (&p_rc));
+  fail_if (OMX_ErrorNone != tiz_rcfile_watch (p_rc));
+
+  old_val = tiz_rcfile_get_value_internal (p_rc, "plugins", "key");
+  fail_if (NULL == old_val || 0 != strcmp (old_val, "before"));
+
+  write_rc_file (path, "[plugins]\nkey = after\n");
+
+  /* Wait up to 5 seconds for the new snapshot */
+  for (i = 0; i < 500; ++i)
+    {
+      val = tiz_rcfile_get_value_internal (p_rc, "plugins", "key");
+      if (val && 0 == strcmp (val, "after"))
+        {
+          break;
+        }
+      usleep (10000);
+    }
+  fail_if (NULL == val || 0 != strcmp (val, "after"));
+
+  /* Strings handed out before the reload are still valid */
+  fail_if (0 != strcmp (old_val, "before"));
+
+  tiz_rcfile_destroy (p_rc);
+  unlink (path);
+  rmdir (dir);
+}
+END_TEST
+
+START_TEST (test_rcfile_reload_reclaims_snapshots)
+{
+  char dir[] = "/tmp/check_rc_XXXXXX";
+  char path[PATH_MAX];
+  char contents[64];
+  tiz_rcfile_t * p_rc = NULL;
+  const char * val = NULL;
+  int n = 0;
+  int i = 0;
+
+  fail_if (NULL == mkdtemp (dir));
+  snprintf (path, sizeof (path), "%s/tizonia.conf", dir);
+  write_rc_file (path, "[plugins]\nkey = 0\n");
+  fail_if (0 != setenv ("TIZONIA_RC_FILE", path, 1));
+
+  fail_if (OMX_ErrorNone != tiz_rcfile_init (&p_rc));
+  /* No grace period: replaced snapshots go as soon as the watcher runs */
+  p_rc->retired_grace = 0;
+  fail_if (OMX_ErrorNone != tiz_rcfile_watch (p_rc));
+
+  for (n = 1; n <= 3; ++n)
+    {
+      char expected[16];
+      snprintf (expected, sizeof (expected), "%d", n);
+      snprintf (contents, sizeof (contents), "[plugins]\nkey = %d\n", n);
+      write_rc_file (path, contents);
+
+      /* Wait up to 5 seconds for the new snapshot */
+      for (i = 0; i < 500; ++i)
+        {
+          val = tiz_rcfile_get_value_internal (p_rc, "plugins", "key");
+          if (val && 0 == strcmp (val, expected))
+            {
+              break;
+            }
+          usleep (10000);
+        }
+      fail_if (NULL == val || 0 != strcmp (val, expected));
+    }
+
+  /* Give the watcher a moment to free the last replaced snapshot */
+  for (i = 0; i < 500; ++i)
+    {
+      if (NULL == __atomic_load_n (&(p_rc->p_retired), __ATOMIC_ACQUIRE))
+        {
+          break;
+        }
+      usleep (10000);
+    }
+  fail_if (NULL != __atomic_load_n (&(p_rc->p_retired), __ATOMIC_ACQUIRE));
+
+  tiz_rcfile_destroy (p_rc);
+  unlink (path);
+  rmdir (dir);
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
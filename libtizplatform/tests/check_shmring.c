@@ -0,0 +1,362 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_shmring.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Shared memory ring API unit tests
+ *
+ *
+ */
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#define SHM_RING_TEST_SLOTS 4
+#define SHM_RING_TEST_SLOT_SIZE 1024
+#define SHM_RING_TEST_ITEMS 10000
+
+static bool
+shm_ring_test_readable (const int a_fd)
+{
+  struct pollfd pfd = {a_fd, POLLIN, 0};
+  return 1 == poll (&pfd, 1, 0);
+}
+
+START_TEST (test_shm_ring_broadcast)
+{
+  tiz_shm_ring_t * p_prod = NULL;
+  tiz_shm_ring_t * p_cons[2] = {NULL, NULL};
+  const void * p_data = NULL;
+  const void * p_data2 = NULL;
+  void * p_slot = NULL;
+  size_t len = 0;
+  OMX_U32 flags = 0;
+  OMX_TICKS ts = 0;
+  int i = 0;
+
+  fail_if (OMX_ErrorBadParameter
+           != tiz_shm_ring_open (&p_prod, "check.ring", 1,
+                                 SHM_RING_TEST_SLOT_SIZE));
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&p_prod, "check.ring", SHM_RING_TEST_SLOTS,
+                                 SHM_RING_TEST_SLOT_SIZE));
+  /* The geometry is that of the existing ring */
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&p_cons[0], "check.ring", 2, 16));
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&p_cons[1], "check.ring", 2, 16));
+  fail_if (SHM_RING_TEST_SLOT_SIZE != tiz_shm_ring_slot_size (p_cons[0]));
+
+  /* Without consumers, slots are recycled straight away */
+  for (i = 0; i < SHM_RING_TEST_SLOTS * 2; ++i)
+    {
+      fail_if (OMX_ErrorNone != tiz_shm_ring_claim (p_prod, &p_slot));
+      tiz_shm_ring_publish (p_prod, 1, 0, 0);
+    }
+
+  fail_if (OMX_ErrorNone != tiz_shm_ring_subscribe (p_cons[0]));
+  fail_if (OMX_ErrorNone != tiz_shm_ring_subscribe (p_cons[1]));
+  fail_if (tiz_shm_ring_fd (p_cons[0]) == tiz_shm_ring_fd (p_cons[1]));
+  fail_if (OMX_ErrorNoMore
+           != tiz_shm_ring_peek (p_cons[0], &p_data, &len, NULL, NULL));
+
+  /* Fill the ring; the consumer that was waiting gets notified */
+  for (i = 0; i < SHM_RING_TEST_SLOTS; ++i)
+    {
+      fail_if (OMX_ErrorNone != tiz_shm_ring_claim (p_prod, &p_slot));
+      memset (p_slot, 'a' + i, i + 1);
+      tiz_shm_ring_publish (p_prod, i + 1, i, 1000 * i);
+    }
+  fail_if (OMX_ErrorNoMore != tiz_shm_ring_claim (p_prod, &p_slot));
+  fail_if (!shm_ring_test_readable (tiz_shm_ring_fd (p_cons[0])));
+  fail_if (shm_ring_test_readable (tiz_shm_ring_fd (p_cons[1])));
+  tiz_shm_ring_clear_fd (p_cons[0]);
+
+  /* Both consumers read the very same memory */
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_peek (p_cons[0], &p_data, &len, &flags, &ts));
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_peek (p_cons[1], &p_data2, &len, &flags, &ts));
+  fail_if (p_data != p_data2);
+  fail_if (1 != len || 0 != flags || 0 != ts || 'a' != *(const char *) p_data);
+
+  /* The slot is only freed when the last reader releases it */
+  tiz_shm_ring_release (p_cons[0]);
+  tiz_shm_ring_clear_fd (p_prod);
+  fail_if (OMX_ErrorNoMore != tiz_shm_ring_claim (p_prod, &p_slot));
+  fail_if (shm_ring_test_readable (tiz_shm_ring_fd (p_prod)));
+  tiz_shm_ring_release (p_cons[1]);
+  fail_if (!shm_ring_test_readable (tiz_shm_ring_fd (p_prod)));
+  tiz_shm_ring_clear_fd (p_prod);
+  fail_if (OMX_ErrorNone != tiz_shm_ring_claim (p_prod, &p_slot));
+  memset (p_slot, 'z', 5);
+  tiz_shm_ring_publish (p_prod, 5, OMX_BUFFERFLAG_EOS, 5000);
+
+  for (i = 1; i < SHM_RING_TEST_SLOTS; ++i)
+    {
+      fail_if (OMX_ErrorNone
+               != tiz_shm_ring_peek (p_cons[0], &p_data, &len, &flags, &ts));
+      fail_if ((size_t) i + 1 != len || (OMX_U32) i != flags
+               || 1000 * i != ts || 'a' + i != *(const char *) p_data);
+      tiz_shm_ring_release (p_cons[0]);
+    }
+
+  /* An unsubscribed consumer does not hold any slots */
+  tiz_shm_ring_unsubscribe (p_cons[1]);
+  fail_if (OMX_ErrorNone != tiz_shm_ring_claim (p_prod, &p_slot));
+  tiz_shm_ring_publish (p_prod, 0, 0, 0);
+
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_peek (p_cons[0], &p_data, &len, &flags, &ts));
+  fail_if (5 != len || OMX_BUFFERFLAG_EOS != flags || 5000 != ts);
+  tiz_shm_ring_release (p_cons[0]);
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_peek (p_cons[0], &p_data, &len, &flags, &ts));
+  fail_if (0 != len);
+  tiz_shm_ring_release (p_cons[0]);
+  fail_if (OMX_ErrorNoMore
+           != tiz_shm_ring_peek (p_cons[0], &p_data, &len, &flags, &ts));
+
+  tiz_shm_ring_close (p_cons[1]);
+  tiz_shm_ring_close (p_cons[0]);
+  tiz_shm_ring_close (p_prod);
+}
+END_TEST
+
+START_TEST (test_shm_ring_max_consumers)
+{
+  tiz_shm_ring_t * p_cons[TIZ_SHM_RING_MAX_CONSUMERS + 1];
+  int i = 0;
+
+  for (i = 0; i <= TIZ_SHM_RING_MAX_CONSUMERS; ++i)
+    {
+      fail_if (OMX_ErrorNone
+               != tiz_shm_ring_open (&p_cons[i], "check.ring.max",
+                                     SHM_RING_TEST_SLOTS,
+                                     SHM_RING_TEST_SLOT_SIZE));
+      fail_if (OMX_ErrorNone != tiz_shm_ring_subscribe (p_cons[i])
+               && i < TIZ_SHM_RING_MAX_CONSUMERS);
+    }
+  fail_if (OMX_ErrorNoMore
+           != tiz_shm_ring_subscribe (p_cons[TIZ_SHM_RING_MAX_CONSUMERS]));
+  tiz_shm_ring_close (p_cons[0]);
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_subscribe (p_cons[TIZ_SHM_RING_MAX_CONSUMERS]));
+  for (i = 1; i <= TIZ_SHM_RING_MAX_CONSUMERS; ++i)
+    {
+      tiz_shm_ring_close (p_cons[i]);
+    }
+}
+END_TEST
+
+START_TEST (test_shm_ring_cross_process)
+{
+  tiz_shm_ring_t * p_prod = NULL;
+  int socks[2] = {-1, -1};
+  pid_t pid = 0;
+  int status = 0;
+  int i = 0;
+
+  fail_if (0 != socketpair (AF_UNIX, SOCK_STREAM, 0, socks));
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&p_prod, "check.ring.xproc",
+                                 SHM_RING_TEST_SLOTS,
+                                 SHM_RING_TEST_SLOT_SIZE));
+
+  pid = fork ();
+  fail_if (pid < 0);
+  if (0 == pid)
+    {
+      tiz_shm_ring_t * p_cons = NULL;
+      const void * p_data = NULL;
+      size_t len = 0;
+      OMX_U32 flags = 0;
+      unsigned expected = 0;
+      char ready = 'r';
+
+      if (OMX_ErrorNone != tiz_shm_ring_import (&p_cons, socks[1])
+          || OMX_ErrorNone != tiz_shm_ring_subscribe (p_cons)
+          || 1 != write (socks[1], &ready, 1))
+        {
+          _exit (1);
+        }
+      while (!(flags & OMX_BUFFERFLAG_EOS))
+        {
+          struct pollfd pfd = {tiz_shm_ring_fd (p_cons), POLLIN, 0};
+          if (OMX_ErrorNoMore
+              == tiz_shm_ring_peek (p_cons, &p_data, &len, &flags, NULL))
+            {
+              (void) poll (&pfd, 1, 1000);
+              tiz_shm_ring_clear_fd (p_cons);
+              continue;
+            }
+          if (sizeof (expected) != len
+              || 0 != memcmp (p_data, &expected, sizeof (expected)))
+            {
+              _exit (2);
+            }
+          ++expected;
+          tiz_shm_ring_release (p_cons);
+        }
+      tiz_shm_ring_close (p_cons);
+      _exit (SHM_RING_TEST_ITEMS == expected ? 0 : 3);
+    }
+
+  {
+    char ready = 0;
+    fail_if (OMX_ErrorNone != tiz_shm_ring_export (p_prod, socks[0]));
+    fail_if (1 != read (socks[0], &ready, 1));
+  }
+
+  for (i = 0; i < SHM_RING_TEST_ITEMS; ++i)
+    {
+      void * p_slot = NULL;
+      const unsigned val = i;
+      while (OMX_ErrorNoMore == tiz_shm_ring_claim (p_prod, &p_slot))
+        {
+          struct pollfd pfd = {tiz_shm_ring_fd (p_prod), POLLIN, 0};
+          (void) poll (&pfd, 1, 1000);
+          tiz_shm_ring_clear_fd (p_prod);
+        }
+      memcpy (p_slot, &val, sizeof (val));
+      tiz_shm_ring_publish (p_prod, sizeof (val),
+                            SHM_RING_TEST_ITEMS - 1 == i ? OMX_BUFFERFLAG_EOS
+                                                         : 0,
+                            0);
+    }
+
+  fail_if (pid != waitpid (pid, &status, 0));
+  fail_if (!WIFEXITED (status) || 0 != WEXITSTATUS (status));
+
+  tiz_shm_ring_close (p_prod);
+  close (socks[0]);
+  close (socks[1]);
+}
+END_TEST
+
+typedef struct shm_ring_test_publisher shm_ring_test_publisher_t;
+struct shm_ring_test_publisher
+{
+  tiz_shm_ring_t * p_ring;
+  int stop;
+};
+
+static void *
+shm_ring_test_publisher_func (void * ap_arg)
+{
+  shm_ring_test_publisher_t * p_pub = ap_arg;
+  unsigned val = 0;
+
+  while (!__atomic_load_n (&(p_pub->stop), __ATOMIC_ACQUIRE))
+    {
+      void * p_slot = NULL;
+      if (OMX_ErrorNoMore == tiz_shm_ring_claim (p_pub->p_ring, &p_slot))
+        {
+          struct pollfd pfd = {tiz_shm_ring_fd (p_pub->p_ring), POLLIN, 0};
+          (void) poll (&pfd, 1, 10);
+          tiz_shm_ring_clear_fd (p_pub->p_ring);
+          continue;
+        }
+      memcpy (p_slot, &val, sizeof (val));
+      tiz_shm_ring_publish (p_pub->p_ring, sizeof (val), 0, 0);
+      ++val;
+    }
+  return NULL;
+}
+
+/* Subscribing while the producer is publishing must not leave behind a
+   slot that still expects a release from the new consumer; the producer
+   would stall on it as soon as the ring wraps around. */
+START_TEST (test_shm_ring_subscribe_while_publishing)
+{
+  shm_ring_test_publisher_t pub;
+  tiz_shm_ring_t * p_cons = NULL;
+  tiz_thread_t thread;
+  void * p_result = NULL;
+  int round = 0;
+
+  pub.p_ring = NULL;
+  pub.stop = 0;
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&pub.p_ring, "check.ring.race",
+                                 SHM_RING_TEST_SLOTS,
+                                 SHM_RING_TEST_SLOT_SIZE));
+  fail_if (OMX_ErrorNone
+           != tiz_shm_ring_open (&p_cons, "check.ring.race",
+                                 SHM_RING_TEST_SLOTS,
+                                 SHM_RING_TEST_SLOT_SIZE));
+  fail_if (OMX_ErrorNone
+           != tiz_thread_create (&thread, 0, 0, shm_ring_test_publisher_func,
+                                 &pub));
+
+  /* Without a consumer the producer publishes flat out, so every subscribe
+     below races with a publication */
+  for (round = 0; round < SHM_RING_TEST_ITEMS; ++round)
+    {
+      unsigned expected = 0;
+      int received = 0;
+      int idle = 0;
+
+      fail_if (OMX_ErrorNone != tiz_shm_ring_subscribe (p_cons));
+
+      /* Twice around the ring, consecutively, and without stalling */
+      while (received < SHM_RING_TEST_SLOTS * 2 && idle < 20)
+        {
+          const void * p_data = NULL;
+          size_t len = 0;
+          unsigned val = 0;
+          if (OMX_ErrorNoMore
+              == tiz_shm_ring_peek (p_cons, &p_data, &len, NULL, NULL))
+            {
+              struct pollfd pfd = {tiz_shm_ring_fd (p_cons), POLLIN, 0};
+              if (0 == poll (&pfd, 1, 100))
+                {
+                  ++idle;
+                }
+              tiz_shm_ring_clear_fd (p_cons);
+              continue;
+            }
+          fail_if (sizeof (val) != len);
+          memcpy (&val, p_data, sizeof (val));
+          fail_if (received > 0 && expected != val);
+          expected = val + 1;
+          ++received;
+          idle = 0;
+          tiz_shm_ring_release (p_cons);
+        }
+      fail_if (received < SHM_RING_TEST_SLOTS * 2);
+      tiz_shm_ring_unsubscribe (p_cons);
+    }
+
+  __atomic_store_n (&(pub.stop), 1, __ATOMIC_RELEASE);
+  tiz_thread_join (&thread, &p_result);
+  tiz_shm_ring_close (p_cons);
+  tiz_shm_ring_close (pub.p_ring);
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
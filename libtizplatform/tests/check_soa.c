@@ -255,6 +255,184 @@ START_TEST (test_soa_reserve_life_cycle)
 }
 END_TEST
 
+START_TEST (test_soa_large_classes)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_soa_t *p_soa = NULL;
+  void *p_class5_obj = NULL;
+  void *p_class6_obj = NULL;
+  void *p_large_obj = NULL;
+  tiz_soa_info_t info;
+
+  error = tiz_soa_init (&p_soa);
+  fail_if (error != OMX_ErrorNone);
+
+  fail_if (NULL == (p_class5_obj = tiz_soa_calloc (p_soa, 300)));
+  fail_if (NULL == (p_class6_obj = tiz_soa_calloc (p_soa, 900)));
+  /* Too large for any class; served from the heap */
+  fail_if (NULL == (p_large_obj = tiz_soa_calloc (p_soa, 2000)));
+  memset (p_class5_obj, 0xa5, 300);
+  memset (p_class6_obj, 0xa6, 900);
+  memset (p_large_obj, 0xaa, 2000);
+
+  tiz_soa_info (p_soa, &info);
+  fail_if (info.chunks != 2);
+  fail_if (info.objects != 3);
+  fail_if (info.slices[5] != 1);
+  fail_if (info.slices[6] != 1);
+  fail_if (info.large_objects != 1);
+  fail_if (info.allocations != 3);
+
+  tiz_soa_free (p_soa, p_class5_obj);
+  tiz_soa_free (p_soa, p_class6_obj);
+  tiz_soa_free (p_soa, p_large_obj);
+
+  tiz_soa_info (p_soa, &info);
+  fail_if (info.chunks != 2);
+  fail_if (info.objects != 0);
+  fail_if (info.large_objects != 0);
+  fail_if (info.frees != 3);
+
+  tiz_soa_destroy (p_soa);
+}
+END_TEST
+
+#define SOA_TEST_PRODUCERS 4
+#define SOA_TEST_OBJS_PER_PRODUCER 20000
+#define SOA_TEST_OBJ_SIZE 72
+
+typedef struct soa_test_producer soa_test_producer_t;
+struct soa_test_producer
+{
+  tiz_soa_t *p_soa;
+  tiz_queue_t *p_queue;
+  int id;
+};
+
+static void *
+soa_test_producer_func (void *ap_arg)
+{
+  soa_test_producer_t *p_prod = ap_arg;
+  int i;
+
+  for (i = 0; i < SOA_TEST_OBJS_PER_PRODUCER; i++)
+    {
+      uint8_t *p_obj = tiz_soa_calloc (p_prod->p_soa, SOA_TEST_OBJ_SIZE);
+      fail_if (p_obj == NULL);
+      fail_if (p_obj[0] != 0 || p_obj[SOA_TEST_OBJ_SIZE - 1] != 0);
+      memset (p_obj, p_prod->id + 1, SOA_TEST_OBJ_SIZE);
+      fail_if (OMX_ErrorNone != tiz_queue_send (p_prod->p_queue, p_obj));
+    }
+
+  return NULL;
+}
+
+START_TEST (test_soa_thread_safe_remote_frees)
+{
+  OMX_ERRORTYPE error = OMX_ErrorNone;
+  tiz_soa_t *p_soa = NULL;
+  tiz_queue_t *p_queue = NULL;
+  tiz_thread_t threads[SOA_TEST_PRODUCERS];
+  soa_test_producer_t prods[SOA_TEST_PRODUCERS];
+  tiz_soa_info_t info;
+  int i;
+
+  error = tiz_soa_init_with_flags (&p_soa, TIZ_SOA_FLAG_THREAD_SAFE);
+  fail_if (error != OMX_ErrorNone);
+
+  error = tiz_queue_init_with_flags (&p_queue, 16,
+                                     TIZ_QUEUE_FLAG_LOCK_FREE_MPSC);
+  fail_if (error != OMX_ErrorNone);
+
+  for (i = 0; i < SOA_TEST_PRODUCERS; i++)
+    {
+      prods[i].p_soa = p_soa;
+      prods[i].p_queue = p_queue;
+      prods[i].id = i;
+      fail_if (OMX_ErrorNone
+               != tiz_thread_create (&threads[i], 0, 0,
+                                     soa_test_producer_func, &prods[i]));
+    }
+
+  /* Objects are allocated by the producers and freed by this thread, the way
+     scheduler messages are */
+  for (i = 0; i < SOA_TEST_PRODUCERS * SOA_TEST_OBJS_PER_PRODUCER; i++)
+    {
+      OMX_PTR p_received = NULL;
+      uint8_t *p_obj = NULL;
+      error = tiz_queue_receive (p_queue, &p_received);
+      fail_if (error != OMX_ErrorNone);
+      p_obj = p_received;
+      fail_if (p_obj[0] == 0 || p_obj[0] > SOA_TEST_PRODUCERS);
+      fail_if (p_obj[SOA_TEST_OBJ_SIZE - 1] != p_obj[0]);
+      tiz_soa_free (p_soa, p_obj);
+    }
+
+  for (i = 0; i < SOA_TEST_PRODUCERS; i++)
+    {
+      OMX_PTR p_result = NULL;
+      tiz_thread_join (&threads[i], &p_result);
+    }
+
+  tiz_soa_info (p_soa, &info);
+  fail_if (info.objects != 0);
+  fail_if (info.allocations
+           != SOA_TEST_PRODUCERS * SOA_TEST_OBJS_PER_PRODUCER);
+  fail_if (info.frees
+           != SOA_TEST_PRODUCERS * SOA_TEST_OBJS_PER_PRODUCER);
+  /* The slices freed by this thread must have been reused by the
+     producers */
+  fail_if (info.remote_refills == 0);
+  fail_if (info.magazine_hits == 0);
+  /* Without reuse, this would have needed ~1900 chunks */
+  fail_if (info.chunks > 64);
+
+  tiz_queue_destroy (p_queue);
+  tiz_soa_destroy (p_soa);
+}
+END_TEST
+
+#define SOA_TEST_ALLOCATORS 16
+#define SOA_TEST_ROUNDS 1000
+
+START_TEST (test_soa_thread_safe_many_allocators)
+{
+  tiz_soa_t *soas[SOA_TEST_ALLOCATORS];
+  tiz_soa_info_t info;
+  int i, j;
+
+  for (i = 0; i < SOA_TEST_ALLOCATORS; i++)
+    {
+      fail_if (OMX_ErrorNone
+               != tiz_soa_init_with_flags (&soas[i],
+                                           TIZ_SOA_FLAG_THREAD_SAFE));
+    }
+
+  /* One thread serving many allocators, the way a thread may run many
+     components, each with a scheduler of its own */
+  for (j = 0; j < SOA_TEST_ROUNDS; j++)
+    {
+      for (i = 0; i < SOA_TEST_ALLOCATORS; i++)
+        {
+          void *p_obj = tiz_soa_calloc (soas[i], SOA_TEST_OBJ_SIZE);
+          fail_if (p_obj == NULL);
+          tiz_soa_free (soas[i], p_obj);
+        }
+    }
+
+  for (i = 0; i < SOA_TEST_ALLOCATORS; i++)
+    {
+      tiz_soa_info (soas[i], &info);
+      fail_if (info.objects != 0);
+      fail_if (info.allocations != SOA_TEST_ROUNDS);
+      /* Only the first allocation misses the thread's magazine */
+      fail_if (info.magazine_hits != SOA_TEST_ROUNDS - 1);
+      fail_if (info.remote_refills != 0);
+      tiz_soa_destroy (soas[i]);
+    }
+}
+END_TEST
+
 /* Local Variables: */
 /* c-default-style: gnu */
 /* fill-column: 79 */
@@ -33,6 +33,7 @@
 #include <unistd.h>
 #include <linux/limits.h>
 #include "../src/tizplatform.h"
+#include "../src/tizplatform_internal.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -51,6 +52,12 @@
 #include "./check_event.c"
 #include "./check_http_parser.c"
 #include "./check_map.c"
+#include "./check_log.c"
+#include "./check_pcm.c"
+#include "./check_shmring.c"
+#include "./check_buffer.c"
+#include "./check_urltrans.c"
+#include "./check_urlcache.c"
 
 #define EVENT_API_TEST_TIMEOUT 100
 
@@ -103,6 +110,9 @@ platform_queue_suite (void)
   tc_queue = tcase_create ("queue");
   tcase_add_test (tc_queue, test_queue_init_and_destroy);
   tcase_add_test (tc_queue, test_queue_send_and_receive);
+  tcase_add_test (tc_queue, test_queue_lock_free_spsc_send_and_receive);
+  tcase_add_test (tc_queue, test_queue_lock_free_mpsc_send_and_receive);
+  tcase_add_test (tc_queue, test_queue_try_receive);
   suite_add_tcase (s, tc_queue);
 
   return s;
@@ -123,6 +133,8 @@ platform_pqueue_suite (void)
   tcase_add_test (tc_pqueue, test_pqueue_first);
   tcase_add_test (tc_pqueue, test_pqueue_remove);
   tcase_add_test (tc_pqueue, test_pqueue_removep);
+  tcase_add_test (tc_pqueue, test_pqueue_remove_handle);
+  tcase_add_test (tc_pqueue, test_pqueue_many_groups);
   suite_add_tcase (s, tc_pqueue);
 
   return s;
@@ -158,6 +170,9 @@ platform_rcfile_suite (void)
   tcase_add_test (tc_rc, test_rcfile_get_single_value);
   tcase_add_test (tc_rc, test_rcfile_get_unexistent_value);
   tcase_add_test (tc_rc, test_rcfile_get_value_list);
+  tcase_add_test (tc_rc, test_rcfile_sections);
+  tcase_add_test (tc_rc, test_rcfile_reload);
+  tcase_add_test (tc_rc, test_rcfile_reload_reclaims_snapshots);
   suite_add_tcase (s, tc_rc);
 
   return s;
@@ -173,6 +188,9 @@ platform_soa_suite (void)
   tc_soa = tcase_create ("soa");
   tcase_add_test (tc_soa, test_soa_basic_life_cycle);
   tcase_add_test (tc_soa, test_soa_reserve_life_cycle);
+  tcase_add_test (tc_soa, test_soa_large_classes);
+  tcase_add_test (tc_soa, test_soa_thread_safe_remote_frees);
+  tcase_add_test (tc_soa, test_soa_thread_safe_many_allocators);
   suite_add_tcase (s, tc_soa);
 
   return s;
@@ -191,6 +209,7 @@ platform_event_suite (void)
   tcase_add_test (tc_event, test_event_io);
   tcase_add_test (tc_event, test_event_timer);
   tcase_add_test (tc_event, test_event_stat);
+  tcase_add_test (tc_event, test_event_timer_sharded_loops);
   suite_add_tcase (s, tc_event);
 
   return s;
@@ -227,6 +246,101 @@ platform_map_suite (void)
 
 }
 
+Suite *
+platform_log_suite (void)
+{
+  TCase *tc_log = NULL;
+  Suite *s = suite_create ("Logging APIs");
+
+  /* logging API test cases */
+  tc_log = tcase_create ("log");
+  tcase_add_test (tc_log, test_log_async_multiple_threads);
+  suite_add_tcase (s, tc_log);
+
+  return s;
+}
+
+Suite *
+platform_pcm_suite (void)
+{
+  TCase *tc_pcm = NULL;
+  Suite *s = suite_create ("PCM conversion APIs");
+
+  /* pcm conversion API test cases */
+  tc_pcm = tcase_create ("pcm");
+  tcase_add_test (tc_pcm, test_pcm_fixed_to_s16);
+  tcase_add_test (tc_pcm, test_pcm_float_to_s16);
+  tcase_add_test (tc_pcm, test_pcm_gain);
+  tcase_add_test (tc_pcm, test_pcm_dither);
+  tcase_add_test (tc_pcm, test_pcm_formats);
+  suite_add_tcase (s, tc_pcm);
+
+  return s;
+}
+
+Suite *
+platform_shm_ring_suite (void)
+{
+  TCase *tc_shm_ring = NULL;
+  Suite *s = suite_create ("Shared memory ring APIs");
+
+  /* shared memory ring API test cases */
+  tc_shm_ring = tcase_create ("shm_ring");
+  tcase_add_test (tc_shm_ring, test_shm_ring_broadcast);
+  tcase_add_test (tc_shm_ring, test_shm_ring_max_consumers);
+  tcase_add_test (tc_shm_ring, test_shm_ring_cross_process);
+  tcase_add_test (tc_shm_ring, test_shm_ring_subscribe_while_publishing);
+  suite_add_tcase (s, tc_shm_ring);
+
+  return s;
+}
+
+Suite *
+platform_buffer_suite (void)
+{
+  TCase *tc_buffer = NULL;
+  Suite *s = suite_create ("Dynamic buffer APIs");
+
+  /* dynamic buffer API test cases */
+  tc_buffer = tcase_create ("buffer");
+  tcase_add_test (tc_buffer, test_buffer_non_seekable);
+  tcase_add_test (tc_buffer, test_buffer_ring);
+  tcase_add_test (tc_buffer, test_buffer_iov);
+  suite_add_tcase (s, tc_buffer);
+
+  return s;
+}
+
+Suite *
+platform_urltrans_suite (void)
+{
+  TCase *tc_urltrans = NULL;
+  Suite *s = suite_create ("URL transfer APIs");
+
+  tc_urltrans = tcase_create ("urltrans");
+  tcase_add_test (tc_urltrans, test_urltrans_connection_reuse);
+  suite_add_tcase (s, tc_urltrans);
+
+  return s;
+}
+
+Suite *
+platform_urlcache_suite (void)
+{
+  TCase *tc_urlcache = NULL;
+  Suite *s = suite_create ("URL cache APIs");
+
+  tc_urlcache = tcase_create ("urlcache");
+  tcase_set_timeout (tc_urlcache, 30);
+  tcase_add_test (tc_urlcache, test_urlcache_parallel_fill_and_seek);
+  tcase_add_test (tc_urlcache, test_urlcache_seek_ahead);
+  tcase_add_test (tc_urlcache, test_urlcache_replay_from_disk);
+  tcase_add_test (tc_urlcache, test_urlcache_ranges_ignored);
+  suite_add_tcase (s, tc_urlcache);
+
+  return s;
+}
+
 int
 main (void)
 {
@@ -247,6 +361,12 @@ main (void)
   srunner_add_suite (sr, platform_http_parser_suite ());
   srunner_add_suite (sr, platform_map_suite ());
   srunner_add_suite (sr, platform_event_suite ());
+  srunner_add_suite (sr, platform_log_suite ());
+  srunner_add_suite (sr, platform_pcm_suite ());
+  srunner_add_suite (sr, platform_shm_ring_suite ());
+  srunner_add_suite (sr, platform_buffer_suite ());
+  srunner_add_suite (sr, platform_urltrans_suite ());
+  srunner_add_suite (sr, platform_urlcache_suite ());
   srunner_run_all (sr, CK_VERBOSE);
   number_failed = srunner_ntests_failed (sr);
   srunner_free (sr);
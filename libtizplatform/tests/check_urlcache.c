@@ -0,0 +1,408 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_urlcache.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  URL cache API unit tests
+ *
+ * The caches download from a local HTTP/1.1 server that honours single byte
+ * ranges (or ignores them, on request).
+ */
+
+#include <dirent.h>
+
+/* Four full chunks and a short one */
+#define URLCACHE_TEST_BODY_SIZE (4 * TIZ_URL_CACHE_CHUNK_SIZE + 1000)
+#define URLCACHE_TEST_NCHUNKS 5
+#define URLCACHE_TEST_MAX_CONNS 8
+
+typedef struct urlcache_test_server urlcache_test_server_t;
+struct urlcache_test_server
+{
+  int lfd;
+  int port;
+  int nconns;
+  int fds[URLCACHE_TEST_MAX_CONNS];
+  char * p_body;
+  bool ignore_ranges;
+  int nrequests; /* Written by the server thread */
+  int stop;
+  pthread_t thread;
+  char url[64];
+};
+
+static inline char
+urlcache_test_byte (const OMX_S64 a_offset)
+{
+  return (char) ((a_offset * 7) % 251);
+}
+
+static bool
+urlcache_test_write_all (const int a_fd, const char * ap_buf, size_t a_len)
+{
+  while (a_len > 0)
+    {
+      ssize_t n = write (a_fd, ap_buf, a_len);
+      if (n <= 0)
+        {
+          return false;
+        }
+      ap_buf += n;
+      a_len -= n;
+    }
+  return true;
+}
+
+static void
+urlcache_test_serve (urlcache_test_server_t * p_srv, const int a_idx)
+{
+  char req[2048];
+  ssize_t n = read (p_srv->fds[a_idx], req, sizeof (req) - 1);
+  if (n <= 0)
+    {
+      close (p_srv->fds[a_idx]);
+      p_srv->fds[a_idx] = p_srv->fds[--p_srv->nconns];
+      return;
+    }
+  req[n] = '\0';
+  /* Requests are small, and the client waits for each response */
+  if (strstr (req, "\r\n\r\n"))
+    {
+      char hdr[256];
+      long long first = 0;
+      long long last = URLCACHE_TEST_BODY_SIZE - 1;
+      const char * p_range = strstr (req, "Range: bytes=");
+      bool partial = false;
+      int hlen = 0;
+
+      if (p_range && !p_srv->ignore_ranges
+          && 2 == sscanf (p_range, "Range: bytes=%lld-%lld", &first, &last))
+        {
+          partial = true;
+        }
+      else
+        {
+          first = 0;
+          last = URLCACHE_TEST_BODY_SIZE - 1;
+        }
+
+      hlen = snprintf (
+        hdr, sizeof (hdr),
+        "HTTP/1.1 %s\r\nContent-Type: audio/mpeg\r\n"
+        "Content-Length: %lld\r\n%s%lld-%lld/%d\r\n\r\n",
+        partial ? "206 Partial Content" : "200 OK", last - first + 1,
+        partial ? "Content-Range: bytes " : "X-Range: ", first, last,
+        URLCACHE_TEST_BODY_SIZE);
+      __sync_fetch_and_add (&p_srv->nrequests, 1);
+      if (!urlcache_test_write_all (p_srv->fds[a_idx], hdr, hlen)
+          || !urlcache_test_write_all (p_srv->fds[a_idx],
+                                       p_srv->p_body + first,
+                                       last - first + 1))
+        {
+          /* The client has abandoned the request */
+          close (p_srv->fds[a_idx]);
+          p_srv->fds[a_idx] = p_srv->fds[--p_srv->nconns];
+        }
+    }
+}
+
+static void *
+urlcache_test_server_thread (void * ap_arg)
+{
+  urlcache_test_server_t * p_srv = ap_arg;
+  while (!__sync_fetch_and_add (&p_srv->stop, 0))
+    {
+      struct pollfd pfds[URLCACHE_TEST_MAX_CONNS + 1];
+      int i = 0;
+      pfds[0].fd = p_srv->lfd;
+      pfds[0].events = POLLIN;
+      for (i = 0; i < p_srv->nconns; ++i)
+        {
+          pfds[i + 1].fd = p_srv->fds[i];
+          pfds[i + 1].events = POLLIN;
+        }
+      if (poll (pfds, p_srv->nconns + 1, 50) <= 0)
+        {
+          continue;
+        }
+      for (i = p_srv->nconns - 1; i >= 0; --i)
+        {
+          if (pfds[i + 1].revents)
+            {
+              urlcache_test_serve (p_srv, i);
+            }
+        }
+      if ((pfds[0].revents & POLLIN) && p_srv->nconns < URLCACHE_TEST_MAX_CONNS)
+        {
+          p_srv->fds[p_srv->nconns++] = accept (p_srv->lfd, NULL, NULL);
+        }
+    }
+  while (p_srv->nconns > 0)
+    {
+      close (p_srv->fds[--p_srv->nconns]);
+    }
+  return NULL;
+}
+
+static void
+urlcache_test_server_start (urlcache_test_server_t * p_srv,
+                            const bool a_ignore_ranges)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+  int i = 0;
+
+  memset (p_srv, 0, sizeof (*p_srv));
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+  fail_if ((p_srv->lfd = socket (AF_INET, SOCK_STREAM, 0)) < 0);
+  fail_if (0 != bind (p_srv->lfd, (struct sockaddr *) &addr, sizeof (addr)));
+  fail_if (0 != listen (p_srv->lfd, 8));
+  fail_if (0 != getsockname (p_srv->lfd, (struct sockaddr *) &addr, &len));
+  p_srv->port = ntohs (addr.sin_port);
+  p_srv->ignore_ranges = a_ignore_ranges;
+  (void) snprintf (p_srv->url, sizeof (p_srv->url),
+                   "http://127.0.0.1:%d/track.mp3", p_srv->port);
+  fail_if (!(p_srv->p_body = malloc (URLCACHE_TEST_BODY_SIZE)));
+  for (i = 0; i < URLCACHE_TEST_BODY_SIZE; ++i)
+    {
+      p_srv->p_body[i] = urlcache_test_byte (i);
+    }
+  /* Writes to a client that has gone away must not kill the process */
+  signal (SIGPIPE, SIG_IGN);
+  fail_if (0 != pthread_create (&p_srv->thread, NULL,
+                                urlcache_test_server_thread, p_srv));
+}
+
+static void
+urlcache_test_server_stop (urlcache_test_server_t * p_srv)
+{
+  __sync_fetch_and_add (&p_srv->stop, 1);
+  fail_if (0 != pthread_join (p_srv->thread, NULL));
+  close (p_srv->lfd);
+  free (p_srv->p_body);
+}
+
+/* Reads from the current position to the end, checking the data, and returns
+   the error that stopped the reads */
+static OMX_ERRORTYPE
+urlcache_test_read_to_end (tiz_urlcache_t * p_cache)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  char buf[10000];
+  OMX_S64 pos = tiz_urlcache_tell (p_cache);
+  int idle_polls = 0;
+
+  while (idle_polls < 50)
+    {
+      size_t nread = 0;
+      size_t i = 0;
+      rc = tiz_urlcache_read (p_cache, buf, sizeof (buf), &nread);
+      if (OMX_ErrorNoMore == rc)
+        {
+          struct pollfd pfd = {tiz_urlcache_fd (p_cache), POLLIN, 0};
+          if (poll (&pfd, 1, 100) <= 0)
+            {
+              ++idle_polls;
+            }
+          tiz_urlcache_clear_fd (p_cache);
+          continue;
+        }
+      if (OMX_ErrorNone != rc || 0 == nread)
+        {
+          break;
+        }
+      for (i = 0; i < nread; ++i)
+        {
+          fail_if (urlcache_test_byte (pos + i) != buf[i]);
+        }
+      pos += nread;
+      idle_polls = 0;
+    }
+
+  if (OMX_ErrorNone == rc)
+    {
+      fail_if (URLCACHE_TEST_BODY_SIZE != pos);
+    }
+  return rc;
+}
+
+static void
+urlcache_test_remove_dir (const char * ap_dir)
+{
+  char path[PATH_MAX];
+  DIR * p_dir = NULL;
+  struct dirent * p_ent = NULL;
+  (void) snprintf (path, sizeof (path), "%s/tizonia/urlcache", ap_dir);
+  if ((p_dir = opendir (path)))
+    {
+      while ((p_ent = readdir (p_dir)))
+        {
+          if ('.' != p_ent->d_name[0])
+            {
+              (void) unlinkat (dirfd (p_dir), p_ent->d_name, 0);
+            }
+        }
+      (void) closedir (p_dir);
+    }
+  (void) rmdir (path);
+  (void) snprintf (path, sizeof (path), "%s/tizonia", ap_dir);
+  (void) rmdir (path);
+  (void) rmdir (ap_dir);
+}
+
+START_TEST (test_urlcache_parallel_fill_and_seek)
+{
+  urlcache_test_server_t srv;
+  tiz_urlcache_t * p_cache = NULL;
+
+  urlcache_test_server_start (&srv, false);
+
+  /* No validator: the cache lives in a private file */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, NULL,
+                                 URLCACHE_TEST_BODY_SIZE, 3,
+                                 URLCACHE_TEST_BODY_SIZE, 0));
+  fail_if (URLCACHE_TEST_BODY_SIZE != tiz_urlcache_length (p_cache));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  fail_if (URLCACHE_TEST_BODY_SIZE != tiz_urlcache_cached (p_cache));
+  /* One range request per chunk */
+  fail_if (URLCACHE_TEST_NCHUNKS != __sync_fetch_and_add (&srv.nrequests, 0));
+
+  /* Seeking back is served from the file */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_seek (p_cache, TIZ_URL_CACHE_CHUNK_SIZE + 17));
+  fail_if (TIZ_URL_CACHE_CHUNK_SIZE + 17 != tiz_urlcache_tell (p_cache));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  fail_if (URLCACHE_TEST_NCHUNKS != __sync_fetch_and_add (&srv.nrequests, 0));
+  fail_if (OMX_ErrorBadParameter
+           != tiz_urlcache_seek (p_cache, URLCACHE_TEST_BODY_SIZE + 1));
+
+  tiz_urlcache_destroy (p_cache);
+  urlcache_test_server_stop (&srv);
+}
+END_TEST
+
+START_TEST (test_urlcache_seek_ahead)
+{
+  urlcache_test_server_t srv;
+  tiz_urlcache_t * p_cache = NULL;
+  const OMX_S64 offset = 3 * TIZ_URL_CACHE_CHUNK_SIZE + 5;
+
+  urlcache_test_server_start (&srv, false);
+
+  /* A one-chunk window: only the chunks from the seek position onwards are
+     downloaded */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, NULL,
+                                 URLCACHE_TEST_BODY_SIZE, 1,
+                                 TIZ_URL_CACHE_CHUNK_SIZE, 0));
+  fail_if (OMX_ErrorNone != tiz_urlcache_seek (p_cache, offset));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  fail_if (tiz_urlcache_cached (p_cache)
+           >= URLCACHE_TEST_BODY_SIZE - TIZ_URL_CACHE_CHUNK_SIZE);
+
+  tiz_urlcache_destroy (p_cache);
+  urlcache_test_server_stop (&srv);
+}
+END_TEST
+
+START_TEST (test_urlcache_replay_from_disk)
+{
+  urlcache_test_server_t srv;
+  tiz_urlcache_t * p_cache = NULL;
+  char dir[] = "/tmp/check_urlcache.XXXXXX";
+  char * p_old_xdg = getenv ("XDG_CACHE_HOME");
+  int nrequests = 0;
+
+  if (p_old_xdg)
+    {
+      p_old_xdg = strdup (p_old_xdg);
+    }
+  fail_if (!mkdtemp (dir));
+  fail_if (0 != setenv ("XDG_CACHE_HOME", dir, 1));
+
+  urlcache_test_server_start (&srv, false);
+
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, "\"etag-1\"",
+                                 URLCACHE_TEST_BODY_SIZE, 2,
+                                 URLCACHE_TEST_BODY_SIZE,
+                                 4 * URLCACHE_TEST_BODY_SIZE));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  tiz_urlcache_destroy (p_cache);
+  nrequests = __sync_fetch_and_add (&srv.nrequests, 0);
+  fail_if (URLCACHE_TEST_NCHUNKS != nrequests);
+
+  /* Same url and validator: nothing is downloaded again */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, "\"etag-1\"",
+                                 URLCACHE_TEST_BODY_SIZE, 2,
+                                 URLCACHE_TEST_BODY_SIZE,
+                                 4 * URLCACHE_TEST_BODY_SIZE));
+  fail_if (URLCACHE_TEST_BODY_SIZE != tiz_urlcache_cached (p_cache));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  fail_if (nrequests != __sync_fetch_and_add (&srv.nrequests, 0));
+  tiz_urlcache_destroy (p_cache);
+
+  /* The resource has changed: it is downloaded again */
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, "\"etag-2\"",
+                                 URLCACHE_TEST_BODY_SIZE, 2,
+                                 URLCACHE_TEST_BODY_SIZE,
+                                 4 * URLCACHE_TEST_BODY_SIZE));
+  fail_if (OMX_ErrorNone != urlcache_test_read_to_end (p_cache));
+  fail_if (2 * nrequests != __sync_fetch_and_add (&srv.nrequests, 0));
+  tiz_urlcache_destroy (p_cache);
+
+  urlcache_test_server_stop (&srv);
+  urlcache_test_remove_dir (dir);
+  if (p_old_xdg)
+    {
+      (void) setenv ("XDG_CACHE_HOME", p_old_xdg, 1);
+      free (p_old_xdg);
+    }
+  else
+    {
+      (void) unsetenv ("XDG_CACHE_HOME");
+    }
+}
+END_TEST
+
+START_TEST (test_urlcache_ranges_ignored)
+{
+  urlcache_test_server_t srv;
+  tiz_urlcache_t * p_cache = NULL;
+
+  urlcache_test_server_start (&srv, true);
+
+  fail_if (OMX_ErrorNone
+           != tiz_urlcache_init (&p_cache, srv.url, NULL,
+                                 URLCACHE_TEST_BODY_SIZE, 2,
+                                 URLCACHE_TEST_BODY_SIZE, 0));
+  fail_if (OMX_ErrorNone == urlcache_test_read_to_end (p_cache));
+
+  tiz_urlcache_destroy (p_cache);
+  urlcache_test_server_stop (&srv);
+}
+END_TEST
@@ -0,0 +1,396 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   check_urltrans.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  URL transfer API unit tests
+ *
+ * The transfers run against a local HTTP/1.1 keep-alive server, and are
+ * driven by a poll loop that stands in for the component's event watchers.
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+#define URLTRANS_TEST_BODY_SIZE (64 * 1024)
+#define URLTRANS_TEST_MAX_CONNS 8
+
+typedef struct urltrans_test_server urltrans_test_server_t;
+struct urltrans_test_server
+{
+  int lfd;
+  int port;
+  int nconns;
+  int fds[URLTRANS_TEST_MAX_CONNS];
+  char * p_body;
+  int naccepted; /* Written by the server thread */
+  int nrequests; /* Written by the server thread */
+  int stop;
+  pthread_t thread;
+};
+
+typedef struct urltrans_test_ctx urltrans_test_ctx_t;
+struct urltrans_test_ctx
+{
+  tiz_urltrans_t * p_trans;
+  int io_obj;
+  int io_fd;
+  tiz_event_io_event_t io_ev;
+  bool io_active;
+  bool timers[4];
+  int ntimers;
+  OMX_BUFFERHEADERTYPE hdr;
+  OMX_U8 data[4096];
+  size_t received;
+  bool done;
+};
+
+static void
+urltrans_test_serve (urltrans_test_server_t * p_srv, const int a_idx)
+{
+  char req[1024];
+  ssize_t n = read (p_srv->fds[a_idx], req, sizeof (req) - 1);
+  if (n <= 0)
+    {
+      close (p_srv->fds[a_idx]);
+      p_srv->fds[a_idx] = p_srv->fds[--p_srv->nconns];
+      return;
+    }
+  req[n] = '\0';
+  /* Requests are small, and the client waits for each response */
+  if (strstr (req, "\r\n\r\n"))
+    {
+      char hdr[128];
+      const int hlen
+        = snprintf (hdr, sizeof (hdr),
+                    "HTTP/1.1 200 OK\r\nContent-Type: audio/mpeg\r\n"
+                    "Content-Length: %d\r\n\r\n",
+                    URLTRANS_TEST_BODY_SIZE);
+      __sync_fetch_and_add (&p_srv->nrequests, 1);
+      if (hlen != write (p_srv->fds[a_idx], hdr, hlen)
+          || URLTRANS_TEST_BODY_SIZE != write (p_srv->fds[a_idx], p_srv->p_body,
+                                               URLTRANS_TEST_BODY_SIZE))
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "short write");
+        }
+    }
+}
+
+static void *
+urltrans_test_server_thread (void * ap_arg)
+{
+  urltrans_test_server_t * p_srv = ap_arg;
+  while (!__sync_fetch_and_add (&p_srv->stop, 0))
+    {
+      struct pollfd pfds[URLTRANS_TEST_MAX_CONNS + 1];
+      int i = 0;
+      pfds[0].fd = p_srv->lfd;
+      pfds[0].events = POLLIN;
+      for (i = 0; i < p_srv->nconns; ++i)
+        {
+          pfds[i + 1].fd = p_srv->fds[i];
+          pfds[i + 1].events = POLLIN;
+        }
+      if (poll (pfds, p_srv->nconns + 1, 50) <= 0)
+        {
+          continue;
+        }
+      for (i = p_srv->nconns - 1; i >= 0; --i)
+        {
+          if (pfds[i + 1].revents)
+            {
+              urltrans_test_serve (p_srv, i);
+            }
+        }
+      if ((pfds[0].revents & POLLIN) && p_srv->nconns < URLTRANS_TEST_MAX_CONNS)
+        {
+          p_srv->fds[p_srv->nconns++] = accept (p_srv->lfd, NULL, NULL);
+          __sync_fetch_and_add (&p_srv->naccepted, 1);
+        }
+    }
+  while (p_srv->nconns > 0)
+    {
+      close (p_srv->fds[--p_srv->nconns]);
+    }
+  return NULL;
+}
+
+static void
+urltrans_test_server_start (urltrans_test_server_t * p_srv)
+{
+  struct sockaddr_in addr;
+  socklen_t len = sizeof (addr);
+
+  memset (p_srv, 0, sizeof (*p_srv));
+  memset (&addr, 0, sizeof (addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+  fail_if ((p_srv->lfd = socket (AF_INET, SOCK_STREAM, 0)) < 0);
+  fail_if (0 != bind (p_srv->lfd, (struct sockaddr *) &addr, sizeof (addr)));
+  fail_if (0 != listen (p_srv->lfd, 8));
+  fail_if (0 != getsockname (p_srv->lfd, (struct sockaddr *) &addr, &len));
+  p_srv->port = ntohs (addr.sin_port);
+  fail_if (!(p_srv->p_body = malloc (URLTRANS_TEST_BODY_SIZE)));
+  memset (p_srv->p_body, 'x', URLTRANS_TEST_BODY_SIZE);
+  fail_if (0 != pthread_create (&p_srv->thread, NULL,
+                                urltrans_test_server_thread, p_srv));
+}
+
+static void
+urltrans_test_server_stop (urltrans_test_server_t * p_srv)
+{
+  __sync_fetch_and_add (&p_srv->stop, 1);
+  fail_if (0 != pthread_join (p_srv->thread, NULL));
+  close (p_srv->lfd);
+  free (p_srv->p_body);
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_init (void * ap_obj, tiz_event_io_t ** app_ev_io, int a_fd,
+                       tiz_event_io_event_t a_event, bool only_once)
+{
+  urltrans_test_ctx_t * p_ctx = ap_obj;
+  p_ctx->io_fd = a_fd;
+  p_ctx->io_ev = a_event;
+  *app_ev_io = (tiz_event_io_t *) &(p_ctx->io_obj);
+  return OMX_ErrorNone;
+}
+
+static void
+urltrans_test_io_destroy (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  urltrans_test_ctx_t * p_ctx = ap_obj;
+  if (ap_ev_io)
+    {
+      p_ctx->io_active = false;
+    }
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_start (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((urltrans_test_ctx_t *) ap_obj)->io_active = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_io_stop (void * ap_obj, tiz_event_io_t * ap_ev_io)
+{
+  ((urltrans_test_ctx_t *) ap_obj)->io_active = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_init (void * ap_obj, tiz_event_timer_t ** app_ev_timer)
+{
+  urltrans_test_ctx_t * p_ctx = ap_obj;
+  fail_if (p_ctx->ntimers >= 4);
+  *app_ev_timer = (tiz_event_timer_t *) &(p_ctx->timers[p_ctx->ntimers++]);
+  return OMX_ErrorNone;
+}
+
+static void
+urltrans_test_timer_destroy (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_start (void * ap_obj, tiz_event_timer_t * ap_ev_timer,
+                           const double a_after, const double a_repeat)
+{
+  *((bool *) ap_ev_timer) = true;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_stop (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  *((bool *) ap_ev_timer) = false;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+urltrans_test_timer_restart (void * ap_obj, tiz_event_timer_t * ap_ev_timer)
+{
+  *((bool *) ap_ev_timer) = true;
+  return OMX_ErrorNone;
+}
+
+static void
+urltrans_test_buffer_filled (OMX_BUFFERHEADERTYPE * ap_hdr, OMX_PTR ap_arg)
+{
+  urltrans_test_ctx_t * p_ctx = ap_arg;
+  p_ctx->received += ap_hdr->nFilledLen;
+  ap_hdr->nFilledLen = 0;
+}
+
+static OMX_BUFFERHEADERTYPE *
+urltrans_test_buffer_emptied (OMX_PTR ap_arg)
+{
+  return &(((urltrans_test_ctx_t *) ap_arg)->hdr);
+}
+
+static void
+urltrans_test_header_available (OMX_PTR ap_arg, const void * ap_ptr,
+                                const size_t a_nbytes)
+{
+}
+
+static bool
+urltrans_test_data_available (OMX_PTR ap_arg, const void * ap_ptr,
+                              const size_t a_nbytes)
+{
+  return false;
+}
+
+static bool
+urltrans_test_connection_lost (OMX_PTR ap_arg)
+{
+  ((urltrans_test_ctx_t *) ap_arg)->done = true;
+  return false;
+}
+
+static void
+urltrans_test_set_uri (OMX_PARAM_CONTENTURITYPE * ap_uri,
+                       const urltrans_test_server_t * ap_srv,
+                       const char * ap_path)
+{
+  snprintf ((char *) ap_uri->contentURI, PATH_MAX, "http://127.0.0.1:%d%s",
+            ap_srv->port, ap_path);
+}
+
+static void
+urltrans_test_init (urltrans_test_ctx_t * ap_ctx,
+                    OMX_PARAM_CONTENTURITYPE * ap_uri)
+{
+  const tiz_urltrans_buffer_cbacks_t buffer_cbacks
+    = {urltrans_test_buffer_filled, urltrans_test_buffer_emptied};
+  const tiz_urltrans_info_cbacks_t info_cbacks
+    = {urltrans_test_header_available, urltrans_test_data_available,
+       urltrans_test_connection_lost};
+  const tiz_urltrans_event_io_cbacks_t io_cbacks
+    = {urltrans_test_io_init, urltrans_test_io_destroy, urltrans_test_io_start,
+       urltrans_test_io_stop};
+  const tiz_urltrans_event_timer_cbacks_t timer_cbacks
+    = {urltrans_test_timer_init, urltrans_test_timer_destroy,
+       urltrans_test_timer_start, urltrans_test_timer_stop,
+       urltrans_test_timer_restart};
+
+  memset (ap_ctx, 0, sizeof (*ap_ctx));
+  ap_ctx->io_fd = -1;
+  ap_ctx->hdr.pBuffer = ap_ctx->data;
+  ap_ctx->hdr.nAllocLen = sizeof (ap_ctx->data);
+  fail_if (OMX_ErrorNone
+           != tiz_urltrans_init (&(ap_ctx->p_trans), ap_ctx, ap_uri,
+                                 (OMX_STRING) "OMX.Aratelia.check.urltrans",
+                                 URLTRANS_TEST_BODY_SIZE, 1., buffer_cbacks,
+                                 info_cbacks, io_cbacks, timer_cbacks));
+  tiz_urltrans_set_internal_buffer_size (ap_ctx->p_trans, 4096);
+}
+
+/* Runs one transfer to completion, and returns the number of body bytes
+   received */
+static size_t
+urltrans_test_run (urltrans_test_ctx_t * ap_ctx)
+{
+  int i = 0;
+
+  ap_ctx->done = false;
+  ap_ctx->received = 0;
+  fail_if (OMX_ErrorNone != tiz_urltrans_start (ap_ctx->p_trans));
+
+  for (i = 0; i < 2000 && !ap_ctx->done; ++i)
+    {
+      struct pollfd pfd = {ap_ctx->io_fd, 0, 0};
+      int t = 0;
+      pfd.events = (TIZ_EVENT_WRITE == ap_ctx->io_ev ? POLLOUT : POLLIN);
+      if (ap_ctx->io_active && 1 == poll (&pfd, 1, 5))
+        {
+          /* The watchers are one-shot */
+          ap_ctx->io_active = false;
+          fail_if (OMX_ErrorNone
+                   != tiz_urltrans_on_io_ready (
+                        ap_ctx->p_trans, (tiz_event_io_t *) &(ap_ctx->io_obj),
+                        ap_ctx->io_fd, ap_ctx->io_ev));
+          continue;
+        }
+      for (t = 0; t < ap_ctx->ntimers && !ap_ctx->done; ++t)
+        {
+          if (ap_ctx->timers[t])
+            {
+              ap_ctx->timers[t] = false;
+              fail_if (OMX_ErrorNone
+                       != tiz_urltrans_on_timer_ready (
+                            ap_ctx->p_trans,
+                            (tiz_event_timer_t *) &(ap_ctx->timers[t])));
+            }
+        }
+    }
+
+  fail_if (!ap_ctx->done);
+  return ap_ctx->received;
+}
+
+START_TEST (test_urltrans_connection_reuse)
+{
+  urltrans_test_server_t srv;
+  urltrans_test_ctx_t ctx;
+  OMX_PARAM_CONTENTURITYPE * p_uri = NULL;
+
+  urltrans_test_server_start (&srv);
+  fail_if (!(p_uri = calloc (1, sizeof (OMX_PARAM_CONTENTURITYPE) + PATH_MAX)));
+
+  /* First track */
+  urltrans_test_set_uri (p_uri, &srv, "/track1.mp3");
+  urltrans_test_init (&ctx, p_uri);
+  fail_if (URLTRANS_TEST_BODY_SIZE != urltrans_test_run (&ctx));
+
+  /* Next track, on the same transfer object */
+  urltrans_test_set_uri (p_uri, &srv, "/track2.mp3");
+  tiz_urltrans_set_uri (ctx.p_trans, p_uri);
+  fail_if (URLTRANS_TEST_BODY_SIZE != urltrans_test_run (&ctx));
+  tiz_urltrans_destroy (ctx.p_trans);
+
+  /* Next track, on a new transfer object, as after a playlist change */
+  urltrans_test_set_uri (p_uri, &srv, "/track3.mp3");
+  urltrans_test_init (&ctx, p_uri);
+  fail_if (URLTRANS_TEST_BODY_SIZE != urltrans_test_run (&ctx));
+  tiz_urltrans_destroy (ctx.p_trans);
+
+  /* All the tracks came through the same connection */
+  fail_if (3 != __sync_fetch_and_add (&srv.nrequests, 0));
+  fail_if (1 != __sync_fetch_and_add (&srv.naccepted, 0));
+
+  urltrans_test_server_stop (&srv);
+  free (p_uri);
+}
+END_TEST
+
+/* Local Variables: */
+/* c-default-style: gnu */
+/* fill-column: 79 */
+/* indent-tabs-mode: nil */
+/* compile-command: "make check" */
+/* End: */
@@ -51,7 +51,8 @@ graph::decoder::decoder (const std::string &graph_name)
   : graph::graph (graph_name),
     fsm_ (new fsm (boost::msm::back::states_
                    << tiz::graph::fsm::configuring (&p_ops_)
-                   << tiz::graph::fsm::skipping (&p_ops_),
+                   << tiz::graph::fsm::skipping (&p_ops_)
+                   << tiz::graph::fsm::gapless_skipping (&p_ops_),
                    &p_ops_))
 {
 }
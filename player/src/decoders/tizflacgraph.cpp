@@ -119,3 +119,11 @@ void graph::flacdecops::do_configure ()
           boost::bind (&tiz::probe::get_pcm_codec_info, probe_ptr_, _1)),
       "Unable to set OMX_IndexParamAudioPcm");
 }
+
+bool graph::flacdecops::is_gapless_capable () const
+{
+  // FLAC streams carry no encoder delay or padding, and the decoder resets
+  // its stream when its input port is re-enabled, so the file reader can be
+  // given the next track without stopping the rest of the graph.
+  return true;
+}
@@ -131,6 +131,14 @@ void graph::mp3decops::do_configure ()
   }
 }
 
+bool graph::mp3decops::is_gapless_capable () const
+{
+  // The decoder trims the encoder delay and padding found in the LAME tag, and
+  // restarts its stream when its input port is re-enabled, so the file reader
+  // can be given the next track without stopping the rest of the graph.
+  return true;
+}
+
 void graph::mp3decops::get_pcm_codec_info (OMX_AUDIO_PARAM_PCMMODETYPE &pcmtype)
 {
   OMX_U32 dec_port_id = 1;
@@ -112,3 +112,12 @@ void graph::mpegdecops::do_configure ()
           boost::bind (&tiz::probe::get_pcm_codec_info, probe_ptr_, _1)),
       "Unable to set OMX_IndexParamAudioPcm");
 }
+
+bool graph::mpegdecops::is_gapless_capable () const
+{
+  // mpg123 skips the encoder delay and padding itself (gapless decoding is
+  // on by default), and the decoder reopens its feed when its input port is
+  // re-enabled, so the file reader can be given the next track without
+  // stopping the rest of the graph.
+  return true;
+}
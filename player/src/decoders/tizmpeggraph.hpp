@@ -59,6 +59,9 @@ namespace tiz
       bool is_disabled_evt_required () const;
       void do_configure ();
 
+    protected:
+      bool is_gapless_capable () const;
+
     protected:
       bool need_port_settings_changed_evt_;
     };
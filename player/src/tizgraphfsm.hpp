@@ -73,6 +73,7 @@ namespace tiz
                                                "configuring",
                                                "executing",
                                                "skipping",
+                                               "gapless_skipping",
                                                "exe2pause",
                                                "pause",
                                                "pause2exe",
@@ -274,6 +275,93 @@ namespace tiz
       // typedef boost::msm::back::state_machine<skipping_, boost::msm::back::mpl_graph_fsm_check> skipping;
       typedef boost::msm::back::state_machine<skipping_> skipping;
 
+      /* 'gapless_skipping' is a submachine */
+      struct gapless_skipping_ : public boost::msm::front::state_machine_def<gapless_skipping_>
+      {
+        // no need for exception handling
+        typedef int no_exception_thrown;
+
+        // data members
+        ops ** pp_ops_;
+
+        gapless_skipping_()
+          :
+          pp_ops_(NULL)
+        {}
+        gapless_skipping_(ops **pp_ops)
+          :
+          pp_ops_(pp_ops)
+        {
+          assert (pp_ops);
+        }
+
+        // submachine states
+        struct gapless_initial : public boost::msm::front::state<>
+        {
+          template <class Event,class FSM>
+          void on_entry(Event const & evt, FSM & fsm) {G_FSM_LOG();}
+          template <class Event,class FSM>
+          void on_exit(Event const & evt, FSM & fsm) {G_FSM_LOG();}
+        };
+
+        struct probing : public boost::msm::front::state<>
+        {
+          template <class Event,class FSM>
+          void on_entry(Event const & evt, FSM & fsm) {G_FSM_LOG();}
+          template <class Event,class FSM>
+          void on_exit(Event const & evt, FSM & fsm) {G_FSM_LOG();}
+        };
+
+        struct gapless_exit : public boost::msm::front::exit_pseudo_state<skipped_evt>
+        {
+          template <class Event,class FSM>
+          void on_entry(Event const & evt, FSM & fsm) {G_FSM_LOG();}
+        };
+
+        // the initial state. Must be defined
+        typedef gapless_initial initial_state;
+
+        // transition actions
+
+        // guard conditions
+
+        // Transition table for gapless_skipping: only the source component is
+        // taken back to Loaded to be given the next uri; the decoder and the
+        // renderer stay in Executing.
+        struct transition_table : boost::mpl::vector<
+          //                       Start                 Event                      Next                 Action                                 Guard
+          //    +-----------------+----------------------+--------------------------+--------------------+--------------------------------------+--------------------------------+
+          boost::msm::front::Row < gapless_initial       , boost::msm::front::none  , disabling_tunnel   , do_disable_tunnel<0>                                                   >,
+          boost::msm::front::Row < disabling_tunnel      , omx_port_disabled_evt    , exe2idle           , do_exe2idle_comp<0>                  , is_port_disabling_complete      >,
+          boost::msm::front::Row < exe2idle              , omx_trans_evt            , idle2loaded        , do_idle2loaded_comp<0>               , is_trans_complete               >,
+          boost::msm::front::Row < idle2loaded           , omx_trans_evt            , probing            , boost::msm::front::ActionSequence_<
+                                                                                                             boost::mpl::vector<
+                                                                                                               do_skip,
+                                                                                                               do_probe > >                     , is_trans_complete               >,
+          boost::msm::front::Row < probing               , boost::msm::front::none  , config2idle        , boost::msm::front::ActionSequence_<
+                                                                                                             boost::mpl::vector<
+                                                                                                               do_configure_comp<0>,
+                                                                                                               do_loaded2idle_comp<0> > >       , is_probing_result_ok            >,
+          boost::msm::front::Row < probing               , boost::msm::front::none  , gapless_exit       , boost::msm::front::none              , boost::msm::front::euml::Not_<
+                                                                                                                                                    is_probing_result_ok >        >,
+          boost::msm::front::Row < config2idle           , omx_trans_evt            , idle2exe           , do_idle2exe_comp<0>                  , is_trans_complete               >,
+          boost::msm::front::Row < idle2exe              , omx_trans_evt            , enabling_tunnel    , do_enable_tunnel<0>                  , is_trans_complete               >,
+          boost::msm::front::Row < enabling_tunnel       , omx_port_enabled_evt     , gapless_exit       , boost::msm::front::none              , is_port_enabling_complete       >
+          //    +-----------------+----------------------+--------------------------+--------------------+--------------------------------------+--------------------------------+
+          > {};
+
+        // Replaces the default no-transition response.
+        template <class FSM,class Event>
+        void no_transition(Event const& e, FSM&,int state)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "no transition from state %d on event %s",
+                   state, typeid(e).name());
+        }
+
+      };
+      // typedef boost::msm::back::state_machine<gapless_skipping_, boost::msm::back::mpl_graph_fsm_check> gapless_skipping;
+      typedef boost::msm::back::state_machine<gapless_skipping_> gapless_skipping;
+
       // The initial state of the SM. Must be defined
       typedef boost::mpl::vector<inited, AllOk> initial_state;
 
@@ -305,7 +393,8 @@ namespace tiz
                                   ::conf_exit>, configured_evt , executing               , boost::msm::front::ActionSequence_<
                                                                                              boost::mpl::vector<
                                                                                                do_retrieve_metadata,
-                                                                                               do_ack_execd> >                            >,
+                                                                                               do_ack_execd,
+                                                                                               do_preroll_next> >                         >,
         boost::msm::front::Row < configuring
                                  ::exit_pt
                                  <configuring_
@@ -328,7 +417,29 @@ namespace tiz
         boost::msm::front::Row < executing   , unload_evt      , exe2idle                , do_exe2idle                                >,
         boost::msm::front::Row < executing   , omx_err_evt     , skipping                , boost::msm::front::none                        >,
         boost::msm::front::Row < executing   , omx_err_evt     , skipping                , do_record_fatal_error   , is_fatal_error       >,
-        boost::msm::front::Row < executing   , omx_eos_evt     , skipping                , boost::msm::front::none , is_last_eos          >,
+        boost::msm::front::Row < executing   , omx_eos_evt     , skipping                , boost::msm::front::none , bmf::euml::And_<
+                                                                                                                       is_last_eos,
+                                                                                                                       bmf::euml::And_<
+                                                                                                                         bmf::euml::Not_<
+                                                                                                                           is_tail_eos>,
+                                                                                                                         bmf::euml::Not_<
+                                                                                                                           is_gapless_transition> > > >,
+        boost::msm::front::Row < executing   , omx_eos_evt     , gapless_skipping        , boost::msm::front::none , bmf::euml::And_<
+                                                                                                                       is_last_eos,
+                                                                                                                       bmf::euml::And_<
+                                                                                                                         bmf::euml::Not_<
+                                                                                                                           is_tail_eos>,
+                                                                                                                         is_gapless_transition> > >,
+        // The decoder has delivered its last samples: restart the source now,
+        // while the renderer is still playing them out.
+        boost::msm::front::Row < executing   , omx_eos_evt     , gapless_skipping        , do_expect_tail_eos      , bmf::euml::And_<
+                                                                                                                       is_penultimate_eos,
+                                                                                                                       is_gapless_transition> >,
+        // The renderer has played out a track whose successor is already
+        // playing.
+        boost::msm::front::Row < executing   , omx_eos_evt     , boost::msm::front::none , do_consume_tail_eos     , bmf::euml::And_<
+                                                                                                                       is_last_eos,
+                                                                                                                       is_tail_eos> >,
         //    +------------------------------+-----------------+-------------------------+-------------------------+----------------------+
         boost::msm::front::Row < skipping
                                  ::exit_pt
@@ -352,6 +463,28 @@ namespace tiz
                                   ::skip_exit>, skipped_evt    , configuring             , boost::msm::front::none , boost::msm::front::euml::Not_<
                                                                                                                        is_end_of_play>   >,
         //    +------------------------------+-----------------+-------------------------+-------------------------+----------------------+
+        boost::msm::front::Row < gapless_skipping
+                                 , omx_eos_evt , boost::msm::front::none , do_consume_tail_eos     , bmf::euml::And_<
+                                                                                                                       is_last_eos,
+                                                                                                                       is_tail_eos> >,
+        boost::msm::front::Row < gapless_skipping
+                                 ::exit_pt
+                                 <gapless_skipping_
+                                  ::gapless_exit>, skipped_evt , unloaded                , boost::msm::front::ActionSequence_<
+                                                                                             boost::mpl::vector<
+                                                                                               do_error,
+                                                                                               do_tear_down_tunnels,
+                                                                                               do_destroy_graph> > , is_internal_error    >,
+        boost::msm::front::Row < gapless_skipping
+                                 ::exit_pt
+                                 <gapless_skipping_
+                                  ::gapless_exit>, skipped_evt , executing               , boost::msm::front::ActionSequence_<
+                                                                                             boost::mpl::vector<
+                                                                                               do_retrieve_metadata,
+                                                                                               do_ack_execd,
+                                                                                               do_preroll_next> > , boost::msm::front::euml::Not_<
+                                                                                                                       is_internal_error> >,
+        //    +------------------------------+-----------------+-------------------------+-------------------------+----------------------+
         boost::msm::front::Row < exe2pause   , omx_trans_evt   , pause                   , do_ack_paused           , is_trans_complete    >,
         //    +------------------------------+-----------------+-------------------------+-------------------------+----------------------+
         boost::msm::front::Row < pause       , execute_evt     , pause2exe               , do_pause2exe                               >,
@@ -220,6 +220,36 @@ namespace tiz
       }
     };
 
+    struct is_penultimate_eos
+    {
+      template < class EVT, class FSM, class SourceState, class TargetState >
+      bool operator()(EVT const& evt, FSM& fsm, SourceState&, TargetState&)
+      {
+        bool rc = false;
+        if (fsm.pp_ops_ && *(fsm.pp_ops_))
+        {
+          rc = (*(fsm.pp_ops_))->is_penultimate_component (evt.handle_);
+        }
+        G_GUARD_LOG (rc);
+        return rc;
+      }
+    };
+
+    struct is_tail_eos
+    {
+      template < class EVT, class FSM, class SourceState, class TargetState >
+      bool operator()(EVT const& evt, FSM& fsm, SourceState&, TargetState&)
+      {
+        bool rc = false;
+        if (fsm.pp_ops_ && *(fsm.pp_ops_))
+        {
+          rc = (*(fsm.pp_ops_))->is_tail_eos ();
+        }
+        G_GUARD_LOG (rc);
+        return rc;
+      }
+    };
+
     struct is_internal_error
     {
       template < class EVT, class FSM, class SourceState, class TargetState >
@@ -268,6 +298,21 @@ namespace tiz
       }
     };
 
+    struct is_gapless_transition
+    {
+      template < class EVT, class FSM, class SourceState, class TargetState >
+      bool operator()(EVT const& evt, FSM& fsm, SourceState&, TargetState&)
+      {
+        bool rc = false;
+        if (fsm.pp_ops_ && *(fsm.pp_ops_))
+        {
+          rc = (*(fsm.pp_ops_))->is_gapless_transition ();
+        }
+        G_GUARD_LOG (rc);
+        return rc;
+      }
+    };
+
     struct is_probing_result_ok
     {
       template < class EVT, class FSM, class SourceState, class TargetState >
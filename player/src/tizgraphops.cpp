@@ -30,8 +30,10 @@
 #endif
 
 #include <assert.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <algorithm>
 
@@ -76,6 +78,8 @@ graph::ops::ops (graph *p_graph, const omx_comp_name_lst_t &comp_lst,
     destination_state_ (OMX_StateMax),
     metadata_ (),
     volume_ (80),
+    gapless_next_ (false),
+    pending_tail_eos_ (0),
     error_code_ (OMX_ErrorNone),
     error_msg_ ()
 {
@@ -217,7 +221,14 @@ void graph::ops::do_configure ()
 
 void graph::ops::do_configure_comp (const int comp_id)
 {
-  // This is a no-op in the base class.
+  // In gapless graphs, the source is given the next track's uri while the
+  // rest of the graph keeps running. Otherwise, this is a no-op.
+  if (last_op_succeeded () && 0 == comp_id && is_gapless_capable ())
+  {
+    G_OPS_BAIL_IF_ERROR (
+        util::set_content_uri (handles_[0], probe_ptr_->get_uri ()),
+        "Unable to set OMX_IndexParamContentURI");
+  }
 }
 
 void graph::ops::do_loaded2idle ()
@@ -383,6 +394,8 @@ void graph::ops::do_pause2idle ()
 
 void graph::ops::do_exe2idle ()
 {
+  // The renderer is stopping; no end of stream is pending from it anymore
+  pending_tail_eos_ = 0;
   if (last_op_succeeded ())
   {
     G_OPS_BAIL_IF_ERROR (
@@ -398,7 +411,6 @@ void graph::ops::do_exe2idle_comp (const int comp_id)
   {
     G_OPS_BAIL_IF_ERROR (transition_comp (comp_id, OMX_StateIdle),
                          "Unable to transition from Exe->Idle");
-    record_expected_transitions (OMX_StateIdle);
   }
 }
 
@@ -419,7 +431,6 @@ void graph::ops::do_idle2loaded_comp (const int comp_id)
   {
     G_OPS_BAIL_IF_ERROR (transition_comp (comp_id, OMX_StateLoaded),
                          "Unable to transition from Idle->Loaded");
-    record_expected_transitions (OMX_StateLoaded);
   }
 }
 
@@ -580,6 +591,75 @@ void graph::ops::do_retrieve_metadata ()
   // To be overriden in child classes when needed.
 }
 
+/**
+ * Default implementation of do_preroll_next () operation. When gapless
+ * playback is enabled, it probes the track that follows the current one and
+ * records whether the transition to it can be done by restarting the source
+ * only, i.e. the decoder and renderer keep running because the coding and pcm
+ * format are the same. The file is also read ahead into the page cache, so
+ * that the restarted source does not stall on the first read.
+ */
+void graph::ops::do_preroll_next ()
+{
+  gapless_next_ = false;
+
+  if (!last_op_succeeded () || !probe_ptr_ || !is_gapless_capable ()
+      || !util::is_gapless_enabled ())
+  {
+    return;
+  }
+
+  std::string next_uri;
+  assert (playlist_);
+  if (!playlist_->peek_uri (SKIP_DEFAULT_VALUE, next_uri))
+  {
+    return;
+  }
+
+  // This is normally just a lookup in the probe cache
+  const bool quiet_probing = true;
+  tiz::probe next_probe (next_uri, quiet_probing);
+  OMX_AUDIO_PARAM_PCMMODETYPE cur_pcmtype;
+  OMX_AUDIO_PARAM_PCMMODETYPE next_pcmtype;
+  probe_ptr_->get_pcm_codec_info (cur_pcmtype);
+  next_probe.get_pcm_codec_info (next_pcmtype);
+
+  gapless_next_
+      = (next_probe.get_omx_domain () == probe_ptr_->get_omx_domain ()
+         && next_probe.get_audio_coding_type ()
+                == probe_ptr_->get_audio_coding_type ()
+         && next_pcmtype.nSamplingRate == cur_pcmtype.nSamplingRate
+         && next_pcmtype.nChannels == cur_pcmtype.nChannels
+         && next_pcmtype.nBitPerSample == cur_pcmtype.nBitPerSample);
+
+  if (gapless_next_)
+  {
+    const int fd = open (next_uri.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0)
+    {
+      (void)posix_fadvise (fd, 0, 0, POSIX_FADV_WILLNEED);
+      close (fd);
+    }
+  }
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "next uri [%s] gapless [%s]", next_uri.c_str (),
+           gapless_next_ ? "YES" : "NO");
+}
+
+void graph::ops::do_expect_tail_eos ()
+{
+  // The source has been restarted before the renderer played out the
+  // previous track; the end of stream the renderer reports for it must not be
+  // taken for the end of the new track.
+  ++pending_tail_eos_;
+}
+
+void graph::ops::do_consume_tail_eos ()
+{
+  assert (pending_tail_eos_ > 0);
+  --pending_tail_eos_;
+}
+
 void graph::ops::do_reset_internal_error ()
 {
   error_code_ = OMX_ErrorNone;
@@ -609,6 +689,18 @@ bool graph::ops::is_port_settings_evt_required () const
   return false;
 }
 
+bool graph::ops::is_gapless_transition () const
+{
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "is_gapless_transition [%s]...",
+           gapless_next_ ? "YES" : "NO");
+  return gapless_next_;
+}
+
+bool graph::ops::is_tail_eos () const
+{
+  return pending_tail_eos_ > 0;
+}
+
 bool graph::ops::is_disabled_evt_required () const
 {
   // To be overriden in child classes when needed.
@@ -669,6 +761,16 @@ bool graph::ops::is_first_component (const OMX_HANDLETYPE handle) const
   return rc;
 }
 
+bool graph::ops::is_penultimate_component (const OMX_HANDLETYPE handle) const
+{
+  bool rc = false;
+  if (handles_.size () > 1)
+  {
+    rc = (handles_[handles_.size () - 2] == handle);
+  }
+  return rc;
+}
+
 bool graph::ops::is_trans_complete (const OMX_HANDLETYPE handle,
                                     const OMX_STATETYPE to_state)
 {
@@ -954,6 +1056,13 @@ bool graph::ops::probe_stream_hook ()
   return true;
 }
 
+bool graph::ops::is_gapless_capable () const
+{
+  // Default implementation. To be overriden by the graphs that can replace
+  // the source's stream while the rest of the graph is executing.
+  return false;
+}
+
 OMX_ERRORTYPE
 graph::ops::transition_source (const OMX_STATETYPE to_state)
 {
@@ -1004,8 +1113,39 @@ OMX_ERRORTYPE
 graph::ops::switch_tunnel (const int tunnel_id,
                                const OMX_COMMANDTYPE to_disabled_or_enabled)
 {
-  // Default implementation. To be overriden by derived classes.
-  return OMX_ErrorNone;
+  // Default implementation. Gapless graphs switch the source <-> decoder
+  // tunnel to restart the source. Otherwise, to be overriden by derived
+  // classes.
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  if (0 == tunnel_id && is_gapless_capable ())
+  {
+    assert (to_disabled_or_enabled == OMX_CommandPortDisable
+            || to_disabled_or_enabled == OMX_CommandPortEnable);
+
+    if (to_disabled_or_enabled == OMX_CommandPortDisable)
+    {
+      rc = tiz::graph::util::disable_tunnel (handles_, tunnel_id);
+    }
+    else
+    {
+      rc = tiz::graph::util::enable_tunnel (handles_, tunnel_id);
+    }
+
+    if (OMX_ErrorNone == rc)
+    {
+      clear_expected_port_transitions ();
+      const int source_index = 0;
+      const int source_output_port = 0;
+      add_expected_port_transition (handles_[source_index], source_output_port,
+                                    to_disabled_or_enabled);
+      const int decoder_index = 1;
+      const int decoder_input_port = 0;
+      add_expected_port_transition (handles_[decoder_index], decoder_input_port,
+                                    to_disabled_or_enabled);
+    }
+  }
+  return rc;
 }
 
 OMX_ERRORTYPE
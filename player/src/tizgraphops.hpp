@@ -132,12 +132,17 @@ namespace tiz
       virtual void do_record_destination (
           const OMX_STATETYPE destination_state);
       virtual void do_retrieve_metadata ();
+      virtual void do_preroll_next ();
+      virtual void do_expect_tail_eos ();
+      virtual void do_consume_tail_eos ();
       virtual void do_reset_internal_error ();
       virtual void do_record_fatal_error (const OMX_HANDLETYPE handle,
                                           const OMX_ERRORTYPE error,
                                           const OMX_U32 port);
 
       virtual bool is_port_settings_evt_required () const;
+      virtual bool is_gapless_transition () const;
+      virtual bool is_tail_eos () const;
       virtual bool is_disabled_evt_required () const;
       virtual bool is_fatal_error (const OMX_ERRORTYPE error) const;
       virtual bool is_tunnel_altered (const int tunnel_id,
@@ -151,6 +156,7 @@ namespace tiz
     public:
       bool is_last_component (const OMX_HANDLETYPE handle) const;
       bool is_first_component (const OMX_HANDLETYPE handle) const;
+      bool is_penultimate_component (const OMX_HANDLETYPE handle) const;
       bool is_trans_complete (const OMX_HANDLETYPE handle,
                               const OMX_STATETYPE to_state);
       bool is_destination_state (const OMX_STATETYPE to_state);
@@ -194,6 +200,7 @@ namespace tiz
           stream_info_dump_func_t stream_info_dump_f, const bool quiet = false);
 
       virtual bool probe_stream_hook ();
+      virtual bool is_gapless_capable () const;
       virtual OMX_ERRORTYPE transition_source (const OMX_STATETYPE to_state);
       virtual OMX_ERRORTYPE transition_comp (const int comp_id,
                                              const OMX_STATETYPE to_state);
@@ -225,6 +232,8 @@ namespace tiz
       OMX_STATETYPE destination_state_;
       track_metadata_map_t metadata_;
       int volume_;
+      bool gapless_next_;
+      int pending_tail_eos_;
       OMX_ERRORTYPE error_code_;
       std::string error_msg_;
     };
@@ -846,3 +846,19 @@ bool graph::util::is_mpris_enabled ()
     }
   return is_enabled;
 }
+
+bool graph::util::is_gapless_enabled ()
+{
+  bool is_enabled = false;
+  const char *p_gapless_enabled = tiz_rcfile_get_value("tizonia", "gapless-playback");
+  if (p_gapless_enabled)
+    {
+      std::string gapless_enabled_str;
+      gapless_enabled_str.assign (p_gapless_enabled);
+      if (gapless_enabled_str.compare ("true") == 0)
+        {
+          is_enabled = true;
+        }
+    }
+  return is_enabled;
+}
@@ -190,6 +190,8 @@ namespace tiz
       static std::string get_default_pcm_renderer ();
 
       static bool is_mpris_enabled ();
+
+      static bool is_gapless_enabled ();
     };
   }  // namespace graph
 }  // namespace tiz
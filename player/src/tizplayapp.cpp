@@ -348,6 +348,9 @@ tiz::playapp::daemonize_if_requested () const
     signal (SIGTSTP, tizplay_sig_stp_hdlr);
     signal (SIGQUIT, tizplay_sig_term_hdlr);
   }
+
+  // Pick up changes to the config file while playing (not fatal)
+  (void)tiz_rcfile_enable_reload ();
   return OMX_ErrorNone;
 }
 
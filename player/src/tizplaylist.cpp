@@ -38,6 +38,7 @@
 
 #include <tizplatform.h>
 
+#include "tizprobecache.hpp"
 #include "tizplaylist.hpp"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -229,6 +230,10 @@ bool tiz::playlist::assemble_play_list (
       std::sort (uri_list.begin (), uri_list.end ());
     }
 
+    // Probe anything that is not in the cache yet while we are still
+    // starting up, so that the graphs don't have to do it on each track
+    tiz::probecache::instance ().prefill (uri_list);
+
     list_assembled = true;
   }
   catch (std::exception const &e)
@@ -250,26 +255,33 @@ end:
   return list_assembled;
 }
 
-void tiz::playlist::skip (const int jump)
+int tiz::playlist::skipped_index (const int jump) const
 {
   const int list_size = uri_list_.size ();
-  TIZ_LOG (TIZ_PRIORITY_TRACE,
-           "jump [%d] current_index_ [%d]"
-           " loop_playback [%s]",
-           jump, current_index_, loop_playback_ ? "YES" : "NO");
-  current_index_ += jump;
+  int index = current_index_ + jump;
 
   if (loop_playback ())
   {
-    if (current_index_ < 0)
+    if (index < 0)
     {
-      current_index_ = list_size - abs (current_index_);
+      index = list_size - abs (index);
     }
-    else if (current_index_ >= list_size)
+    else if (index >= list_size)
     {
-      current_index_ %= list_size;
+      index %= list_size;
     }
   }
+  return index;
+}
+
+void tiz::playlist::skip (const int jump)
+{
+  const int list_size = uri_list_.size ();
+  TIZ_LOG (TIZ_PRIORITY_TRACE,
+           "jump [%d] current_index_ [%d]"
+           " loop_playback [%s]",
+           jump, current_index_, loop_playback_ ? "YES" : "NO");
+  current_index_ = skipped_index (jump);
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "jump [%d] new index [%d]... [%s]", jump,
            current_index_, current_index_ < list_size && current_index_ >= 0
@@ -277,6 +289,18 @@ void tiz::playlist::skip (const int jump)
                                : "");
 }
 
+bool tiz::playlist::peek_uri (const int jump, std::string &uri) const
+{
+  const int list_size = uri_list_.size ();
+  const int index = skipped_index (jump);
+  if (index < 0 || index >= list_size)
+  {
+    return false;
+  }
+  uri.assign (uri_list_[index]);
+  return true;
+}
+
 const std::string &tiz::playlist::get_current_uri () const
 {
   const int list_size = uri_list_.size ();
@@ -57,6 +57,7 @@ namespace tiz
     void skip (const int jump);
     playlist obtain_next_sub_playlist (const list_direction_t up_or_down);
     const std::string & get_current_uri () const;
+    bool peek_uri (const int jump, std::string &uri) const;
     uri_lst_t get_sublist (const int from, const int to) const;
     const uri_lst_t &get_uri_list () const;
     int current_index () const;
@@ -84,6 +85,7 @@ namespace tiz
 
   private:
 
+    int skipped_index (const int jump) const;
     void scan_list ();
     int find_next_sub_list (const int index) const;
 
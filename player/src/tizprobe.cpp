@@ -37,6 +37,9 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <fileref.h>
+#include <tag.h>
+
 #include <ZenLib/Ztring.h>
 #include <MediaInfo/MediaInfo.h>
 #include <MediaInfo/MediaInfo_Const.h>
@@ -102,7 +105,6 @@ namespace  // unnamed
   }
 
   void obtain_stream_title_and_genre (MediaInfoLib::MediaInfo &mi,
-                                      const bool quiet,
                                       std::string &stream_title,
                                       std::string &stream_genre)
   {
@@ -111,8 +113,6 @@ namespace  // unnamed
     std::string title (mi_stream_general_info_to_std_string (mi, L"Track"));
     std::string album (mi_stream_general_info_to_std_string (mi, L"Album"));
     std::string genre (mi_stream_general_info_to_std_string (mi, L"Genre"));
-    std::string full_track_name (
-        mi_stream_general_info_to_std_string (mi, L"CompleteName"));
 
     stream_title.assign (artist);
     if (!album.empty ())
@@ -127,15 +127,6 @@ namespace  // unnamed
       stream_title.append (title);
     }
     stream_genre.assign (genre);
-
-    if (!quiet)
-    {
-      if (stream_title.empty ())
-      {
-        stream_title.assign (full_track_name);
-      }
-      boost::replace_all (stream_title, "_", " ");
-    }
   }
 
   OMX_AUDIO_CODINGTYPE obtain_codec_id (MediaInfoLib::MediaInfo &mi)
@@ -235,6 +226,11 @@ namespace  // unnamed
     }
     return container_format;
   }
+
+  std::string tag_to_std_string (const TagLib::String &str)
+  {
+    return str.stripWhiteSpace ().to8Bit ();
+  }
 }
 
 tiz::probe::probe (const std::string &uri, const bool quiet)
@@ -252,7 +248,8 @@ tiz::probe::probe (const std::string &uri, const bool quiet)
     vorbistype_ (),
     aactype_ (),
     vp8type_ (),
-    meta_file_ (uri.c_str ()),
+    info_ (),
+    probed_ (false),
     stream_title_ (),
     stream_genre_ (),
     stream_is_cbr_ (false)
@@ -405,78 +402,141 @@ tiz::probe::get_container_type ()
   return container_type_;
 }
 
-void tiz::probe::probe_stream ()
+void tiz::probe::obtain_info (const std::string &uri,
+                              probecache::entry &info)
 {
   MediaInfoLib::MediaInfo mi;
 
-  if (open_media (uri_, mi))
+  info = probecache::entry ();
+
+  if (open_media (uri, mi))
   {
-    OMX_U32 samplerate = 48000;
-    OMX_U32 bitrate = 0;
-    OMX_U32 nchannels = 2;
-    OMX_U32 bitdepth = 16;
-    OMX_ENDIANTYPE endianness = OMX_EndianLittle;
-    OMX_NUMERICALDATATYPE sign = OMX_NumericalDataSigned;
+    info.valid = true;
 
     // Get an idea of the container format
-    container_type_ = obtain_container_format (mi);
+    info.container = obtain_container_format (mi);
 
     // Get the codec type
-    const OMX_AUDIO_CODINGTYPE codec_id = obtain_codec_id (mi);
+    info.codec = obtain_codec_id (mi);
 
     // Get the stream title and genre
-    obtain_stream_title_and_genre (mi, quiet_, stream_title_, stream_genre_);
-
-    TIZ_PRINTF_DBG_RED ("uri [%s] codec_id [%0x]\n", uri_.c_str (), codec_id);
+    obtain_stream_title_and_genre (mi, info.stream_title, info.stream_genre);
 
     // Grab the sample rate, bitrate, num channels, and sample format (when
     // available), and cbr flag
-    obtain_stream_properties (mi, samplerate, bitrate, nchannels, bitdepth,
-                              endianness, sign, stream_is_cbr_);
+    obtain_stream_properties (mi, info.samplerate, info.bitrate,
+                              info.nchannels, info.bitdepth, info.endianness,
+                              info.sign, info.cbr);
 
-    if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingMP2)
-    {
-      set_mp2_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingMP3)
-    {
-      set_mp3_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingAAC)
-    {
-      set_aac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                          sign);
-    }
-    else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingFLAC)
-    {
-      set_flac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                           sign);
-    }
-    else if (codec_id == OMX_AUDIO_CodingVORBIS)
-    {
-      set_vorbis_codec_info (samplerate, bitrate, nchannels, bitdepth,
-                             endianness, sign);
-    }
-    else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingOPUS)
-    {
-      set_opus_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
-                           sign);
-    }
-    else if (is_pcm_codec (codec_id))
+    mi.Close ();
+  }
+
+  TagLib::FileRef meta_file (uri.c_str ());
+  if (!meta_file.isNull () && meta_file.tag ())
+  {
+    TagLib::Tag *tag = meta_file.tag ();
+    info.title = tag_to_std_string (tag->title ());
+    info.artist = tag_to_std_string (tag->artist ());
+    info.album = tag_to_std_string (tag->album ());
+    info.comment = tag_to_std_string (tag->comment ());
+    info.genre = tag_to_std_string (tag->genre ());
+    info.year = tag->year ();
+    info.track = tag->track ();
+  }
+
+  if (!meta_file.isNull () && meta_file.audioProperties ())
+  {
+    info.length = meta_file.audioProperties ()->length ();
+  }
+}
+
+void tiz::probe::probe_stream ()
+{
+  if (probed_)
+  {
+    return;
+  }
+
+  probed_ = true;
+  if (!probecache::instance ().lookup (uri_, info_))
+  {
+    obtain_info (uri_, info_);
+    probecache::instance ().store (uri_, info_);
+  }
+  apply_info ();
+}
+
+void tiz::probe::apply_info ()
+{
+  if (!info_.valid)
+  {
+    return;
+  }
+
+  const OMX_AUDIO_CODINGTYPE codec_id = info_.codec;
+  const OMX_U32 samplerate = info_.samplerate;
+  const OMX_U32 bitrate = info_.bitrate;
+  const OMX_U32 nchannels = info_.nchannels;
+  const OMX_U32 bitdepth = info_.bitdepth;
+  const OMX_ENDIANTYPE endianness = info_.endianness;
+  const OMX_NUMERICALDATATYPE sign = info_.sign;
+
+  container_type_ = info_.container;
+  stream_is_cbr_ = info_.cbr;
+  stream_title_ = info_.stream_title;
+  stream_genre_ = info_.stream_genre;
+
+  if (!quiet_)
+  {
+    if (stream_title_.empty ())
     {
-      domain_ = OMX_PortDomainAudio;
-      audio_coding_type_
-          = static_cast< OMX_AUDIO_CODINGTYPE >(OMX_AUDIO_CodingPCM);
-      pcmtype_.nSamplingRate = samplerate;
-      pcmtype_.nChannels = nchannels;
-      pcmtype_.nBitPerSample = bitdepth;
-      pcmtype_.eEndian = endianness;
-      pcmtype_.eNumData = sign;
+      stream_title_.assign (uri_);
     }
+    boost::replace_all (stream_title_, "_", " ");
+  }
 
-    mi.Close ();
+  TIZ_PRINTF_DBG_RED ("uri [%s] codec_id [%0x]\n", uri_.c_str (), codec_id);
+
+  if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingMP2)
+  {
+    set_mp2_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingMP3)
+  {
+    set_mp3_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingAAC)
+  {
+    set_aac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                        sign);
+  }
+  else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingFLAC)
+  {
+    set_flac_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                         sign);
+  }
+  else if (codec_id == OMX_AUDIO_CodingVORBIS)
+  {
+    set_vorbis_codec_info (samplerate, bitrate, nchannels, bitdepth,
+                           endianness, sign);
+  }
+  else if (codec_id == (OMX_AUDIO_CODINGTYPE)OMX_AUDIO_CodingOPUS)
+  {
+    set_opus_codec_info (samplerate, bitrate, nchannels, bitdepth, endianness,
+                         sign);
+  }
+  else if (is_pcm_codec (codec_id))
+  {
+    domain_ = OMX_PortDomainAudio;
+    audio_coding_type_
+        = static_cast< OMX_AUDIO_CODINGTYPE >(OMX_AUDIO_CodingPCM);
+    pcmtype_.nSamplingRate = samplerate;
+    pcmtype_.nChannels = nchannels;
+    pcmtype_.nBitPerSample = bitdepth;
+    pcmtype_.eEndian = endianness;
+    pcmtype_.eNumData = sign;
   }
 }
 
@@ -747,76 +807,58 @@ bool tiz::probe::is_cbr_stream ()
   return stream_is_cbr_;
 }
 
-std::string tiz::probe::retrieve_meta_data_str (
-    TagLib::String (TagLib::Tag::*TagFunction)() const) const
+std::string tiz::probe::title ()
 {
-  assert (TagFunction);
-  if (!meta_file_.isNull () && meta_file_.tag ())
-  {
-    TagLib::Tag *tag = meta_file_.tag ();
-    return (tag->*TagFunction)().stripWhiteSpace ().to8Bit ();
-  }
-  return std::string ();
+  probe_stream ();
+  return info_.title;
 }
 
-unsigned int tiz::probe::retrieve_meta_data_uint (
-    TagLib::uint (TagLib::Tag::*TagFunction)() const) const
+std::string tiz::probe::artist ()
 {
-  assert (TagFunction);
-  if (!meta_file_.isNull () && meta_file_.tag ())
-  {
-    TagLib::Tag *tag = meta_file_.tag ();
-    return (tag->*TagFunction)();
-  }
-  return 0;
-}
-
-std::string tiz::probe::title () const
-{
-  return retrieve_meta_data_str (&TagLib::Tag::title);
+  probe_stream ();
+  return info_.artist;
 }
 
-std::string tiz::probe::artist () const
+std::string tiz::probe::album ()
 {
-  return retrieve_meta_data_str (&TagLib::Tag::artist);
+  probe_stream ();
+  return info_.album;
 }
 
-std::string tiz::probe::album () const
+std::string tiz::probe::year ()
 {
-  return retrieve_meta_data_str (&TagLib::Tag::album);
+  probe_stream ();
+  return boost::lexical_cast< std::string >(info_.year);
 }
 
-std::string tiz::probe::year () const
+std::string tiz::probe::comment ()
 {
-  return boost::lexical_cast< std::string >(
-      retrieve_meta_data_uint (&TagLib::Tag::year));
+  probe_stream ();
+  return info_.comment;
 }
 
-std::string tiz::probe::comment () const
+std::string tiz::probe::track ()
 {
-  return retrieve_meta_data_str (&TagLib::Tag::comment);
+  probe_stream ();
+  return boost::lexical_cast< std::string >(info_.track);
 }
 
-std::string tiz::probe::track () const
+std::string tiz::probe::genre ()
 {
-  return boost::lexical_cast< std::string >(
-      retrieve_meta_data_uint (&TagLib::Tag::track));
+  probe_stream ();
+  return info_.genre;
 }
 
-std::string tiz::probe::genre () const
-{
-  return retrieve_meta_data_str (&TagLib::Tag::genre);
-}
-
-std::string tiz::probe::stream_length () const
+std::string tiz::probe::stream_length ()
 {
   std::string length_str;
 
-  if (!meta_file_.isNull () && meta_file_.audioProperties ())
+  probe_stream ();
+
+  if (info_.length >= 0)
   {
-    TagLib::AudioProperties *properties = meta_file_.audioProperties ();
-    int seconds = properties->length () % 60;
-    int minutes = (properties->length () - seconds) / 60;
+    int seconds = info_.length % 60;
+    int minutes = (info_.length - seconds) / 60;
     int hours = 0;
     if (minutes >= 60)
     {
@@ -32,15 +32,14 @@
 #include <string>
 #include <boost/shared_ptr.hpp>
 
-#include <fileref.h>
-#include <tag.h>
-
 #include <OMX_Core.h>
 #include <OMX_Component.h>
 #include <OMX_Audio.h>
 #include <OMX_Video.h>
 #include <OMX_TizoniaExt.h>
 
+#include "tizprobecache.hpp"
+
 namespace tiz
 {
   class probe
@@ -66,13 +65,13 @@ namespace tiz
     void get_vp8_codec_info (OMX_VIDEO_PARAM_VP8TYPE &vp8type);
 
     /* Meta-data information */
-    std::string title () const;
-    std::string artist () const;
-    std::string album () const;
-    std::string year () const;
-    std::string comment () const;
-    std::string track () const;
-    std::string genre () const;
+    std::string title ();
+    std::string artist ();
+    std::string album ();
+    std::string year ();
+    std::string comment ();
+    std::string track ();
+    std::string genre ();
 
     /* Meta-data information. These methods are currently used by the http
        streaming use case. */
@@ -81,7 +80,7 @@ namespace tiz
     bool is_cbr_stream ();
 
     /* Duration */
-    std::string stream_length () const;
+    std::string stream_length ();
 
     void dump_pcm_info ();
     void dump_mp3_info ();
@@ -90,8 +89,13 @@ namespace tiz
     void dump_aac_and_pcm_info ();
     void dump_stream_metadata ();
 
+    /* Extracts from a local file everything the probe needs (this is what
+       ends up in the probe cache). */
+    static void obtain_info (const std::string &uri, probecache::entry &info);
+
   private:
     void probe_stream ();
+    void apply_info ();
     void set_mp2_codec_info (const OMX_U32 samplerate, const OMX_U32 bitrate,
                              const OMX_U32 nchannels, const OMX_U32 bitdepth,
                              const OMX_ENDIANTYPE endianness,
@@ -116,10 +120,6 @@ namespace tiz
                                 const OMX_U32 nchannels, const OMX_U32 bitdepth,
                                 const OMX_ENDIANTYPE endianness,
                                 const OMX_NUMERICALDATATYPE sign);
-    std::string retrieve_meta_data_str (
-        TagLib::String (TagLib::Tag::*TagFunction)() const) const;
-    unsigned int retrieve_meta_data_uint (
-        TagLib::uint (TagLib::Tag::*TagFunction)() const) const;
 
   private:
     std::string uri_;
@@ -137,7 +137,8 @@ namespace tiz
     OMX_AUDIO_PARAM_VORBISTYPE vorbistype_;
     OMX_AUDIO_PARAM_AACPROFILETYPE aactype_;
     OMX_VIDEO_PARAM_VP8TYPE vp8type_;
-    TagLib::FileRef meta_file_;
+    probecache::entry info_;
+    bool probed_;
     std::string stream_title_;
     std::string stream_genre_;
     bool stream_is_cbr_;
@@ -0,0 +1,636 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizprobecache.cpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent cache of media probing results
+ *
+ * The cache file is a header, followed by an array of fixed-size records
+ * sorted by path hash, followed by a blob with all the strings. Lookups
+ * binary-search the records straight from the mapping, so opening a cache
+ * with tens of thousands of entries costs next to nothing.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <tizplatform.h>
+
+#include "tizprobe.hpp"
+#include "tizprobecache.hpp"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.play.probecache"
+#endif
+
+#define PROBECACHE_MAGIC "TIZPROBE"
+#define PROBECACHE_VERSION 1
+#define PROBECACHE_FILE_NAME "probe.cache"
+#define PROBECACHE_MAX_PREFILL_THREADS 16
+
+namespace  // unnamed
+{
+  enum record_string
+  {
+    StrStreamTitle,
+    StrStreamGenre,
+    StrTitle,
+    StrArtist,
+    StrAlbum,
+    StrComment,
+    StrGenre,
+    StrMax
+  };
+
+  enum record_flags
+  {
+    FlagValid = 1 << 0,
+    FlagCbr = 1 << 1
+  };
+
+  struct file_header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint64_t strings_offset;
+    uint64_t strings_len;
+  };
+
+  struct file_record
+  {
+    uint64_t hash;
+    uint64_t mtime;
+    uint64_t size;
+    uint32_t path_offset;
+    uint32_t path_len;
+    uint32_t flags;
+    uint32_t codec;
+    uint32_t container;
+    uint32_t samplerate;
+    uint32_t bitrate;
+    uint32_t nchannels;
+    uint32_t bitdepth;
+    uint32_t endianness;
+    uint32_t sign;
+    uint32_t year;
+    uint32_t track;
+    int32_t length;
+    uint32_t str_offset[StrMax];
+    uint32_t str_len[StrMax];
+  };
+
+  // FNV-1a
+  uint64_t hash_path (const std::string &path)
+  {
+    uint64_t h = 14695981039346656037ULL;
+    for (std::string::const_iterator it = path.begin (); it != path.end ();
+         ++it)
+    {
+      h ^= static_cast< uint8_t >(*it);
+      h *= 1099511628211ULL;
+    }
+    return h;
+  }
+
+  bool stat_file (const std::string &path, uint64_t &mtime, uint64_t &size)
+  {
+    struct stat st;
+    if (0 != ::stat (path.c_str (), &st) || !S_ISREG (st.st_mode))
+    {
+      return false;
+    }
+    mtime = static_cast< uint64_t >(st.st_mtim.tv_sec) * 1000000000ULL
+            + st.st_mtim.tv_nsec;
+    size = st.st_size;
+    return true;
+  }
+
+  std::string cache_dir ()
+  {
+    const char *p_xdg = getenv ("XDG_CACHE_HOME");
+    const char *p_home = getenv ("HOME");
+    if (p_xdg && *p_xdg)
+    {
+      return std::string (p_xdg).append ("/tizonia");
+    }
+    if (p_home && *p_home)
+    {
+      return std::string (p_home).append ("/.cache/tizonia");
+    }
+    return std::string ();
+  }
+
+  struct record_less
+  {
+    bool operator()(const file_record &a, const uint64_t hash) const
+    {
+      return a.hash < hash;
+    }
+  };
+
+  // Records are written in this order
+  struct sortable_entry
+  {
+    uint64_t hash;
+    const std::string *p_path;
+    uint64_t mtime;
+    uint64_t size;
+    const tiz::probecache::entry *p_data;
+
+    bool operator<(const sortable_entry &other) const
+    {
+      return hash < other.hash
+             || (hash == other.hash && *p_path < *other.p_path);
+    }
+  };
+
+  void add_string (std::string &blob, const std::string &str,
+                   uint32_t &offset, uint32_t &len)
+  {
+    offset = blob.size ();
+    len = str.size ();
+    blob.append (str);
+  }
+}
+
+tiz::probecache::entry::entry ()
+  : valid (false),
+    codec (OMX_AUDIO_CodingUnused),
+    container (OMX_FORMATMax),
+    samplerate (48000),
+    bitrate (0),
+    nchannels (2),
+    bitdepth (16),
+    endianness (OMX_EndianLittle),
+    sign (OMX_NumericalDataSigned),
+    cbr (false),
+    stream_title (),
+    stream_genre (),
+    title (),
+    artist (),
+    album (),
+    comment (),
+    genre (),
+    year (0),
+    track (0),
+    length (-1)
+{
+}
+
+tiz::probecache &tiz::probecache::instance ()
+{
+  static probecache cache;
+  return cache;
+}
+
+tiz::probecache::probecache ()
+  : path_ (),
+    enabled_ (false),
+    p_map_ (NULL),
+    map_len_ (0),
+    pending_ (),
+    mutex_ (),
+    next_prefill_ (0),
+    prefill_mutex_ ()
+{
+  const std::string dir (cache_dir ());
+  if (!dir.empty ())
+  {
+    try
+    {
+      boost::filesystem::create_directories (dir);
+      path_.assign (dir).append ("/").append (PROBECACHE_FILE_NAME);
+      enabled_ = true;
+      (void)map_file ();
+    }
+    catch (std::exception const &e)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : probe cache disabled", e.what ());
+    }
+  }
+}
+
+tiz::probecache::~probecache ()
+{
+  try
+  {
+    flush ();
+  }
+  catch (...)
+  {
+  }
+  unmap_file ();
+}
+
+bool tiz::probecache::map_file ()
+{
+  int fd = -1;
+  struct stat st;
+  const file_header *p_hdr = NULL;
+  bool mapped = false;
+
+  assert (!p_map_);
+
+  if ((fd = ::open (path_.c_str (), O_RDONLY | O_CLOEXEC)) < 0)
+  {
+    // No cache yet
+    return false;
+  }
+
+  if (0 == fstat (fd, &st)
+      && static_cast< size_t >(st.st_size) >= sizeof (file_header))
+  {
+    void *p_addr = mmap (NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED != p_addr)
+    {
+      p_map_ = static_cast< const uint8_t * >(p_addr);
+      map_len_ = st.st_size;
+      p_hdr = reinterpret_cast< const file_header * >(p_map_);
+      const uint64_t records_end
+          = sizeof (file_header)
+            + static_cast< uint64_t >(p_hdr->count) * sizeof (file_record);
+      mapped = (0 == memcmp (p_hdr->magic, PROBECACHE_MAGIC,
+                             sizeof (p_hdr->magic))
+                && PROBECACHE_VERSION == p_hdr->version
+                && records_end <= p_hdr->strings_offset
+                && p_hdr->strings_offset + p_hdr->strings_len <= map_len_);
+    }
+  }
+
+  close (fd);
+
+  if (!mapped)
+  {
+    TIZ_LOG (TIZ_PRIORITY_NOTICE, "Ignoring unusable probe cache [%s]",
+             path_.c_str ());
+    unmap_file ();
+  }
+  else
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Mapped probe cache [%s] - [%u] entries",
+             path_.c_str (), p_hdr->count);
+  }
+
+  return mapped;
+}
+
+void tiz::probecache::unmap_file ()
+{
+  if (p_map_)
+  {
+    munmap (const_cast< uint8_t * >(p_map_), map_len_);
+    p_map_ = NULL;
+    map_len_ = 0;
+  }
+}
+
+bool tiz::probecache::lookup_mapped (const std::string &uri,
+                                     const uint64_t mtime, const uint64_t size,
+                                     entry &e) const
+{
+  if (!p_map_)
+  {
+    return false;
+  }
+
+  const file_header *p_hdr = reinterpret_cast< const file_header * >(p_map_);
+  const file_record *p_first
+      = reinterpret_cast< const file_record * >(p_map_ + sizeof (file_header));
+  const file_record *p_last = p_first + p_hdr->count;
+  const char *p_strings
+      = reinterpret_cast< const char * >(p_map_ + p_hdr->strings_offset);
+  const uint64_t hash = hash_path (uri);
+
+  for (const file_record *p_rec
+       = std::lower_bound (p_first, p_last, hash, record_less ());
+       p_rec != p_last && p_rec->hash == hash; ++p_rec)
+  {
+    if (p_rec->path_offset + p_rec->path_len > p_hdr->strings_len
+        || uri.compare (0, std::string::npos, p_strings + p_rec->path_offset,
+                        p_rec->path_len) != 0)
+    {
+      continue;
+    }
+
+    if (p_rec->mtime != mtime || p_rec->size != size)
+    {
+      // The file has changed since it was probed
+      return false;
+    }
+
+    e.valid = (p_rec->flags & FlagValid) != 0;
+    e.cbr = (p_rec->flags & FlagCbr) != 0;
+    e.codec = static_cast< OMX_AUDIO_CODINGTYPE >(p_rec->codec);
+    e.container = static_cast< OMX_MEDIACONTAINER_FORMATTYPE >(p_rec->container);
+    e.samplerate = p_rec->samplerate;
+    e.bitrate = p_rec->bitrate;
+    e.nchannels = p_rec->nchannels;
+    e.bitdepth = p_rec->bitdepth;
+    e.endianness = static_cast< OMX_ENDIANTYPE >(p_rec->endianness);
+    e.sign = static_cast< OMX_NUMERICALDATATYPE >(p_rec->sign);
+    e.year = p_rec->year;
+    e.track = p_rec->track;
+    e.length = p_rec->length;
+
+    std::string *strs[StrMax]
+        = {&e.stream_title, &e.stream_genre, &e.title, &e.artist,
+           &e.album,        &e.comment,      &e.genre};
+    for (int i = 0; i < StrMax; ++i)
+    {
+      if (p_rec->str_offset[i] + p_rec->str_len[i] > p_hdr->strings_len)
+      {
+        return false;
+      }
+      strs[i]->assign (p_strings + p_rec->str_offset[i], p_rec->str_len[i]);
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool tiz::probecache::lookup (const std::string &uri, entry &e)
+{
+  uint64_t mtime = 0;
+  uint64_t size = 0;
+
+  if (!enabled_ || !stat_file (uri, mtime, size))
+  {
+    return false;
+  }
+
+  boost::mutex::scoped_lock lock (mutex_);
+
+  pending_map_t::const_iterator it = pending_.find (uri);
+  if (it != pending_.end ())
+  {
+    if (it->second.mtime == mtime && it->second.size == size)
+    {
+      e = it->second.data;
+      return true;
+    }
+    return false;
+  }
+
+  return lookup_mapped (uri, mtime, size, e);
+}
+
+void tiz::probecache::store (const std::string &uri, const entry &e)
+{
+  pending_entry pe;
+
+  if (!enabled_ || !stat_file (uri, pe.mtime, pe.size))
+  {
+    return;
+  }
+
+  pe.data = e;
+  boost::mutex::scoped_lock lock (mutex_);
+  pending_[uri] = pe;
+}
+
+void tiz::probecache::flush ()
+{
+  if (!enabled_)
+  {
+    return;
+  }
+
+  boost::mutex::scoped_lock lock (mutex_);
+
+  if (pending_.empty ())
+  {
+    return;
+  }
+
+  // Merge what is in the file with the new results; the latter win
+  std::vector< std::string > old_paths;
+  std::vector< pending_entry > old_entries;
+  if (p_map_)
+  {
+    const file_header *p_hdr = reinterpret_cast< const file_header * >(p_map_);
+    const file_record *p_rec = reinterpret_cast< const file_record * >(
+        p_map_ + sizeof (file_header));
+    const char *p_strings
+        = reinterpret_cast< const char * >(p_map_ + p_hdr->strings_offset);
+    old_paths.reserve (p_hdr->count);
+    old_entries.reserve (p_hdr->count);
+    for (uint32_t i = 0; i < p_hdr->count; ++i, ++p_rec)
+    {
+      if (p_rec->path_offset + p_rec->path_len > p_hdr->strings_len)
+      {
+        continue;
+      }
+      std::string path (p_strings + p_rec->path_offset, p_rec->path_len);
+      pending_entry pe;
+      if (pending_.find (path) == pending_.end ()
+          && lookup_mapped (path, p_rec->mtime, p_rec->size, pe.data))
+      {
+        pe.mtime = p_rec->mtime;
+        pe.size = p_rec->size;
+        old_paths.push_back (path);
+        old_entries.push_back (pe);
+      }
+    }
+  }
+
+  std::vector< sortable_entry > sorted;
+  sorted.reserve (old_paths.size () + pending_.size ());
+  for (size_t i = 0; i < old_paths.size (); ++i)
+  {
+    sortable_entry se = {hash_path (old_paths[i]), &old_paths[i],
+                         old_entries[i].mtime, old_entries[i].size,
+                         &old_entries[i].data};
+    sorted.push_back (se);
+  }
+  for (pending_map_t::const_iterator it = pending_.begin ();
+       it != pending_.end (); ++it)
+  {
+    sortable_entry se = {hash_path (it->first), &it->first, it->second.mtime,
+                         it->second.size, &it->second.data};
+    sorted.push_back (se);
+  }
+  std::sort (sorted.begin (), sorted.end ());
+
+  std::vector< file_record > records (sorted.size ());
+  std::string blob;
+  for (size_t i = 0; i < sorted.size (); ++i)
+  {
+    const entry &e = *sorted[i].p_data;
+    file_record &r = records[i];
+    memset (&r, 0, sizeof (r));
+    r.hash = sorted[i].hash;
+    r.mtime = sorted[i].mtime;
+    r.size = sorted[i].size;
+    add_string (blob, *sorted[i].p_path, r.path_offset, r.path_len);
+    r.flags = (e.valid ? FlagValid : 0) | (e.cbr ? FlagCbr : 0);
+    r.codec = e.codec;
+    r.container = e.container;
+    r.samplerate = e.samplerate;
+    r.bitrate = e.bitrate;
+    r.nchannels = e.nchannels;
+    r.bitdepth = e.bitdepth;
+    r.endianness = e.endianness;
+    r.sign = e.sign;
+    r.year = e.year;
+    r.track = e.track;
+    r.length = e.length;
+    const std::string *strs[StrMax]
+        = {&e.stream_title, &e.stream_genre, &e.title, &e.artist,
+           &e.album,        &e.comment,      &e.genre};
+    for (int s = 0; s < StrMax; ++s)
+    {
+      add_string (blob, *strs[s], r.str_offset[s], r.str_len[s]);
+    }
+  }
+
+  file_header hdr;
+  memset (&hdr, 0, sizeof (hdr));
+  memcpy (hdr.magic, PROBECACHE_MAGIC, sizeof (hdr.magic));
+  hdr.version = PROBECACHE_VERSION;
+  hdr.count = records.size ();
+  hdr.strings_offset = sizeof (hdr) + records.size () * sizeof (file_record);
+  hdr.strings_len = blob.size ();
+
+  // Write a new file and move it into place, so that other instances of the
+  // player that have the old one mapped are not affected. The temporary file
+  // gets a unique name in the cache directory, as several instances may be
+  // flushing at the same time.
+  std::vector< char > tmp_path (path_.begin (), path_.end ());
+  const char tmp_suffix[] = ".XXXXXX";
+  tmp_path.insert (tmp_path.end (), tmp_suffix,
+                   tmp_suffix + sizeof (tmp_suffix));
+  const int fd = mkstemp (&tmp_path[0]);
+  FILE *p_file = NULL;
+  bool written = false;
+  if (fd >= 0 && !(p_file = fdopen (fd, "wb")))
+  {
+    close (fd);
+  }
+  if (p_file)
+  {
+    written = (1 == fwrite (&hdr, sizeof (hdr), 1, p_file))
+              && (records.empty ()
+                  || records.size () == fwrite (&records[0], sizeof (file_record),
+                                                records.size (), p_file))
+              && (blob.empty ()
+                  || 1 == fwrite (blob.data (), blob.size (), 1, p_file));
+    written = (0 == fclose (p_file)) && written;
+  }
+
+  if (written && 0 == rename (&tmp_path[0], path_.c_str ()))
+  {
+    TIZ_LOG (TIZ_PRIORITY_TRACE, "Wrote [%u] entries to [%s]", hdr.count,
+             path_.c_str ());
+    pending_.clear ();
+    unmap_file ();
+    (void)map_file ();
+  }
+  else
+  {
+    TIZ_LOG (TIZ_PRIORITY_ERROR, "Unable to write the probe cache [%s]",
+             path_.c_str ());
+    if (fd >= 0)
+    {
+      (void)unlink (&tmp_path[0]);
+    }
+  }
+}
+
+void tiz::probecache::prefill_worker (const std::vector< std::string > *p_uris)
+{
+  assert (p_uris);
+  for (;;)
+  {
+    size_t i = 0;
+    {
+      boost::mutex::scoped_lock lock (prefill_mutex_);
+      if (next_prefill_ >= p_uris->size ())
+      {
+        break;
+      }
+      i = next_prefill_++;
+    }
+
+    entry e;
+    if (!lookup ((*p_uris)[i], e))
+    {
+      try
+      {
+        tiz::probe::obtain_info ((*p_uris)[i], e);
+        store ((*p_uris)[i], e);
+      }
+      catch (std::exception const &ex)
+      {
+        // Leave it to the player to deal with this file
+        TIZ_LOG (TIZ_PRIORITY_ERROR, "[%s] : while probing [%s]", ex.what (),
+                 (*p_uris)[i].c_str ());
+      }
+    }
+  }
+}
+
+void tiz::probecache::prefill (const std::vector< std::string > &uris)
+{
+  if (!enabled_ || uris.empty ())
+  {
+    return;
+  }
+
+  size_t nthreads = std::max (boost::thread::hardware_concurrency (), 1U);
+  nthreads = std::min (nthreads, static_cast< size_t >(
+                                     PROBECACHE_MAX_PREFILL_THREADS));
+  nthreads = std::min (nthreads, uris.size ());
+
+  TIZ_LOG (TIZ_PRIORITY_TRACE, "Prefilling [%lu] uris with [%lu] threads",
+           (unsigned long)uris.size (), (unsigned long)nthreads);
+
+  next_prefill_ = 0;
+  boost::thread_group pool;
+  for (size_t i = 0; i < nthreads; ++i)
+  {
+    pool.create_thread (
+        boost::bind (&probecache::prefill_worker, this, &uris));
+  }
+  pool.join_all ();
+
+  flush ();
+}
@@ -0,0 +1,128 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   tizprobecache.hpp
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Persistent cache of media probing results
+ *
+ *
+ */
+
+#ifndef TIZPROBECACHE_HPP
+#define TIZPROBECACHE_HPP
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <OMX_Core.h>
+#include <OMX_Audio.h>
+#include <OMX_TizoniaExt.h>
+
+namespace tiz
+{
+  /**
+   * Caches what tiz::probe learns about a local file (codec, container, pcm
+   * parameters and tags), keyed by path, modification time and size. The
+   * entries live in a compact file under the user's cache directory that is
+   * memory-mapped on first use; new results are kept in memory and merged into
+   * that file by flush ().
+   */
+  class probecache : private boost::noncopyable
+  {
+
+  public:
+    struct entry
+    {
+      entry ();
+
+      bool valid;  // false when the file could not be opened as media
+      OMX_AUDIO_CODINGTYPE codec;
+      OMX_MEDIACONTAINER_FORMATTYPE container;
+      OMX_U32 samplerate;
+      OMX_U32 bitrate;
+      OMX_U32 nchannels;
+      OMX_U32 bitdepth;
+      OMX_ENDIANTYPE endianness;
+      OMX_NUMERICALDATATYPE sign;
+      bool cbr;
+      // From MediaInfo
+      std::string stream_title;
+      std::string stream_genre;
+      // From TagLib
+      std::string title;
+      std::string artist;
+      std::string album;
+      std::string comment;
+      std::string genre;
+      unsigned int year;
+      unsigned int track;
+      int length;  // seconds, -1 if unknown
+    };
+
+  public:
+    static probecache &instance ();
+
+    bool lookup (const std::string &uri, entry &e);
+    void store (const std::string &uri, const entry &e);
+
+    /** Probes, across a pool of threads, the files in the list that are not
+     * cached yet, and flushes the results. */
+    void prefill (const std::vector< std::string > &uris);
+
+    void flush ();
+
+  private:
+    struct pending_entry
+    {
+      uint64_t mtime;
+      uint64_t size;
+      entry data;
+    };
+    typedef std::map< std::string, pending_entry > pending_map_t;
+
+    probecache ();
+    ~probecache ();
+
+    bool map_file ();
+    void unmap_file ();
+    bool lookup_mapped (const std::string &uri, const uint64_t mtime,
+                        const uint64_t size, entry &e) const;
+    void prefill_worker (const std::vector< std::string > *p_uris);
+
+  private:
+    std::string path_;
+    bool enabled_;
+    const uint8_t *p_map_;
+    size_t map_len_;
+    pending_map_t pending_;
+    boost::mutex mutex_;  // Protects everything above
+    size_t next_prefill_;
+    boost::mutex prefill_mutex_;  // Protects next_prefill_
+  };
+}  // namespace tiz
+
+#endif  // TIZPROBECACHE_HPP
@@ -43,6 +43,7 @@
 #include <tizscheduler.h>
 
 #include "frprc.h"
+#include "frcfgport.h"
 #include "fr.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
@@ -140,7 +141,7 @@ static OMX_PTR
 instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
   /* Instantiate the config port */
-  return factory_new (tiz_get_type (ap_hdl, "tizuricfgport"),
+  return factory_new (tiz_get_type (ap_hdl, "frcfgport"),
                       NULL, /* this port does not take options */
                       ARATELIA_FILE_READER_COMPONENT_NAME, file_reader_version);
 }
@@ -161,7 +162,8 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   const tiz_role_factory_t * rf_list[]
     = {&audio_role, &video_role, &image_role, &other_role};
   tiz_type_factory_t frprc_type;
-  const tiz_type_factory_t * tf_list[] = {&frprc_type};
+  tiz_type_factory_t frcfgport_type;
+  const tiz_type_factory_t * tf_list[] = {&frprc_type, &frcfgport_type};
 
   strcpy ((OMX_STRING) audio_role.role, ARATELIA_FILE_READER_AUDIO_READER_ROLE);
   audio_role.pf_cport = instantiate_config_port;
@@ -192,12 +194,17 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   strcpy ((OMX_STRING) frprc_type.object_name, "frprc");
   frprc_type.pf_object_init = fr_prc_init;
 
+  strcpy ((OMX_STRING) frcfgport_type.class_name, "frcfgport_class");
+  frcfgport_type.pf_class_init = fr_cfgport_class_init;
+  strcpy ((OMX_STRING) frcfgport_type.object_name, "frcfgport");
+  frcfgport_type.pf_object_init = fr_cfgport_init;
+
   /* Initialize the component infrastructure */
   tiz_check_omx (
     tiz_comp_init (ap_hdl, ARATELIA_FILE_READER_COMPONENT_NAME));
 
-  /* Register the "frprc" class */
-  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
+  /* Register the "frprc" and "frcfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 2));
 
   /* Register the various roles */
   tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 4));
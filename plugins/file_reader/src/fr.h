@@ -47,6 +47,11 @@ extern "C" {
 #define ARATELIA_FILE_READER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_FILE_READER_PORT_ALIGNMENT 0
 #define ARATELIA_FILE_READER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_FILE_READER_DEFAULT_WINDOW_SIZE (1024 * 1024)
+#define ARATELIA_FILE_READER_DEFAULT_READ_THREADS 2
+#define ARATELIA_FILE_READER_MAX_READ_THREADS 8
+#define ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE (64 * 1024)
+#define ARATELIA_FILE_READER_THREAD_STACK_SIZE (64 * 1024)
 
 #ifdef __cplusplus
 }
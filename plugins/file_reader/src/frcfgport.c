@@ -0,0 +1,242 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   frcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief A specialised config port class for the binary file reader component
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include "fr.h"
+#include "frcfgport.h"
+#include "frcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.file_reader.cfgport"
+#endif
+
+static OMX_TIZONIA_FILEREADERMODE
+mode_from_str (const char * ap_str)
+{
+  OMX_TIZONIA_FILEREADERMODE mode = OMX_TIZONIA_FileReaderModeSync;
+  if (ap_str)
+    {
+      if (0 == strncmp (ap_str, "readahead", strlen ("readahead")))
+        {
+          mode = OMX_TIZONIA_FileReaderModeReadAhead;
+        }
+      else if (0 == strncmp (ap_str, "mmap", strlen ("mmap")))
+        {
+          mode = OMX_TIZONIA_FileReaderModeMmap;
+        }
+    }
+  return mode;
+}
+
+static OMX_U32
+get_u32_config_value (const char * ap_key, const OMX_U32 a_default)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? (OMX_U32) strtoul (p_value, NULL, 10) : a_default;
+}
+
+static void
+sanitize_mode (OMX_TIZONIA_FILEREADERMODETYPE * ap_mode)
+{
+  assert (ap_mode);
+  if (ap_mode->eMode > OMX_TIZONIA_FileReaderModeMmap)
+    {
+      ap_mode->eMode = OMX_TIZONIA_FileReaderModeSync;
+    }
+  if (ap_mode->nWindowSize < ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE)
+    {
+      ap_mode->nWindowSize = ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE;
+    }
+  ap_mode->nReadThreads = MIN (MAX (ap_mode->nReadThreads, 1),
+                               ARATELIA_FILE_READER_MAX_READ_THREADS);
+}
+
+/*
+ * frcfgport class
+ */
+
+static void *
+fr_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  fr_cfgport_t * p_obj = super_ctor (typeOf (ap_obj, "frcfgport"), ap_obj, app);
+
+  assert (p_obj);
+
+  tiz_check_omx_ret_null (
+    tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigFileReaderMode));
+
+  /* Initialize the OMX_TIZONIA_FILEREADERMODETYPE structure with the defaults
+     found in the configuration file */
+  TIZ_INIT_OMX_STRUCT (p_obj->mode_);
+  p_obj->mode_.eMode = mode_from_str (tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION, "OMX.Aratelia.file_reader.binary.mode"));
+  p_obj->mode_.nWindowSize
+    = get_u32_config_value ("OMX.Aratelia.file_reader.binary.window_kb",
+                            ARATELIA_FILE_READER_DEFAULT_WINDOW_SIZE / 1024)
+      * 1024;
+  p_obj->mode_.nReadThreads
+    = get_u32_config_value ("OMX.Aratelia.file_reader.binary.read_threads",
+                            ARATELIA_FILE_READER_DEFAULT_READ_THREADS);
+  sanitize_mode (&(p_obj->mode_));
+
+  return p_obj;
+}
+
+static void *
+fr_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "frcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+fr_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const fr_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "GetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigFileReaderMode == a_index)
+    {
+      memcpy (ap_struct, &(p_obj->mode_),
+              sizeof (OMX_TIZONIA_FILEREADERMODETYPE));
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "frcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+fr_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  fr_cfgport_t * p_obj = (fr_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "SetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigFileReaderMode == a_index)
+    {
+      memcpy (&(p_obj->mode_), ap_struct,
+              sizeof (OMX_TIZONIA_FILEREADERMODETYPE));
+      sanitize_mode (&(p_obj->mode_));
+      TIZ_TRACE (ap_hdl, "mode [%d] window [%u] threads [%u]",
+                 p_obj->mode_.eMode, p_obj->mode_.nWindowSize,
+                 p_obj->mode_.nReadThreads);
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "frcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * fr_cfgport_class
+ */
+
+static void *
+fr_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "frcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+fr_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * frcfgport_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizuricfgport), "frcfgport_class", classOf (tizuricfgport),
+     sizeof (fr_cfgport_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, fr_cfgport_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return frcfgport_class;
+}
+
+void *
+fr_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * frcfgport_class = tiz_get_type (ap_hdl, "frcfgport_class");
+  TIZ_LOG_CLASS (frcfgport_class);
+  void * frcfgport = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (frcfgport_class, "frcfgport", tizuricfgport, sizeof (fr_cfgport_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, fr_cfgport_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, fr_cfgport_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, fr_cfgport_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, fr_cfgport_SetConfig,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+
+  return frcfgport;
+}
@@ -35,6 +35,9 @@
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <OMX_Core.h>
 
@@ -59,6 +62,19 @@ static inline void
 close_file (fr_prc_t * ap_prc)
 {
   assert (ap_prc);
+  if (ap_prc->p_ev_io_)
+    {
+      tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_io_);
+      ap_prc->p_ev_io_ = NULL;
+    }
+  fr_rdahead_destroy (ap_prc->p_rdahead_);
+  ap_prc->p_rdahead_ = NULL;
+  if (ap_prc->p_map_)
+    {
+      (void) munmap (ap_prc->p_map_, ap_prc->map_size_);
+      ap_prc->p_map_ = NULL;
+    }
+  ap_prc->map_size_ = 0;
   if (ap_prc->p_file_)
     {
       fclose (ap_prc->p_file_);
@@ -80,7 +96,13 @@ reset_stream_parameters (fr_prc_t * ap_prc)
   assert (ap_prc);
   ap_prc->counter_ = 0;
   ap_prc->eos_ = false;
-  if (ap_prc->p_file_)
+  ap_prc->map_pos_ = 0;
+  ap_prc->map_advised_ = 0;
+  if (ap_prc->p_rdahead_)
+    {
+      fr_rdahead_rewind (ap_prc->p_rdahead_);
+    }
+  else if (ap_prc->p_file_)
     {
       rewind (ap_prc->p_file_);
     }
@@ -129,6 +151,151 @@ obtain_uri (fr_prc_t * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+obtain_mode (fr_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_STRUCT (ap_prc->mode_);
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetConfig (tiz_get_krn (handleOf (ap_prc)),
+                                  handleOf (ap_prc),
+                                  OMX_TizoniaIndexConfigFileReaderMode,
+                                  &(ap_prc->mode_))))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving the reader mode from the port",
+                 tiz_err_to_str (rc));
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+map_file (fr_prc_t * ap_prc)
+{
+  struct stat st;
+  assert (ap_prc);
+  assert (ap_prc->p_file_);
+  assert (!ap_prc->p_map_);
+
+  if (0 != fstat (fileno (ap_prc->p_file_), &st) || !S_ISREG (st.st_mode)
+      || (OMX_U64) st.st_size > SIZE_MAX)
+    {
+      return OMX_ErrorUnsupportedSetting;
+    }
+
+  ap_prc->map_size_ = st.st_size;
+  if (ap_prc->map_size_ > 0)
+    {
+      void * p_map = mmap (NULL, ap_prc->map_size_, PROT_READ, MAP_PRIVATE,
+                           fileno (ap_prc->p_file_), 0);
+      if (MAP_FAILED == p_map)
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "mmap failed (%s)", strerror (errno));
+          ap_prc->map_size_ = 0;
+          return OMX_ErrorUnsupportedSetting;
+        }
+      ap_prc->p_map_ = p_map;
+      (void) madvise (ap_prc->p_map_, ap_prc->map_size_, MADV_SEQUENTIAL);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+start_readahead (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  assert (ap_prc->p_file_);
+  assert (!ap_prc->p_rdahead_);
+
+  tiz_check_omx (fr_rdahead_init (&(ap_prc->p_rdahead_),
+                                  fileno (ap_prc->p_file_),
+                                  ap_prc->mode_.nWindowSize,
+                                  ap_prc->mode_.nReadThreads));
+  /* The read-ahead threads wake up the component through this eventfd */
+  tiz_check_omx (tiz_srv_io_watcher_init (
+    ap_prc, &(ap_prc->p_ev_io_), fr_rdahead_event_fd (ap_prc->p_rdahead_),
+    TIZ_EVENT_READ, false));
+  return OMX_ErrorNone;
+}
+
+static void
+advise_map_window (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  /* Have the kernel page in the next window asynchronously, once the
+     consumer has gone through half of the previous one */
+  if (ap_prc->map_pos_ + ap_prc->mode_.nWindowSize / 2 >= ap_prc->map_advised_
+      && ap_prc->map_advised_ < ap_prc->map_size_)
+    {
+      const long page_size = sysconf (_SC_PAGESIZE);
+      size_t start = ap_prc->map_pos_ & ~((size_t) page_size - 1);
+      size_t end = MIN (ap_prc->map_pos_ + ap_prc->mode_.nWindowSize,
+                        ap_prc->map_size_);
+      (void) madvise (ap_prc->p_map_ + start, end - start, MADV_WILLNEED);
+      ap_prc->map_advised_ = end;
+    }
+}
+
+static OMX_ERRORTYPE
+copy_from_map (fr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * p_hdr)
+{
+  size_t len = 0;
+  assert (ap_prc);
+  assert (p_hdr);
+
+  if (ap_prc->p_map_)
+    {
+      advise_map_window (ap_prc);
+      len = MIN (p_hdr->nAllocLen, ap_prc->map_size_ - ap_prc->map_pos_);
+      memcpy (p_hdr->pBuffer, ap_prc->p_map_ + ap_prc->map_pos_, len);
+      ap_prc->map_pos_ += len;
+    }
+
+  p_hdr->nFilledLen = len;
+  ap_prc->counter_ += len;
+
+  if (ap_prc->map_pos_ >= ap_prc->map_size_)
+    {
+      TIZ_NOTICE (handleOf (ap_prc), "End of file reached; EOS in HEADER [%p]",
+                  p_hdr);
+      p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+      ap_prc->eos_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+copy_from_readahead (fr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * p_hdr)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t len = 0;
+  bool eos = false;
+  assert (ap_prc);
+  assert (p_hdr);
+
+  rc = fr_rdahead_read (ap_prc->p_rdahead_, p_hdr->pBuffer, p_hdr->nAllocLen,
+                        &len, &eos);
+  if (OMX_ErrorNoMore == rc)
+    {
+      rc = OMX_ErrorNone;
+    }
+  tiz_check_omx (rc);
+
+  p_hdr->nFilledLen = len;
+  ap_prc->counter_ += len;
+
+  if (eos)
+    {
+      TIZ_NOTICE (handleOf (ap_prc), "End of file reached; EOS in HEADER [%p]",
+                  p_hdr);
+      p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+      ap_prc->eos_ = true;
+    }
+  return OMX_ErrorNone;
+}
+
 static OMX_ERRORTYPE
 read_into_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
 {
@@ -180,6 +347,12 @@ fr_prc_ctor (void * ap_obj, va_list * app)
   assert (p_prc);
   p_prc->p_file_ = NULL;
   p_prc->p_uri_param_ = NULL;
+  TIZ_INIT_OMX_STRUCT (p_prc->mode_);
+  p_prc->mode_.eMode = OMX_TIZONIA_FileReaderModeSync;
+  p_prc->p_rdahead_ = NULL;
+  p_prc->p_ev_io_ = NULL;
+  p_prc->p_map_ = NULL;
+  p_prc->map_size_ = 0;
   reset_stream_parameters (p_prc);
   return p_prc;
 }
@@ -214,6 +387,23 @@ fr_prc_allocate_resources (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
       return OMX_ErrorInsufficientResources;
     }
 
+  tiz_check_omx (obtain_mode (p_prc));
+
+  if (OMX_TIZONIA_FileReaderModeMmap == p_prc->mode_.eMode
+      && OMX_ErrorNone != map_file (p_prc))
+    {
+      TIZ_NOTICE (handleOf (p_prc), "Unable to map the file; reading it instead");
+      p_prc->mode_.eMode = OMX_TIZONIA_FileReaderModeSync;
+    }
+  else if (OMX_TIZONIA_FileReaderModeReadAhead == p_prc->mode_.eMode)
+    {
+      tiz_check_omx (start_readahead (p_prc));
+    }
+
+  TIZ_NOTICE (handleOf (p_prc), "mode [%d] window [%u] threads [%u]",
+              p_prc->mode_.eMode, p_prc->mode_.nWindowSize,
+              p_prc->mode_.nReadThreads);
+
   return OMX_ErrorNone;
 }
 
@@ -235,12 +425,24 @@ fr_prc_prepare_to_transfer (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 static OMX_ERRORTYPE
 fr_prc_transfer_and_process (void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
 {
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_start (p_prc, p_prc->p_ev_io_));
+    }
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 fr_prc_stop_and_return (void * ap_obj)
 {
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_stop (p_prc, p_prc->p_ev_io_));
+    }
   return OMX_ErrorNone;
 }
 
@@ -248,35 +450,80 @@ fr_prc_stop_and_return (void * ap_obj)
  * from tiz_prc class
  */
 
+static bool
+data_available (fr_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  /* In read-ahead mode, if the data is not there yet, the io watcher will
+     tell us when it is */
+  return !ap_prc->p_rdahead_ || fr_rdahead_ready (ap_prc->p_rdahead_);
+}
+
+static OMX_ERRORTYPE
+fill_buffer (fr_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * p_hdr)
+{
+  assert (ap_prc);
+  switch (ap_prc->mode_.eMode)
+    {
+      case OMX_TIZONIA_FileReaderModeReadAhead:
+        return copy_from_readahead (ap_prc, p_hdr);
+      case OMX_TIZONIA_FileReaderModeMmap:
+        return copy_from_map (ap_prc, p_hdr);
+      default:
+        return read_into_buffer (ap_prc, p_hdr);
+    };
+}
+
 static OMX_ERRORTYPE
 fr_prc_buffers_ready (const void * ap_obj)
 {
-  const fr_prc_t * p_prc = ap_obj;
+  fr_prc_t * p_prc = (fr_prc_t *) ap_obj;
 
   assert (ap_obj);
 
-  if (!p_prc->eos_)
+  /* Reads from memory do not block, so fill as many buffers as we can;
+     synchronous reads are done one buffer at a time */
+  do
     {
       OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+      if (p_prc->eos_ || !data_available (p_prc))
+        {
+          break;
+        }
       tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)),
-                                               ARATELIA_FILE_READER_PORT_INDEX,
-                                               0, &p_hdr));
-      if (p_hdr)
+                                           ARATELIA_FILE_READER_PORT_INDEX, 0,
+                                           &p_hdr));
+      if (!p_hdr)
         {
-          TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...nFilledLen [%d]",
-                     p_hdr, p_hdr->nFilledLen);
-          p_hdr->nOffset = 0;
-          p_hdr->nFilledLen = 0;
-          tiz_check_omx (read_into_buffer (p_prc, p_hdr));
-          tiz_check_omx (
-            tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
-                                    ARATELIA_FILE_READER_PORT_INDEX, p_hdr));
+          break;
         }
+      TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...nFilledLen [%d]",
+                 p_hdr, p_hdr->nFilledLen);
+      p_hdr->nOffset = 0;
+      p_hdr->nFilledLen = 0;
+      tiz_check_omx (fill_buffer (p_prc, p_hdr));
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
+                                             ARATELIA_FILE_READER_PORT_INDEX,
+                                             p_hdr));
     }
+  while (OMX_TIZONIA_FileReaderModeSync != p_prc->mode_.eMode);
 
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+fr_prc_io_ready (void * ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                 int a_events)
+{
+  fr_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_rdahead_)
+    {
+      fr_rdahead_clear_event (p_prc->p_rdahead_);
+    }
+  return fr_prc_buffers_ready (p_prc);
+}
+
 /*
  * fr_prc_class
  */
@@ -335,6 +582,8 @@ fr_prc_init (void * ap_tos, void * ap_hdl)
      tiz_srv_stop_and_return, fr_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, fr_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, fr_prc_io_ready,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -35,8 +35,12 @@ extern "C" {
 
 #include <stdbool.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include <tizprc_decls.h>
 
+#include "frrdahead.h"
+
 typedef struct fr_prc fr_prc_t;
 struct fr_prc
 {
@@ -46,6 +50,13 @@ struct fr_prc
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   OMX_U32 counter_;
   bool eos_;
+  OMX_TIZONIA_FILEREADERMODETYPE mode_;
+  fr_rdahead_t * p_rdahead_;
+  tiz_event_io_t * p_ev_io_;
+  OMX_U8 * p_map_;
+  size_t map_size_;
+  size_t map_pos_;
+  size_t map_advised_; /* end of the range last passed to MADV_WILLNEED */
 };
 
 typedef struct fr_prc_class fr_prc_class_t;
@@ -0,0 +1,460 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   frrdahead.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Binary file reader's read-ahead engine
+ *
+ * The slots form a ring. 'head' is the slot the consumer is copying from, and
+ * the 'issued' slots that follow it are either being read or ready. Slots are
+ * handed to the threads in file order, so with several threads more than one
+ * read can be in flight (which is what helps on network filesystems), but the
+ * consumer always sees the data in order.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+
+#include <tizplatform.h>
+
+#include "fr.h"
+#include "frrdahead.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.file_reader.rdahead"
+#endif
+
+typedef enum fr_slot_state fr_slot_state_t;
+enum fr_slot_state
+{
+  ESlotEmpty,
+  ESlotReading,
+  ESlotReady
+};
+
+typedef struct fr_slot fr_slot_t;
+struct fr_slot
+{
+  OMX_U8 * p_data;
+  size_t len;
+  int err;
+  fr_slot_state_t state;
+};
+
+struct fr_rdahead
+{
+  int fd;
+  int evfd;
+  fr_slot_t * p_slots;
+  size_t nslots;
+  size_t head;
+  size_t pos;     /* bytes of the head slot already copied out */
+  size_t issued;  /* slots after head being read or ready */
+  size_t nreading;
+  off_t next_off; /* file offset of the next slot to be issued */
+  bool eof_issued;
+  bool eos;
+  bool dirty;     /* data was handed out since the last rewind */
+  bool waiting;   /* the consumer found the head slot not ready */
+  bool stop;
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  tiz_thread_t threads[ARATELIA_FILE_READER_MAX_READ_THREADS];
+  OMX_U32 nthreads;
+};
+
+static inline void
+signal_event (const int a_fd)
+{
+  const uint64_t one = 1;
+  (void) write (a_fd, &one, sizeof (one));
+}
+
+static ssize_t
+read_slot (const int a_fd, OMX_U8 * ap_dst, size_t a_len, off_t a_off)
+{
+  size_t done = 0;
+  while (done < a_len)
+    {
+      ssize_t n = pread (a_fd, ap_dst + done, a_len - done, a_off + done);
+      if (n < 0 && EINTR == errno)
+        {
+          continue;
+        }
+      if (n < 0)
+        {
+          return -1;
+        }
+      if (0 == n)
+        {
+          break;
+        }
+      done += n;
+    }
+  return (ssize_t) done;
+}
+
+static void *
+rdahead_thread_func (void * ap_arg)
+{
+  fr_rdahead_t * p_ra = ap_arg;
+  assert (p_ra);
+
+  tiz_mutex_lock (&(p_ra->mutex));
+  for (;;)
+    {
+      fr_slot_t * p_slot = NULL;
+      size_t idx = 0;
+      off_t off = 0;
+      ssize_t n = 0;
+      int err = 0;
+
+      while (!p_ra->stop
+             && (p_ra->eof_issued || p_ra->issued >= p_ra->nslots))
+        {
+          tiz_cond_wait (&(p_ra->cond), &(p_ra->mutex));
+        }
+
+      if (p_ra->stop)
+        {
+          break;
+        }
+
+      idx = (p_ra->head + p_ra->issued) % p_ra->nslots;
+      p_slot = &(p_ra->p_slots[idx]);
+      assert (ESlotEmpty == p_slot->state);
+      p_slot->state = ESlotReading;
+      off = p_ra->next_off;
+      p_ra->next_off += ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE;
+      p_ra->issued++;
+      p_ra->nreading++;
+      tiz_mutex_unlock (&(p_ra->mutex));
+
+      n = read_slot (p_ra->fd, p_slot->p_data,
+                     ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE, off);
+      err = n < 0 ? errno : 0;
+
+      tiz_mutex_lock (&(p_ra->mutex));
+      p_slot->err = err;
+      p_slot->len = n < 0 ? 0 : (size_t) n;
+      p_slot->state = ESlotReady;
+      if (n < ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE)
+        {
+          /* End of file (or an error); nothing else to issue */
+          p_ra->eof_issued = true;
+        }
+      p_ra->nreading--;
+      if (p_ra->waiting && idx == p_ra->head)
+        {
+          p_ra->waiting = false;
+          signal_event (p_ra->evfd);
+        }
+      /* fr_rdahead_rewind may be waiting for the reads in flight */
+      tiz_cond_broadcast (&(p_ra->cond));
+    }
+  tiz_mutex_unlock (&(p_ra->mutex));
+
+  return NULL;
+}
+
+static void
+stop_threads (fr_rdahead_t * ap_ra)
+{
+  OMX_U32 i = 0;
+  assert (ap_ra);
+
+  tiz_mutex_lock (&(ap_ra->mutex));
+  ap_ra->stop = true;
+  tiz_cond_broadcast (&(ap_ra->cond));
+  tiz_mutex_unlock (&(ap_ra->mutex));
+
+  for (i = 0; i < ap_ra->nthreads; ++i)
+    {
+      OMX_PTR p_result = NULL;
+      (void) tiz_thread_join (&(ap_ra->threads[i]), &p_result);
+    }
+  ap_ra->nthreads = 0;
+}
+
+OMX_ERRORTYPE
+fr_rdahead_init (fr_rdahead_t ** app_ra, const int a_fd,
+                 const size_t a_window_size, const OMX_U32 a_nthreads)
+{
+  fr_rdahead_t * p_ra = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  size_t i = 0;
+
+  assert (app_ra);
+  assert (a_fd >= 0);
+  assert (a_nthreads > 0 && a_nthreads <= ARATELIA_FILE_READER_MAX_READ_THREADS);
+
+  p_ra = tiz_mem_calloc (1, sizeof (fr_rdahead_t));
+  tiz_check_null_ret_oom (p_ra != NULL);
+
+  p_ra->fd = a_fd;
+  p_ra->evfd = -1;
+  /* At least one slot per thread, plus the one being copied out */
+  p_ra->nslots = a_window_size / ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE;
+  if (p_ra->nslots < a_nthreads + 1)
+    {
+      p_ra->nslots = a_nthreads + 1;
+    }
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_ra->mutex)))
+    {
+      tiz_mem_free (p_ra);
+      return OMX_ErrorInsufficientResources;
+    }
+  if (OMX_ErrorNone != tiz_cond_init (&(p_ra->cond)))
+    {
+      tiz_mutex_destroy (&(p_ra->mutex));
+      tiz_mem_free (p_ra);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_ra->evfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  p_ra->p_slots = tiz_mem_calloc (p_ra->nslots, sizeof (fr_slot_t));
+  if (p_ra->evfd < 0 || !p_ra->p_slots)
+    {
+      goto end;
+    }
+
+  for (i = 0; i < p_ra->nslots; ++i)
+    {
+      p_ra->p_slots[i].p_data
+        = tiz_mem_alloc (ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE);
+      if (!p_ra->p_slots[i].p_data)
+        {
+          goto end;
+        }
+    }
+
+  for (p_ra->nthreads = 0; p_ra->nthreads < a_nthreads; ++p_ra->nthreads)
+    {
+      if (OMX_ErrorNone
+          != tiz_thread_create (&(p_ra->threads[p_ra->nthreads]),
+                                ARATELIA_FILE_READER_THREAD_STACK_SIZE, 0,
+                                rdahead_thread_func, p_ra))
+        {
+          goto end;
+        }
+      (void) tiz_thread_setname (&(p_ra->threads[p_ra->nthreads]),
+                                 (const OMX_STRING) "tizfrrdahead");
+    }
+
+  rc = OMX_ErrorNone;
+
+end:
+
+  if (OMX_ErrorNone != rc)
+    {
+      fr_rdahead_destroy (p_ra);
+      p_ra = NULL;
+    }
+
+  *app_ra = p_ra;
+  return rc;
+}
+
+void
+fr_rdahead_destroy (fr_rdahead_t * ap_ra)
+{
+  size_t i = 0;
+
+  if (!ap_ra)
+    {
+      return;
+    }
+
+  stop_threads (ap_ra);
+
+  if (ap_ra->p_slots)
+    {
+      for (i = 0; i < ap_ra->nslots; ++i)
+        {
+          tiz_mem_free (ap_ra->p_slots[i].p_data);
+        }
+      tiz_mem_free (ap_ra->p_slots);
+    }
+
+  if (ap_ra->evfd >= 0)
+    {
+      close (ap_ra->evfd);
+    }
+
+  tiz_cond_destroy (&(ap_ra->cond));
+  tiz_mutex_destroy (&(ap_ra->mutex));
+  tiz_mem_free (ap_ra);
+}
+
+int
+fr_rdahead_event_fd (const fr_rdahead_t * ap_ra)
+{
+  assert (ap_ra);
+  return ap_ra->evfd;
+}
+
+void
+fr_rdahead_clear_event (fr_rdahead_t * ap_ra)
+{
+  uint64_t count = 0;
+  assert (ap_ra);
+  (void) read (ap_ra->evfd, &count, sizeof (count));
+}
+
+bool
+fr_rdahead_ready (fr_rdahead_t * ap_ra)
+{
+  bool ready = false;
+  assert (ap_ra);
+  tiz_mutex_lock (&(ap_ra->mutex));
+  ready = ap_ra->eos || ESlotReady == ap_ra->p_slots[ap_ra->head].state;
+  if (!ready)
+    {
+      ap_ra->waiting = true;
+    }
+  tiz_mutex_unlock (&(ap_ra->mutex));
+  return ready;
+}
+
+OMX_ERRORTYPE
+fr_rdahead_read (fr_rdahead_t * ap_ra, OMX_U8 * ap_dst, const size_t a_len,
+                 size_t * ap_read, bool * ap_eos)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t copied = 0;
+  bool consumed = false;
+
+  assert (ap_ra);
+  assert (ap_dst);
+  assert (ap_read);
+  assert (ap_eos);
+
+  tiz_mutex_lock (&(ap_ra->mutex));
+
+  while (copied < a_len && !ap_ra->eos)
+    {
+      fr_slot_t * p_slot = &(ap_ra->p_slots[ap_ra->head]);
+      size_t n = 0;
+
+      if (ESlotReady != p_slot->state)
+        {
+          ap_ra->waiting = true;
+          break;
+        }
+
+      if (p_slot->err)
+        {
+          TIZ_LOG (TIZ_PRIORITY_ERROR, "Error reading the file (%s)",
+                   strerror (p_slot->err));
+          rc = OMX_ErrorInsufficientResources;
+          break;
+        }
+
+      ap_ra->dirty = true;
+      n = MIN (p_slot->len - ap_ra->pos, a_len - copied);
+      memcpy (ap_dst + copied, p_slot->p_data + ap_ra->pos, n);
+      copied += n;
+      ap_ra->pos += n;
+
+      if (ap_ra->pos == p_slot->len)
+        {
+          /* A short slot is the last one */
+          ap_ra->eos = p_slot->len < ARATELIA_FILE_READER_READAHEAD_SLOT_SIZE;
+          p_slot->state = ESlotEmpty;
+          p_slot->len = 0;
+          ap_ra->pos = 0;
+          ap_ra->head = (ap_ra->head + 1) % ap_ra->nslots;
+          ap_ra->issued--;
+          consumed = true;
+        }
+    }
+
+  if (consumed)
+    {
+      tiz_cond_broadcast (&(ap_ra->cond));
+    }
+
+  *ap_eos = ap_ra->eos;
+
+  tiz_mutex_unlock (&(ap_ra->mutex));
+
+  *ap_read = copied;
+  if (OMX_ErrorNone == rc && 0 == copied && !(*ap_eos))
+    {
+      rc = OMX_ErrorNoMore;
+    }
+  return rc;
+}
+
+void
+fr_rdahead_rewind (fr_rdahead_t * ap_ra)
+{
+  size_t i = 0;
+  assert (ap_ra);
+
+  tiz_mutex_lock (&(ap_ra->mutex));
+
+  if (!ap_ra->dirty)
+    {
+      tiz_mutex_unlock (&(ap_ra->mutex));
+      return;
+    }
+
+  /* Stop issuing, and let the reads in flight land before the slots are
+     recycled */
+  ap_ra->eof_issued = true;
+  while (ap_ra->nreading > 0)
+    {
+      tiz_cond_wait (&(ap_ra->cond), &(ap_ra->mutex));
+    }
+
+  for (i = 0; i < ap_ra->nslots; ++i)
+    {
+      ap_ra->p_slots[i].state = ESlotEmpty;
+      ap_ra->p_slots[i].len = 0;
+      ap_ra->p_slots[i].err = 0;
+    }
+  ap_ra->head = 0;
+  ap_ra->pos = 0;
+  ap_ra->issued = 0;
+  ap_ra->next_off = 0;
+  ap_ra->eof_issued = false;
+  ap_ra->eos = false;
+  ap_ra->dirty = false;
+  ap_ra->waiting = false;
+  tiz_cond_broadcast (&(ap_ra->cond));
+
+  tiz_mutex_unlock (&(ap_ra->mutex));
+
+  fr_rdahead_clear_event (ap_ra);
+}
@@ -0,0 +1,83 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   frrdahead.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Binary file reader's read-ahead engine
+ *
+ * A small pool of threads keeps a window of the file read in advance, split in
+ * fixed-size slots. The component's thread copies out of the slots, never
+ * blocking on the disk; when it finds the next slot still in flight, it is
+ * woken up through an eventfd once that slot has been read.
+ *
+ */
+
+#ifndef FRRDAHEAD_H
+#define FRRDAHEAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct fr_rdahead fr_rdahead_t;
+
+OMX_ERRORTYPE
+fr_rdahead_init (fr_rdahead_t ** app_ra, const int a_fd,
+                 const size_t a_window_size, const OMX_U32 a_nthreads);
+
+void
+fr_rdahead_destroy (fr_rdahead_t * ap_ra);
+
+/* The eventfd that becomes readable when fr_rdahead_read may make progress */
+int
+fr_rdahead_event_fd (const fr_rdahead_t * ap_ra);
+
+void
+fr_rdahead_clear_event (fr_rdahead_t * ap_ra);
+
+/* Whether fr_rdahead_read would make progress now. If not, the eventfd will
+   be signalled once it does. */
+bool
+fr_rdahead_ready (fr_rdahead_t * ap_ra);
+
+/* Copies up to a_len bytes without blocking. Returns OMX_ErrorNoMore with
+   *ap_read == 0 when the data is not there yet (the eventfd will be signalled),
+   and sets *ap_eos once the end of the file has been handed out. */
+OMX_ERRORTYPE
+fr_rdahead_read (fr_rdahead_t * ap_ra, OMX_U8 * ap_dst, const size_t a_len,
+                 size_t * ap_read, bool * ap_eos);
+
+/* Drops the window and starts reading again from the beginning of the file.
+   Nothing is dropped if no data has been handed out since the last rewind. */
+void
+fr_rdahead_rewind (fr_rdahead_t * ap_ra);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRRDAHEAD_H */
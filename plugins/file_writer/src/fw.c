@@ -44,6 +44,7 @@
 
 #include "fw.h"
 #include "fwprc.h"
+#include "fwcfgport.h"
 
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
@@ -139,7 +140,7 @@ instantiate_other_port (OMX_HANDLETYPE ap_hdl)
 static OMX_PTR
 instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 {
-  return factory_new (tiz_get_type (ap_hdl, "tizuricfgport"),
+  return factory_new (tiz_get_type (ap_hdl, "fwcfgport"),
                       NULL, /* this port does not take options */
                       ARATELIA_FILE_WRITER_COMPONENT_NAME, file_writer_version);
 }
@@ -160,7 +161,8 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   const tiz_role_factory_t * rf_list[]
     = {&audio_role, &video_role, &image_role, &other_role};
   tiz_type_factory_t fwprc_type;
-  const tiz_type_factory_t * tf_list[] = {&fwprc_type};
+  tiz_type_factory_t fwcfgport_type;
+  const tiz_type_factory_t * tf_list[] = {&fwprc_type, &fwcfgport_type};
 
   TIZ_LOG (TIZ_PRIORITY_TRACE, "OMX_ComponentInit: [%s]",
            ARATELIA_FILE_WRITER_COMPONENT_NAME);
@@ -194,12 +196,17 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   strcpy ((OMX_STRING) fwprc_type.object_name, "fwprc");
   fwprc_type.pf_object_init = fw_prc_init;
 
+  strcpy ((OMX_STRING) fwcfgport_type.class_name, "fwcfgport_class");
+  fwcfgport_type.pf_class_init = fw_cfgport_class_init;
+  strcpy ((OMX_STRING) fwcfgport_type.object_name, "fwcfgport");
+  fwcfgport_type.pf_object_init = fw_cfgport_init;
+
   /* Initialize the component infrastructure */
   tiz_check_omx (
     tiz_comp_init (ap_hdl, ARATELIA_FILE_WRITER_COMPONENT_NAME));
 
-  /* Register the "fwprc" class */
-  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
+  /* Register the "fwprc" and "fwcfgport" classes */
+  tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 2));
 
   /* Register the various roles */
   tiz_check_omx (tiz_comp_register_roles (ap_hdl, rf_list, 4));
@@ -47,6 +47,12 @@ extern "C" {
 #define ARATELIA_FILE_WRITER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_FILE_WRITER_PORT_ALIGNMENT 0
 #define ARATELIA_FILE_WRITER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_FILE_WRITER_DEFAULT_BLOCK_SIZE (1024 * 1024)
+#define ARATELIA_FILE_WRITER_MIN_BLOCK_SIZE (64 * 1024)
+#define ARATELIA_FILE_WRITER_BLOCK_COUNT 4
+#define ARATELIA_FILE_WRITER_DEFAULT_SYNC_INTERVAL (8 * 1024 * 1024)
+#define ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT 4096
+#define ARATELIA_FILE_WRITER_THREAD_STACK_SIZE (64 * 1024)
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,582 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   fwbatch.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Binary file writer's batching engine
+ *
+ * The blocks form a ring. 'wr' is the first block queued for the writer
+ * thread, 'nqueued' blocks are queued from there, and the block right after
+ * them is the one the component is filling. A full block is queued as soon as
+ * there is a free block to fill next, either by the component or, when the
+ * component is not around, by the writer thread itself.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <tizplatform.h>
+
+#include "fw.h"
+#include "fwbatch.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.file_writer.batch"
+#endif
+
+typedef struct fw_block fw_block_t;
+struct fw_block
+{
+  OMX_U8 * p_data;
+  size_t len;
+  bool final;
+};
+
+struct fw_batch
+{
+  int fd;
+  int evfd;
+  bool direct;
+  OMX_TIZONIA_FILEWRITERMODETYPE mode;
+  size_t block_size;
+  fw_block_t blocks[ARATELIA_FILE_WRITER_BLOCK_COUNT];
+  size_t wr;
+  size_t nqueued;
+  off_t off;
+  OMX_U64 since_sync;
+  int err;
+  bool waiting;    /* the component found no room in the blocks */
+  bool final_done;
+  bool stop;
+  OMX_TIZONIA_FILEWRITERSTATSTYPE stats;
+  tiz_mutex_t mutex;
+  tiz_cond_t cond;
+  tiz_thread_t thread;
+  bool started;
+};
+
+static inline void
+signal_event (const int a_fd)
+{
+  const uint64_t one = 1;
+  (void) write (a_fd, &one, sizeof (one));
+}
+
+static inline OMX_U64
+now_us (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline fw_block_t *
+fill_block (fw_batch_t * ap_batch)
+{
+  return &(ap_batch->blocks[(ap_batch->wr + ap_batch->nqueued)
+                            % ARATELIA_FILE_WRITER_BLOCK_COUNT]);
+}
+
+static inline bool
+can_queue (const fw_batch_t * ap_batch)
+{
+  /* One block must stay available for the component to fill */
+  return ap_batch->nqueued < ARATELIA_FILE_WRITER_BLOCK_COUNT - 1;
+}
+
+static inline void
+queue_fill_block (fw_batch_t * ap_batch)
+{
+  assert (can_queue (ap_batch));
+  ap_batch->nqueued++;
+  tiz_cond_broadcast (&(ap_batch->cond));
+}
+
+static int
+sync_file (fw_batch_t * ap_batch)
+{
+  return OMX_TRUE == ap_batch->mode.bDataSyncOnly ? fdatasync (ap_batch->fd)
+                                                  : fsync (ap_batch->fd);
+}
+
+static int
+write_blocks (fw_batch_t * ap_batch, struct iovec * ap_iov, int a_niov,
+              size_t a_total, off_t a_off)
+{
+  if (ap_batch->direct)
+    {
+      int i = 0;
+      bool aligned = 0 == a_off % ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT;
+      for (i = 0; i < a_niov; ++i)
+        {
+          aligned
+            = aligned
+              && 0 == ap_iov[i].iov_len % ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT;
+        }
+      if (!aligned)
+        {
+          /* A partial block was flushed; from here on the offsets are not
+             aligned, so carry on through the page cache */
+          int flags = fcntl (ap_batch->fd, F_GETFL);
+          (void) fcntl (ap_batch->fd, F_SETFL, flags & ~O_DIRECT);
+          ap_batch->direct = false;
+        }
+    }
+
+  while (a_total > 0)
+    {
+      ssize_t n = pwritev (ap_batch->fd, ap_iov, a_niov, a_off);
+      if (n < 0 && EINTR == errno)
+        {
+          continue;
+        }
+      if (n <= 0)
+        {
+          return n < 0 ? errno : EIO;
+        }
+      /* Short write; skip what made it */
+      a_total -= n;
+      a_off += n;
+      while (a_niov > 0 && (size_t) n >= ap_iov->iov_len)
+        {
+          n -= ap_iov->iov_len;
+          ap_iov++;
+          a_niov--;
+        }
+      if (a_niov > 0)
+        {
+          ap_iov->iov_base = (OMX_U8 *) ap_iov->iov_base + n;
+          ap_iov->iov_len -= n;
+        }
+    }
+  return 0;
+}
+
+static void *
+writer_thread_func (void * ap_arg)
+{
+  fw_batch_t * p_batch = ap_arg;
+  assert (p_batch);
+
+  tiz_mutex_lock (&(p_batch->mutex));
+  for (;;)
+    {
+      struct iovec iov[ARATELIA_FILE_WRITER_BLOCK_COUNT];
+      size_t nblocks = 0;
+      size_t total = 0;
+      size_t i = 0;
+      bool final = false;
+      bool do_sync = false;
+      off_t off = 0;
+      OMX_U64 start = 0;
+      OMX_U64 elapsed = 0;
+      int err = 0;
+      int niov = 0;
+
+      while (!p_batch->stop && 0 == p_batch->nqueued)
+        {
+          tiz_cond_wait (&(p_batch->cond), &(p_batch->mutex));
+        }
+
+      if (p_batch->stop)
+        {
+          break;
+        }
+
+      /* Write out everything queued so far with a single call */
+      nblocks = p_batch->nqueued;
+      for (i = 0; i < nblocks; ++i)
+        {
+          fw_block_t * p_blk
+            = &(p_batch->blocks[(p_batch->wr + i)
+                                % ARATELIA_FILE_WRITER_BLOCK_COUNT]);
+          if (p_blk->len > 0)
+            {
+              iov[niov].iov_base = p_blk->p_data;
+              iov[niov].iov_len = p_blk->len;
+              total += p_blk->len;
+              niov++;
+            }
+          final = final || p_blk->final;
+        }
+      off = p_batch->off;
+      tiz_mutex_unlock (&(p_batch->mutex));
+
+      start = now_us ();
+      if (total > 0)
+        {
+          err = write_blocks (p_batch, iov, niov, total, off);
+        }
+      p_batch->since_sync += total;
+      do_sync = (OMX_TIZONIA_FileWriterSyncNone != p_batch->mode.eSyncPolicy
+                 && final)
+                || (OMX_TIZONIA_FileWriterSyncPeriodic
+                      == p_batch->mode.eSyncPolicy
+                    && p_batch->since_sync >= p_batch->mode.nSyncInterval);
+      if (0 == err && do_sync)
+        {
+          err = 0 == sync_file (p_batch) ? 0 : errno;
+          p_batch->since_sync = 0;
+        }
+      elapsed = now_us () - start;
+
+      tiz_mutex_lock (&(p_batch->mutex));
+      if (err && !p_batch->err)
+        {
+          p_batch->err = err;
+        }
+      p_batch->off += total;
+      p_batch->stats.nBytesWritten += total;
+      p_batch->stats.nWrites += total > 0 ? 1 : 0;
+      p_batch->stats.nSyncs += do_sync ? 1 : 0;
+      p_batch->stats.nMaxWriteTimeUs
+        = MAX (p_batch->stats.nMaxWriteTimeUs, (OMX_U32) elapsed);
+      for (i = 0; i < nblocks; ++i)
+        {
+          fw_block_t * p_blk = &(p_batch->blocks[p_batch->wr]);
+          p_blk->len = 0;
+          p_blk->final = false;
+          p_batch->wr = (p_batch->wr + 1) % ARATELIA_FILE_WRITER_BLOCK_COUNT;
+        }
+      p_batch->nqueued -= nblocks;
+
+      if (fill_block (p_batch)->len == p_batch->block_size
+          && can_queue (p_batch))
+        {
+          queue_fill_block (p_batch);
+        }
+
+      if (final || p_batch->waiting || err)
+        {
+          p_batch->final_done = p_batch->final_done || final;
+          p_batch->waiting = false;
+          signal_event (p_batch->evfd);
+        }
+      /* fw_batch_write and fw_batch_drain may be waiting */
+      tiz_cond_broadcast (&(p_batch->cond));
+    }
+  tiz_mutex_unlock (&(p_batch->mutex));
+
+  return NULL;
+}
+
+OMX_ERRORTYPE
+fw_batch_init (fw_batch_t ** app_batch, const int a_fd,
+               const OMX_TIZONIA_FILEWRITERMODETYPE * ap_mode)
+{
+  fw_batch_t * p_batch = NULL;
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  size_t i = 0;
+
+  assert (app_batch);
+  assert (a_fd >= 0);
+  assert (ap_mode);
+
+  p_batch = tiz_mem_calloc (1, sizeof (fw_batch_t));
+  tiz_check_null_ret_oom (p_batch != NULL);
+
+  p_batch->fd = a_fd;
+  p_batch->evfd = -1;
+  p_batch->mode = *ap_mode;
+  p_batch->direct = (fcntl (a_fd, F_GETFL) & O_DIRECT) != 0;
+  /* Full blocks must be valid O_DIRECT transfers */
+  p_batch->block_size
+    = ((MAX (ap_mode->nBlockSize, ARATELIA_FILE_WRITER_MIN_BLOCK_SIZE)
+        + ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT - 1)
+       / ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT)
+      * ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT;
+  p_batch->stats.nSize = sizeof (OMX_TIZONIA_FILEWRITERSTATSTYPE);
+  p_batch->stats.nVersion.nVersion = OMX_VERSION;
+
+  if (OMX_ErrorNone != tiz_mutex_init (&(p_batch->mutex)))
+    {
+      tiz_mem_free (p_batch);
+      return OMX_ErrorInsufficientResources;
+    }
+  if (OMX_ErrorNone != tiz_cond_init (&(p_batch->cond)))
+    {
+      tiz_mutex_destroy (&(p_batch->mutex));
+      tiz_mem_free (p_batch);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  p_batch->evfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (p_batch->evfd < 0)
+    {
+      goto end;
+    }
+
+  for (i = 0; i < ARATELIA_FILE_WRITER_BLOCK_COUNT; ++i)
+    {
+      void * p_data = NULL;
+      if (0 != posix_memalign (&p_data, ARATELIA_FILE_WRITER_DIRECT_IO_ALIGNMENT,
+                               p_batch->block_size))
+        {
+          goto end;
+        }
+      p_batch->blocks[i].p_data = p_data;
+    }
+
+  if (OMX_ErrorNone
+      != tiz_thread_create (&(p_batch->thread),
+                            ARATELIA_FILE_WRITER_THREAD_STACK_SIZE, 0,
+                            writer_thread_func, p_batch))
+    {
+      goto end;
+    }
+  p_batch->started = true;
+  (void) tiz_thread_setname (&(p_batch->thread), (const OMX_STRING) "tizfwbatch");
+
+  rc = OMX_ErrorNone;
+
+end:
+
+  if (OMX_ErrorNone != rc)
+    {
+      fw_batch_destroy (p_batch);
+      p_batch = NULL;
+    }
+
+  *app_batch = p_batch;
+  return rc;
+}
+
+void
+fw_batch_destroy (fw_batch_t * ap_batch)
+{
+  size_t i = 0;
+
+  if (!ap_batch)
+    {
+      return;
+    }
+
+  if (ap_batch->started)
+    {
+      OMX_PTR p_result = NULL;
+      tiz_mutex_lock (&(ap_batch->mutex));
+      ap_batch->stop = true;
+      tiz_cond_broadcast (&(ap_batch->cond));
+      tiz_mutex_unlock (&(ap_batch->mutex));
+      (void) tiz_thread_join (&(ap_batch->thread), &p_result);
+      ap_batch->started = false;
+    }
+
+  for (i = 0; i < ARATELIA_FILE_WRITER_BLOCK_COUNT; ++i)
+    {
+      free (ap_batch->blocks[i].p_data);
+    }
+
+  if (ap_batch->evfd >= 0)
+    {
+      close (ap_batch->evfd);
+    }
+
+  tiz_cond_destroy (&(ap_batch->cond));
+  tiz_mutex_destroy (&(ap_batch->mutex));
+  tiz_mem_free (ap_batch);
+}
+
+int
+fw_batch_event_fd (const fw_batch_t * ap_batch)
+{
+  assert (ap_batch);
+  return ap_batch->evfd;
+}
+
+void
+fw_batch_clear_event (fw_batch_t * ap_batch)
+{
+  uint64_t count = 0;
+  assert (ap_batch);
+  (void) read (ap_batch->evfd, &count, sizeof (count));
+}
+
+bool
+fw_batch_has_room (fw_batch_t * ap_batch, const size_t a_len)
+{
+  size_t room = 0;
+  bool has_room = false;
+  assert (ap_batch);
+
+  tiz_mutex_lock (&(ap_batch->mutex));
+  room = ap_batch->block_size - fill_block (ap_batch)->len
+         + (ARATELIA_FILE_WRITER_BLOCK_COUNT - 1 - ap_batch->nqueued)
+             * ap_batch->block_size;
+  /* Anything larger than a block may still wait for the writer thread in
+     fw_batch_write */
+  has_room = ap_batch->err || room >= MIN (a_len, ap_batch->block_size);
+  if (!has_room)
+    {
+      ap_batch->waiting = true;
+    }
+  tiz_mutex_unlock (&(ap_batch->mutex));
+  return has_room;
+}
+
+OMX_ERRORTYPE
+fw_batch_write (fw_batch_t * ap_batch, const OMX_U8 * ap_data,
+                const size_t a_len)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  size_t done = 0;
+  bool stalled = false;
+
+  assert (ap_batch);
+  assert (ap_data || 0 == a_len);
+
+  tiz_mutex_lock (&(ap_batch->mutex));
+  while (done < a_len && !ap_batch->err)
+    {
+      fw_block_t * p_blk = fill_block (ap_batch);
+      size_t n = 0;
+
+      if (p_blk->len == ap_batch->block_size)
+        {
+          if (can_queue (ap_batch))
+            {
+              queue_fill_block (ap_batch);
+            }
+          else
+            {
+              stalled = true;
+              tiz_cond_wait (&(ap_batch->cond), &(ap_batch->mutex));
+            }
+          continue;
+        }
+
+      n = MIN (ap_batch->block_size - p_blk->len, a_len - done);
+      memcpy (p_blk->p_data + p_blk->len, ap_data + done, n);
+      p_blk->len += n;
+      done += n;
+
+      if (p_blk->len == ap_batch->block_size && can_queue (ap_batch))
+        {
+          queue_fill_block (ap_batch);
+        }
+    }
+
+  if (ap_batch->err)
+    {
+      TIZ_LOG (TIZ_PRIORITY_ERROR, "Error writing the file (%s)",
+               strerror (ap_batch->err));
+      rc = OMX_ErrorInsufficientResources;
+    }
+  ap_batch->stats.nStalls += stalled ? 1 : 0;
+  tiz_mutex_unlock (&(ap_batch->mutex));
+
+  return rc;
+}
+
+OMX_ERRORTYPE
+fw_batch_flush (fw_batch_t * ap_batch, const bool a_final)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_batch);
+
+  tiz_mutex_lock (&(ap_batch->mutex));
+  while (!can_queue (ap_batch) && !ap_batch->err)
+    {
+      tiz_cond_wait (&(ap_batch->cond), &(ap_batch->mutex));
+    }
+  if (ap_batch->err)
+    {
+      rc = OMX_ErrorInsufficientResources;
+    }
+  else if (fill_block (ap_batch)->len > 0 || a_final)
+    {
+      /* An empty final block still gets the file synced */
+      fill_block (ap_batch)->final = a_final;
+      queue_fill_block (ap_batch);
+    }
+  tiz_mutex_unlock (&(ap_batch->mutex));
+
+  return rc;
+}
+
+bool
+fw_batch_final_done (fw_batch_t * ap_batch)
+{
+  bool done = false;
+  assert (ap_batch);
+  tiz_mutex_lock (&(ap_batch->mutex));
+  done = ap_batch->final_done;
+  ap_batch->final_done = false;
+  tiz_mutex_unlock (&(ap_batch->mutex));
+  return done;
+}
+
+OMX_ERRORTYPE
+fw_batch_drain (fw_batch_t * ap_batch)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_batch);
+
+  tiz_check_omx (fw_batch_flush (ap_batch, false));
+
+  tiz_mutex_lock (&(ap_batch->mutex));
+  while (ap_batch->nqueued > 0 && !ap_batch->err)
+    {
+      tiz_cond_wait (&(ap_batch->cond), &(ap_batch->mutex));
+    }
+  if (ap_batch->err)
+    {
+      rc = OMX_ErrorInsufficientResources;
+    }
+  tiz_mutex_unlock (&(ap_batch->mutex));
+
+  return rc;
+}
+
+void
+fw_batch_get_stats (fw_batch_t * ap_batch,
+                    OMX_TIZONIA_FILEWRITERSTATSTYPE * ap_stats)
+{
+  size_t i = 0;
+  assert (ap_batch);
+  assert (ap_stats);
+
+  tiz_mutex_lock (&(ap_batch->mutex));
+  *ap_stats = ap_batch->stats;
+  ap_stats->nBytesQueued = 0;
+  for (i = 0; i <= ap_batch->nqueued; ++i)
+    {
+      ap_stats->nBytesQueued
+        += ap_batch->blocks[(ap_batch->wr + i)
+                            % ARATELIA_FILE_WRITER_BLOCK_COUNT].len;
+    }
+  tiz_mutex_unlock (&(ap_batch->mutex));
+}
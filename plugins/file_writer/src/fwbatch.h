@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   fwbatch.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - Binary file writer's batching engine
+ *
+ * The component's thread copies the buffers' data into large blocks, and a
+ * separate thread writes out the filled blocks (several per pwritev call when
+ * they queue up) and syncs the file according to the configured policy.
+ *
+ */
+
+#ifndef FWBATCH_H
+#define FWBATCH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+#include <OMX_TizoniaExt.h>
+
+typedef struct fw_batch fw_batch_t;
+
+OMX_ERRORTYPE
+fw_batch_init (fw_batch_t ** app_batch, const int a_fd,
+               const OMX_TIZONIA_FILEWRITERMODETYPE * ap_mode);
+
+/* Joins the writer thread; the data not flushed yet is discarded */
+void
+fw_batch_destroy (fw_batch_t * ap_batch);
+
+/* The eventfd that becomes readable when room is made in the blocks, and
+   when a final flush completes */
+int
+fw_batch_event_fd (const fw_batch_t * ap_batch);
+
+void
+fw_batch_clear_event (fw_batch_t * ap_batch);
+
+/* Whether a_len bytes can be written without waiting. If not, the eventfd
+   will be signalled once they can. */
+bool
+fw_batch_has_room (fw_batch_t * ap_batch, const size_t a_len);
+
+/* Copies the data into the blocks, waiting for the writer thread if they are
+   full. Fails if a previous write or sync failed. */
+OMX_ERRORTYPE
+fw_batch_write (fw_batch_t * ap_batch, const OMX_U8 * ap_data,
+                const size_t a_len);
+
+/* Hands the partially filled block to the writer thread. A final flush also
+   syncs the file unless the policy is OMX_TIZONIA_FileWriterSyncNone, and
+   signals the eventfd once everything is on disk. */
+OMX_ERRORTYPE
+fw_batch_flush (fw_batch_t * ap_batch, const bool a_final);
+
+/* Whether the last final flush has completed; clears the condition */
+bool
+fw_batch_final_done (fw_batch_t * ap_batch);
+
+/* Flushes and waits until the writer thread has written everything */
+OMX_ERRORTYPE
+fw_batch_drain (fw_batch_t * ap_batch);
+
+void
+fw_batch_get_stats (fw_batch_t * ap_batch,
+                    OMX_TIZONIA_FILEWRITERSTATSTYPE * ap_stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FWBATCH_H */
@@ -0,0 +1,309 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   fwcfgport.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief A specialised config port class for the binary file writer component
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tizplatform.h>
+
+#include <tizport.h>
+
+#include "fw.h"
+#include "fwcfgport.h"
+#include "fwcfgport_decls.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.file_writer.cfgport"
+#endif
+
+static const char *
+get_config_value (const char * ap_key)
+{
+  return tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+}
+
+static OMX_U32
+get_u32_config_value (const char * ap_key, const OMX_U32 a_default)
+{
+  const char * p_value = get_config_value (ap_key);
+  return p_value ? (OMX_U32) strtoul (p_value, NULL, 10) : a_default;
+}
+
+static OMX_BOOL
+get_bool_config_value (const char * ap_key)
+{
+  const char * p_value = get_config_value (ap_key);
+  return (p_value && 0 == strncmp (p_value, "true", strlen ("true")))
+           ? OMX_TRUE
+           : OMX_FALSE;
+}
+
+static OMX_TIZONIA_FILEWRITERSYNCPOLICY
+sync_policy_from_str (const char * ap_str)
+{
+  OMX_TIZONIA_FILEWRITERSYNCPOLICY policy = OMX_TIZONIA_FileWriterSyncNone;
+  if (ap_str)
+    {
+      if (0 == strncmp (ap_str, "eos", strlen ("eos")))
+        {
+          policy = OMX_TIZONIA_FileWriterSyncOnEos;
+        }
+      else if (0 == strncmp (ap_str, "periodic", strlen ("periodic")))
+        {
+          policy = OMX_TIZONIA_FileWriterSyncPeriodic;
+        }
+    }
+  return policy;
+}
+
+static void
+sanitize_mode (OMX_TIZONIA_FILEWRITERMODETYPE * ap_mode)
+{
+  assert (ap_mode);
+  if (ap_mode->eMode > OMX_TIZONIA_FileWriterModeBatched)
+    {
+      ap_mode->eMode = OMX_TIZONIA_FileWriterModeSync;
+    }
+  if (ap_mode->eSyncPolicy > OMX_TIZONIA_FileWriterSyncPeriodic)
+    {
+      ap_mode->eSyncPolicy = OMX_TIZONIA_FileWriterSyncNone;
+    }
+  ap_mode->nBlockSize
+    = MAX (ap_mode->nBlockSize, ARATELIA_FILE_WRITER_MIN_BLOCK_SIZE);
+  if (0 == ap_mode->nSyncInterval)
+    {
+      ap_mode->nSyncInterval = ARATELIA_FILE_WRITER_DEFAULT_SYNC_INTERVAL;
+    }
+}
+
+/*
+ * fwcfgport class
+ */
+
+static void *
+fw_cfgport_ctor (void * ap_obj, va_list * app)
+{
+  fw_cfgport_t * p_obj = super_ctor (typeOf (ap_obj, "fwcfgport"), ap_obj, app);
+  const char * p_mode = NULL;
+
+  assert (p_obj);
+
+  tiz_check_omx_ret_null (
+    tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigFileWriterMode));
+  tiz_check_omx_ret_null (tiz_port_register_index (
+    p_obj, OMX_TizoniaIndexConfigFileWriterStats)); /* read-only */
+
+  /* Initialize the OMX_TIZONIA_FILEWRITERMODETYPE structure with the defaults
+     found in the configuration file */
+  TIZ_INIT_OMX_STRUCT (p_obj->mode_);
+  p_mode = get_config_value ("OMX.Aratelia.file_writer.binary.mode");
+  p_obj->mode_.eMode
+    = (p_mode && 0 == strncmp (p_mode, "batched", strlen ("batched")))
+        ? OMX_TIZONIA_FileWriterModeBatched
+        : OMX_TIZONIA_FileWriterModeSync;
+  p_obj->mode_.nBlockSize
+    = get_u32_config_value ("OMX.Aratelia.file_writer.binary.block_kb",
+                            ARATELIA_FILE_WRITER_DEFAULT_BLOCK_SIZE / 1024)
+      * 1024;
+  p_obj->mode_.bDirectIO
+    = get_bool_config_value ("OMX.Aratelia.file_writer.binary.direct_io");
+  p_obj->mode_.eSyncPolicy = sync_policy_from_str (
+    get_config_value ("OMX.Aratelia.file_writer.binary.sync"));
+  p_obj->mode_.nSyncInterval
+    = get_u32_config_value ("OMX.Aratelia.file_writer.binary.sync_interval_kb",
+                            ARATELIA_FILE_WRITER_DEFAULT_SYNC_INTERVAL / 1024)
+      * 1024;
+  p_obj->mode_.bDataSyncOnly
+    = get_bool_config_value ("OMX.Aratelia.file_writer.binary.fdatasync");
+  sanitize_mode (&(p_obj->mode_));
+
+  TIZ_INIT_OMX_STRUCT (p_obj->stats_);
+
+  return p_obj;
+}
+
+static void *
+fw_cfgport_dtor (void * ap_obj)
+{
+  return super_dtor (typeOf (ap_obj, "fwcfgport"), ap_obj);
+}
+
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+fw_cfgport_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  const fw_cfgport_t * p_obj = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "GetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigFileWriterMode == a_index)
+    {
+      memcpy (ap_struct, &(p_obj->mode_),
+              sizeof (OMX_TIZONIA_FILEWRITERMODETYPE));
+    }
+  else if (OMX_TizoniaIndexConfigFileWriterStats == a_index)
+    {
+      memcpy (ap_struct, &(p_obj->stats_),
+              sizeof (OMX_TIZONIA_FILEWRITERSTATSTYPE));
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_GetConfig (typeOf (ap_obj, "fwcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+static OMX_ERRORTYPE
+fw_cfgport_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                      OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  fw_cfgport_t * p_obj = (fw_cfgport_t *) ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+
+  assert (p_obj);
+
+  TIZ_TRACE (ap_hdl, "SetConfig [%s]...", tiz_idx_to_str (a_index));
+
+  if (OMX_TizoniaIndexConfigFileWriterMode == a_index)
+    {
+      memcpy (&(p_obj->mode_), ap_struct,
+              sizeof (OMX_TIZONIA_FILEWRITERMODETYPE));
+      sanitize_mode (&(p_obj->mode_));
+    }
+  else if (OMX_TizoniaIndexConfigFileWriterStats == a_index)
+    {
+      /* The stats are read-only for IL clients */
+      rc = OMX_ErrorUnsupportedSetting;
+    }
+  else
+    {
+      /* Delegate to the base port */
+      rc = super_SetConfig (typeOf (ap_obj, "fwcfgport"), ap_obj, ap_hdl,
+                            a_index, ap_struct);
+    }
+
+  return rc;
+}
+
+/*
+ * from tiz_port
+ */
+
+static OMX_ERRORTYPE
+fw_cfgport_SetConfig_internal (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                               OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  fw_cfgport_t * p_obj = (fw_cfgport_t *) ap_obj;
+
+  assert (p_obj);
+  assert (ap_struct);
+
+  if (OMX_TizoniaIndexConfigFileWriterStats == a_index)
+    {
+      /* This is how the processor publishes the writer's stats */
+      p_obj->stats_ = *((OMX_TIZONIA_FILEWRITERSTATSTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+
+  return tiz_api_SetConfig (ap_obj, ap_hdl, a_index, ap_struct);
+}
+
+/*
+ * fw_cfgport_class
+ */
+
+static void *
+fw_cfgport_class_ctor (void * ap_obj, va_list * app)
+{
+  /* NOTE: Class methods might be added in the future. None for now. */
+  return super_ctor (typeOf (ap_obj, "fwcfgport_class"), ap_obj, app);
+}
+
+/*
+ * initialization
+ */
+
+void *
+fw_cfgport_class_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * fwcfgport_class = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (classOf (tizuricfgport), "fwcfgport_class", classOf (tizuricfgport),
+     sizeof (fw_cfgport_class_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, fw_cfgport_class_ctor,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+  return fwcfgport_class;
+}
+
+void *
+fw_cfgport_init (void * ap_tos, void * ap_hdl)
+{
+  void * tizuricfgport = tiz_get_type (ap_hdl, "tizuricfgport");
+  void * fwcfgport_class = tiz_get_type (ap_hdl, "fwcfgport_class");
+  TIZ_LOG_CLASS (fwcfgport_class);
+  void * fwcfgport = factory_new
+    /* TIZ_CLASS_COMMENT: class type, class name, parent, size */
+    (fwcfgport_class, "fwcfgport", tizuricfgport, sizeof (fw_cfgport_t),
+     /* TIZ_CLASS_COMMENT: */
+     ap_tos, ap_hdl,
+     /* TIZ_CLASS_COMMENT: class constructor */
+     ctor, fw_cfgport_ctor,
+     /* TIZ_CLASS_COMMENT: class destructor */
+     dtor, fw_cfgport_dtor,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, fw_cfgport_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, fw_cfgport_SetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_port_SetConfig_internal, fw_cfgport_SetConfig_internal,
+     /* TIZ_CLASS_COMMENT: stop value*/
+     0);
+
+  return fwcfgport;
+}
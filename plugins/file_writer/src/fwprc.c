@@ -35,6 +35,9 @@
 #include <errno.h>
 #include <limits.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <OMX_Core.h>
 
@@ -95,6 +98,162 @@ obtain_uri (fw_prc_t * ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE
+obtain_mode (fw_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+
+  TIZ_INIT_OMX_STRUCT (ap_prc->mode_);
+  if (OMX_ErrorNone
+      != (rc = tiz_api_GetConfig (tiz_get_krn (handleOf (ap_prc)),
+                                  handleOf (ap_prc),
+                                  OMX_TizoniaIndexConfigFileWriterMode,
+                                  &(ap_prc->mode_))))
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[%s] : Error retrieving the writer mode from the port",
+                 tiz_err_to_str (rc));
+    }
+  return rc;
+}
+
+static OMX_ERRORTYPE
+open_file (fw_prc_t * ap_prc)
+{
+  const char * p_path = NULL;
+  assert (ap_prc);
+  assert (ap_prc->p_uri_param_);
+
+  p_path = (const char *) ap_prc->p_uri_param_->contentURI;
+
+  if (OMX_TIZONIA_FileWriterModeBatched == ap_prc->mode_.eMode)
+    {
+      const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+      if (OMX_TRUE == ap_prc->mode_.bDirectIO)
+        {
+          ap_prc->fd_ = open (p_path, flags | O_DIRECT, 0666);
+          if (ap_prc->fd_ < 0 && EINVAL == errno)
+            {
+              TIZ_NOTICE (handleOf (ap_prc),
+                          "O_DIRECT not supported by this filesystem");
+            }
+        }
+      if (ap_prc->fd_ < 0)
+        {
+          ap_prc->fd_ = open (p_path, flags, 0666);
+        }
+      if (ap_prc->fd_ < 0)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Error opening file from URI (%s)",
+                     strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+      tiz_check_omx (fw_batch_init (&(ap_prc->p_batch_), ap_prc->fd_,
+                                    &(ap_prc->mode_)));
+      /* The writer thread wakes up the component through this eventfd */
+      tiz_check_omx (tiz_srv_io_watcher_init (
+        ap_prc, &(ap_prc->p_ev_io_), fw_batch_event_fd (ap_prc->p_batch_),
+        TIZ_EVENT_READ, false));
+    }
+  else if ((ap_prc->p_file_ = fopen (p_path, "w")) == 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc), "Error opening file from URI (%s)",
+                 strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  return OMX_ErrorNone;
+}
+
+static void
+close_file (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->p_batch_)
+    {
+      (void) fw_batch_drain (ap_prc->p_batch_);
+      fw_batch_destroy (ap_prc->p_batch_);
+      ap_prc->p_batch_ = NULL;
+    }
+
+  if (ap_prc->p_ev_io_)
+    {
+      tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_ev_io_);
+      ap_prc->p_ev_io_ = NULL;
+    }
+
+  if (ap_prc->fd_ >= 0)
+    {
+      close (ap_prc->fd_);
+      ap_prc->fd_ = -1;
+    }
+
+  if (ap_prc->p_file_)
+    {
+      fclose (ap_prc->p_file_);
+      ap_prc->p_file_ = NULL;
+    }
+}
+
+static void
+publish_stats (fw_prc_t * ap_prc)
+{
+  OMX_TIZONIA_FILEWRITERSTATSTYPE stats;
+  assert (ap_prc);
+
+  if (ap_prc->p_batch_)
+    {
+      fw_batch_get_stats (ap_prc->p_batch_, &stats);
+    }
+  else
+    {
+      stats = ap_prc->stats_;
+    }
+  (void) tiz_krn_SetConfig_internal (tiz_get_krn (handleOf (ap_prc)),
+                                     handleOf (ap_prc),
+                                     OMX_TizoniaIndexConfigFileWriterStats,
+                                     &stats);
+}
+
+static inline OMX_U64
+now_us (void)
+{
+  struct timespec ts;
+  (void) clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (OMX_U64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static OMX_ERRORTYPE
+sync_stdio_file (fw_prc_t * ap_prc, const bool a_eos)
+{
+  const OMX_TIZONIA_FILEWRITERSYNCPOLICY policy = ap_prc->mode_.eSyncPolicy;
+  assert (ap_prc);
+  assert (ap_prc->p_file_);
+
+  if ((a_eos && OMX_TIZONIA_FileWriterSyncNone != policy)
+      || (OMX_TIZONIA_FileWriterSyncPeriodic == policy
+          && ap_prc->since_sync_ >= ap_prc->mode_.nSyncInterval))
+    {
+      const OMX_U64 start = now_us ();
+      const int fd = fileno (ap_prc->p_file_);
+      if (0 != fflush (ap_prc->p_file_)
+          || 0 != (OMX_TRUE == ap_prc->mode_.bDataSyncOnly ? fdatasync (fd)
+                                                           : fsync (fd)))
+        {
+          TIZ_ERROR (handleOf (ap_prc), "Error syncing the file (%s)",
+                     strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+      ap_prc->since_sync_ = 0;
+      ap_prc->stats_.nSyncs++;
+      ap_prc->stats_.nMaxWriteTimeUs
+        = MAX (ap_prc->stats_.nMaxWriteTimeUs, (OMX_U32) (now_us () - start));
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * fwprc
  */
@@ -108,6 +267,17 @@ fw_proc_ctor (void * ap_obj, va_list * app)
   p_prc->p_uri_param_ = NULL;
   p_prc->counter_ = 0;
   p_prc->eos_ = false;
+  p_prc->fd_ = -1;
+  TIZ_INIT_OMX_STRUCT (p_prc->mode_);
+  p_prc->mode_.eMode = OMX_TIZONIA_FileWriterModeSync;
+  TIZ_INIT_OMX_STRUCT (p_prc->stats_);
+  p_prc->since_sync_ = 0;
+  p_prc->p_batch_ = NULL;
+  p_prc->p_ev_io_ = NULL;
+  p_prc->p_stats_timer_ = NULL;
+  p_prc->max_buf_len_ = 0;
+  p_prc->eos_flags_ = 0;
+  p_prc->eos_pending_ = false;
   return p_prc;
 }
 
@@ -117,9 +287,11 @@ fw_proc_dtor (void * ap_obj)
   fw_prc_t * p_prc = ap_obj;
   assert (p_prc);
 
-  if (p_prc->p_file_)
+  close_file (p_prc);
+
+  if (p_prc->p_stats_timer_)
     {
-      fclose (p_prc->p_file_);
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_stats_timer_);
     }
 
   if (p_prc->p_uri_param_)
@@ -136,9 +308,18 @@ fw_proc_write_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
   fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
   assert (p_prc);
 
-  if (p_prc->p_file_ && !(p_prc->eos_) && p_hdr->nFilledLen > 0)
+  if (p_prc->p_batch_ && !(p_prc->eos_))
+    {
+      tiz_check_omx (fw_batch_write (p_prc->p_batch_,
+                                     p_hdr->pBuffer + p_hdr->nOffset,
+                                     p_hdr->nFilledLen));
+      p_prc->counter_ += p_hdr->nFilledLen;
+      p_hdr->nFilledLen = 0;
+    }
+  else if (p_prc->p_file_ && !(p_prc->eos_) && p_hdr->nFilledLen > 0)
     {
       int elems_written = 0;
+      const OMX_U64 start = now_us ();
       if (1 != (elems_written = fwrite (p_hdr->pBuffer + p_hdr->nOffset,
                                         p_hdr->nFilledLen, 1, p_prc->p_file_)))
         {
@@ -149,13 +330,20 @@ fw_proc_write_buffer (const void * ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
           return OMX_ErrorInsufficientResources;
         }
 
-      p_hdr->nFilledLen = 0;
       p_prc->counter_ += p_hdr->nFilledLen;
+      p_prc->since_sync_ += p_hdr->nFilledLen;
+      p_prc->stats_.nBytesWritten += p_hdr->nFilledLen;
+      p_prc->stats_.nWrites++;
+      p_prc->stats_.nMaxWriteTimeUs
+        = MAX (p_prc->stats_.nMaxWriteTimeUs, (OMX_U32) (now_us () - start));
 
       TIZ_TRACE (handleOf (p_prc),
                  "Writing data from HEADER [%p]...nFilledLen [%d] "
                  "counter [%d] elems_written [%d]",
                  p_hdr, p_hdr->nFilledLen, p_prc->counter_, elems_written);
+
+      p_hdr->nFilledLen = 0;
+      tiz_check_omx (sync_stdio_file (p_prc, false));
     }
 
   return OMX_ErrorNone;
@@ -172,16 +360,20 @@ fw_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
   assert (ap_obj);
 
   tiz_check_omx (obtain_uri (p_prc));
+  tiz_check_omx (obtain_mode (p_prc));
+  tiz_check_omx (open_file (p_prc));
 
-  if ((p_prc->p_file_
-       = fopen ((const char *) p_prc->p_uri_param_->contentURI, "w"))
-      == 0)
+  if (!p_prc->p_stats_timer_)
     {
-      TIZ_ERROR (handleOf (p_prc), "Error opening file from URI (%s)",
-                 strerror (errno));
-      return OMX_ErrorInsufficientResources;
+      tiz_check_omx (
+        tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_stats_timer_)));
     }
 
+  TIZ_NOTICE (handleOf (p_prc), "mode [%d] block [%u] direct [%s] sync [%d]",
+              p_prc->mode_.eMode, p_prc->mode_.nBlockSize,
+              OMX_TRUE == p_prc->mode_.bDirectIO ? "YES" : "NO",
+              p_prc->mode_.eSyncPolicy);
+
   return OMX_ErrorNone;
 }
 
@@ -191,11 +383,7 @@ fw_proc_deallocate_resources (void * ap_obj)
   fw_prc_t * p_prc = ap_obj;
   assert (ap_obj);
 
-  if (p_prc->p_file_)
-    {
-      fclose (p_prc->p_file_);
-      p_prc->p_file_ = NULL;
-    }
+  close_file (p_prc);
 
   tiz_mem_free (p_prc->p_uri_param_);
   p_prc->p_uri_param_ = NULL;
@@ -220,51 +408,148 @@ fw_proc_transfer_and_process (void * ap_obj, OMX_U32 a_pid)
   assert (ap_obj);
   p_prc->counter_ = 0;
   p_prc->eos_ = false;
+  p_prc->eos_pending_ = false;
+  if (p_prc->p_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_start (p_prc, p_prc->p_ev_io_));
+    }
+  if (p_prc->p_stats_timer_)
+    {
+      tiz_check_omx (tiz_srv_timer_watcher_start (
+        p_prc, p_prc->p_stats_timer_, 1.0, 1.0));
+    }
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 fw_proc_stop_and_return (void * ap_obj)
 {
-  return OMX_ErrorNone;
+  fw_prc_t * p_prc = ap_obj;
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_obj);
+  if (p_prc->p_batch_)
+    {
+      /* Whatever was accepted must reach the file before going to Idle */
+      rc = fw_batch_drain (p_prc->p_batch_);
+    }
+  if (p_prc->p_ev_io_)
+    {
+      (void) tiz_srv_io_watcher_stop (p_prc, p_prc->p_ev_io_);
+    }
+  if (p_prc->p_stats_timer_)
+    {
+      (void) tiz_srv_timer_watcher_stop (p_prc, p_prc->p_stats_timer_);
+    }
+  publish_stats (p_prc);
+  return rc;
 }
 
 /*
  * from tiz_prc class
  */
 
+static void
+issue_eos_event (fw_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->eos_pending_ = false;
+  publish_stats (ap_prc);
+  tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                       ARATELIA_FILE_WRITER_PORT_INDEX, ap_prc->eos_flags_,
+                       NULL);
+}
+
 static OMX_ERRORTYPE
 fw_proc_buffers_ready (const void * ap_obj)
 {
-  const fw_prc_t * p_prc = ap_obj;
+  fw_prc_t * p_prc = (fw_prc_t *) ap_obj;
+
+  assert (p_prc);
 
-  if (!p_prc->eos_)
+  /* Copying into the blocks does not block, so take as many buffers as they
+     can hold; synchronous writes are done one buffer at a time */
+  while (!p_prc->eos_)
     {
       OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+
+      if (p_prc->p_batch_
+          && !fw_batch_has_room (p_prc->p_batch_, p_prc->max_buf_len_))
+        {
+          /* The io watcher will tell us when the writer thread catches up */
+          break;
+        }
+
       tiz_check_omx (tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)),
-                                               ARATELIA_FILE_WRITER_PORT_INDEX,
-                                               0, &p_hdr));
-      if (p_hdr)
+                                           ARATELIA_FILE_WRITER_PORT_INDEX, 0,
+                                           &p_hdr));
+      if (!p_hdr)
+        {
+          break;
+        }
+
+      TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...", p_hdr);
+      p_prc->max_buf_len_ = MAX (p_prc->max_buf_len_, p_hdr->nFilledLen);
+      tiz_check_omx (fw_proc_write_buffer (p_prc, p_hdr));
+      if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
         {
-          TIZ_TRACE (handleOf (p_prc), "Claimed HEADER [%p]...", p_hdr);
-          tiz_check_omx (fw_proc_write_buffer (p_prc, p_hdr));
-          if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+          TIZ_DEBUG (handleOf (p_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                     p_hdr);
+          p_prc->eos_flags_ = p_hdr->nFlags;
+          if (p_prc->p_batch_)
+            {
+              /* The event is issued once the data is in the file */
+              p_prc->eos_ = true;
+              p_prc->eos_pending_ = true;
+              tiz_check_omx (fw_batch_flush (p_prc->p_batch_, true));
+            }
+          else
             {
-              TIZ_DEBUG (handleOf (p_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
-                         p_hdr);
-              tiz_srv_issue_event ((OMX_PTR) p_prc, OMX_EventBufferFlag,
-                                   ARATELIA_FILE_WRITER_PORT_INDEX,
-                                   p_hdr->nFlags, NULL);
+              tiz_check_omx (sync_stdio_file (p_prc, true));
+              issue_eos_event (p_prc);
             }
-          tiz_check_omx (
-            tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
-                                    ARATELIA_FILE_WRITER_PORT_INDEX, p_hdr));
+        }
+      tiz_check_omx (tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
+                                             ARATELIA_FILE_WRITER_PORT_INDEX,
+                                             p_hdr));
+      if (!p_prc->p_batch_)
+        {
+          break;
         }
     }
 
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+fw_proc_io_ready (void * ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                  int a_events)
+{
+  fw_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_batch_)
+    {
+      fw_batch_clear_event (p_prc->p_batch_);
+      if (p_prc->eos_pending_ && fw_batch_final_done (p_prc->p_batch_))
+        {
+          issue_eos_event (p_prc);
+        }
+    }
+  return fw_proc_buffers_ready (p_prc);
+}
+
+static OMX_ERRORTYPE
+fw_proc_timer_ready (void * ap_obj, tiz_event_timer_t * ap_ev_timer,
+                     void * ap_arg, const uint32_t a_id)
+{
+  fw_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  if (ap_ev_timer == p_prc->p_stats_timer_)
+    {
+      publish_stats (p_prc);
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * fw_prc_class
  */
@@ -323,6 +608,10 @@ fw_prc_init (void * ap_tos, void * ap_hdl)
      tiz_srv_stop_and_return, fw_proc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, fw_proc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, fw_proc_io_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_srv_timer_ready, fw_proc_timer_ready,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
@@ -35,7 +35,10 @@ extern "C" {
 
 #include <stdbool.h>
 
+#include <OMX_TizoniaExt.h>
+
 #include "fwprc.h"
+#include "fwbatch.h"
 #include "tizprc_decls.h"
 
 typedef struct fw_prc fw_prc_t;
@@ -47,6 +50,16 @@ struct fw_prc
   OMX_PARAM_CONTENTURITYPE * p_uri_param_;
   OMX_U32 counter_;
   bool eos_;
+  int fd_; /* batched mode only */
+  OMX_TIZONIA_FILEWRITERMODETYPE mode_;
+  OMX_TIZONIA_FILEWRITERSTATSTYPE stats_; /* sync mode only */
+  OMX_U64 since_sync_;                    /* sync mode only */
+  fw_batch_t * p_batch_;
+  tiz_event_io_t * p_ev_io_;
+  tiz_event_timer_t * p_stats_timer_;
+  OMX_U32 max_buf_len_;
+  OMX_U32 eos_flags_;
+  bool eos_pending_; /* EOS seen; the event waits for the final flush */
 };
 
 typedef struct fw_prc_class fw_prc_class_t;
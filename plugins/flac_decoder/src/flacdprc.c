@@ -738,6 +738,55 @@ flacd_prc_buffers_ready (const void * ap_obj)
   return transform_stream (ap_obj);
 }
 
+static OMX_ERRORTYPE
+flacd_prc_port_disable (const void * ap_obj, OMX_U32 a_pid)
+{
+  flacd_prc_t * p_prc = (flacd_prc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid || ARATELIA_FLAC_DECODER_INPUT_PORT_INDEX == a_pid)
+    {
+      p_prc->in_port_disabled_ = true;
+      if (p_prc->p_in_hdr_)
+        {
+          release_header (p_prc, ARATELIA_FLAC_DECODER_INPUT_PORT_INDEX);
+        }
+    }
+  if (OMX_ALL == a_pid || ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX == a_pid)
+    {
+      p_prc->out_port_disabled_ = true;
+      if (p_prc->p_out_hdr_)
+        {
+          release_header (p_prc, ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX);
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+flacd_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
+{
+  flacd_prc_t * p_prc = (flacd_prc_t *) ap_obj;
+  assert (p_prc);
+  if (OMX_ALL == a_pid || ARATELIA_FLAC_DECODER_INPUT_PORT_INDEX == a_pid)
+    {
+      /* A new stream may be about to arrive on this port, e.g. the next
+         track of a gapless transition */
+      if (p_prc->p_flac_dec_)
+        {
+          (void) FLAC__stream_decoder_reset (p_prc->p_flac_dec_);
+        }
+      reset_stream_parameters (p_prc);
+      p_prc->eos_ = false;
+      p_prc->store_offset_ = 0;
+      p_prc->in_port_disabled_ = false;
+    }
+  if (OMX_ALL == a_pid || ARATELIA_FLAC_DECODER_OUTPUT_PORT_INDEX == a_pid)
+    {
+      p_prc->out_port_disabled_ = false;
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * flacd_prc_class
  */
@@ -788,6 +837,10 @@ flacd_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, flacd_prc_buffers_ready,
      /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_disable, flacd_prc_port_disable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_prc_port_enable, flacd_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
      tiz_srv_allocate_resources, flacd_prc_allocate_resources,
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_deallocate_resources, flacd_prc_deallocate_resources,
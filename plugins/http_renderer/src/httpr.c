@@ -31,6 +31,8 @@
 #endif
 
 #include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include <OMX_Core.h>
@@ -64,8 +66,9 @@
 static OMX_VERSIONTYPE http_renderer_version = {{1, 0, 0, 0}};
 
 static OMX_PTR
-instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
+instantiate_mp3_port (OMX_HANDLETYPE ap_hdl, const OMX_U32 a_pid)
 {
+  OMX_PTR p_port = NULL;
   OMX_AUDIO_PARAM_MP3TYPE mp3type;
   OMX_AUDIO_CODINGTYPE encodings[] = {OMX_AUDIO_CodingMP3, OMX_AUDIO_CodingMax};
   tiz_port_options_t mp3_port_opts = {
@@ -76,13 +79,13 @@ instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
     ARATELIA_HTTP_RENDERER_PORT_NONCONTIGUOUS,
     ARATELIA_HTTP_RENDERER_PORT_ALIGNMENT,
     ARATELIA_HTTP_RENDERER_PORT_SUPPLIERPREF,
-    {ARATELIA_HTTP_RENDERER_PORT_INDEX, NULL, NULL, NULL},
+    {a_pid, NULL, NULL, NULL},
     0 /* Master port */
   };
 
   mp3type.nSize = sizeof (OMX_AUDIO_PARAM_MP3TYPE);
   mp3type.nVersion.nVersion = OMX_VERSION;
-  mp3type.nPortIndex = ARATELIA_HTTP_RENDERER_PORT_INDEX;
+  mp3type.nPortIndex = a_pid;
   mp3type.nChannels = 2;
   mp3type.nBitRate = 128000;
   mp3type.nSampleRate = 44100;
@@ -90,8 +93,61 @@ instantiate_mp3_port (OMX_HANDLETYPE ap_hdl)
   mp3type.eChannelMode = OMX_AUDIO_ChannelModeStereo;
   mp3type.eFormat = OMX_AUDIO_MP3StreamFormatMP1Layer3;
 
-  return factory_new (tiz_get_type (ap_hdl, "httprmp3port"), &mp3_port_opts,
-                      &encodings, &mp3type);
+  p_port = factory_new (tiz_get_type (ap_hdl, "httprmp3port"), &mp3_port_opts,
+                        &encodings, &mp3type);
+
+  if (p_port && a_pid > ARATELIA_HTTP_RENDERER_PORT_INDEX)
+    {
+      /* The first mountpoint is served at "/"; give the others a name of
+         their own, so that they are reachable out of the box */
+      OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint;
+      TIZ_INIT_OMX_PORT_STRUCT (mountpoint, a_pid);
+      if (OMX_ErrorNone
+          == tiz_api_GetParameter (p_port, ap_hdl,
+                                   OMX_TizoniaIndexParamIcecastMountpoint,
+                                   &mountpoint))
+        {
+          snprintf ((char *) mountpoint.cMountName,
+                    sizeof (mountpoint.cMountName), "/stream%u",
+                    (unsigned int) a_pid);
+          (void) tiz_api_SetParameter (p_port, ap_hdl,
+                                       OMX_TizoniaIndexParamIcecastMountpoint,
+                                       &mountpoint);
+        }
+    }
+
+  return p_port;
+}
+
+/* The role factory's port hooks only take the handle */
+#define HTTPR_DEFINE_MP3_PORT_INSTANTIATOR(pid)                \
+  static OMX_PTR instantiate_mp3_port_##pid (OMX_HANDLETYPE ap_hdl) \
+  {                                                            \
+    return instantiate_mp3_port (ap_hdl, pid);                 \
+  }
+
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (0)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (1)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (2)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (3)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (4)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (5)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (6)
+HTTPR_DEFINE_MP3_PORT_INSTANTIATOR (7)
+
+static const tiz_role_port_init_f mp3_port_instantiators[ICE_MAX_MOUNTPOINTS]
+  = {instantiate_mp3_port_0, instantiate_mp3_port_1, instantiate_mp3_port_2,
+     instantiate_mp3_port_3, instantiate_mp3_port_4, instantiate_mp3_port_5,
+     instantiate_mp3_port_6, instantiate_mp3_port_7};
+
+static OMX_U32
+get_mountpoints_count (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_renderer.http.mountpoints");
+  long nmounts = p_value ? strtol (p_value, NULL, 10) : ICE_DEFAULT_MOUNTPOINTS;
+  return MIN (MAX (nmounts, 1), ICE_MAX_MOUNTPOINTS);
 }
 
 static OMX_PTR
@@ -119,11 +175,16 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   tiz_type_factory_t httprcfgport_type;
   const tiz_type_factory_t * tf_list[]
     = {&httprprc_type, &httprmp3port_type, &httprcfgport_type};
+  OMX_U32 i = 0;
 
   strcpy ((OMX_STRING) role_factory.role, ARATELIA_HTTP_RENDERER_DEFAULT_ROLE);
   role_factory.pf_cport = instantiate_config_port;
-  role_factory.pf_port[0] = instantiate_mp3_port;
-  role_factory.nports = 1;
+  /* One mp3 input port per mountpoint */
+  role_factory.nports = get_mountpoints_count ();
+  for (i = 0; i < role_factory.nports; ++i)
+    {
+      role_factory.pf_port[i] = mp3_port_instantiators[i];
+    }
   role_factory.pf_proc = instantiate_processor;
 
   strcpy ((OMX_STRING) httprprc_type.class_name, "httprprc_class");
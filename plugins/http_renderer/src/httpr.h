@@ -56,6 +56,16 @@ extern "C" {
 #define ICE_MIN_BURST_SIZE 1400
 #define ICE_MEDIUM_BURST_SIZE 2800 /* Not used for now */
 #define ICE_MAX_BURST_SIZE 4200    /* Not used for now */
+#define ICE_CHUNK_RING_SIZE 64 /* Encoded chunks kept per mountpoint */
+#define ICE_MAX_IOVECS 16      /* Max iovecs per listener write */
+#define ICE_MAX_MOUNTPOINTS 8  /* One mp3 input port per mountpoint */
+#define ICE_DEFAULT_MOUNTPOINTS 1
+#define ICE_MAX_WORKER_THREADS 64
+#define ICE_DEFAULT_WORKER_THREADS 1
+#define ICE_WORKER_MAX_EVENTS 64 /* epoll events handled per wake-up */
+#define ICE_WORKER_TICK_MS 10    /* Longest a busy worker sleeps */
+#define ICE_WORKER_STACK_SIZE (256 * 1024)
+#define ICE_STATS_UPDATE_INTERVAL 1.0 /* Seconds between mountpoint stats */
 #define ICE_LISTENER_BUF_SIZE \
   (ICE_MAX_BURST_SIZE + OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE)
 
@@ -58,6 +58,7 @@ httpr_mp3port_ctor (void * ap_obj, va_list * app)
 
   tiz_port_register_index (p_obj, OMX_TizoniaIndexParamIcecastMountpoint);
   tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigIcecastMetadata);
+  tiz_port_register_index (p_obj, OMX_TizoniaIndexConfigHttpMountpointStats);
 
   p_obj->mountpoint_.nSize = sizeof (OMX_TIZONIA_ICECASTMOUNTPOINTTYPE);
   p_obj->mountpoint_.nVersion.nVersion = OMX_VERSION;
@@ -83,6 +84,10 @@ httpr_mp3port_ctor (void * ap_obj, va_list * app)
 
   p_obj->p_stream_title_ = NULL;
 
+  tiz_mem_set (&(p_obj->stats_), 0, sizeof (p_obj->stats_));
+  p_obj->stats_.nSize = sizeof (OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE);
+  p_obj->stats_.nVersion.nVersion = OMX_VERSION;
+
   return p_obj;
 }
 
@@ -112,8 +117,11 @@ httpr_mp3port_GetParameter (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
 
   if (OMX_TizoniaIndexParamIcecastMountpoint == a_index)
     {
-      memcpy (ap_struct, &(p_obj->mountpoint_),
+      OMX_TIZONIA_ICECASTMOUNTPOINTTYPE * p_mountpoint = ap_struct;
+      memcpy (p_mountpoint, &(p_obj->mountpoint_),
               sizeof (OMX_TIZONIA_ICECASTMOUNTPOINTTYPE));
+      /* The index is not known yet when the port is constructed */
+      p_mountpoint->nPortIndex = tiz_port_index (p_obj);
     }
   else
     {
@@ -202,6 +210,12 @@ httpr_mp3port_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
           p_metadata->cStreamTitle[0] = '\000';
         }
     }
+  else if (OMX_TizoniaIndexConfigHttpMountpointStats == a_index)
+    {
+      OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE * p_stats = ap_struct;
+      *p_stats = p_obj->stats_;
+      p_stats->nPortIndex = tiz_port_index (p_obj);
+    }
   else
     {
       /* Delegate to the base port */
@@ -252,6 +266,11 @@ httpr_mp3port_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
                      stream_title_len, p_obj->p_stream_title_);
         }
     }
+  else if (OMX_TizoniaIndexConfigHttpMountpointStats == a_index)
+    {
+      /* The stats are read-only for IL clients */
+      rc = OMX_ErrorUnsupportedSetting;
+    }
   else
     {
       /* Delegate to the base port */
@@ -262,6 +281,29 @@ httpr_mp3port_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
   return rc;
 }
 
+/*
+ * from tiz_port
+ */
+
+static OMX_ERRORTYPE
+httpr_mp3port_SetConfig_internal (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                                  OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  httpr_mp3port_t * p_obj = (httpr_mp3port_t *) ap_obj;
+
+  assert (p_obj);
+  assert (ap_struct);
+
+  if (OMX_TizoniaIndexConfigHttpMountpointStats == a_index)
+    {
+      /* This is how the processor publishes the mountpoint's stats */
+      p_obj->stats_ = *((OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE *) ap_struct);
+      return OMX_ErrorNone;
+    }
+
+  return tiz_api_SetConfig (ap_obj, ap_hdl, a_index, ap_struct);
+}
+
 /*
  * httpr_mp3port_class
  */
@@ -317,6 +359,8 @@ httpr_mp3port_init (void * ap_tos, void * ap_hdl)
      tiz_api_GetConfig, httpr_mp3port_GetConfig,
      /* TIZ_CLASS_COMMENT: */
      tiz_api_SetConfig, httpr_mp3port_SetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_port_SetConfig_internal, httpr_mp3port_SetConfig_internal,
      /* TIZ_CLASS_COMMENT: stop value*/
      0);
 
@@ -45,6 +45,7 @@ struct httpr_mp3port
   const tiz_mp3port_t _;
   OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_;
   OMX_STRING p_stream_title_;
+  OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE stats_;
 };
 
 typedef struct httpr_mp3port_class httpr_mp3port_class_t;
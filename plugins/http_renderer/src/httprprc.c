@@ -33,6 +33,9 @@
 #endif
 
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 #include <OMX_Core.h>
 
@@ -51,39 +54,52 @@ httpr_prc_config_change (const void * ap_prc, OMX_U32 a_pid,
                          OMX_INDEXTYPE a_config_idx);
 
 static void
-release_buffers (httpr_prc_t * ap_prc)
+release_buffers (httpr_prc_t * ap_prc, const OMX_U32 a_pid)
 {
   assert (ap_prc);
+  assert (a_pid < ICE_MAX_MOUNTPOINTS);
 
-  if (ap_prc->p_server_ && ap_prc->p_inhdr_)
+  if (ap_prc->p_server_)
     {
-      httpr_srv_release_buffers (ap_prc->p_server_);
+      httpr_srv_release_buffers (ap_prc->p_server_, a_pid);
+    }
+  assert (NULL == ap_prc->p_inhdr_[a_pid]);
+}
+
+static void
+release_all_buffers (httpr_prc_t * ap_prc)
+{
+  OMX_U32 pid = 0;
+  assert (ap_prc);
+  for (pid = 0; pid < ap_prc->nmounts_; ++pid)
+    {
+      release_buffers (ap_prc, pid);
     }
-  assert (NULL == ap_prc->p_inhdr_);
 }
 
 static OMX_BUFFERHEADERTYPE *
-buffer_needed (void * ap_arg)
+buffer_needed (OMX_U32 a_pid, void * ap_arg)
 {
   httpr_prc_t * p_prc = ap_arg;
   OMX_BUFFERHEADERTYPE * p_hdr = NULL;
   assert (p_prc);
+  assert (a_pid < p_prc->nmounts_);
 
-  if (!p_prc->port_disabled_)
+  if (!p_prc->port_disabled_[a_pid])
     {
-      if (!p_prc->p_inhdr_)
+      if (!p_prc->p_inhdr_[a_pid])
         {
-          (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)),
-                                       ARATELIA_HTTP_RENDERER_PORT_INDEX, 0,
-                                       &p_prc->p_inhdr_);
-          if (p_prc->p_inhdr_)
+          (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (p_prc)), a_pid, 0,
+                                       &p_prc->p_inhdr_[a_pid]);
+          if (p_prc->p_inhdr_[a_pid])
             {
               TIZ_TRACE (handleOf (p_prc),
-                         "Claimed HEADER [%p]...nFilledLen [%d]",
-                         p_prc->p_inhdr_, p_prc->p_inhdr_->nFilledLen);
+                         "Claimed HEADER [%p] pid [%u]...nFilledLen [%d]",
+                         p_prc->p_inhdr_[a_pid], (unsigned int) a_pid,
+                         p_prc->p_inhdr_[a_pid]->nFilledLen);
             }
         }
-      p_hdr = p_prc->p_inhdr_;
+      p_hdr = p_prc->p_inhdr_[a_pid];
     }
 
   /*   p_prc->awaiting_buffers_ = p_hdr ? false : true; */
@@ -91,33 +107,33 @@ buffer_needed (void * ap_arg)
 }
 
 static void
-buffer_emptied (OMX_BUFFERHEADERTYPE * ap_hdr, void * ap_arg)
+buffer_emptied (OMX_BUFFERHEADERTYPE * ap_hdr, OMX_U32 a_pid, void * ap_arg)
 {
   httpr_prc_t * p_prc = ap_arg;
 
   assert (p_prc);
   assert (ap_hdr);
-  assert (p_prc->p_inhdr_ == ap_hdr);
+  assert (a_pid < p_prc->nmounts_);
+  assert (p_prc->p_inhdr_[a_pid] == ap_hdr);
   assert (ap_hdr->nFilledLen == 0);
 
   ap_hdr->nOffset = 0;
-  TIZ_TRACE (handleOf (p_prc), "HEADER [%p]", ap_hdr);
+  TIZ_TRACE (handleOf (p_prc), "HEADER [%p] pid [%u]", ap_hdr,
+             (unsigned int) a_pid);
 
   if ((ap_hdr->nFlags & OMX_BUFFERFLAG_EOS) != 0)
     {
       TIZ_TRACE (handleOf (p_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]", ap_hdr);
-      tiz_srv_issue_event ((OMX_PTR) p_prc, OMX_EventBufferFlag,
-                           ARATELIA_HTTP_RENDERER_PORT_INDEX, ap_hdr->nFlags,
-                           NULL);
+      tiz_srv_issue_event ((OMX_PTR) p_prc, OMX_EventBufferFlag, a_pid,
+                           ap_hdr->nFlags, NULL);
     }
 
-  tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)),
-                          ARATELIA_HTTP_RENDERER_PORT_INDEX, ap_hdr);
-  p_prc->p_inhdr_ = NULL;
+  tiz_krn_release_buffer (tiz_get_krn (handleOf (p_prc)), a_pid, ap_hdr);
+  p_prc->p_inhdr_[a_pid] = NULL;
 }
 
 static inline OMX_ERRORTYPE
-retrieve_mp3_settings (const void * ap_prc,
+retrieve_mp3_settings (const void * ap_prc, const OMX_U32 a_pid,
                        OMX_AUDIO_PARAM_MP3TYPE * ap_mp3type)
 {
   const httpr_prc_t * p_prc = ap_prc;
@@ -125,7 +141,7 @@ retrieve_mp3_settings (const void * ap_prc,
   assert (ap_mp3type);
 
   /* Retrieve the mp3 settings from the input port */
-  TIZ_INIT_OMX_PORT_STRUCT (*ap_mp3type, ARATELIA_HTTP_RENDERER_PORT_INDEX);
+  TIZ_INIT_OMX_PORT_STRUCT (*ap_mp3type, a_pid);
   tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
                                            handleOf (p_prc),
                                            OMX_IndexParamAudioMp3, ap_mp3type));
@@ -133,7 +149,7 @@ retrieve_mp3_settings (const void * ap_prc,
 }
 
 static inline OMX_ERRORTYPE
-retrieve_mountpoint_settings (const void * ap_prc,
+retrieve_mountpoint_settings (const void * ap_prc, const OMX_U32 a_pid,
                               OMX_TIZONIA_ICECASTMOUNTPOINTTYPE * ap_mountpoint)
 {
   const httpr_prc_t * p_prc = ap_prc;
@@ -141,13 +157,126 @@ retrieve_mountpoint_settings (const void * ap_prc,
   assert (ap_mountpoint);
 
   /* Retrieve the mountpoint settings from the input port */
-  TIZ_INIT_OMX_PORT_STRUCT (*ap_mountpoint, ARATELIA_HTTP_RENDERER_PORT_INDEX);
+  TIZ_INIT_OMX_PORT_STRUCT (*ap_mountpoint, a_pid);
   tiz_check_omx (tiz_api_GetParameter (
     tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
     OMX_TizoniaIndexParamIcecastMountpoint, ap_mountpoint));
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+retrieve_mountpoints_count (const void * ap_prc, OMX_U32 * ap_nmounts)
+{
+  const httpr_prc_t * p_prc = ap_prc;
+  OMX_PORT_PARAM_TYPE audio_init;
+
+  assert (p_prc);
+  assert (ap_nmounts);
+
+  /* All the audio ports of this component are mp3 input ports */
+  TIZ_INIT_OMX_STRUCT (audio_init);
+  tiz_check_omx (tiz_api_GetParameter (tiz_get_krn (handleOf (p_prc)),
+                                       handleOf (p_prc),
+                                       OMX_IndexParamAudioInit, &audio_init));
+  *ap_nmounts = MIN (MAX (audio_init.nPorts, 1), ICE_MAX_MOUNTPOINTS);
+  return OMX_ErrorNone;
+}
+
+static OMX_U32
+get_worker_threads_count (httpr_prc_t * ap_prc)
+{
+  const char * p_value = NULL;
+  long nworkers = ICE_DEFAULT_WORKER_THREADS;
+
+  assert (ap_prc);
+
+  p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    "OMX.Aratelia.audio_renderer.http.worker_threads");
+  if (p_value)
+    {
+      nworkers = strtol (p_value, NULL, 10);
+      if (0 == nworkers)
+        {
+          /* Zero means one worker per online CPU */
+          nworkers = sysconf (_SC_NPROCESSORS_ONLN);
+        }
+    }
+
+  nworkers = MIN (MAX (nworkers, 1), ICE_MAX_WORKER_THREADS);
+  TIZ_TRACE (handleOf (ap_prc), "Using [%ld] worker threads", nworkers);
+  return nworkers;
+}
+
+static OMX_ERRORTYPE
+configure_mountpoint (httpr_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  OMX_TIZONIA_ICECASTMOUNTPOINTTYPE * p_mountpoint = NULL;
+  OMX_U32 i = 0;
+
+  assert (ap_prc);
+  assert (a_pid < ap_prc->nmounts_);
+
+  /* Obtain mp3 settings from port */
+  tiz_check_omx (
+    retrieve_mp3_settings (ap_prc, a_pid, &(ap_prc->mp3type_[a_pid])));
+
+  httpr_srv_set_mp3_settings (ap_prc->p_server_, a_pid,
+                              ap_prc->mp3type_[a_pid].nBitRate,
+                              ap_prc->mp3type_[a_pid].nChannels,
+                              ap_prc->mp3type_[a_pid].nSampleRate);
+
+  /* Obtain mount point and station-related information */
+  p_mountpoint = &(ap_prc->mountpoint_[a_pid]);
+  tiz_check_omx (retrieve_mountpoint_settings (ap_prc, a_pid, p_mountpoint));
+
+  for (i = 0; i < a_pid; ++i)
+    {
+      if (0 == strncmp ((char *) p_mountpoint->cMountName,
+                        (char *) ap_prc->mountpoint_[i].cMountName,
+                        OMX_MAX_STRINGNAME_SIZE))
+        {
+          TIZ_WARN (handleOf (ap_prc),
+                    "Mountpoint [%s] (port [%u]) is shadowed by port [%u]",
+                    p_mountpoint->cMountName, (unsigned int) a_pid,
+                    (unsigned int) i);
+        }
+    }
+
+  httpr_srv_set_mountpoint_settings (
+    ap_prc->p_server_, a_pid, p_mountpoint->cMountName,
+    p_mountpoint->cStationName, p_mountpoint->cStationDescription,
+    p_mountpoint->cStationGenre, p_mountpoint->cStationUrl,
+    p_mountpoint->nIcyMetadataPeriod,
+    (p_mountpoint->bBurstOnConnect == OMX_TRUE
+       ? p_mountpoint->nInitialBurstSize
+       : 0),
+    p_mountpoint->nMaxClients);
+
+  return httpr_prc_config_change (ap_prc, a_pid,
+                                  OMX_TizoniaIndexConfigIcecastMetadata);
+}
+
+static OMX_ERRORTYPE
+update_mountpoint_stats (httpr_prc_t * ap_prc)
+{
+  OMX_U32 pid = 0;
+
+  assert (ap_prc);
+  assert (ap_prc->p_server_);
+
+  for (pid = 0; pid < ap_prc->nmounts_; ++pid)
+    {
+      OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE stats;
+      TIZ_INIT_OMX_PORT_STRUCT (stats, pid);
+      httpr_srv_get_mountpoint_stats (ap_prc->p_server_, pid, &stats);
+      tiz_check_omx (tiz_krn_SetConfig_internal (
+        tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
+        OMX_TizoniaIndexConfigHttpMountpointStats, &stats));
+    }
+  return OMX_ErrorNone;
+}
+
 /*
  * httprprc
  */
@@ -156,11 +285,17 @@ static void *
 httpr_prc_ctor (void * ap_prc, va_list * app)
 {
   httpr_prc_t * p_prc = super_ctor (typeOf (ap_prc, "httprprc"), ap_prc, app);
+  OMX_U32 pid = 0;
   assert (p_prc);
   p_prc->mount_name_ = NULL;
-  p_prc->port_disabled_ = false;
+  p_prc->nmounts_ = 0;
   p_prc->p_server_ = NULL;
-  p_prc->p_inhdr_ = NULL;
+  p_prc->p_stats_timer_ = NULL;
+  for (pid = 0; pid < ICE_MAX_MOUNTPOINTS; ++pid)
+    {
+      p_prc->port_disabled_[pid] = false;
+      p_prc->p_inhdr_[pid] = NULL;
+    }
   return p_prc;
 }
 
@@ -186,6 +321,11 @@ httpr_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
     tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
     OMX_TizoniaIndexParamHttpServer, &p_prc->server_info_));
 
+  tiz_check_omx (retrieve_mountpoints_count (p_prc, &(p_prc->nmounts_)));
+
+  tiz_check_omx (
+    tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_stats_timer_)));
+
   return httpr_srv_init (
     &(p_prc->p_server_), p_prc, p_prc->server_info_.cBindAddress, /* if this is
                                                             * null, the
@@ -194,7 +334,8 @@ httpr_prc_allocate_resources (void * ap_prc, OMX_U32 a_pid)
                                                             * all
                                                             * interfaces. */
     p_prc->server_info_.nListeningPort, p_prc->server_info_.nMaxClients,
-    buffer_emptied, buffer_needed, p_prc);
+    p_prc->nmounts_, get_worker_threads_count (p_prc), buffer_emptied,
+    buffer_needed, p_prc);
 }
 
 static OMX_ERRORTYPE
@@ -204,6 +345,11 @@ httpr_prc_deallocate_resources (void * ap_prc)
   assert (p_prc);
   httpr_srv_destroy (p_prc->p_server_);
   p_prc->p_server_ = NULL;
+  if (p_prc->p_stats_timer_)
+    {
+      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_stats_timer_);
+      p_prc->p_stats_timer_ = NULL;
+    }
   return OMX_ErrorNone;
 }
 
@@ -211,33 +357,18 @@ static OMX_ERRORTYPE
 httpr_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
 {
   httpr_prc_t * p_prc = ap_prc;
+  OMX_U32 pid = 0;
 
   assert (p_prc);
 
-  /* Obtain mp3 settings from port */
-  tiz_check_omx (retrieve_mp3_settings (ap_prc, &(p_prc->mp3type_)));
-
-  httpr_srv_set_mp3_settings (p_prc->p_server_, p_prc->mp3type_.nBitRate,
-                              p_prc->mp3type_.nChannels,
-                              p_prc->mp3type_.nSampleRate);
-
-  /* Obtain mount point and station-related information */
-  tiz_check_omx (
-    retrieve_mountpoint_settings (ap_prc, &(p_prc->mountpoint_)));
-
-  httpr_srv_set_mountpoint_settings (
-    p_prc->p_server_, p_prc->mountpoint_.cMountName,
-    p_prc->mountpoint_.cStationName, p_prc->mountpoint_.cStationDescription,
-    p_prc->mountpoint_.cStationGenre, p_prc->mountpoint_.cStationUrl,
-    p_prc->mountpoint_.nIcyMetadataPeriod,
-    (p_prc->mountpoint_.bBurstOnConnect == OMX_TRUE
-       ? p_prc->mountpoint_.nInitialBurstSize
-       : 0),
-    p_prc->mountpoint_.nMaxClients);
+  for (pid = 0; pid < p_prc->nmounts_; ++pid)
+    {
+      tiz_check_omx (configure_mountpoint (p_prc, pid));
+    }
 
-  tiz_check_omx (
-    httpr_prc_config_change (p_prc, ARATELIA_HTTP_RENDERER_PORT_INDEX,
-                             OMX_TizoniaIndexConfigIcecastMetadata));
+  tiz_check_omx (tiz_srv_timer_watcher_start (p_prc, p_prc->p_stats_timer_,
+                                              ICE_STATS_UPDATE_INTERVAL,
+                                              ICE_STATS_UPDATE_INTERVAL));
 
   return httpr_srv_start (p_prc->p_server_);
 }
@@ -254,8 +385,12 @@ httpr_prc_stop_and_return (void * ap_prc)
   httpr_prc_t * p_prc = ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
+  if (p_prc->p_stats_timer_)
+    {
+      (void) tiz_srv_timer_watcher_stop (p_prc, p_prc->p_stats_timer_);
+    }
   rc = httpr_srv_stop (p_prc->p_server_);
-  release_buffers (p_prc);
+  release_all_buffers (p_prc);
   return rc;
 }
 
@@ -285,7 +420,7 @@ httpr_prc_io_ready (void * ap_prc, tiz_event_io_t * ap_ev_io, int a_fd,
   assert (p_prc);
   if (p_prc->p_server_)
     {
-      httpr_srv_io_event (p_prc->p_server_, a_fd);
+      rc = httpr_srv_io_event (p_prc->p_server_, a_fd);
     }
   return rc;
 }
@@ -297,9 +432,9 @@ httpr_prc_timer_ready (void * ap_prc, tiz_event_timer_t * ap_ev_timer,
   httpr_prc_t * p_prc = ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (p_prc->p_server_)
+  if (p_prc->p_server_ && ap_ev_timer == p_prc->p_stats_timer_)
     {
-      rc = httpr_srv_timer_event (p_prc->p_server_);
+      rc = update_mountpoint_stats (p_prc);
     }
   return rc;
 }
@@ -308,19 +443,26 @@ static OMX_ERRORTYPE
 httpr_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
 {
   httpr_prc_t * p_prc = (httpr_prc_t *) ap_prc;
+  OMX_U32 pid = 0;
 
   assert (ap_prc);
-  assert (ARATELIA_HTTP_RENDERER_PORT_INDEX == a_pid);
+  assert (OMX_ALL == a_pid || a_pid < p_prc->nmounts_);
 
-  p_prc->port_disabled_ = false;
-
-  tiz_check_omx (retrieve_mp3_settings (p_prc, &(p_prc->mp3type_)));
-  httpr_srv_set_mp3_settings (p_prc->p_server_, p_prc->mp3type_.nBitRate,
-                              p_prc->mp3type_.nChannels,
-                              p_prc->mp3type_.nSampleRate);
-  tiz_check_omx (
-    httpr_prc_config_change (p_prc, ARATELIA_HTTP_RENDERER_PORT_INDEX,
-                             OMX_TizoniaIndexConfigIcecastMetadata));
+  for (pid = 0; pid < p_prc->nmounts_; ++pid)
+    {
+      if (OMX_ALL == a_pid || pid == a_pid)
+        {
+          p_prc->port_disabled_[pid] = false;
+          tiz_check_omx (
+            retrieve_mp3_settings (p_prc, pid, &(p_prc->mp3type_[pid])));
+          httpr_srv_set_mp3_settings (p_prc->p_server_, pid,
+                                      p_prc->mp3type_[pid].nBitRate,
+                                      p_prc->mp3type_[pid].nChannels,
+                                      p_prc->mp3type_[pid].nSampleRate);
+          tiz_check_omx (httpr_prc_config_change (
+            p_prc, pid, OMX_TizoniaIndexConfigIcecastMetadata));
+        }
+    }
   return OMX_ErrorNone;
 }
 
@@ -328,8 +470,16 @@ static OMX_ERRORTYPE
 httpr_prc_port_disable (const void * ap_prc, OMX_U32 a_pid)
 {
   httpr_prc_t * p_prc = (httpr_prc_t *) ap_prc;
-  p_prc->port_disabled_ = true;
-  release_buffers (p_prc);
+  OMX_U32 pid = 0;
+  assert (ap_prc);
+  for (pid = 0; pid < p_prc->nmounts_; ++pid)
+    {
+      if (OMX_ALL == a_pid || pid == a_pid)
+        {
+          p_prc->port_disabled_[pid] = true;
+          release_buffers (p_prc, pid);
+        }
+    }
   return OMX_ErrorNone;
 }
 
@@ -343,7 +493,7 @@ httpr_prc_config_change (const void * ap_prc, const OMX_U32 a_pid,
   assert (ap_prc);
 
   if (p_prc->p_server_ && OMX_TizoniaIndexConfigIcecastMetadata == a_config_idx
-      && ARATELIA_HTTP_RENDERER_PORT_INDEX == a_pid)
+      && a_pid < p_prc->nmounts_)
     {
       OMX_TIZONIA_ICECASTMETADATATYPE * p_metadata
         = (OMX_TIZONIA_ICECASTMETADATATYPE *) tiz_mem_calloc (
@@ -353,7 +503,7 @@ httpr_prc_config_change (const void * ap_prc, const OMX_U32 a_pid,
       tiz_check_null_ret_oom (p_metadata != NULL);
 
       /* Retrieve the updated icecast metadata from the input port */
-      TIZ_INIT_OMX_PORT_STRUCT (*p_metadata, ARATELIA_HTTP_RENDERER_PORT_INDEX);
+      TIZ_INIT_OMX_PORT_STRUCT (*p_metadata, a_pid);
       p_metadata->nSize = sizeof (OMX_TIZONIA_ICECASTMETADATATYPE)
                           + OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE;
 
@@ -369,7 +519,7 @@ httpr_prc_config_change (const void * ap_prc, const OMX_U32 a_pid,
         }
       else
         {
-          httpr_srv_set_stream_title (p_prc->p_server_,
+          httpr_srv_set_stream_title (p_prc->p_server_, a_pid,
                                       p_metadata->cStreamTitle);
         }
 
@@ -40,6 +40,7 @@ extern "C" {
 
 #include <tizprc_decls.h>
 
+#include "httpr.h"
 #include "httprsrv.h"
 
 typedef struct httpr_prc httpr_prc_t;
@@ -48,13 +49,15 @@ struct httpr_prc
   /* Object */
   const tiz_prc_t _;
   OMX_STRING mount_name_;
-  bool port_disabled_;
+  OMX_U32 nmounts_; /* One mountpoint per mp3 input port */
+  bool port_disabled_[ICE_MAX_MOUNTPOINTS];
   int lstn_sockfd_;
   httpr_server_t * p_server_;
-  OMX_BUFFERHEADERTYPE * p_inhdr_;
-  OMX_AUDIO_PARAM_MP3TYPE mp3type_;
+  tiz_event_timer_t * p_stats_timer_;
+  OMX_BUFFERHEADERTYPE * p_inhdr_[ICE_MAX_MOUNTPOINTS];
+  OMX_AUDIO_PARAM_MP3TYPE mp3type_[ICE_MAX_MOUNTPOINTS];
   OMX_TIZONIA_HTTPSERVERTYPE server_info_;
-  OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_;
+  OMX_TIZONIA_ICECASTMOUNTPOINTTYPE mountpoint_[ICE_MAX_MOUNTPOINTS];
 };
 
 typedef struct httpr_prc_class httpr_prc_class_t;
@@ -25,6 +25,13 @@
  *
  * NOTE: This is work in progress!!!!
  *
+ * The component's thread accepts new connections and feeds the mountpoints'
+ * chunk rings from the input ports. Everything else happens on a pool of
+ * worker threads: each worker owns the sockets of the listeners it has been
+ * handed, waits on them with its own epoll instance, and paces the writes of
+ * its listeners itself. A worker whose listener has caught up with the head of
+ * a ring asks the component's thread for more data through an eventfd.
+ *
  * TODO: Better flow control
  *
  */
@@ -46,6 +53,9 @@
 #include <errno.h>
 #include <time.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #include <tizplatform.h>
 #include <tizutils.h>
@@ -66,21 +76,58 @@
 #define ICE_RENDERER_MAX_ADDR_LEN 46
 #endif
 
-typedef struct httpr_connection httpr_connection_t;
+#define ICE_ICY_BLOCK_MAX_LEN (OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE + 17)
+
 typedef struct httpr_listener httpr_listener_t;
 typedef struct httpr_listener_buffer httpr_listener_buffer_t;
+typedef struct httpr_chunk httpr_chunk_t;
+typedef struct httpr_iovec_set httpr_iovec_set_t;
 typedef struct httpr_mount httpr_mount_t;
+typedef struct httpr_pending_con httpr_pending_con_t;
+typedef struct httpr_worker httpr_worker_t;
 
 struct httpr_listener_buffer
 {
   unsigned int len;
-  unsigned int metadata_offset;
-  unsigned int metadata_bytes;
   char * p_data;
 };
 
+/* An encoded chunk, shared by all the listeners of a mountpoint. The ring
+ * holds one reference; every write in progress that points into the chunk
+ * holds another, so a chunk that falls off the ring in the meantime stays
+ * alive until that write is over. */
+struct httpr_chunk
+{
+  OMX_U32 refcount;
+  size_t len;
+  OMX_U8 data[];
+};
+
+typedef enum httpr_iov_kind httpr_iov_kind_t;
+enum httpr_iov_kind
+{
+  IOV_AUDIO,
+  IOV_METADATA,
+  IOV_PENDING_METADATA
+};
+
+struct httpr_iovec_set
+{
+  struct iovec iov[ICE_MAX_IOVECS];
+  httpr_iov_kind_t kind[ICE_MAX_IOVECS];
+  bool chunk_end[ICE_MAX_IOVECS]; /* IOV_AUDIO slice ends its chunk */
+  httpr_chunk_t * p_chunks[ICE_MAX_IOVECS]; /* References held by the set */
+  int nchunks;
+  int count;
+  size_t len;
+};
+
+/* Everything in a mountpoint is protected by its mutex; the component's
+ * thread writes the settings and the ring, the workers read them. */
 struct httpr_mount
 {
+  OMX_U32 pid; /* The input port that feeds this mountpoint */
+  tiz_mutex_t mutex;
   OMX_U8 mount_name[OMX_MAX_STRINGNAME_SIZE];
   OMX_U8 station_name[OMX_MAX_STRINGNAME_SIZE];
   OMX_U8 station_description[OMX_MAX_STRINGNAME_SIZE];
@@ -90,37 +137,91 @@ struct httpr_mount
   OMX_U8 stream_title[OMX_MAX_STRINGNAME_SIZE];
   OMX_U32 initial_burst_size;
   OMX_U32 max_clients;
+  OMX_U32 bitrate;
+  OMX_U32 num_channels;
+  OMX_U32 sample_rate;
+  OMX_U32 bytes_per_frame;
+  OMX_U32 burst_size;
+  double wait_time;
+  double pkts_per_sec;
+  /* The ICY metadata block (length byte + zero-padded title), rebuilt on
+   * every title change; title_version tells listeners it has changed */
+  OMX_U8 icy_block[ICE_ICY_BLOCK_MAX_LEN];
+  size_t icy_block_len;
+  OMX_U32 title_version;
+  /* Chunk 'seq' lives in slot 'seq % ICE_CHUNK_RING_SIZE' */
+  httpr_chunk_t * p_chunks[ICE_CHUNK_RING_SIZE];
+  uint64_t head; /* seq of the next chunk to be appended */
+  uint64_t tail; /* seq of the oldest chunk still in the ring */
+  size_t bytes;  /* bytes held in [tail, head) */
+  bool need_data;
+  /* Stats */
+  OMX_U32 nlisteners;
+  OMX_U32 peak_listeners;
+  OMX_U32 total_connections;
+  OMX_U32 rejected_connections;
+  OMX_U32 listener_skips;
+  uint64_t bytes_sent;
+};
+
+typedef enum httpr_listener_state httpr_listener_state_t;
+enum httpr_listener_state
+{
+  LSTNR_AWAITING_REQUEST,
+  LSTNR_STREAMING,
+  LSTNR_BLOCKED /* Waiting for the socket to become writable */
 };
 
-struct httpr_connection
+/* A listener belongs to one worker and is only ever touched by its thread */
+struct httpr_listener
 {
-  httpr_listener_t * p_lstnr;
+  httpr_worker_t * p_wrk;
+  httpr_mount_t * p_mount; /* NULL until the request has been accepted */
+  httpr_listener_t * p_prev;
+  httpr_listener_t * p_next;
+  httpr_listener_state_t state;
+  double due; /* When the next burst is due (monotonic seconds) */
+  int sockfd;
+  char * p_ip;
+  unsigned short port;
   time_t con_time;
   uint64_t sent_total;
   unsigned int sent_last;
   unsigned int burst_bytes;
   OMX_S32 initial_burst_bytes;
-  bool metadata_delivered;
+  uint64_t chunk_seq; /* Cursor into the mountpoint's chunk ring */
+  size_t chunk_off;
+  uint64_t metadata_sent_at; /* sent_total when the last ICY block went out */
+  OMX_U32 title_version;
+  bool title_pending; /* The current title has not been sent yet */
+  OMX_U8 icy_block[ICE_ICY_BLOCK_MAX_LEN]; /* This listener's title block */
+  httpr_listener_buffer_t buf; /* Request and partially-sent metadata bytes */
+  tiz_http_parser_t * p_parser;
+  bool want_metadata;
+};
+
+/* A connection accepted by the component's thread, on its way to a worker */
+struct httpr_pending_con
+{
   int sockfd;
-  char * p_host;
   char * p_ip;
   unsigned short port;
-  tiz_event_io_t * p_ev_io;
-  tiz_event_timer_t * p_ev_timer;
+  httpr_pending_con_t * p_next;
 };
 
-struct httpr_listener
+struct httpr_worker
 {
   httpr_server_t * p_server;
-  httpr_connection_t * p_con;
-  int respcode;
-  long intro_offset;
-  unsigned long pos;
-  httpr_listener_buffer_t buf;
-  tiz_http_parser_t * p_parser;
-  bool need_response;
-  bool timer_started;
-  bool want_metadata;
+  OMX_U32 index;
+  tiz_thread_t thread;
+  bool started;
+  int epfd;
+  int evfd; /* New connections and stop requests */
+  tiz_mutex_t mutex; /* Protects p_pending, load and stop */
+  httpr_pending_con_t * p_pending;
+  OMX_U32 load; /* Pending plus live listeners */
+  bool stop;
+  httpr_listener_t * p_lstnrs; /* Only used by the worker's thread */
 };
 
 struct httpr_server
@@ -129,46 +230,21 @@ struct httpr_server
   int lstn_sockfd;
   char * p_ip;
   tiz_event_io_t * p_srv_ev_io;
-  OMX_U32 max_clients; /* In future, more than one will be allowed;
-                          only one allowed at the moment. */
-  tiz_map_t * p_lstnrs;
-  OMX_BUFFERHEADERTYPE * p_hdr;
+  int wake_fd; /* Workers ask the component's thread for data through this */
+  tiz_event_io_t * p_wake_ev_io;
+  tiz_mutex_t mutex; /* Protects nlisteners */
+  OMX_U32 max_clients;
+  OMX_U32 nlisteners;
   httpr_srv_release_buffer_f pf_release_buf;
   httpr_srv_acquire_buffer_f pf_acquire_buf;
-  bool need_more_data;
   bool running;
   OMX_PTR p_arg;
-  OMX_U32 bitrate;
-  OMX_U32 num_channels;
-  OMX_U32 sample_rate;
-  OMX_U32 bytes_per_frame;
-  OMX_U32 burst_size;
-  double wait_time;
-  double pkts_per_sec;
-  httpr_mount_t mountpoint;
+  httpr_mount_t mounts[ICE_MAX_MOUNTPOINTS];
+  OMX_U32 nmounts;
+  httpr_worker_t workers[ICE_MAX_WORKER_THREADS];
+  OMX_U32 nworkers;
 };
 
-static void
-srv_destroy_listener (httpr_listener_t * ap_lstnr);
-
-static OMX_S32
-listeners_map_compare_func (OMX_PTR ap_key1, OMX_PTR ap_key2)
-{
-  int * p_sockfd1 = (int *) ap_key1;
-  int * p_sockfd2 = (int *) ap_key2;
-  assert (ap_key1);
-  assert (ap_key2);
-  return (*p_sockfd1 == *p_sockfd2) ? 0 : ((*p_sockfd1 < *p_sockfd2) ? -1 : 1);
-}
-
-static void
-listeners_map_free_func (OMX_PTR ap_key, OMX_PTR ap_value)
-{
-  httpr_listener_t * p_lstnr = (httpr_listener_t *) ap_value;
-  assert (p_lstnr);
-  srv_destroy_listener (p_lstnr);
-}
-
 static bool
 srv_is_recoverable_error (httpr_server_t * ap_server, int sockfd, int error)
 {
@@ -222,28 +298,6 @@ srv_get_socket_buffer_utilization (const int a_sockfd)
   return remaining;
 }
 
-static inline int
-srv_get_listeners_count (const httpr_server_t * ap_server)
-{
-  int rc = 0;
-  if (ap_server && ap_server->p_lstnrs)
-    {
-      rc = tiz_map_size (ap_server->p_lstnrs);
-    }
-  return rc;
-}
-
-static httpr_listener_t *
-srv_get_first_listener (const httpr_server_t * ap_server)
-{
-  httpr_listener_t * p_lstnr = NULL;
-  if (srv_get_listeners_count (ap_server) > 0)
-    {
-      p_lstnr = tiz_map_value_at (ap_server->p_lstnrs, 0);
-    }
-  return p_lstnr;
-}
-
 static int
 srv_set_non_blocking (const int sockfd)
 {
@@ -422,12 +476,23 @@ srv_create_server_socket (httpr_server_t * ap_server, const int a_port,
   return ICE_SOCK_ERROR;
 }
 
+
+static inline double
+srv_now (void)
+{
+  struct timespec ts;
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 static void
 srv_destroy_server_io_watcher (httpr_server_t * ap_server)
 {
   assert (ap_server);
   tiz_srv_io_watcher_destroy (ap_server->p_parent, ap_server->p_srv_ev_io);
   ap_server->p_srv_ev_io = NULL;
+  tiz_srv_io_watcher_destroy (ap_server->p_parent, ap_server->p_wake_ev_io);
+  ap_server->p_wake_ev_io = NULL;
 }
 
 static OMX_ERRORTYPE
@@ -441,6 +506,12 @@ srv_allocate_server_io_watcher (httpr_server_t * ap_server)
     TIZ_EVENT_READ, /* Interested in read events only */
     true            /* Only one event at a time */
     );
+  if (OMX_ErrorNone == rc)
+    {
+      rc = tiz_srv_io_watcher_init (ap_server->p_parent,
+                                    &(ap_server->p_wake_ev_io),
+                                    ap_server->wake_fd, TIZ_EVENT_READ, true);
+    }
   if (OMX_ErrorNone != rc)
     {
       srv_destroy_server_io_watcher (ap_server);
@@ -471,205 +542,429 @@ srv_stop_server_io_watcher (httpr_server_t * ap_server)
   return tiz_srv_io_watcher_stop (ap_server->p_parent, ap_server->p_srv_ev_io);
 }
 
-static OMX_ERRORTYPE
-srv_start_listener_io_watcher (httpr_listener_t * ap_lstnr)
+static inline OMX_ERRORTYPE
+srv_start_wake_io_watcher (httpr_server_t * ap_server)
 {
-  assert (ap_lstnr);
-  assert (ap_lstnr->p_server);
-  assert (ap_lstnr->p_con);
-  return tiz_srv_io_watcher_start (ap_lstnr->p_server->p_parent,
-                                   ap_lstnr->p_con->p_ev_io);
+  assert (ap_server);
+  return tiz_srv_io_watcher_start (ap_server->p_parent,
+                                   ap_server->p_wake_ev_io);
 }
 
-static OMX_ERRORTYPE
-srv_stop_listener_io_watcher (httpr_listener_t * ap_lstnr)
+static inline OMX_ERRORTYPE
+srv_stop_wake_io_watcher (httpr_server_t * ap_server)
 {
-  assert (ap_lstnr);
-  assert (ap_lstnr->p_con);
-  return tiz_srv_io_watcher_stop (ap_lstnr->p_server->p_parent,
-                                  ap_lstnr->p_con->p_ev_io);
+  assert (ap_server);
+  return tiz_srv_io_watcher_stop (ap_server->p_parent,
+                                  ap_server->p_wake_ev_io);
 }
 
-static OMX_ERRORTYPE
-srv_start_listener_timer_watcher (httpr_listener_t * ap_lstnr,
-                                  const double a_wait_time)
+static inline void
+srv_signal_eventfd (const int a_fd)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  assert (ap_lstnr);
-  if (!ap_lstnr->timer_started)
+  const uint64_t one = 1;
+  /* The counter saturating is not a concern; any wake-up will do */
+  (void) write (a_fd, &one, sizeof (one));
+}
+
+static inline void
+srv_drain_eventfd (const int a_fd)
+{
+  uint64_t count = 0;
+  (void) read (a_fd, &count, sizeof (count));
+}
+
+/*
+ * Mountpoints and their chunk rings
+ */
+
+static httpr_mount_t *
+srv_get_mount (httpr_server_t * ap_server, const OMX_U32 a_pid)
+{
+  OMX_U32 i = 0;
+  assert (ap_server);
+  for (i = 0; i < ap_server->nmounts; ++i)
     {
-      assert (ap_lstnr->p_server);
-      assert (ap_lstnr->p_con);
-      tiz_check_omx (tiz_srv_timer_watcher_start (
-        ap_lstnr->p_server->p_parent, ap_lstnr->p_con->p_ev_timer, a_wait_time,
-        a_wait_time));
-      ap_lstnr->timer_started = true;
+      if (ap_server->mounts[i].pid == a_pid)
+        {
+          return &(ap_server->mounts[i]);
+        }
     }
-  return rc;
+  return NULL;
 }
 
-static OMX_ERRORTYPE
-srv_stop_listener_timer_watcher (httpr_listener_t * ap_lstnr)
+static inline httpr_chunk_t *
+srv_ring_chunk (httpr_mount_t * ap_mount, const uint64_t a_seq)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  assert (ap_lstnr);
-  if (ap_lstnr->timer_started)
+  assert (ap_mount);
+  return ap_mount->p_chunks[a_seq % ICE_CHUNK_RING_SIZE];
+}
+
+/* Must be called with the mountpoint's mutex held */
+static void
+srv_unref_chunk (httpr_chunk_t * ap_chunk)
+{
+  assert (ap_chunk);
+  assert (ap_chunk->refcount > 0);
+  if (0 == --ap_chunk->refcount)
     {
-      assert (ap_lstnr->p_server);
-      assert (ap_lstnr->p_con);
-      tiz_check_omx (tiz_srv_timer_watcher_stop (
-        ap_lstnr->p_server->p_parent, ap_lstnr->p_con->p_ev_timer));
-      ap_lstnr->timer_started = false;
+      tiz_mem_free (ap_chunk);
     }
-  return rc;
 }
 
+/* Must be called with the mountpoint's mutex held */
 static void
-srv_destroy_connection (httpr_connection_t * ap_con)
+srv_ring_drop_tail (httpr_mount_t * ap_mount)
+{
+  httpr_chunk_t ** pp_slot = NULL;
+
+  assert (ap_mount);
+  assert (ap_mount->tail < ap_mount->head);
+
+  /* Listeners still reading this chunk keep their own reference to it; those
+   * that have not reached it yet will skip to the new tail by themselves */
+  pp_slot = &(ap_mount->p_chunks[ap_mount->tail % ICE_CHUNK_RING_SIZE]);
+  ap_mount->bytes -= (*pp_slot)->len;
+  srv_unref_chunk (*pp_slot);
+  *pp_slot = NULL;
+  ap_mount->tail++;
+}
+
+static OMX_ERRORTYPE
+srv_ring_append (httpr_mount_t * ap_mount, const OMX_U8 * ap_data,
+                 const size_t a_len)
+{
+  httpr_chunk_t * p_chunk = NULL;
+
+  assert (ap_mount);
+  assert (ap_data);
+  assert (a_len > 0);
+
+  /* This is the one and only copy of the encoded data; from here on, all
+   * listeners of the mountpoint send straight from the chunk */
+  p_chunk = tiz_mem_alloc (sizeof (httpr_chunk_t) + a_len);
+  tiz_check_null_ret_oom (p_chunk != NULL);
+  p_chunk->refcount = 1;
+  p_chunk->len = a_len;
+  memcpy (p_chunk->data, ap_data, a_len);
+
+  tiz_mutex_lock (&(ap_mount->mutex));
+  if (ap_mount->head - ap_mount->tail == ICE_CHUNK_RING_SIZE)
+    {
+      srv_ring_drop_tail (ap_mount);
+    }
+  ap_mount->p_chunks[ap_mount->head % ICE_CHUNK_RING_SIZE] = p_chunk;
+  ap_mount->bytes += a_len;
+  ap_mount->head++;
+  ap_mount->need_data = false;
+  tiz_mutex_unlock (&(ap_mount->mutex));
+
+  return OMX_ErrorNone;
+}
+
+static bool
+srv_ring_needs_data (httpr_mount_t * ap_mount)
 {
-  if (ap_con)
+  bool need_data = false;
+  assert (ap_mount);
+  tiz_mutex_lock (&(ap_mount->mutex));
+  need_data = ap_mount->need_data;
+  tiz_mutex_unlock (&(ap_mount->mutex));
+  return need_data;
+}
+
+static bool
+srv_ring_fill (httpr_server_t * ap_server, httpr_mount_t * ap_mount)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+
+  assert (ap_server);
+  assert (ap_mount);
+
+  if (NULL
+      == (p_hdr = ap_server->pf_acquire_buf (ap_mount->pid, ap_server->p_arg)))
     {
-      if (ICE_SOCK_ERROR != ap_con->sockfd)
+      /* no more buffers available at the moment */
+      return false;
+    }
+
+  if (p_hdr->nFilledLen > 0)
+    {
+      OMX_ERRORTYPE rc = srv_ring_append (
+        ap_mount, p_hdr->pBuffer + p_hdr->nOffset, p_hdr->nFilledLen);
+      if (OMX_ErrorNone != rc)
         {
-          close (ap_con->sockfd);
+          TIZ_ERROR (handleOf (ap_server->p_parent),
+                     "[%s] : Dropping [%u] bytes of encoded data",
+                     tiz_err_to_str (rc), (unsigned int) p_hdr->nFilledLen);
         }
-      tiz_mem_free (ap_con->p_ip);
-      tiz_mem_free (ap_con->p_host);
-      assert (ap_con->p_lstnr && ap_con->p_lstnr->p_server);
-      tiz_srv_io_watcher_destroy (ap_con->p_lstnr->p_server->p_parent,
-                                  ap_con->p_ev_io);
-      tiz_srv_timer_watcher_destroy (ap_con->p_lstnr->p_server->p_parent,
-                                     ap_con->p_ev_timer);
-      tiz_mem_free (ap_con);
+    }
+
+  /* The buffer can go back to the port straight away */
+  p_hdr->nFilledLen = 0;
+  ap_server->pf_release_buf (p_hdr, ap_mount->pid, ap_server->p_arg);
+
+  return true;
+}
+
+static void
+srv_fill_rings (httpr_server_t * ap_server)
+{
+  OMX_U32 i = 0;
+  assert (ap_server);
+  /* Only the mountpoints with a listener that has caught up with the head of
+     the ring pull more data from their port */
+  for (i = 0; i < ap_server->nmounts; ++i)
+    {
+      httpr_mount_t * p_mount = &(ap_server->mounts[i]);
+      while (srv_ring_needs_data (p_mount) && srv_ring_fill (ap_server, p_mount))
+        ;
     }
 }
 
 static void
-srv_destroy_listener (httpr_listener_t * ap_lstnr)
+srv_ring_reset (httpr_mount_t * ap_mount)
 {
-  if (ap_lstnr)
+  assert (ap_mount);
+  tiz_mutex_lock (&(ap_mount->mutex));
+  while (ap_mount->tail < ap_mount->head)
     {
-      srv_stop_listener_timer_watcher (ap_lstnr);
-      if (ap_lstnr->p_parser)
-        {
-          tiz_http_parser_destroy (ap_lstnr->p_parser);
-        }
-      tiz_mem_free (ap_lstnr->buf.p_data);
-      srv_destroy_connection (ap_lstnr->p_con);
-      tiz_mem_free (ap_lstnr);
+      srv_ring_drop_tail (ap_mount);
     }
+  assert (0 == ap_mount->bytes);
+  ap_mount->need_data = false;
+  tiz_mutex_unlock (&(ap_mount->mutex));
 }
 
 static void
-srv_remove_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+srv_set_mount_defaults (httpr_mount_t * ap_mount, const OMX_U32 a_pid)
 {
-  int nlstnrs = 0;
+  assert (ap_mount);
+  ap_mount->pid = a_pid;
+  ap_mount->metadata_period = ICE_DEFAULT_METADATA_INTERVAL;
+  ap_mount->initial_burst_size = ICE_INITIAL_BURST_SIZE;
+  ap_mount->max_clients = 1;
+  ap_mount->bytes_per_frame = 144 * 128000 / 44100;
+  ap_mount->burst_size = ICE_MEDIUM_BURST_SIZE;
+  ap_mount->pkts_per_sec
+    = (((double) ap_mount->bytes_per_frame * (double) (1000 / 26)
+        / (double) ap_mount->burst_size));
+  ap_mount->wait_time = (1 / ap_mount->pkts_per_sec);
+}
 
-  assert (ap_server);
+static void
+srv_build_icy_block (httpr_mount_t * ap_mount)
+{
+  size_t title_len = 0;
+  size_t nblocks = 0;
+
+  assert (ap_mount);
+
+  /* Length byte (in 16-byte units) followed by the zero-padded title */
+  title_len = strnlen ((char *) ap_mount->stream_title,
+                       OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE - 1);
+  nblocks = (title_len + 15) / 16;
+  tiz_mem_set (ap_mount->icy_block, 0, sizeof (ap_mount->icy_block));
+  ap_mount->icy_block[0] = (OMX_U8) nblocks;
+  memcpy (ap_mount->icy_block + 1, ap_mount->stream_title, title_len);
+  ap_mount->icy_block_len = 1 + (nblocks * 16);
+  assert (ap_mount->icy_block_len <= sizeof (ap_mount->icy_block));
+}
+
+/*
+ * Listeners (these run on the worker threads)
+ */
+
+static OMX_ERRORTYPE
+wrk_set_listener_events (httpr_listener_t * ap_lstnr, const uint32_t a_events)
+{
+  struct epoll_event ev;
   assert (ap_lstnr);
+  assert (ap_lstnr->p_wrk);
+  tiz_mem_set (&ev, 0, sizeof (ev));
+  ev.events = a_events | EPOLLRDHUP;
+  ev.data.ptr = ap_lstnr;
+  return (0 == epoll_ctl (ap_lstnr->p_wrk->epfd, EPOLL_CTL_MOD,
+                          ap_lstnr->sockfd, &ev)
+            ? OMX_ErrorNone
+            : OMX_ErrorInsufficientResources);
+}
+
+static bool
+wrk_reserve_slot (httpr_server_t * ap_server, httpr_mount_t * ap_mount)
+{
+  bool reserved = false;
 
-  nlstnrs = srv_get_listeners_count (ap_server);
-  assert (nlstnrs > 0);
+  assert (ap_server);
+  assert (ap_mount);
 
-  TIZ_LOG (TIZ_PRIORITY_TRACE,
-           "Destroyed listener [%s] - [%d] listeners remaining",
-           ap_lstnr->p_con->p_ip, nlstnrs - 1);
+  /* Lock order is always server, then mountpoint */
+  tiz_mutex_lock (&(ap_server->mutex));
+  tiz_mutex_lock (&(ap_mount->mutex));
+  if (ap_server->nlisteners < ap_server->max_clients
+      && ap_mount->nlisteners < ap_mount->max_clients)
+    {
+      ap_server->nlisteners++;
+      ap_mount->nlisteners++;
+      ap_mount->peak_listeners
+        = MAX (ap_mount->peak_listeners, ap_mount->nlisteners);
+      ap_mount->total_connections++;
+      reserved = true;
+    }
+  else
+    {
+      ap_mount->rejected_connections++;
+    }
+  tiz_mutex_unlock (&(ap_mount->mutex));
+  tiz_mutex_unlock (&(ap_server->mutex));
 
-  tiz_map_erase (ap_server->p_lstnrs, &ap_lstnr->p_con->sockfd);
-  assert (nlstnrs - 1 == srv_get_listeners_count (ap_server));
+  return reserved;
+}
 
-  /* NOTE: No need to call srv_destroy_listener as this has been called already
-   * by
-   * the map's listeners_map_free_func */
+static void
+wrk_release_slot (httpr_server_t * ap_server, httpr_mount_t * ap_mount)
+{
+  assert (ap_server);
+  assert (ap_mount);
+
+  tiz_mutex_lock (&(ap_server->mutex));
+  tiz_mutex_lock (&(ap_mount->mutex));
+  assert (ap_server->nlisteners > 0);
+  assert (ap_mount->nlisteners > 0);
+  ap_server->nlisteners--;
+  ap_mount->nlisteners--;
+  tiz_mutex_unlock (&(ap_mount->mutex));
+  tiz_mutex_unlock (&(ap_server->mutex));
 }
 
-static httpr_connection_t *
-srv_create_connection (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                       const int connected_sockfd, char * ap_ip,
-                       const unsigned short ap_port, const double a_wait_time)
+static void
+wrk_attach_listener (httpr_mount_t * ap_mount, httpr_listener_t * ap_lstnr)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  httpr_connection_t * p_con = NULL;
-  OMX_HANDLETYPE p_hdl = NULL;
+  uint64_t seq = 0;
+  size_t burst = 0;
 
-  assert (ap_server);
+  assert (ap_mount);
   assert (ap_lstnr);
-  p_hdl = handleOf (ap_server->p_parent);
 
-  p_con
-    = (httpr_connection_t *) tiz_mem_calloc (1, sizeof (httpr_connection_t));
-  rc = p_con ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
-  goto_end_on_omx_error (rc, p_hdl, "Unable to alloc the connection struct");
-
-  p_con->p_lstnr = ap_lstnr;
-  p_con->con_time = 0; /* time (NULL); */
-  p_con->sent_total = 0;
-  p_con->sent_last = 0;
-  p_con->burst_bytes = 0;
-  p_con->initial_burst_bytes = ap_server->mountpoint.initial_burst_size;
-  p_con->sockfd = connected_sockfd;
-  p_con->p_host = NULL;
-  p_con->p_ip = ap_ip;
-  p_con->port = ap_port;
-  p_con->p_ev_io = NULL;
-  p_con->p_ev_timer = NULL;
+  tiz_mutex_lock (&(ap_mount->mutex));
 
-  /* We are interested in knowing when a listener socket is available for
-   * writing */
-  rc = tiz_srv_io_watcher_init (ap_server->p_parent, &(p_con->p_ev_io),
-                                p_con->sockfd, TIZ_EVENT_WRITE, true);
-  goto_end_on_omx_error (rc, p_hdl, "Unable to init the client's io event");
+  /* Start far enough behind the head for the initial burst to be served with
+   * audio that is already in the ring */
+  seq = ap_mount->head;
+  while (seq > ap_mount->tail && burst < ap_mount->initial_burst_size)
+    {
+      --seq;
+      burst += srv_ring_chunk (ap_mount, seq)->len;
+    }
 
-  rc = tiz_srv_timer_watcher_init (ap_server->p_parent, &(p_con->p_ev_timer));
-  goto_end_on_omx_error (rc, p_hdl, "Unable to init the client's timer event");
+  ap_lstnr->chunk_seq = seq;
+  ap_lstnr->chunk_off = 0;
+  ap_lstnr->initial_burst_bytes = ap_mount->initial_burst_size;
+  ap_lstnr->title_version = ap_mount->title_version;
+  ap_lstnr->title_pending = true;
+  ap_lstnr->p_mount = ap_mount;
 
-end:
-  if (OMX_ErrorNone != rc)
+  tiz_mutex_unlock (&(ap_mount->mutex));
+}
+
+static void
+wrk_destroy_listener (httpr_listener_t * ap_lstnr)
+{
+  if (ap_lstnr)
     {
-      srv_destroy_connection (p_con);
-      p_con = NULL;
-    }
+      httpr_worker_t * p_wrk = ap_lstnr->p_wrk;
+      assert (p_wrk);
+
+      if (ap_lstnr->p_prev)
+        {
+          ap_lstnr->p_prev->p_next = ap_lstnr->p_next;
+        }
+      else if (p_wrk->p_lstnrs == ap_lstnr)
+        {
+          p_wrk->p_lstnrs = ap_lstnr->p_next;
+        }
+      if (ap_lstnr->p_next)
+        {
+          ap_lstnr->p_next->p_prev = ap_lstnr->p_prev;
+        }
+
+      if (ap_lstnr->p_mount)
+        {
+          wrk_release_slot (p_wrk->p_server, ap_lstnr->p_mount);
+        }
+
+      TIZ_TRACE (handleOf (p_wrk->p_server->p_parent),
+                 "Destroyed listener [%s] fd [%d] (worker [%u])",
+                 ap_lstnr->p_ip ? ap_lstnr->p_ip : "", ap_lstnr->sockfd,
+                 (unsigned int) p_wrk->index);
+
+      if (ICE_SOCK_ERROR != ap_lstnr->sockfd)
+        {
+          /* Closing the socket only takes it out of the epoll set when no
+             other descriptor refers to it; the listener may not have been
+             added yet, in which case this fails harmlessly */
+          (void) epoll_ctl (p_wrk->epfd, EPOLL_CTL_DEL, ap_lstnr->sockfd,
+                            NULL);
+          close (ap_lstnr->sockfd);
+        }
+      if (ap_lstnr->p_parser)
+        {
+          tiz_http_parser_destroy (ap_lstnr->p_parser);
+        }
+      tiz_mem_free (ap_lstnr->buf.p_data);
+      tiz_mem_free (ap_lstnr->p_ip);
+      tiz_mem_free (ap_lstnr);
 
-  return p_con;
+      tiz_mutex_lock (&(p_wrk->mutex));
+      assert (p_wrk->load > 0);
+      p_wrk->load--;
+      tiz_mutex_unlock (&(p_wrk->mutex));
+    }
 }
 
 static OMX_ERRORTYPE
-srv_create_listener (httpr_server_t * ap_server, httpr_listener_t ** app_lstnr,
-                     const int a_connected_sockfd, char * ap_ip,
-                     const unsigned short ap_port)
+wrk_create_listener (httpr_worker_t * ap_wrk, httpr_pending_con_t * ap_con)
 {
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   httpr_listener_t * p_lstnr = NULL;
-  httpr_connection_t * p_con = NULL;
   OMX_HANDLETYPE p_hdl = NULL;
   int sockrc = ICE_SOCK_ERROR;
+  struct epoll_event ev;
 
-  assert (ap_server);
-  assert (app_lstnr);
-  assert (ICE_SOCK_ERROR != a_connected_sockfd);
-  assert (ap_ip);
-  p_hdl = handleOf (ap_server->p_parent);
+  assert (ap_wrk);
+  assert (ap_con);
+  assert (ICE_SOCK_ERROR != ap_con->sockfd);
+  p_hdl = handleOf (ap_wrk->p_server->p_parent);
 
   p_lstnr = (httpr_listener_t *) tiz_mem_calloc (1, sizeof (httpr_listener_t));
-  rc = p_lstnr ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
-  goto_end_on_omx_error (rc, p_hdl, "Unable to alloc the listener structure");
-
-  p_con = srv_create_connection (ap_server, p_lstnr, a_connected_sockfd, ap_ip,
-                                 ap_port, ap_server->wait_time);
-  rc = p_con ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
-  goto_end_on_omx_error (rc, p_hdl, "Unable to init the listener's connection");
-
-  p_lstnr->p_server = ap_server;
-  p_lstnr->p_con = p_con;
-  p_lstnr->respcode = 200;
-  p_lstnr->intro_offset = 0;
-  p_lstnr->pos = 0;
+  if (!p_lstnr)
+    {
+      TIZ_ERROR (p_hdl, "Unable to alloc the listener structure");
+      close (ap_con->sockfd);
+      tiz_mem_free (ap_con->p_ip);
+      tiz_mutex_lock (&(ap_wrk->mutex));
+      ap_wrk->load--;
+      tiz_mutex_unlock (&(ap_wrk->mutex));
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* From here on, the listener owns the socket and the ip string */
+  p_lstnr->p_wrk = ap_wrk;
+  p_lstnr->p_mount = NULL;
+  p_lstnr->p_prev = NULL;
+  p_lstnr->p_next = ap_wrk->p_lstnrs;
+  if (ap_wrk->p_lstnrs)
+    {
+      ap_wrk->p_lstnrs->p_prev = p_lstnr;
+    }
+  ap_wrk->p_lstnrs = p_lstnr;
+  p_lstnr->state = LSTNR_AWAITING_REQUEST;
+  p_lstnr->due = 0;
+  p_lstnr->sockfd = ap_con->sockfd;
+  p_lstnr->p_ip = ap_con->p_ip;
+  p_lstnr->port = ap_con->port;
+  p_lstnr->con_time = 0; /* time (NULL); */
   p_lstnr->buf.len = ICE_LISTENER_BUF_SIZE;
-  p_lstnr->buf.metadata_offset = 0;
-  p_lstnr->buf.metadata_bytes = 0;
   p_lstnr->p_parser = NULL;
-  p_lstnr->need_response = true;
-  p_lstnr->timer_started = false;
   p_lstnr->want_metadata = false;
 
   p_lstnr->buf.p_data = (char *) tiz_mem_alloc (ICE_LISTENER_BUF_SIZE);
@@ -680,11 +975,19 @@ srv_create_listener (httpr_server_t * ap_server, httpr_listener_t ** app_lstnr,
   rc = tiz_http_parser_init (&(p_lstnr->p_parser), ETIZHttpParserTypeRequest);
   goto_end_on_omx_error (rc, p_hdl, "Unable to init the http parser");
 
-  sockrc = srv_set_non_blocking (p_lstnr->p_con->sockfd);
+  sockrc = srv_set_non_blocking (p_lstnr->sockfd);
+  rc = sockrc < 0 ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
+  goto_end_on_socket_error (sockrc, p_hdl, strerror (errno));
+
+  sockrc = srv_set_nodelay (p_lstnr->sockfd);
   rc = sockrc < 0 ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
   goto_end_on_socket_error (sockrc, p_hdl, strerror (errno));
 
-  sockrc = srv_set_nodelay (p_lstnr->p_con->sockfd);
+  /* Wait for the listener's request */
+  tiz_mem_set (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN | EPOLLRDHUP;
+  ev.data.ptr = p_lstnr;
+  sockrc = epoll_ctl (ap_wrk->epfd, EPOLL_CTL_ADD, p_lstnr->sockfd, &ev);
   rc = sockrc < 0 ? OMX_ErrorInsufficientResources : OMX_ErrorNone;
   goto_end_on_socket_error (sockrc, p_hdl, strerror (errno));
 
@@ -694,31 +997,26 @@ end:
 
   if (OMX_ErrorNone != rc)
     {
-      srv_destroy_listener (p_lstnr);
+      wrk_destroy_listener (p_lstnr);
       p_lstnr = NULL;
     }
 
-  *app_lstnr = p_lstnr;
-
   return rc;
 }
 
 static int
-srv_read_from_listener (httpr_listener_t * ap_lstnr)
+wrk_read_from_listener (httpr_listener_t * ap_lstnr)
 {
-  httpr_connection_t * p_con = NULL;
   httpr_listener_buffer_t * p_buf = NULL;
 
   assert (ap_lstnr);
-  assert (ap_lstnr->p_con);
 
-  p_con = ap_lstnr->p_con;
   p_buf = &ap_lstnr->buf;
   assert (p_buf->p_data);
   assert (p_buf->len > 0);
 
   errno = 0;
-  return recv (p_con->sockfd, p_buf->p_data, p_buf->len, 0);
+  return recv (ap_lstnr->sockfd, p_buf->p_data, p_buf->len, 0);
 }
 
 static ssize_t
@@ -786,16 +1084,15 @@ srv_build_http_negative_response (char * ap_buf, size_t len, int status,
   return ret;
 }
 
+
 static void
-srv_send_http_error (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                     int a_error, const char * ap_err_msg)
+wrk_send_http_error (httpr_listener_t * ap_lstnr, int a_error,
+                     const char * ap_err_msg)
 {
   ssize_t resp_size = 0;
 
-  assert (ap_server);
   assert (ap_lstnr);
   assert (ap_lstnr->buf.p_data);
-  assert (ap_lstnr->p_con);
   assert (ap_err_msg);
 
   ap_lstnr->buf.p_data[ICE_LISTENER_BUF_SIZE - 1] = '\000';
@@ -809,15 +1106,14 @@ srv_send_http_error (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
 
   ap_lstnr->buf.len = strnlen (ap_lstnr->buf.p_data, ICE_LISTENER_BUF_SIZE);
 
-  send (ap_lstnr->p_con->sockfd, ap_lstnr->buf.p_data, ap_lstnr->buf.len, 0);
+  send (ap_lstnr->sockfd, ap_lstnr->buf.p_data, ap_lstnr->buf.len,
+        MSG_NOSIGNAL);
   ap_lstnr->buf.len = 0;
 }
 
 static ssize_t
-srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
-                                  size_t len, OMX_U32 a_bitrate,
-                                  OMX_U32 a_num_channels, OMX_U32 a_sample_rate,
-                                  bool a_want_metadata)
+wrk_build_http_positive_response (httpr_mount_t * ap_mount, char * ap_buf,
+                                  size_t len, bool a_want_metadata)
 {
   const char * http_version = "1.0";
   char status_buffer[80];
@@ -837,9 +1133,11 @@ srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
   int pub = 0;
   bool metadata_needed = false;
 
-  assert (ap_server);
+  assert (ap_mount);
   assert (ap_buf);
 
+  tiz_mutex_lock (&(ap_mount->mutex));
+
   /* HTTP status line */
   snprintf (status_buffer, sizeof (status_buffer), "HTTP/%s %d %s\r\n",
             http_version, status, statusmsg);
@@ -850,42 +1148,44 @@ srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
 
   /* icy-br header */
   snprintf (icybr_buffer, sizeof (icybr_buffer), "icy-br:%d\r\n",
-            (int) a_bitrate / 1000);
+            (int) ap_mount->bitrate / 1000);
 
   /* ice-audio-info header */
   snprintf (iceaudioinfo_buffer, sizeof (iceaudioinfo_buffer),
             "ice-audio-info: "
             "bitrate=%d;channels=%d;samplerate=%d\r\n",
-            (int) a_bitrate, (int) a_num_channels, (int) a_sample_rate);
+            (int) ap_mount->bitrate, (int) ap_mount->num_channels,
+            (int) ap_mount->sample_rate);
 
   /* icy-name header */
   snprintf (icyname_buffer, sizeof (icyname_buffer), "icy-name:%s\r\n",
-            ap_server->mountpoint.station_name);
+            ap_mount->station_name);
 
   /* icy-decription header */
   snprintf (icydescription_buffer, sizeof (icydescription_buffer),
-            "icy-description:%s\r\n",
-            ap_server->mountpoint.station_description);
+            "icy-description:%s\r\n", ap_mount->station_description);
 
   /* icy-genre header */
   snprintf (icygenre_buffer, sizeof (icygenre_buffer), "icy-genre:%s\r\n",
-            ap_server->mountpoint.station_genre);
+            ap_mount->station_genre);
 
   /* icy-url header */
   snprintf (icyurl_buffer, sizeof (icyurl_buffer), "icy-url:%s\r\n",
-            ap_server->mountpoint.station_url);
+            ap_mount->station_url);
 
   /* icy-pub header */
   snprintf (icypub_buffer, sizeof (icypub_buffer), "icy-pub:%u\r\n", pub);
 
-  if (ap_server->mountpoint.metadata_period > 0 && a_want_metadata)
+  if (ap_mount->metadata_period > 0 && a_want_metadata)
     {
       metadata_needed = true;
       /* icy-metaint header */
       snprintf (icymetaint_buffer, sizeof (icymetaint_buffer),
-                "icy-metaint:%lu\r\n", ap_server->mountpoint.metadata_period);
+                "icy-metaint:%lu\r\n", ap_mount->metadata_period);
     }
 
+  tiz_mutex_unlock (&(ap_mount->mutex));
+
   ret = snprintf (
     ap_buf, len, "%s%s%s%s%s%s%s%s%s%s%s%s\r\n", status_buffer,
     contenttype_buffer, icybr_buffer, iceaudioinfo_buffer, icyname_buffer,
@@ -897,42 +1197,72 @@ srv_build_http_positive_response (httpr_server_t * ap_server, char * ap_buf,
 }
 
 static int
-srv_send_http_response (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+wrk_send_http_response (httpr_listener_t * ap_lstnr)
 {
   ssize_t sent_bytes = 0;
 
-  assert (ap_server);
   assert (ap_lstnr);
   assert (ap_lstnr->buf.p_data);
-  assert (ap_lstnr->p_con);
 
   ap_lstnr->buf.len = strnlen (ap_lstnr->buf.p_data, ICE_LISTENER_BUF_SIZE);
 
-  sent_bytes = send (ap_lstnr->p_con->sockfd, ap_lstnr->buf.p_data,
-                     ap_lstnr->buf.len, MSG_NOSIGNAL);
+  sent_bytes = send (ap_lstnr->sockfd, ap_lstnr->buf.p_data, ap_lstnr->buf.len,
+                     MSG_NOSIGNAL);
   ap_lstnr->buf.len = 0;
   return sent_bytes;
 }
 
+static httpr_mount_t *
+wrk_route_request (httpr_server_t * ap_server, const char * ap_url)
+{
+  httpr_mount_t * p_mount = NULL;
+  OMX_U32 i = 0;
+
+  assert (ap_server);
+  assert (ap_url);
+
+  for (i = 0; i < ap_server->nmounts && !p_mount; ++i)
+    {
+      httpr_mount_t * p_candidate = &(ap_server->mounts[i]);
+      tiz_mutex_lock (&(p_candidate->mutex));
+      if (0 == strncmp ((char *) p_candidate->mount_name, ap_url,
+                        OMX_MAX_STRINGNAME_SIZE))
+        {
+          p_mount = p_candidate;
+        }
+      tiz_mutex_unlock (&(p_candidate->mutex));
+    }
+
+  if (!p_mount && ap_server->nmounts > 0 && 0 == strcmp ("/", ap_url))
+    {
+      /* The root always leads somewhere: the first mountpoint */
+      p_mount = &(ap_server->mounts[0]);
+    }
+
+  return p_mount;
+}
+
 static OMX_ERRORTYPE
-srv_handle_listeners_request (httpr_server_t * ap_server,
+wrk_handle_listeners_request (httpr_worker_t * ap_wrk,
                               httpr_listener_t * ap_lstnr)
 {
-#define bail_on_request_error(some_error, httperr, msg)                \
-  do                                                                   \
-    {                                                                  \
-      if (some_error)                                                  \
-        {                                                              \
-          TIZ_ERROR (handleOf (ap_server->p_parent), "[%s]", msg);     \
-          if (httperr > 0)                                             \
-            {                                                          \
-              srv_send_http_error (ap_server, ap_lstnr, httperr, msg); \
-            }                                                          \
-          goto end;                                                    \
-        }                                                              \
-    }                                                                  \
+#define bail_on_request_error(some_error, httperr, msg)         \
+  do                                                            \
+    {                                                           \
+      if (some_error)                                           \
+        {                                                       \
+          TIZ_ERROR (handleOf (p_server->p_parent), "[%s]", msg); \
+          if (httperr > 0)                                      \
+            {                                                   \
+              wrk_send_http_error (ap_lstnr, httperr, msg);     \
+            }                                                   \
+          goto end;                                             \
+        }                                                       \
+    }                                                           \
   while (0)
 
+  httpr_server_t * p_server = NULL;
+  httpr_mount_t * p_mount = NULL;
   int nparsed = 0;
   int nread = -1;
   bool some_error = true;
@@ -940,27 +1270,26 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
   int to_write = -1;
   const char * parsed_string = NULL;
 
-  assert (ap_server);
+  assert (ap_wrk);
   assert (ap_lstnr);
-  assert (ap_lstnr->p_con);
   assert (ap_lstnr->p_parser);
-
-  some_error = (srv_get_listeners_count (ap_server) > ap_server->max_clients);
-  bail_on_request_error (some_error, 400, "Client limit reached");
+  p_server = ap_wrk->p_server;
 
   /*   some_error */
-  /*       = (ap_lstnr->p_con->con_time + ICE_DEFAULT_HEADER_TIMEOUT <= time
+  /*       = (ap_lstnr->con_time + ICE_DEFAULT_HEADER_TIMEOUT <= time
    * (NULL)); */
   /*   bail_on_request_error (some_error, -1, "Connection timed out"); */
 
-  some_error = ((nread = srv_read_from_listener (ap_lstnr)) <= 0);
-  rc
-    = (some_error
-         ? (srv_is_recoverable_error (ap_server, ap_lstnr->p_con->sockfd, errno)
-              ? OMX_ErrorNotReady
-              : OMX_ErrorNone)
-         : OMX_ErrorNone);
-  bail_on_request_error (some_error, -1, strerror (errno));
+  /* Only a read that would block is worth retrying; a zero-length read
+     means that the client has gone before sending its request */
+  some_error = ((nread = wrk_read_from_listener (ap_lstnr)) <= 0);
+  rc = ((some_error && nread < 0
+         && srv_is_recoverable_error (p_server, ap_lstnr->sockfd, errno))
+          ? OMX_ErrorNotReady
+          : OMX_ErrorNone);
+  bail_on_request_error (some_error, -1,
+                         0 == nread ? "Connection closed by the client"
+                                    : strerror (errno));
 
   nparsed
     = tiz_http_parser_parse (ap_lstnr->p_parser, ap_lstnr->buf.p_data, nread);
@@ -977,27 +1306,38 @@ srv_handle_listeners_request (httpr_server_t * ap_server,
        || (0 != strncmp ("/", parsed_string, strlen ("/"))));
   bail_on_request_error (some_error, 401, "Unathorized");
 
+  some_error = (NULL == (p_mount = wrk_route_request (p_server, parsed_string)));
+  bail_on_request_error (some_error, 404, "Mountpoint not found");
+
+  some_error = !wrk_reserve_slot (p_server, p_mount);
+  bail_on_request_error (some_error, 400, "Client limit reached");
+
   if ((parsed_string
        = tiz_http_parser_get_header (ap_lstnr->p_parser, "Icy-MetaData"))
       && (0 == strncmp ("1", parsed_string, strlen ("1"))))
     {
-      TIZ_TRACE (handleOf (ap_server->p_parent), "ICY metadata requested");
+      TIZ_TRACE (handleOf (p_server->p_parent), "ICY metadata requested");
       ap_lstnr->want_metadata = true;
     }
 
+  /* From here on, the slot is released along with the listener */
+  wrk_attach_listener (p_mount, ap_lstnr);
+
   /* The request seems ok. Now build the response */
-  some_error
-    = (0 == (to_write = srv_build_http_positive_response (
-               ap_server, ap_lstnr->buf.p_data, ICE_LISTENER_BUF_SIZE - 1,
-               ap_server->bitrate, ap_server->num_channels,
-               ap_server->sample_rate, ap_lstnr->want_metadata)));
+  some_error = (0 == (to_write = wrk_build_http_positive_response (
+                        p_mount, ap_lstnr->buf.p_data,
+                        ICE_LISTENER_BUF_SIZE - 1, ap_lstnr->want_metadata)));
   bail_on_request_error (some_error, 500, "Internal Server Error");
 
-  some_error = (0 == srv_send_http_response (ap_server, ap_lstnr));
+  some_error = (0 == wrk_send_http_response (ap_lstnr));
   bail_on_request_error (some_error, 500, "Internal Server Error");
 
   some_error = false;
-  ap_lstnr->need_response = false;
+
+  TIZ_NOTICE (handleOf (p_server->p_parent),
+              "Client [%s:%u] fd [%d] now connected to [%s] (worker [%u])",
+              ap_lstnr->p_ip, ap_lstnr->port, ap_lstnr->sockfd,
+              p_mount->mount_name, (unsigned int) ap_wrk->index);
 
 end:
   if (some_error && OMX_ErrorNone == rc)
@@ -1008,273 +1348,251 @@ end:
   return rc;
 }
 
-static OMX_S32
-srv_remove_existing_listener (OMX_PTR ap_key, OMX_PTR ap_value, OMX_PTR ap_arg)
+static inline bool
+wrk_is_time_to_send_metadata (const httpr_listener_t * ap_lstnr,
+                              const OMX_U32 a_period, const uint64_t a_sent,
+                              const uint64_t a_sent_at)
 {
-  httpr_server_t * p_server = ap_arg;
-  httpr_listener_t * p_lstnr = NULL;
-
-  assert (p_server);
-  assert (ap_key);
-  assert (ap_value);
-
-  p_lstnr = (httpr_listener_t *) ap_value;
-
-  srv_remove_listener (p_server, p_lstnr);
-
-  return 0;
+  return (ap_lstnr->want_metadata && a_period > 0 && a_sent > 0
+          && 0 == (a_sent % a_period) && a_sent != a_sent_at);
 }
 
-inline static void
-srv_release_empty_buffer (httpr_server_t * ap_server,
-                          httpr_listener_t * ap_lstnr,
-                          OMX_BUFFERHEADERTYPE ** app_hdr)
+static inline void
+wrk_add_iovec (httpr_iovec_set_t * ap_set, void * ap_base, const size_t a_len,
+               const httpr_iov_kind_t a_kind, const bool a_chunk_end)
 {
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-
-  assert (ap_server);
-  assert (ap_lstnr);
-  assert (app_hdr);
-
-  p_hdr = *app_hdr;
+  assert (ap_set);
+  assert (ap_set->count < ICE_MAX_IOVECS);
+  ap_set->iov[ap_set->count].iov_base = ap_base;
+  ap_set->iov[ap_set->count].iov_len = a_len;
+  ap_set->kind[ap_set->count] = a_kind;
+  ap_set->chunk_end[ap_set->count] = a_chunk_end;
+  ap_set->count++;
+  ap_set->len += a_len;
+}
 
-  ap_lstnr->pos = 0;
-  p_hdr->nFilledLen = 0;
-  ap_server->pf_release_buf (p_hdr, ap_server->p_arg);
-  *app_hdr = NULL;
-  ap_server->p_hdr = NULL;
+static inline size_t
+wrk_get_burst_budget (const httpr_listener_t * ap_lstnr,
+                      const OMX_U32 a_burst_size)
+{
+  if (ap_lstnr->initial_burst_bytes > 0)
+    {
+      return ap_lstnr->initial_burst_bytes;
+    }
+  return (ap_lstnr->burst_bytes < a_burst_size
+            ? a_burst_size - ap_lstnr->burst_bytes
+            : 0);
 }
 
-static bool
-srv_is_listener_ready (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+/* Must be called with the mountpoint's mutex held. Every chunk the set points
+ * into gets an extra reference, to be dropped by wrk_release_iovecs. */
+static void
+wrk_arrange_data (httpr_mount_t * ap_mount, httpr_listener_t * ap_lstnr,
+                  httpr_iovec_set_t * ap_set)
 {
-  bool lstnr_ready = true;
-  OMX_HANDLETYPE p_hdl = NULL;
-  assert (ap_server);
+  static const OMX_U8 empty_icy_block = 0;
+  httpr_listener_buffer_t * p_lstnr_buf = NULL;
+  const OMX_U32 period = ap_mount->metadata_period;
+  uint64_t seq = 0;
+  uint64_t sent = 0;
+  uint64_t sent_at = 0;
+  size_t off = 0;
+  size_t budget = 0;
+  bool title_pending = false;
+
+  assert (ap_mount);
   assert (ap_lstnr);
-  p_hdl = handleOf (ap_server->p_parent);
+  assert (ap_set);
+
+  p_lstnr_buf = &ap_lstnr->buf;
+  ap_set->count = 0;
+  ap_set->nchunks = 0;
+  ap_set->len = 0;
 
-  if (ap_lstnr->need_response)
+  /* Whatever is left of a metadata block that did not fit in the socket last
+   * time must go out before any more audio */
+  if (p_lstnr_buf->len > 0)
     {
-      OMX_ERRORTYPE rc = OMX_ErrorNone;
-      if (OMX_ErrorNone
-          != (rc = srv_handle_listeners_request (ap_server, ap_lstnr)))
+      wrk_add_iovec (ap_set, p_lstnr_buf->p_data, p_lstnr_buf->len,
+                     IOV_PENDING_METADATA, false);
+    }
+
+  seq = ap_lstnr->chunk_seq;
+  off = ap_lstnr->chunk_off;
+  sent = ap_lstnr->sent_total;
+  sent_at = ap_lstnr->metadata_sent_at;
+  title_pending = ap_lstnr->title_pending;
+  budget = wrk_get_burst_budget (ap_lstnr, ap_mount->burst_size);
+
+  while (budget > 0 && seq < ap_mount->head && ap_set->count < ICE_MAX_IOVECS)
+    {
+      httpr_chunk_t * p_chunk = NULL;
+      size_t len = 0;
+
+      if (wrk_is_time_to_send_metadata (ap_lstnr, period, sent, sent_at))
         {
-          if (OMX_ErrorNotReady == rc)
+          /* The stream title goes out once per title change; after that, an
+           * empty block (a single zero length byte) */
+          if (title_pending)
             {
-              TIZ_ERROR (p_hdl, "no data yet lets wait some time ");
-              (void) srv_start_listener_io_watcher (ap_lstnr);
+              memcpy (ap_lstnr->icy_block, ap_mount->icy_block,
+                      ap_mount->icy_block_len);
+              wrk_add_iovec (ap_set, ap_lstnr->icy_block,
+                             ap_mount->icy_block_len, IOV_METADATA, false);
+              title_pending = false;
             }
           else
             {
-              TIZ_ERROR (p_hdl,
-                         "[%s] : while handling the "
-                         "listener's initial request. Will remove the listener",
-                         tiz_err_to_str (rc));
-              srv_remove_listener (ap_server, ap_lstnr);
+              wrk_add_iovec (ap_set, (void *) &empty_icy_block, 1,
+                             IOV_METADATA, false);
             }
-          lstnr_ready = false;
+          sent_at = sent;
+          continue;
         }
-    }
-  return lstnr_ready;
-}
 
-static inline bool
-srv_is_time_to_send_metadata (httpr_server_t * ap_server,
-                              httpr_listener_t * ap_lstnr)
-{
-  if (ap_lstnr->p_con->sent_total == 0)
-    {
-      return false;
-    }
-
-  if (((ap_lstnr->p_con->sent_total + ap_server->burst_size)
-       % ap_server->mountpoint.metadata_period)
-      <= ap_server->burst_size)
-    {
-      return true;
-    }
-
-  return false;
-}
-
-static inline size_t
-srv_get_metadata_offset (const httpr_server_t * ap_server,
-                         const httpr_listener_t * ap_lstnr)
-{
-  size_t offset = 0;
-  if (ap_lstnr->p_con->sent_total != 0)
-    {
-      offset = (ap_server->mountpoint.metadata_period
-                * ((ap_lstnr->p_con->sent_total + ap_server->burst_size)
-                   / ap_server->mountpoint.metadata_period))
-               - ap_lstnr->p_con->sent_total;
-    }
+      p_chunk = srv_ring_chunk (ap_mount, seq);
+      assert (p_chunk);
+      assert (off < p_chunk->len);
+      len = MIN (p_chunk->len - off, budget);
+      if (ap_lstnr->want_metadata && period > 0)
+        {
+          len = MIN (len, period - (sent % period));
+        }
 
-  return offset;
-}
+      if (0 == ap_set->nchunks
+          || ap_set->p_chunks[ap_set->nchunks - 1] != p_chunk)
+        {
+          p_chunk->refcount++;
+          ap_set->p_chunks[ap_set->nchunks++] = p_chunk;
+        }
 
-static inline size_t
-srv_get_metadata_length (const httpr_server_t * ap_server,
-                         const httpr_listener_t * ap_lstnr)
-{
-  if (ap_lstnr->p_con->sent_total == 0 || ap_lstnr->p_con->metadata_delivered)
-    {
-      return 0;
+      budget -= len;
+      sent += len;
+      off += len;
+      wrk_add_iovec (ap_set, p_chunk->data + off - len, len, IOV_AUDIO,
+                     off == p_chunk->len);
+      if (off == p_chunk->len)
+        {
+          ++seq;
+          off = 0;
+        }
     }
-
-  return strnlen ((char *) ap_server->mountpoint.stream_title,
-                  OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
 }
 
 static void
-srv_arrange_metadata (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                      OMX_U8 ** app_buffer, size_t * ap_len)
+wrk_release_iovecs (httpr_mount_t * ap_mount, httpr_iovec_set_t * ap_set,
+                    const size_t a_audio_bytes)
 {
-  size_t len = 0;
-  httpr_listener_buffer_t * p_lstnr_buf = NULL;
-
-  assert (ap_server);
-  assert (ap_lstnr);
-  assert (app_buffer);
-  assert (ap_len);
-
-  len = *ap_len;
-  p_lstnr_buf = &ap_lstnr->buf;
-
-  if (0 == len || !ap_lstnr->want_metadata
-      || 0 == ap_server->mountpoint.metadata_period
-      || !srv_is_time_to_send_metadata (ap_server, ap_lstnr))
+  int i = 0;
+  assert (ap_mount);
+  assert (ap_set);
+  tiz_mutex_lock (&(ap_mount->mutex));
+  for (i = 0; i < ap_set->nchunks; ++i)
     {
-      /* p_lstnr_buf->metadata_bytes = 0; */
-      return;
+      srv_unref_chunk (ap_set->p_chunks[i]);
     }
-
-  {
-    OMX_U8 * p_buffer = *app_buffer;
-    size_t metadata_offset = srv_get_metadata_offset (ap_server, ap_lstnr);
-
-    if (metadata_offset < len && 0 == p_lstnr_buf->metadata_bytes)
-      {
-        OMX_U8 * p_dest = NULL;
-        OMX_U8 * p_src = NULL;
-        size_t metadata_len = srv_get_metadata_length (ap_server, ap_lstnr);
-        size_t metadata_total = 0;
-        size_t metadata_byte = 0;
-
-        if (metadata_len > 0)
-          {
-            metadata_byte = metadata_len / 16;
-            if (metadata_len % 16)
-              {
-                metadata_byte++;
-              }
-          }
-        else
-          {
-            metadata_byte = 0;
-          }
-
-        metadata_total = (metadata_byte * 16) + 1;
-        p_dest = p_buffer + metadata_offset + metadata_total;
-        p_src = p_buffer + metadata_offset;
-
-        /* Move content to make space for the metadata */
-        memmove (p_dest, p_src, len - metadata_offset);
-
-        p_lstnr_buf->metadata_bytes += metadata_total;
-        p_lstnr_buf->metadata_offset += metadata_offset;
-
-        if (metadata_len)
-          {
-            snprintf ((char *) p_src, metadata_total, "%c%s",
-                      (int) metadata_byte,
-                      (char *) ap_server->mountpoint.stream_title);
-            ap_lstnr->p_con->metadata_delivered = true;
-          }
-        else
-          {
-            p_src[0] = metadata_byte;
-          }
-
-        len += metadata_total;
-        p_lstnr_buf->len = len;
-
-        *ap_len = len;
-        *app_buffer = p_buffer;
-      }
-  }
+  ap_mount->bytes_sent += a_audio_bytes;
+  tiz_mutex_unlock (&(ap_mount->mutex));
+  ap_set->nchunks = 0;
 }
 
-static void
-srv_arrange_data (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                  OMX_U8 ** app_buffer, size_t * ap_len)
+static size_t
+wrk_consume_iovecs (httpr_listener_t * ap_lstnr,
+                    const httpr_iovec_set_t * ap_set, size_t a_bytes)
 {
-  OMX_U8 * p_buffer = NULL;
-  size_t len = 0;
   httpr_listener_buffer_t * p_lstnr_buf = NULL;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  size_t audio_bytes = 0;
+  int i = 0;
 
-  assert (ap_server);
   assert (ap_lstnr);
-  assert (app_buffer);
-  assert (ap_len);
+  assert (ap_set);
 
   p_lstnr_buf = &ap_lstnr->buf;
-  p_hdr = ap_server->p_hdr;
 
-  if (p_hdr && p_hdr->pBuffer && p_hdr->nFilledLen > 0)
+  for (i = 0; i < ap_set->count && a_bytes > 0; ++i)
     {
-      int to_copy = 0;
-      if (ap_server->burst_size > p_lstnr_buf->len)
-        {
-          to_copy = ap_server->burst_size - p_lstnr_buf->len;
-        }
-      if (to_copy > p_hdr->nFilledLen)
+      const size_t iov_len = ap_set->iov[i].iov_len;
+      const size_t len = MIN (a_bytes, iov_len);
+      a_bytes -= len;
+
+      switch (ap_set->kind[i])
         {
-          to_copy = p_hdr->nFilledLen;
-        }
-      memcpy (p_lstnr_buf->p_data + p_lstnr_buf->len,
-              p_hdr->pBuffer + p_hdr->nOffset, to_copy);
-      p_lstnr_buf->len += to_copy;
-      p_hdr->nFilledLen -= to_copy;
-      p_hdr->nOffset += to_copy;
+          case IOV_AUDIO:
+            {
+              ap_lstnr->chunk_off += len;
+              if (len == iov_len && ap_set->chunk_end[i])
+                {
+                  ap_lstnr->chunk_seq++;
+                  ap_lstnr->chunk_off = 0;
+                }
+              ap_lstnr->sent_total += len;
+              audio_bytes += len;
+            }
+            break;
+          case IOV_METADATA:
+            {
+              ap_lstnr->metadata_sent_at = ap_lstnr->sent_total;
+              if (ap_set->iov[i].iov_base == ap_lstnr->icy_block)
+                {
+                  ap_lstnr->title_pending = false;
+                }
+              if (len < iov_len)
+                {
+                  /* Keep the rest of the block, it goes first next time */
+                  assert (0 == p_lstnr_buf->len);
+                  memcpy (p_lstnr_buf->p_data,
+                          (OMX_U8 *) ap_set->iov[i].iov_base + len,
+                          iov_len - len);
+                  p_lstnr_buf->len = iov_len - len;
+                }
+            }
+            break;
+          case IOV_PENDING_METADATA:
+            {
+              p_lstnr_buf->len -= len;
+              if (p_lstnr_buf->len > 0)
+                {
+                  memmove (p_lstnr_buf->p_data, p_lstnr_buf->p_data + len,
+                           p_lstnr_buf->len);
+                }
+            }
+            break;
+          default:
+            {
+              assert (0);
+            }
+            break;
+        };
     }
 
-  p_buffer = (OMX_U8 *) p_lstnr_buf->p_data;
-  len = p_lstnr_buf->len;
-
-  srv_arrange_metadata (ap_server, ap_lstnr, &p_buffer, &len);
-
-  *ap_len = len;
-  *app_buffer = p_buffer;
+  return audio_bytes;
 }
 
 static OMX_ERRORTYPE
-srv_write_to_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
-                       const void * ap_buffer, const size_t a_buf_len,
-                       int * a_bytes_written)
+wrk_write_to_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
+                       httpr_iovec_set_t * ap_set, int * a_bytes_written)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   int bytes = 0;
-  httpr_connection_t * p_con = NULL;
-  int sock = ICE_SOCK_ERROR;
+  struct msghdr msg;
 
   assert (ap_server);
   assert (ap_lstnr);
-  assert (ap_buffer);
+  assert (ap_set);
   assert (a_bytes_written);
 
-  p_con = ap_lstnr->p_con;
-  sock = p_con->sockfd;
   *a_bytes_written = 0;
-  errno = 0;
 
-  bytes = send (sock, (const void *) ap_buffer, a_buf_len, MSG_NOSIGNAL);
+  tiz_mem_set (&msg, 0, sizeof (msg));
+  msg.msg_iov = ap_set->iov;
+  msg.msg_iovlen = ap_set->count;
+
+  errno = 0;
+  bytes = sendmsg (ap_lstnr->sockfd, &msg, MSG_NOSIGNAL);
 
   if (bytes < 0)
     {
-      if (!srv_is_recoverable_error (ap_server, sock, errno))
+      if (!srv_is_recoverable_error (ap_server, ap_lstnr->sockfd, errno))
         {
           TIZ_PRINTF_DBG_RED (
             "Non-recoverable error while writing to the socket (will destroy "
@@ -1285,10 +1603,8 @@ srv_write_to_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
       else
         {
           TIZ_PRINTF_DBG_RED (
-            "Recoverable error while writing to the socket"
-            "(re-starting io watcher)\n");
-          (void) srv_start_listener_io_watcher (ap_lstnr);
-          (void) srv_stop_listener_timer_watcher (ap_lstnr);
+            "Recoverable error while writing to the socket "
+            "(waiting for the socket)\n");
           rc = OMX_ErrorNotReady;
         }
     }
@@ -1299,346 +1615,593 @@ srv_write_to_listener (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr,
   return rc;
 }
 
+/* Returns OMX_ErrorUnderflow when the listener has caught up with the head of
+ * the ring, OMX_ErrorNotReady when its socket is full and OMX_ErrorNoMore when
+ * it has to go */
 static OMX_ERRORTYPE
-srv_write_omx_buffer (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
+wrk_write_from_ring (httpr_server_t * ap_server, httpr_listener_t * ap_lstnr)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  httpr_connection_t * p_con = NULL;
-  int sock = ICE_SOCK_ERROR;
+  httpr_mount_t * p_mount = NULL;
+  httpr_iovec_set_t set;
+  size_t audio_bytes = 0;
+  OMX_U32 burst_size = 0;
+  bool ask_for_data = false;
+  int bytes = 0;
 
   assert (ap_server);
   assert (ap_lstnr);
-  assert (ap_lstnr->p_con);
+  assert (ap_lstnr->p_mount);
 
-  p_con = ap_lstnr->p_con;
-  sock = p_con->sockfd;
+  p_mount = ap_lstnr->p_mount;
+  ap_lstnr->sent_last = 0;
 
-  p_con->sent_last = 0;
+  tiz_mutex_lock (&(p_mount->mutex));
 
-  if (!srv_is_valid_socket (sock))
+  if (ap_lstnr->chunk_seq < p_mount->tail)
     {
+      /* The ring has moved on without this listener. Rather than stalling the
+       * whole mountpoint on its slowest listeners, skip to the oldest audio
+       * still available. ICY framing is not affected, as it is based on the
+       * bytes actually sent. */
       TIZ_WARN (handleOf (ap_server->p_parent),
-                "Will destroy listener "
-                "(Invalid listener socket fd [%d])",
-                sock);
-      /* The socket is not valid anymore. The listener will be removed. */
-      rc = OMX_ErrorNoMore;
+                "Listener [%s] fd [%d] is lagging behind; skipping [%u] chunks",
+                ap_lstnr->p_ip, ap_lstnr->sockfd,
+                (unsigned int) (p_mount->tail - ap_lstnr->chunk_seq));
+      ap_lstnr->chunk_seq = p_mount->tail;
+      ap_lstnr->chunk_off = 0;
+      p_mount->listener_skips++;
     }
-  else
-    {
-      httpr_listener_buffer_t * p_lstnr_buf = &ap_lstnr->buf;
-      OMX_U8 * p_buffer = NULL;
-      size_t len = 0;
-      int bytes = 0;
-
-      /* Obtain a pointer to the data and the amount of data to be written */
-      srv_arrange_data (ap_server, ap_lstnr, &p_buffer, &len);
 
-      if (len > 0)
+  if (ap_lstnr->chunk_seq == p_mount->head && 0 == ap_lstnr->buf.len)
+    {
+      ask_for_data = !p_mount->need_data;
+      p_mount->need_data = true;
+      tiz_mutex_unlock (&(p_mount->mutex));
+      if (ask_for_data)
         {
-          int metadata_sent = 0;
-          tiz_check_omx (
-            srv_write_to_listener (ap_server, ap_lstnr, p_buffer, len, &bytes));
-          assert (bytes >= 0);
+          srv_signal_eventfd (ap_server->wake_fd);
+        }
+      return OMX_ErrorUnderflow;
+    }
 
-          p_lstnr_buf->len
-            = bytes > p_lstnr_buf->len ? 0 : (p_lstnr_buf->len - bytes);
+  /* Gather the listener's view of the mountpoint's ring, with any ICY
+   * metadata that is due interleaved in place */
+  wrk_arrange_data (p_mount, ap_lstnr, &set);
+  burst_size = p_mount->burst_size;
 
-          if (p_lstnr_buf->len > 0)
-            {
-              memmove (p_lstnr_buf->p_data, p_lstnr_buf->p_data + bytes,
-                       p_lstnr_buf->len);
-            }
+  tiz_mutex_unlock (&(p_mount->mutex));
 
-          if (bytes > p_lstnr_buf->metadata_offset)
-            {
-              metadata_sent = MIN ((bytes - p_lstnr_buf->metadata_offset),
-                                   p_lstnr_buf->metadata_bytes);
-            }
+  if (0 == set.len)
+    {
+      wrk_release_iovecs (p_mount, &set, 0);
+      return OMX_ErrorNone;
+    }
 
-          if (p_con->initial_burst_bytes > 0)
-            {
-              p_con->initial_burst_bytes -= (bytes - metadata_sent);
-            }
-          else
-            {
-              if (p_con->con_time == 0)
-                {
-                  p_con->con_time = time (NULL);
-                }
-            }
+  rc = wrk_write_to_listener (ap_server, ap_lstnr, &set, &bytes);
+  assert (bytes >= 0);
 
-          p_con->sent_total += (bytes - metadata_sent);
-          p_con->sent_last = (bytes - metadata_sent);
-          p_con->burst_bytes += (bytes - metadata_sent);
-
-          {
-            time_t t = time (NULL);
-            double d = difftime (t, p_con->con_time);
-            uint64_t rate = d ? p_con->sent_total / (uint64_t) d : 0;
-            TIZ_PRINTF_DBG_BLU (
-              "total [%lld] last [%d] burst [%d] time [%f] rate [%lld] "
-              "server burst [%d] bytes [%d]\n",
-              p_con->sent_total, p_con->sent_last, p_con->burst_bytes, d, rate,
-              ap_server->burst_size, bytes);
-          }
-
-          TIZ_PRINTF_DBG_GRN (
-            "metadata_bytes [%u] < metadata_offset [%u] metadata_sent [%u]\n",
-            p_lstnr_buf->metadata_bytes, p_lstnr_buf->metadata_offset,
-            metadata_sent);
-
-          p_lstnr_buf->metadata_bytes -= metadata_sent;
-          if (p_lstnr_buf->metadata_offset > 0 && p_lstnr_buf->metadata_bytes)
-            {
-              p_lstnr_buf->metadata_offset -= ((unsigned int) bytes);
-            }
-          else
-            {
-              p_lstnr_buf->metadata_offset = 0;
-            }
+  audio_bytes = wrk_consume_iovecs (ap_lstnr, &set, bytes);
+  wrk_release_iovecs (p_mount, &set, audio_bytes);
 
-          if (bytes < len)
-            {
-              TIZ_PRINTF_DBG_RED (
-                "NEED TO STOP bytes [%d] < len [%u] p_lstnr_buf->len [%u]\n",
-                bytes, len, p_lstnr_buf->len);
-              (void) srv_start_listener_io_watcher (ap_lstnr);
-              (void) srv_stop_listener_timer_watcher (ap_lstnr);
-              rc = OMX_ErrorNotReady;
-            }
-          else
-            {
-              if ((p_con->initial_burst_bytes <= 0)
-                  && (p_con->burst_bytes >= ap_server->burst_size))
-                {
-                  rc = srv_start_listener_timer_watcher (ap_lstnr,
-                                                         ap_server->wait_time);
-                }
-            }
+  if (OMX_ErrorNone != rc)
+    {
+      return rc;
+    }
+
+  if (ap_lstnr->initial_burst_bytes > 0)
+    {
+      ap_lstnr->initial_burst_bytes -= audio_bytes;
+    }
+  else
+    {
+      if (ap_lstnr->con_time == 0)
+        {
+          ap_lstnr->con_time = time (NULL);
         }
     }
 
+  ap_lstnr->sent_last = audio_bytes;
+  ap_lstnr->burst_bytes += audio_bytes;
+
+  {
+    time_t t = time (NULL);
+    double d = difftime (t, ap_lstnr->con_time);
+    uint64_t rate = d ? ap_lstnr->sent_total / (uint64_t) d : 0;
+    TIZ_PRINTF_DBG_BLU (
+      "total [%lld] last [%d] burst [%d] time [%f] rate [%lld] "
+      "server burst [%d] bytes [%d] iovecs [%d]\n",
+      ap_lstnr->sent_total, ap_lstnr->sent_last, ap_lstnr->burst_bytes, d,
+      rate, burst_size, bytes, set.count);
+  }
+
+  if ((size_t) bytes < set.len)
+    {
+      TIZ_PRINTF_DBG_RED ("NEED TO STOP bytes [%d] < len [%u]\n", bytes,
+                          (unsigned int) set.len);
+      rc = OMX_ErrorNotReady;
+    }
+
   return rc;
 }
 
 static OMX_ERRORTYPE
-srv_accept_connection (httpr_server_t * ap_server)
+wrk_write (httpr_worker_t * ap_wrk, httpr_listener_t * ap_lstnr,
+           const double a_now)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
-  char * p_ip = NULL;
-  httpr_listener_t * p_lstnr = NULL;
-  httpr_connection_t * p_con = NULL;
-  int connected_sockfd = ICE_SOCK_ERROR;
-  bool all_ok = false;
-  OMX_HANDLETYPE p_hdl = NULL;
+  httpr_mount_t * p_mount = NULL;
+  OMX_U32 burst_size = 0;
+  double wait_time = 0;
 
-  assert (ap_server);
-  p_hdl = handleOf (ap_server->p_parent);
+  assert (ap_wrk);
+  assert (ap_lstnr);
+  assert (ap_lstnr->p_mount);
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  p_mount = ap_lstnr->p_mount;
+
+  tiz_mutex_lock (&(p_mount->mutex));
+  burst_size = p_mount->burst_size;
+  wait_time = p_mount->wait_time;
+  if (ap_lstnr->title_version != p_mount->title_version)
     {
-      /* This is a simple solution to prevent more than one connection at
-       * a time. One day this could be a multi-client renderer */
-      tiz_map_for_each (ap_server->p_lstnrs, srv_remove_existing_listener,
-                        ap_server);
+      /* A new title; send a small burst so that it goes out soon */
+      ap_lstnr->title_version = p_mount->title_version;
+      ap_lstnr->title_pending = true;
+      ap_lstnr->initial_burst_bytes = p_mount->initial_burst_size * 0.1;
     }
+  tiz_mutex_unlock (&(p_mount->mutex));
 
-  if ((p_ip = (char *) tiz_mem_alloc (ICE_RENDERER_MAX_ADDR_LEN)))
+  if (ap_lstnr->initial_burst_bytes <= 0)
     {
-      unsigned short port = 0;
-      OMX_U32 index = 0;
+      ap_lstnr->burst_bytes = 0;
+    }
 
-      connected_sockfd
-        = srv_accept_socket (ap_server, p_ip, ICE_RENDERER_MAX_ADDR_LEN, &port);
-      goto_end_on_socket_error (connected_sockfd, p_hdl,
-                                "Unable to accept the connection");
+  while (1)
+    {
+      rc = wrk_write_from_ring (ap_wrk->p_server, ap_lstnr);
 
-      rc = srv_create_listener (ap_server, &p_lstnr, connected_sockfd, p_ip,
-                                port);
-      goto_end_on_omx_error (rc, p_hdl, "Unable to instantiate the listener");
+      if (OMX_ErrorNone != rc)
+        {
+          break;
+        }
+
+      if ((ap_lstnr->initial_burst_bytes <= 0)
+          && (ap_lstnr->burst_bytes >= burst_size))
+        {
+          break;
+        }
+    };
+
+  switch (rc)
+    {
+      case OMX_ErrorNone:
+        {
+          ap_lstnr->due = a_now + wait_time;
+        }
+        break;
+      case OMX_ErrorUnderflow:
+        {
+          /* Nothing new in the ring yet; look again on the next tick */
+          ap_lstnr->due = a_now + (ICE_WORKER_TICK_MS / 1000.0);
+          rc = OMX_ErrorNone;
+        }
+        break;
+      case OMX_ErrorNotReady:
+        {
+          /* Socket not ready, send buffer is full. Wait until it drains */
+          ap_lstnr->state = LSTNR_BLOCKED;
+          rc = wrk_set_listener_events (ap_lstnr, EPOLLOUT);
+        }
+        break;
+      default:
+        break;
+    };
 
-      assert (p_lstnr->p_con);
-      p_con = p_lstnr->p_con;
+  return rc;
+}
 
-      rc = tiz_map_insert (ap_server->p_lstnrs, &(p_con->sockfd), p_lstnr,
-                           &index);
-      goto_end_on_omx_error (rc, p_hdl,
-                             "Unable to add the listener to the map");
+static void
+wrk_handle_listener_event (httpr_worker_t * ap_wrk,
+                           httpr_listener_t * ap_lstnr,
+                           const uint32_t a_events, const double a_now)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
 
-      rc = srv_start_listener_io_watcher (p_lstnr);
-      goto_end_on_omx_error (rc, p_hdl,
-                             "Unable to start the listener's io watcher");
+  assert (ap_wrk);
+  assert (ap_lstnr);
 
-      all_ok = true;
+  /* A hang-up is final in any state; the socket is level-triggered, so it
+     would otherwise keep waking this worker up */
+  if (a_events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+    {
+      wrk_destroy_listener (ap_lstnr);
+      return;
     }
 
-end:
+  if (LSTNR_AWAITING_REQUEST == ap_lstnr->state && (a_events & EPOLLIN))
+    {
+      rc = wrk_handle_listeners_request (ap_wrk, ap_lstnr);
+      if (OMX_ErrorNotReady == rc)
+        {
+          TIZ_ERROR (handleOf (ap_wrk->p_server->p_parent),
+                     "no data yet lets wait some time ");
+          return;
+        }
+      else if (OMX_ErrorNone != rc)
+        {
+          TIZ_ERROR (handleOf (ap_wrk->p_server->p_parent),
+                     "[%s] : while handling the "
+                     "listener's initial request. Will remove the listener",
+                     tiz_err_to_str (rc));
+          wrk_destroy_listener (ap_lstnr);
+          return;
+        }
 
-  if (!all_ok)
+      ap_lstnr->state = LSTNR_STREAMING;
+      ap_lstnr->due = a_now;
+      if (OMX_ErrorNone != wrk_set_listener_events (ap_lstnr, 0))
+        {
+          wrk_destroy_listener (ap_lstnr);
+        }
+      return;
+    }
+
+  if (LSTNR_BLOCKED == ap_lstnr->state && (a_events & EPOLLOUT))
     {
-      if (ICE_SOCK_ERROR != connected_sockfd)
+      ap_lstnr->state = LSTNR_STREAMING;
+      ap_lstnr->due = a_now;
+      if (OMX_ErrorNone != wrk_set_listener_events (ap_lstnr, 0))
         {
-          close (connected_sockfd);
-          connected_sockfd = ICE_SOCK_ERROR;
+          wrk_destroy_listener (ap_lstnr);
         }
+    }
+}
 
-      if (p_lstnr)
+/* Writes to every listener whose burst is due, and returns the number of
+ * milliseconds until the next one is */
+static int
+wrk_service_listeners (httpr_worker_t * ap_wrk)
+{
+  httpr_listener_t * p_lstnr = NULL;
+  httpr_listener_t * p_next = NULL;
+  const double now = srv_now ();
+  double next_due = -1;
+
+  assert (ap_wrk);
+
+  for (p_lstnr = ap_wrk->p_lstnrs; p_lstnr; p_lstnr = p_next)
+    {
+      p_next = p_lstnr->p_next;
+
+      if (LSTNR_STREAMING != p_lstnr->state)
         {
-          srv_remove_listener (ap_server, p_lstnr);
-          p_lstnr = NULL;
+          continue;
         }
 
-      if (p_ip)
+      if (p_lstnr->due <= now
+          && OMX_ErrorNone != wrk_write (ap_wrk, p_lstnr, now))
         {
-          tiz_mem_free (p_ip);
-          p_ip = NULL;
+          wrk_destroy_listener (p_lstnr);
+          continue;
         }
 
-      if (OMX_ErrorInsufficientResources != rc)
+      if (LSTNR_STREAMING == p_lstnr->state
+          && (next_due < 0 || p_lstnr->due < next_due))
         {
-          /* Use OMX_ErrorNotReady to signal an error other than OOM */
-          rc = OMX_ErrorNotReady;
+          next_due = p_lstnr->due;
         }
     }
-  else
+
+  if (next_due < 0)
     {
-      TIZ_NOTICE (p_hdl, "Client [%s:%u] fd [%d] now connected", p_con->p_ip,
-                  p_con->port, p_con->sockfd);
+      /* Nothing to pace; sleep until a socket or the eventfd wakes us up */
+      return -1;
+    }
 
-      TIZ_PRINTF_DBG_RED ("Client connected [%s:%u]\n", p_con->p_ip,
-                          p_con->port);
-      TIZ_PRINTF_DBG_GRN (
-        "\tburst [%d] sample rate [%u] bitrate [%u] "
-        "burst_size [%u] bytes per frame [%u] wait_time [%f] "
-        "pkts/s [%f].\n",
-        (unsigned int) p_con->initial_burst_bytes,
-        (unsigned int) ap_server->sample_rate,
-        (unsigned int) ap_server->bitrate, (unsigned int) ap_server->burst_size,
-        (unsigned int) ap_server->bytes_per_frame, ap_server->wait_time,
-        ap_server->pkts_per_sec);
+  return (int) MIN (MAX ((next_due - now) * 1000.0, 0), ICE_WORKER_TICK_MS);
+}
+
+static bool
+wrk_adopt_pending_connections (httpr_worker_t * ap_wrk)
+{
+  httpr_pending_con_t * p_con = NULL;
+  bool stop = false;
+
+  assert (ap_wrk);
+
+  tiz_mutex_lock (&(ap_wrk->mutex));
+  p_con = ap_wrk->p_pending;
+  ap_wrk->p_pending = NULL;
+  stop = ap_wrk->stop;
+  tiz_mutex_unlock (&(ap_wrk->mutex));
+
+  while (p_con)
+    {
+      httpr_pending_con_t * p_next = p_con->p_next;
+      (void) wrk_create_listener (ap_wrk, p_con);
+      tiz_mem_free (p_con);
+      p_con = p_next;
     }
 
-  /* Always restart the server's watcher, even if an error occurred */
-  srv_start_server_io_watcher (ap_server);
+  return !stop;
+}
 
-  return rc;
+static void *
+wrk_thread_func (void * ap_arg)
+{
+  httpr_worker_t * p_wrk = ap_arg;
+  struct epoll_event events[ICE_WORKER_MAX_EVENTS];
+  bool running = true;
+  int timeout = -1;
+
+  assert (p_wrk);
+
+  (void) tiz_thread_setname (&(p_wrk->thread), (const OMX_STRING) "httprwrk");
+
+  while (running)
+    {
+      const int nevents
+        = epoll_wait (p_wrk->epfd, events, ICE_WORKER_MAX_EVENTS, timeout);
+      const double now = srv_now ();
+      int i = 0;
+
+      for (i = 0; i < nevents; ++i)
+        {
+          if (events[i].data.ptr == p_wrk)
+            {
+              srv_drain_eventfd (p_wrk->evfd);
+              running = wrk_adopt_pending_connections (p_wrk);
+            }
+          else
+            {
+              wrk_handle_listener_event (p_wrk, events[i].data.ptr,
+                                         events[i].events, now);
+            }
+        }
+
+      timeout = wrk_service_listeners (p_wrk);
+    }
+
+  while (p_wrk->p_lstnrs)
+    {
+      wrk_destroy_listener (p_wrk->p_lstnrs);
+    }
+
+  return NULL;
+}
+
+static void
+wrk_deinit (httpr_worker_t * ap_wrk)
+{
+  assert (ap_wrk);
+  assert (!ap_wrk->started);
+  if (ap_wrk->epfd >= 0)
+    {
+      close (ap_wrk->epfd);
+      ap_wrk->epfd = ICE_SOCK_ERROR;
+    }
+  if (ap_wrk->evfd >= 0)
+    {
+      close (ap_wrk->evfd);
+      ap_wrk->evfd = ICE_SOCK_ERROR;
+    }
+  tiz_mutex_destroy (&(ap_wrk->mutex));
 }
 
 static OMX_ERRORTYPE
-srv_write (httpr_server_t * ap_server)
+wrk_init (httpr_worker_t * ap_wrk, httpr_server_t * ap_server,
+          const OMX_U32 a_index)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  httpr_listener_t * p_lstnr = NULL;
-  httpr_connection_t * p_con = NULL;
+  struct epoll_event ev;
 
+  assert (ap_wrk);
   assert (ap_server);
 
-  if (srv_get_listeners_count (ap_server) <= 0)
+  ap_wrk->p_server = ap_server;
+  ap_wrk->index = a_index;
+  ap_wrk->started = false;
+  ap_wrk->p_pending = NULL;
+  ap_wrk->load = 0;
+  ap_wrk->stop = false;
+  ap_wrk->p_lstnrs = NULL;
+  ap_wrk->epfd = ICE_SOCK_ERROR;
+  ap_wrk->evfd = ICE_SOCK_ERROR;
+
+  tiz_check_omx (tiz_mutex_init (&(ap_wrk->mutex)));
+
+  ap_wrk->epfd = epoll_create1 (EPOLL_CLOEXEC);
+  ap_wrk->evfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (ap_wrk->epfd < 0 || ap_wrk->evfd < 0)
     {
-      return OMX_ErrorNoMore;
+      return OMX_ErrorInsufficientResources;
     }
 
-  /* Until support for multiple listeners gets implemented, there will only be
-     one listener in the map */
-  p_lstnr = srv_get_first_listener (ap_server);
-  assert (p_lstnr);
-  p_con = p_lstnr->p_con;
-  assert (p_con);
-
-  srv_stop_listener_io_watcher (p_lstnr);
-  if (!srv_is_listener_ready (ap_server, p_lstnr))
+  tiz_mem_set (&ev, 0, sizeof (ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = ap_wrk;
+  if (0 != epoll_ctl (ap_wrk->epfd, EPOLL_CTL_ADD, ap_wrk->evfd, &ev))
     {
-      return OMX_ErrorNotReady;
+      return OMX_ErrorInsufficientResources;
     }
 
-  srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+  return OMX_ErrorNone;
+}
 
-  if (p_con->initial_burst_bytes <= 0)
+static OMX_ERRORTYPE
+wrk_start (httpr_worker_t * ap_wrk)
+{
+  assert (ap_wrk);
+  assert (!ap_wrk->started);
+  ap_wrk->stop = false;
+  tiz_check_omx (
+    tiz_thread_create (&(ap_wrk->thread), ICE_WORKER_STACK_SIZE, 0,
+                       wrk_thread_func, ap_wrk));
+  ap_wrk->started = true;
+  return OMX_ErrorNone;
+}
+
+static void
+wrk_stop (httpr_worker_t * ap_wrk)
+{
+  httpr_pending_con_t * p_con = NULL;
+
+  assert (ap_wrk);
+
+  if (ap_wrk->started)
     {
-      p_con->burst_bytes = 0;
+      OMX_PTR p_result = NULL;
+      tiz_mutex_lock (&(ap_wrk->mutex));
+      ap_wrk->stop = true;
+      tiz_mutex_unlock (&(ap_wrk->mutex));
+      srv_signal_eventfd (ap_wrk->evfd);
+      (void) tiz_thread_join (&(ap_wrk->thread), &p_result);
+      ap_wrk->started = false;
     }
 
-  while (1)
+  /* Drop whatever was handed over after the worker's last look */
+  tiz_mutex_lock (&(ap_wrk->mutex));
+  p_con = ap_wrk->p_pending;
+  ap_wrk->p_pending = NULL;
+  ap_wrk->load = 0;
+  tiz_mutex_unlock (&(ap_wrk->mutex));
+  while (p_con)
     {
-      if (NULL == p_hdr)
-        {
-          if (NULL == (p_hdr = ap_server->pf_acquire_buf (ap_server->p_arg)))
-            {
-              /* no more buffers available at the moment */
-              ap_server->need_more_data = true;
-              srv_stop_listener_timer_watcher (p_lstnr);
-              rc = OMX_ErrorNone;
-              break;
-            }
-          ap_server->need_more_data = false;
-          ap_server->p_hdr = p_hdr;
-        }
+      httpr_pending_con_t * p_next = p_con->p_next;
+      close (p_con->sockfd);
+      tiz_mem_free (p_con->p_ip);
+      tiz_mem_free (p_con);
+      p_con = p_next;
+    }
+}
 
-      rc = srv_write_omx_buffer (ap_server, p_lstnr);
+/*
+ * Server (these run on the component's thread)
+ */
 
-      if (OMX_ErrorNoMore == rc)
-        {
-          (void) srv_remove_listener (ap_server, p_lstnr);
-          break;
-        }
+static httpr_worker_t *
+srv_get_least_loaded_worker (httpr_server_t * ap_server)
+{
+  httpr_worker_t * p_wrk = NULL;
+  OMX_U32 min_load = 0;
+  OMX_U32 i = 0;
 
-      if (OMX_ErrorNotReady == rc
-          || ((p_con->initial_burst_bytes <= 0)
-              && (p_con->burst_bytes >= ap_server->burst_size)))
-        {
-          rc = OMX_ErrorNotReady;
-          break;
-        }
+  assert (ap_server);
+  assert (ap_server->nworkers > 0);
 
-      /*       if (p_lstnr->pos == ap_server->p_hdr->nFilledLen) */
-      if (0 == ap_server->p_hdr->nFilledLen)
+  for (i = 0; i < ap_server->nworkers; ++i)
+    {
+      httpr_worker_t * p_candidate = &(ap_server->workers[i]);
+      OMX_U32 load = 0;
+      tiz_mutex_lock (&(p_candidate->mutex));
+      load = p_candidate->load;
+      tiz_mutex_unlock (&(p_candidate->mutex));
+      if (!p_wrk || load < min_load)
         {
-          /* Buffer emptied */
-          (void) srv_release_empty_buffer (ap_server, p_lstnr, &p_hdr);
+          p_wrk = p_candidate;
+          min_load = load;
         }
-    };
-
-  return rc;
+    }
+  return p_wrk;
 }
 
 static OMX_ERRORTYPE
-srv_stream_to_client (httpr_server_t * ap_server)
+srv_accept_connection (httpr_server_t * ap_server)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
+  char * p_ip = NULL;
+  httpr_pending_con_t * p_con = NULL;
+  httpr_worker_t * p_wrk = NULL;
+  int connected_sockfd = ICE_SOCK_ERROR;
+  unsigned short port = 0;
+  bool all_ok = false;
+  OMX_HANDLETYPE p_hdl = NULL;
+
   assert (ap_server);
+  p_hdl = handleOf (ap_server->p_parent);
 
-  rc = srv_write (ap_server);
-  switch (rc)
+  p_ip = (char *) tiz_mem_alloc (ICE_RENDERER_MAX_ADDR_LEN);
+  p_con = (httpr_pending_con_t *) tiz_mem_calloc (1, sizeof (*p_con));
+  rc = (p_ip && p_con) ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
+  goto_end_on_omx_error (rc, p_hdl, "Unable to alloc the connection");
+
+  connected_sockfd
+    = srv_accept_socket (ap_server, p_ip, ICE_RENDERER_MAX_ADDR_LEN, &port);
+  goto_end_on_socket_error (connected_sockfd, p_hdl,
+                            "Unable to accept the connection");
+
+  p_con->sockfd = connected_sockfd;
+  p_con->p_ip = p_ip;
+  p_con->port = port;
+
+  /* Hand the connection over to the worker with fewest listeners */
+  p_wrk = srv_get_least_loaded_worker (ap_server);
+  tiz_mutex_lock (&(p_wrk->mutex));
+  p_con->p_next = p_wrk->p_pending;
+  p_wrk->p_pending = p_con;
+  p_wrk->load++;
+  tiz_mutex_unlock (&(p_wrk->mutex));
+  srv_signal_eventfd (p_wrk->evfd);
+
+  TIZ_PRINTF_DBG_RED ("Client connected [%s:%u] -> worker [%u]\n", p_ip, port,
+                      (unsigned int) p_wrk->index);
+
+  all_ok = true;
+
+end:
+
+  if (!all_ok)
     {
-      case OMX_ErrorNone:
-      case OMX_ErrorNoMore:
-      /* Socket not ready, send buffer is full, or the burst limit has been
-         reached */
-      case OMX_ErrorNotReady:
+      if (ICE_SOCK_ERROR != connected_sockfd)
         {
-          /* No connected clients just yet */
-          rc = OMX_ErrorNone;
+          close (connected_sockfd);
+          connected_sockfd = ICE_SOCK_ERROR;
         }
-        break;
 
-      default:
+      tiz_mem_free (p_ip);
+      p_ip = NULL;
+      tiz_mem_free (p_con);
+      p_con = NULL;
+
+      if (OMX_ErrorInsufficientResources != rc)
         {
-          TIZ_ERROR (handleOf (ap_server->p_parent), "[%s]",
-                     tiz_err_to_str (rc));
-          assert (0);
+          /* Use OMX_ErrorNotReady to signal an error other than OOM */
+          rc = OMX_ErrorNotReady;
         }
-        break;
-    };
+    }
+
+  /* Always restart the server's watcher, even if an error occurred */
+  srv_start_server_io_watcher (ap_server);
+
   return rc;
 }
 
-static int
-srv_get_descriptor (const httpr_server_t * ap_server)
+static void
+srv_stop_workers (httpr_server_t * ap_server)
+{
+  OMX_U32 i = 0;
+  assert (ap_server);
+  for (i = 0; i < ap_server->nworkers; ++i)
+    {
+      wrk_stop (&(ap_server->workers[i]));
+    }
+}
+
+static OMX_ERRORTYPE
+srv_start_workers (httpr_server_t * ap_server)
 {
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  OMX_U32 i = 0;
   assert (ap_server);
-  return ap_server->lstn_sockfd;
+  for (i = 0; i < ap_server->nworkers && OMX_ErrorNone == rc; ++i)
+    {
+      rc = wrk_start (&(ap_server->workers[i]));
+    }
+  if (OMX_ErrorNone != rc)
+    {
+      srv_stop_workers (ap_server);
+    }
+  return rc;
 }
 
 /*               */
@@ -1650,18 +2213,32 @@ httpr_srv_destroy (httpr_server_t * ap_server)
 {
   if (ap_server)
     {
+      OMX_U32 i = 0;
+
+      srv_stop_workers (ap_server);
+      for (i = 0; i < ap_server->nworkers; ++i)
+        {
+          wrk_deinit (&(ap_server->workers[i]));
+        }
+
       srv_destroy_server_io_watcher (ap_server);
       if (ICE_SOCK_ERROR != ap_server->lstn_sockfd)
         {
           close (ap_server->lstn_sockfd);
         }
+      if (ICE_SOCK_ERROR != ap_server->wake_fd)
+        {
+          close (ap_server->wake_fd);
+        }
 
-      tiz_mem_free (ap_server->p_ip);
-      if (ap_server->p_lstnrs)
+      for (i = 0; i < ap_server->nmounts; ++i)
         {
-          tiz_map_clear (ap_server->p_lstnrs);
-          tiz_map_destroy (ap_server->p_lstnrs);
+          srv_ring_reset (&(ap_server->mounts[i]));
+          tiz_mutex_destroy (&(ap_server->mounts[i].mutex));
         }
+
+      tiz_mutex_destroy (&(ap_server->mutex));
+      tiz_mem_free (ap_server->p_ip);
       tiz_mem_free (ap_server);
     }
 }
@@ -1669,6 +2246,7 @@ httpr_srv_destroy (httpr_server_t * ap_server)
 OMX_ERRORTYPE
 httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
                 OMX_STRING a_address, OMX_U32 a_port, OMX_U32 a_max_clients,
+                OMX_U32 a_nmounts, OMX_U32 a_nworkers,
                 httpr_srv_release_buffer_f a_pf_release_buf,
                 httpr_srv_acquire_buffer_f a_pf_acquire_buf, OMX_PTR ap_arg)
 {
@@ -1680,6 +2258,8 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   assert (ap_parent);
   assert (a_pf_release_buf);
   assert (a_pf_acquire_buf);
+  assert (a_nmounts > 0 && a_nmounts <= ICE_MAX_MOUNTPOINTS);
+  assert (a_nworkers > 0 && a_nworkers <= ICE_MAX_WORKER_THREADS);
 
   p_server = (httpr_server_t *) tiz_mem_calloc (1, sizeof (httpr_server_t));
   rc = p_server ? OMX_ErrorNone : OMX_ErrorInsufficientResources;
@@ -1690,28 +2270,31 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   p_server->lstn_sockfd = ICE_SOCK_ERROR;
   p_server->p_ip = NULL;
   p_server->p_srv_ev_io = NULL;
+  p_server->wake_fd = ICE_SOCK_ERROR;
+  p_server->p_wake_ev_io = NULL;
   p_server->max_clients = a_max_clients;
-  p_server->p_lstnrs = NULL;
-  p_server->p_hdr = NULL;
+  p_server->nlisteners = 0;
   p_server->pf_release_buf = a_pf_release_buf;
   p_server->pf_acquire_buf = a_pf_acquire_buf;
-  p_server->need_more_data = true;
   p_server->running = false;
   p_server->p_arg = ap_arg;
-  p_server->bitrate = 0;
-  p_server->num_channels = 0;
-  p_server->sample_rate = 0;
-  p_server->bytes_per_frame = 144 * 128000 / 44100;
-  p_server->burst_size = ICE_MEDIUM_BURST_SIZE;
-  p_server->pkts_per_sec
-    = (((double) p_server->bytes_per_frame * (double) (1000 / 26)
-        / (double) p_server->burst_size));
-  p_server->wait_time = (1 / p_server->pkts_per_sec);
-
-  tiz_mem_set (&(p_server->mountpoint), 0, sizeof (httpr_mount_t));
-  p_server->mountpoint.metadata_period = ICE_DEFAULT_METADATA_INTERVAL;
-  p_server->mountpoint.initial_burst_size = ICE_INITIAL_BURST_SIZE;
-  p_server->mountpoint.max_clients = 1;
+  p_server->nmounts = 0;
+  p_server->nworkers = 0;
+
+  rc = tiz_mutex_init (&(p_server->mutex));
+  goto_end_on_omx_error (rc, handleOf (ap_parent),
+                         "Unable to init the server mutex");
+
+  /* Mountpoint i is fed by input port i */
+  for (; p_server->nmounts < a_nmounts; ++p_server->nmounts)
+    {
+      httpr_mount_t * p_mount = &(p_server->mounts[p_server->nmounts]);
+      rc = tiz_mutex_init (&(p_mount->mutex));
+      goto_end_on_omx_error (rc, handleOf (ap_parent),
+                             "Unable to init the mountpoint mutex");
+      srv_set_mount_defaults (p_mount, p_server->nmounts);
+      srv_build_icy_block (p_mount);
+    }
 
   if (a_address)
     {
@@ -1721,10 +2304,22 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   goto_end_on_omx_error (rc, handleOf (ap_parent),
                          "Unable to duo the server ip address");
 
-  rc = tiz_map_init (&(p_server->p_lstnrs), listeners_map_compare_func,
-                     listeners_map_free_func, NULL);
-  goto_end_on_omx_error (rc, handleOf (ap_parent),
-                         "Unable to init the listeners map");
+  p_server->wake_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+  goto_end_on_socket_error (p_server->wake_fd, handleOf (ap_parent),
+                            "Unable to create the wake-up eventfd");
+
+  for (; p_server->nworkers < a_nworkers; ++p_server->nworkers)
+    {
+      rc = wrk_init (&(p_server->workers[p_server->nworkers]), p_server,
+                     p_server->nworkers);
+      if (OMX_ErrorNone != rc)
+        {
+          /* Include this one in the clean-up */
+          p_server->nworkers++;
+        }
+      goto_end_on_omx_error (rc, handleOf (ap_parent),
+                             "Unable to init a worker");
+    }
 
   p_server->lstn_sockfd
     = srv_create_server_socket (p_server, a_port, a_address);
@@ -1735,6 +2330,10 @@ httpr_srv_init (httpr_server_t ** app_server, void * ap_parent,
   goto_end_on_omx_error (rc, handleOf (ap_parent),
                          "Unable to alloc the server's io event");
 
+  TIZ_NOTICE (handleOf (ap_parent), "[%u] mountpoints [%u] worker threads",
+              (unsigned int) p_server->nmounts,
+              (unsigned int) p_server->nworkers);
+
   /* All good so far */
   all_ok = true;
 
@@ -1768,6 +2367,12 @@ httpr_srv_start (httpr_server_t * ap_server)
   rc = srv_set_non_blocking (ap_server->lstn_sockfd);
   goto_end_on_omx_error (rc, p_hdl, "Unable to set socket as non-blocking");
 
+  rc = srv_start_workers (ap_server);
+  goto_end_on_omx_error (rc, p_hdl, "Unable to start the worker threads");
+
+  rc = srv_start_wake_io_watcher (ap_server);
+  goto_end_on_omx_error (rc, p_hdl, "Unable to start the wake-up io watcher");
+
   rc = srv_start_server_io_watcher (ap_server);
   goto_end_on_omx_error (rc, p_hdl, "Unable to start the server io watcher");
 
@@ -1786,83 +2391,84 @@ end:
 OMX_ERRORTYPE
 httpr_srv_stop (httpr_server_t * ap_server)
 {
-  httpr_listener_t * p_lstnr = NULL;
+  OMX_U32 i = 0;
   assert (ap_server);
   (void) srv_stop_server_io_watcher (ap_server);
-  if (ap_server->p_lstnrs)
+  (void) srv_stop_wake_io_watcher (ap_server);
+  /* The workers close their listeners' sockets on their way out */
+  srv_stop_workers (ap_server);
+  for (i = 0; i < ap_server->nmounts; ++i)
     {
-      /* Until support for multiple listeners gets implemented, there will only
-         be one listener in the map */
-      p_lstnr = srv_get_first_listener (ap_server);
-      if (p_lstnr)
-        {
-          (void) srv_stop_listener_io_watcher (p_lstnr);
-          (void) srv_stop_listener_timer_watcher (p_lstnr);
-          (void) srv_remove_listener (ap_server, p_lstnr);
-        }
+      srv_ring_reset (&(ap_server->mounts[i]));
     }
   ap_server->running = false;
-  ap_server->need_more_data = false;
   return OMX_ErrorNone;
 }
 
 void
-httpr_srv_release_buffers (httpr_server_t * ap_server)
+httpr_srv_release_buffers (httpr_server_t * ap_server, const OMX_U32 a_pid)
 {
+  httpr_mount_t * p_mount = NULL;
   assert (ap_server);
-  if (ap_server->p_hdr)
+  /* OMX buffers are returned as soon as their contents are in the ring; all
+     that is left to do is to discard the audio that is still queued there */
+  if ((p_mount = srv_get_mount (ap_server, a_pid)))
     {
-      ap_server->p_hdr->nFilledLen = 0;
-      ap_server->pf_release_buf (ap_server->p_hdr, ap_server->p_arg);
-      ap_server->p_hdr = NULL;
+      srv_ring_reset (p_mount);
     }
 }
 
 void
-httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_bitrate,
+httpr_srv_set_mp3_settings (httpr_server_t * ap_server, const OMX_U32 a_pid,
+                            const OMX_U32 a_bitrate,
                             const OMX_U32 a_num_channels,
                             const OMX_U32 a_sample_rate)
 {
+  httpr_mount_t * p_mount = NULL;
+
   assert (ap_server);
 
-  ap_server->bitrate = (a_bitrate != 0 ? a_bitrate : 448000);
-  ap_server->num_channels = (a_num_channels != 0 ? a_num_channels : 2);
-  ap_server->sample_rate = (a_sample_rate != 0 ? a_sample_rate : 44100);
-  assert (0 != a_sample_rate);
-  ap_server->bytes_per_frame = (144 * ap_server->bitrate / a_sample_rate) + 1;
-  ap_server->burst_size = ICE_MIN_BURST_SIZE;
+  if (!(p_mount = srv_get_mount (ap_server, a_pid)))
+    {
+      return;
+    }
 
-  ap_server->pkts_per_sec
-    = (((double) ap_server->bytes_per_frame * (double) (1000 / 26)
-        / (double) ap_server->burst_size));
+  tiz_mutex_lock (&(p_mount->mutex));
 
-  ap_server->wait_time = (1 / ap_server->pkts_per_sec);
+  p_mount->bitrate = (a_bitrate != 0 ? a_bitrate : 448000);
+  p_mount->num_channels = (a_num_channels != 0 ? a_num_channels : 2);
+  p_mount->sample_rate = (a_sample_rate != 0 ? a_sample_rate : 44100);
+  assert (0 != a_sample_rate);
+  p_mount->bytes_per_frame = (144 * p_mount->bitrate / a_sample_rate) + 1;
+  p_mount->burst_size = ICE_MIN_BURST_SIZE;
 
-  if (srv_get_listeners_count (ap_server) > 0)
-    {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
-    }
+  p_mount->pkts_per_sec
+    = (((double) p_mount->bytes_per_frame * (double) (1000 / 26)
+        / (double) p_mount->burst_size));
+
+  /* The workers pick the new pacing up on each listener's next burst */
+  p_mount->wait_time = (1 / p_mount->pkts_per_sec);
 
   TIZ_PRINTF_DBG_MAG (
-    "burst [%d] sample rate [%u] bitrate [%u] "
+    "mount [%u] burst [%d] sample rate [%u] bitrate [%u] "
     "burst_size [%u] bytes per frame [%u] wait_time [%f] "
     "pkts/s [%f].\n",
-    (unsigned int) ap_server->mountpoint.initial_burst_size,
-    (unsigned int) ap_server->sample_rate, (unsigned int) ap_server->bitrate,
-    (unsigned int) ap_server->burst_size,
-    (unsigned int) ap_server->bytes_per_frame, ap_server->wait_time,
-    ap_server->pkts_per_sec);
+    (unsigned int) a_pid, (unsigned int) p_mount->initial_burst_size,
+    (unsigned int) p_mount->sample_rate, (unsigned int) p_mount->bitrate,
+    (unsigned int) p_mount->burst_size,
+    (unsigned int) p_mount->bytes_per_frame, p_mount->wait_time,
+    p_mount->pkts_per_sec);
+
+  tiz_mutex_unlock (&(p_mount->mutex));
 }
 
 void
 httpr_srv_set_mountpoint_settings (
-  httpr_server_t * ap_server, OMX_U8 * ap_mount_name, OMX_U8 * ap_station_name,
-  OMX_U8 * ap_station_description, OMX_U8 * ap_station_genre,
-  OMX_U8 * ap_station_url, const OMX_U32 a_metadata_period,
-  const OMX_U32 a_burst_size, const OMX_U32 a_max_clients)
+  httpr_server_t * ap_server, const OMX_U32 a_pid, OMX_U8 * ap_mount_name,
+  OMX_U8 * ap_station_name, OMX_U8 * ap_station_description,
+  OMX_U8 * ap_station_genre, OMX_U8 * ap_station_url,
+  const OMX_U32 a_metadata_period, const OMX_U32 a_burst_size,
+  const OMX_U32 a_max_clients)
 {
   httpr_mount_t * p_mount = NULL;
 
@@ -1873,7 +2479,12 @@ httpr_srv_set_mountpoint_settings (
   assert (ap_station_genre);
   assert (ap_station_url);
 
-  p_mount = &(ap_server->mountpoint);
+  if (!(p_mount = srv_get_mount (ap_server, a_pid)))
+    {
+      return;
+    }
+
+  tiz_mutex_lock (&(p_mount->mutex));
 
   strncpy ((char *) p_mount->mount_name, (char *) ap_mount_name,
            OMX_MAX_STRINGNAME_SIZE);
@@ -1899,13 +2510,16 @@ httpr_srv_set_mountpoint_settings (
   p_mount->initial_burst_size = a_burst_size;
   p_mount->max_clients = a_max_clients;
 
+  tiz_mutex_unlock (&(p_mount->mutex));
+
   TIZ_NOTICE (handleOf (ap_server->p_parent),
-              "StationName [%s] IcyMetadataPeriod [%d]", p_mount->station_name,
+              "Mountpoint [%s] StationName [%s] IcyMetadataPeriod [%d]",
+              p_mount->mount_name, p_mount->station_name,
               p_mount->metadata_period);
 }
 
 void
-httpr_srv_set_stream_title (httpr_server_t * ap_server,
+httpr_srv_set_stream_title (httpr_server_t * ap_server, const OMX_U32 a_pid,
                             OMX_U8 * ap_stream_title)
 {
   httpr_mount_t * p_mount = NULL;
@@ -1913,34 +2527,59 @@ httpr_srv_set_stream_title (httpr_server_t * ap_server,
   assert (ap_server);
   assert (ap_stream_title);
 
-  p_mount = &(ap_server->mountpoint);
+  if (!(p_mount = srv_get_mount (ap_server, a_pid)))
+    {
+      return;
+    }
 
-  TIZ_PRINTF_DBG_YEL ("stream_title [%s]\n", ap_stream_title);
+  TIZ_PRINTF_DBG_YEL ("mount [%u] stream_title [%s]\n", (unsigned int) a_pid,
+                      ap_stream_title);
 
+  tiz_mutex_lock (&(p_mount->mutex));
   strncpy ((char *) p_mount->stream_title, (char *) ap_stream_title,
            OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE);
   p_mount->stream_title[OMX_TIZONIA_MAX_SHOUTCAST_METADATA_SIZE - 1] = '\000';
+  srv_build_icy_block (p_mount);
+  /* Listeners notice this on their next burst */
+  p_mount->title_version++;
+  tiz_mutex_unlock (&(p_mount->mutex));
+}
+
+void
+httpr_srv_get_mountpoint_stats (httpr_server_t * ap_server,
+                                const OMX_U32 a_pid,
+                                OMX_TIZONIA_HTTPMOUNTPOINTSTATSTYPE * ap_stats)
+{
+  httpr_mount_t * p_mount = NULL;
+
+  assert (ap_server);
+  assert (ap_stats);
 
-  if (srv_get_listeners_count (ap_server) > 0)
+  if (!(p_mount = srv_get_mount (ap_server, a_pid)))
     {
-      httpr_listener_t * p_lstnr = srv_get_first_listener (ap_server);
-      assert (p_lstnr);
-      assert (p_lstnr->p_con);
-      p_lstnr->p_con->metadata_delivered = false;
-      p_lstnr->p_con->initial_burst_bytes
-        = ap_server->mountpoint.initial_burst_size * 0.1;
-      srv_stop_listener_timer_watcher (p_lstnr);
-      srv_start_listener_timer_watcher (p_lstnr, ap_server->wait_time);
+      return;
     }
+
+  tiz_mutex_lock (&(p_mount->mutex));
+  ap_stats->nListeners = p_mount->nlisteners;
+  ap_stats->nPeakListeners = p_mount->peak_listeners;
+  ap_stats->nTotalConnections = p_mount->total_connections;
+  ap_stats->nRejectedConnections = p_mount->rejected_connections;
+  ap_stats->nListenerSkips = p_mount->listener_skips;
+  ap_stats->nRingBytes = p_mount->bytes;
+  ap_stats->nBytesSent = p_mount->bytes_sent;
+  tiz_mutex_unlock (&(p_mount->mutex));
 }
 
 OMX_ERRORTYPE
 httpr_srv_buffer_event (httpr_server_t * ap_server)
 {
   assert (ap_server);
-  return ((ap_server->running && ap_server->need_more_data)
-            ? srv_stream_to_client (ap_server)
-            : OMX_ErrorNone);
+  if (ap_server->running)
+    {
+      srv_fill_rings (ap_server);
+    }
+  return OMX_ErrorNone;
 }
 
 OMX_ERRORTYPE
@@ -1950,7 +2589,7 @@ httpr_srv_io_event (httpr_server_t * ap_server, const int a_fd)
   assert (ap_server);
   if (ap_server->running)
     {
-      if (a_fd == srv_get_descriptor (ap_server))
+      if (a_fd == ap_server->lstn_sockfd)
         {
           /* A new connection event. Try to accept it */
           rc = srv_accept_connection (ap_server);
@@ -1959,18 +2598,13 @@ httpr_srv_io_event (httpr_server_t * ap_server, const int a_fd)
               rc = OMX_ErrorNone;
             }
         }
-      else
+      else if (a_fd == ap_server->wake_fd)
         {
-          /* The client socket is ready */
-          rc = srv_stream_to_client (ap_server);
+          /* A worker has run out of data */
+          srv_drain_eventfd (ap_server->wake_fd);
+          srv_fill_rings (ap_server);
+          (void) srv_start_wake_io_watcher (ap_server);
         }
     }
   return rc;
 }
-
-OMX_ERRORTYPE
-httpr_srv_timer_event (httpr_server_t * ap_server)
-{
-  assert (ap_server);
-  return ap_server->running ? srv_stream_to_client (ap_server) : OMX_ErrorNone;
-}
@@ -56,6 +56,9 @@ extern "C" {
 #define ARATELIA_HTTP_SOURCE_DEFAULT_RECONNECT_TIMEOUT 3.0F
 #define ARATELIA_HTTP_SOURCE_DEFAULT_BIT_RATE_KBITS 128
 #define ARATELIA_HTTP_SOURCE_DEFAULT_CACHE_SECONDS 10
+#define ARATELIA_HTTP_SOURCE_DEFAULT_RANGE_CONNECTIONS 3
+#define ARATELIA_HTTP_SOURCE_DEFAULT_PREFETCH_KB 8192
+#define ARATELIA_HTTP_SOURCE_DEFAULT_DISK_CACHE_MB 256
 
 #ifdef __cplusplus
 }
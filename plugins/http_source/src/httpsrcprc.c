@@ -23,6 +23,13 @@
  *
  * @brief  HTTP streaming client - processor class
  *
+ * Resources that turn out to be plain files (a Content-Length, byte range
+ * support and no icy metadata) are not streamed through the url transfer
+ * once the format has been detected. They are downloaded instead in chunks,
+ * with several range requests in parallel, into a tiz_urlcache that the
+ * buffers are filled from. The cache is kept on disk, so that playing the
+ * same url again (e.g. after a reconnection, a replay or in a later run) does
+ * not download it again.
  *
  */
 
@@ -58,6 +65,10 @@ static OMX_ERRORTYPE
 release_buffer (httpsrc_prc_t *);
 static OMX_ERRORTYPE
 prepare_for_port_auto_detection (httpsrc_prc_t * ap_prc);
+static OMX_BUFFERHEADERTYPE *
+buffer_emptied (OMX_PTR ap_arg);
+static void
+buffer_filled (OMX_BUFFERHEADERTYPE * ap_hdr, void * ap_arg);
 
 typedef struct ogg_codec_id ogg_codec_id_t;
 struct ogg_codec_id
@@ -507,6 +518,230 @@ obtain_audio_encoding_from_headers (httpsrc_prc_t * ap_prc,
   }
 }
 
+static int
+get_int_config_value (const char * ap_key, const int a_default)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? atoi (p_value) : a_default;
+}
+
+static bool
+get_bool_config_value (const char * ap_key, const bool a_default)
+{
+  const char * p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? 0 != strncasecmp (p_value, "false", 5) : a_default;
+}
+
+static void
+reset_range_info (httpsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->content_length_ = -1;
+  ap_prc->accept_ranges_ = false;
+  ap_prc->icy_ = false;
+  tiz_mem_free (ap_prc->p_validator_);
+  ap_prc->p_validator_ = NULL;
+}
+
+/* Finds out from the response headers whether the resource can be downloaded
+   in chunks, and how it can be told apart from a newer version of it */
+static void
+obtain_range_info_from_headers (httpsrc_prc_t * ap_prc,
+                                const char * ap_header, const size_t a_size)
+{
+  const char * p_end = ap_header + a_size;
+  const char * p_value = NULL;
+  size_t name_len = 0;
+
+  assert (ap_prc);
+  assert (ap_header);
+
+  if (a_size > 5 && 0 == strncmp (ap_header, "HTTP/", 5))
+    {
+      /* The status line of a new response (e.g. after a redirection) */
+      reset_range_info (ap_prc);
+      return;
+    }
+
+  if (!(p_value = memchr (ap_header, ':', a_size)))
+    {
+      return;
+    }
+
+  name_len = p_value - ap_header;
+  for (++p_value; p_value < p_end && !is_valid_character (*p_value);
+       ++p_value)
+    {
+    }
+  while (p_end > p_value && !is_valid_character (p_end[-1]))
+    {
+      --p_end;
+    }
+
+  if (name_len > 4 && 0 == strncasecmp (ap_header, "icy-", 4))
+    {
+      ap_prc->icy_ = true;
+    }
+  else if (14 == name_len && 0 == strncasecmp (ap_header, "content-length", 14))
+    {
+      ap_prc->content_length_ = strtoll (p_value, NULL, 10);
+    }
+  else if (13 == name_len && 0 == strncasecmp (ap_header, "accept-ranges", 13))
+    {
+      ap_prc->accept_ranges_ = (p_end - p_value >= 5
+                                && 0 == strncasecmp (p_value, "bytes", 5));
+    }
+  else if ((4 == name_len && 0 == strncasecmp (ap_header, "etag", 4))
+           || (13 == name_len
+               && 0 == strncasecmp (ap_header, "last-modified", 13)
+               && !ap_prc->p_validator_))
+    {
+      /* The ETag is preferred */
+      char * p_validator = tiz_mem_calloc (1, (p_end - p_value) + 1);
+      if (p_validator)
+        {
+          memcpy (p_validator, p_value, p_end - p_value);
+          tiz_mem_free (ap_prc->p_validator_);
+          ap_prc->p_validator_ = p_validator;
+        }
+    }
+}
+
+static int
+range_connections (void)
+{
+  return MIN (TIZ_URL_CACHE_MAX_CONNECTIONS,
+              get_int_config_value (
+                ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".range_connections",
+                ARATELIA_HTTP_SOURCE_DEFAULT_RANGE_CONNECTIONS));
+}
+
+static bool
+is_range_download_possible (httpsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  return ap_prc->content_length_ > 0 && ap_prc->accept_ranges_
+         && !ap_prc->icy_ && range_connections () > 0;
+}
+
+static OMX_ERRORTYPE
+start_disk_cache (httpsrc_prc_t * ap_prc)
+{
+  int connections = 0;
+  int prefetch_kb = 0;
+  size_t disk_bytes = 0;
+
+  assert (ap_prc);
+  assert (!ap_prc->p_cache_);
+
+  ap_prc->cache_pending_ = false;
+
+  connections = range_connections ();
+  prefetch_kb = MAX (
+    1, get_int_config_value (ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".prefetch_kb",
+                             ARATELIA_HTTP_SOURCE_DEFAULT_PREFETCH_KB));
+  if (get_bool_config_value (ARATELIA_HTTP_SOURCE_COMPONENT_NAME ".disk_cache",
+                             true))
+    {
+      disk_bytes = (size_t) MAX (
+        0, get_int_config_value (ARATELIA_HTTP_SOURCE_COMPONENT_NAME
+                                 ".disk_cache_mb",
+                                 ARATELIA_HTTP_SOURCE_DEFAULT_DISK_CACHE_MB))
+                   * 1024 * 1024;
+    }
+
+  if (OMX_ErrorNone
+      != tiz_urlcache_init (&(ap_prc->p_cache_),
+                            (const char *) ap_prc->p_uri_param_->contentURI,
+                            ap_prc->p_validator_, ap_prc->content_length_,
+                            connections, (size_t) prefetch_kb * 1024,
+                            disk_bytes))
+    {
+      /* Carry on streaming */
+      TIZ_NOTICE (handleOf (ap_prc), "Unable to create the url cache");
+      return OMX_ErrorNone;
+    }
+
+  if (OMX_ErrorNone
+      != tiz_srv_io_watcher_init (ap_prc, &(ap_prc->p_cache_ev_io_),
+                                  tiz_urlcache_fd (ap_prc->p_cache_),
+                                  TIZ_EVENT_READ, false))
+    {
+      tiz_urlcache_destroy (ap_prc->p_cache_);
+      ap_prc->p_cache_ = NULL;
+      return OMX_ErrorNone;
+    }
+
+  TIZ_NOTICE (handleOf (ap_prc),
+              "Downloading [%lld] bytes with [%d] range requests "
+              "([%lld] bytes cached)",
+              (long long) ap_prc->content_length_, connections,
+              (long long) tiz_urlcache_cached (ap_prc->p_cache_));
+
+  /* The paused transfer has not handed out any data yet; the cache starts
+     from the beginning of the resource */
+  tiz_urltrans_cancel (ap_prc->p_trans_);
+  tiz_urltrans_flush_buffer (ap_prc->p_trans_);
+  return tiz_srv_io_watcher_start (ap_prc, ap_prc->p_cache_ev_io_);
+}
+
+static void
+stop_disk_cache (httpsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_cache_ev_io_)
+    {
+      tiz_srv_io_watcher_destroy (ap_prc, ap_prc->p_cache_ev_io_);
+      ap_prc->p_cache_ev_io_ = NULL;
+    }
+  tiz_urlcache_destroy (ap_prc->p_cache_);
+  ap_prc->p_cache_ = NULL;
+  ap_prc->cache_pending_ = false;
+}
+
+static OMX_ERRORTYPE
+fill_buffers_from_disk_cache (httpsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+
+  assert (ap_prc);
+  assert (ap_prc->p_cache_);
+
+  while (!ap_prc->eos_ && (p_hdr = buffer_emptied (ap_prc)))
+    {
+      size_t nread = 0;
+      OMX_ERRORTYPE rc = tiz_urlcache_read (ap_prc->p_cache_, p_hdr->pBuffer,
+                                            p_hdr->nAllocLen, &nread);
+      if (OMX_ErrorNoMore == rc)
+        {
+          /* The io watcher fires when the next chunk is in */
+          break;
+        }
+      else if (OMX_ErrorNone != rc)
+        {
+          TIZ_ERROR (handleOf (ap_prc), "[%s] : while downloading [%s]",
+                     tiz_err_to_str (rc), ap_prc->p_uri_param_->contentURI);
+          stop_disk_cache (ap_prc);
+          tiz_srv_issue_err_event ((OMX_PTR) ap_prc, rc);
+          break;
+        }
+
+      p_hdr->nOffset = 0;
+      p_hdr->nFilledLen = nread;
+      if (0 == nread)
+        {
+          TIZ_NOTICE (handleOf (ap_prc), "End of resource; EOS in HEADER [%p]",
+                      p_hdr);
+          p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+          ap_prc->eos_ = true;
+        }
+      buffer_filled (p_hdr, ap_prc);
+    }
+  return OMX_ErrorNone;
+}
+
 static void
 send_port_auto_detect_events (httpsrc_prc_t * ap_prc)
 {
@@ -656,6 +891,7 @@ header_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
     {
       obtain_audio_encoding_from_headers (p_prc, ap_ptr, a_nbytes);
     }
+  obtain_range_info_from_headers (p_prc, ap_ptr, a_nbytes);
 }
 
 static bool
@@ -684,6 +920,9 @@ data_available (OMX_PTR ap_arg, const void * ap_ptr, const size_t a_nbytes)
               set_audio_info_on_port (p_prc);
             }
         }
+      /* Once the transfer is to be resumed, a plain file is downloaded into
+         the disk cache instead */
+      p_prc->cache_pending_ = is_range_download_possible (p_prc);
       /* And now trigger the OMX_EventPortFormatDetected and
          OMX_EventPortSettingsChanged events or a
          OMX_ErrorFormatNotDetected event */
@@ -743,6 +982,11 @@ httpsrc_prc_ctor (void * ap_obj, va_list * app)
   p_prc->samplerate_ = 44100;
   p_prc->auto_detect_on_ = false;
   p_prc->bitrate_ = ARATELIA_HTTP_SOURCE_DEFAULT_BIT_RATE_KBITS;
+  p_prc->p_cache_ = NULL;
+  p_prc->p_cache_ev_io_ = NULL;
+  p_prc->cache_pending_ = false;
+  p_prc->p_validator_ = NULL;
+  reset_range_info (p_prc);
   update_cache_size (p_prc);
   return p_prc;
 }
@@ -794,6 +1038,8 @@ httpsrc_prc_deallocate_resources (void * ap_prc)
 {
   httpsrc_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  stop_disk_cache (p_prc);
+  reset_range_info (p_prc);
   tiz_urltrans_destroy (p_prc->p_trans_);
   p_prc->p_trans_ = NULL;
   delete_uri (p_prc);
@@ -808,7 +1054,18 @@ httpsrc_prc_prepare_to_transfer (void * ap_prc, OMX_U32 a_pid)
   p_prc->eos_ = false;
   tiz_urltrans_cancel (p_prc->p_trans_);
   tiz_urltrans_set_internal_buffer_size (p_prc->p_trans_, p_prc->cache_bytes_);
-  return prepare_for_port_auto_detection (p_prc);
+  tiz_check_omx (prepare_for_port_auto_detection (p_prc));
+  if (p_prc->auto_detect_on_)
+    {
+      /* The stream is going to be probed again */
+      stop_disk_cache (p_prc);
+    }
+  else if (p_prc->p_cache_)
+    {
+      /* Play again from the beginning, out of the disk cache */
+      tiz_check_omx (tiz_urlcache_seek (p_prc->p_cache_, 0));
+    }
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
@@ -821,6 +1078,11 @@ httpsrc_prc_transfer_and_process (void * ap_prc, OMX_U32 a_pid)
     {
       rc = tiz_urltrans_start (p_prc->p_trans_);
     }
+  else if (p_prc->p_cache_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_start (p_prc, p_prc->p_cache_ev_io_));
+      rc = fill_buffers_from_disk_cache (p_prc);
+    }
   return rc;
 }
 
@@ -829,6 +1091,10 @@ httpsrc_prc_stop_and_return (void * ap_prc)
 {
   httpsrc_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  if (p_prc->p_cache_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_stop (p_prc, p_prc->p_cache_ev_io_));
+    }
   if (p_prc->p_trans_)
     {
       tiz_urltrans_pause (p_prc->p_trans_);
@@ -846,6 +1112,14 @@ httpsrc_prc_buffers_ready (const void * ap_prc)
 {
   httpsrc_prc_t * p_prc = (httpsrc_prc_t *) ap_prc;
   assert (p_prc);
+  if (p_prc->cache_pending_)
+    {
+      tiz_check_omx (start_disk_cache (p_prc));
+    }
+  if (p_prc->p_cache_)
+    {
+      return fill_buffers_from_disk_cache (p_prc);
+    }
   return tiz_urltrans_on_buffers_ready (p_prc->p_trans_);
 }
 
@@ -855,6 +1129,11 @@ httpsrc_prc_io_ready (void * ap_prc, tiz_event_io_t * ap_ev_io, int a_fd,
 {
   httpsrc_prc_t * p_prc = ap_prc;
   assert (p_prc);
+  if (p_prc->p_cache_ && ap_ev_io == p_prc->p_cache_ev_io_)
+    {
+      tiz_urlcache_clear_fd (p_prc->p_cache_);
+      return fill_buffers_from_disk_cache (p_prc);
+    }
   return tiz_urltrans_on_io_ready (p_prc->p_trans_, ap_ev_io, a_fd, a_events);
 }
 
@@ -896,6 +1175,10 @@ httpsrc_prc_port_disable (const void * ap_obj, OMX_U32 TIZ_UNUSED (a_pid))
   httpsrc_prc_t * p_prc = (httpsrc_prc_t *) ap_obj;
   assert (p_prc);
   p_prc->port_disabled_ = true;
+  if (p_prc->p_cache_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_stop (p_prc, p_prc->p_cache_ev_io_));
+    }
   if (p_prc->p_trans_)
     {
       tiz_urltrans_pause (p_prc->p_trans_);
@@ -916,7 +1199,20 @@ httpsrc_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
   if (p_prc->port_disabled_)
     {
       p_prc->port_disabled_ = false;
-      rc = tiz_urltrans_unpause (p_prc->p_trans_);
+      if (p_prc->cache_pending_)
+        {
+          tiz_check_omx (start_disk_cache (p_prc));
+        }
+      if (p_prc->p_cache_)
+        {
+          tiz_check_omx (
+            tiz_srv_io_watcher_start (p_prc, p_prc->p_cache_ev_io_));
+          rc = fill_buffers_from_disk_cache (p_prc);
+        }
+      else
+        {
+          rc = tiz_urltrans_unpause (p_prc->p_trans_);
+        }
     }
   return rc;
 }
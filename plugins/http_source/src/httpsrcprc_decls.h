@@ -56,6 +56,13 @@ struct httpsrc_prc
   bool auto_detect_on_;
   int bitrate_;
   int cache_bytes_;
+  tiz_urlcache_t * p_cache_;
+  tiz_event_io_t * p_cache_ev_io_;
+  bool cache_pending_;
+  OMX_S64 content_length_;
+  bool accept_ranges_;
+  bool icy_;
+  char * p_validator_;
 };
 
 typedef struct httpsrc_prc_class httpsrc_prc_class_t;
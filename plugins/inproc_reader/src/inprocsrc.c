@@ -141,7 +141,7 @@ instantiate_config_port (OMX_HANDLETYPE ap_hdl)
 static OMX_PTR
 instantiate_processor (OMX_HANDLETYPE ap_hdl)
 {
-  return factory_new (tiz_get_type (ap_hdl, "inprocsrc_prc"));
+  return factory_new (tiz_get_type (ap_hdl, "inprocsrcprc"));
 }
 
 OMX_ERRORTYPE
@@ -185,15 +185,15 @@ OMX_ComponentInit (OMX_HANDLETYPE ap_hdl)
   other_role.nports     = 1;
   other_role.pf_proc    = instantiate_processor;
 
-  strcpy ((OMX_STRING) inprocsrc_prc_type.class_name, "inprocsrc_prc_class");
+  strcpy ((OMX_STRING) inprocsrc_prc_type.class_name, "inprocsrcprc_class");
   inprocsrc_prc_type.pf_class_init = inprocsrc_prc_class_init;
-  strcpy ((OMX_STRING) inprocsrc_prc_type.object_name, "inprocsrc_prc");
+  strcpy ((OMX_STRING) inprocsrc_prc_type.object_name, "inprocsrcprc");
   inprocsrc_prc_type.pf_object_init = inprocsrc_prc_init;
 
   /* Initialize the component infrastructure */
   tiz_check_omx (tiz_comp_init (ap_hdl, ARATELIA_INPROC_READER_COMPONENT_NAME));
 
-  /* Register the "inprocsrc_prc" class */
+  /* Register the "inprocsrcprc" class */
   tiz_check_omx (tiz_comp_register_types (ap_hdl, tf_list, 1));
 
   /* Register the various roles */
@@ -47,6 +47,10 @@ extern "C"
 #define ARATELIA_INPROC_READER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_READER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_READER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_READER_RING_NAME          "broadcast"
+#define ARATELIA_INPROC_READER_RING_SLOTS         16
+#define ARATELIA_INPROC_READER_RING_SLOT_SIZE     (64 * 1024)
+#define ARATELIA_INPROC_READER_ZMQ_ENDPOINT       "ipc:///tmp/tizonia-inproc"
 
 #ifdef __cplusplus
 }
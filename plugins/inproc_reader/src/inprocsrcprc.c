@@ -21,7 +21,11 @@
  * @file   inprocsrcprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket reader
+ * @brief  Tizonia - Inproc reader processor
+ *
+ * Reads the buffers published by the inproc writer, from a shared memory ring
+ * (see tizshmring.h) or from a ZeroMQ SUB socket when the ring is not
+ * available or the transport is configured as 'zmq'.
  *
  *
  */
@@ -31,6 +35,10 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 
 #include <tizplatform.h>
 
@@ -50,11 +58,212 @@
  * inprocsrcprc
  */
 
+static const char *
+get_config_value (const char * ap_key)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE * 2];
+  assert (ap_key);
+  snprintf (key, sizeof (key), "%s.%s", ARATELIA_INPROC_READER_COMPONENT_NAME,
+            ap_key);
+  return tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+}
+
+static bool
+shm_transport_enabled (void)
+{
+  const char * p_transport = get_config_value ("transport");
+  return !(p_transport && 0 == strcasecmp (p_transport, "zmq"));
+}
+
+static OMX_ERRORTYPE
+open_zmq_sock (inprocsrc_prc_t * ap_prc)
+{
+  const char * p_endpoint = get_config_value ("zmq_endpoint");
+  assert (ap_prc);
+
+  ap_prc->p_zmq_ctx_ = zmq_ctx_new ();
+  if (!ap_prc->p_zmq_ctx_
+      || !(ap_prc->p_zmq_sock_ = zmq_socket (ap_prc->p_zmq_ctx_, ZMQ_SUB))
+      || 0 != zmq_setsockopt (ap_prc->p_zmq_sock_, ZMQ_SUBSCRIBE, "", 0)
+      || 0 != zmq_connect (ap_prc->p_zmq_sock_,
+                           p_endpoint ? p_endpoint
+                                      : ARATELIA_INPROC_READER_ZMQ_ENDPOINT))
+    {
+      TIZ_ERROR (handleOf (ap_prc), "%s", zmq_strerror (errno));
+      return OMX_ErrorInsufficientResources;
+    }
+  return OMX_ErrorNone;
+}
+
+static void
+drop_chunk (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->chunk_valid_)
+    {
+      if (ap_prc->p_ring_)
+        {
+          tiz_shm_ring_release (ap_prc->p_ring_);
+        }
+      else
+        {
+          (void) zmq_msg_close (&(ap_prc->zmq_msg_));
+        }
+      ap_prc->chunk_valid_ = false;
+    }
+}
+
+/* Make the next ring slot, or zmq message, the current chunk. Ring slots are
+   read in place, without copying them out of the shared memory segment. */
+static bool
+next_chunk (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+
+  if (ap_prc->chunk_valid_)
+    {
+      return true;
+    }
+
+  ap_prc->chunk_offset_ = 0;
+  if (ap_prc->p_ring_)
+    {
+      const void * p_data = NULL;
+      if (OMX_ErrorNone
+          == tiz_shm_ring_peek (ap_prc->p_ring_, &p_data,
+                                &(ap_prc->chunk_len_),
+                                &(ap_prc->chunk_flags_),
+                                &(ap_prc->chunk_timestamp_)))
+        {
+          ap_prc->p_chunk_ = p_data;
+          ap_prc->chunk_valid_ = true;
+        }
+    }
+  else if (ap_prc->p_zmq_sock_)
+    {
+      (void) zmq_msg_init (&(ap_prc->zmq_msg_));
+      if (zmq_msg_recv (&(ap_prc->zmq_msg_), ap_prc->p_zmq_sock_,
+                        ZMQ_DONTWAIT)
+          >= 0)
+        {
+          ap_prc->p_chunk_ = zmq_msg_data (&(ap_prc->zmq_msg_));
+          ap_prc->chunk_len_ = zmq_msg_size (&(ap_prc->zmq_msg_));
+          /* The writer signals the EOS with an empty message */
+          ap_prc->chunk_flags_
+            = 0 == ap_prc->chunk_len_ ? OMX_BUFFERFLAG_EOS : 0;
+          ap_prc->chunk_timestamp_ = 0;
+          ap_prc->chunk_valid_ = true;
+        }
+      else
+        {
+          (void) zmq_msg_close (&(ap_prc->zmq_msg_));
+        }
+    }
+  return ap_prc->chunk_valid_;
+}
+
+static OMX_BUFFERHEADERTYPE *
+get_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (!ap_prc->p_outhdr_)
+    {
+      (void) tiz_krn_claim_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                   ARATELIA_INPROC_READER_PORT_INDEX, 0,
+                                   &ap_prc->p_outhdr_);
+      if (ap_prc->p_outhdr_)
+        {
+          ap_prc->p_outhdr_->nOffset = 0;
+          ap_prc->p_outhdr_->nFilledLen = 0;
+          ap_prc->p_outhdr_->nFlags = 0;
+        }
+    }
+  return ap_prc->p_outhdr_;
+}
+
+static OMX_ERRORTYPE
+release_header (inprocsrc_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->p_outhdr_)
+    {
+      OMX_BUFFERHEADERTYPE * p_hdr = ap_prc->p_outhdr_;
+      ap_prc->p_outhdr_ = NULL;
+      if (p_hdr->nFlags & OMX_BUFFERFLAG_EOS)
+        {
+          TIZ_DEBUG (handleOf (ap_prc), "OMX_BUFFERFLAG_EOS in HEADER [%p]",
+                     p_hdr);
+          tiz_srv_issue_event ((OMX_PTR) ap_prc, OMX_EventBufferFlag,
+                               ARATELIA_INPROC_READER_PORT_INDEX,
+                               p_hdr->nFlags, NULL);
+        }
+      tiz_check_omx (
+        tiz_krn_release_buffer (tiz_get_krn (handleOf (ap_prc)),
+                                ARATELIA_INPROC_READER_PORT_INDEX, p_hdr));
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+fill_buffers (inprocsrc_prc_t * ap_prc)
+{
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
+  assert (ap_prc);
+
+  while (!ap_prc->stopped_ && next_chunk (ap_prc)
+         && (p_hdr = get_header (ap_prc)))
+    {
+      const size_t room = p_hdr->nAllocLen - p_hdr->nOffset - p_hdr->nFilledLen;
+      const size_t len
+        = MIN (ap_prc->chunk_len_ - ap_prc->chunk_offset_, room);
+
+      if (0 == p_hdr->nFilledLen)
+        {
+          p_hdr->nTimeStamp = ap_prc->chunk_timestamp_;
+        }
+      /* The one copy, into the downstream component's buffer */
+      memcpy (p_hdr->pBuffer + p_hdr->nOffset + p_hdr->nFilledLen,
+              ap_prc->p_chunk_ + ap_prc->chunk_offset_, len);
+      p_hdr->nFilledLen += len;
+      ap_prc->chunk_offset_ += len;
+
+      if (ap_prc->chunk_offset_ == ap_prc->chunk_len_)
+        {
+          if (ap_prc->chunk_flags_ & OMX_BUFFERFLAG_EOS)
+            {
+              p_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
+              ap_prc->eos_ = true;
+            }
+          drop_chunk (ap_prc);
+          /* Keep the writer's buffer boundaries */
+          tiz_check_omx (release_header (ap_prc));
+        }
+      else if (len == room)
+        {
+          tiz_check_omx (release_header (ap_prc));
+        }
+    }
+  return OMX_ErrorNone;
+}
+
 static void *
 inprocsrc_prc_ctor (void *ap_obj, va_list * app)
 {
   inprocsrc_prc_t *p_obj = super_ctor (typeOf (ap_obj, "inprocsrcprc"), ap_obj, app);
+  p_obj->p_outhdr_ = NULL;
+  p_obj->stopped_ = true;
   p_obj->eos_ = false;
+  p_obj->p_ring_ = NULL;
+  p_obj->p_zmq_ctx_ = NULL;
+  p_obj->p_zmq_sock_ = NULL;
+  p_obj->zmq_fd_ = -1;
+  p_obj->p_ev_io_ = NULL;
+  p_obj->p_chunk_ = NULL;
+  p_obj->chunk_len_ = 0;
+  p_obj->chunk_offset_ = 0;
+  p_obj->chunk_flags_ = 0;
+  p_obj->chunk_timestamp_ = 0;
+  p_obj->chunk_valid_ = false;
   return p_obj;
 }
 
@@ -64,12 +273,6 @@ inprocsrc_prc_dtor (void *ap_obj)
   return super_dtor (typeOf (ap_obj, "inprocsrcprc"), ap_obj);
 }
 
-static OMX_ERRORTYPE
-inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
-{
-  return OMX_ErrorNone;
-}
-
 /*
  * from tizsrv class
  */
@@ -77,31 +280,123 @@ inprocsrc_prc_read_buffer (const void *ap_obj, OMX_BUFFERHEADERTYPE * p_hdr)
 static OMX_ERRORTYPE
 inprocsrc_prc_allocate_resources (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+
+  if (shm_transport_enabled ()
+      && OMX_ErrorNone
+           != tiz_shm_ring_open (&(p_prc->p_ring_),
+                                 ARATELIA_INPROC_READER_RING_NAME,
+                                 ARATELIA_INPROC_READER_RING_SLOTS,
+                                 ARATELIA_INPROC_READER_RING_SLOT_SIZE))
+    {
+      TIZ_WARN (handleOf (p_prc),
+                "Shared memory ring not available; using ZeroMQ");
+      p_prc->p_ring_ = NULL;
+    }
+  if (!p_prc->p_ring_)
+    {
+      tiz_check_omx (open_zmq_sock (p_prc));
+    }
+  TIZ_DEBUG (handleOf (p_prc), "transport [%s]",
+             p_prc->p_ring_ ? "shm" : "zmq");
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_deallocate_resources (void *ap_obj)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  drop_chunk (p_prc);
+  if (p_prc->p_ev_io_)
+    {
+      tiz_srv_io_watcher_destroy (p_prc, p_prc->p_ev_io_);
+      p_prc->p_ev_io_ = NULL;
+    }
+  if (p_prc->p_ring_)
+    {
+      tiz_shm_ring_close (p_prc->p_ring_);
+      p_prc->p_ring_ = NULL;
+    }
+  if (p_prc->p_zmq_sock_)
+    {
+      zmq_close (p_prc->p_zmq_sock_);
+      p_prc->p_zmq_sock_ = NULL;
+    }
+  if (p_prc->p_zmq_ctx_)
+    {
+      zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
+      p_prc->p_zmq_ctx_ = NULL;
+    }
+  p_prc->zmq_fd_ = -1;
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_prepare_to_transfer (void *ap_obj, OMX_U32 a_pid)
 {
+  inprocsrc_prc_t *p_prc = ap_obj;
+  size_t fd_len = sizeof (p_prc->zmq_fd_);
+  int fd = -1;
+  assert (p_prc);
+
+  p_prc->eos_ = false;
+  if (p_prc->p_ring_)
+    {
+      /* Subscribe now, so that no slots are held while in Idle */
+      if (OMX_ErrorNone != tiz_shm_ring_subscribe (p_prc->p_ring_))
+        {
+          TIZ_ERROR (handleOf (p_prc), "Too many readers on the ring");
+          return OMX_ErrorInsufficientResources;
+        }
+      fd = tiz_shm_ring_fd (p_prc->p_ring_);
+    }
+  else
+    {
+      if (0 != zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_,
+                               &fd_len))
+        {
+          TIZ_ERROR (handleOf (p_prc), "%s", zmq_strerror (errno));
+          return OMX_ErrorInsufficientResources;
+        }
+      fd = p_prc->zmq_fd_;
+    }
+
+  if (!p_prc->p_ev_io_)
+    {
+      tiz_check_omx (tiz_srv_io_watcher_init (p_prc, &(p_prc->p_ev_io_), fd,
+                                              TIZ_EVENT_READ, false));
+    }
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_transfer_and_process (void *ap_obj, OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  assert (p_prc->p_ev_io_);
+  p_prc->stopped_ = false;
+  return tiz_srv_io_watcher_start (p_prc, p_prc->p_ev_io_);
 }
 
 static OMX_ERRORTYPE
 inprocsrc_prc_stop_and_return (void *ap_obj)
 {
-  return OMX_ErrorNone;
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  if (p_prc->p_ev_io_)
+    {
+      (void) tiz_srv_io_watcher_stop (p_prc, p_prc->p_ev_io_);
+    }
+  drop_chunk (p_prc);
+  if (p_prc->p_ring_)
+    {
+      tiz_shm_ring_unsubscribe (p_prc->p_ring_);
+    }
+  return release_header (p_prc);
 }
 
 /*
@@ -111,7 +406,20 @@ inprocsrc_prc_stop_and_return (void *ap_obj)
 static OMX_ERRORTYPE
 inprocsrc_prc_buffers_ready (const void *ap_obj)
 {
-  return OMX_ErrorNone;
+  return fill_buffers ((inprocsrc_prc_t *) ap_obj);
+}
+
+static OMX_ERRORTYPE
+inprocsrc_prc_io_ready (void *ap_obj, tiz_event_io_t * ap_ev_io, int a_fd,
+                        int a_events)
+{
+  inprocsrc_prc_t *p_prc = ap_obj;
+  assert (p_prc);
+  if (p_prc->p_ring_)
+    {
+      tiz_shm_ring_clear_fd (p_prc->p_ring_);
+    }
+  return fill_buffers (p_prc);
 }
 
 /*
@@ -171,6 +479,8 @@ inprocsrc_prc_init (void * ap_tos, void * ap_hdl)
      /* TIZ_CLASS_COMMENT: */
      tiz_srv_stop_and_return, inprocsrc_prc_stop_and_return,
      /* TIZ_CLASS_COMMENT: */
+     tiz_srv_io_ready, inprocsrc_prc_io_ready,
+     /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, inprocsrc_prc_buffers_ready,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
@@ -34,9 +34,13 @@ extern "C"
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include <zmq.h>
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
 #include <tizprc_decls.h>
 
   typedef struct inprocsrc_prc inprocsrc_prc_t;
@@ -44,7 +48,22 @@ extern "C"
   {
     /* Object */
     const tiz_prc_t _;
+    OMX_BUFFERHEADERTYPE * p_outhdr_;
+    bool stopped_;
     bool eos_;
+    tiz_shm_ring_t * p_ring_;
+    void * p_zmq_ctx_;
+    void * p_zmq_sock_;
+    int zmq_fd_;
+    zmq_msg_t zmq_msg_;
+    tiz_event_io_t * p_ev_io_;
+    /* The ring slot or zmq message being copied out */
+    const OMX_U8 * p_chunk_;
+    size_t chunk_len_;
+    size_t chunk_offset_;
+    OMX_U32 chunk_flags_;
+    OMX_TICKS chunk_timestamp_;
+    bool chunk_valid_;
   };
 
   typedef struct inprocsrc_prc_class inprocsrc_prc_class_t;
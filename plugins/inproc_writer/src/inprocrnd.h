@@ -47,6 +47,10 @@ extern "C"
 #define ARATELIA_INPROC_WRITER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_INPROC_WRITER_PORT_ALIGNMENT     0
 #define ARATELIA_INPROC_WRITER_PORT_SUPPLIERPREF  OMX_BufferSupplyInput
+#define ARATELIA_INPROC_WRITER_RING_NAME          "broadcast"
+#define ARATELIA_INPROC_WRITER_RING_SLOTS         16
+#define ARATELIA_INPROC_WRITER_RING_SLOT_SIZE     (64 * 1024)
+#define ARATELIA_INPROC_WRITER_ZMQ_ENDPOINT       "ipc:///tmp/tizonia-inproc"
 
 #ifdef __cplusplus
 }
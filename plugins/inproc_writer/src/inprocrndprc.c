@@ -21,7 +21,11 @@
  * @file   inprocrndprc.c
  * @author Juan A. Rubio <juan.rubio@aratelia.com>
  *
- * @brief  Tizonia - ZMQ inproc socket writer processor
+ * @brief  Tizonia - Inproc writer processor
+ *
+ * Publishes the incoming buffers on a shared memory ring (see tizshmring.h),
+ * or on a ZeroMQ PUB socket when the ring is not available or the transport
+ * is configured as 'zmq'.
  *
  *
  */
@@ -31,6 +35,10 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
 
 #include <tizplatform.h>
 
@@ -51,7 +59,7 @@
     {                                                 \
       if (NULL == (expr))                             \
         {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
+          TIZ_ERROR (handleOf (prc), "%s", msg);      \
           goto end;                                   \
         }                                             \
     }                                                 \
@@ -62,12 +70,27 @@
     {                                                 \
       if (0 != (expr))                                \
         {                                             \
-          TIZ_ERROR (handleOf (prc), "%s (%s)", msg); \
+          TIZ_ERROR (handleOf (prc), "%s", msg);      \
           goto end;                                   \
         }                                             \
     }                                                 \
   while (0)
 
+static const char *get_config_value (const char *ap_key)
+{
+  char key[OMX_MAX_STRINGNAME_SIZE * 2];
+  assert (ap_key);
+  snprintf (key, sizeof(key), "%s.%s", ARATELIA_INPROC_WRITER_COMPONENT_NAME,
+            ap_key);
+  return tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, key);
+}
+
+static bool shm_transport_enabled (void)
+{
+  const char *p_transport = get_config_value ("transport");
+  return !(p_transport && 0 == strcasecmp (p_transport, "zmq"));
+}
+
 static OMX_BUFFERHEADERTYPE *get_header (inprocrnd_prc_t *ap_prc)
 {
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
@@ -162,19 +185,77 @@ static OMX_ERRORTYPE buffer_emptied (inprocrnd_prc_t *ap_prc)
   return release_header (ap_prc);
 }
 
+/* The payload is written once to a ring slot, that every subscribed reader
+   then uses in place. Returns false when all the slots are still in use; the
+   ring's eventfd wakes us up when one is released. */
+static bool publish_to_ring (inprocrnd_prc_t *ap_prc,
+                             OMX_BUFFERHEADERTYPE *ap_hdr)
+{
+  void *p_slot = NULL;
+  size_t len = 0;
+  OMX_U32 flags = 0;
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  if (OMX_ErrorNoMore == tiz_shm_ring_claim (ap_prc->p_ring_, &p_slot))
+    {
+      return false;
+    }
+
+  /* Buffers larger than a slot are split; EOS goes with the last piece */
+  len = MIN (ap_hdr->nFilledLen, tiz_shm_ring_slot_size (ap_prc->p_ring_));
+  flags = ap_hdr->nFlags;
+  if (len < ap_hdr->nFilledLen)
+    {
+      flags &= ~OMX_BUFFERFLAG_EOS;
+    }
+  memcpy (p_slot, ap_hdr->pBuffer + ap_hdr->nOffset, len);
+  tiz_shm_ring_publish (ap_prc->p_ring_, len, flags, ap_hdr->nTimeStamp);
+  ap_hdr->nFilledLen -= len;
+  ap_hdr->nOffset += len;
+  return true;
+}
+
+static bool send_to_zmq_sock (inprocrnd_prc_t *ap_prc,
+                              OMX_BUFFERHEADERTYPE *ap_hdr)
+{
+  assert (ap_prc);
+  assert (ap_hdr);
+
+  /* An empty message carries the EOS */
+  if (zmq_send (ap_prc->p_zmq_sock_, ap_hdr->pBuffer + ap_hdr->nOffset,
+                ap_hdr->nFilledLen, ZMQ_DONTWAIT) < 0)
+    {
+      if (EAGAIN == errno)
+        {
+          return false;
+        }
+      TIZ_ERROR (handleOf (ap_prc), "zmq_send: %s - dropping [%d] bytes",
+                 zmq_strerror (errno), ap_hdr->nFilledLen);
+    }
+  ap_hdr->nOffset += ap_hdr->nFilledLen;
+  ap_hdr->nFilledLen = 0;
+  return true;
+}
+
 static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   OMX_BUFFERHEADERTYPE *p_hdr = NULL;
   assert (ap_prc);
 
-  while ((p_hdr = get_header (ap_prc)))
+  while (OMX_ErrorNone == rc && (p_hdr = get_header (ap_prc)))
     {
-      if (p_hdr->nFilledLen > 0)
+      if (p_hdr->nFilledLen > 0 || (p_hdr->nFlags & OMX_BUFFERFLAG_EOS))
         {
-          const int bytes_to_write = 0;
-          p_hdr->nFilledLen -= bytes_to_write;
-          p_hdr->nOffset += bytes_to_write;
+          const bool sent = ap_prc->p_ring_
+                                ? publish_to_ring (ap_prc, p_hdr)
+                                : send_to_zmq_sock (ap_prc, p_hdr);
+          if (!sent)
+            {
+              /* The transport is full; carry on from io_ready */
+              break;
+            }
         }
 
       if (0 == p_hdr->nFilledLen)
@@ -187,6 +268,58 @@ static OMX_ERRORTYPE write_buffer (inprocrnd_prc_t *ap_prc)
   return rc;
 }
 
+static OMX_ERRORTYPE open_ring (inprocrnd_prc_t *ap_prc)
+{
+  assert (ap_prc);
+  assert (!ap_prc->p_ring_);
+
+  if (shm_transport_enabled ())
+    {
+      if (OMX_ErrorNone
+          != tiz_shm_ring_open (&(ap_prc->p_ring_),
+                                ARATELIA_INPROC_WRITER_RING_NAME,
+                                ARATELIA_INPROC_WRITER_RING_SLOTS,
+                                ARATELIA_INPROC_WRITER_RING_SLOT_SIZE))
+        {
+          TIZ_WARN (handleOf (ap_prc),
+                    "Shared memory ring not available; using ZeroMQ");
+          ap_prc->p_ring_ = NULL;
+        }
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE open_zmq_sock (inprocrnd_prc_t *ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
+  const char *p_endpoint = get_config_value ("zmq_endpoint");
+  int zmq_rc = 0;
+  assert (ap_prc);
+
+  /* Create the zmq context */
+  ap_prc->p_zmq_ctx_ = zmq_ctx_new ();
+  goto_end_on_zmq_null_pointer (ap_prc->p_zmq_ctx_, ap_prc,
+                                zmq_strerror (errno));
+
+  /* Create the zmq PUB socket */
+  ap_prc->p_zmq_sock_ = zmq_socket (ap_prc->p_zmq_ctx_, ZMQ_PUB);
+  goto_end_on_zmq_null_pointer (ap_prc->p_zmq_sock_, ap_prc,
+                                zmq_strerror (errno));
+
+  /* Bind the socket to the configured address */
+  zmq_rc = zmq_bind (ap_prc->p_zmq_sock_,
+                     p_endpoint ? p_endpoint
+                                : ARATELIA_INPROC_WRITER_ZMQ_ENDPOINT);
+  goto_end_on_zmq_error (zmq_rc, ap_prc, zmq_strerror (errno));
+
+  /* All good */
+  rc = OMX_ErrorNone;
+
+end:
+
+  return rc;
+}
+
 /*
  * inprocrndprc
  */
@@ -201,6 +334,8 @@ static void *inprocrnd_prc_ctor (void *ap_prc, va_list *app)
   p_prc->p_zmq_ctx_ = NULL;
   p_prc->p_zmq_sock_ = NULL;
   p_prc->zmq_fd_ = -1;
+  p_prc->p_ring_ = NULL;
+  p_prc->p_ev_io_ = NULL;
   p_prc->eos_ = false;
   return p_prc;
 }
@@ -218,38 +353,32 @@ static OMX_ERRORTYPE inprocrnd_prc_allocate_resources (void *ap_prc,
                                                        OMX_U32 a_pid)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
-  OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
-  int zmq_rc = 0;
   assert (p_prc);
 
-  /* Create the zmq context */
-  p_prc->p_zmq_ctx_ = zmq_ctx_new ();
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_ctx_, p_prc, zmq_strerror (errno));
-
-  /* No need for io threads (since inproc transport) */
-  zmq_ctx_set (p_prc->p_zmq_ctx_, ZMQ_IO_THREADS, 0);
-
-  /* Create the zmq PUB socket */
-  p_prc->p_zmq_sock_ = zmq_socket (p_prc->p_zmq_ctx_, ZMQ_PUB);
-  goto_end_on_zmq_null_pointer (p_prc->p_zmq_sock_, p_prc,
-                                zmq_strerror (errno));
-
-  /* Bind the socket to the inproc address */
-  zmq_rc = zmq_bind (p_prc->p_zmq_sock_, "inproc://broadcast");
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
-
-  /* All good */
-  rc = OMX_ErrorNone;
-
-end:
-
-  return rc;
+  tiz_check_omx (open_ring (p_prc));
+  if (!p_prc->p_ring_)
+    {
+      tiz_check_omx (open_zmq_sock (p_prc));
+    }
+  TIZ_DEBUG (handleOf (p_prc), "transport [%s]",
+             p_prc->p_ring_ ? "shm" : "zmq");
+  return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
 {
   inprocrnd_prc_t *p_prc = ap_prc;
   assert (p_prc);
+  if (p_prc->p_ev_io_)
+    {
+      tiz_srv_io_watcher_destroy (p_prc, p_prc->p_ev_io_);
+      p_prc->p_ev_io_ = NULL;
+    }
+  if (p_prc->p_ring_)
+    {
+      tiz_shm_ring_close (p_prc->p_ring_);
+      p_prc->p_ring_ = NULL;
+    }
   if (p_prc->p_zmq_sock_)
     {
       zmq_close (p_prc->p_zmq_sock_);
@@ -260,6 +389,7 @@ static OMX_ERRORTYPE inprocrnd_prc_deallocate_resources (void *ap_prc)
       zmq_ctx_shutdown (p_prc->p_zmq_ctx_);
       p_prc->p_zmq_ctx_ = NULL;
     }
+  p_prc->zmq_fd_ = -1;
   return OMX_ErrorNone;
 }
 
@@ -270,15 +400,29 @@ static OMX_ERRORTYPE inprocrnd_prc_prepare_to_transfer (void *ap_prc,
   OMX_ERRORTYPE rc = OMX_ErrorInsufficientResources;
   int zmq_rc = 0;
   size_t fd_len = 0;
+  int fd = -1;
   assert (p_prc);
 
-  fd_len = sizeof(p_prc->zmq_fd_);
-  zmq_rc
-      = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_, &fd_len);
-  goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
+  if (p_prc->p_ev_io_)
+    {
+      return OMX_ErrorNone;
+    }
 
-  /* All goood */
-  rc = OMX_ErrorNone;
+  if (p_prc->p_ring_)
+    {
+      fd = tiz_shm_ring_fd (p_prc->p_ring_);
+    }
+  else
+    {
+      fd_len = sizeof(p_prc->zmq_fd_);
+      zmq_rc = zmq_getsockopt (p_prc->p_zmq_sock_, ZMQ_FD, &p_prc->zmq_fd_,
+                               &fd_len);
+      goto_end_on_zmq_error (zmq_rc, p_prc, zmq_strerror (errno));
+      fd = p_prc->zmq_fd_;
+    }
+
+  rc = tiz_srv_io_watcher_init (p_prc, &(p_prc->p_ev_io_), fd, TIZ_EVENT_READ,
+                                false);
 
 end:
 
@@ -288,12 +432,24 @@ end:
 static OMX_ERRORTYPE inprocrnd_prc_transfer_and_process (void *ap_prc,
                                                          OMX_U32 a_pid)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = false;
+  p_prc->eos_ = false;
+  assert (p_prc->p_ev_io_);
+  return tiz_srv_io_watcher_start (p_prc, p_prc->p_ev_io_);
 }
 
 static OMX_ERRORTYPE inprocrnd_prc_stop_and_return (void *ap_prc)
 {
-  return OMX_ErrorNone;
+  inprocrnd_prc_t *p_prc = ap_prc;
+  assert (p_prc);
+  p_prc->stopped_ = true;
+  if (p_prc->p_ev_io_)
+    {
+      (void)tiz_srv_io_watcher_stop (p_prc, p_prc->p_ev_io_);
+    }
+  return release_header (p_prc);
 }
 
 /*
@@ -307,7 +463,12 @@ static OMX_ERRORTYPE inprocrnd_prc_io_ready (void *ap_prc,
   inprocrnd_prc_t *p_prc = (inprocrnd_prc_t *)ap_prc;
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (p_prc);
-  if (ready_to_process (p_prc) && ready_to_write_to_zmq_sock (p_prc))
+  if (p_prc->p_ring_)
+    {
+      tiz_shm_ring_clear_fd (p_prc->p_ring_);
+    }
+  if (ready_to_process (p_prc)
+      && (p_prc->p_ring_ || ready_to_write_to_zmq_sock (p_prc)))
     {
       rc = write_buffer (p_prc);
     }
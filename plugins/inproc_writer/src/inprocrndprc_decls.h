@@ -40,6 +40,7 @@ extern "C"
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
 #include <tizprc_decls.h>
 
   typedef struct inprocrnd_prc inprocrnd_prc_t;
@@ -54,6 +55,8 @@ extern "C"
     void * p_zmq_ctx_;
     void * p_zmq_sock_;
     int zmq_fd_;
+    tiz_shm_ring_t * p_ring_;
+    tiz_event_io_t * p_ev_io_;
     bool eos_;
   };
 
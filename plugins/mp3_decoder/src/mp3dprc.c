@@ -31,7 +31,6 @@
 #endif
 
 #include <assert.h>
-#include <limits.h>
 #include <string.h>
 
 #include <tizplatform.h>
@@ -58,6 +57,30 @@ reset_stream_parameters (mp3d_prc_t * ap_prc)
   ap_prc->frame_count_ = 0;
   ap_prc->next_synth_sample_ = 0;
   ap_prc->eos_ = false;
+  if (ap_prc->p_pcm_conv_)
+    {
+      tiz_pcm_conv_reset (ap_prc->p_pcm_conv_);
+    }
+}
+
+static void
+reset_trimming_info (mp3d_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  ap_prc->skip_samples_ = 0;
+  ap_prc->total_samples_ = 0;
+  ap_prc->samples_out_ = 0;
+}
+
+static void
+restart_mad_stream (mp3d_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  /* Drop whatever was left of the previous stream in libmad's bit
+     reservoir, so that the first frames of the next one decode cleanly */
+  mad_stream_finish (&ap_prc->stream_);
+  mad_stream_init (&ap_prc->stream_);
+  reset_trimming_info (ap_prc);
 }
 
 static void
@@ -280,46 +303,6 @@ store_stream_metadata (mp3d_prc_t * ap_prc, struct mad_header * Header)
              Emphasis, Header->samplerate);
 }
 
-static signed short
-mad_fixed_to_sshort (mad_fixed_t fixed)
-{
-  /* A fixed point number is formed of the following bit pattern:
-   *
-   * SWWWFFFFFFFFFFFFFFFFFFFFFFFFFFFF
-   * MSB                          LSB
-   * S ==> Sign (0 is positive, 1 is negative)
-   * W ==> Whole part bits
-   * F ==> Fractional part bits
-   *
-   * This pattern contains MAD_F_FRACBITS fractional bits, one
-   * should alway use this macro when working on the bits of a fixed
-   * point number. It is not guaranteed to be constant over the
-   * different platforms supported by libmad.
-   *
-   * The signed short value is formed, after clipping, by the least
-   * significant whole part bit, followed by the 15 most significant
-   * fractional part bits. Warning: this is a quick and dirty way to
-   * compute the 16-bit number, madplay includes much better
-   * algorithms.
-   */
-
-  /* Clipping */
-  if (fixed >= MAD_F_ONE)
-    {
-      return (SHRT_MAX);
-    }
-
-  if (fixed <= -MAD_F_ONE)
-    {
-      return (-SHRT_MAX);
-    }
-
-  /* Conversion. */
-  fixed = fixed >> (MAD_F_FRACBITS - 15);
-
-  return (signed short) fixed;
-}
-
 static size_t
 read_from_omx_buffer (const mp3d_prc_t * ap_prc, void * ap_dst, size_t bytes,
                       OMX_BUFFERHEADERTYPE * ap_hdr)
@@ -381,69 +364,200 @@ update_pcm_mode (mp3d_prc_t * ap_prc, const OMX_U32 a_samplerate,
   return OMX_ErrorNone;
 }
 
-static int
-synthesize_samples (const void * ap_obj, int next_sample)
+static unsigned long
+read_be32 (const unsigned char * ap_data)
 {
-  mp3d_prc_t * p_prc = (mp3d_prc_t *) ap_obj;
-  const unsigned char * p_bufend
-    = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nAllocLen;
-  unsigned char * p_output
-    = p_prc->p_outhdr_->pBuffer + p_prc->p_outhdr_->nFilledLen;
-  bool buffer_full = (p_bufend == p_output);
-  int i;
+  return ((unsigned long) ap_data[0] << 24) | ((unsigned long) ap_data[1] << 16)
+         | ((unsigned long) ap_data[2] << 8) | (unsigned long) ap_data[3];
+}
+
+/* Looks for a Xing/Info header in the frame just decoded, and if it is there,
+ * uses the encoder delay and padding of the LAME extension to work out the
+ * samples to drop at both ends of the stream. Returns true if the frame is
+ * the Xing/Info frame, which carries no audio. */
+static bool
+parse_lame_tag (mp3d_prc_t * ap_prc)
+{
+  const struct mad_header * p_header = NULL;
+  const unsigned char * p_data = NULL;
+  const unsigned char * p_end = NULL;
+  unsigned long flags = 0;
+  unsigned long frames = 0;
+  unsigned long samples_per_frame = 0;
+  size_t side_info_len = 0;
+
+  assert (ap_prc);
+  p_header = &(ap_prc->frame_.header);
+
+  if (MAD_LAYER_III != p_header->layer || !ap_prc->stream_.this_frame
+      || !ap_prc->stream_.next_frame)
+    {
+      return false;
+    }
+
+  if (p_header->flags & MAD_FLAG_LSF_EXT)
+    {
+      side_info_len = (MAD_MODE_SINGLE_CHANNEL == p_header->mode) ? 9 : 17;
+    }
+  else
+    {
+      side_info_len = (MAD_MODE_SINGLE_CHANNEL == p_header->mode) ? 17 : 32;
+    }
+
+  p_data = ap_prc->stream_.this_frame + 4 + side_info_len;
+  p_end = ap_prc->stream_.next_frame;
+  if (p_header->flags & MAD_FLAG_PROTECTION)
+    {
+      p_data += 2;
+    }
 
-  for (i = next_sample; i < p_prc->synth_.pcm.length && !buffer_full; i++)
+  if (p_data + 8 > p_end
+      || (memcmp (p_data, "Xing", 4) != 0 && memcmp (p_data, "Info", 4) != 0))
     {
-      signed short sample;
+      return false;
+    }
 
-      /* Left channel */
-      sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[0][i]);
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+  flags = read_be32 (p_data + 4);
+  p_data += 8;
 
-      /* Right channel. If the decoded stream is monophonic then
-       * the right output channel is the same as the left one.
-       */
-      if (MAD_NCHANNELS (&p_prc->frame_.header) == 2)
+  if (flags & 0x1) /* frames */
+    {
+      if (p_data + 4 > p_end)
+        {
+          return true;
+        }
+      frames = read_be32 (p_data);
+      p_data += 4;
+    }
+  if (flags & 0x2) /* bytes */
+    {
+      p_data += 4;
+    }
+  if (flags & 0x4) /* toc */
+    {
+      p_data += 100;
+    }
+  if (flags & 0x8) /* quality */
+    {
+      p_data += 4;
+    }
+
+  /* The LAME extension: 9 bytes of encoder version, followed by the info
+     tag revision, the lowpass, the replay gain fields, the encoding flags,
+     the bitrate, and the 12-bit encoder delay and padding values. */
+  if (p_data + 24 <= p_end && memcmp (p_data, "LAME", 4) == 0)
+    {
+      const unsigned long delay
+        = ((unsigned long) p_data[21] << 4) | (p_data[22] >> 4);
+      const unsigned long padding
+        = ((unsigned long) (p_data[22] & 0x0f) << 8) | p_data[23];
+
+      /* libmad adds 529 samples of delay of its own */
+      ap_prc->skip_samples_ = delay + 529;
+      samples_per_frame = 32 * MAD_NSBSAMPLES (p_header);
+      if (frames > 0 && frames * samples_per_frame > delay + padding)
         {
-          sample = mad_fixed_to_sshort (p_prc->synth_.pcm.samples[1][i]);
+          ap_prc->total_samples_ = frames * samples_per_frame - delay - padding;
         }
-      *(p_output++) = sample >> 8;
-      *(p_output++) = sample & 0xff;
+      TIZ_TRACE (handleOf (ap_prc),
+                 "LAME tag : frames [%lu] delay [%lu] padding [%lu] "
+                 "total samples [%lu]",
+                 frames, delay, padding, ap_prc->total_samples_);
+    }
+
+  return true;
+}
 
-      p_prc->p_outhdr_->nFilledLen += 4;
+static void
+update_output_pcm_mode (mp3d_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  if (ap_prc->frame_.header.samplerate != ap_prc->pcmmode_.nSamplingRate
+      || ap_prc->pcmmode_.nChannels < 2)
+    {
+      /* We're outputting two channels, also for mono streams.
+       */
+      const OMX_U32 nchannels = 2;
+      TIZ_PRINTF_DBG_GRN ("samplerate [%d] NCHANNELS [%d] channels [%d].",
+                          ap_prc->frame_.header.samplerate,
+                          MAD_NCHANNELS (&ap_prc->frame_.header),
+                          ap_prc->synth_.pcm.channels);
+      store_stream_metadata (ap_prc, &(ap_prc->frame_.header));
+      (void) update_pcm_mode (ap_prc, ap_prc->synth_.pcm.samplerate,
+                              nchannels);
+    }
+}
 
-      if (p_prc->frame_.header.samplerate != p_prc->pcmmode_.nSamplingRate
-          || p_prc->pcmmode_.nChannels < 2)
+static int
+synthesize_samples (const void * ap_obj, int next_sample)
+{
+  mp3d_prc_t * p_prc = (mp3d_prc_t *) ap_obj;
+  const struct mad_pcm * p_pcm = &(p_prc->synth_.pcm);
+  const size_t frame_size = tiz_pcm_conv_frame_size (p_prc->p_pcm_conv_);
+  bool buffer_full = false;
+  int i = next_sample;
+
+  while (i < p_pcm->length && !buffer_full)
+    {
+      OMX_BUFFERHEADERTYPE * p_out = p_prc->p_outhdr_;
+      const void * planes[2];
+      unsigned long nframes = p_pcm->length - i;
+
+      /* Drop the encoder delay and padding, when they are known */
+      if (p_prc->skip_samples_ > 0)
         {
-          /* We're outputting two channels, also for mono streams.
-           */
-          const OMX_U32 nchannels = 2;
-          TIZ_PRINTF_DBG_GRN ("samplerate [%d] NCHANNELS [%d] channels [%d].",
-                              p_prc->frame_.header.samplerate,
-                              MAD_NCHANNELS (&p_prc->frame_.header),
-                              p_prc->synth_.pcm.channels);
-          store_stream_metadata (p_prc, &(p_prc->frame_.header));
-          (void) update_pcm_mode (p_prc, p_prc->synth_.pcm.samplerate,
-                                  nchannels);
+          const unsigned long nskip = MIN (nframes, p_prc->skip_samples_);
+          p_prc->skip_samples_ -= nskip;
+          i += nskip;
+          continue;
         }
+      if (p_prc->total_samples_ > 0)
+        {
+          if (p_prc->samples_out_ >= p_prc->total_samples_)
+            {
+              i = p_pcm->length;
+              break;
+            }
+          nframes
+            = MIN (nframes, p_prc->total_samples_ - p_prc->samples_out_);
+        }
+      nframes
+        = MIN (nframes, (p_out->nAllocLen - p_out->nFilledLen) / frame_size);
+      if (0 == nframes)
+        {
+          break;
+        }
+
+      /* If the decoded stream is monophonic then the right output channel is
+       * the same as the left one.
+       */
+      planes[0] = p_pcm->samples[0] + i;
+      planes[1] = p_pcm->samples[MAD_NCHANNELS (&p_prc->frame_.header) == 2
+                                   ? 1
+                                   : 0]
+                  + i;
+      tiz_pcm_conv_planar (p_prc->p_pcm_conv_, planes, nframes,
+                           p_out->pBuffer + p_out->nFilledLen);
+      p_out->nFilledLen += nframes * frame_size;
+      p_prc->samples_out_ += nframes;
+      i += nframes;
+
+      update_output_pcm_mode (p_prc);
 
       /* release the output buffer if it is full, or if we are at the early stages
          of the decoding */
-      if (p_output == p_bufend)
+      if (p_out->nAllocLen - p_out->nFilledLen < frame_size)
         {
-          p_output = p_prc->p_outhdr_->pBuffer;
-          p_prc->p_outhdr_->nFilledLen = p_prc->p_outhdr_->nAllocLen;
+          p_out->nFilledLen = p_out->nAllocLen;
           (void) release_headers (p_prc,
                                   ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX);
           buffer_full = true;
         }
       else if (p_prc->frame_count_ < 5
-               && p_prc->p_outhdr_->nFilledLen
+               && p_out->nFilledLen
                     >= (int) (ARATELIA_MP3_DECODER_PORT_MIN_OUTPUT_BUF_SIZE
                               * .2))
         {
-          p_output = p_prc->p_outhdr_->pBuffer;
           (void) release_headers (p_prc,
                                   ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX);
           buffer_full = true;
@@ -451,7 +565,7 @@ synthesize_samples (const void * ap_obj, int next_sample)
     }
 
   /* Return the sample index if there are more samples to process */
-  if (i < p_prc->synth_.pcm.length)
+  if (i < p_pcm->length)
     {
       return i;
     }
@@ -599,6 +713,12 @@ decode_buffer (const void * ap_obj)
       if (0 == p_obj->frame_count_)
         {
           store_stream_metadata (p_obj, &(p_obj->frame_.header));
+          if (parse_lame_tag (p_obj))
+            {
+              /* The Xing/Info frame is not audio */
+              p_obj->frame_count_++;
+              continue;
+            }
         }
 
       p_obj->frame_count_++;
@@ -711,6 +831,8 @@ mp3d_proc_ctor (void * ap_obj, va_list * app)
   p_obj->p_inhdr_ = 0;
   p_obj->p_outhdr_ = 0;
   p_obj->next_synth_sample_ = 0;
+  p_obj->p_pcm_conv_ = NULL;
+  reset_trimming_info (p_obj);
   p_obj->eos_ = false;
   p_obj->in_port_disabled_ = false;
   p_obj->out_port_disabled_ = false;
@@ -730,14 +852,30 @@ mp3d_proc_dtor (void * ap_obj)
 static OMX_ERRORTYPE
 mp3d_proc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
+  mp3d_prc_t * p_prc = ap_obj;
+  assert (p_prc);
+  assert (!p_prc->p_pcm_conv_);
   /* NOTE: Initialisation of the decoder is delayed until Idle->Exe */
-  return OMX_ErrorNone;
+  /* libmad's output is converted to 16-bit big-endian stereo, which is what
+     the output port advertises, rounding to nearest unless dither has been
+     enabled in the rc file. */
+  return tiz_pcm_conv_init (
+    &(p_prc->p_pcm_conv_), ETIZPcmInFixed32, MAD_F_FRACBITS, ETIZPcmOutS16,
+    OMX_EndianBig, 2,
+    tiz_pcm_dither_from_str (
+      tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            "OMX.Aratelia.audio_decoder.mp3.dither"),
+      ETIZPcmDitherNone));
 }
 
 static OMX_ERRORTYPE
 mp3d_proc_deallocate_resources (void * ap_obj)
 {
+  mp3d_prc_t * p_prc = ap_obj;
+  assert (p_prc);
   /* NOTE: De-initialisation of the decoder is done in Exe->Idle */
+  tiz_pcm_conv_destroy (p_prc->p_pcm_conv_);
+  p_prc->p_pcm_conv_ = NULL;
   return OMX_ErrorNone;
 }
 
@@ -773,6 +911,7 @@ mp3d_proc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
              p_prc->pcmmode_.nSamplingRate, p_prc->pcmmode_.nChannels);
 
   reset_stream_parameters (ap_obj);
+  reset_trimming_info (ap_obj);
 
   return OMX_ErrorNone;
 }
@@ -881,7 +1020,10 @@ mp3d_proc_port_enable (const void * ap_obj, OMX_U32 a_pid)
   assert (p_obj);
   if (OMX_ALL == a_pid || ARATELIA_MP3_DECODER_INPUT_PORT_INDEX == a_pid)
     {
+      /* A new stream may be about to arrive on this port, e.g. the next
+         track of a gapless transition */
       reset_stream_parameters (p_obj);
+      restart_mad_stream (p_obj);
       p_obj->in_port_disabled_ = false;
     }
   if (OMX_ALL == a_pid || ARATELIA_MP3_DECODER_OUTPUT_PORT_INDEX == a_pid)
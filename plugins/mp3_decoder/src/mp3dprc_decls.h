@@ -38,6 +38,8 @@ extern "C" {
 
 #include <OMX_Core.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
 #define INPUT_BUFFER_SIZE (5 * 8192)
@@ -59,6 +61,10 @@ struct mp3d_prc
   OMX_BUFFERHEADERTYPE * p_inhdr_;
   OMX_BUFFERHEADERTYPE * p_outhdr_;
   int next_synth_sample_;
+  tiz_pcm_conv_t * p_pcm_conv_;
+  unsigned long skip_samples_;  /* encoder + decoder delay still to drop */
+  unsigned long total_samples_; /* from the LAME tag, 0 if unknown */
+  unsigned long samples_out_;
   bool eos_;
   bool in_port_disabled_;
   bool out_port_disabled_;
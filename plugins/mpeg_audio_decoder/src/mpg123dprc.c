@@ -524,6 +524,18 @@ static OMX_ERRORTYPE mpg123d_proc_port_flush (const void *ap_prc, OMX_U32 a_pid)
 static OMX_ERRORTYPE mpg123d_prc_port_enable (const void *ap_prc, OMX_U32 a_pid)
 {
   mpg123d_prc_t *p_prc = (mpg123d_prc_t *)ap_prc;
+  if ((OMX_ALL == a_pid || ARATELIA_MPG123_DECODER_INPUT_PORT_INDEX == a_pid)
+      && p_prc->p_mpg123_)
+    {
+      /* A new stream may be about to arrive on this port, e.g. the next
+         track of a gapless transition */
+      (void)mpg123_close (p_prc->p_mpg123_);
+      if (MPG123_OK != mpg123_open_feed (p_prc->p_mpg123_))
+        {
+          return OMX_ErrorInsufficientResources;
+        }
+      reset_stream_parameters (p_prc);
+    }
   tiz_filter_prc_update_port_disabled_flag (p_prc, a_pid, false);
   return OMX_ErrorNone;
 }
@@ -52,6 +52,7 @@ extern "C" {
 #define TIZ_OGG_DEMUXER_INITIAL_READ_BLOCKSIZE 16384
 #define TIZ_OGG_DEMUXER_DEFAULT_READ_BLOCKSIZE 512
 #define TIZ_OGG_DEMUXER_DEFAULT_BUFFER_UTILISATION .75
+#define TIZ_OGG_DEMUXER_SEEK_INDEX_INTERVAL_MS 500
 #define ALL_OGG_STREAMS -1
 
 #ifdef __cplusplus
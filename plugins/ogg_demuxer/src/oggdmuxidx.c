@@ -0,0 +1,445 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   oggdmuxidx.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - OGG demuxer seek index
+ *
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <tizplatform.h>
+
+#include "oggdmuxidx.h"
+
+#ifdef TIZ_LOG_CATEGORY_NAME
+#undef TIZ_LOG_CATEGORY_NAME
+#define TIZ_LOG_CATEGORY_NAME "tiz.ogg_demuxer.idx"
+#endif
+
+#define OGGDMUX_IDX_MAGIC "TIZOGGIX"
+#define OGGDMUX_IDX_VERSION 1
+#define OGGDMUX_IDX_DIR "/oggdmux"
+/* A ten-hour file indexed every 100 ms is well below this */
+#define OGGDMUX_IDX_MAX_ENTRIES (1 << 22)
+#define OGGDMUX_IDX_INITIAL_CAPACITY 256
+
+typedef struct oggdmux_idx_entry oggdmux_idx_entry_t;
+struct oggdmux_idx_entry
+{
+  int64_t time_ms;
+  int64_t offset;
+};
+
+/* On-disk header; followed by count entries */
+typedef struct oggdmux_idx_file_hdr oggdmux_idx_file_hdr_t;
+struct oggdmux_idx_file_hdr
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t mtime_ns;
+  uint64_t size;
+  int64_t duration_ms;
+  int64_t serialno;
+};
+
+struct oggdmux_idx
+{
+  char * p_cache_path;
+  uint64_t mtime_ns;
+  uint64_t size;
+  long serialno;
+  OMX_U32 interval_ms;
+  oggdmux_idx_entry_t * p_entries;
+  OMX_U32 count;
+  OMX_U32 capacity;
+  OMX_S64 duration_ms;
+  bool dirty;
+};
+
+static uint64_t
+fnv1a_64 (const char * ap_str)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  while (*ap_str)
+    {
+      hash ^= (unsigned char) *ap_str++;
+      hash *= 1099511628211ULL;
+    }
+  return hash;
+}
+
+/* Same location as the player's probe cache */
+static bool
+cache_dir (char * ap_dir, const size_t a_len)
+{
+  const char * p_xdg = getenv ("XDG_CACHE_HOME");
+  const char * p_home = getenv ("HOME");
+  int n = -1;
+  if (p_xdg && *p_xdg)
+    {
+      n = snprintf (ap_dir, a_len, "%s/tizonia", p_xdg);
+    }
+  else if (p_home && *p_home)
+    {
+      n = snprintf (ap_dir, a_len, "%s/.cache/tizonia", p_home);
+    }
+  return n > 0 && (size_t) n < a_len;
+}
+
+static bool
+make_dir (const char * ap_dir)
+{
+  return 0 == mkdir (ap_dir, 0700) || EEXIST == errno;
+}
+
+static char *
+cache_path (const char * ap_path)
+{
+  char dir[PATH_MAX];
+  char * p_path = NULL;
+  size_t len = 0;
+
+  if (!cache_dir (dir, sizeof (dir)))
+    {
+      return NULL;
+    }
+
+  len = strlen (dir) + sizeof (OGGDMUX_IDX_DIR) + 1 + 16 + sizeof (".idx");
+  if ((p_path = tiz_mem_alloc (len)))
+    {
+      (void) snprintf (p_path, len, "%s" OGGDMUX_IDX_DIR "/%016llx.idx", dir,
+                       (unsigned long long) fnv1a_64 (ap_path));
+    }
+  return p_path;
+}
+
+static bool
+reserve (oggdmux_idx_t * ap_idx, const OMX_U32 a_count)
+{
+  oggdmux_idx_entry_t * p_entries = NULL;
+  OMX_U32 capacity = ap_idx->capacity;
+
+  if (a_count <= capacity)
+    {
+      return true;
+    }
+  if (a_count > OGGDMUX_IDX_MAX_ENTRIES)
+    {
+      return false;
+    }
+  if (0 == capacity)
+    {
+      capacity = OGGDMUX_IDX_INITIAL_CAPACITY;
+    }
+  while (capacity < a_count)
+    {
+      capacity *= 2;
+    }
+  if (!(p_entries = tiz_mem_realloc (ap_idx->p_entries,
+                                     capacity * sizeof (*p_entries))))
+    {
+      return false;
+    }
+  ap_idx->p_entries = p_entries;
+  ap_idx->capacity = capacity;
+  return true;
+}
+
+static bool
+entries_are_sorted (const oggdmux_idx_entry_t * ap_entries,
+                    const OMX_U32 a_count)
+{
+  OMX_U32 i = 0;
+  for (i = 1; i < a_count; ++i)
+    {
+      if (ap_entries[i].time_ms < ap_entries[i - 1].time_ms
+          || ap_entries[i].offset <= ap_entries[i - 1].offset)
+        {
+          return false;
+        }
+    }
+  return true;
+}
+
+static void
+load (oggdmux_idx_t * ap_idx)
+{
+  oggdmux_idx_file_hdr_t hdr;
+  FILE * p_file = NULL;
+
+  assert (ap_idx);
+
+  if (!(p_file = fopen (ap_idx->p_cache_path, "r")))
+    {
+      return;
+    }
+
+  if (1 == fread (&hdr, sizeof (hdr), 1, p_file)
+      && 0 == memcmp (hdr.magic, OGGDMUX_IDX_MAGIC, sizeof (hdr.magic))
+      && OGGDMUX_IDX_VERSION == hdr.version
+      && ap_idx->mtime_ns == hdr.mtime_ns && ap_idx->size == hdr.size
+      && ap_idx->serialno == hdr.serialno && reserve (ap_idx, hdr.count)
+      && hdr.count
+           == fread (ap_idx->p_entries, sizeof (oggdmux_idx_entry_t),
+                     hdr.count, p_file)
+      && entries_are_sorted (ap_idx->p_entries, hdr.count))
+    {
+      ap_idx->count = hdr.count;
+      ap_idx->duration_ms = hdr.duration_ms;
+      TIZ_LOG (TIZ_PRIORITY_DEBUG,
+               "[%s] : loaded [%u] entries - duration [%lld]",
+               ap_idx->p_cache_path, ap_idx->count,
+               (long long) ap_idx->duration_ms);
+    }
+
+  (void) fclose (p_file);
+}
+
+OMX_ERRORTYPE
+oggdmux_idx_init (oggdmux_idx_t ** app_idx, const char * ap_path,
+                  const long a_serialno, const OMX_U32 a_interval_ms)
+{
+  oggdmux_idx_t * p_idx = NULL;
+  struct stat st;
+
+  assert (app_idx);
+  assert (ap_path);
+
+  tiz_check_null_ret_oom ((p_idx = tiz_mem_calloc (1, sizeof (*p_idx)))
+                          != NULL);
+  p_idx->serialno = a_serialno;
+  p_idx->interval_ms = a_interval_ms;
+  p_idx->duration_ms = -1;
+
+  /* Without a cache location, the index still serves the current session */
+  if (0 == stat (ap_path, &st) && (p_idx->p_cache_path = cache_path (ap_path)))
+    {
+      p_idx->mtime_ns = (uint64_t) st.st_mtim.tv_sec * 1000000000ULL
+                        + st.st_mtim.tv_nsec;
+      p_idx->size = st.st_size;
+      load (p_idx);
+    }
+
+  *app_idx = p_idx;
+  return OMX_ErrorNone;
+}
+
+void
+oggdmux_idx_destroy (oggdmux_idx_t * ap_idx)
+{
+  if (ap_idx)
+    {
+      tiz_mem_free (ap_idx->p_entries);
+      tiz_mem_free (ap_idx->p_cache_path);
+      tiz_mem_free (ap_idx);
+    }
+}
+
+void
+oggdmux_idx_add (oggdmux_idx_t * ap_idx, const OMX_S64 a_time_ms,
+                 const OMX_S64 a_offset)
+{
+  oggdmux_idx_entry_t * p_last = NULL;
+
+  assert (ap_idx);
+
+  if (ap_idx->duration_ms >= 0 || a_time_ms < 0)
+    {
+      return;
+    }
+
+  if (ap_idx->count > 0)
+    {
+      p_last = &(ap_idx->p_entries[ap_idx->count - 1]);
+      if (a_offset <= p_last->offset)
+        {
+          return;
+        }
+      if (a_time_ms == p_last->time_ms)
+        {
+          /* e.g. the codec header pages, all with granulepos 0: keep the
+           * offset of the last one, i.e. that of the first data page */
+          p_last->offset = a_offset;
+          ap_idx->dirty = true;
+          return;
+        }
+      if (a_time_ms < p_last->time_ms + (OMX_S64) ap_idx->interval_ms)
+        {
+          return;
+        }
+    }
+
+  if (reserve (ap_idx, ap_idx->count + 1))
+    {
+      ap_idx->p_entries[ap_idx->count].time_ms = a_time_ms;
+      ap_idx->p_entries[ap_idx->count].offset = a_offset;
+      ap_idx->count++;
+      ap_idx->dirty = true;
+    }
+}
+
+void
+oggdmux_idx_complete (oggdmux_idx_t * ap_idx, const OMX_S64 a_duration_ms)
+{
+  assert (ap_idx);
+  if (ap_idx->duration_ms < 0 && ap_idx->count > 0)
+    {
+      ap_idx->duration_ms = a_duration_ms;
+      ap_idx->dirty = true;
+    }
+}
+
+bool
+oggdmux_idx_lookup (const oggdmux_idx_t * ap_idx, const OMX_S64 a_time_ms,
+                    OMX_S64 * ap_entry_ms, OMX_S64 * ap_offset)
+{
+  const oggdmux_idx_entry_t * p_entries = NULL;
+  OMX_U32 lo = 0;
+  OMX_U32 hi = 0;
+
+  assert (ap_idx);
+  assert (ap_entry_ms);
+  assert (ap_offset);
+
+  if (0 == ap_idx->count)
+    {
+      return false;
+    }
+
+  p_entries = ap_idx->p_entries;
+  if (ap_idx->duration_ms < 0
+      && a_time_ms > p_entries[ap_idx->count - 1].time_ms
+                       + (OMX_S64) ap_idx->interval_ms)
+    {
+      return false;
+    }
+
+  /* Last entry at or before a_time_ms; the first one if there is none */
+  hi = ap_idx->count;
+  while (hi - lo > 1)
+    {
+      const OMX_U32 mid = lo + (hi - lo) / 2;
+      if (p_entries[mid].time_ms <= a_time_ms)
+        {
+          lo = mid;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  *ap_entry_ms = p_entries[lo].time_ms;
+  *ap_offset = p_entries[lo].offset;
+  return true;
+}
+
+OMX_S64
+oggdmux_idx_duration (const oggdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  return ap_idx->duration_ms;
+}
+
+OMX_U32
+oggdmux_idx_count (const oggdmux_idx_t * ap_idx)
+{
+  assert (ap_idx);
+  return ap_idx->count;
+}
+
+OMX_ERRORTYPE
+oggdmux_idx_save (oggdmux_idx_t * ap_idx)
+{
+  oggdmux_idx_file_hdr_t hdr;
+  char dir[PATH_MAX];
+  char tmp_path[PATH_MAX];
+  FILE * p_file = NULL;
+  bool written = false;
+
+  assert (ap_idx);
+
+  if (!ap_idx->dirty || !ap_idx->p_cache_path || 0 == ap_idx->count)
+    {
+      return OMX_ErrorNone;
+    }
+
+  if (!cache_dir (dir, sizeof (dir)) || !make_dir (dir)
+      || strlen (dir) + sizeof (OGGDMUX_IDX_DIR) > sizeof (dir))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+  strcat (dir, OGGDMUX_IDX_DIR);
+  if (!make_dir (dir))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  /* Written aside and renamed, so that readers never see a partial index */
+  if ((size_t) snprintf (tmp_path, sizeof (tmp_path), "%s.%ld",
+                         ap_idx->p_cache_path, (long) getpid ())
+        >= sizeof (tmp_path)
+      || !(p_file = fopen (tmp_path, "w")))
+    {
+      return OMX_ErrorInsufficientResources;
+    }
+
+  memset (&hdr, 0, sizeof (hdr));
+  memcpy (hdr.magic, OGGDMUX_IDX_MAGIC, sizeof (hdr.magic));
+  hdr.version = OGGDMUX_IDX_VERSION;
+  hdr.count = ap_idx->count;
+  hdr.mtime_ns = ap_idx->mtime_ns;
+  hdr.size = ap_idx->size;
+  hdr.duration_ms = ap_idx->duration_ms;
+  hdr.serialno = ap_idx->serialno;
+
+  written = 1 == fwrite (&hdr, sizeof (hdr), 1, p_file)
+            && ap_idx->count == fwrite (ap_idx->p_entries,
+                                        sizeof (oggdmux_idx_entry_t),
+                                        ap_idx->count, p_file);
+  written = (0 == fclose (p_file)) && written;
+
+  if (!written || 0 != rename (tmp_path, ap_idx->p_cache_path))
+    {
+      (void) unlink (tmp_path);
+      return OMX_ErrorInsufficientResources;
+    }
+
+  ap_idx->dirty = false;
+  return OMX_ErrorNone;
+}
@@ -0,0 +1,91 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   oggdmuxidx.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - OGG demuxer seek index
+ *
+ * A sorted table of (time, byte offset) pairs for one logical stream of an
+ * Ogg file. Each entry gives the offset of the first page that follows a page
+ * ending at that time. Entries are only appended while the file is read
+ * contiguously from the beginning, so the index always covers the file from
+ * offset 0 up to its last entry. The table is persisted in the user's cache
+ * directory, next to the player's probe cache, and reused while the file's
+ * size and modification time stay the same.
+ */
+
+#ifndef OGGDMUXIDX_H
+#define OGGDMUXIDX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+
+#include <OMX_Core.h>
+#include <OMX_Types.h>
+
+typedef struct oggdmux_idx oggdmux_idx_t;
+
+/* Creates an empty index for the stream with the given serial number of the
+ * file at ap_path, and fills it from the cache when there is a valid cached
+ * copy. */
+OMX_ERRORTYPE
+oggdmux_idx_init (oggdmux_idx_t ** app_idx, const char * ap_path,
+                  const long a_serialno, const OMX_U32 a_interval_ms);
+
+void
+oggdmux_idx_destroy (oggdmux_idx_t * ap_idx);
+
+/* Records that the page ending at a_time_ms is followed by a page that starts
+ * at a_offset. Ignored unless a_offset is beyond the last entry and the entry
+ * would be at least the index's interval away from it. */
+void
+oggdmux_idx_add (oggdmux_idx_t * ap_idx, const OMX_S64 a_time_ms,
+                 const OMX_S64 a_offset);
+
+/* Marks the index as covering the whole file. */
+void
+oggdmux_idx_complete (oggdmux_idx_t * ap_idx, const OMX_S64 a_duration_ms);
+
+/* Looks up the last entry at or before a_time_ms. Returns false when the
+ * index does not extend that far yet. */
+bool
+oggdmux_idx_lookup (const oggdmux_idx_t * ap_idx, const OMX_S64 a_time_ms,
+                    OMX_S64 * ap_entry_ms, OMX_S64 * ap_offset);
+
+/* Returns the duration in milliseconds, or -1 if the index is not complete. */
+OMX_S64
+oggdmux_idx_duration (const oggdmux_idx_t * ap_idx);
+
+OMX_U32
+oggdmux_idx_count (const oggdmux_idx_t * ap_idx);
+
+/* Writes the index to the cache, if it has changed since it was loaded. */
+OMX_ERRORTYPE
+oggdmux_idx_save (oggdmux_idx_t * ap_idx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OGGDMUXIDX_H */
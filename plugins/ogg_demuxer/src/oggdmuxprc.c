@@ -35,6 +35,7 @@
 #include <errno.h>
 #include <unistd.h>
 #include <limits.h>
+#include <strings.h>
 
 #include <tizplatform.h>
 
@@ -74,6 +75,15 @@ static int g_total_released = 0;
 static OMX_ERRORTYPE
 oggdmux_prc_deallocate_resources (void *);
 
+static bool
+seek_index_enabled (void)
+{
+  const char * p_value = tiz_rcfile_get_value (
+    TIZ_RCFILE_PLUGINS_DATA_SECTION,
+    ARATELIA_OGG_DEMUXER_COMPONENT_NAME ".seek_index");
+  return !(p_value && 0 == strcasecmp (p_value, "false"));
+}
+
 static inline bool
 is_audio_content (const OggzStreamContent content)
 {
@@ -235,7 +245,10 @@ alloc_oggz (oggdmux_prc_t * ap_prc)
   assert (!ap_prc->p_oggz_);
 
   /* Allocate the oggz object */
-  tiz_check_null_ret_oom ((ap_prc->p_oggz_ = oggz_new (OGGZ_READ)));
+  /* OGGZ_AUTO sets up the granule rates needed to translate granulepos to
+   * time */
+  tiz_check_null_ret_oom (
+    (ap_prc->p_oggz_ = oggz_new (OGGZ_READ | OGGZ_AUTO)));
 
   /* Allocate a table */
   tiz_check_null_ret_oom ((ap_prc->p_tracks_ = oggz_table_new ()));
@@ -832,6 +845,96 @@ do_flush (oggdmux_prc_t * ap_prc)
   return release_all_buffers (ap_prc, OMX_ALL);
 }
 
+static OMX_S64
+page_time_ms (oggdmux_prc_t * ap_prc, const ogg_page * ap_og,
+              const long a_serialno)
+{
+  ogg_int64_t granulepos = ogg_page_granulepos (ap_og);
+  ogg_int64_t rate_n = 0;
+  ogg_int64_t rate_d = 0;
+  int shift = 0;
+
+  if (granulepos < 0
+      || 0 != oggz_get_granulerate (ap_prc->p_oggz_, a_serialno, &rate_n,
+                                    &rate_d)
+      || rate_n <= 0)
+    {
+      /* No packet ends in this page, or the stream has no time base */
+      return -1;
+    }
+
+  if ((shift = oggz_get_granuleshift (ap_prc->p_oggz_, a_serialno)) > 0)
+    {
+      const ogg_int64_t iframe = granulepos >> shift;
+      granulepos = iframe + (granulepos - (iframe << shift));
+    }
+
+  return granulepos * 1000 * rate_d / rate_n;
+}
+
+/* Keeps track of the byte offset of the next page, for as long as it is
+ * known, and of the time of the indexed stream, and feeds both to the seek
+ * index. */
+static void
+index_page (oggdmux_prc_t * ap_prc, const ogg_page * ap_og,
+            const long a_serialno)
+{
+  OMX_S64 time_ms = -1;
+
+  assert (ap_prc);
+  assert (ap_og);
+
+  if (a_serialno == ap_prc->idx_serialno_
+      && (time_ms = page_time_ms (ap_prc, ap_og, a_serialno)) >= 0)
+    {
+      ap_prc->position_ms_ = time_ms;
+    }
+
+  if (ap_prc->idx_offset_ >= 0)
+    {
+      ap_prc->idx_offset_ += ap_og->header_len + ap_og->body_len;
+      if (time_ms >= 0 && ap_prc->p_idx_)
+        {
+          oggdmux_idx_add (ap_prc->p_idx_, time_ms, ap_prc->idx_offset_);
+        }
+    }
+}
+
+static void
+init_seek_index (oggdmux_prc_t * ap_prc, const long a_serialno)
+{
+  assert (ap_prc);
+
+  ap_prc->idx_serialno_ = a_serialno;
+  if (!ap_prc->p_idx_ && seek_index_enabled ())
+    {
+      if (OMX_ErrorNone
+          == oggdmux_idx_init (&(ap_prc->p_idx_),
+                               (const char *) ap_prc->p_uri_->contentURI,
+                               a_serialno,
+                               TIZ_OGG_DEMUXER_SEEK_INDEX_INTERVAL_MS))
+        {
+          TIZ_DEBUG (handleOf (ap_prc),
+                     "%010lu: seek index entries [%u] duration [%lld] ms",
+                     a_serialno, oggdmux_idx_count (ap_prc->p_idx_),
+                     (long long) oggdmux_idx_duration (ap_prc->p_idx_));
+        }
+    }
+}
+
+static void
+save_seek_index (oggdmux_prc_t * ap_prc)
+{
+  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  assert (ap_prc);
+  if (ap_prc->p_idx_
+      && OMX_ErrorNone != (rc = oggdmux_idx_save (ap_prc->p_idx_)))
+    {
+      TIZ_WARN (handleOf (ap_prc), "[%s] : Could not save the seek index",
+                tiz_err_to_str (rc));
+    }
+}
+
 static int
 read_page_normal (OGGZ * ap_oggz, const ogg_page * ap_og, long a_serialno,
                   void * ap_user_data)
@@ -839,6 +942,7 @@ read_page_normal (OGGZ * ap_oggz, const ogg_page * ap_og, long a_serialno,
   oggdmux_prc_t * p_prc = ap_user_data;
   TIZ_DEBUG (handleOf (p_prc), "serialno = [%d] : granule pos [%lld]",
              a_serialno, oggz_tell_granulepos (ap_oggz));
+  index_page (p_prc, ap_og, a_serialno);
   return OGGZ_CONTINUE;
 }
 
@@ -865,8 +969,17 @@ read_page_first_pass (OGGZ * ap_oggz, const ogg_page * ap_og, long a_serialno,
                      a_serialno);
           rc = OGGZ_STOP_ERR;
         }
+      else if (p_prc->idx_serialno_ < 0
+               && is_audio_content (
+                    oggz_stream_get_content (ap_oggz, a_serialno)))
+        {
+          /* The index follows the first audio stream */
+          init_seek_index (p_prc, a_serialno);
+        }
     }
 
+  index_page (p_prc, ap_og, a_serialno);
+
   if (oggz_get_bos (ap_oggz, ALL_OGG_STREAMS) == 0)
     {
       TIZ_TRACE (handleOf (p_prc), "Number of tracks [%d]",
@@ -892,6 +1005,51 @@ seek_to_byte_offset (oggdmux_prc_t * ap_prc, const oggz_off_t a_offset)
                  a_offset);
       return OMX_ErrorInsufficientResources;
     }
+  ap_prc->idx_offset_ = a_offset;
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+seek_to_time (oggdmux_prc_t * ap_prc, const OMX_S64 a_time_ms)
+{
+  OMX_S64 entry_ms = 0;
+  OMX_S64 offset = 0;
+  ogg_int64_t units = 0;
+
+  assert (ap_prc);
+
+  tiz_check_omx (do_flush (ap_prc));
+  ap_prc->file_eos_ = false;
+
+  if (ap_prc->p_idx_
+      && oggdmux_idx_lookup (ap_prc->p_idx_, a_time_ms, &entry_ms, &offset))
+    {
+      TIZ_DEBUG (handleOf (ap_prc),
+                 "[%lld] ms : indexed page at [%lld] ms offset [%lld]",
+                 (long long) a_time_ms, (long long) entry_ms,
+                 (long long) offset);
+      tiz_check_omx (seek_to_byte_offset (ap_prc, offset));
+      ap_prc->position_ms_ = entry_ms;
+      return OMX_ErrorNone;
+    }
+
+  /* Not indexed yet; have liboggz bisect the file. The offset of the page
+   * where this lands is unknown, so the index stops growing until the next
+   * indexed seek. */
+  ap_prc->aud_eos_ = false;
+  ap_prc->vid_eos_ = false;
+  ap_prc->idx_offset_ = -1;
+  if ((units = oggz_seek_units (ap_prc->p_oggz_, a_time_ms, SEEK_SET)) < 0)
+    {
+      TIZ_ERROR (handleOf (ap_prc),
+                 "[OMX_ErrorUnsupportedSetting] : "
+                 "Could not seek to [%lld] ms",
+                 (long long) a_time_ms);
+      return OMX_ErrorUnsupportedSetting;
+    }
+  TIZ_DEBUG (handleOf (ap_prc), "[%lld] ms : bisected to [%lld] ms",
+             (long long) a_time_ms, (long long) units);
+  ap_prc->position_ms_ = units;
   return OMX_ErrorNone;
 }
 
@@ -949,6 +1107,7 @@ obtain_tracks (oggdmux_prc_t * ap_prc)
   /* Seek to beginning of file and set the normal callback (no-op function) */
   tiz_check_omx (seek_to_byte_offset (p_prc, 0));
   tiz_check_omx (set_read_page_callback (p_prc, read_page_normal));
+  p_prc->position_ms_ = 0;
 
   return OMX_ErrorNone;
 }
@@ -1048,6 +1207,11 @@ demux_file (oggdmux_prc_t * ap_prc)
     {
       int remaining = 0;
       ap_prc->file_eos_ = true;
+      if (ap_prc->p_idx_ && ap_prc->idx_offset_ >= 0)
+        {
+          /* Every page since the beginning of the file has been seen */
+          oggdmux_idx_complete (ap_prc->p_idx_, ap_prc->position_ms_);
+        }
       /* Try to empty the temp stores out to an omx buffer */
       remaining = flush_stores (ap_prc);
       TIZ_TRACE (handleOf (ap_prc),
@@ -1101,6 +1265,13 @@ oggdmux_prc_ctor (void * ap_obj, va_list * app)
   p_prc->vid_eos_ = false;
   p_prc->aud_port_disabled_ = false;
   p_prc->vid_port_disabled_ = false;
+  p_prc->p_idx_ = NULL;
+  p_prc->idx_serialno_ = -1;
+  p_prc->idx_offset_ = -1;
+  p_prc->position_ms_ = 0;
+  p_prc->pending_seek_ms_ = -1;
+  p_prc->seek_mode_ = OMX_TIME_SeekModeFast;
+  p_prc->stopped_ = true;
 
   return p_prc;
 }
@@ -1132,6 +1303,10 @@ oggdmux_prc_deallocate_resources (void * ap_obj)
 {
   oggdmux_prc_t * p_prc = ap_obj;
   assert (p_prc);
+  save_seek_index (p_prc);
+  oggdmux_idx_destroy (p_prc->p_idx_);
+  p_prc->p_idx_ = NULL;
+  p_prc->idx_serialno_ = -1;
   dealloc_oggz (p_prc);
   dealloc_data_stores (p_prc);
   dealloc_file (p_prc);
@@ -1146,6 +1321,13 @@ oggdmux_prc_prepare_to_transfer (void * ap_obj, OMX_U32 a_pid)
   assert (p_prc);
   tiz_check_omx (obtain_tracks (p_prc));
   tiz_check_omx (set_read_packet_callbacks (p_prc));
+  p_prc->stopped_ = false;
+  if (p_prc->pending_seek_ms_ >= 0)
+    {
+      const OMX_S64 seek_ms = p_prc->pending_seek_ms_;
+      p_prc->pending_seek_ms_ = -1;
+      tiz_check_omx (seek_to_time (p_prc, seek_ms));
+    }
   return OMX_ErrorNone;
 }
 
@@ -1164,6 +1346,8 @@ oggdmux_prc_stop_and_return (void * ap_obj)
   p_prc->aud_eos_ = false;
   p_prc->vid_eos_ = false;
   p_prc->file_eos_ = false;
+  p_prc->stopped_ = true;
+  save_seek_index (p_prc);
   TIZ_TRACE (handleOf (p_prc), "stop_and_return");
   return do_flush (p_prc);
 }
@@ -1241,6 +1425,77 @@ oggdmux_prc_port_enable (const void * ap_obj, OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+/*
+ * from tiz_api
+ */
+
+static OMX_ERRORTYPE
+oggdmux_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                       OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  oggdmux_prc_t * p_prc = (oggdmux_prc_t *) ap_obj;
+  assert (p_prc);
+  assert (ap_struct);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      OMX_TIME_CONFIG_TIMESTAMPTYPE * p_pos = ap_struct;
+      p_pos->nTimestamp = (p_prc->pending_seek_ms_ >= 0
+                             ? p_prc->pending_seek_ms_
+                             : p_prc->position_ms_)
+                          * 1000;
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      OMX_TIME_CONFIG_SEEKMODETYPE * p_mode = ap_struct;
+      p_mode->eType = p_prc->seek_mode_;
+    }
+  else if (OMX_TizoniaIndexConfigMediaDuration == a_index)
+    {
+      OMX_TIZONIA_MEDIADURATIONTYPE * p_duration = ap_struct;
+      const OMX_S64 duration_ms
+        = p_prc->p_idx_ ? oggdmux_idx_duration (p_prc->p_idx_) : -1;
+      p_duration->nDuration = duration_ms >= 0 ? duration_ms * 1000 : -1;
+    }
+  else
+    {
+      return super_GetConfig (typeOf (ap_obj, "oggdmuxprc"), ap_obj, ap_hdl,
+                              a_index, ap_struct);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+oggdmux_prc_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                       OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  oggdmux_prc_t * p_prc = (oggdmux_prc_t *) ap_obj;
+  assert (p_prc);
+  assert (ap_struct);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      const OMX_TIME_CONFIG_TIMESTAMPTYPE * p_pos = ap_struct;
+      const OMX_S64 time_ms
+        = p_pos->nTimestamp > 0 ? p_pos->nTimestamp / 1000 : 0;
+      if (p_prc->stopped_)
+        {
+          /* Applied once the tracks have been discovered */
+          p_prc->pending_seek_ms_ = time_ms;
+          return OMX_ErrorNone;
+        }
+      return seek_to_time (p_prc, time_ms);
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      const OMX_TIME_CONFIG_SEEKMODETYPE * p_mode = ap_struct;
+      p_prc->seek_mode_ = p_mode->eType;
+      return OMX_ErrorNone;
+    }
+  return super_SetConfig (typeOf (ap_obj, "oggdmuxprc"), ap_obj, ap_hdl,
+                          a_index, ap_struct);
+}
+
 /*
  * oggdmux_prc_class
  */
@@ -1305,6 +1560,10 @@ oggdmux_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_enable, oggdmux_prc_port_enable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_buffers_ready, oggdmux_prc_buffers_ready,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, oggdmux_prc_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, oggdmux_prc_SetConfig,
      /* TIZ_CLASS_COMMENT: stop value*/
      0);
 
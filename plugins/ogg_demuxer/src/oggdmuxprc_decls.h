@@ -38,6 +38,8 @@ extern "C" {
 
 #include <tizprc_decls.h>
 
+#include "oggdmuxidx.h"
+
 typedef struct oggdmux_prc oggdmux_prc_t;
 struct oggdmux_prc
 {
@@ -63,6 +65,13 @@ struct oggdmux_prc
   bool vid_eos_;
   bool aud_port_disabled_;
   bool vid_port_disabled_;
+  oggdmux_idx_t * p_idx_;
+  long idx_serialno_;
+  OMX_S64 idx_offset_;
+  OMX_S64 position_ms_;
+  OMX_S64 pending_seek_ms_;
+  OMX_TIME_SEEKMODETYPE seek_mode_;
+  bool stopped_;
 };
 
 typedef struct oggdmux_prc_class oggdmux_prc_class_t;
@@ -33,7 +33,6 @@
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
-#include <math.h>
 
 #include <tizplatform.h>
 
@@ -44,20 +43,6 @@
 #include "opusdprc.h"
 #include "opusdprc_decls.h"
 
-#ifdef HAVE_LRINTF
-#define float2int(x) lrintf (x)
-#else
-#define float2int(flt) ((int) (floor (.5 + flt)))
-#endif
-
-#ifndef HAVE_FMINF
-#define fminf(_x, _y) ((_x) < (_y) ? (_x) : (_y))
-#endif
-
-#ifndef HAVE_FMAXF
-#define fmaxf(_x, _y) ((_x) > (_y) ? (_x) : (_y))
-#endif
-
 #ifdef TIZ_LOG_CATEGORY_NAME
 #undef TIZ_LOG_CATEGORY_NAME
 #define TIZ_LOG_CATEGORY_NAME "tiz.opus_decoder.prc"
@@ -262,6 +247,23 @@ update_pcm_mode (opusd_prc_t * ap_prc, const OMX_U32 a_samplerate,
   return OMX_ErrorNone;
 }
 
+static OMX_ERRORTYPE
+init_pcm_converter (opusd_prc_t * ap_prc)
+{
+  assert (ap_prc);
+  tiz_pcm_conv_destroy (ap_prc->p_pcm_conv_);
+  ap_prc->p_pcm_conv_ = NULL;
+  /* The decoded floats are requantized to 16-bit, in the host's byte order.
+     Dither is off unless enabled in the rc file. */
+  return tiz_pcm_conv_init (
+    &(ap_prc->p_pcm_conv_), ETIZPcmInFloat32, 0, ETIZPcmOutS16,
+    TIZ_PCM_NATIVE_ENDIAN, ap_prc->channels_,
+    tiz_pcm_dither_from_str (
+      tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            "OMX.Aratelia.audio_decoder.opus.dither"),
+      ETIZPcmDitherNone));
+}
+
 static OMX_ERRORTYPE
 init_opus_decoder (opusd_prc_t * ap_prc)
 {
@@ -318,6 +320,7 @@ init_opus_decoder (opusd_prc_t * ap_prc)
 
     store_stream_metadata (ap_prc);
     (void) update_pcm_mode (ap_prc, ap_prc->rate_, ap_prc->channels_);
+    tiz_check_omx (init_pcm_converter (ap_prc));
 
     p_in->nOffset += header_offset;
     p_in->nFilledLen -= header_offset;
@@ -424,7 +427,6 @@ transform_buffer (opusd_prc_t * ap_prc)
     float * output = NULL;
     short * out = NULL;
     unsigned out_len = 0;
-    int i = 0;
     int tmp_skip = 0;
     int frame_size = opus_multistream_decode_float (ap_prc->p_opus_dec_, p_data,
                                                     len, ap_prc->p_out_buf_,
@@ -446,11 +448,7 @@ transform_buffer (opusd_prc_t * ap_prc)
 
         /* Convert to short and save to output file */
         out = (short *) (p_out->pBuffer + p_out->nOffset);
-        for (i = 0; i < (int) out_len * ap_prc->channels_; ++i)
-          {
-            out[i] = (short) float2int (
-              fmaxf (-32768, fminf (output[i] * 32768.f, 32767)));
-          }
+        tiz_pcm_conv_interleaved (ap_prc->p_pcm_conv_, output, out_len, out);
 
         if ((p_in->nFlags & OMX_BUFFERFLAG_EOS) > 0)
           {
@@ -548,6 +546,7 @@ opusd_prc_ctor (void * ap_obj, va_list * app)
   p_prc->p_in_hdr_ = NULL;
   p_prc->p_out_hdr_ = NULL;
   p_prc->p_out_buf_ = NULL;
+  p_prc->p_pcm_conv_ = NULL;
   reset_stream_parameters (p_prc);
   p_prc->in_port_disabled_ = false;
   p_prc->out_port_disabled_ = false;
@@ -583,6 +582,8 @@ opusd_prc_deallocate_resources (void * ap_obj)
       opus_multistream_decoder_destroy (p_prc->p_opus_dec_);
       p_prc->p_opus_dec_ = NULL;
     }
+  tiz_pcm_conv_destroy (p_prc->p_pcm_conv_);
+  p_prc->p_pcm_conv_ = NULL;
   deallocate_output_buffer (p_prc);
   return OMX_ErrorNone;
 }
@@ -37,6 +37,8 @@ extern "C" {
 #include <opus.h>
 #include <opus_multistream.h>
 
+#include <tizplatform.h>
+
 #include <tizprc_decls.h>
 
 typedef struct opusd_prc opusd_prc_t;
@@ -49,6 +51,7 @@ struct opusd_prc
   OMX_BUFFERHEADERTYPE * p_out_hdr_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   float * p_out_buf_;
+  tiz_pcm_conv_t * p_pcm_conv_;
   opus_int64 packet_count_;
   int rate_;
   int mapping_family_;
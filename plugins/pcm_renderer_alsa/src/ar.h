@@ -56,7 +56,11 @@ extern "C"
   ARATELIA_AUDIO_RENDERER_NULL_ALSA_DEVICE
 #define ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_MIXER  "Master"
 
-#define ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT 20
+/* Length of the fade-in applied when the renderer starts processing, if
+   enabled */
+#define ARATELIA_AUDIO_RENDERER_RAMP_DURATION_MS 4000
+/* Length of the ramp used to move to a new software volume level */
+#define ARATELIA_AUDIO_RENDERER_VOLUME_CHANGE_MS 20
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   argain.c
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA audio renderer's software gain stage
+ *
+ * Constant gains on S16 and float samples go through the tizpcm kernels
+ * (selected at run time); ramps are applied frame by frame.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <assert.h>
+#include <math.h>
+
+#include <tizplatform.h>
+
+#include "argain.h"
+
+#define AR_GAIN_S24_MAX 8388607
+#define AR_GAIN_S24_MIN (-8388608)
+
+static inline int32_t clamp_to_range (const float a_val, const float a_min,
+                                      const float a_max)
+{
+  float v = a_val < a_min ? a_min : (a_val > a_max ? a_max : a_val);
+  return (int32_t)lrintf (v);
+}
+
+static inline int32_t read_s24 (const uint8_t *ap_sample)
+{
+  int32_t v = ap_sample[0] | (ap_sample[1] << 8) | (ap_sample[2] << 16);
+  return (v ^ 0x800000) - 0x800000; /* sign-extend */
+}
+
+static inline void write_s24 (uint8_t *ap_sample, const int32_t a_val)
+{
+  ap_sample[0] = (uint8_t)(a_val & 0xff);
+  ap_sample[1] = (uint8_t)((a_val >> 8) & 0xff);
+  ap_sample[2] = (uint8_t)((a_val >> 16) & 0xff);
+}
+
+static inline void scale_sample (const ar_gain_format_t a_format,
+                                 uint8_t *ap_sample, const float a_gain)
+{
+  switch (a_format)
+    {
+      case AR_GAIN_FORMAT_S16:
+        {
+          int16_t *p_s = (int16_t *)ap_sample;
+          *p_s = (int16_t)clamp_to_range (*p_s * a_gain, -32768.f, 32767.f);
+        }
+        break;
+      case AR_GAIN_FORMAT_S24:
+        {
+          write_s24 (ap_sample,
+                     clamp_to_range (read_s24 (ap_sample) * a_gain,
+                                     AR_GAIN_S24_MIN, AR_GAIN_S24_MAX));
+        }
+        break;
+      case AR_GAIN_FORMAT_S32:
+        {
+          int32_t *p_s = (int32_t *)ap_sample;
+          double v = (double)*p_s * a_gain;
+          v = v < -2147483648.0 ? -2147483648.0
+                                : (v > 2147483647.0 ? 2147483647.0 : v);
+          *p_s = (int32_t)lrint (v);
+        }
+        break;
+      case AR_GAIN_FORMAT_FLOAT:
+        {
+          float *p_s = (float *)ap_sample;
+          *p_s *= a_gain;
+        }
+        break;
+      default:
+        break;
+    };
+}
+
+static size_t sample_size (const ar_gain_format_t a_format)
+{
+  switch (a_format)
+    {
+      case AR_GAIN_FORMAT_S16:
+        return 2;
+      case AR_GAIN_FORMAT_S24:
+        return 3;
+      default:
+        return 4;
+    };
+}
+
+static void apply_constant (const ar_gain_format_t a_format, uint8_t *ap_pcm,
+                            size_t a_samples, const float a_gain)
+{
+  switch (a_format)
+    {
+      case AR_GAIN_FORMAT_S16:
+        {
+          tiz_pcm_gain_s16 ((int16_t *)ap_pcm, a_samples, a_gain);
+        }
+        break;
+      case AR_GAIN_FORMAT_FLOAT:
+        {
+          tiz_pcm_gain_float ((float *)ap_pcm, a_samples, a_gain);
+        }
+        break;
+      default:
+        {
+          const size_t size = sample_size (a_format);
+          for (; a_samples > 0; --a_samples, ap_pcm += size)
+            {
+              scale_sample (a_format, ap_pcm, a_gain);
+            }
+        }
+        break;
+    };
+}
+
+void ar_gain_init (ar_gain_t *ap_gain, const float a_gain)
+{
+  assert (ap_gain);
+  ap_gain->current = a_gain;
+  ap_gain->target = a_gain;
+  ap_gain->step = 0.f;
+  ap_gain->ramp_frames = 0;
+}
+
+void ar_gain_set (ar_gain_t *ap_gain, const float a_target,
+                  const uint32_t a_ramp_frames)
+{
+  assert (ap_gain);
+  ap_gain->target = a_target;
+  if (0 == a_ramp_frames || a_target == ap_gain->current)
+    {
+      ap_gain->current = a_target;
+      ap_gain->step = 0.f;
+      ap_gain->ramp_frames = 0;
+    }
+  else
+    {
+      ap_gain->step = (a_target - ap_gain->current) / (float)a_ramp_frames;
+      ap_gain->ramp_frames = a_ramp_frames;
+    }
+}
+
+bool ar_gain_is_unity (const ar_gain_t *ap_gain)
+{
+  assert (ap_gain);
+  return (0 == ap_gain->ramp_frames && 1.f == ap_gain->current);
+}
+
+void ar_gain_apply (ar_gain_t *ap_gain, const ar_gain_format_t a_format,
+                    void *ap_buf, const size_t a_frames,
+                    const unsigned int a_channels)
+{
+  uint8_t *p_pcm = ap_buf;
+  size_t frames = a_frames;
+  const size_t size = sample_size (a_format);
+
+  assert (ap_gain);
+  assert (ap_buf);
+
+  if (AR_GAIN_FORMAT_UNSUPPORTED == a_format || ar_gain_is_unity (ap_gain))
+    {
+      return;
+    }
+
+  /* The ramp, if any, moves one step per frame */
+  while (ap_gain->ramp_frames > 0 && frames > 0)
+    {
+      unsigned int ch = 0;
+      ap_gain->current += ap_gain->step;
+      if (0 == --ap_gain->ramp_frames)
+        {
+          ap_gain->current = ap_gain->target;
+        }
+      for (ch = 0; ch < a_channels; ++ch, p_pcm += size)
+        {
+          scale_sample (a_format, p_pcm, ap_gain->current);
+        }
+      --frames;
+    }
+
+  if (frames > 0 && 1.f != ap_gain->current)
+    {
+      apply_constant (a_format, p_pcm, frames * a_channels, ap_gain->current);
+    }
+}
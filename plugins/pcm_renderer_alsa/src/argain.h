@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2011-2017 Aratelia Limited - Juan A. Rubio
+ *
+ * This file is part of Tizonia
+ *
+ * Tizonia is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * Tizonia is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with Tizonia.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file   argain.h
+ * @author Juan A. Rubio <juan.rubio@aratelia.com>
+ *
+ * @brief  Tizonia - ALSA audio renderer's software gain stage
+ *
+ *
+ */
+#ifndef ARGAIN_H
+#define ARGAIN_H
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+  typedef enum ar_gain_format
+  {
+    AR_GAIN_FORMAT_S16,
+    AR_GAIN_FORMAT_S24, /* packed, 3 bytes per sample */
+    AR_GAIN_FORMAT_S32,
+    AR_GAIN_FORMAT_FLOAT,
+    AR_GAIN_FORMAT_UNSUPPORTED
+  } ar_gain_format_t;
+
+  /* A linear gain that moves towards a target gain, one frame at a time */
+  typedef struct ar_gain ar_gain_t;
+  struct ar_gain
+  {
+    float current;
+    float target;
+    float step;            /* per frame */
+    uint32_t ramp_frames;  /* frames left until current reaches target */
+  };
+
+  void ar_gain_init (ar_gain_t *ap_gain, const float a_gain);
+
+  /* Moves to a_target over a_ramp_frames frames (immediately if 0) */
+  void ar_gain_set (ar_gain_t *ap_gain, const float a_target,
+                    const uint32_t a_ramp_frames);
+
+  /* True when applying the gain would not modify the samples */
+  bool ar_gain_is_unity (const ar_gain_t *ap_gain);
+
+  /* Applies the gain in-place to a_frames interleaved frames of native
+     endianness samples */
+  void ar_gain_apply (ar_gain_t *ap_gain, const ar_gain_format_t a_format,
+                      void *ap_buf, const size_t a_frames,
+                      const unsigned int a_channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif                          /* ARGAIN_H */
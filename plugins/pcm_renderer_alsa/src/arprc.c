@@ -331,6 +331,13 @@ static OMX_ERRORTYPE retrieve_alsa_pcm_format (
              : ARATELIA_AUDIO_RENDERER_DEFAULT_ALSA_MIXER;
 }
 
+static bool get_bool_config_value (const char *ap_key, const bool a_default)
+{
+  const char *p_value
+      = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION, ap_key);
+  return p_value ? (0 == strncmp (p_value, "true", 4)) : a_default;
+}
+
 static bool using_null_alsa_device (ar_prc_t *ap_prc)
 {
   return (0 == strncmp (get_alsa_device (ap_prc),
@@ -370,6 +377,7 @@ static OMX_ERRORTYPE release_header (ar_prc_t *ap_prc)
   if (ap_prc->p_inhdr_)
     {
       ap_prc->p_inhdr_->nOffset = 0;
+      ap_prc->hdr_processed_ = false;
       tiz_check_omx (tiz_krn_release_buffer (
           tiz_get_krn (handleOf (ap_prc)), ARATELIA_AUDIO_RENDERER_PORT_INDEX,
           ap_prc->p_inhdr_));
@@ -391,55 +399,6 @@ static inline OMX_ERRORTYPE do_flush (ar_prc_t *ap_prc)
   return release_header (ap_prc);
 }
 
-static float sint_to_float (const int a_sample)
-{
-  float f;
-  if (a_sample >= 0)
-    f = a_sample / 32767.0;
-  else
-    f = a_sample / 32768.0;
-  return f;
-}
-
-static int float_to_sint (const float a_sample)
-{
-  float f;
-  f = a_sample * 32767;
-  if (f < -32768)
-    f = -32768;
-  if (f > 32767)
-    f = 32767;
-  return (int)f;
-}
-
-static void adjust_gain (const ar_prc_t *ap_prc, OMX_BUFFERHEADERTYPE *ap_hdr,
-                         const snd_pcm_uframes_t a_samples_per_channel)
-{
-  assert (ap_prc);
-  assert (ap_hdr);
-
-  if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE != ap_prc->gain_)
-    {
-      int i;
-      int gainadj = (int)(ap_prc->gain_ * 256.);
-      float gain = pow (10., gainadj / 5120.);
-      /*       gain = 3.1f; */
-      /*       fprintf (stderr, "%f samples %ld\n", gain, a_samples_per_channel); */
-      OMX_S16 *pcm = (OMX_S16 *)(ap_hdr->pBuffer + ap_hdr->nOffset);
-      for (i = 0; i < a_samples_per_channel; i++)
-        {
-          float f = sint_to_float (*pcm);
-          f *= gain;
-          int v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-          f = sint_to_float (*pcm);
-          f *= gain;
-          v = float_to_sint (f);
-          *(pcm++) = (v > 32767) ? 32767 : ((v < -32768) ? -32768 : v);
-        }
-    }
-}
-
 static void swap_byte_order_s16 (const ar_prc_t *ap_prc, OMX_BUFFERHEADERTYPE *ap_hdr,
                                  const int a_samples)
 {
@@ -491,6 +450,72 @@ static void swap_byte_order (const ar_prc_t *ap_prc,
     }
 }
 
+static ar_gain_format_t get_gain_format (const ar_prc_t *ap_prc)
+{
+  bool little_endian = (OMX_EndianLittle == ap_prc->pcmmode.eEndian);
+
+  assert (ap_prc);
+
+  /* The gain stage runs after swap_byte_order, on native samples only */
+  if (ap_prc->swap_byte_order_ && 16 == ap_prc->pcmmode.nBitPerSample)
+    {
+      little_endian = !little_endian;
+    }
+
+  if (little_endian != (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+      || OMX_NumericalDataSigned != ap_prc->pcmmode.eNumData)
+    {
+      return AR_GAIN_FORMAT_UNSUPPORTED;
+    }
+
+  switch (ap_prc->pcmmode.nBitPerSample)
+    {
+      case 16:
+        return AR_GAIN_FORMAT_S16;
+      case 24:
+        return AR_GAIN_FORMAT_S24;
+      case 32:
+        /* See retrieve_alsa_pcm_format: 32-bit streams are float */
+        return AR_GAIN_FORMAT_FLOAT;
+      default:
+        return AR_GAIN_FORMAT_UNSUPPORTED;
+    };
+}
+
+/* The configured gain, plus the volume and mute state when these are handled
+   in software */
+static float get_target_gain (const ar_prc_t *ap_prc)
+{
+  float gain = 1.f;
+
+  assert (ap_prc);
+
+  if (ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE != ap_prc->gain_)
+    {
+      gain = powf (10.f, ap_prc->gain_ / 20.f);
+    }
+
+  if (ap_prc->software_volume_)
+    {
+      const float vol = ap_prc->muted_
+                            ? 0.f
+                            : (float)ap_prc->volume_
+                                  / ARATELIA_AUDIO_RENDERER_MAX_VOLUME_VALUE;
+      /* A cubic taper is a good approximation of perceived loudness */
+      gain *= vol * vol * vol;
+    }
+
+  return gain;
+}
+
+static void update_gain (ar_prc_t *ap_prc, const uint32_t a_ramp_ms)
+{
+  assert (ap_prc);
+  ar_gain_set (&(ap_prc->gain_stage_), get_target_gain (ap_prc),
+               (uint32_t)((uint64_t)ap_prc->pcmmode.nSamplingRate * a_ramp_ms
+                          / 1000));
+}
+
 static OMX_ERRORTYPE get_alsa_master_volume (ar_prc_t *ap_prc,
                                              long *ap_volume)
 {
@@ -554,7 +579,16 @@ static OMX_ERRORTYPE set_initial_component_volume (ar_prc_t *ap_prc)
 
   if (!using_null_alsa_device (ap_prc))
     {
-      tiz_check_omx (get_alsa_master_volume (ap_prc, &(ap_prc->volume_)));
+      if (!ap_prc->software_volume_
+          && OMX_ErrorNone
+                 != get_alsa_master_volume (ap_prc, &(ap_prc->volume_)))
+        {
+          /* No usable mixer element on this device (common with hw:
+             devices); fall back to software volume */
+          TIZ_NOTICE (handleOf (ap_prc),
+                      "ALSA mixer not available; using software volume");
+          ap_prc->software_volume_ = true;
+        }
 
       TIZ_INIT_OMX_PORT_STRUCT (volume, ARATELIA_AUDIO_RENDERER_PORT_INDEX);
       tiz_check_omx (
@@ -621,7 +655,12 @@ static void toggle_mute (ar_prc_t *ap_prc, const bool a_mute)
 {
   assert (ap_prc);
 
-  if (!using_null_alsa_device (ap_prc))
+  if (ap_prc->software_volume_)
+    {
+      ap_prc->muted_ = a_mute;
+      update_gain (ap_prc, ARATELIA_AUDIO_RENDERER_VOLUME_CHANGE_MS);
+    }
+  else if (!using_null_alsa_device (ap_prc))
     {
       long new_volume = (a_mute ? 0 : ap_prc->volume_);
       TIZ_TRACE (handleOf (ap_prc), "new volume = %ld - ap_prc->volume_ [%d]",
@@ -632,11 +671,19 @@ static void toggle_mute (ar_prc_t *ap_prc, const bool a_mute)
 
 static void set_volume (ar_prc_t *ap_prc, const long a_volume)
 {
-  if (!using_null_alsa_device (ap_prc))
+  assert (ap_prc);
+
+  if (ap_prc->software_volume_)
+    {
+      ap_prc->volume_ = a_volume;
+      update_gain (ap_prc, ARATELIA_AUDIO_RENDERER_VOLUME_CHANGE_MS);
+      TIZ_TRACE (handleOf (ap_prc), "ap_prc->volume_ = %ld (software)",
+                 ap_prc->volume_);
+    }
+  else if (!using_null_alsa_device (ap_prc))
     {
       if (set_alsa_master_volume (ap_prc, a_volume))
         {
-          assert (ap_prc);
           ap_prc->volume_ = a_volume;
           TIZ_TRACE (handleOf (ap_prc), "ap_prc->volume_ = %ld",
                      ap_prc->volume_);
@@ -644,41 +691,18 @@ static void set_volume (ar_prc_t *ap_prc, const long a_volume)
     }
 }
 
-static void prepare_volume_ramp (ar_prc_t *ap_prc)
-{
-  assert (ap_prc);
-  if (ap_prc->ramp_enabled_)
-    {
-      ap_prc->ramp_volume_ = ARATELIA_AUDIO_RENDERER_DEFAULT_VOLUME_VALUE;
-      ap_prc->ramp_step_count_
-          = ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT;
-      ap_prc->ramp_step_ = (double)ap_prc->ramp_volume_
-                           / (double)ap_prc->ramp_step_count_;
-    }
-}
-
-static OMX_ERRORTYPE start_volume_ramp (ar_prc_t *ap_prc)
+static void start_volume_ramp (ar_prc_t *ap_prc)
 {
   assert (ap_prc);
   if (ap_prc->ramp_enabled_)
     {
-      assert (ap_prc->p_vol_ramp_timer_);
-      ap_prc->ramp_volume_ = 0;
-      tiz_check_omx (
-          tiz_srv_timer_watcher_start (ap_prc, ap_prc->p_vol_ramp_timer_, 0.2, 0.2));
+      /* Fade in from silence; the ramp advances with the frames rendered */
+      ar_gain_init (&(ap_prc->gain_stage_), 0.f);
+      update_gain (ap_prc, ARATELIA_AUDIO_RENDERER_RAMP_DURATION_MS);
     }
-  return OMX_ErrorNone;
-}
-
-static void stop_volume_ramp (ar_prc_t *ap_prc)
-{
-  assert (ap_prc);
-  if (ap_prc->ramp_enabled_)
+  else
     {
-      if (ap_prc->p_vol_ramp_timer_)
-        {
-          (void)tiz_srv_timer_watcher_stop (ap_prc, ap_prc->p_vol_ramp_timer_);
-        }
+      ar_gain_init (&(ap_prc->gain_stage_), get_target_gain (ap_prc));
     }
 }
 
@@ -712,24 +736,6 @@ static void stop_eos_timer (ar_prc_t *ap_prc)
     }
 }
 
-static OMX_ERRORTYPE apply_ramp_step (ar_prc_t *ap_prc)
-{
-  assert (ap_prc);
-  if (ap_prc->ramp_enabled_)
-    {
-      if (ap_prc->ramp_step_count_-- > 0)
-        {
-          ap_prc->ramp_volume_ += ap_prc->ramp_step_;
-          set_volume (ap_prc, ap_prc->ramp_volume_);
-        }
-      else
-        {
-          stop_volume_ramp (ap_prc);
-        }
-    }
-  return OMX_ErrorNone;
-}
-
 static OMX_ERRORTYPE render_buffer (ar_prc_t *ap_prc,
                                     OMX_BUFFERHEADERTYPE *ap_hdr)
 {
@@ -744,8 +750,16 @@ static OMX_ERRORTYPE render_buffer (ar_prc_t *ap_prc,
   assert (ap_hdr->nFilledLen > 0);
   samples_per_channel = ap_hdr->nFilledLen / step;
 
-  adjust_gain (ap_prc, ap_hdr, samples_per_channel);
-  swap_byte_order (ap_prc, ap_hdr);
+  if (!ap_prc->hdr_processed_)
+    {
+      /* A header may need several writes to be consumed; process its
+         samples only once */
+      swap_byte_order (ap_prc, ap_hdr);
+      ar_gain_apply (&(ap_prc->gain_stage_), ap_prc->gain_format_,
+                     ap_hdr->pBuffer + ap_hdr->nOffset, samples_per_channel,
+                     ap_prc->pcmmode.nChannels);
+      ap_prc->hdr_processed_ = true;
+    }
 
   while (samples_per_channel > 0 && OMX_ErrorNone == rc)
     {
@@ -877,7 +891,6 @@ static void *ar_prc_ctor (void *ap_prc, va_list *app)
   p_prc->descriptor_count_ = 0;
   p_prc->p_fds_ = NULL;
   p_prc->p_ev_io_ = NULL;
-  p_prc->p_vol_ramp_timer_ = NULL;
   p_prc->p_eos_timer_ = NULL;
   p_prc->p_inhdr_ = NULL;
   p_prc->port_disabled_ = false;
@@ -885,10 +898,14 @@ static void *ar_prc_ctor (void *ap_prc, va_list *app)
   p_prc->nflags_ = 0;
   p_prc->gain_ = ARATELIA_AUDIO_RENDERER_DEFAULT_GAIN_VALUE;
   p_prc->volume_ = ARATELIA_AUDIO_RENDERER_DEFAULT_VOLUME_VALUE;
-  p_prc->ramp_enabled_ = false;
-  p_prc->ramp_step_ = 0;
-  p_prc->ramp_step_count_ = ARATELIA_AUDIO_RENDERER_DEFAULT_RAMP_STEP_COUNT;
-  p_prc->ramp_volume_ = 0;
+  p_prc->ramp_enabled_ = get_bool_config_value (
+      "OMX.Aratelia.audio_renderer.alsa.pcm.volume_ramp", false);
+  p_prc->software_volume_ = get_bool_config_value (
+      "OMX.Aratelia.audio_renderer.alsa.pcm.software_volume", false);
+  p_prc->muted_ = false;
+  ar_gain_init (&(p_prc->gain_stage_), 1.f);
+  p_prc->gain_format_ = AR_GAIN_FORMAT_UNSUPPORTED;
+  p_prc->hdr_processed_ = false;
   return p_prc;
 }
 
@@ -939,13 +956,6 @@ static OMX_ERRORTYPE ar_prc_allocate_resources (void *ap_prc,
           = tiz_mem_alloc (sizeof(struct pollfd) * p_prc->descriptor_count_);
       tiz_check_null_ret_oom (p_prc->p_fds_ != NULL);
 
-      /* This is to generate volume ramps when needed */
-      if (p_prc->ramp_enabled_)
-        {
-          tiz_check_omx (
-              tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_vol_ramp_timer_)));
-        }
-
       /* This is to produce accurate EOS flag events */
       tiz_check_omx (
           tiz_srv_timer_watcher_init (p_prc, &(p_prc->p_eos_timer_)));
@@ -977,6 +987,12 @@ static OMX_ERRORTYPE ar_prc_prepare_to_transfer (void *ap_prc,
 
       /* Retrieve pcm params from the alsa pcm device and the omx port */
       tiz_check_omx (retrieve_alsa_pcm_format (p_prc, &snd_pcm_format));
+      p_prc->gain_format_ = get_gain_format (p_prc);
+      if (AR_GAIN_FORMAT_UNSUPPORTED == p_prc->gain_format_)
+        {
+          TIZ_NOTICE (handleOf (p_prc),
+                      "Software gain not available for this pcm format");
+        }
 
       /* This sets the hardware and software parameters in a convenient way. */
       bail_on_snd_pcm_error (snd_pcm_set_params (
@@ -1019,16 +1035,13 @@ static OMX_ERRORTYPE ar_prc_transfer_and_process (void *ap_prc,
   ar_prc_t *p_prc = ap_prc;
   assert (p_prc);
   log_alsa_pcm_state (p_prc);
-  prepare_volume_ramp (p_prc);
-  tiz_check_omx (start_volume_ramp (p_prc));
-  tiz_check_omx (apply_ramp_step (p_prc));
+  start_volume_ramp (p_prc);
   return OMX_ErrorNone;
 }
 
 static OMX_ERRORTYPE ar_prc_stop_and_return (void *ap_prc)
 {
   log_alsa_pcm_state (ap_prc);
-  stop_volume_ramp (ap_prc);
   stop_eos_timer (ap_prc);
   return do_flush (ap_prc);
 }
@@ -1041,12 +1054,6 @@ static OMX_ERRORTYPE ar_prc_deallocate_resources (void *ap_prc)
   tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_eos_timer_);
   p_prc->p_eos_timer_ = NULL;
 
-  if (p_prc->ramp_enabled_)
-    {
-      tiz_srv_timer_watcher_destroy (p_prc, p_prc->p_vol_ramp_timer_);
-      p_prc->p_vol_ramp_timer_ = NULL;
-    }
-
   p_prc->descriptor_count_ = 0;
   tiz_mem_free (p_prc->p_fds_);
   p_prc->p_fds_ = NULL;
@@ -1120,10 +1127,6 @@ static OMX_ERRORTYPE ar_prc_timer_ready (void *ap_prc,
       tiz_srv_issue_event ((OMX_PTR)ap_prc, OMX_EventBufferFlag, 0,
                            p_prc->nflags_, NULL);
     }
-  else if (ap_ev_timer == p_prc->p_vol_ramp_timer_)
-    {
-      rc = apply_ramp_step (ap_prc);
-    }
   else
     {
       assert (0);
@@ -1169,7 +1172,6 @@ static OMX_ERRORTYPE ar_prc_port_disable (const void *ap_prc,
   ar_prc_t *p_prc = (ar_prc_t *)ap_prc;
   assert (p_prc);
   log_alsa_pcm_state (p_prc);
-  stop_volume_ramp (p_prc);
   p_prc->port_disabled_ = true;
   if (p_prc->p_pcm_)
     {
@@ -1226,8 +1228,6 @@ static OMX_ERRORTYPE ar_prc_config_change (void *ap_prc, OMX_U32 a_pid,
               && volume.sVolume.nValue
                  >= ARATELIA_AUDIO_RENDERER_MIN_VOLUME_VALUE)
             {
-              /* TODO: Volume should be done by adjusting the gain, not ALSA's
-               * master volume! */
               set_volume (p_prc, volume.sVolume.nValue);
             }
         }
@@ -1238,8 +1238,6 @@ static OMX_ERRORTYPE ar_prc_config_change (void *ap_prc, OMX_U32 a_pid,
           tiz_check_omx (tiz_api_GetConfig (
               tiz_get_krn (handleOf (p_prc)), handleOf (p_prc),
               OMX_IndexConfigAudioMute, &mute));
-          /* TODO: Volume should be done by adjusting the gain, not ALSA's
-           * master volume! */
           TIZ_TRACE (handleOf (p_prc),
                      "[OMX_IndexConfigAudioMute] : bMute = [%s]",
                      (mute.bMute == OMX_FALSE ? "FALSE" : "TRUE"));
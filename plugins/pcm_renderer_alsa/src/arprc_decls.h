@@ -42,6 +42,8 @@ extern "C"
 
 #include <tizprc_decls.h>
 
+#include "argain.h"
+
   typedef struct ar_prc ar_prc_t;
   struct ar_prc
   {
@@ -56,7 +58,6 @@ extern "C"
     int descriptor_count_;
     struct pollfd *p_fds_;
     tiz_event_io_t *p_ev_io_;
-    tiz_event_timer_t *p_vol_ramp_timer_;
     tiz_event_timer_t *p_eos_timer_;
     OMX_BUFFERHEADERTYPE *p_inhdr_;
     bool port_disabled_;
@@ -65,9 +66,11 @@ extern "C"
     float gain_;
     long volume_;
     bool ramp_enabled_;
-    long ramp_step_;
-    long ramp_step_count_;
-    long ramp_volume_;
+    bool software_volume_;
+    bool muted_;
+    ar_gain_t gain_stage_;
+    ar_gain_format_t gain_format_;
+    bool hdr_processed_;
   };
 
   typedef struct ar_prc_class ar_prc_class_t;
@@ -747,7 +747,10 @@ allocate_temp_data_store (spfysrc_prc_t * ap_prc)
     tiz_api_GetParameter (tiz_get_krn (handleOf (ap_prc)), handleOf (ap_prc),
                           OMX_IndexParamPortDefinition, &port_def));
   assert (ap_prc->p_store_ == NULL);
-  return tiz_buffer_init (&(ap_prc->p_store_), port_def.nBufferSize);
+  tiz_check_omx (tiz_buffer_init (&(ap_prc->p_store_), port_def.nBufferSize));
+  /* Use a ring if possible, so that the cached audio is never moved around */
+  (void) tiz_buffer_seek_mode (ap_prc->p_store_, TIZ_BUFFER_RING);
+  return OMX_ErrorNone;
 }
 
 static inline void
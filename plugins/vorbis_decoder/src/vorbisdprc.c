@@ -158,18 +158,6 @@ store_data (vorbisd_prc_t * ap_prc, const OMX_U8 * ap_data, OMX_U32 a_nbytes)
   return a_nbytes - nbytes_to_copy;
 }
 
-static inline void
-write_frame_float_ilv (float * to, const float * from, const int channels)
-{
-  int i = 0;
-  assert (to);
-  assert (from);
-  for (i = 0; i < channels; ++i)
-    {
-      to[i] = from[i];
-    }
-}
-
 static OMX_ERRORTYPE
 update_pcm_mode (vorbisd_prc_t * ap_prc, const OMX_U32 a_samplerate,
                  const OMX_U32 a_channels)
@@ -313,6 +301,16 @@ fishsound_decoded_callback (FishSound * ap_fsound, float * app_pcm[],
       store_stream_metadata (p_prc);
       (void) update_pcm_mode (p_prc, p_prc->fsinfo_.samplerate,
                               p_prc->fsinfo_.channels);
+      tiz_pcm_conv_destroy (p_prc->p_pcm_conv_);
+      p_prc->p_pcm_conv_ = NULL;
+      if (OMX_ErrorNone
+          != tiz_pcm_conv_init (&(p_prc->p_pcm_conv_), ETIZPcmInFloat32, 0,
+                                ETIZPcmOutFloat32, TIZ_PCM_NATIVE_ENDIAN,
+                                p_prc->fsinfo_.channels, ETIZPcmDitherNone))
+        {
+          rc = FISH_SOUND_STOP_ERR;
+          goto end;
+        }
     }
 
   p_out = tiz_filter_prc_get_header (p_prc,
@@ -328,22 +326,15 @@ fishsound_decoded_callback (FishSound * ap_fsound, float * app_pcm[],
 
   {
     /* write decoded PCM samples */
-    size_t i = 0;
+    const float * p_pcm = (const float *) app_pcm;
     size_t frame_len = sizeof (float) * p_prc->fsinfo_.channels;
     size_t frames_alloc = ((p_out->nAllocLen - p_out->nOffset) / frame_len);
     size_t frames_to_write = (frames > frames_alloc) ? frames_alloc : frames;
     size_t bytes_to_write = frames_to_write * frame_len;
     assert (p_out);
 
-    for (i = 0; i < frames_to_write; ++i)
-      {
-        size_t frame_offset = i * frame_len;
-        size_t float_offset = i * p_prc->fsinfo_.channels;
-        float * out
-          = (float *) (p_out->pBuffer + p_out->nOffset + frame_offset);
-        write_frame_float_ilv (out, ((float *) app_pcm) + float_offset,
-                               p_prc->fsinfo_.channels);
-      }
+    tiz_pcm_conv_interleaved (p_prc->p_pcm_conv_, p_pcm, frames_to_write,
+                              p_out->pBuffer + p_out->nOffset);
     p_out->nFilledLen += bytes_to_write;
     p_out->nOffset += bytes_to_write;
 
@@ -355,7 +346,8 @@ fishsound_decoded_callback (FishSound * ap_fsound, float * app_pcm[],
         TIZ_TRACE (handleOf (p_prc), "Need to store [%d] bytes",
                    nbytes_remaining);
         nbytes_remaining = store_data (
-          p_prc, (OMX_U8 *) (app_pcm[frames_to_write * sizeof (float)]),
+          p_prc,
+          (OMX_U8 *) (p_pcm + frames_to_write * p_prc->fsinfo_.channels),
           nbytes_remaining);
       }
 
@@ -576,6 +568,7 @@ vorbisd_prc_ctor (void * ap_obj, va_list * app)
   assert (p_prc);
   p_prc->p_fsnd_ = NULL;
   p_prc->started_ = false;
+  p_prc->p_pcm_conv_ = NULL;
   p_prc->p_store_ = NULL;
   p_prc->store_size_ = 0;
   p_prc->store_offset_ = 0;
@@ -610,6 +603,8 @@ vorbisd_prc_deallocate_resources (void * ap_obj)
       fish_sound_delete (p_prc->p_fsnd_);
       p_prc->p_fsnd_ = NULL;
     }
+  tiz_pcm_conv_destroy (p_prc->p_pcm_conv_);
+  p_prc->p_pcm_conv_ = NULL;
   dealloc_temp_data_store (p_prc);
   return OMX_ErrorNone;
 }
@@ -36,6 +36,8 @@ extern "C" {
 #include <stdbool.h>
 #include <fishsound/fishsound.h>
 
+#include <tizplatform.h>
+
 #include <tizfilterprc.h>
 #include <tizfilterprc_decls.h>
 
@@ -48,6 +50,7 @@ struct vorbisd_prc
   FishSoundInfo fsinfo_;
   OMX_AUDIO_PARAM_PCMMODETYPE pcmmode_;
   bool started_;
+  tiz_pcm_conv_t * p_pcm_conv_;
   OMX_U8 * p_store_;
   OMX_U32 store_size_;
   OMX_U32 store_offset_;
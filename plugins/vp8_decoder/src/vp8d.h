@@ -49,6 +49,8 @@ extern "C" {
 #define ARATELIA_VP8_DECODER_PORT_NONCONTIGUOUS OMX_FALSE
 #define ARATELIA_VP8_DECODER_PORT_ALIGNMENT 0
 #define ARATELIA_VP8_DECODER_PORT_SUPPLIERPREF OMX_BufferSupplyInput
+#define ARATELIA_VP8_DECODER_DEFAULT_THREADS 0 /* one per online cpu */
+#define ARATELIA_VP8_DECODER_MAX_THREADS 8
 
 #ifdef __cplusplus
 }
@@ -36,6 +36,7 @@
 #include <assert.h>
 #include <limits.h>
 #include <string.h>
+#include <unistd.h>
 
 #include <tizplatform.h>
 
@@ -688,19 +689,70 @@ read_frame (vp8d_prc_t * ap_prc, OMX_BUFFERHEADERTYPE * ap_inhdr)
   return rc;
 }
 
+static OMX_U32
+get_threads_count (vp8d_prc_t * ap_prc)
+{
+  const char * p_value = NULL;
+  long nthreads = ARATELIA_VP8_DECODER_DEFAULT_THREADS;
+
+  assert (ap_prc);
+
+  p_value
+    = tiz_rcfile_get_value (TIZ_RCFILE_PLUGINS_DATA_SECTION,
+                            ARATELIA_VP8_DECODER_COMPONENT_NAME ".threads");
+  if (p_value)
+    {
+      nthreads = strtol (p_value, NULL, 10);
+    }
+
+  if (0 == nthreads)
+    {
+      /* Zero means one thread per online CPU */
+      nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    }
+
+  nthreads = MIN (MAX (nthreads, 1), ARATELIA_VP8_DECODER_MAX_THREADS);
+  TIZ_TRACE (handleOf (ap_prc), "Using [%ld] decoder threads", nthreads);
+  return nthreads;
+}
+
+static inline OMX_U32
+picture_size (const vpx_image_t * ap_img)
+{
+  assert (ap_img);
+  return (ap_img->d_w * ap_img->d_h)
+         + 2 * (((1 + ap_img->d_w) / 2) * ((1 + ap_img->d_h) / 2));
+}
+
+/* The planes are written without padding. The decoder's planes always have
+   borders, but a plane that happens to be contiguous goes in one copy */
 static void
-out_put (OMX_BUFFERHEADERTYPE * p_hdr, const uint8_t * buf, unsigned int len)
+out_put_plane (OMX_BUFFERHEADERTYPE * ap_hdr, const uint8_t * ap_src,
+               const int a_stride, const unsigned int a_width,
+               const unsigned int a_height)
 {
-  memcpy (p_hdr->pBuffer + p_hdr->nOffset, buf, len);
-  p_hdr->nOffset += len;
-  p_hdr->nFilledLen = p_hdr->nOffset;
+  uint8_t * p_dst = NULL;
+  unsigned int y = 0;
 
-  if (p_hdr->nFilledLen > p_hdr->nAllocLen)
+  assert (ap_hdr);
+  assert (ap_src);
+
+  p_dst = ap_hdr->pBuffer + ap_hdr->nOffset;
+  if (a_stride == (int) a_width)
+    {
+      memcpy (p_dst, ap_src, a_width * a_height);
+    }
+  else
     {
-      TIZ_LOG (TIZ_PRIORITY_TRACE, "len [%d] nFilledLen [%d] nAllocLen [%d]",
-               len, p_hdr->nFilledLen, p_hdr->nAllocLen);
-      assert (p_hdr->nFilledLen <= p_hdr->nAllocLen);
+      for (y = 0; y < a_height; ++y)
+        {
+          memcpy (p_dst, ap_src, a_width);
+          p_dst += a_width;
+          ap_src += a_stride;
+        }
     }
+  ap_hdr->nOffset += a_width * a_height;
+  ap_hdr->nFilledLen = ap_hdr->nOffset;
 }
 
 static OMX_ERRORTYPE
@@ -722,8 +774,7 @@ decode_frame (vp8d_prc_t * ap_prc)
 
   if ((img = vpx_codec_get_frame (&(ap_prc->vp8ctx_), &iter)))
     {
-      unsigned int y;
-      uint8_t * buf = img->planes[VPX_PLANE_Y];
+      OMX_BUFFERHEADERTYPE * p_hdr = ap_prc->p_outhdr_;
 
 #if 0
       {
@@ -742,26 +793,23 @@ decode_frame (vp8d_prc_t * ap_prc)
         }
 #endif
 
-      for (y = 0; y < img->d_h; y++)
+      /* Checked once per picture, rather than once per row */
+      if (picture_size (img) > p_hdr->nAllocLen - p_hdr->nOffset)
         {
-          out_put (ap_prc->p_outhdr_, buf, img->d_w);
-          buf += img->stride[VPX_PLANE_Y];
-        }
-
-      buf = img->planes[VPX_PLANE_U];
-
-      for (y = 0; y < (1 + img->d_h) / 2; y++)
-        {
-          out_put (ap_prc->p_outhdr_, buf, (1 + img->d_w) / 2);
-          buf += img->stride[VPX_PLANE_U];
+          TIZ_ERROR (handleOf (ap_prc),
+                     "Dropping picture : [%u] bytes needed, nAllocLen [%u]",
+                     picture_size (img), p_hdr->nAllocLen);
         }
-
-      buf = img->planes[VPX_PLANE_V];
-
-      for (y = 0; y < (1 + img->d_h) / 2; y++)
+      else
         {
-          out_put (ap_prc->p_outhdr_, buf, (1 + img->d_w) / 2);
-          buf += img->stride[VPX_PLANE_V];
+          out_put_plane (p_hdr, img->planes[VPX_PLANE_Y],
+                         img->stride[VPX_PLANE_Y], img->d_w, img->d_h);
+          out_put_plane (p_hdr, img->planes[VPX_PLANE_U],
+                         img->stride[VPX_PLANE_U], (1 + img->d_w) / 2,
+                         (1 + img->d_h) / 2);
+          out_put_plane (p_hdr, img->planes[VPX_PLANE_V],
+                         img->stride[VPX_PLANE_V], (1 + img->d_w) / 2,
+                         (1 + img->d_h) / 2);
         }
     }
 
@@ -913,6 +961,7 @@ vp8d_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNone;
   vp8d_prc_t * ap_prc = ap_obj;
+  vpx_codec_dec_cfg_t cfg;
   int flags = 0;
 
   assert (ap_prc);
@@ -921,9 +970,14 @@ vp8d_prc_allocate_resources (void * ap_obj, OMX_U32 a_pid)
   /*   flags = (postprc ? VPX_CODEC_USE_POSTPRC : 0) | */
   /*     (ec_enabled ? VPX_CODEC_USE_ERROR_CONCEALMENT : 0); */
 
+  /* The macroblock rows of each frame are spread over the decoder threads;
+     the frame size is not known yet */
+  tiz_mem_set (&cfg, 0, sizeof (cfg));
+  cfg.threads = get_threads_count (ap_prc);
+
   /* Initialize codec */
   bail_on_vpx_err_with_omx_err (
-    vpx_codec_dec_init (&(ap_prc->vp8ctx_), ifaces[0].iface, NULL, flags),
+    vpx_codec_dec_init (&(ap_prc->vp8ctx_), ifaces[0].iface, &cfg, flags),
     OMX_ErrorInsufficientResources);
 
 end:
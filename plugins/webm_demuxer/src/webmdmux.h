@@ -75,6 +75,10 @@ extern "C" {
 #define ARATELIA_WEBM_DEMUXER_DEFAULT_BIT_RATE_KBITS 128
 #define ARATELIA_WEBM_DEMUXER_DEFAULT_CACHE_SECONDS 10
 
+/* Filter role - additional configs */
+#define ARATELIA_WEBM_DEMUXER_MAX_QUEUED_FRAMES 64
+#define ARATELIA_WEBM_DEMUXER_SEEK_INDEX_INTERVAL_MS 1000
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,7 +25,6 @@
  *
  * TODO: Support for video demuxing (VP8/VP9 demuxing no handled yet).
  * TODO: Finalise support for audio demuxer (VORBIS not handled yet, only OPUS demuxing).
- * TODO: Seek support.
  *
  */
 
@@ -160,6 +159,7 @@ ne_io_seek (int64_t offset, int whence, void * userdata)
 {
   webmdmuxflt_prc_t * p_prc = userdata;
   int tb_whence = TIZ_BUFFER_SEEK_SET;
+  int64_t target = 0;
   assert (p_prc);
   TIZ_DEBUG (handleOf (userdata), "offset %lld - whence %d", offset, whence);
   switch (whence)
@@ -167,11 +167,13 @@ ne_io_seek (int64_t offset, int whence, void * userdata)
       case NESTEGG_SEEK_SET:
         {
           tb_whence = TIZ_BUFFER_SEEK_SET;
+          target = offset;
         }
         break;
       case NESTEGG_SEEK_CUR:
         {
           tb_whence = TIZ_BUFFER_SEEK_CUR;
+          target = tiz_buffer_offset (p_prc->p_webm_store_) + offset;
         }
         break;
       case NESTEGG_SEEK_END:
@@ -185,6 +187,14 @@ ne_io_seek (int64_t offset, int whence, void * userdata)
         }
         break;
     };
+  /* The cue points and the index may refer to data that has not been
+     received yet */
+  if (target < 0
+      || target > tiz_buffer_offset (p_prc->p_webm_store_)
+                    + tiz_buffer_available (p_prc->p_webm_store_))
+    {
+      return -1;
+    }
   return tiz_buffer_seek (p_prc->p_webm_store_, offset, tb_whence);
 }
 
@@ -281,8 +291,41 @@ print_video_codec_metadata (webmdmuxflt_prc_t * ap_prc,
 }
 #endif
 
+static inline tiz_buffer_t *
+frame_store (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  assert (ap_prc);
+  return ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
+           ? ap_prc->p_aud_store_
+           : ap_prc->p_vid_store_;
+}
+
+static inline tiz_vector_t *
+frame_lengths (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  assert (ap_prc);
+  return ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
+           ? ap_prc->p_aud_frame_lengths_
+           : ap_prc->p_vid_frame_lengths_;
+}
+
+static inline OMX_U32 *
+headers_pending (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  assert (ap_prc);
+  return ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
+           ? &(ap_prc->aud_headers_pending_)
+           : &(ap_prc->vid_headers_pending_);
+}
+
+static inline OMX_S32
+frames_queued (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  return tiz_vector_length (frame_lengths (ap_prc, a_pid));
+}
+
 static void
-propagate_eos_if_required (webmdmuxflt_prc_t * ap_prc,
+propagate_eos_if_required (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid,
                            OMX_BUFFERHEADERTYPE * ap_out_hdr)
 {
   assert (ap_prc);
@@ -292,7 +335,8 @@ propagate_eos_if_required (webmdmuxflt_prc_t * ap_prc,
 
   /* If EOS, propagate the flag to the next component */
   if (tiz_filter_prc_is_eos (ap_prc)
-      && tiz_buffer_available (ap_prc->p_webm_store_) == 0)
+      && tiz_buffer_available (ap_prc->p_webm_store_) == 0
+      && 0 == frames_queued (ap_prc, a_pid))
     {
       ap_out_hdr->nFlags |= OMX_BUFFERFLAG_EOS;
       tiz_filter_prc_update_eos_flag (ap_prc, false);
@@ -335,98 +379,122 @@ release_output_header (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
         {
           TIZ_DEBUG (handleOf (ap_prc), "p_hdr [%p] nFilledLen [%u]", p_hdr,
                      p_hdr->nFilledLen);
-          propagate_eos_if_required (ap_prc, p_hdr);
+          propagate_eos_if_required (ap_prc, a_pid, p_hdr);
           rc = tiz_filter_prc_release_header (ap_prc, a_pid);
         }
     }
   return rc;
 }
 
-OMX_ERRORTYPE
-deliver_codec_metadata (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+/* Each output port has a queue of frames (the codec headers first, then the
+   blocks of its track) waiting for an omx buffer. This way, a port that runs
+   out of buffers does not hold up the other one, until its queue is full. */
+static OMX_ERRORTYPE
+queue_frame (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid,
+             const unsigned char * ap_data, size_t a_length)
 {
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  bool * p_metadata_delivered = NULL;
-  tiz_buffer_t * p_out_store = NULL;
-  tiz_vector_t * p_header_lengths = NULL;
+  tiz_buffer_t * p_store = frame_store (ap_prc, a_pid);
+  size_t pushed = 0;
 
-  assert (ap_prc);
+  assert (ap_data);
+  assert (a_length);
 
-  p_metadata_delivered = ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
-                           ? &(ap_prc->audio_metadata_delivered_)
-                           : &(ap_prc->video_metadata_delivered_);
-  assert (p_metadata_delivered);
+  /* The store grows as needed, but at most by twice its size on each push */
+  while (pushed < a_length)
+    {
+      int nbytes
+        = tiz_buffer_push (p_store, ap_data + pushed, a_length - pushed);
+      tiz_check_true_ret_val ((nbytes > 0), OMX_ErrorInsufficientResources);
+      pushed += nbytes;
+    }
+  tiz_check_omx (
+    tiz_vector_push_back (frame_lengths (ap_prc, a_pid), &a_length));
 
-  p_out_store = ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
-                  ? ap_prc->p_aud_store_
-                  : ap_prc->p_vid_store_;
-  assert (p_out_store);
+  return OMX_ErrorNone;
+}
 
-  p_header_lengths = ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX == a_pid
-                       ? ap_prc->p_aud_header_lengths_
-                       : ap_prc->p_vid_header_lengths_;
-  assert (p_header_lengths);
+static void
+drop_oversize_frame (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid,
+                     const size_t a_framelen, const OMX_U32 a_capacity)
+{
+  OMX_U32 * p_headers_pending = headers_pending (ap_prc, a_pid);
 
-  if (tiz_vector_length (p_header_lengths) > 0)
-    {
-      if (tiz_buffer_available (p_out_store)
-          && (p_hdr = tiz_filter_prc_get_header (ap_prc, a_pid)))
-        {
-          size_t headerlen = 0;
-          size_t * p_headerlen = tiz_vector_at (p_header_lengths, (OMX_S32) 0);
-          assert (p_headerlen);
-          headerlen = *p_headerlen;
-
-          /* Copy the data into the omx buffer */
-          size_t nbytes_to_copy = MIN (TIZ_OMX_BUF_AVAIL (p_hdr), headerlen);
-          memcpy (TIZ_OMX_BUF_PTR (p_hdr) + p_hdr->nFilledLen,
-                  tiz_buffer_get (p_out_store), nbytes_to_copy);
-          tiz_buffer_advance (p_out_store, nbytes_to_copy);
-          p_hdr->nFilledLen += nbytes_to_copy;
-          tiz_vector_erase (p_header_lengths, (OMX_S32) 0, (OMX_S32) 1);
-          tiz_check_omx (release_output_header (ap_prc, a_pid));
-        }
-    }
+  TIZ_ERROR (handleOf (ap_prc),
+             "[OMX_ErrorStreamCorrupt] : port [%u] - dropping a frame of "
+             "[%u] bytes (buffer size [%u] bytes)",
+             a_pid, (unsigned int) a_framelen, a_capacity);
 
-  if (0 == tiz_vector_length (p_header_lengths))
+  tiz_buffer_advance (frame_store (ap_prc, a_pid), a_framelen);
+  tiz_vector_erase (frame_lengths (ap_prc, a_pid), (OMX_S32) 0, (OMX_S32) 1);
+  if (*p_headers_pending > 0)
     {
-      *p_metadata_delivered = true;
+      --(*p_headers_pending);
     }
-
-  return OMX_ErrorNone;
+  tiz_srv_issue_err_event ((OMX_PTR) ap_prc, OMX_ErrorStreamCorrupt);
 }
 
 static OMX_ERRORTYPE
-store_audio_codec_metadata (webmdmuxflt_prc_t * ap_prc,
-                            unsigned char * ap_codec_data, size_t a_length)
+deliver_frames (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
 {
-  int pushed = 0;
-  assert (ap_prc);
-  assert (ap_codec_data);
-  assert (a_length);
+  tiz_buffer_t * p_store = frame_store (ap_prc, a_pid);
+  tiz_vector_t * p_lengths = frame_lengths (ap_prc, a_pid);
+  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
 
-  pushed = tiz_buffer_push (ap_prc->p_aud_store_, ap_codec_data, a_length);
-  tiz_check_true_ret_val ((pushed == a_length), OMX_ErrorInsufficientResources);
-  tiz_check_omx (
-    tiz_vector_push_back (ap_prc->p_aud_header_lengths_, &a_length));
+  while (tiz_vector_length (p_lengths) > 0
+         && tiz_filter_prc_is_port_enabled (ap_prc, a_pid)
+         && (p_hdr = tiz_filter_prc_get_header (ap_prc, a_pid)))
+    {
+      size_t framelen = *(size_t *) tiz_vector_at (p_lengths, (OMX_S32) 0);
+      OMX_U32 * p_headers_pending = NULL;
+
+      /* One whole frame per omx buffer; the decoders downstream can not
+         reassemble a frame from several buffers. A frame that does not fit
+         in an empty buffer is dropped. */
+      if (framelen > p_hdr->nAllocLen - p_hdr->nOffset)
+        {
+          drop_oversize_frame (ap_prc, a_pid, framelen,
+                               p_hdr->nAllocLen - p_hdr->nOffset);
+          continue;
+        }
+
+      assert (0 == p_hdr->nFilledLen);
+      memcpy (TIZ_OMX_BUF_PTR (p_hdr), tiz_buffer_get (p_store), framelen);
+      tiz_buffer_advance (p_store, framelen);
+      p_hdr->nFilledLen = framelen;
+      TIZ_DEBUG (handleOf (ap_prc), "copy to buffer p_hdr [%p] - len %u",
+                 p_hdr, p_hdr->nFilledLen);
+
+      p_headers_pending = headers_pending (ap_prc, a_pid);
+      tiz_vector_erase (p_lengths, (OMX_S32) 0, (OMX_S32) 1);
+      if (*p_headers_pending > 0)
+        {
+          --(*p_headers_pending);
+        }
+      tiz_check_omx (release_output_header (ap_prc, a_pid));
+    }
 
   return OMX_ErrorNone;
 }
 
-static OMX_ERRORTYPE
-store_video_codec_metadata (webmdmuxflt_prc_t * ap_prc,
-                            unsigned char * ap_codec_data, size_t a_length)
+/* Drops the frames queued for a port, except for any codec headers that have
+   not been delivered yet. In that case the queue is left as it is, as the
+   store can not be partially emptied. */
+static void
+drop_queued_frames (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
 {
-  int pushed = 0;
-  assert (ap_prc);
-  assert (ap_codec_data);
-  assert (a_length);
-
-  pushed = tiz_buffer_push (ap_prc->p_vid_store_, ap_codec_data, a_length);
-  tiz_check_true_ret_val ((pushed == a_length), OMX_ErrorInsufficientResources);
-  tiz_check_omx (
-    tiz_vector_push_back (ap_prc->p_vid_header_lengths_, &a_length));
+  if (0 == *headers_pending (ap_prc, a_pid))
+    {
+      tiz_buffer_clear (frame_store (ap_prc, a_pid));
+      tiz_vector_clear (frame_lengths (ap_prc, a_pid));
+    }
+}
 
+static OMX_ERRORTYPE
+queue_codec_metadata (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid,
+                      unsigned char * ap_codec_data, size_t a_length)
+{
+  tiz_check_omx (queue_frame (ap_prc, a_pid, ap_codec_data, a_length));
+  ++(*headers_pending (ap_prc, a_pid));
   return OMX_ErrorNone;
 }
 
@@ -492,100 +560,308 @@ store_data (webmdmuxflt_prc_t * ap_prc)
   return rc;
 }
 
-static OMX_ERRORTYPE
-extract_track_data (webmdmuxflt_prc_t * ap_prc, const unsigned int a_track,
-                    const OMX_U32 a_pid)
+static inline bool
+video_track_on (webmdmuxflt_prc_t * ap_prc)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNotReady;
-  OMX_BUFFERHEADERTYPE * p_hdr = NULL;
-  unsigned int chunks = 0;
+  assert (ap_prc);
+  return (NESTEGG_TRACK_UNKNOWN != ap_prc->ne_video_track_
+          && tiz_filter_prc_is_port_enabled (
+               ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX));
+}
 
-  if (!tiz_filter_prc_is_port_disabled (ap_prc, a_pid))
+static OMX_U32
+track_to_pid (webmdmuxflt_prc_t * ap_prc, const unsigned int a_track)
+{
+  assert (ap_prc);
+  if (a_track == ap_prc->ne_audio_track_)
     {
-      p_hdr = tiz_filter_prc_get_header (ap_prc, a_pid);
-      if (p_hdr)
+      return ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX;
+    }
+  if (a_track == ap_prc->ne_video_track_)
+    {
+      return ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX;
+    }
+  return ARATELIA_WEBM_DEMUXER_FILTER_PORT_0_INDEX;
+}
+
+/* Whether the next element in the store is a Cluster */
+static bool
+at_cluster_start (webmdmuxflt_prc_t * ap_prc)
+{
+  static const unsigned char cluster_id[] = {0x1F, 0x43, 0xB6, 0x75};
+  assert (ap_prc);
+  return (tiz_buffer_available (ap_prc->p_webm_store_)
+            >= (int) sizeof (cluster_id)
+          && 0 == memcmp (tiz_buffer_get (ap_prc->p_webm_store_), cluster_id,
+                          sizeof (cluster_id)));
+}
+
+/* nestegg_init stops once it has read the ID and size of the first Cluster.
+   Finds where that Cluster starts, and seeks back there, so that every
+   Cluster is parsed from its start and its offset can be indexed. */
+static void
+rewind_to_first_cluster (webmdmuxflt_prc_t * ap_prc)
+{
+  static const unsigned char cluster_id[] = {0x1F, 0x43, 0xB6, 0x75};
+  const long offset = tiz_buffer_offset (ap_prc->p_webm_store_);
+  const unsigned char * p_pos = tiz_buffer_get (ap_prc->p_webm_store_);
+  long size_len = 0;
+
+  ap_prc->ne_seekable_ = at_cluster_start (ap_prc);
+
+  /* The size is an EBML vint, between 1 and 8 bytes long */
+  for (size_len = 1; size_len <= 8 && !ap_prc->ne_seekable_; ++size_len)
+    {
+      const long id_offset = offset - size_len - (long) sizeof (cluster_id);
+      const unsigned char marker = 0x80 >> (size_len - 1);
+      if (id_offset >= 0
+          && 0 == memcmp (p_pos - (offset - id_offset), cluster_id,
+                          sizeof (cluster_id))
+          && marker == (p_pos[-size_len] & (0xFF << (8 - size_len)))
+          && 0 == nestegg_offset_seek (ap_prc->p_ne_, id_offset))
         {
-          unsigned char * p_data = NULL;
-          size_t data_size = 0;
-          int nestegg_rc = 0;
-
-          assert (ap_prc);
-          assert (ap_prc->p_ne_pkt_);
-
-          nestegg_packet_count (ap_prc->p_ne_pkt_, &chunks);
-
-          /* Extract a packet */
-          assert (ap_prc->ne_chunk_ <= chunks);
-          if (ap_prc->ne_chunk_ < chunks
-              && ((nestegg_rc = nestegg_packet_data (
-                     ap_prc->p_ne_pkt_, ap_prc->ne_chunk_, &p_data, &data_size))
-                  == 0)
-              && TIZ_OMX_BUF_AVAIL (p_hdr) >= data_size)
-            {
-              memcpy (TIZ_OMX_BUF_PTR (p_hdr) + p_hdr->nFilledLen, p_data,
-                      data_size);
-              p_hdr->nFilledLen += data_size;
-              TIZ_DEBUG (handleOf (ap_prc),
-                         "copy to buffer p_hdr [%p] - len %u", p_hdr,
-                         p_hdr->nFilledLen);
-              ++ap_prc->ne_chunk_;
-            }
-          else
-            {
-              TIZ_WARN (handleOf (ap_prc), "Unable to extract packet");
-            }
+          ap_prc->ne_seekable_ = true;
+        }
+    }
 
-          WEBMDMUX_LOG_STATE (ap_prc);
+  TIZ_DEBUG (handleOf (ap_prc), "first cluster found : %s",
+             (ap_prc->ne_seekable_ ? "YES" : "NO"));
+}
 
-          /* Release the OMX buffer */
-          if (TIZ_OMX_BUF_FILL_LEN (p_hdr) > 0)
-            {
-              tiz_check_omx (release_output_header (ap_prc, a_pid));
-            }
-        } /* if (p_hdr) */
-    }     /* if (!tiz_filter_prc_is_port_disabled (ap_prc, a_pid)) */
+/* The fallback seek index, for files without Cues (or with the Cues at the
+   end), is built as the file is played. It records the Clusters, at most one
+   per interval, that start with an audio block (or a video keyframe, if there
+   is a video track). */
+static void
+index_cluster (webmdmuxflt_prc_t * ap_prc, const unsigned int a_track,
+               const uint64_t a_tstamp, const bool a_keyframe,
+               const int64_t a_offset)
+{
+  webmdmuxflt_idx_entry_t entry = {a_tstamp, a_offset};
+  const webmdmuxflt_idx_entry_t * p_last = NULL;
+
+  assert (ap_prc);
 
-  /* Release the ne packet if all chunks have been processed */
-  if (ap_prc->ne_chunk_ >= chunks)
+  if (video_track_on (ap_prc))
     {
-      /* All chunks extracted, release the packet now. */
-      nestegg_free_packet (ap_prc->p_ne_pkt_);
-      ap_prc->p_ne_pkt_ = NULL;
-      ap_prc->ne_chunk_ = 0;
-      /* Return ErrorNone. This is an indication that we will need to keep
-         reading data from the internal data store */
-      rc = OMX_ErrorNone;
+      if (a_track != ap_prc->ne_video_track_ || !a_keyframe)
+        {
+          return;
+        }
+    }
+  else if (a_track != ap_prc->ne_audio_track_)
+    {
+      return;
     }
 
-  return rc;
+  if (tiz_vector_length (ap_prc->p_seek_idx_) > 0)
+    {
+      p_last = tiz_vector_back (ap_prc->p_seek_idx_);
+      assert (p_last);
+      if (a_offset <= p_last->offset
+          || a_tstamp < p_last->tstamp_ns
+                          + ARATELIA_WEBM_DEMUXER_SEEK_INDEX_INTERVAL_MS
+                              * 1000000ULL)
+        {
+          return;
+        }
+    }
+
+  (void) tiz_vector_push_back (ap_prc->p_seek_idx_, &entry);
+}
+
+/* Finds the last indexed Cluster that starts at or before a_tstamp */
+static bool
+lookup_cluster (webmdmuxflt_prc_t * ap_prc, const uint64_t a_tstamp,
+                webmdmuxflt_idx_entry_t * ap_entry)
+{
+  OMX_S32 lo = 0;
+  OMX_S32 hi = tiz_vector_length (ap_prc->p_seek_idx_);
+
+  assert (ap_entry);
+
+  while (lo < hi)
+    {
+      const OMX_S32 mid = lo + (hi - lo) / 2;
+      const webmdmuxflt_idx_entry_t * p_entry
+        = tiz_vector_at (ap_prc->p_seek_idx_, mid);
+      if (p_entry->tstamp_ns <= a_tstamp)
+        {
+          lo = mid + 1;
+        }
+      else
+        {
+          hi = mid;
+        }
+    }
+
+  if (0 == lo)
+    {
+      return false;
+    }
+  *ap_entry
+    = *(const webmdmuxflt_idx_entry_t *) tiz_vector_at (ap_prc->p_seek_idx_,
+                                                        lo - 1);
+  return true;
+}
+
+/* Moves the parser to a Cluster close to a_tstamp, using the file's Cues
+   first, and then the index. Fails if neither knows of a Cluster that is
+   already in the store. */
+static bool
+jump_to_cluster (webmdmuxflt_prc_t * ap_prc, const uint64_t a_tstamp)
+{
+  const long offset = tiz_buffer_offset (ap_prc->p_webm_store_);
+  const bool forward = (a_tstamp >= ap_prc->position_ns_);
+  webmdmuxflt_idx_entry_t entry;
+
+  if (nestegg_has_cues (ap_prc->p_ne_)
+      && 0 == nestegg_track_seek (ap_prc->p_ne_,
+                                  video_track_on (ap_prc)
+                                    ? ap_prc->ne_video_track_
+                                    : ap_prc->ne_audio_track_,
+                                  a_tstamp))
+    {
+      /* Going back to a point before the current one, in a forward seek,
+         would only demux the same blocks again */
+      if (!forward || tiz_buffer_offset (ap_prc->p_webm_store_) > offset)
+        {
+          TIZ_DEBUG (handleOf (ap_prc), "cue point at offset [%ld]",
+                     tiz_buffer_offset (ap_prc->p_webm_store_));
+          return true;
+        }
+    }
+
+  /* Loading the cues may have moved the read position */
+  (void) nestegg_offset_seek (ap_prc->p_ne_, offset);
+
+  if (lookup_cluster (ap_prc, a_tstamp, &entry)
+      && (!forward || entry.offset > offset)
+      && 0 == nestegg_offset_seek (ap_prc->p_ne_, entry.offset))
+    {
+      TIZ_DEBUG (handleOf (ap_prc), "index entry [%llu ms] at offset [%lld]",
+                 (unsigned long long) entry.tstamp_ns / 1000000,
+                 (long long) entry.offset);
+      return true;
+    }
+
+  return false;
 }
 
 static OMX_ERRORTYPE
-extract_track_audio_data (webmdmuxflt_prc_t * ap_prc,
-                          const unsigned int a_track)
+seek_to_time (webmdmuxflt_prc_t * ap_prc, const uint64_t a_tstamp)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
   assert (ap_prc);
-  if (a_track == ap_prc->ne_audio_track_)
+  assert (ap_prc->p_ne_);
+
+  TIZ_DEBUG (handleOf (ap_prc), "seek to [%llu ms] from [%llu ms]",
+             (unsigned long long) a_tstamp / 1000000,
+             (unsigned long long) ap_prc->position_ns_ / 1000000);
+
+  drop_queued_frames (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX);
+  drop_queued_frames (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX);
+
+  /* Go back to the start of the block that could not be read */
+  if (ap_prc->ne_read_err_ < 0)
     {
-      rc = extract_track_data (ap_prc, a_track,
-                               ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX);
+      ap_prc->ne_read_err_ = 0;
+      nestegg_read_reset (ap_prc->p_ne_);
     }
-  return rc;
+
+  ap_prc->seek_target_ns_ = a_tstamp;
+  if (ap_prc->ne_seekable_ && jump_to_cluster (ap_prc, a_tstamp))
+    {
+      /* The Cluster starts with a video keyframe. Only when there is no video
+         is the audio trimmed to the exact position. */
+      ap_prc->seeking_ = !video_track_on (ap_prc);
+      ap_prc->await_keyframe_ = false;
+    }
+  else
+    {
+      /* Skip the blocks up to the position, and then up to the next video
+         keyframe */
+      ap_prc->seeking_ = true;
+      ap_prc->await_keyframe_ = video_track_on (ap_prc);
+    }
+  ap_prc->position_ns_ = a_tstamp;
+
+  return OMX_ErrorNone;
+}
+
+static bool
+skip_packet (webmdmuxflt_prc_t * ap_prc, const unsigned int a_track,
+             const uint64_t a_tstamp, const bool a_keyframe)
+{
+  assert (ap_prc);
+  if (ap_prc->seeking_)
+    {
+      if (a_tstamp < ap_prc->seek_target_ns_)
+        {
+          return true;
+        }
+      if (ap_prc->await_keyframe_)
+        {
+          if (a_track != ap_prc->ne_video_track_ || !a_keyframe)
+            {
+              return true;
+            }
+          ap_prc->await_keyframe_ = false;
+        }
+      ap_prc->seeking_ = false;
+    }
+  return false;
 }
 
 static OMX_ERRORTYPE
-extract_track_video_data (webmdmuxflt_prc_t * ap_prc,
-                          const unsigned int a_track)
+queue_packet (webmdmuxflt_prc_t * ap_prc, nestegg_packet * ap_pkt,
+              const OMX_U32 a_pid)
 {
-  OMX_ERRORTYPE rc = OMX_ErrorNone;
+  unsigned int chunks = 0;
+  unsigned int chunk = 0;
+
   assert (ap_prc);
-  if (a_track == ap_prc->ne_video_track_)
+  assert (ap_pkt);
+
+  if (ARATELIA_WEBM_DEMUXER_FILTER_PORT_0_INDEX == a_pid
+      || tiz_filter_prc_is_port_disabled (ap_prc, a_pid))
     {
-      rc = extract_track_data (ap_prc, a_track,
-                               ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX);
+      /* Not a track we demux, or nobody to deliver it to */
+      return OMX_ErrorNone;
     }
-  return rc;
+
+  nestegg_packet_count (ap_pkt, &chunks);
+  for (chunk = 0; chunk < chunks; ++chunk)
+    {
+      unsigned char * p_data = NULL;
+      size_t data_size = 0;
+      if (0 == nestegg_packet_data (ap_pkt, chunk, &p_data, &data_size)
+          && data_size > 0)
+        {
+          tiz_check_omx (queue_frame (ap_prc, a_pid, p_data, data_size));
+        }
+      else
+        {
+          TIZ_WARN (handleOf (ap_prc), "Unable to extract packet");
+        }
+    }
+
+  return OMX_ErrorNone;
+}
+
+static bool
+port_starved (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  return (tiz_filter_prc_is_port_enabled (ap_prc, a_pid)
+          && 0 == frames_queued (ap_prc, a_pid)
+          && tiz_filter_prc_get_header (ap_prc, a_pid));
+}
+
+static bool
+port_backlogged (webmdmuxflt_prc_t * ap_prc, const OMX_U32 a_pid)
+{
+  return (tiz_filter_prc_is_port_enabled (ap_prc, a_pid)
+          && frames_queued (ap_prc, a_pid)
+               >= ARATELIA_WEBM_DEMUXER_MAX_QUEUED_FRAMES);
 }
 
 static bool
@@ -602,12 +878,25 @@ able_to_demux (webmdmuxflt_prc_t * ap_prc)
 
   if (!compressed_data_avail && tiz_filter_prc_is_eos (ap_prc))
     {
-      release_output_header (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX);
-      release_output_header (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX);
+      if (0 == frames_queued (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX))
+        {
+          release_output_header (ap_prc,
+                                 ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX);
+        }
+      if (0 == frames_queued (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX))
+        {
+          release_output_header (ap_prc,
+                                 ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX);
+        }
     }
 
+  /* Keep demuxing while a port is waiting for data, unless the other one has
+     too much queued already */
   if (!compressed_data_avail || !enough_compressed_data_avail
-      || (!tiz_filter_prc_output_headers_available (ap_prc)))
+      || port_backlogged (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX)
+      || port_backlogged (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX)
+      || !(port_starved (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX)
+           || port_starved (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX)))
     {
       rc = false;
     }
@@ -621,6 +910,9 @@ static OMX_ERRORTYPE
 read_packet (webmdmuxflt_prc_t * ap_prc)
 {
   OMX_ERRORTYPE rc = OMX_ErrorNotReady;
+  nestegg_packet * p_pkt = NULL;
+  long offset = 0;
+  bool cluster_start = false;
 
   assert (ap_prc);
 
@@ -630,26 +922,34 @@ read_packet (webmdmuxflt_prc_t * ap_prc)
       nestegg_read_reset (ap_prc->p_ne_);
     }
 
-  if (ap_prc->p_ne_pkt_
-      || (ap_prc->ne_read_err_
-          = nestegg_read_packet (ap_prc->p_ne_, &ap_prc->p_ne_pkt_))
-           > 0)
+  offset = tiz_buffer_offset (ap_prc->p_webm_store_);
+  cluster_start = ap_prc->ne_seekable_ && at_cluster_start (ap_prc);
+
+  if ((ap_prc->ne_read_err_ = nestegg_read_packet (ap_prc->p_ne_, &p_pkt))
+      > 0)
     {
       unsigned int track = 0;
-      assert (ap_prc->p_ne_pkt_);
+      uint64_t tstamp = 0;
+      bool keyframe = false;
+      assert (p_pkt);
 
-      nestegg_packet_track (ap_prc->p_ne_pkt_, &track);
+      nestegg_packet_track (p_pkt, &track);
+      nestegg_packet_tstamp (p_pkt, &tstamp);
+      keyframe = (NESTEGG_PACKET_HAS_KEYFRAME_TRUE
+                  == nestegg_packet_has_keyframe (p_pkt));
 
-      tiz_check_omx (extract_track_audio_data (ap_prc, track));
-      tiz_check_omx (extract_track_video_data (ap_prc, track));
+      if (cluster_start)
+        {
+          index_cluster (ap_prc, track, tstamp, keyframe, offset);
+        }
 
-      if (track != ap_prc->ne_audio_track_ && track != ap_prc->ne_video_track_)
+      rc = OMX_ErrorNone;
+      if (!skip_packet (ap_prc, track, tstamp, keyframe))
         {
-          /* Just in case, read the next packet */
-          nestegg_free_packet (ap_prc->p_ne_pkt_);
-          ap_prc->p_ne_pkt_ = NULL;
-          ap_prc->ne_chunk_ = 0;
+          ap_prc->position_ns_ = tstamp;
+          rc = queue_packet (ap_prc, p_pkt, track_to_pid (ap_prc, track));
         }
+      nestegg_free_packet (p_pkt);
     }
   else
     {
@@ -668,10 +968,14 @@ demux_stream (webmdmuxflt_prc_t * ap_prc)
   assert (ap_prc);
   assert (ap_prc->p_ne_);
 
-  while (able_to_demux (ap_prc))
+  do
     {
-      rc = read_packet (ap_prc);
+      tiz_check_omx (
+        deliver_frames (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX));
+      tiz_check_omx (
+        deliver_frames (ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX));
     }
+  while (able_to_demux (ap_prc) && OMX_ErrorNone == (rc = read_packet (ap_prc)));
 
   return rc;
 }
@@ -723,13 +1027,17 @@ alloc_output_stores (webmdmuxflt_prc_t * ap_prc)
   tiz_check_omx (
     tiz_buffer_init (&(ap_prc->p_vid_store_), vid_port_def.nBufferSize));
 
-  assert (!ap_prc->p_aud_header_lengths_);
+  assert (!ap_prc->p_aud_frame_lengths_);
   tiz_check_omx (
-    tiz_vector_init (&(ap_prc->p_aud_header_lengths_), sizeof (size_t)));
+    tiz_vector_init (&(ap_prc->p_aud_frame_lengths_), sizeof (size_t)));
 
-  assert (!ap_prc->p_vid_header_lengths_);
+  assert (!ap_prc->p_vid_frame_lengths_);
   tiz_check_omx (
-    tiz_vector_init (&(ap_prc->p_vid_header_lengths_), sizeof (size_t)));
+    tiz_vector_init (&(ap_prc->p_vid_frame_lengths_), sizeof (size_t)));
+
+  assert (!ap_prc->p_seek_idx_);
+  tiz_check_omx (tiz_vector_init (&(ap_prc->p_seek_idx_),
+                                  sizeof (webmdmuxflt_idx_entry_t)));
 
   return OMX_ErrorNone;
 }
@@ -765,10 +1073,13 @@ reset_nestegg_members (webmdmuxflt_prc_t * ap_prc)
   ap_prc->ne_audio_track_ = NESTEGG_TRACK_UNKNOWN;
   ap_prc->ne_video_track_ = NESTEGG_TRACK_UNKNOWN;
   ap_prc->ne_duration_ = 0;
-  ap_prc->p_ne_pkt_ = NULL;
-  ap_prc->ne_chunk_ = 0;
   ap_prc->ne_read_err_ = 0;
   ap_prc->ne_last_read_len_ = 0;
+  ap_prc->ne_seekable_ = false;
+  ap_prc->position_ns_ = 0;
+  ap_prc->seek_target_ns_ = 0;
+  ap_prc->seeking_ = false;
+  ap_prc->await_keyframe_ = false;
 }
 
 static void
@@ -777,8 +1088,8 @@ reset_stream_parameters (webmdmuxflt_prc_t * ap_prc)
   assert (ap_prc);
   TIZ_DEBUG (handleOf (ap_prc), "Resetting stream parameters");
   ap_prc->ne_inited_ = false;
-  ap_prc->audio_metadata_delivered_ = false;
-  ap_prc->video_metadata_delivered_ = false;
+  ap_prc->aud_headers_pending_ = 0;
+  ap_prc->vid_headers_pending_ = 0;
   ap_prc->audio_auto_detect_on_ = false;
   ap_prc->audio_coding_type_ = OMX_AUDIO_CodingUnused;
   ap_prc->video_auto_detect_on_ = false;
@@ -790,8 +1101,10 @@ reset_stream_parameters (webmdmuxflt_prc_t * ap_prc)
   tiz_buffer_clear (ap_prc->p_webm_store_);
   tiz_buffer_clear (ap_prc->p_aud_store_);
   tiz_buffer_clear (ap_prc->p_vid_store_);
-  tiz_vector_clear (ap_prc->p_aud_header_lengths_);
-  tiz_vector_clear (ap_prc->p_vid_header_lengths_);
+  tiz_vector_clear (ap_prc->p_aud_frame_lengths_);
+  tiz_vector_clear (ap_prc->p_vid_frame_lengths_);
+  /* The offsets are only valid for this stream */
+  tiz_vector_clear (ap_prc->p_seek_idx_);
 
   tiz_filter_prc_update_eos_flag (ap_prc, false);
 }
@@ -818,10 +1131,12 @@ dealloc_output_stores (
   ap_prc->p_aud_store_ = NULL;
   tiz_buffer_destroy (ap_prc->p_vid_store_);
   ap_prc->p_vid_store_ = NULL;
-  tiz_vector_destroy (ap_prc->p_aud_header_lengths_);
-  ap_prc->p_aud_header_lengths_ = NULL;
-  tiz_vector_destroy (ap_prc->p_vid_header_lengths_);
-  ap_prc->p_vid_header_lengths_ = NULL;
+  tiz_vector_destroy (ap_prc->p_aud_frame_lengths_);
+  ap_prc->p_aud_frame_lengths_ = NULL;
+  tiz_vector_destroy (ap_prc->p_vid_frame_lengths_);
+  ap_prc->p_vid_frame_lengths_ = NULL;
+  tiz_vector_destroy (ap_prc->p_seek_idx_);
+  ap_prc->p_seek_idx_ = NULL;
 }
 
 static OMX_ERRORTYPE
@@ -923,9 +1238,10 @@ read_audio_codec_metadata (webmdmuxflt_prc_t * ap_prc,
           print_audio_codec_metadata (ap_prc, header_idx, nheaders,
                                       p_codec_data, length);
 #endif
-          /* Put the audio specific codec data on a temporary buffer */
-          tiz_check_omx (
-            store_audio_codec_metadata (ap_prc, p_codec_data, length));
+          /* Queue the audio specific codec data ahead of the blocks */
+          tiz_check_omx (queue_codec_metadata (
+            ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX, p_codec_data,
+            length));
         }
 
       tiz_check_omx (set_audio_coding_on_port (ap_prc));
@@ -973,9 +1289,10 @@ read_video_codec_metadata (webmdmuxflt_prc_t * ap_prc,
           print_video_codec_metadata (ap_prc, header_idx, nheaders,
                                       p_codec_data, length);
 #endif
-          /* Put the video specific codec data on an OMX buffer */
-          tiz_check_omx (
-            store_video_codec_metadata (ap_prc, p_codec_data, length));
+          /* Queue the video specific codec data ahead of the blocks */
+          tiz_check_omx (queue_codec_metadata (
+            ap_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX, p_codec_data,
+            length));
         }
 
       tiz_check_omx (set_video_coding_on_port (ap_prc));
@@ -1088,6 +1405,12 @@ alloc_nestegg (webmdmuxflt_prc_t * ap_prc)
     {
       rc = send_port_auto_detect_events (ap_prc);
       ap_prc->ne_inited_ = true;
+      rewind_to_first_cluster (ap_prc);
+      if (OMX_ErrorNone == rc && ap_prc->pending_seek_us_ >= 0)
+        {
+          rc = seek_to_time (ap_prc, ap_prc->pending_seek_us_ * 1000);
+          ap_prc->pending_seek_us_ = -1;
+        }
     }
   TIZ_DEBUG (handleOf (ap_prc), "nestegg inited = %s",
              (ap_prc->ne_inited_ ? "TRUE" : "FALSE"));
@@ -1119,8 +1442,11 @@ webmdmuxflt_prc_ctor (void * ap_prc, va_list * app)
   p_prc->p_webm_store_ = NULL;
   p_prc->p_aud_store_ = NULL;
   p_prc->p_vid_store_ = NULL;
-  p_prc->p_aud_header_lengths_ = NULL;
-  p_prc->p_vid_header_lengths_ = NULL;
+  p_prc->p_aud_frame_lengths_ = NULL;
+  p_prc->p_vid_frame_lengths_ = NULL;
+  p_prc->p_seek_idx_ = NULL;
+  p_prc->pending_seek_us_ = -1;
+  p_prc->seek_mode_ = OMX_TIME_SeekModeFast;
   reset_stream_parameters (p_prc);
   g_handle = handleOf (ap_prc);
   return p_prc;
@@ -1201,19 +1527,6 @@ webmdmuxflt_prc_buffers_ready (const void * ap_prc)
     }
 
   if (p_prc->ne_inited_)
-    {
-      tiz_check_omx (deliver_codec_metadata (
-        p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX));
-      tiz_check_omx (deliver_codec_metadata (
-        p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX));
-    }
-
-  if ((p_prc->audio_metadata_delivered_
-       || tiz_filter_prc_is_port_disabled (
-            p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_1_INDEX))
-      && (p_prc->video_metadata_delivered_
-          || tiz_filter_prc_is_port_disabled (
-               p_prc, ARATELIA_WEBM_DEMUXER_FILTER_PORT_2_INDEX)))
     {
       rc = demux_stream (p_prc);
       if (OMX_ErrorNotReady == rc)
@@ -1265,6 +1578,75 @@ webmdmuxflt_prc_port_enable (const void * ap_prc, OMX_U32 a_pid)
   return OMX_ErrorNone;
 }
 
+/*
+ * from tizapi class
+ */
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_GetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  webmdmuxflt_prc_t * p_prc = (webmdmuxflt_prc_t *) ap_obj;
+  assert (p_prc);
+  assert (ap_struct);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      OMX_TIME_CONFIG_TIMESTAMPTYPE * p_pos = ap_struct;
+      p_pos->nTimestamp = p_prc->pending_seek_us_ >= 0
+                            ? p_prc->pending_seek_us_
+                            : (OMX_TICKS) (p_prc->position_ns_ / 1000);
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      OMX_TIME_CONFIG_SEEKMODETYPE * p_mode = ap_struct;
+      p_mode->eType = p_prc->seek_mode_;
+    }
+  else if (OMX_TizoniaIndexConfigMediaDuration == a_index)
+    {
+      OMX_TIZONIA_MEDIADURATIONTYPE * p_duration = ap_struct;
+      p_duration->nDuration = p_prc->ne_inited_ && p_prc->ne_duration_ > 0
+                                ? (OMX_TICKS) (p_prc->ne_duration_ / 1000)
+                                : -1;
+    }
+  else
+    {
+      return super_GetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj,
+                              ap_hdl, a_index, ap_struct);
+    }
+  return OMX_ErrorNone;
+}
+
+static OMX_ERRORTYPE
+webmdmuxflt_prc_SetConfig (const void * ap_obj, OMX_HANDLETYPE ap_hdl,
+                           OMX_INDEXTYPE a_index, OMX_PTR ap_struct)
+{
+  webmdmuxflt_prc_t * p_prc = (webmdmuxflt_prc_t *) ap_obj;
+  assert (p_prc);
+  assert (ap_struct);
+
+  if (OMX_IndexConfigTimePosition == a_index)
+    {
+      const OMX_TIME_CONFIG_TIMESTAMPTYPE * p_pos = ap_struct;
+      const OMX_TICKS time_us = p_pos->nTimestamp > 0 ? p_pos->nTimestamp : 0;
+      if (!p_prc->ne_inited_)
+        {
+          /* Applied once the stream headers have been parsed */
+          p_prc->pending_seek_us_ = time_us;
+          return OMX_ErrorNone;
+        }
+      return seek_to_time (p_prc, (uint64_t) time_us * 1000);
+    }
+  else if (OMX_IndexConfigTimeSeekMode == a_index)
+    {
+      const OMX_TIME_CONFIG_SEEKMODETYPE * p_mode = ap_struct;
+      p_prc->seek_mode_ = p_mode->eType;
+      return OMX_ErrorNone;
+    }
+  return super_SetConfig (typeOf (ap_obj, "webmdmuxfltprc"), ap_obj, ap_hdl,
+                          a_index, ap_struct);
+}
+
 /*
  * webmdmuxflt_prc_class
  */
@@ -1335,6 +1717,10 @@ webmdmuxflt_prc_init (void * ap_tos, void * ap_hdl)
      tiz_prc_port_disable, webmdmuxflt_prc_port_disable,
      /* TIZ_CLASS_COMMENT: */
      tiz_prc_port_enable, webmdmuxflt_prc_port_enable,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_GetConfig, webmdmuxflt_prc_GetConfig,
+     /* TIZ_CLASS_COMMENT: */
+     tiz_api_SetConfig, webmdmuxflt_prc_SetConfig,
      /* TIZ_CLASS_COMMENT: stop value */
      0);
 
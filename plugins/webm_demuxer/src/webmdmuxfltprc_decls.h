@@ -35,6 +35,7 @@ extern "C" {
 #include <stdbool.h>
 
 #include <OMX_Core.h>
+#include <OMX_Other.h>
 
 #include <tizplatform.h>
 
@@ -43,6 +44,15 @@ extern "C" {
 
 #include "nestegg.h"
 
+/* A seek index entry: the offset of a Cluster and the timestamp of its first
+   block */
+typedef struct webmdmuxflt_idx_entry webmdmuxflt_idx_entry_t;
+struct webmdmuxflt_idx_entry
+{
+  uint64_t tstamp_ns;
+  int64_t offset;
+};
+
 typedef struct webmdmuxflt_prc webmdmuxflt_prc_t;
 struct webmdmuxflt_prc
 {
@@ -51,11 +61,12 @@ struct webmdmuxflt_prc
   tiz_buffer_t * p_webm_store_;
   tiz_buffer_t * p_aud_store_;
   tiz_buffer_t * p_vid_store_;
-  tiz_vector_t * p_aud_header_lengths_;
-  tiz_vector_t * p_vid_header_lengths_;
+  tiz_vector_t * p_aud_frame_lengths_;
+  tiz_vector_t * p_vid_frame_lengths_;
+  OMX_U32 aud_headers_pending_;
+  OMX_U32 vid_headers_pending_;
+  tiz_vector_t * p_seek_idx_;
   bool ne_inited_;
-  bool audio_metadata_delivered_;
-  bool video_metadata_delivered_;
   bool audio_auto_detect_on_;
   OMX_S32 audio_coding_type_;
   bool video_auto_detect_on_;
@@ -67,10 +78,15 @@ struct webmdmuxflt_prc
   unsigned int ne_audio_track_;
   unsigned int ne_video_track_;
   uint64_t ne_duration_;
-  nestegg_packet * p_ne_pkt_;
-  unsigned int ne_chunk_;
   int ne_read_err_;
   int ne_last_read_len_;
+  bool ne_seekable_;
+  uint64_t position_ns_;
+  uint64_t seek_target_ns_;
+  bool seeking_;
+  bool await_keyframe_;
+  OMX_S64 pending_seek_us_;
+  OMX_TIME_SEEKMODETYPE seek_mode_;
 };
 
 typedef struct webmdmuxflt_prc_class webmdmuxflt_prc_class_t;